@@ -13,6 +13,10 @@ MANLINKS+=AU_DevOut.3:AU_DelChannel.3
 CATLINKS+=AU_DevOut.cat3:AU_DelChannel.cat3
 MANLINKS+=AU_DevOut.3:AU_WriteFloat.3
 CATLINKS+=AU_DevOut.cat3:AU_WriteFloat.cat3
+MANLINKS+=AU_DevOut.3:AU_WriteChannel.3
+CATLINKS+=AU_DevOut.cat3:AU_WriteChannel.cat3
+MANLINKS+=AU_DevOut.3:AU_SetChannel.3
+CATLINKS+=AU_DevOut.cat3:AU_SetChannel.cat3
 MANLINKS+=AU_Wave.3:AU_WaveNew.3
 CATLINKS+=AU_Wave.cat3:AU_WaveNew.cat3
 MANLINKS+=AU_Wave.3:AU_WaveFromFile.3
@@ -34,63 +34,33 @@
 #include <agar/au/au_dev_out.h>
 
 #include <sndfile.h>
-#include <errno.h>
-#include <time.h>
+#include <string.h>
 
 typedef struct au_dev_out_wav {
 	struct au_dev_out _inherit;
 	SNDFILE  *file;
 	SF_INFO   info;
-	AG_Thread th;
-	float    *silence;			/* 1s of silence */
 } AU_DevOutFile;
 
 static void
 Init(void *obj)
 {
-	AU_DevOut *dev = obj;
 	AU_DevOutFile *df = obj;
 
-	dev->flags |= AU_DEV_OUT_THREADED;
 	df->file = NULL;
-	df->silence = NULL;
 	memset(&df->info, 0, sizeof(df->info));
 }
 
-static void *
-AU_DevFileThread(void *obj)
+static int
+Write(void *obj, const float *frames, Uint nFrames)
 {
-	AU_DevOut *dev = obj;
 	AU_DevOutFile *df = obj;
-	long rv;
-
-	for (;;) {
-		AG_MutexLock(&dev->lock);
-		if (dev->flags & AU_DEV_OUT_CLOSING) {
-			dev->flags &= ~(AU_DEV_OUT_CLOSING);
-			AG_MutexUnlock(&dev->lock);
-			return (NULL);
-		}
-		AG_CondBroadcast(&dev->wrRdy);
-		/* XXX */
-		if (dev->bufSize > dev->rate/1000) {
-			rv = sf_writef_float(df->file, dev->buf, dev->bufSize);
-			if (rv < dev->bufSize) {
-				dev->flags |= AU_DEV_OUT_ERROR;
-			}
-			dev->bufSize = 0;
-		} else {
-			/* Write ~1ms of silence */
-			rv = sf_writef_float(df->file, df->silence,
-			    dev->rate/1000);
-			if (rv < dev->rate) {
-				dev->flags |= AU_DEV_OUT_ERROR;
-			}
-		}
-		AG_MutexUnlock(&dev->lock);
-		AG_Delay(1);
+
+	if (sf_writef_float(df->file, frames, nFrames) < nFrames) {
+		AG_SetError("sf_writef_float: %s", sf_strerror(df->file));
+		return (-1);
 	}
-	return (NULL);
+	return (0);
 }
 
 static int
@@ -99,7 +69,6 @@ Open(void *obj, const char *path, int rate, int ch)
 	AU_DevOut *dev = obj;
 	AU_DevOutFile *df = obj;
 	const char *c;
-	int i;
 
 	if (df->file != NULL) {
 		AG_SetError("Audio dump to file already in progress");
@@ -110,14 +79,6 @@ Open(void *obj, const char *path, int rate, int ch)
 	df->info.channels = ch;
 	dev->rate = rate;
 	dev->ch = ch;
-	
-	/* Allocate 1s of silence */
-	if (df->silence == NULL &&
-	    (df->silence = TryMalloc(rate*dev->bytesPerFrame)) == NULL) {
-		return (-1);
-	}
-	for (i = 0; i < rate*ch; i++)
-		df->silence[i] = 0.0;
 
 	if ((c = strrchr(path, '.')) != NULL &&		/* XXX */
 	    AG_Strcasecmp(c, ".ogg") == 0) {
@@ -130,12 +91,6 @@ Open(void *obj, const char *path, int rate, int ch)
 		AG_SetError("%s(%d): %s", path, rate, sf_strerror(NULL));
 		return (-1);
 	}
-	if (AG_ThreadTryCreate(&df->th, AU_DevFileThread, df) != 0) {
-		sf_write_sync(df->file);
-		sf_close(df->file);
-		df->file = NULL;
-		return (-1);
-	}
 	return (0);
 }
 
@@ -149,8 +104,6 @@ Close(void *obj)
 		sf_close(df->file);
 		df->file = NULL;
 	}
-	Free(df->silence);
-	df->silence = NULL;
 }
 
 const AU_DevOutClass auDevOut_file = {
@@ -159,7 +112,8 @@ const AU_DevOutClass auDevOut_file = {
 	Init,
 	NULL,	/* Destroy */
 	Open,
-	Close
+	Close,
+	Write
 };
 
 #endif /* HAVE_SNDFILE */
@@ -29,10 +29,32 @@
 
 #include <agar/config/have_portaudio.h>
 #include <agar/config/have_sndfile.h>
+#include <agar/config/have_clock_gettime.h>
+#include <agar/config/have_gettimeofday.h>
 
 #include <agar/core/core.h>
 #include <agar/au/au_init.h>
 #include <agar/au/au_dev_out.h>
+#include <agar/au/au_math.h>
+
+#include <string.h>
+#include <time.h>
+#if !defined(HAVE_CLOCK_GETTIME) && defined(HAVE_GETTIMEOFDAY)
+# include <sys/time.h>
+#endif
+
+/*
+ * Ring positions are published with release semantics and read with
+ * acquire semantics, so that the samples written before a position update
+ * are visible to the other thread.
+ */
+#if defined(__GNUC__) && defined(__ATOMIC_ACQUIRE)
+# define LoadPos(p)    __atomic_load_n((p), __ATOMIC_ACQUIRE)
+# define StorePos(p,v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+# define LoadPos(p)    (*(volatile Uint *)(p))
+# define StorePos(p,v) (*(volatile Uint *)(p) = (v))
+#endif
 
 /* Available audio output drivers */
 extern const AU_DevOutClass auDevOut_pa;
@@ -48,6 +70,10 @@ const AU_DevOutClass *auDevOutList[] = {
 };
 const AU_DevOut *auDevOut = NULL;
 
+#ifdef AG_THREADS
+static void *_Nullable AU_DevOutThread(void *_Nonnull);
+#endif
+
 /* Start audio playback / dump on the specified output device. */
 AU_DevOut *
 AU_OpenOut(const char *path, int rate, int ch)
@@ -55,11 +81,11 @@ AU_OpenOut(const char *path, int rate, int ch)
 	AU_DevOut *dev = NULL;
 	char devName[128], devArgs[128], *c;
 	const AU_DevOutClass **pDevCls;
-	float *buf;
 	int i;
 
 	/* Parse arguments */
 	Strlcpy(devName, path, sizeof(devName));
+	devArgs[0] = '\0';
 	if ((c = strchr(devName, '(')) != NULL) {
 		Strlcpy(devArgs, &c[1], sizeof(devArgs));
 		*c = '\0';
@@ -76,44 +102,78 @@ AU_OpenOut(const char *path, int rate, int ch)
 		AG_SetError("No such output driver: %s", devName);
 		goto fail;
 	}
+	if (ch < 1 || ch > AU_DEV_CHANNELS_MAX) {
+		AG_SetError("Bad channel count: %d", ch);
+		goto fail;
+	}
 	if ((dev = TryMalloc((*pDevCls)->size)) == NULL)
 		return (NULL);
 
 	/* Initialize device instance */
 	dev->cls = *pDevCls;
 	dev->flags = 0;
-	dev->bufSize = 0;
-	dev->bufMax = AU_MINBUFSIZ;
 	dev->nOverruns = 0;
-	dev->rate = 0;
+	dev->rate = rate;
 	dev->ch = ch;
 	dev->bytesPerFrame = ch*sizeof(float);
-
+	dev->period = (Uint)(rate*AU_PERIOD_MS/1000);
+	if (dev->period == 0) {
+		dev->period = 1;
+	}
+	dev->ringSize = AU_PowOf2i(AU_MINBUFSIZ);
+	if (dev->ringSize < dev->period*2) {
+		dev->ringSize = AU_PowOf2i(dev->period*2);
+	}
 	Verbose("Audio out: %s: %dHz, %d-Ch, %d Bytes/Frame\n",
 	    path, rate, ch, dev->bytesPerFrame);
 
-	if ((buf = TryMalloc(dev->bufMax*dev->bytesPerFrame)) == NULL) {
+	if ((dev->buf = TryMalloc(dev->period*dev->bytesPerFrame)) == NULL) {
 		goto fail;
 	}
-	dev->buf = buf;
-
-	for (i = 0; i < dev->bufMax*ch; i++)
-		buf[i] = 0.0f;
-
 	AG_MutexInit(&dev->lock);
 	AG_CondInit(&dev->wrRdy);
 	AG_CondInit(&dev->rdRdy);
-	dev->chan = NULL;
+	for (i = 0; i < AU_CHANNELS_MAX; i++) {
+		dev->chan[i] = NULL;
+	}
 	dev->nChan = 0;
 
+	/* Channel 0 receives the frames written by AU_WriteFloat(). */
+	if (AU_AddChannel(dev) == -1)
+		goto fail_sync;
+
 	if (dev->cls->Init != NULL) {
 		dev->cls->Init(dev);
 	}
 	if (dev->cls->Open != NULL &&
 	    dev->cls->Open(dev, devArgs, rate, ch) == -1) {
-		return (NULL);
+		goto fail_open;
+	}
+	if (dev->cls->Write != NULL) {
+#ifdef AG_THREADS
+		if (AG_ThreadTryCreate(&dev->th, AU_DevOutThread, dev) != 0)
+			goto fail_close;
+		dev->flags |= AU_DEV_OUT_THREADED;
+#else
+		AG_SetError("Audio output requires threads");
+		goto fail_close;
+#endif
 	}
 	return (dev);
+fail_close:
+	if (dev->cls->Close != NULL) {
+		dev->cls->Close(dev);
+	}
+fail_open:
+	if (dev->cls->Destroy != NULL) {
+		dev->cls->Destroy(dev);
+	}
+	AU_DelChannel(dev, 0);
+fail_sync:
+	AG_CondDestroy(&dev->wrRdy);
+	AG_CondDestroy(&dev->rdRdy);
+	AG_MutexDestroy(&dev->lock);
+	Free(dev->buf);
 fail:
 	Free(dev);
 	return (NULL);
@@ -122,17 +182,20 @@ fail:
 void
 AU_CloseOut(AU_DevOut *dev)
 {
-	AG_MutexLock(&dev->lock);
-	dev->flags |= AU_DEV_OUT_CLOSING;
-	for (;;) {
-		AG_MutexUnlock(&dev->lock);
-		AG_Delay(250);
+	int i;
+
+#ifdef AG_THREADS
+	if (dev->flags & AU_DEV_OUT_THREADED) {
+		void *rv;
+
+		/* Let the output thread drain the channels and exit. */
 		AG_MutexLock(&dev->lock);
-		if ((dev->flags & AU_DEV_OUT_CLOSING) == 0)
-			break;
+		dev->flags |= AU_DEV_OUT_CLOSING;
+		AG_CondBroadcast(&dev->rdRdy);
+		AG_MutexUnlock(&dev->lock);
+		AG_ThreadJoin(dev->th, &rv);
 	}
-	AG_MutexUnlock(&dev->lock);
-
+#endif
 	if (dev->cls->Close != NULL) {
 		AG_MutexLock(&dev->lock);
 		dev->cls->Close(dev);
@@ -141,7 +204,10 @@ AU_CloseOut(AU_DevOut *dev)
 	if (dev->cls->Destroy != NULL) {
 		dev->cls->Destroy(dev);
 	}
-	Free(dev->chan);
+	for (i = 0; i < AU_CHANNELS_MAX; i++) {
+		if (dev->chan[i] != NULL)
+			AU_DelChannel(dev, i);
+	}
 	AG_CondDestroy(&dev->wrRdy);
 	AG_CondDestroy(&dev->rdRdy);
 	AG_MutexDestroy(&dev->lock);
@@ -149,24 +215,275 @@ AU_CloseOut(AU_DevOut *dev)
 	free(dev);
 }
 
+/* Return the number of frames pending in a ring. */
+static __inline__ Uint
+RingUsed(AU_Ring *_Nonnull r)
+{
+	return (LoadPos(&r->wrPos) - LoadPos(&r->rdPos));
+}
+
+#ifdef AG_THREADS
+/* Add frames multiplied by per-channel gains g to the mixing buffer. */
+static void
+MixFrames(float *_Nonnull _Restrict out, const float *_Nonnull _Restrict in,
+    Uint nFrames, Uint ch, const float *_Nonnull g)
+{
+	Uint i, c;
+
+	switch (ch) {
+	case 1:
+		{
+			const float g0 = g[0];
+
+			for (i = 0; i < nFrames; i++)
+				out[i] += in[i]*g0;
+		}
+		break;
+	case 2:
+		{
+			const float gL = g[0], gR = g[1];
+
+			for (i = 0; i < nFrames*2; i += 2) {
+				out[i]   += in[i]*gL;
+				out[i+1] += in[i+1]*gR;
+			}
+		}
+		break;
+	default:
+		for (i = 0; i < nFrames; i++) {
+			for (c = 0; c < ch; c++)
+				out[c] += in[c]*g[c];
+
+			out += ch;
+			in += ch;
+		}
+		break;
+	}
+}
+
+/*
+ * Mix up to nFrames pending frames of every channel into the mixing buffer
+ * (missing frames are silent). Return the largest number of frames read
+ * from a channel. The device must be locked.
+ */
+static Uint
+Mix(AU_DevOut *_Nonnull dev, Uint nFrames)
+{
+	float *out = dev->buf, g[AU_DEV_CHANNELS_MAX];
+	Uint i, c, nMax = 0;
+	const Uint ch = (Uint)dev->ch;
+
+	for (i = 0; i < nFrames*ch; i++)
+		out[i] = 0.0f;
+
+	for (i = 0; i < AU_CHANNELS_MAX; i++) {
+		AU_Channel *chan = dev->chan[i];
+		AU_Ring *r;
+		Uint n, n1, offs;
+
+		if (chan == NULL || (n = RingUsed(&chan->ring)) == 0) {
+			continue;
+		}
+		r = &chan->ring;
+		if (n > nFrames) {
+			n = nFrames;
+		} else if (n < nFrames) {
+			chan->nUnderruns++;
+		}
+		for (c = 0; c < ch; c++) {
+			g[c] = chan->vol;
+		}
+		if (ch >= 2) {
+			g[0] *= (chan->pan > 0.5f) ? 2.0f*(1.0f - chan->pan) : 1.0f;
+			g[1] *= (chan->pan < 0.5f) ? 2.0f*chan->pan : 1.0f;
+		}
+		offs = r->rdPos & (r->size - 1);
+		n1 = (n < r->size - offs) ? n : r->size - offs;
+		MixFrames(out, &r->buf[offs*ch], n1, ch, g);
+		if (n1 < n) {
+			MixFrames(&out[n1*ch], r->buf, n - n1, ch, g);
+		}
+		StorePos(&r->rdPos, r->rdPos + n);
+		if (n > nMax)
+			nMax = n;
+	}
+	if (nMax > 0) {
+		for (i = 0; i < nFrames*ch; i++) {
+			if (out[i] > 1.0f)       { out[i] = 1.0f; }
+			else if (out[i] < -1.0f) { out[i] = -1.0f; }
+		}
+		AG_CondBroadcast(&dev->wrRdy);
+	}
+	return (nMax);
+}
+
+/*
+ * Return 1 if a period can be mixed without padding any channel which
+ * has pending frames. The device must be locked.
+ */
+static int
+PeriodReady(AU_DevOut *_Nonnull dev)
+{
+	Uint i, n;
+	int ready = 0;
+
+	for (i = 0; i < AU_CHANNELS_MAX; i++) {
+		if (dev->chan[i] == NULL ||
+		    (n = RingUsed(&dev->chan[i]->ring)) == 0) {
+			continue;
+		}
+		if (n < dev->period) {
+			return (0);
+		}
+		ready = 1;
+	}
+	return (ready);
+}
+
+/*
+ * Wait up to one mixing period for the producers. The device must be
+ * locked. Return 0 if signaled, or nonzero if the period has elapsed.
+ */
+static int
+WaitPeriod(AU_DevOut *_Nonnull dev)
+{
+#if defined(HAVE_CLOCK_GETTIME) || defined(HAVE_GETTIMEOFDAY)
+	long ns = (long)((Uint64)dev->period*1000000000 / dev->rate);
+	struct timespec ts;
+# ifdef HAVE_CLOCK_GETTIME
+	clock_gettime(CLOCK_REALTIME, &ts);
+# else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	ts.tv_sec = tv.tv_sec;
+	ts.tv_nsec = tv.tv_usec*1000;
+# endif
+	ts.tv_nsec += ns;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec += ts.tv_nsec / 1000000000;
+		ts.tv_nsec %= 1000000000;
+	}
+	return AG_CondTimedWait(&dev->rdRdy, &dev->lock, &ts);
+#else
+	/*
+	 * No sub-second wall clock to express a deadline with; sleep for
+	 * the period instead (at the millisecond resolution of AG_Delay).
+	 */
+	Uint32 ms = (Uint32)((Uint64)dev->period*1000 / dev->rate);
+
+	AG_MutexUnlock(&dev->lock);
+	AG_Delay((ms > 0) ? ms : 1);
+	AG_MutexLock(&dev->lock);
+	return (1);
+#endif
+}
+
+/*
+ * Output thread. Mix one period whenever every active channel has a full
+ * period pending. If the producers fall behind by more than a period, mix
+ * whatever is available (or silence), so the device advances in real time.
+ */
+static void *
+AU_DevOutThread(void *obj)
+{
+	AU_DevOut *dev = obj;
+	Uint n;
+	int rv;
+
+	AG_MutexLock(&dev->lock);
+	for (;;) {
+		if (dev->flags & AU_DEV_OUT_CLOSING) {
+			while ((n = Mix(dev, dev->period)) > 0) {
+				if (dev->cls->Write(dev, dev->buf, n) == -1)
+					dev->flags |= AU_DEV_OUT_ERROR;
+			}
+			dev->flags &= ~(AU_DEV_OUT_CLOSING);
+			break;
+		}
+		if (!PeriodReady(dev) && WaitPeriod(dev) == 0)
+			continue;
+
+		Mix(dev, dev->period);
+
+		/* Mixing buffer belongs to this thread; write unlocked. */
+		AG_MutexUnlock(&dev->lock);
+		rv = dev->cls->Write(dev, dev->buf, dev->period);
+		AG_MutexLock(&dev->lock);
+		if (rv == -1)
+			dev->flags |= AU_DEV_OUT_ERROR;
+	}
+	AG_MutexUnlock(&dev->lock);
+	return (NULL);
+}
+#endif /* AG_THREADS */
+
+/* Write frames to virtual channel 0. */
 int
 AU_WriteFloat(AU_DevOut *dev, float *data, Uint nFrames)
 {
-	AG_MutexLock(&dev->lock);
-	if (dev->bufSize+nFrames > dev->bufMax) {
-		float *bufNew;
-		if ((bufNew = AG_TryRealloc(dev->buf,
-		    (dev->bufSize + nFrames)*dev->bytesPerFrame)) == NULL) {
+	return AU_WriteChannel(dev, 0, data, nFrames);
+}
+
+/*
+ * Queue nFrames frames (of dev->ch samples each) on a virtual channel.
+ * Only one thread may write to a given channel. If the channel ring is
+ * full, block until the output thread has mixed enough frames.
+ */
+int
+AU_WriteChannel(AU_DevOut *dev, int nChan, const float *data, Uint nFrames)
+{
+	AU_Channel *chan;
+	AU_Ring *r;
+	Uint wrPos, used, nFree, n, n1, offs, ch = (Uint)dev->ch;
+
+	if (nChan < 0 || nChan >= AU_CHANNELS_MAX ||
+	    (chan = dev->chan[nChan]) == NULL) {
+		AG_SetError("No such channel");
+		return (-1);
+	}
+	r = &chan->ring;
+	while (nFrames > 0) {
+		wrPos = r->wrPos;
+		if ((nFree = r->size - (wrPos - LoadPos(&r->rdPos))) == 0) {
+			if ((dev->flags & AU_DEV_OUT_THREADED) == 0) {
+				dev->nOverruns++;
+				AG_SetError("Channel overrun");
+				return (-1);
+			}
+			AG_MutexLock(&dev->lock);
+			while (RingUsed(r) == r->size &&
+			      !(dev->flags & AU_DEV_OUT_ERROR)) {
+				AG_CondBroadcast(&dev->rdRdy);
+				AG_CondWait(&dev->wrRdy, &dev->lock);
+			}
 			AG_MutexUnlock(&dev->lock);
-			return (-1);
+			if (dev->flags & AU_DEV_OUT_ERROR) {
+				AG_SetError("Audio output error");
+				return (-1);
+			}
+			continue;
 		}
-		dev->buf = bufNew;
-		dev->bufMax = dev->bufSize+nFrames;
+		used = r->size - nFree;
+		n = (nFrames < nFree) ? nFrames : nFree;
+		offs = wrPos & (r->size - 1);
+		n1 = (n < r->size - offs) ? n : r->size - offs;
+		memcpy(&r->buf[offs*ch], data, n1*ch*sizeof(float));
+		if (n1 < n) {
+			memcpy(r->buf, &data[n1*ch], (n - n1)*ch*sizeof(float));
+		}
+		StorePos(&r->wrPos, wrPos + n);
+
+		/* Wake the output thread once a full period is pending. */
+		if (used < dev->period && used+n >= dev->period &&
+		    (dev->flags & AU_DEV_OUT_THREADED)) {
+			AG_MutexLock(&dev->lock);
+			AG_CondSignal(&dev->rdRdy);
+			AG_MutexUnlock(&dev->lock);
+		}
+		data += n*ch;
+		nFrames -= n;
 	}
-	memcpy(&dev->buf[dev->bufSize*dev->ch], data, nFrames*dev->bytesPerFrame);
-	dev->bufSize += nFrames;
-	AG_CondBroadcast(&dev->rdRdy);
-	AG_MutexUnlock(&dev->lock);
 	return (0);
 }
 
@@ -174,38 +491,81 @@ AU_WriteFloat(AU_DevOut *dev, float *data, Uint nFrames)
 int
 AU_AddChannel(AU_DevOut *dev)
 {
-	AU_Channel *chanNew, *ch;
-	int rv;
+	AU_Channel *chan;
+	int i;
 
-	AG_MutexLock(&dev->lock);
-	if ((chanNew = TryRealloc(dev->chan, (dev->nChan+1)*sizeof(AU_Channel)))
+	if ((chan = TryMalloc(sizeof(AU_Channel))) == NULL) {
+		return (-1);
+	}
+	chan->vol = 1.0;
+	chan->pan = 0.5;
+	chan->nUnderruns = 0;
+	chan->ring.size = dev->ringSize;
+	chan->ring.ch = (Uint)dev->ch;
+	chan->ring.wrPos = 0;
+	chan->ring.rdPos = 0;
+	if ((chan->ring.buf = TryMalloc(dev->ringSize*dev->bytesPerFrame))
 	    == NULL) {
+		free(chan);
+		return (-1);
+	}
+
+	AG_MutexLock(&dev->lock);
+	for (i = 0; i < AU_CHANNELS_MAX; i++) {
+		if (dev->chan[i] == NULL)
+			break;
+	}
+	if (i == AU_CHANNELS_MAX) {
 		AG_MutexUnlock(&dev->lock);
+		AG_SetError("Too many channels");
+		free(chan->ring.buf);
+		free(chan);
 		return (-1);
 	}
-	dev->chan = chanNew;
-	ch = &dev->chan[(rv = dev->nChan++)];
-	ch->vol = 1.0;
-	ch->pan = 0.5;
+	dev->chan[i] = chan;
+	dev->nChan++;
 	AG_MutexUnlock(&dev->lock);
-	return (rv);
+	return (i);
 }
 
-/* Delete a virtual channel. */
+/*
+ * Delete a virtual channel. Frames pending on the channel are discarded.
+ * The indices of the other channels are unchanged.
+ */
 int
 AU_DelChannel(AU_DevOut *dev, int ch)
 {
+	AU_Channel *chan;
+
 	AG_MutexLock(&dev->lock);
-	if (ch < 0 || ch >= dev->nChan) {
+	if (ch < 0 || ch >= AU_CHANNELS_MAX || (chan = dev->chan[ch]) == NULL) {
 		AG_SetError("No such channel");
 		AG_MutexUnlock(&dev->lock);
 		return (-1);
 	}
-	if (ch < dev->nChan-1) {
-		memmove(&dev->chan[ch], &dev->chan[ch+1],
-		    (dev->nChan - ch - 1)*sizeof(AU_Channel));
-	}
+	dev->chan[ch] = NULL;
 	dev->nChan--;
 	AG_MutexUnlock(&dev->lock);
+
+	free(chan->ring.buf);
+	free(chan);
+	return (0);
+}
+
+/* Set the volume and stereo panning (0.0 = left, 1.0 = right) of a channel. */
+int
+AU_SetChannel(AU_DevOut *dev, int ch, float vol, float pan)
+{
+	AU_Channel *chan;
+
+	AG_MutexLock(&dev->lock);
+	if (ch < 0 || ch >= AU_CHANNELS_MAX || (chan = dev->chan[ch]) == NULL) {
+		AG_SetError("No such channel");
+		AG_MutexUnlock(&dev->lock);
+		return (-1);
+	}
+	chan->vol = vol;
+	chan->pan = (pan < 0.0f) ? 0.0f : (pan > 1.0f) ? 1.0f : pan;
+	AG_MutexUnlock(&dev->lock);
 	return (0);
 }
@@ -3,8 +3,13 @@
 #include <agar/core/begin.h>
 
 #ifndef AU_MINBUFSIZ
-#define AU_MINBUFSIZ 65536
+#define AU_MINBUFSIZ 65536		/* Channel ring capacity (frames) */
 #endif
+#ifndef AU_PERIOD_MS
+#define AU_PERIOD_MS 10			/* Mixing period (ms) */
+#endif
+#define AU_CHANNELS_MAX 32		/* Max virtual channels per device */
+#define AU_DEV_CHANNELS_MAX 32		/* Max device (output) channels */
 
 struct au_dev_out;
 
@@ -16,8 +21,22 @@ typedef struct au_dev_out_class {
 	void (*_Nullable Destroy)(void *_Nonnull);
 	int  (*_Nullable Open)(void *_Nonnull, const char *_Nonnull, int, int);
 	void (*_Nullable Close)(void *_Nonnull);
+	int  (*_Nullable Write)(void *_Nonnull, const float *_Nonnull, Uint);
 } AU_DevOutClass;
 
+/*
+ * Fixed-capacity ring of audio frames, written by a single producer and
+ * read by the output thread without locking. The positions are free-running
+ * frame counters.
+ */
+typedef struct au_ring {
+	float *_Nonnull buf;		/* Frames (size * ch samples) */
+	Uint size;			/* Capacity in frames (power of 2) */
+	Uint ch;			/* Samples per frame */
+	Uint wrPos;			/* Frames written (producer) */
+	Uint rdPos;			/* Frames read (output thread) */
+} AU_Ring;
+
 #if 0
 /* TODO */
 /* Buffered audio connection */
@@ -50,6 +69,8 @@ typedef struct au_link {
 typedef struct au_channel {
 	float vol;			/* Channel volume */
 	float pan;			/* Stereo panning */
+	AU_Ring ring;			/* Frames pending mixing */
+	int nUnderruns;			/* Periods only partially filled */
 #if 0
 	AG_TAILQ_HEAD_(au_link) links;	/* Device connections */
 #endif
@@ -66,14 +87,15 @@ typedef struct au_dev_out {
 	int rate;			/* Sample rate */
 	int ch;				/* Channel count */
 	int bytesPerFrame;		/* Bytes per audio frame */
-	float *_Nonnull buf;		/* Audio buffer */
-	AG_Size bufSize;		/* Buffer content size (frames) */
-	AG_Size bufMax;			/* Total buffer size (frames) */
+	float *_Nonnull buf;		/* Mixing buffer (one period) */
+	Uint period;			/* Frames mixed per period */
+	Uint ringSize;			/* Capacity of channel rings (frames) */
 	int nOverruns;			/* Overruns recorded */
-	_Nonnull AG_Cond wrRdy, rdRdy;	/* Buffer status */
+	_Nonnull AG_Cond wrRdy, rdRdy;	/* Space freed, frames written */
+	AG_Thread th;			/* Output thread */
 
-	AU_Channel *_Nullable chan;	/* Virtual channels */
-	Uint                 nChan;
+	AU_Channel *_Nullable chan[AU_CHANNELS_MAX]; /* Virtual channels */
+	Uint                  nChan;
 } AU_DevOut;
 
 #define AUDEVOUT(obj) ((AU_DevOut *)(obj))
@@ -85,9 +107,11 @@ AU_DevOut *_Nullable AU_OpenOut(const char *_Nonnull, int, int);
 void                 AU_CloseOut(AU_DevOut *_Nonnull);
 
 int AU_WriteFloat(AU_DevOut *_Nonnull, float *_Nonnull, Uint);
+int AU_WriteChannel(AU_DevOut *_Nonnull, int, const float *_Nonnull, Uint);
 
 int AU_AddChannel(AU_DevOut *_Nonnull);
 int AU_DelChannel(AU_DevOut *_Nonnull, int);
+int AU_SetChannel(AU_DevOut *_Nonnull, int, float, float);
 __END_DECLS
 
 #include <agar/core/close.h>
@@ -39,23 +39,18 @@
 typedef struct au_dev_out_pa {
 	struct au_dev_out _inherit;
 	PaStream *stream;
-	int wrPos;
-	AG_Thread th;
 } AU_DevOutPA;
 
 static void
 Init(void *obj)
 {
-	AU_DevOut *dev = obj;
 	AU_DevOutPA *dpa = obj;
 	PaError rv;
 	
 	if (Pa_GetVersion() < 1899)
 		AG_FatalError("Agar-AU requires PortAudio >= v19");
 
-	dev->flags |= AU_DEV_OUT_THREADED;
 	dpa->stream = NULL;
-	dpa->wrPos = 0;
 	
 	if ((rv = Pa_Initialize()) != paNoError) {
 		AG_Verbose("Pa_Initialize: %s", Pa_GetErrorText(rv));
@@ -63,36 +58,19 @@ Init(void *obj)
 	}
 }
 
-static void *
-AU_DevPaThread(void *obj)
+static int
+Write(void *obj, const float *frames, Uint nFrames)
 {
-	AU_DevOut *dev = obj;
 	AU_DevOutPA *dpa = obj;
-	struct timespec ts;
 	PaError rv;
 
-	for (;;) {
-		AG_MutexLock(&dev->lock);
-		if (dev->flags & AU_DEV_OUT_CLOSING) {
-			dev->flags &= ~(AU_DEV_OUT_CLOSING);
-			AG_MutexUnlock(&dev->lock);
-			return (NULL);
-		}
-		AG_CondBroadcast(&dev->wrRdy);
-		ts.tv_sec = time(NULL) + 1;
-		ts.tv_nsec = 0;
-		if (AG_CondTimedWait(&dev->rdRdy, &dev->lock, &ts) == 0) {
-			rv = Pa_WriteStream(dpa->stream, dev->buf, dev->bufSize);
-			if (rv != paNoError) {
-				printf("Pa_WriteStream: %s\n",
-				    Pa_GetErrorText(rv));
-			}
-			dev->bufSize = 0;
-		}
-		AG_CondBroadcast(&dev->wrRdy);
-		AG_MutexUnlock(&dev->lock);
+	/* Blocks until the device has room for the frames. */
+	if ((rv = Pa_WriteStream(dpa->stream, frames, nFrames)) != paNoError &&
+	    rv != paOutputUnderflowed) {
+		AG_SetError("Pa_WriteStream: %s", Pa_GetErrorText(rv));
+		return (-1);
 	}
-	return (NULL);
+	return (0);
 }
 
 static void
@@ -150,9 +128,6 @@ Open(void *obj, const char *path, int rate, int channels)
 		AG_SetError("PortAudio error: %s", Pa_GetErrorText(rv));
 		goto fail;
 	}
-	if (AG_ThreadTryCreate(&dpa->th, AU_DevPaThread, dpa) != 0) {
-		goto fail;
-	}
 	return (0);
 fail:
 	return (-1);
@@ -175,6 +150,7 @@ const AU_DevOutClass auDevOut_pa = {
 	Init,
 	Destroy,
 	Open,
-	Close
+	Close,
+	Write
 };
 #endif /* HAVE_PORTAUDIO */
@@ -219,6 +219,26 @@ MANLINKS+=AG_Db.3:AG_DbPut.3
 CATLINKS+=AG_Db.cat3:AG_DbPut.cat3
 MANLINKS+=AG_Db.3:AG_DbSync.3
 CATLINKS+=AG_Db.cat3:AG_DbSync.cat3
+MANLINKS+=AG_Db.3:AG_DbIterate.3
+CATLINKS+=AG_Db.cat3:AG_DbIterate.cat3
+MANLINKS+=AG_Db.3:AG_DbIteratePrefix.3
+CATLINKS+=AG_Db.cat3:AG_DbIteratePrefix.cat3
+MANLINKS+=AG_Db.3:AG_DbBegin.3
+CATLINKS+=AG_Db.cat3:AG_DbBegin.cat3
+MANLINKS+=AG_Db.3:AG_DbCommit.3
+CATLINKS+=AG_Db.cat3:AG_DbCommit.cat3
+MANLINKS+=AG_Db.3:AG_DbRollback.3
+CATLINKS+=AG_Db.cat3:AG_DbRollback.cat3
+MANLINKS+=AG_Db.3:AG_DbGetMulti.3
+CATLINKS+=AG_Db.cat3:AG_DbGetMulti.cat3
+MANLINKS+=AG_Db.3:AG_DbPutMulti.3
+CATLINKS+=AG_Db.cat3:AG_DbPutMulti.cat3
+MANLINKS+=AG_Db.3:AG_DbDelMulti.3
+CATLINKS+=AG_Db.cat3:AG_DbDelMulti.cat3
+MANLINKS+=AG_Db.3:AG_DbSetWriteBehind.3
+CATLINKS+=AG_Db.cat3:AG_DbSetWriteBehind.cat3
+MANLINKS+=AG_Db.3:AG_DbFlush.3
+CATLINKS+=AG_Db.cat3:AG_DbFlush.cat3
 MANLINKS+=AG_Error.3:AG_SetError.3
 CATLINKS+=AG_Error.cat3:AG_SetError.cat3
 MANLINKS+=AG_Error.3:AG_GetError.3
@@ -421,6 +441,22 @@ MANLINKS+=AG_File.3:AG_ShortFilename.3
 CATLINKS+=AG_File.cat3:AG_ShortFilename.cat3
 MANLINKS+=AG_File.3:AG_RegisterFileExtMappings.3
 CATLINKS+=AG_File.cat3:AG_RegisterFileExtMappings.cat3
+MANLINKS+=AG_HandleTbl.3:AG_HandleTblsInit.3
+CATLINKS+=AG_HandleTbl.cat3:AG_HandleTblsInit.cat3
+MANLINKS+=AG_HandleTbl.3:AG_HandleTblsFree.3
+CATLINKS+=AG_HandleTbl.cat3:AG_HandleTblsFree.cat3
+MANLINKS+=AG_HandleTbl.3:AG_HandleTblGet.3
+CATLINKS+=AG_HandleTbl.cat3:AG_HandleTblGet.cat3
+MANLINKS+=AG_HandleTbl.3:AG_HandleTblLookup.3
+CATLINKS+=AG_HandleTbl.cat3:AG_HandleTblLookup.cat3
+MANLINKS+=AG_HandleTbl.3:AG_HandleLookup.3
+CATLINKS+=AG_HandleTbl.cat3:AG_HandleLookup.cat3
+MANLINKS+=AG_HandleTbl.3:AG_HandleInsert.3
+CATLINKS+=AG_HandleTbl.cat3:AG_HandleInsert.cat3
+MANLINKS+=AG_HandleTbl.3:AG_HandleRemove.3
+CATLINKS+=AG_HandleTbl.cat3:AG_HandleRemove.cat3
+MANLINKS+=AG_HandleTbl.3:AG_HandleGenerate.3
+CATLINKS+=AG_HandleTbl.cat3:AG_HandleGenerate.cat3
 MANLINKS+=AG_List.3:AG_ListNew.3
 CATLINKS+=AG_List.cat3:AG_ListNew.cat3
 MANLINKS+=AG_List.3:AG_ListDup.3
@@ -1073,6 +1109,8 @@ MANLINKS+=AG_Variable.3:AG_Set.3
 CATLINKS+=AG_Variable.cat3:AG_Set.cat3
 MANLINKS+=AG_Variable.3:AG_Unset.3
 CATLINKS+=AG_Variable.cat3:AG_Unset.cat3
+MANLINKS+=AG_Variable.3:AG_VariableChanged.3
+CATLINKS+=AG_Variable.cat3:AG_VariableChanged.cat3
 MANLINKS+=AG_Variable.3:AG_VariableSubst.3
 CATLINKS+=AG_Variable.cat3:AG_VariableSubst.cat3
 MANLINKS+=AG_Variable.3:AG_GetUint.3
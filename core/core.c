@@ -39,6 +39,7 @@
 #include <agar/config/have_select.h>
 #include <agar/config/have_db4.h>
 #include <agar/config/have_db5.h>
+#include <agar/config/_mk_have_unistd_h.h>
 #include <agar/config/have_getpwuid.h>
 #include <agar/config/have_getuid.h>
 #include <agar/config/have_getaddrinfo.h>
@@ -145,6 +146,9 @@ AG_InitCore(const char *progname, Uint flags)
 #ifdef AG_SERIALIZATION
 	AG_RegisterClass(&agConfigClass);
 	AG_RegisterClass(&agDbClass);
+# ifdef _MK_HAVE_UNISTD_H
+	AG_RegisterClass(&agDbKVClass);
+# endif
 # if defined(HAVE_DB4) || defined(HAVE_DB5)
 	AG_RegisterClass(&agDbHashClass);
 	AG_RegisterClass(&agDbBtreeClass);
@@ -85,6 +85,7 @@
 #include <agar/core/list.h>
 #include <agar/core/tree.h>
 #include <agar/core/tbl.h>
+#include <agar/core/handle_tbl.h>
 #include <agar/core/cpuinfo.h>
 #include <agar/core/file.h>
 #include <agar/core/dir.h>
@@ -31,6 +31,7 @@
 #include <agar/core/list.h>
 #include <agar/core/tree.h>
 #include <agar/core/tbl.h>
+#include <agar/core/handle_tbl.h>
 #include <agar/core/config.h>
 #include <agar/core/file.h>
 #include <agar/core/dir.h>
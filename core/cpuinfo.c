@@ -127,6 +127,47 @@ X86_GetCPUID(int fn)
 #endif
 	return (regs);
 }
+
+/* Execute CPUID for a function which takes a subleaf argument in ECX. */
+static struct cpuid_regs /* _Pure_Attribute */
+X86_GetCPUIDSub(int fn, int sub)
+{
+	struct cpuid_regs regs;
+
+#if defined(__i386__) || defined(i386)
+	__asm(
+		"mov %%ebx, %%esi\n"
+		".byte 0x0f, 0xa2\n"
+		"xchg %%esi, %%ebx\n"
+		: "=a" (regs.a), "=S" (regs.b), "=c" (regs.c), "=d" (regs.d)
+		: "0" (fn), "2" (sub));
+
+#elif defined(__x86_64__)
+	__asm(
+		"mov %%rbx, %%rsi\n"
+		".byte 0x0f, 0xa2\n"
+		"xchg %%rsi, %%rbx\n"
+		: "=a" (regs.a), "=S" (regs.b), "=c" (regs.c), "=d" (regs.d)
+		: "0" (fn), "2" (sub));
+#endif
+	return (regs);
+}
+
+/*
+ * Read the XCR0 register (XGETBV), to check that the operating system
+ * saves the extended (YMM) register state on context switches.
+ */
+static Uint32
+X86_GetXCR0(void)
+{
+	Uint32 lo, hi;
+
+	__asm(
+		".byte 0x0f, 0x01, 0xd0\n"
+		: "=a" (lo), "=d" (hi)
+		: "c" (0));
+	return (lo);
+}
 #endif /* __GNUC__ && (__i386__ || __x86_64__) */
 
 #if defined(__i386__) || defined(i386) || defined(__x86_64__)
@@ -255,6 +296,16 @@ AG_GetCPUInfo(AG_CPUInfo *_Nonnull cpu)
 		if (rExt.c & 0x00000200) cpu->ext |= AG_EXT_SSSE3;
 		if (rExt.c & 0x00080000) cpu->ext |= AG_EXT_SSE41;
 		if (rExt.c & 0x00100000) cpu->ext |= AG_EXT_SSE42;
+
+		/* AVX requires OSXSAVE and OS support for the YMM state. */
+		if ((rExt.c & 0x18000000) == 0x18000000 &&
+		    (X86_GetXCR0() & 0x6) == 0x6) {
+			cpu->ext |= AG_EXT_AVX;
+		}
+	}
+	if (maxFns >= 7 && (cpu->ext & AG_EXT_AVX)) {
+		rExt = X86_GetCPUIDSub(7, 0);
+		if (rExt.b & 0x00000020) cpu->ext |= AG_EXT_AVX2;
 	}
 #endif /* i386 or x86_64 */
 
@@ -28,6 +28,7 @@
 
 #include <agar/config/have_db4.h>
 #include <agar/config/have_db5.h>
+#include <agar/config/_mk_have_unistd_h.h>
 #include <agar/core/core.h>
 
 /* Create a new database handle for the given database backend. */
@@ -37,10 +38,14 @@ AG_DbNew(const char *_Nonnull backend)
 	AG_Db *db;
 	AG_DbClass *dbc = NULL;
 
+#ifdef _MK_HAVE_UNISTD_H
+	if (strcmp(backend, "kv") == 0)
+		dbc = &agDbKVClass;
+#endif
 #if defined(HAVE_DB4) || defined(HAVE_DB5)
-	if (strcmp(backend, "hash")) {
+	if (strcmp(backend, "hash") == 0) {
 		dbc = &agDbHashClass;
-	} else if (strcmp(backend, "btree")) {
+	} else if (strcmp(backend, "btree") == 0) {
 		dbc = &agDbBtreeClass;
 	}
 #endif
@@ -48,13 +53,293 @@ AG_DbNew(const char *_Nonnull backend)
 		AG_SetError("No such database backend: %s", backend);
 		return (NULL);
 	}
-	if ((db = TryMalloc(sizeof(AG_Db))) == NULL) {
+	if ((db = TryMalloc(((AG_ObjectClass *)dbc)->size)) == NULL) {
 		return (NULL);
 	}
 	AG_ObjectInit(db, dbc);
 	return (db);
 }
 
+/*
+ * Write-behind buffer. Writes are queued in memory and passed to the
+ * backend in batches; reads check the queue first. The most recent
+ * write to each key is found through a hash table of buffer indices
+ * (which is at most half full).
+ */
+#define WB_TBL_SIZE	(AG_DB_WRITE_BEHIND_MAX*2)
+#define WB_FNV_INIT	2166136261U
+#define WB_FNV_PRIME	16777619U
+
+static void
+FreeWrites(AG_Db *_Nonnull db)
+{
+	Uint i;
+
+	for (i = 0; i < db->nWb; i++) {
+		free(db->wb[i].key.data);
+	}
+	if (db->nWb > 0) {
+		memset(db->wbTbl, 0, WB_TBL_SIZE*sizeof(Uint));
+	}
+	db->nWb = 0;
+	db->wbBytes = 0;
+}
+
+static __inline__ Uint32
+HashKey(const AG_Dbt *_Nonnull key)
+{
+	const Uint8 *p = key->data;
+	Uint32 h = WB_FNV_INIT;
+	AG_Size i;
+
+	for (i = 0; i < key->size; i++) {
+		h = (h ^ p[i]) * WB_FNV_PRIME;
+	}
+	return (h);
+}
+
+/*
+ * Return the hash table slot of the buffered write to a key, or the
+ * empty slot where it would be inserted.
+ */
+static Uint *_Nonnull
+LookupWriteSlot(AG_Db *_Nonnull db, const AG_Dbt *_Nonnull key, Uint32 hash)
+{
+	const Uint mask = WB_TBL_SIZE - 1;
+	Uint i;
+
+	for (i = hash & mask; db->wbTbl[i] != 0; i = (i+1) & mask) {
+		const AG_DbWrite *w = &db->wb[db->wbTbl[i] - 1];
+
+		if (w->hash == hash && w->key.size == key->size &&
+		    memcmp(w->key.data, key->data, key->size) == 0)
+			break;
+	}
+	return (&db->wbTbl[i]);
+}
+
+/* Return the most recent buffered write to a key. */
+static AG_DbWrite *_Nullable
+LookupWrite(AG_Db *_Nonnull db, const AG_Dbt *_Nonnull key)
+{
+	Uint slot = *LookupWriteSlot(db, key, HashKey(key));
+
+	return (slot != 0) ? &db->wb[slot-1] : NULL;
+}
+
+static int
+PutMultiOp(AG_Db *_Nonnull db, const AG_Dbt *_Nonnull keys,
+    const AG_Dbt *_Nonnull vals, Uint n)
+{
+	AG_DbClass *dbc = AGDB_CLASS(db);
+	Uint i;
+
+	if (dbc->putMulti != NULL) {
+		return dbc->putMulti(db, keys, vals, n);
+	}
+	for (i = 0; i < n; i++) {
+		if (dbc->put(db, &keys[i], &vals[i]) != 0)
+			return (-1);
+	}
+	return (0);
+}
+
+static int
+DelMultiOp(AG_Db *_Nonnull db, const AG_Dbt *_Nonnull keys, Uint n)
+{
+	AG_DbClass *dbc = AGDB_CLASS(db);
+	Uint i;
+	int rv;
+
+	if (dbc->delMulti != NULL) {
+		return dbc->delMulti(db, keys, n);
+	}
+	for (i = 0; i < n; i++) {
+		if ((rv = dbc->exists(db, &keys[i])) == -1) {
+			return (-1);
+		}
+		if (rv == 1 && dbc->del(db, &keys[i]) != 0)
+			return (-1);
+	}
+	return (0);
+}
+
+/*
+ * Pass buffered writes to the backend, as runs of consecutive puts and
+ * deletions (in a single transaction if the backend supports them). On
+ * failure the buffer is preserved, so the flush may be retried.
+ */
+static int
+FlushWrites(AG_Db *_Nonnull db)
+{
+	AG_DbClass *dbc = AGDB_CLASS(db);
+	AG_Dbt *keys, *vals;
+	Uint i, j, n;
+	int txn, rv = 0;
+
+	if (db->nWb == 0) {
+		return (0);
+	}
+	if ((keys = TryMalloc(db->nWb * sizeof(AG_Dbt))) == NULL) {
+		return (-1);
+	}
+	if ((vals = TryMalloc(db->nWb * sizeof(AG_Dbt))) == NULL) {
+		free(keys);
+		return (-1);
+	}
+	txn = (dbc->begin != NULL && dbc->begin(db) == 0);
+
+	for (i = 0; i < db->nWb && rv == 0; i = j) {
+		Uint del = (db->wb[i].flags & AG_DB_WRITE_DEL);
+
+		for (j = i, n = 0;
+		     j < db->nWb && (db->wb[j].flags & AG_DB_WRITE_DEL) == del;
+		     j++, n++) {
+			keys[n] = db->wb[j].key;
+			vals[n] = db->wb[j].val;
+		}
+		rv = del ? DelMultiOp(db, keys, n) :
+		           PutMultiOp(db, keys, vals, n);
+	}
+	if (txn) {
+		if (rv == 0) {
+			rv = dbc->commit(db);
+		} else {
+			dbc->rollback(db);
+		}
+	}
+	free(vals);
+	free(keys);
+	if (rv == 0) {
+		FreeWrites(db);
+	}
+	return (rv);
+}
+
+#ifdef AG_TIMERS
+static Uint32
+FlushTimeout(AG_Timer *_Nonnull to, AG_Event *_Nonnull event)
+{
+	AG_Db *db = AG_SELF();
+
+	AG_ObjectLock(db);
+	if (FlushWrites(db) == -1) {
+		Verbose("%s: %s\n", OBJECT(db)->name, AG_GetError());
+	}
+	AG_ObjectUnlock(db);
+	return (db->nWb > 0) ? db->wbIval : 0;		/* Retry on failure */
+}
+#endif
+
+/* Queue a put (or a deletion if val is NULL). */
+static int
+QueueWrite(AG_Db *_Nonnull db, const AG_Dbt *_Nonnull key,
+    const AG_Dbt *_Nullable val)
+{
+	AG_DbWrite *w;
+	AG_Size valSize = (val != NULL) ? val->size : 0;
+	Uint8 *data;
+
+	if (db->flags & AG_DB_READONLY) {
+		AG_SetError(_("Database is read-only"));
+		return (-1);
+	}
+	if (db->nWb == AG_DB_WRITE_BEHIND_MAX && FlushWrites(db) == -1) {
+		return (-1);
+	}
+	if (db->wb == NULL) {
+		if ((db->wb = TryMalloc(AG_DB_WRITE_BEHIND_MAX *
+		                        sizeof(AG_DbWrite))) == NULL) {
+			return (-1);
+		}
+		if ((db->wbTbl = TryMalloc(WB_TBL_SIZE*sizeof(Uint))) == NULL) {
+			free(db->wb);
+			db->wb = NULL;
+			return (-1);
+		}
+		memset(db->wbTbl, 0, WB_TBL_SIZE*sizeof(Uint));
+	}
+	if ((data = TryMalloc(key->size + valSize + 1)) == NULL) {
+		return (-1);
+	}
+	w = &db->wb[db->nWb++];
+	memcpy(data, key->data, key->size);
+	w->key.data = data;
+	w->key.size = key->size;
+	w->hash = HashKey(key);
+	*LookupWriteSlot(db, key, w->hash) = db->nWb;	/* Supersede */
+	if (val != NULL) {
+		memcpy(&data[key->size], val->data, valSize);
+		w->val.data = &data[key->size];
+		w->val.size = valSize;
+		w->flags = 0;
+	} else {
+		w->val.data = NULL;
+		w->val.size = 0;
+		w->flags = AG_DB_WRITE_DEL;
+	}
+	db->wbBytes += key->size + valSize;
+
+	if (db->nWb == 1) {
+		db->tWb = AG_GetTicks();
+#ifdef AG_TIMERS
+		if (db->wbIval > 0 && !AG_TimerIsRunning(db, &db->wbTimer))
+			AG_AddTimer(db, &db->wbTimer, db->wbIval,
+			    FlushTimeout, NULL);
+#endif
+	}
+	return (0);
+}
+
+/* Flush the write-behind buffer if it is full or old enough. */
+static int
+CheckWrites(AG_Db *_Nonnull db)
+{
+	if (db->wbBytes >= db->wbSize ||
+	    (db->wbIval > 0 && AG_GetTicks() - db->tWb >= db->wbIval)) {
+		return FlushWrites(db);
+	}
+	return (0);
+}
+
+/*
+ * Enable write-behind buffering of AG_DbPut() and AG_DbDel(). Buffered
+ * writes are passed to the backend in batches once size bytes have
+ * accumulated, or ival milliseconds after the first buffered write.
+ * A size of 0 flushes the buffer and disables buffering.
+ */
+int
+AG_DbSetWriteBehind(AG_Db *db, AG_Size size, Uint ival)
+{
+	int rv = 0;
+
+	AG_ObjectLock(db);
+	db->wbSize = size;
+	db->wbIval = ival;
+	if (size == 0) {
+		if ((rv = FlushWrites(db)) == 0) {
+			Free(db->wb);
+			Free(db->wbTbl);
+			db->wb = NULL;
+			db->wbTbl = NULL;
+		}
+	}
+	AG_ObjectUnlock(db);
+	return (rv);
+}
+
+/* Pass any buffered writes to the backend. */
+int
+AG_DbFlush(AG_Db *db)
+{
+	int rv;
+
+	AG_ObjectLock(db);
+	rv = FlushWrites(db);
+	AG_ObjectUnlock(db);
+	return (rv);
+}
+
 /* Open a database. */
 int
 AG_DbOpen(AG_Db *db, const char *path, Uint flags)
@@ -87,6 +372,11 @@ AG_DbClose(AG_Db *db)
 	
 	AG_ObjectLock(db);
 	if (db->flags & AG_DB_OPEN) {
+		if (FlushWrites(db) == -1) {
+			Verbose("%s: Lost %u writes (%s)\n", OBJECT(db)->name,
+			    db->nWb, AG_GetError());
+			FreeWrites(db);
+		}
 		if (dbc->close != NULL) {
 			dbc->close(db);
 		}
@@ -103,7 +393,9 @@ AG_DbSync(AG_Db *db)
 	int rv;
 	
 	AG_ObjectLock(db);
-	rv = (dbc->sync != NULL) ? dbc->sync(db) : 0;
+	if ((rv = FlushWrites(db)) == 0) {
+		rv = (dbc->sync != NULL) ? dbc->sync(db) : 0;
+	}
 	AG_ObjectUnlock(db);
 	return (rv);
 }
@@ -113,23 +405,50 @@ int
 AG_DbExists(AG_Db *db, AG_Dbt *key)
 {
 	AG_DbClass *dbc = AGDB_CLASS(db);
+	AG_DbWrite *w;
 	int rv;
 
 	AG_ObjectLock(db);
-	rv = dbc->exists(db, key);
+	if (db->nWb > 0 && (w = LookupWrite(db, key)) != NULL) {
+		rv = !(w->flags & AG_DB_WRITE_DEL);
+	} else {
+		rv = dbc->exists(db, key);
+	}
 	AG_ObjectUnlock(db);
 	return (rv);
 }
 
+/* Copy the value of a buffered write. */
+static int
+GetWrite(const AG_DbWrite *_Nonnull w, AG_Dbt *_Nonnull val)
+{
+	if ((val->data = TryMalloc(w->val.size + 1)) == NULL) {
+		return (-1);
+	}
+	memcpy(val->data, w->val.data, w->val.size);
+	val->size = w->val.size;
+	return (0);
+}
+
 /* Retrieve a database entry. */
 int
 AG_DbGet(AG_Db *_Nonnull db, const AG_Dbt *_Nonnull key, AG_Dbt *_Nonnull val)
 {
 	AG_DbClass *dbc = AGDB_CLASS(db);
+	AG_DbWrite *w;
 	int rv;
 
 	AG_ObjectLock(db);
-	rv = dbc->get(db, key, val);
+	if (db->nWb > 0 && (w = LookupWrite(db, key)) != NULL) {
+		if (w->flags & AG_DB_WRITE_DEL) {
+			AG_SetError(_("No such key"));
+			rv = -1;
+		} else {
+			rv = GetWrite(w, val);
+		}
+	} else {
+		rv = dbc->get(db, key, val);
+	}
 	AG_ObjectUnlock(db);
 	return (rv);
 }
@@ -142,7 +461,12 @@ AG_DbPut(AG_Db *db, const AG_Dbt *key, const AG_Dbt *val)
 	int rv;
 
 	AG_ObjectLock(db);
-	rv = dbc->put(db, key, val);
+	if (db->wbSize > 0 && !(db->flags & AG_DB_TXN)) {
+		if ((rv = QueueWrite(db, key, val)) == 0)
+			rv = CheckWrites(db);
+	} else {
+		rv = dbc->put(db, key, val);
+	}
 	AG_ObjectUnlock(db);
 	return (rv);
 }
@@ -155,7 +479,161 @@ AG_DbDel(AG_Db *_Nonnull db, const AG_Dbt *_Nonnull key)
 	int rv;
 
 	AG_ObjectLock(db);
-	rv = dbc->del(db, key);
+	if (db->wbSize > 0 && !(db->flags & AG_DB_TXN)) {
+		if ((rv = QueueWrite(db, key, NULL)) == 0)
+			rv = CheckWrites(db);
+	} else {
+		rv = dbc->del(db, key);
+	}
+	AG_ObjectUnlock(db);
+	return (rv);
+}
+
+static int
+GetMultiOp(AG_Db *_Nonnull db, const AG_Dbt *_Nonnull keys,
+    AG_Dbt *_Nonnull vals, Uint n)
+{
+	AG_DbClass *dbc = AGDB_CLASS(db);
+	Uint i;
+	int rv, nFound = 0;
+
+	if (dbc->getMulti != NULL) {
+		return dbc->getMulti(db, keys, vals, n);
+	}
+	for (i = 0; i < n; i++) {
+		vals[i].data = NULL;
+		vals[i].size = 0;
+	}
+	for (i = 0; i < n; i++) {
+		if ((rv = dbc->exists(db, &keys[i])) == -1) {
+			goto fail;
+		}
+		if (rv == 0) {
+			continue;
+		}
+		if (dbc->get(db, &keys[i], &vals[i]) != 0) {
+			goto fail;
+		}
+		nFound++;
+	}
+	return (nFound);
+fail:
+	for (i = 0; i < n; i++) {
+		Free(vals[i].data);
+		vals[i].data = NULL;
+	}
+	return (-1);
+}
+
+/*
+ * Retrieve the entries for n keys. Values are returned as newly-allocated
+ * memory in vals (with NULL data for keys which were not found). Return
+ * the number of keys found, or -1 if an error has occurred.
+ */
+int
+AG_DbGetMulti(AG_Db *db, const AG_Dbt *keys, AG_Dbt *vals, Uint n)
+{
+	AG_Dbt *missKeys = NULL, *missVals = NULL;
+	Uint *miss = NULL, nMiss = 0, i;
+	int rv, nFound = 0;
+
+	AG_ObjectLock(db);
+	if (db->nWb == 0) {
+		rv = GetMultiOp(db, keys, vals, n);
+		goto out;
+	}
+	if ((miss = TryMalloc(n * sizeof(Uint))) == NULL ||
+	    (missKeys = TryMalloc(n * sizeof(AG_Dbt))) == NULL ||
+	    (missVals = TryMalloc(n * sizeof(AG_Dbt))) == NULL) {
+		rv = -1;
+		goto out;
+	}
+	for (i = 0; i < n; i++) {
+		AG_DbWrite *w;
+
+		vals[i].data = NULL;
+		vals[i].size = 0;
+		if ((w = LookupWrite(db, &keys[i])) == NULL) {
+			missKeys[nMiss] = keys[i];
+			miss[nMiss++] = i;
+			continue;
+		}
+		if (w->flags & AG_DB_WRITE_DEL) {
+			continue;
+		}
+		if (GetWrite(w, &vals[i]) == -1) {
+			goto fail;
+		}
+		nFound++;
+	}
+	if (nMiss > 0) {
+		if ((rv = GetMultiOp(db, missKeys, missVals, nMiss)) == -1) {
+			goto fail;
+		}
+		for (i = 0; i < nMiss; i++) {
+			vals[miss[i]] = missVals[i];
+		}
+		nFound += rv;
+	}
+	rv = nFound;
+out:
+	Free(missVals);
+	Free(missKeys);
+	Free(miss);
+	AG_ObjectUnlock(db);
+	return (rv);
+fail:
+	for (i = 0; i < n; i++) {
+		Free(vals[i].data);
+		vals[i].data = NULL;
+	}
+	rv = -1;
+	goto out;
+}
+
+/*
+ * Write n entries. Backends implementing batch writes apply them
+ * atomically, in a single round trip.
+ */
+int
+AG_DbPutMulti(AG_Db *db, const AG_Dbt *keys, const AG_Dbt *vals, Uint n)
+{
+	Uint i;
+	int rv = 0;
+
+	AG_ObjectLock(db);
+	if (db->wbSize > 0 && !(db->flags & AG_DB_TXN)) {
+		for (i = 0; i < n; i++) {
+			if ((rv = QueueWrite(db, &keys[i], &vals[i])) != 0)
+				break;
+		}
+		if (rv == 0)
+			rv = CheckWrites(db);
+	} else {
+		rv = PutMultiOp(db, keys, vals, n);
+	}
+	AG_ObjectUnlock(db);
+	return (rv);
+}
+
+/* Delete the entries for n keys. Keys which do not exist are ignored. */
+int
+AG_DbDelMulti(AG_Db *db, const AG_Dbt *keys, Uint n)
+{
+	Uint i;
+	int rv = 0;
+
+	AG_ObjectLock(db);
+	if (db->wbSize > 0 && !(db->flags & AG_DB_TXN)) {
+		for (i = 0; i < n; i++) {
+			if ((rv = QueueWrite(db, &keys[i], NULL)) != 0)
+				break;
+		}
+		if (rv == 0)
+			rv = CheckWrites(db);
+	} else {
+		rv = DelMultiOp(db, keys, n);
+	}
 	AG_ObjectUnlock(db);
 	return (rv);
 }
@@ -168,7 +646,113 @@ AG_DbIterate(AG_Db *db, AG_DbIterateFn fn, void *arg)
 	int rv;
 
 	AG_ObjectLock(db);
-	rv = dbc->iterate(db, fn, arg);
+	if ((rv = FlushWrites(db)) == 0) {
+		rv = dbc->iterate(db, fn, arg);
+	}
+	AG_ObjectUnlock(db);
+	return (rv);
+}
+
+/*
+ * Iterate over the entries whose keys begin with the given prefix. Backends
+ * without native support are iterated in full and filtered.
+ */
+struct ag_db_prefix_args {
+	const AG_Dbt *_Nonnull prefix;
+	AG_DbIterateFn fn;
+	void *_Nullable arg;
+};
+
+static int
+IteratePrefixFilter(const AG_Dbt *_Nonnull key, const AG_Dbt *_Nonnull val,
+    void *_Nullable p)
+{
+	struct ag_db_prefix_args *args = p;
+
+	if (key->size < args->prefix->size ||
+	    memcmp(key->data, args->prefix->data, args->prefix->size) != 0) {
+		return (0);
+	}
+	return args->fn(key, val, args->arg);
+}
+
+int
+AG_DbIteratePrefix(AG_Db *db, const AG_Dbt *prefix, AG_DbIterateFn fn,
+    void *arg)
+{
+	AG_DbClass *dbc = AGDB_CLASS(db);
+	struct ag_db_prefix_args args;
+	int rv;
+
+	AG_ObjectLock(db);
+	if ((rv = FlushWrites(db)) != 0) {
+		goto out;
+	}
+	if (dbc->iteratePrefix != NULL) {
+		rv = dbc->iteratePrefix(db, prefix, fn, arg);
+	} else {
+		args.prefix = prefix;
+		args.fn = fn;
+		args.arg = arg;
+		rv = dbc->iterate(db, IteratePrefixFilter, &args);
+	}
+out:
+	AG_ObjectUnlock(db);
+	return (rv);
+}
+
+/*
+ * Begin a transaction. Writes until AG_DbCommit() are applied atomically
+ * (bypassing the write-behind buffer). The database remains locked until
+ * AG_DbCommit() or AG_DbRollback(). Fails on backends which do not
+ * implement transactions.
+ */
+int
+AG_DbBegin(AG_Db *db)
+{
+	AG_DbClass *dbc = AGDB_CLASS(db);
+
+	if (dbc->begin == NULL) {
+		AG_SetError(_("Transactions not supported by this backend"));
+		return (-1);
+	}
+	AG_ObjectLock(db);
+	if (FlushWrites(db) != 0 ||
+	    dbc->begin(db) != 0) {
+		AG_ObjectUnlock(db);
+		return (-1);
+	}
+	db->flags |= AG_DB_TXN;
+	return (0);
+}
+
+/* Commit the current transaction. */
+int
+AG_DbCommit(AG_Db *db)
+{
+	AG_DbClass *dbc = AGDB_CLASS(db);
+	int rv;
+
+	rv = (dbc->commit != NULL) ? dbc->commit(db) : 0;
+	db->flags &= ~(AG_DB_TXN);
+	AG_ObjectUnlock(db);
+	return (rv);
+}
+
+/* Discard the writes of the current transaction. */
+int
+AG_DbRollback(AG_Db *db)
+{
+	AG_DbClass *dbc = AGDB_CLASS(db);
+	int rv;
+
+	if (dbc->rollback != NULL) {
+		rv = dbc->rollback(db);
+	} else {
+		AG_SetError(_("Rollback is not supported by %s"), dbc->name);
+		rv = -1;
+	}
+	db->flags &= ~(AG_DB_TXN);
 	AG_ObjectUnlock(db);
 	return (rv);
 }
@@ -179,6 +763,29 @@ Init(void *_Nonnull obj)
 	AG_Db *db = obj;
 
 	db->flags = 0;
+	db->wbIval = 0;
+	db->wbSize = 0;
+	db->wbBytes = 0;
+	db->wb = NULL;
+	db->wbTbl = NULL;
+	db->nWb = 0;
+	db->tWb = 0;
+#ifdef AG_TIMERS
+	AG_InitTimer(&db->wbTimer, "flush", 0);
+#endif
+}
+
+static void
+Destroy(void *_Nonnull obj)
+{
+	AG_Db *db = obj;
+
+#ifdef AG_TIMERS
+	AG_DelTimer(db, &db->wbTimer);
+#endif
+	FreeWrites(db);
+	Free(db->wb);
+	Free(db->wbTbl);
 }
 
 AG_DbClass agDbClass = {
@@ -188,7 +795,7 @@ AG_DbClass agDbClass = {
 		{ 0,0 },
 		Init,
 		NULL,		/* free */
-		NULL,		/* destroy */
+		Destroy,
 		NULL,		/* load */
 		NULL,		/* save */
 		NULL		/* edit */
@@ -204,7 +811,14 @@ AG_DbClass agDbClass = {
 	NULL,			/* get */
 	NULL,			/* put */
 	NULL,			/* del */
-	NULL			/* iterate */
+	NULL,			/* iterate */
+	NULL,			/* begin */
+	NULL,			/* commit */
+	NULL,			/* rollback */
+	NULL,			/* iteratePrefix */
+	NULL,			/* getMulti */
+	NULL,			/* putMulti */
+	NULL			/* delMulti */
 };
 
 #endif /* AG_SERIALIZATION */
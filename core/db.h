@@ -12,8 +12,8 @@ struct ag_db;
 
 /* Database data item (e.g., key or value) */
 typedef struct ag_dbt {
-	void *_Nonnull data;
-	AG_Size        size;
+	void *_Nullable data;
+	AG_Size         size;
 } AG_Dbt;
 
 typedef int (*AG_DbIterateFn)(const AG_Dbt *_Nonnull,
@@ -44,15 +44,47 @@ typedef struct ag_db_class {
 	int  (*_Nonnull  del)(void *_Nonnull, const AG_Dbt *_Nonnull);
 	int  (*_Nullable iterate)(void *_Nonnull, _Nonnull AG_DbIterateFn,
 	                          void *_Nullable);
+	int  (*_Nullable begin)(void *_Nonnull);
+	int  (*_Nullable commit)(void *_Nonnull);
+	int  (*_Nullable rollback)(void *_Nonnull);
+	int  (*_Nullable iteratePrefix)(void *_Nonnull, const AG_Dbt *_Nonnull,
+	                                _Nonnull AG_DbIterateFn, void *_Nullable);
+	int  (*_Nullable getMulti)(void *_Nonnull, const AG_Dbt *_Nonnull,
+	                           AG_Dbt *_Nonnull, Uint);
+	int  (*_Nullable putMulti)(void *_Nonnull, const AG_Dbt *_Nonnull,
+	                           const AG_Dbt *_Nonnull, Uint);
+	int  (*_Nullable delMulti)(void *_Nonnull, const AG_Dbt *_Nonnull, Uint);
 } AG_DbClass;
 
 #define AGDB_CLASS(db) ((AG_DbClass *)AGOBJECT(db)->cls)
 
+#define AG_DB_WRITE_BEHIND_MAX 1024	/* Max buffered writes */
+
+/* Buffered write (see AG_DbSetWriteBehind()). */
+typedef struct ag_db_write {
+	AG_Dbt key;
+	AG_Dbt val;			/* Value (unused for deletions) */
+	Uint flags;
+#define AG_DB_WRITE_DEL	0x01		/* Deletion */
+	Uint32 hash;			/* Hash of key */
+} AG_DbWrite;
+
 typedef struct ag_db {
 	struct ag_object _inherit;
 	Uint flags;
 #define AG_DB_OPEN	0x01		/* Database is open */
 #define AG_DB_READONLY	0x02		/* Open in read-only mode */
+#define AG_DB_TXN	0x04		/* Transaction in progress */
+	Uint wbIval;			/* Write-behind flush interval (ms) */
+	AG_Size wbSize;			/* Write-behind flush size (or 0) */
+	AG_Size wbBytes;		/* Bytes in write-behind buffer */
+	AG_DbWrite *_Nullable wb;	/* Write-behind buffer */
+	Uint *_Nullable wbTbl;		/* Hash table of write index+1 */
+	Uint nWb;
+	Uint32 tWb;			/* Time of first buffered write */
+#ifdef AG_TIMERS
+	AG_Timer wbTimer;		/* Write-behind flush timer */
+#endif
 } AG_Db;
 
 #define AGDB(p) ((AG_Db *)(p))
@@ -62,6 +94,7 @@ extern AG_DbClass agDbClass;
 extern AG_DbClass agDbHashClass;
 extern AG_DbClass agDbBtreeClass;
 extern AG_DbClass agDbMySQLClass;
+extern AG_DbClass agDbKVClass;
 
 AG_Db *_Nullable AG_DbNew(const char *_Nonnull);
 int              AG_DbOpen(AG_Db *_Nonnull, const char *_Nonnull, Uint);
@@ -73,6 +106,21 @@ int AG_DbGet(AG_Db *_Nonnull, const AG_Dbt *_Nonnull, AG_Dbt *_Nonnull);
 int AG_DbPut(AG_Db *_Nonnull, const AG_Dbt *_Nonnull, const AG_Dbt *_Nonnull);
 int AG_DbDel(AG_Db *_Nonnull, const AG_Dbt *_Nonnull);
 int AG_DbIterate(AG_Db *_Nonnull, _Nonnull AG_DbIterateFn, void *_Nullable);
+int AG_DbIteratePrefix(AG_Db *_Nonnull, const AG_Dbt *_Nonnull,
+                       _Nonnull AG_DbIterateFn, void *_Nullable);
+
+int AG_DbGetMulti(AG_Db *_Nonnull, const AG_Dbt *_Nonnull, AG_Dbt *_Nonnull,
+                  Uint);
+int AG_DbPutMulti(AG_Db *_Nonnull, const AG_Dbt *_Nonnull,
+                  const AG_Dbt *_Nonnull, Uint);
+int AG_DbDelMulti(AG_Db *_Nonnull, const AG_Dbt *_Nonnull, Uint);
+
+int  AG_DbSetWriteBehind(AG_Db *_Nonnull, AG_Size, Uint);
+int  AG_DbFlush(AG_Db *_Nonnull);
+
+int AG_DbBegin(AG_Db *_Nonnull);
+int AG_DbCommit(AG_Db *_Nonnull);
+int AG_DbRollback(AG_Db *_Nonnull);
 __END_DECLS
 
 #include <agar/core/close.h>
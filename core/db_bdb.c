@@ -225,6 +225,78 @@ Del(void *_Nonnull obj, const AG_Dbt *_Nonnull key)
 	return (rv != 0) ? -1 : 0;
 }
 
+#ifdef DB_MULTIPLE_KEY_WRITE_NEXT
+/* Write n entries with a single bulk put operation. */
+static int
+PutMulti(void *_Nonnull obj, const AG_Dbt *_Nonnull keys,
+    const AG_Dbt *_Nonnull vals, Uint n)
+{
+	AG_DbHashBT *db = obj;
+	DBT dbBulk, dbNone;
+	AG_Size size = 2*sizeof(u_int32_t);
+	void *p;
+	Uint i;
+	int rv;
+
+	for (i = 0; i < n; i++) {
+		size += keys[i].size + vals[i].size + 4*sizeof(u_int32_t);
+	}
+	size = (size + 1023) & ~((AG_Size)1023);
+
+	memset(&dbBulk, 0, sizeof(DBT));
+	if ((dbBulk.data = TryMalloc(size)) == NULL) {
+		return (-1);
+	}
+	dbBulk.ulen = (u_int32_t)size;
+	dbBulk.flags = DB_DBT_USERMEM | DB_DBT_BULK;
+
+	DB_MULTIPLE_WRITE_INIT(p, &dbBulk);
+	for (i = 0; i < n; i++) {
+		DB_MULTIPLE_KEY_WRITE_NEXT(p, &dbBulk,
+		    keys[i].data, keys[i].size,
+		    vals[i].data, vals[i].size);
+		if (p == NULL) {
+			AG_SetError("db_put: Bulk buffer overflow");
+			goto fail;
+		}
+	}
+	memset(&dbNone, 0, sizeof(DBT));
+	rv = db->pDB->put(db->pDB, NULL, &dbBulk, &dbNone, DB_MULTIPLE_KEY);
+	if (rv != 0) {
+		AG_SetError("db_put: %s", db_strerror(rv));
+		goto fail;
+	}
+	free(dbBulk.data);
+	return (0);
+fail:
+	free(dbBulk.data);
+	return (-1);
+}
+#endif /* DB_MULTIPLE_KEY_WRITE_NEXT */
+
+/* Delete the existing keys among n keys. */
+static int
+DelMulti(void *_Nonnull obj, const AG_Dbt *_Nonnull keys, Uint n)
+{
+	AG_DbHashBT *db = obj;
+	DBT dbKey;
+	Uint i;
+	int rv;
+
+	for (i = 0; i < n; i++) {
+		memset(&dbKey, 0, sizeof(DBT));
+		dbKey.data = keys[i].data;
+		dbKey.size = keys[i].size;
+
+		rv = db->pDB->del(db->pDB, NULL, &dbKey, 0);
+		if (rv != 0 && rv != DB_NOTFOUND) {
+			AG_SetError("DB Delete: %s", db_strerror(rv));
+			return (-1);
+		}
+	}
+	return (0);
+}
+
 static int
 Iterate(void *_Nonnull obj, AG_DbIterateFn fn, void *_Nullable arg)
 {
@@ -282,7 +354,18 @@ AG_DbClass agDbHashClass = {
 	Get,
 	Put,
 	Del,
-	Iterate
+	Iterate,
+	NULL,			/* begin */
+	NULL,			/* commit */
+	NULL,			/* rollback */
+	NULL,			/* iteratePrefix */
+	NULL,			/* getMulti */
+#ifdef DB_MULTIPLE_KEY_WRITE_NEXT
+	PutMulti,
+#else
+	NULL,			/* putMulti */
+#endif
+	DelMulti
 };
 AG_DbClass agDbBtreeClass = {
 	{
@@ -307,5 +390,16 @@ AG_DbClass agDbBtreeClass = {
 	Get,
 	Put,
 	Del,
-	Iterate
+	Iterate,
+	NULL,			/* begin */
+	NULL,			/* commit */
+	NULL,			/* rollback */
+	NULL,			/* iteratePrefix */
+	NULL,			/* getMulti */
+#ifdef DB_MULTIPLE_KEY_WRITE_NEXT
+	PutMulti,
+#else
+	NULL,			/* putMulti */
+#endif
+	DelMulti
 };
@@ -0,0 +1,1502 @@
+/*
+ * Copyright (c) 2026 Julien Nadeau Carriere <vedge@csoft.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Built-in key/value database backend ("kv"). Records are appended to a
+ * log file in batches terminated by a checksummed commit record, so a
+ * batch is either entirely present or discarded on the next open. The
+ * index (keys and value offsets) is kept in memory and values are read
+ * through a shared mapping of the file. When dead records outweigh live
+ * ones, the log is compacted into a fresh file on sync.
+ */
+
+#include <agar/config/ag_serialization.h>
+#include <agar/config/_mk_have_unistd_h.h>
+#if defined(AG_SERIALIZATION) && defined(_MK_HAVE_UNISTD_H)
+
+#include <agar/core/core.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#if defined(_POSIX_MAPPED_FILES) && (_POSIX_MAPPED_FILES > 0)
+# include <sys/mman.h>
+# define KV_USE_MMAP
+#endif
+#ifndef O_BINARY
+# define O_BINARY 0
+#endif
+
+#define KV_MAGIC	"AGDBKV01"	/* File signature */
+#define KV_MAGIC_LEN	8
+#define KV_REC_HDR	8		/* Key and value lengths */
+#define KV_COMMIT	0xffffffffU	/* Key length of a commit record */
+#define KV_DELETED	0xffffffffU	/* Value length of a deletion */
+#define KV_WBUF_SIZE	65536		/* Write buffer size */
+#define KV_ARENA_SIZE	65536		/* Key arena chunk size */
+#define KV_COMPACT_MIN	(1024*1024)	/* Min log size for compaction */
+#define KV_FNV_INIT	2166136261U
+#define KV_FNV_PRIME	16777619U
+
+/* Index entry for a key. */
+typedef struct kv_ent {
+	Uint8 *_Nonnull key;		/* Key data (in arena) */
+	Uint32 keyLen;			/* Key length */
+	Uint32 valLen;			/* Value length (or KV_DELETED) */
+	off_t valOffs;			/* Value offset in log */
+	Uint32 hash;			/* Hash of key */
+	Uint32 _pad;
+} KV_Ent;
+
+/* Previous state of an entry modified in the current batch. */
+typedef struct kv_undo {
+	Uint ent;			/* Entry index */
+	Uint32 valLen;			/* Previous value length */
+	off_t valOffs;			/* Previous value offset */
+} KV_Undo;
+
+/* Chunk of key storage. */
+typedef struct kv_arena {
+	struct kv_arena *_Nullable next;
+	AG_Size used;
+	AG_Size size;
+	Uint8 data[1];
+} KV_Arena;
+
+typedef struct ag_db_kv {
+	struct ag_db _inherit;
+	int fd;				/* Log file */
+	Uint syncMs;			/* Group commit interval (ms) */
+	char *_Nullable path;		/* Log file path */
+	Uint8 *_Nullable map;		/* Mapped part of the log */
+	AG_Size mapLen;
+	Uint nWalks;			/* Iterations in progress (pins map) */
+	off_t fileSize;			/* Bytes written to the log */
+	Uint8 *_Nullable wbuf;		/* Write buffer */
+	AG_Size wbufLen;
+	AG_Size syncBytes;		/* Group commit threshold (bytes) */
+	AG_Size unsynced;		/* Bytes committed since last fsync */
+	Uint32 tSync;			/* Time of last fsync */
+#ifdef AG_TIMERS
+	AG_Timer toSync;		/* Deferred fsync */
+#endif
+
+	KV_Ent *_Nullable ents;		/* Index entries */
+	Uint nEnts, maxEnts;
+	Uint *_Nullable tbl;		/* Hash table of entry index+1 */
+	Uint tblSize;			/* Table size (power of 2) */
+	Uint *_Nullable order;		/* Entries sorted by key */
+	Uint nOrder;			/* Entries covered by order */
+	KV_Arena *_Nullable arena;	/* Key storage */
+
+	Uint nLive;			/* Live keys */
+	Uint32 sum;			/* Checksum of current batch */
+	AG_Size liveBytes;		/* Size of live records */
+	AG_Size deadBytes;		/* Size of dead records */
+	int inTxn;			/* Explicit transaction in progress */
+	off_t batchStart;		/* Log offset of current batch */
+	Uint batchEnts;			/* nEnts at start of batch */
+	Uint batchLive;			/* nLive at start of batch */
+	AG_Size batchLiveBytes;		/* liveBytes at start of batch */
+	AG_Size batchDeadBytes;		/* deadBytes at start of batch */
+	KV_Undo *_Nullable undo;	/* Entries changed in batch */
+	Uint nUndo, maxUndo;
+} AG_DbKV;
+
+static __inline__ Uint32
+HashBytes(Uint32 h, const Uint8 *_Nonnull p, AG_Size len)
+{
+	AG_Size i;
+
+	for (i = 0; i < len; i++) {
+		h = (h ^ p[i]) * KV_FNV_PRIME;
+	}
+	return (h);
+}
+
+static __inline__ void
+PutLE32(Uint8 *_Nonnull p, Uint32 v)
+{
+	p[0] = (Uint8)(v);
+	p[1] = (Uint8)(v >> 8);
+	p[2] = (Uint8)(v >> 16);
+	p[3] = (Uint8)(v >> 24);
+}
+
+static __inline__ Uint32
+GetLE32(const Uint8 *_Nonnull p)
+{
+	return ((Uint32)p[0]) | ((Uint32)p[1] << 8) |
+	       ((Uint32)p[2] << 16) | ((Uint32)p[3] << 24);
+}
+
+/* Size of the log record of an entry. */
+static __inline__ AG_Size
+RecordSize(Uint32 keyLen, Uint32 valLen)
+{
+	return (KV_REC_HDR + keyLen + ((valLen != KV_DELETED) ? valLen : 0));
+}
+
+static int
+CompareKeys(const Uint8 *_Nonnull k1, Uint32 len1,
+    const Uint8 *_Nonnull k2, Uint32 len2)
+{
+	int rv;
+
+	if ((rv = memcmp(k1, k2, (len1 < len2) ? len1 : len2)) != 0) {
+		return (rv);
+	}
+	return (len1 < len2) ? -1 : (len1 > len2) ? 1 : 0;
+}
+
+static void
+FreeArena(KV_Arena *_Nullable a)
+{
+	KV_Arena *aNext;
+
+	for (; a != NULL; a = aNext) {
+		aNext = a->next;
+		free(a);
+	}
+}
+
+/* Copy a key into arena storage. */
+static Uint8 *_Nullable
+ArenaDup(KV_Arena *_Nullable *_Nonnull pArena, const Uint8 *_Nonnull key,
+    Uint32 len)
+{
+	KV_Arena *a = *pArena;
+	Uint8 *p;
+
+	if (a == NULL || a->used + len > a->size) {
+		AG_Size size = (len > KV_ARENA_SIZE) ? len : KV_ARENA_SIZE;
+
+		if ((a = TryMalloc(sizeof(KV_Arena) + size)) == NULL) {
+			return (NULL);
+		}
+		a->next = *pArena;
+		a->used = 0;
+		a->size = size;
+		*pArena = a;
+	}
+	p = &a->data[a->used];
+	memcpy(p, key, len);
+	a->used += len;
+	return (p);
+}
+
+/*
+ * Hash table of entry indices.
+ */
+static Uint *_Nullable
+LookupSlot(AG_DbKV *_Nonnull db, const Uint8 *_Nonnull key, Uint32 len,
+    Uint32 hash)
+{
+	const Uint mask = db->tblSize - 1;
+	Uint i;
+
+	if (db->tblSize == 0) {
+		return (NULL);
+	}
+	for (i = hash & mask; db->tbl[i] != 0; i = (i+1) & mask) {
+		const KV_Ent *e = &db->ents[db->tbl[i] - 1];
+
+		if (e->hash == hash && e->keyLen == len &&
+		    memcmp(e->key, key, len) == 0)
+			return (&db->tbl[i]);
+	}
+	return (&db->tbl[i]);
+}
+
+static KV_Ent *_Nullable
+Lookup(AG_DbKV *_Nonnull db, const AG_Dbt *_Nonnull key)
+{
+	Uint32 hash;
+	Uint *slot;
+
+	if (key->size >= KV_COMMIT) {
+		return (NULL);
+	}
+	hash = HashBytes(KV_FNV_INIT, key->data, key->size);
+	slot = LookupSlot(db, key->data, (Uint32)key->size, hash);
+	if (slot == NULL || *slot == 0) {
+		return (NULL);
+	}
+	return (&db->ents[*slot - 1]);
+}
+
+static int
+RebuildTable(AG_DbKV *_Nonnull db, Uint tblSize)
+{
+	const Uint mask = tblSize - 1;
+	Uint *tbl, i;
+
+	if (tblSize == 0) {
+		return (0);
+	}
+	if ((tbl = TryMalloc(tblSize * sizeof(Uint))) == NULL) {
+		return (-1);
+	}
+	memset(tbl, 0, tblSize * sizeof(Uint));
+	for (i = 0; i < db->nEnts; i++) {
+		Uint j;
+
+		for (j = db->ents[i].hash & mask; tbl[j] != 0; j = (j+1) & mask)
+			;;
+		tbl[j] = i+1;
+	}
+	Free(db->tbl);
+	db->tbl = tbl;
+	db->tblSize = tblSize;
+	return (0);
+}
+
+/* Add a new index entry. */
+static KV_Ent *_Nullable
+AddEntry(AG_DbKV *_Nonnull db, const Uint8 *_Nonnull key, Uint32 len,
+    Uint32 hash)
+{
+	KV_Ent *e;
+	Uint *slot;
+
+	if (db->nEnts+1 > db->maxEnts) {
+		Uint maxNew = (db->maxEnts > 0) ? db->maxEnts*2 : 256;
+		KV_Ent *entsNew;
+
+		if ((entsNew = TryRealloc(db->ents, maxNew*sizeof(KV_Ent)))
+		    == NULL) {
+			return (NULL);
+		}
+		db->ents = entsNew;
+		db->maxEnts = maxNew;
+	}
+	if ((db->nEnts+1)*2 > db->tblSize) {
+		if (RebuildTable(db, (db->tblSize > 0) ? db->tblSize*2 : 512)
+		    == -1)
+			return (NULL);
+	}
+	e = &db->ents[db->nEnts];
+	if ((e->key = ArenaDup(&db->arena, key, len)) == NULL) {
+		return (NULL);
+	}
+	e->keyLen = len;
+	e->valLen = KV_DELETED;
+	e->valOffs = 0;
+	e->hash = hash;
+	slot = LookupSlot(db, key, len, hash);
+	*slot = ++db->nEnts;
+	return (e);
+}
+
+/*
+ * Update the index for a record written at recOffs. If undo is set,
+ * remember the previous state of the entry for rollback.
+ */
+static int
+IndexRecord(AG_DbKV *_Nonnull db, const Uint8 *_Nonnull key, Uint32 keyLen,
+    Uint32 valLen, off_t recOffs, int undo)
+{
+	Uint32 hash = HashBytes(KV_FNV_INIT, key, keyLen);
+	Uint *slot;
+	KV_Ent *e;
+
+	slot = LookupSlot(db, key, keyLen, hash);
+	if (slot != NULL && *slot != 0) {
+		e = &db->ents[*slot - 1];
+		if (undo && (Uint)(*slot - 1) < db->batchEnts) {
+			KV_Undo *u;
+
+			if (db->nUndo+1 > db->maxUndo) {
+				Uint maxNew = (db->maxUndo > 0) ?
+				              db->maxUndo*2 : 64;
+				KV_Undo *undoNew;
+
+				if ((undoNew = TryRealloc(db->undo,
+				    maxNew*sizeof(KV_Undo))) == NULL) {
+					return (-1);
+				}
+				db->undo = undoNew;
+				db->maxUndo = maxNew;
+			}
+			u = &db->undo[db->nUndo++];
+			u->ent = *slot - 1;
+			u->valLen = e->valLen;
+			u->valOffs = e->valOffs;
+		}
+	} else {
+		if ((e = AddEntry(db, key, keyLen, hash)) == NULL)
+			return (-1);
+	}
+	if (e->valLen != KV_DELETED) {
+		AG_Size oldSize = RecordSize(e->keyLen, e->valLen);
+
+		db->liveBytes -= oldSize;
+		db->deadBytes += oldSize;
+		db->nLive--;
+	}
+	e->valLen = valLen;
+	e->valOffs = recOffs + KV_REC_HDR + keyLen;
+	if (valLen != KV_DELETED) {
+		db->liveBytes += RecordSize(keyLen, valLen);
+		db->nLive++;
+	} else {
+		db->deadBytes += RecordSize(keyLen, valLen);
+	}
+	return (0);
+}
+
+/*
+ * Log output.
+ */
+static int
+WriteFully(int fd, const void *_Nonnull data, AG_Size len)
+{
+	const Uint8 *p = data;
+	ssize_t rv;
+
+	while (len > 0) {
+		if ((rv = write(fd, p, len)) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			AG_SetError("write: %s", strerror(errno));
+			return (-1);
+		}
+		p += rv;
+		len -= (AG_Size)rv;
+	}
+	return (0);
+}
+
+static int
+Flush(AG_DbKV *_Nonnull db)
+{
+	if (db->wbufLen == 0) {
+		return (0);
+	}
+	if (WriteFully(db->fd, db->wbuf, db->wbufLen) == -1) {
+		return (-1);
+	}
+	db->fileSize += db->wbufLen;
+	db->wbufLen = 0;
+	return (0);
+}
+
+/* Append bytes to the log (through the write buffer). */
+static int
+Append(AG_DbKV *_Nonnull db, const void *_Nonnull data, AG_Size len)
+{
+	if (db->wbufLen + len > KV_WBUF_SIZE) {
+		if (Flush(db) == -1) {
+			return (-1);
+		}
+		if (len > KV_WBUF_SIZE) {
+			if (WriteFully(db->fd, data, len) == -1) {
+				return (-1);
+			}
+			db->fileSize += len;
+			return (0);
+		}
+	}
+	memcpy(&db->wbuf[db->wbufLen], data, len);
+	db->wbufLen += len;
+	return (0);
+}
+
+/* Append a record to the current batch and update the index. */
+static int
+AppendRecord(AG_DbKV *_Nonnull db, const AG_Dbt *_Nonnull key,
+    const void *_Nullable val, Uint32 valLen)
+{
+	off_t recOffs = db->fileSize + (off_t)db->wbufLen;
+	Uint8 hdr[KV_REC_HDR];
+
+	PutLE32(&hdr[0], (Uint32)key->size);
+	PutLE32(&hdr[4], valLen);
+	db->sum = HashBytes(db->sum, hdr, sizeof(hdr));
+	db->sum = HashBytes(db->sum, key->data, key->size);
+	if (Append(db, hdr, sizeof(hdr)) == -1 ||
+	    Append(db, key->data, key->size) == -1) {
+		return (-1);
+	}
+	if (valLen != KV_DELETED) {
+		db->sum = HashBytes(db->sum, val, valLen);
+		if (Append(db, val, valLen) == -1)
+			return (-1);
+	}
+	return IndexRecord(db, key->data, (Uint32)key->size, valLen,
+	    recOffs, 1);
+}
+
+static void
+BeginBatch(AG_DbKV *_Nonnull db)
+{
+	db->batchStart = db->fileSize + (off_t)db->wbufLen;
+	db->batchEnts = db->nEnts;
+	db->batchLive = db->nLive;
+	db->batchLiveBytes = db->liveBytes;
+	db->batchDeadBytes = db->deadBytes;
+	db->sum = KV_FNV_INIT;
+	db->nUndo = 0;
+}
+
+/* Force committed data to stable storage. */
+static int
+SyncLog(AG_DbKV *_Nonnull db)
+{
+	if (Flush(db) == -1) {
+		return (-1);
+	}
+	if (fsync(db->fd) == -1) {
+		AG_SetError("fsync: %s", strerror(errno));
+		return (-1);
+	}
+	db->unsynced = 0;
+	db->tSync = AG_GetTicks();
+	return (0);
+}
+
+#ifdef AG_TIMERS
+/* Sync the commits left over from the last group once its interval is up. */
+static Uint32
+SyncTimeout(AG_Timer *_Nonnull to, AG_Event *_Nonnull event)
+{
+	AG_DbKV *db = AG_SELF();
+	Uint32 rv = 0;
+
+	AG_ObjectLock(db);
+	if (db->fd != -1 && db->unsynced > 0 && SyncLog(db) == -1) {
+		Verbose("%s: %s\n", db->path, AG_GetError());
+		rv = to->ival;					/* Retry */
+	}
+	AG_ObjectUnlock(db);
+	return (rv);
+}
+#endif
+
+/*
+ * Terminate the current batch with a commit record. Batches are
+ * flushed to the OS immediately but fsync'ed in groups, once the
+ * db-sync-ms interval has elapsed or db-sync-bytes have accumulated.
+ * If no further commit comes along, a timer syncs the group when its
+ * interval is up.
+ */
+static int
+CommitBatch(AG_DbKV *_Nonnull db)
+{
+	off_t end = db->fileSize + (off_t)db->wbufLen;
+	Uint8 rec[KV_REC_HDR];
+	Uint32 elapsed;
+
+	if (end == db->batchStart) {
+		return (0);
+	}
+	PutLE32(&rec[0], KV_COMMIT);
+	PutLE32(&rec[4], db->sum);
+	if (Append(db, rec, sizeof(rec)) == -1 ||
+	    Flush(db) == -1) {
+		return (-1);
+	}
+	db->deadBytes += sizeof(rec);
+	db->unsynced += (AG_Size)(db->fileSize - db->batchStart);
+	db->nUndo = 0;
+
+	elapsed = AG_GetTicks() - db->tSync;
+	if (db->unsynced >= db->syncBytes || elapsed >= db->syncMs) {
+		return SyncLog(db);
+	}
+#ifdef AG_TIMERS
+	if (!AG_TimerIsRunning(db, &db->toSync))
+		AG_AddTimer(db, &db->toSync, db->syncMs - elapsed,
+		    SyncTimeout, NULL);
+#endif
+	return (0);
+}
+
+/* Discard the current batch from the log and restore the index. */
+static int
+RollbackBatch(AG_DbKV *_Nonnull db)
+{
+	int rv = 0;
+	Uint i;
+
+	db->wbufLen = 0;
+	if (db->fileSize > db->batchStart) {
+		if (ftruncate(db->fd, db->batchStart) == -1 ||
+		    lseek(db->fd, db->batchStart, SEEK_SET) == -1) {
+			AG_SetError("ftruncate: %s", strerror(errno));
+			rv = -1;
+		}
+		db->fileSize = db->batchStart;
+	}
+	for (i = db->nUndo; i > 0; i--) {
+		const KV_Undo *u = &db->undo[i-1];
+		KV_Ent *e = &db->ents[u->ent];
+
+		e->valLen = u->valLen;
+		e->valOffs = u->valOffs;
+	}
+	db->nUndo = 0;
+	db->nLive = db->batchLive;
+	db->liveBytes = db->batchLiveBytes;
+	db->deadBytes = db->batchDeadBytes;
+
+	if (db->nEnts > db->batchEnts) {		/* Forget new keys */
+		Uint nOrder = 0;
+
+		db->nEnts = db->batchEnts;
+		for (i = 0; i < db->nOrder; i++) {
+			if (db->order[i] < db->nEnts)
+				db->order[nOrder++] = db->order[i];
+		}
+		db->nOrder = nOrder;
+		if (RebuildTable(db, db->tblSize) == -1)
+			rv = -1;
+	}
+	return (rv);
+}
+
+/*
+ * Map the log file (up to fileSize), replacing any previous mapping. This
+ * is a no-op while an iteration is in progress, since the callback may
+ * still hold pointers into the current mapping.
+ */
+static void
+MapLog(AG_DbKV *_Nonnull db)
+{
+#ifdef KV_USE_MMAP
+	if (db->nWalks == 0 && (AG_Size)db->fileSize > db->mapLen) {
+		void *map;
+
+		if (db->map != NULL) {
+			munmap(db->map, db->mapLen);
+			db->map = NULL;
+			db->mapLen = 0;
+		}
+		map = mmap(NULL, (size_t)db->fileSize, PROT_READ, MAP_SHARED,
+		    db->fd, 0);
+		if (map != MAP_FAILED) {
+			db->map = map;
+			db->mapLen = (AG_Size)db->fileSize;
+		}
+	}
+#endif
+}
+
+/*
+ * Return a pointer to the value of an entry. If the value is not in the
+ * mapped region, the mapping is extended (unless pinned by an iteration)
+ * or the value is read into *tmp.
+ */
+static const Uint8 *_Nullable
+ValueData(AG_DbKV *_Nonnull db, const KV_Ent *_Nonnull e,
+    Uint8 *_Nullable *_Nonnull tmp)
+{
+	off_t end = e->valOffs + e->valLen;
+	Uint8 *buf;
+	AG_Size got;
+
+	*tmp = NULL;
+	if (e->valLen == 0) {
+		return ((const Uint8 *)"");
+	}
+	if (end > db->fileSize && Flush(db) == -1) {
+		return (NULL);
+	}
+#ifdef KV_USE_MMAP
+	if ((AG_Size)end > db->mapLen) {
+		MapLog(db);
+	}
+	if ((AG_Size)end <= db->mapLen)
+		return (&db->map[e->valOffs]);
+#endif
+	if ((buf = TryMalloc(e->valLen)) == NULL) {
+		return (NULL);
+	}
+	for (got = 0; got < e->valLen; ) {
+		ssize_t rv;
+
+		rv = pread(db->fd, &buf[got], e->valLen - got,
+		    e->valOffs + (off_t)got);
+		if (rv <= 0) {
+			if (rv == -1 && errno == EINTR) {
+				continue;
+			}
+			AG_SetError("pread: %s",
+			    (rv == 0) ? "Unexpected EOF" : strerror(errno));
+			free(buf);
+			return (NULL);
+		}
+		got += (AG_Size)rv;
+	}
+	*tmp = buf;
+	return (buf);
+}
+
+/*
+ * Sorted key order (for iteration). Entries added since the last
+ * iteration are sorted (by pointer, so the comparison needs no outside
+ * state) and merged into the order array.
+ */
+static int
+CompareEnts(const void *_Nonnull p1, const void *_Nonnull p2)
+{
+	const KV_Ent *e1 = *(const KV_Ent *const *)p1;
+	const KV_Ent *e2 = *(const KV_Ent *const *)p2;
+
+	return CompareKeys(e1->key, e1->keyLen, e2->key, e2->keyLen);
+}
+
+static int
+UpdateOrder(AG_DbKV *_Nonnull db)
+{
+	Uint nNew = db->nEnts - db->nOrder;
+	KV_Ent **sorted;
+	Uint *order, *new, i, j, k;
+
+	if (nNew == 0) {
+		return (0);
+	}
+	if ((order = TryMalloc(db->nEnts * sizeof(Uint))) == NULL) {
+		return (-1);
+	}
+	if ((new = TryMalloc(nNew * sizeof(Uint))) == NULL) {
+		free(order);
+		return (-1);
+	}
+	if ((sorted = TryMalloc(nNew * sizeof(KV_Ent *))) == NULL) {
+		free(new);
+		free(order);
+		return (-1);
+	}
+	for (i = 0; i < nNew; i++) {
+		sorted[i] = &db->ents[db->nOrder + i];
+	}
+	qsort(sorted, nNew, sizeof(KV_Ent *), CompareEnts);
+	for (i = 0; i < nNew; i++) {
+		new[i] = (Uint)(sorted[i] - db->ents);
+	}
+	free(sorted);
+
+	/* Merge the new entries from the end. */
+	if (db->nOrder > 0) {
+		memcpy(order, db->order, db->nOrder * sizeof(Uint));
+	}
+	i = db->nOrder;
+	j = nNew;
+	k = db->nEnts;
+	while (j > 0) {
+		if (i > 0) {
+			const KV_Ent *eOld = &db->ents[order[i-1]];
+			const KV_Ent *eNew = &db->ents[new[j-1]];
+
+			if (CompareKeys(eOld->key, eOld->keyLen,
+			    eNew->key, eNew->keyLen) > 0) {
+				order[--k] = order[--i];
+				continue;
+			}
+		}
+		order[--k] = new[--j];
+	}
+	free(new);
+	Free(db->order);
+	db->order = order;
+	db->nOrder = db->nEnts;
+	return (0);
+}
+
+/* Return the position of the first key >= the given prefix. */
+static Uint
+LowerBound(AG_DbKV *_Nonnull db, const Uint8 *_Nonnull key, Uint32 len)
+{
+	Uint lo = 0, hi = db->nOrder;
+
+	while (lo < hi) {
+		Uint mid = lo + (hi - lo)/2;
+		const KV_Ent *e = &db->ents[db->order[mid]];
+
+		if (CompareKeys(e->key, e->keyLen, key, len) < 0) {
+			lo = mid+1;
+		} else {
+			hi = mid;
+		}
+	}
+	return (lo);
+}
+
+static int
+IterateFrom(AG_DbKV *_Nonnull db, const AG_Dbt *_Nullable prefix,
+    AG_DbIterateFn fn, void *_Nullable arg)
+{
+	Uint i;
+	int rv = 0;
+
+	if (UpdateOrder(db) == -1 ||
+	    Flush(db) == -1) {
+		return (-1);
+	}
+	/*
+	 * Map the whole log up front and pin the mapping for the duration
+	 * of the walk, so that the value pointers passed to fn remain valid
+	 * even if fn reads from (or writes to) the database. Values written
+	 * during the walk are read into a temporary buffer instead.
+	 */
+	MapLog(db);
+	db->nWalks++;
+	i = (prefix != NULL) ? LowerBound(db, prefix->data,
+	                                  (Uint32)prefix->size) : 0;
+	for (; i < db->nOrder; i++) {
+		const KV_Ent *e = &db->ents[db->order[i]];
+		AG_Dbt key, val;
+		const Uint8 *data;
+		Uint8 *tmp;
+
+		if (prefix != NULL &&
+		    (e->keyLen < prefix->size ||
+		     memcmp(e->key, prefix->data, prefix->size) != 0)) {
+			break;
+		}
+		if (e->valLen == KV_DELETED) {
+			continue;
+		}
+		if ((data = ValueData(db, e, &tmp)) == NULL) {
+			rv = -1;
+			break;
+		}
+		key.data = e->key;
+		key.size = e->keyLen;
+		val.data = (void *)data;
+		val.size = e->valLen;
+		rv = fn(&key, &val, arg);
+		Free(tmp);
+		if (rv == -1)
+			break;
+	}
+	db->nWalks--;
+	return (rv == -1) ? -1 : 0;
+}
+
+/*
+ * Replay the log into the index. A trailing batch without a valid
+ * commit record (e.g., following a crash) is discarded.
+ */
+static int
+Replay(AG_DbKV *_Nonnull db, const Uint8 *_Nonnull data, off_t size)
+{
+	off_t pos = KV_MAGIC_LEN, batch = KV_MAGIC_LEN;
+	Uint32 sum = KV_FNV_INIT;
+
+	while (pos + KV_REC_HDR <= size) {
+		Uint32 keyLen = GetLE32(&data[pos]);
+		Uint32 valLen = GetLE32(&data[pos+4]);
+		off_t recLen;
+
+		if (keyLen == KV_COMMIT) {
+			off_t p;
+
+			if (valLen != sum) {
+				break;
+			}
+			for (p = batch; p < pos; ) {	/* Apply the batch */
+				Uint32 kl = GetLE32(&data[p]);
+				Uint32 vl = GetLE32(&data[p+4]);
+
+				if (IndexRecord(db, &data[p+KV_REC_HDR], kl,
+				    vl, p, 0) == -1) {
+					return (-1);
+				}
+				p += RecordSize(kl, vl);
+			}
+			db->deadBytes += KV_REC_HDR;
+			pos += KV_REC_HDR;
+			batch = pos;
+			sum = KV_FNV_INIT;
+			continue;
+		}
+		recLen = (off_t)RecordSize(keyLen, valLen);
+		if (pos + recLen > size) {
+			break;
+		}
+		sum = HashBytes(sum, &data[pos], (AG_Size)recLen);
+		pos += recLen;
+	}
+	if (batch < size) {
+		Verbose("%s: Discarding %lu bytes of uncommitted data\n",
+		    db->path, (unsigned long)(size - batch));
+		if (!(AGDB(db)->flags & AG_DB_READONLY) &&
+		    ftruncate(db->fd, batch) == -1) {
+			AG_SetError("ftruncate: %s", strerror(errno));
+			return (-1);
+		}
+	}
+	db->fileSize = batch;
+	return (0);
+}
+
+static int
+ReadLog(AG_DbKV *_Nonnull db, off_t size)
+{
+	Uint8 *data;
+	int rv;
+#ifdef KV_USE_MMAP
+	void *map;
+
+	map = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, db->fd, 0);
+	if (map != MAP_FAILED) {
+		rv = Replay(db, map, size);
+		munmap(map, (size_t)size);
+		return (rv);
+	}
+#endif
+	if ((data = TryMalloc((AG_Size)size)) == NULL) {
+		return (-1);
+	}
+	if (pread(db->fd, data, (size_t)size, 0) != (ssize_t)size) {
+		AG_SetError("%s: Read error", db->path);
+		free(data);
+		return (-1);
+	}
+	rv = Replay(db, data, size);
+	free(data);
+	return (rv);
+}
+
+static void
+Reset(AG_DbKV *_Nonnull db)
+{
+#ifdef AG_TIMERS
+	AG_DelTimer(db, &db->toSync);
+#endif
+#ifdef KV_USE_MMAP
+	if (db->map != NULL) {
+		munmap(db->map, db->mapLen);
+	}
+#endif
+	db->map = NULL;
+	db->mapLen = 0;
+	if (db->fd != -1) {
+		close(db->fd);
+		db->fd = -1;
+	}
+	Free(db->path);
+	db->path = NULL;
+	Free(db->wbuf);
+	db->wbuf = NULL;
+	db->wbufLen = 0;
+	Free(db->ents);
+	db->ents = NULL;
+	db->nEnts = 0;
+	db->maxEnts = 0;
+	Free(db->tbl);
+	db->tbl = NULL;
+	db->tblSize = 0;
+	Free(db->order);
+	db->order = NULL;
+	db->nOrder = 0;
+	FreeArena(db->arena);
+	db->arena = NULL;
+	Free(db->undo);
+	db->undo = NULL;
+	db->nUndo = 0;
+	db->maxUndo = 0;
+	db->nLive = 0;
+	db->liveBytes = 0;
+	db->deadBytes = 0;
+	db->inTxn = 0;
+}
+
+/*
+ * Force the directory entry of a renamed file to stable storage.
+ */
+static int
+SyncDir(const char *_Nonnull path)
+{
+#ifndef _WIN32
+	char dir[AG_PATHNAME_MAX];
+	char *c;
+	int fd, rv = 0;
+
+	Strlcpy(dir, path, sizeof(dir));
+	if ((c = strrchr(dir, '/')) == NULL) {
+		Strlcpy(dir, ".", sizeof(dir));
+	} else if (c == &dir[0]) {
+		c[1] = '\0';
+	} else {
+		*c = '\0';
+	}
+	if ((fd = open(dir, O_RDONLY)) == -1) {
+		AG_SetError("%s: %s", dir, strerror(errno));
+		return (-1);
+	}
+	if (fsync(fd) == -1) {
+		AG_SetError("fsync: %s", strerror(errno));
+		rv = -1;
+	}
+	close(fd);
+	return (rv);
+#else
+	return (0);
+#endif
+}
+
+/*
+ * Rewrite the live records into a new log (in key order) and replace
+ * the existing log file.
+ */
+static int
+Compact(AG_DbKV *_Nonnull db)
+{
+	char pathTmp[AG_PATHNAME_MAX];
+	KV_Ent *ents;
+	KV_Arena *arena = NULL;
+	Uint *tbl, *order;
+	Uint i, nEnts = 0;
+	off_t offs = KV_MAGIC_LEN, sizeOrig, sizeNew;
+	Uint32 sum = KV_FNV_INIT;
+	Uint8 rec[KV_REC_HDR];
+	int fd, fdOrig, rv;
+
+	if (SyncLog(db) == -1 || UpdateOrder(db) == -1) {
+		return (-1);
+	}
+	Strlcpy(pathTmp, db->path, sizeof(pathTmp));
+	Strlcat(pathTmp, ".tmp", sizeof(pathTmp));
+	if ((fd = open(pathTmp, O_RDWR|O_CREAT|O_TRUNC|O_BINARY, 0644)) == -1) {
+		AG_SetError("%s: %s", pathTmp, strerror(errno));
+		return (-1);
+	}
+	if ((ents = TryMalloc((db->nLive+1) * sizeof(KV_Ent))) == NULL)
+		goto fail;
+
+	/* Write live records through the write buffer of the new log. */
+	fdOrig = db->fd;
+	sizeOrig = db->fileSize;
+	db->fd = fd;
+	db->fileSize = 0;
+	if (Append(db, KV_MAGIC, KV_MAGIC_LEN) == -1) {
+		goto fail_write;
+	}
+	for (i = 0; i < db->nOrder; i++) {
+		const KV_Ent *e = &db->ents[db->order[i]];
+		KV_Ent *eNew;
+		const Uint8 *data;
+		Uint8 *tmp;
+
+		if (e->valLen == KV_DELETED) {
+			continue;
+		}
+		db->fd = fdOrig;				/* Read old log */
+		sizeNew = db->fileSize;
+		db->fileSize = sizeOrig;
+		data = ValueData(db, e, &tmp);
+		db->fd = fd;
+		db->fileSize = sizeNew;
+		if (data == NULL) {
+			goto fail_write;
+		}
+		PutLE32(&rec[0], e->keyLen);
+		PutLE32(&rec[4], e->valLen);
+		sum = HashBytes(sum, rec, sizeof(rec));
+		sum = HashBytes(sum, e->key, e->keyLen);
+		sum = HashBytes(sum, data, e->valLen);
+		if (Append(db, rec, sizeof(rec)) == -1 ||
+		    Append(db, e->key, e->keyLen) == -1 ||
+		    Append(db, data, e->valLen) == -1) {
+			Free(tmp);
+			goto fail_write;
+		}
+		Free(tmp);
+
+		eNew = &ents[nEnts++];
+		if ((eNew->key = ArenaDup(&arena, e->key, e->keyLen)) == NULL) {
+			goto fail_write;
+		}
+		eNew->keyLen = e->keyLen;
+		eNew->valLen = e->valLen;
+		eNew->valOffs = offs + KV_REC_HDR + e->keyLen;
+		eNew->hash = e->hash;
+		offs += RecordSize(e->keyLen, e->valLen);
+	}
+	PutLE32(&rec[0], KV_COMMIT);
+	PutLE32(&rec[4], sum);
+	if (Append(db, rec, sizeof(rec)) == -1 ||
+	    Flush(db) == -1) {
+		goto fail_write;
+	}
+	if (fsync(fd) == -1) {
+		AG_SetError("fsync: %s", strerror(errno));
+		goto fail_write;
+	}
+	if ((order = TryMalloc((nEnts+1) * sizeof(Uint))) == NULL) {
+		goto fail_write;
+	}
+	if (rename(pathTmp, db->path) == -1) {
+		AG_SetError("%s: %s", db->path, strerror(errno));
+		free(order);
+		goto fail_write;
+	}
+	rv = SyncDir(db->path);			/* Committed to the new log */
+
+	/* Switch to the new log and index. */
+#ifdef KV_USE_MMAP
+	if (db->map != NULL) {
+		munmap(db->map, db->mapLen);
+		db->map = NULL;
+		db->mapLen = 0;
+	}
+#endif
+	close(fdOrig);
+	for (i = 0; i < nEnts; i++) {
+		order[i] = i;
+	}
+	free(db->ents);
+	db->ents = ents;
+	db->nEnts = nEnts;
+	db->maxEnts = db->nLive+1;
+	Free(db->order);
+	db->order = order;
+	db->nOrder = nEnts;
+	FreeArena(db->arena);
+	db->arena = arena;
+	db->deadBytes = KV_REC_HDR;
+	db->unsynced = 0;
+	tbl = db->tbl;
+	db->tbl = NULL;
+	if (RebuildTable(db, db->tblSize) == -1) {
+		db->tbl = tbl;
+		return (-1);
+	}
+	free(tbl);
+	return (rv);
+fail_write:
+	db->fd = fdOrig;
+	db->fileSize = sizeOrig;
+	db->wbufLen = 0;
+	FreeArena(arena);
+	free(ents);
+fail:
+	close(fd);
+	unlink(pathTmp);
+	return (-1);
+}
+
+static void
+Init(void *_Nonnull obj)
+{
+	AG_DbKV *db = obj;
+
+	db->fd = -1;
+	db->path = NULL;
+	db->map = NULL;
+	db->mapLen = 0;
+	db->nWalks = 0;
+	db->wbuf = NULL;
+	db->wbufLen = 0;
+	db->ents = NULL;
+	db->nEnts = 0;
+	db->maxEnts = 0;
+	db->tbl = NULL;
+	db->tblSize = 0;
+	db->order = NULL;
+	db->nOrder = 0;
+	db->arena = NULL;
+	db->undo = NULL;
+	db->nUndo = 0;
+	db->maxUndo = 0;
+	db->nLive = 0;
+	db->liveBytes = 0;
+	db->deadBytes = 0;
+	db->inTxn = 0;
+#ifdef AG_TIMERS
+	AG_InitTimer(&db->toSync, "sync", 0);
+#endif
+
+	AG_SetInt(db, "db-create", 1);
+	AG_SetUint(db, "db-sync-ms", 100);
+	AG_SetUint(db, "db-sync-bytes", 4*1024*1024);
+}
+
+static void
+Destroy(void *_Nonnull obj)
+{
+	Reset(obj);
+}
+
+static int
+Open(void *_Nonnull obj, const char *_Nonnull path, Uint flags)
+{
+	AG_DbKV *db = obj;
+	struct stat sb;
+	int oflags;
+
+	if (flags & AG_DB_READONLY) {
+		oflags = O_RDONLY;
+	} else {
+		oflags = O_RDWR;
+		if (AG_GetInt(db, "db-create"))
+			oflags |= O_CREAT;
+	}
+	if ((db->fd = open(path, oflags|O_BINARY, 0644)) == -1) {
+		AG_SetError("%s: %s", path, strerror(errno));
+		return (-1);
+	}
+	AGDB(db)->flags |= (flags & AG_DB_READONLY);
+	db->path = Strdup(path);
+	db->syncMs = AG_GetUint(db, "db-sync-ms");
+	db->syncBytes = (AG_Size)AG_GetUint(db, "db-sync-bytes");
+	db->unsynced = 0;
+	db->tSync = AG_GetTicks();
+	if ((db->wbuf = TryMalloc(KV_WBUF_SIZE)) == NULL ||
+	    fstat(db->fd, &sb) == -1) {
+		goto fail;
+	}
+	if (sb.st_size == 0 && !(flags & AG_DB_READONLY)) {
+		if (WriteFully(db->fd, KV_MAGIC, KV_MAGIC_LEN) == -1) {
+			goto fail;
+		}
+		db->fileSize = KV_MAGIC_LEN;
+	} else {
+		char magic[KV_MAGIC_LEN];
+
+		if (pread(db->fd, magic, KV_MAGIC_LEN, 0) != KV_MAGIC_LEN ||
+		    memcmp(magic, KV_MAGIC, KV_MAGIC_LEN) != 0) {
+			AG_SetError("%s: Not a kv database", path);
+			goto fail;
+		}
+		if (ReadLog(db, sb.st_size) == -1)
+			goto fail;
+	}
+	if (lseek(db->fd, db->fileSize, SEEK_SET) == -1) {
+		AG_SetError("lseek: %s", strerror(errno));
+		goto fail;
+	}
+	return (0);
+fail:
+	Reset(db);
+	AGDB(db)->flags &= ~(AG_DB_READONLY);
+	return (-1);
+}
+
+static void
+Close(void *_Nonnull obj)
+{
+	AG_DbKV *db = obj;
+
+	if (db->inTxn) {
+		RollbackBatch(db);
+	}
+	if (!(AGDB(db)->flags & AG_DB_READONLY) && SyncLog(db) == -1) {
+		Verbose("%s: %s\n", db->path, AG_GetError());
+	}
+	Reset(db);
+	AGDB(db)->flags &= ~(AG_DB_READONLY);
+}
+
+static int
+Sync(void *_Nonnull obj)
+{
+	AG_DbKV *db = obj;
+
+	if (AGDB(db)->flags & AG_DB_READONLY) {
+		return (0);
+	}
+	if (db->inTxn) {
+		return SyncLog(db);
+	}
+	if (db->deadBytes > db->liveBytes &&
+	    db->fileSize >= KV_COMPACT_MIN &&
+	    db->nWalks == 0) {			/* Compaction unmaps the log */
+		return Compact(db);
+	}
+	return SyncLog(db);
+}
+
+static int
+Exists(void *_Nonnull obj, const AG_Dbt *_Nonnull key)
+{
+	const KV_Ent *e;
+
+	e = Lookup(obj, key);
+	return (e != NULL && e->valLen != KV_DELETED);
+}
+
+static int
+Get(void *_Nonnull obj, const AG_Dbt *_Nonnull key, AG_Dbt *_Nonnull val)
+{
+	AG_DbKV *db = obj;
+	const KV_Ent *e;
+	const Uint8 *data;
+	Uint8 *tmp;
+
+	if ((e = Lookup(db, key)) == NULL || e->valLen == KV_DELETED) {
+		AG_SetError(_("No such key"));
+		return (-1);
+	}
+	if ((data = ValueData(db, e, &tmp)) == NULL) {
+		return (-1);
+	}
+	if (tmp != NULL) {
+		val->data = tmp;
+	} else {
+		if ((val->data = TryMalloc(e->valLen + 1)) == NULL) {
+			return (-1);
+		}
+		memcpy(val->data, data, e->valLen);
+	}
+	val->size = e->valLen;
+	return (0);
+}
+
+/*
+ * Write n records (a deletion if vals is NULL). Outside of transactions,
+ * the records are written as a batch of their own.
+ */
+static int
+WriteRecords(AG_DbKV *_Nonnull db, const AG_Dbt *_Nonnull keys,
+    const AG_Dbt *_Nullable vals, Uint n)
+{
+	Uint i;
+
+	if (AGDB(db)->flags & AG_DB_READONLY) {
+		AG_SetError(_("Database is read-only"));
+		return (-1);
+	}
+	for (i = 0; i < n; i++) {
+		if (keys[i].size >= KV_COMMIT) {
+			AG_SetError(_("Key is too large"));
+			return (-1);
+		}
+		if (vals != NULL && vals[i].size >= KV_DELETED) {
+			AG_SetError(_("Value is too large"));
+			return (-1);
+		}
+	}
+	if (!db->inTxn) {
+		BeginBatch(db);
+	}
+	for (i = 0; i < n; i++) {
+		if (AppendRecord(db, &keys[i],
+		    (vals != NULL) ? vals[i].data : NULL,
+		    (vals != NULL) ? (Uint32)vals[i].size : KV_DELETED) == -1)
+			goto fail;
+	}
+	if (!db->inTxn && CommitBatch(db) == -1) {
+		goto fail;
+	}
+	return (0);
+fail:
+	if (!db->inTxn) {
+		RollbackBatch(db);
+	}
+	return (-1);
+}
+
+static int
+Put(void *_Nonnull obj, const AG_Dbt *_Nonnull key, const AG_Dbt *_Nonnull val)
+{
+	return WriteRecords(obj, key, val, 1);
+}
+
+static int
+Del(void *_Nonnull obj, const AG_Dbt *_Nonnull key)
+{
+	if (!Exists(obj, key)) {
+		AG_SetError(_("No such key"));
+		return (-1);
+	}
+	return WriteRecords(obj, key, NULL, 1);
+}
+
+static int
+GetMulti(void *_Nonnull obj, const AG_Dbt *_Nonnull keys,
+    AG_Dbt *_Nonnull vals, Uint n)
+{
+	AG_DbKV *db = obj;
+	Uint i;
+	int nFound = 0;
+
+	for (i = 0; i < n; i++) {
+		vals[i].data = NULL;
+		vals[i].size = 0;
+	}
+	for (i = 0; i < n; i++) {
+		const KV_Ent *e;
+		const Uint8 *data;
+		Uint8 *tmp;
+
+		if ((e = Lookup(db, &keys[i])) == NULL ||
+		    e->valLen == KV_DELETED) {
+			continue;
+		}
+		if ((data = ValueData(db, e, &tmp)) == NULL) {
+			goto fail;
+		}
+		if (tmp == NULL) {
+			if ((tmp = TryMalloc(e->valLen + 1)) == NULL) {
+				goto fail;
+			}
+			memcpy(tmp, data, e->valLen);
+		}
+		vals[i].data = tmp;
+		vals[i].size = e->valLen;
+		nFound++;
+	}
+	return (nFound);
+fail:
+	for (i = 0; i < n; i++) {
+		Free(vals[i].data);
+		vals[i].data = NULL;
+	}
+	return (-1);
+}
+
+/* Write n records as one batch. */
+static int
+PutMulti(void *_Nonnull obj, const AG_Dbt *_Nonnull keys,
+    const AG_Dbt *_Nonnull vals, Uint n)
+{
+	return WriteRecords(obj, keys, vals, n);
+}
+
+/* Delete the existing keys among n keys, as one batch. */
+static int
+DelMulti(void *_Nonnull obj, const AG_Dbt *_Nonnull keys, Uint n)
+{
+	AG_DbKV *db = obj;
+	AG_Dbt *found;
+	Uint i, nFound = 0;
+	int rv;
+
+	if ((found = TryMalloc((n+1) * sizeof(AG_Dbt))) == NULL) {
+		return (-1);
+	}
+	for (i = 0; i < n; i++) {
+		if (Exists(db, &keys[i]))
+			found[nFound++] = keys[i];
+	}
+	rv = (nFound > 0) ? WriteRecords(db, found, NULL, nFound) : 0;
+	free(found);
+	return (rv);
+}
+
+static int
+Iterate(void *_Nonnull obj, AG_DbIterateFn fn, void *_Nullable arg)
+{
+	return IterateFrom(obj, NULL, fn, arg);
+}
+
+static int
+IteratePrefix(void *_Nonnull obj, const AG_Dbt *_Nonnull prefix,
+    AG_DbIterateFn fn, void *_Nullable arg)
+{
+	return IterateFrom(obj, prefix, fn, arg);
+}
+
+static int
+Begin(void *_Nonnull obj)
+{
+	AG_DbKV *db = obj;
+
+	if (AGDB(db)->flags & AG_DB_READONLY) {
+		AG_SetError(_("Database is read-only"));
+		return (-1);
+	}
+	if (db->inTxn) {
+		AG_SetError(_("Transaction already in progress"));
+		return (-1);
+	}
+	BeginBatch(db);
+	db->inTxn = 1;
+	return (0);
+}
+
+static int
+Commit(void *_Nonnull obj)
+{
+	AG_DbKV *db = obj;
+
+	if (!db->inTxn) {
+		AG_SetError(_("No transaction in progress"));
+		return (-1);
+	}
+	db->inTxn = 0;
+	if (CommitBatch(db) == -1) {
+		RollbackBatch(db);
+		return (-1);
+	}
+	return (0);
+}
+
+static int
+Rollback(void *_Nonnull obj)
+{
+	AG_DbKV *db = obj;
+
+	if (!db->inTxn) {
+		AG_SetError(_("No transaction in progress"));
+		return (-1);
+	}
+	db->inTxn = 0;
+	return RollbackBatch(db);
+}
+
+AG_DbClass agDbKVClass = {
+	{
+		"AG_Db:AG_DbKV",
+		sizeof(AG_DbKV),
+		{ 0,0 },
+		Init,
+		NULL,		/* free */
+		Destroy,
+		NULL,		/* load */
+		NULL,		/* save */
+		NULL		/* edit */
+	},
+	"kv",
+	N_("Log-Structured Key/Value Store"),
+	AG_DB_KEY_DATA,		/* Key is variable data */
+	AG_DB_REC_VARIABLE,	/* Variable-sized records */
+	Open,
+	Close,
+	Sync,
+	Exists,
+	Get,
+	Put,
+	Del,
+	Iterate,
+	Begin,
+	Commit,
+	Rollback,
+	IteratePrefix,
+	GetMulti,
+	PutMulti,
+	DelMulti
+};
+
+#endif /* AG_SERIALIZATION and _MK_HAVE_UNISTD_H */
@@ -63,9 +63,14 @@ Init(void *_Nonnull obj)
 	AG_SetString(db, "charset-dir",		NULL);
 	
 	AG_SetString(db, "init-cmd", NULL);
-	AG_SetString(db, "get-cmd", "SELECT my_field FROM my_table "
-                                    "WHERE my_field = '%s'");
-	AG_SetString(db, "put-cmd", "INSERT INTO my_table VALUES('%s')");
+	AG_SetString(db, "get-cmd", "SELECT my_value FROM my_table "
+                                    "WHERE my_key = '%s'");
+	AG_SetString(db, "get-multi-cmd", "SELECT my_key,my_value FROM my_table "
+	                                  "WHERE my_key IN ");
+	AG_SetString(db, "put-cmd", "INSERT INTO my_table VALUES('%s','%s')");
+	AG_SetString(db, "put-multi-cmd", "REPLACE INTO my_table VALUES ");
+	AG_SetString(db, "put-multi-row", "('%s','%s')");
+	AG_SetUint(db,   "max-query-size", 1024*1024);
 }
 
 static int
@@ -184,6 +189,268 @@ Del(void *_Nonnull obj, const AG_Dbt *_Nonnull key)
 	return (-1);
 }
 
+/* Append to a dynamically-allocated query string. */
+static int
+QueryGrow(char *_Nullable *_Nonnull q, AG_Size *_Nonnull qMax, AG_Size len)
+{
+	char *qNew;
+	AG_Size maxNew;
+
+	if (len <= *qMax) {
+		return (0);
+	}
+	for (maxNew = (*qMax > 0) ? *qMax : 4096; maxNew < len; maxNew <<= 1)
+		;;
+	if ((qNew = TryRealloc(*q, maxNew)) == NULL) {
+		return (-1);
+	}
+	*q = qNew;
+	*qMax = maxNew;
+	return (0);
+}
+
+static int
+QueryAppend(char *_Nullable *_Nonnull q, AG_Size *_Nonnull qLen,
+    AG_Size *_Nonnull qMax, const char *_Nonnull s, AG_Size len)
+{
+	if (QueryGrow(q, qMax, *qLen + len + 1) == -1) {
+		return (-1);
+	}
+	memcpy(&(*q)[*qLen], s, len);
+	*qLen += len;
+	return (0);
+}
+
+/*
+ * Append a row to a query, substituting the escaped key and value for
+ * the first and second "%s" of the row template.
+ */
+static int
+QueryAppendRow(AG_DbMySQL *_Nonnull db, char *_Nullable *_Nonnull q,
+    AG_Size *_Nonnull qLen, AG_Size *_Nonnull qMax, const char *_Nonnull row,
+    const AG_Dbt *_Nonnull key, const AG_Dbt *_Nonnull val)
+{
+	const AG_Dbt *arg[2];
+	const char *c;
+	int nArg = 0;
+
+	arg[0] = key;
+	arg[1] = val;
+	for (c = row; *c != '\0'; c++) {
+		if (c[0] == '%' && c[1] == 's' && nArg < 2) {
+			const AG_Dbt *d = arg[nArg++];
+
+			if (QueryGrow(q, qMax, *qLen + d->size*2 + 1) == -1) {
+				return (-1);
+			}
+			*qLen += mysql_real_escape_string(db->my, &(*q)[*qLen],
+			    d->data, (unsigned long)d->size);
+			c++;
+		} else {
+			if (QueryAppend(q, qLen, qMax, c, 1) == -1)
+				return (-1);
+		}
+	}
+	return (0);
+}
+
+/* Key of a GetMulti() request, sorted to match the result rows. */
+typedef struct ag_db_mysql_key {
+	const AG_Dbt *_Nonnull key;
+	Uint idx;				/* Index in keys[] */
+} AG_DbMySQLKey;
+
+static int
+CompareKeys(const void *_Nonnull p1, const void *_Nonnull p2)
+{
+	const AG_Dbt *k1 = ((const AG_DbMySQLKey *)p1)->key;
+	const AG_Dbt *k2 = ((const AG_DbMySQLKey *)p2)->key;
+	int rv;
+
+	rv = memcmp(k1->data, k2->data, AG_MIN(k1->size, k2->size));
+	if (rv != 0) {
+		return (rv);
+	}
+	return (k1->size < k2->size) ? -1 : (k1->size > k2->size) ? 1 : 0;
+}
+
+/* Copy the value of a result row to every request for its key. */
+static int
+GetMultiRow(AG_DbMySQLKey *_Nonnull sk, Uint nSk, AG_Dbt *_Nonnull vals,
+    MYSQL_ROW _Nonnull row, const unsigned long *_Nonnull len)
+{
+	AG_DbMySQLKey rk;
+	AG_Dbt key;
+	Uint lo = 0, hi = nSk, mid, nFound = 0;
+
+	key.data = row[0];
+	key.size = (AG_Size)len[0];
+	rk.key = &key;
+	while (lo < hi) {			/* Find the first match */
+		mid = (lo + hi) / 2;
+		if (CompareKeys(&sk[mid], &rk) < 0) {
+			lo = mid+1;
+		} else {
+			hi = mid;
+		}
+	}
+	for (; lo < nSk && CompareKeys(&sk[lo], &rk) == 0; lo++) {
+		AG_Dbt *val = &vals[sk[lo].idx];
+
+		if (val->data != NULL) {
+			continue;		/* Duplicate row */
+		}
+		if ((val->data = TryMalloc(len[1] + 1)) == NULL) {
+			return (-1);
+		}
+		if (row[1] != NULL) {
+			memcpy(val->data, row[1], len[1]);
+		}
+		val->size = (AG_Size)len[1];
+		nFound++;
+	}
+	return (int)nFound;
+}
+
+/*
+ * Retrieve the entries for n keys using statements of the form
+ * "get-multi-cmd ('key1','key2',...)" of up to max-query-size bytes.
+ */
+static int
+GetMulti(void *_Nonnull obj, const AG_Dbt *_Nonnull keys,
+    AG_Dbt *_Nonnull vals, Uint n)
+{
+	AG_DbMySQL *db = obj;
+	const char *cmd = AG_GetStringP(db, "get-multi-cmd");
+	AG_Size maxQuery = (AG_Size)AG_GetUint(db, "max-query-size");
+	AG_DbMySQLKey *sk;
+	MYSQL_RES *res;
+	MYSQL_ROW row;
+	char *q = NULL;
+	AG_Size qLen = 0, qMax = 0;
+	Uint i, nRows = 0;
+	int rv, nFound = 0;
+
+	for (i = 0; i < n; i++) {
+		vals[i].data = NULL;
+		vals[i].size = 0;
+	}
+	if (n == 0) {
+		return (0);
+	}
+	if ((sk = TryMalloc(n * sizeof(AG_DbMySQLKey))) == NULL) {
+		return (-1);
+	}
+	for (i = 0; i < n; i++) {
+		sk[i].key = &keys[i];
+		sk[i].idx = i;
+	}
+	qsort(sk, n, sizeof(AG_DbMySQLKey), CompareKeys);
+
+	for (i = 0; i < n; i++) {
+		if (nRows == 0) {
+			if (QueryAppend(&q, &qLen, &qMax, cmd, strlen(cmd)) == -1 ||
+			    QueryAppend(&q, &qLen, &qMax, "(", 1) == -1)
+				goto fail;
+		} else {
+			if (QueryAppend(&q, &qLen, &qMax, ",", 1) == -1)
+				goto fail;
+		}
+		if (QueryAppendRow(db, &q, &qLen, &qMax, "'%s'",
+		    &keys[i], &keys[i]) == -1) {
+			goto fail;
+		}
+		nRows++;
+		if (qLen < maxQuery && i < n-1) {
+			continue;
+		}
+		if (QueryAppend(&q, &qLen, &qMax, ")", 1) == -1) {
+			goto fail;
+		}
+		if (mysql_real_query(db->my, q, (unsigned long)qLen) != 0 ||
+		    (res = mysql_store_result(db->my)) == NULL) {
+			AG_SetError("GetMulti: %s", mysql_error(db->my));
+			goto fail;
+		}
+		while ((row = mysql_fetch_row(res)) != NULL) {
+			if ((rv = GetMultiRow(sk, n, vals, row,
+			    mysql_fetch_lengths(res))) == -1) {
+				mysql_free_result(res);
+				goto fail;
+			}
+			nFound += rv;
+		}
+		mysql_free_result(res);
+		qLen = 0;
+		nRows = 0;
+	}
+	free(sk);
+	Free(q);
+	return (nFound);
+fail:
+	for (i = 0; i < n; i++) {
+		Free(vals[i].data);
+		vals[i].data = NULL;
+	}
+	free(sk);
+	Free(q);
+	return (-1);
+}
+
+/*
+ * Write n entries using multi-row statements of up to max-query-size
+ * bytes, in a single transaction.
+ */
+static int
+PutMulti(void *_Nonnull obj, const AG_Dbt *_Nonnull keys,
+    const AG_Dbt *_Nonnull vals, Uint n)
+{
+	AG_DbMySQL *db = obj;
+	const char *cmd = AG_GetStringP(db, "put-multi-cmd");
+	const char *row = AG_GetStringP(db, "put-multi-row");
+	AG_Size maxQuery = (AG_Size)AG_GetUint(db, "max-query-size");
+	char *q = NULL;
+	AG_Size qLen = 0, qMax = 0;
+	Uint i, nRows = 0;
+
+	mysql_autocommit(db->my, 0);
+	for (i = 0; i < n; i++) {
+		if (nRows == 0) {
+			qLen = 0;
+			if (QueryAppend(&q, &qLen, &qMax, cmd, strlen(cmd)) == -1)
+				goto fail;
+		} else {
+			if (QueryAppend(&q, &qLen, &qMax, ",", 1) == -1)
+				goto fail;
+		}
+		if (QueryAppendRow(db, &q, &qLen, &qMax, row,
+		    &keys[i], &vals[i]) == -1) {
+			goto fail;
+		}
+		nRows++;
+		if (qLen >= maxQuery || i == n-1) {
+			if (mysql_real_query(db->my, q, (unsigned long)qLen)
+			    != 0) {
+				AG_SetError("PutMulti: %s", mysql_error(db->my));
+				goto fail;
+			}
+			nRows = 0;
+		}
+	}
+	if (mysql_commit(db->my) != 0) {
+		AG_SetError("PutMulti: %s", mysql_error(db->my));
+		goto fail;
+	}
+	mysql_autocommit(db->my, 1);
+	Free(q);
+	return (0);
+fail:
+	mysql_rollback(db->my);
+	mysql_autocommit(db->my, 1);
+	Free(q);
+	return (-1);
+}
+
 static int
 Iterate(void *_Nonnull obj, AG_DbIterateFn fn, void *_Nullable arg)
 {
@@ -213,5 +480,12 @@ AG_DbClass agDbMySQLClass = {
 	Get,
 	Put,
 	Del,
-	Iterate
+	Iterate,
+	NULL,			/* begin */
+	NULL,			/* commit */
+	NULL,			/* rollback */
+	NULL,			/* iteratePrefix */
+	GetMulti,
+	PutMulti,
+	NULL			/* delMulti */
 };
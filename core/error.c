@@ -82,7 +82,7 @@ AG_InitErrorSubsystem(void)
 	    AG_ThreadKeyTryCreate(&agErrorCodeKey, NULL) == -1) {
 		return (-1);
 	}
-	AG_ThreadKeySet(agErrorMsgKey, Strdup("No error"));
+	AG_ThreadKeySet(agErrorMsgKey, agErrorMsg);
 	AG_ThreadKeySet(agErrorCodeKey, NULL);
 #endif
 
@@ -98,13 +98,20 @@ AG_DestroyErrorSubsystem(void)
 #if defined(_WIN32) && defined(USE_WIN32_CONSOLE)
 	FreeConsole();
 #endif
-	Free(agErrorMsg);
-	agErrorMsg = NULL;
-	agErrorCode = AG_EUNDEFINED;
 #ifdef AG_THREADS
+	/*
+	 * agErrorMsg may point to the message of another thread, which is
+	 * released by DestroyErrorMsg(). Only free the calling thread's.
+	 */
+	Free(AG_ThreadKeyGet(agErrorMsgKey));
+	AG_ThreadKeySet(agErrorMsgKey, NULL);
 	AG_ThreadKeyDelete(agErrorMsgKey);
 	AG_ThreadKeyDelete(agErrorCodeKey);
+#else
+	Free(agErrorMsg);
 #endif
+	agErrorMsg = NULL;
+	agErrorCode = AG_EUNDEFINED;
 }
 
 /* Set the error message string (C string). */
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2026 Julien Nadeau Carriere <vedge@csoft.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Tables of numerical handles, allocated per class name. Used by VG(3)
+ * and SK(3) to look up nodes by class and handle, and to generate the
+ * lowest unused handle for a new node.
+ */
+
+#include <agar/core/core.h>
+
+void
+AG_HandleTblsInit(AG_HandleTbls *hts)
+{
+	hts->tbls = NULL;
+	hts->nTbls = 0;
+}
+
+void
+AG_HandleTblsFree(AG_HandleTbls *hts)
+{
+	Uint i;
+
+	for (i = 0; i < hts->nTbls; i++) {
+		AG_HandleTbl *ht = &hts->tbls[i];
+
+		Free(ht->buckets);
+		Free(ht->free);
+	}
+	Free(hts->tbls);
+	hts->tbls = NULL;
+	hts->nTbls = 0;
+}
+
+/* Return the handle table for the given class (optionally creating it). */
+AG_HandleTbl *
+AG_HandleTblGet(AG_HandleTbls *hts, const char *name, int create)
+{
+	AG_HandleTbl *ht;
+	Uint i;
+
+	for (i = 0; i < hts->nTbls; i++) {
+		ht = &hts->tbls[i];
+		if (strcmp(ht->name, name) == 0)
+			return (ht);
+	}
+	if (!create) {
+		return (NULL);
+	}
+	hts->tbls = Realloc(hts->tbls, (hts->nTbls+1) * sizeof(AG_HandleTbl));
+	ht = &hts->tbls[hts->nTbls++];
+	ht->name = name;
+	ht->nBuckets = 16;
+	ht->buckets = Malloc(ht->nBuckets*sizeof(AG_HandleEnt *));
+	memset(ht->buckets, 0, ht->nBuckets*sizeof(AG_HandleEnt *));
+	ht->nEnts = 0;
+	ht->free = NULL;
+	ht->nFree = 0;
+	ht->maxFree = 0;
+	ht->next = 1;
+	return (ht);
+}
+
+AG_HandleEnt *
+AG_HandleTblLookup(const AG_HandleTbl *ht, Uint32 handle)
+{
+	AG_HandleEnt *e;
+
+	for (e = ht->buckets[handle & (ht->nBuckets-1)];
+	     e != NULL;
+	     e = e->next) {
+		if (e->handle == handle)
+			return (e);
+	}
+	return (NULL);
+}
+
+/* Look up the structure with the given handle in the table of a class. */
+void *
+AG_HandleLookup(AG_HandleTbls *hts, const char *name, Uint32 handle)
+{
+	AG_HandleTbl *ht;
+	AG_HandleEnt *e;
+
+	if ((ht = AG_HandleTblGet(hts, name, 0)) == NULL ||
+	    (e = AG_HandleTblLookup(ht, handle)) == NULL) {
+		return (NULL);
+	}
+	return (e->p);
+}
+
+/*
+ * Add an entry (referencing the structure p) under the given handle to
+ * the table of a class.
+ */
+void
+AG_HandleInsert(AG_HandleTbls *hts, const char *name, AG_HandleEnt *e,
+    Uint32 handle, void *p)
+{
+	AG_HandleTbl *ht = AG_HandleTblGet(hts, name, 1);
+	AG_HandleEnt **bucket;
+
+	if (ht->nEnts >= ht->nBuckets) {		/* Grow and rehash */
+		Uint nBucketsNew = ht->nBuckets << 1, i;
+		AG_HandleEnt **bucketsNew, *eOld, *eNext;
+
+		bucketsNew = Malloc(nBucketsNew*sizeof(AG_HandleEnt *));
+		memset(bucketsNew, 0, nBucketsNew*sizeof(AG_HandleEnt *));
+		for (i = 0; i < ht->nBuckets; i++) {
+			for (eOld = ht->buckets[i];
+			     eOld != NULL;
+			     eOld = eNext) {
+				eNext = eOld->next;
+				bucket = &bucketsNew[eOld->handle &
+				                     (nBucketsNew-1)];
+				eOld->next = *bucket;
+				*bucket = eOld;
+			}
+		}
+		Free(ht->buckets);
+		ht->buckets = bucketsNew;
+		ht->nBuckets = nBucketsNew;
+	}
+	e->handle = handle;
+	e->p = p;
+	bucket = &ht->buckets[handle & (ht->nBuckets-1)];
+	e->next = *bucket;
+	*bucket = e;
+	ht->nEnts++;
+}
+
+/*
+ * Remove an entry from the table of a class (if it is there) and release
+ * its handle for reuse.
+ */
+void
+AG_HandleRemove(AG_HandleTbls *hts, const char *name, AG_HandleEnt *e)
+{
+	AG_HandleTbl *ht;
+	AG_HandleEnt **pe;
+	Uint i;
+
+	if ((ht = AG_HandleTblGet(hts, name, 0)) == NULL) {
+		return;
+	}
+	for (pe = &ht->buckets[e->handle & (ht->nBuckets-1)];
+	     *pe != NULL;
+	     pe = &(*pe)->next) {
+		if (*pe == e)
+			break;
+	}
+	if (*pe == NULL) {
+		return;
+	}
+	*pe = e->next;
+	e->next = NULL;
+	ht->nEnts--;
+
+	if (e->handle == 0 || e->handle >= ht->next) {
+		return;
+	}
+	if (ht->nFree+1 > ht->maxFree) {
+		ht->maxFree = (ht->maxFree > 0) ? ht->maxFree<<1 : 16;
+		ht->free = Realloc(ht->free, ht->maxFree*sizeof(Uint32));
+	}
+	for (i = ht->nFree++; i > 0; i = (i-1) >> 1) {	/* Sift up */
+		if (ht->free[(i-1) >> 1] <= e->handle) {
+			break;
+		}
+		ht->free[i] = ht->free[(i-1) >> 1];
+	}
+	ht->free[i] = e->handle;
+}
+
+/* Remove the top of a handle table's free heap. */
+static void
+PopFreeHandle(AG_HandleTbl *_Nonnull ht)
+{
+	Uint32 last = ht->free[--ht->nFree];
+	Uint i = 0, j;
+
+	while ((j = (i << 1) + 1) < ht->nFree) {		/* Sift down */
+		if (j+1 < ht->nFree && ht->free[j+1] < ht->free[j]) {
+			j++;
+		}
+		if (last <= ht->free[j]) {
+			break;
+		}
+		ht->free[i] = ht->free[j];
+		i = j;
+	}
+	ht->free[i] = last;
+}
+
+/*
+ * Return the lowest handle (starting from 1) not in use in the table of a
+ * class. Return 0 if all handles below max are in use.
+ */
+Uint32
+AG_HandleGenerate(AG_HandleTbls *hts, const char *name, Uint32 max)
+{
+	AG_HandleTbl *ht;
+
+	if ((ht = AG_HandleTblGet(hts, name, 0)) == NULL) {
+		return (1);
+	}
+	while (ht->nFree > 0) {
+		if (AG_HandleTblLookup(ht, ht->free[0]) == NULL) {
+			return (ht->free[0]);
+		}
+		PopFreeHandle(ht);		/* Reused since released */
+	}
+	while (AG_HandleTblLookup(ht, ht->next) != NULL) {
+		if (++ht->next >= max)
+			return (0);
+	}
+	return (ht->next);
+}
@@ -0,0 +1,58 @@
+/*	Public domain	*/
+/*
+ * Tables of numerical handles allocated per class name.
+ */
+
+#ifndef _AGAR_CORE_HANDLE_TBL_H_
+#define _AGAR_CORE_HANDLE_TBL_H_
+#include <agar/core/begin.h>
+
+/* Entry embedded in a structure which is referenced by handle. */
+typedef struct ag_handle_ent {
+	Uint32 handle;				/* Handle as hashed */
+	void *_Nullable p;			/* Structure referenced */
+	struct ag_handle_ent *_Nullable next;	/* Next in bucket */
+} AG_HandleEnt;
+
+/*
+ * Handles in use by the instances of a class. Released handles go into
+ * a min-heap so that the lowest free handle is always reused first.
+ */
+typedef struct ag_handle_tbl {
+	const char *_Nonnull name;		/* Class name */
+	AG_HandleEnt *_Nullable *_Nonnull buckets; /* By handle */
+	Uint                             nBuckets; /* (power of 2) */
+	Uint                             nEnts;
+	Uint32 *_Nullable free;			/* Released handles (min-heap) */
+	Uint             nFree, maxFree;
+	Uint32 next;				/* Handles below are used or free */
+} AG_HandleTbl;
+
+/* Set of handle tables (one per class name). */
+typedef struct ag_handle_tbls {
+	AG_HandleTbl *_Nullable tbls;
+	Uint                   nTbls;
+} AG_HandleTbls;
+
+__BEGIN_DECLS
+void AG_HandleTblsInit(AG_HandleTbls *_Nonnull);
+void AG_HandleTblsFree(AG_HandleTbls *_Nonnull);
+
+AG_HandleTbl *_Nullable AG_HandleTblGet(AG_HandleTbls *_Nonnull,
+                                        const char *_Nonnull, int);
+AG_HandleEnt *_Nullable AG_HandleTblLookup(const AG_HandleTbl *_Nonnull,
+                                           Uint32)
+                                          _Pure_Attribute;
+void *_Nullable         AG_HandleLookup(AG_HandleTbls *_Nonnull,
+                                        const char *_Nonnull, Uint32);
+
+void   AG_HandleInsert(AG_HandleTbls *_Nonnull, const char *_Nonnull,
+                       AG_HandleEnt *_Nonnull, Uint32, void *_Nonnull);
+void   AG_HandleRemove(AG_HandleTbls *_Nonnull, const char *_Nonnull,
+                       AG_HandleEnt *_Nonnull);
+Uint32 AG_HandleGenerate(AG_HandleTbls *_Nonnull, const char *_Nonnull,
+                         Uint32);
+__END_DECLS
+
+#include <agar/core/close.h>
+#endif /* _AGAR_CORE_HANDLE_TBL_H_ */
@@ -323,6 +323,7 @@ ag_fetch_variable_of_type(void *obj, const char *name,
 
 	V = AG_FetchVariable(obj, name, type);
 	if (V->type != type) {
+		Uint flags = V->flags, version = V->version;
 #ifdef AG_DEBUG
 		AG_Debug(obj, "Mutating \"%s\": From (%s) to (%s)\n", name,
 		    agVariableTypes[V->type].name,
@@ -330,6 +331,8 @@ ag_fetch_variable_of_type(void *obj, const char *name,
 #endif
 		AG_FreeVariable(V);
 		AG_InitVariable(V, type, name);
+		V->flags = flags;		/* Preserve across mutation */
+		V->version = version;
 	}
 	return (V);
 }
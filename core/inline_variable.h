@@ -19,6 +19,8 @@ ag_init_variable(AG_Variable *V, AG_VariableType type, const char *name)
 		V->name[0] = '\0';
 	}
 	V->type = type;
+	V->flags = 0;
+	V->version = 0;
 #ifdef AG_THREADS
 	V->mutex = NULL;
 #endif
@@ -176,6 +176,8 @@ typedef struct ag_object {
 #define AG_OBJECT_INDETACH	 0x10000  /* In AG_ObjectDetach() */
 #define AG_OBJECT_BOUND_EVENTS	 0x20000  /* Generate "bound" events whenever
 					     AG_Bind*() is invoked */
+#define AG_OBJECT_CHANGED_EVENTS 0x40000  /* Generate "variable-changed" events
+					     whenever a variable is modified */
 #define AG_OBJECT_SAVED_FLAGS	(AG_OBJECT_FLOATING_VARS|\
  				 AG_OBJECT_INDESTRUCTIBLE|\
 				 AG_OBJECT_PRESERVE_DEPS|\
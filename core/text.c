@@ -106,6 +106,7 @@ AG_TextInit(AG_Text *txt, AG_Size maxLen)
 	
 	txt->flags = 0;
 	txt->lang = 0;
+	txt->gen = 0;
 	txt->maxLen = (maxLen != 0) ? maxLen : AG_INT_MAX-1;
 	AG_MutexInitRecursive(&txt->lock);
 
@@ -149,6 +150,7 @@ AG_TextClear(AG_Text *txt)
 		te->maxLen = 0;
 		te->len = 0;
 	}
+	txt->gen++;
 	AG_MutexUnlock(&txt->lock);
 }
 
@@ -181,6 +183,7 @@ AG_TextSet(AG_Text *txt, const char *fmt, ...)
 		te->len = 0;
 		te->maxLen = 0;
 	}
+	txt->gen++;
 	AG_MutexUnlock(&txt->lock);
 	return (0);
 }
@@ -210,6 +213,7 @@ AG_TextSetEnt(AG_Text *txt, enum ag_language lang, const char *fmt, ...)
 		te->len = 0;
 		te->maxLen = 0;
 	}
+	txt->gen++;
 	AG_MutexUnlock(&txt->lock);
 	return (0);
 }
@@ -239,6 +243,7 @@ AG_TextSetEntS(AG_Text *txt, enum ag_language lang, const char *s)
 		te->len = 0;
 		te->maxLen = 0;
 	}
+	txt->gen++;
 	AG_MutexUnlock(&txt->lock);
 	return (0);
 }
@@ -344,6 +349,7 @@ AG_TextLoad(AG_Text *txt, AG_DataSource *ds)
 	}
 	txt->flags &= ~(AG_TEXT_SAVED_FLAGS);
 	txt->flags |= (Uint)(AG_ReadUint32(ds) & AG_TEXT_SAVED_FLAGS);
+	txt->gen++;
 	AG_MutexUnlock(&txt->lock);
 	return (0);
 fail:
@@ -452,6 +458,7 @@ AG_TextCatS(AG_Text *_Nonnull txt, const char *_Nonnull s)
 	}
 	memcpy(&te->buf[te->len], s, len+1);
 	te->len += len;
+	txt->gen++;
 	AG_MutexUnlock(&txt->lock);
 	return (0);
 }
@@ -164,6 +164,7 @@ typedef struct ag_text {
 	AG_Size maxLen;			/* Maximum string length (bytes) */
 	Uint flags;
 #define AG_TEXT_SAVED_FLAGS	0
+	Uint gen;			/* Incremented on every change */
 } AG_Text, AG_TextElement;
 
 #define AGTEXT(p) ((AG_Text *)(p))
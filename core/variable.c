@@ -336,11 +336,45 @@ AG_Unset(void *pObj, const char *name)
 	}
 }
 
-/* Generate "bound" event if BOUND_EVENTS flag is set */
+/* Bump version and generate "bound" event if BOUND_EVENTS flag is set */
 #undef  FN_POST_BOUND_EVENT
 #define FN_POST_BOUND_EVENT(obj, V) \
+	(V)->version++; \
 	if (OBJECT(obj)->flags & AG_OBJECT_BOUND_EVENTS) \
-		AG_PostEvent(NULL, (obj), "bound", "%p", (V))
+		AG_PostEvent(NULL, (obj), "bound", "%p", (V)); \
+	FN_POST_CHANGED_EVENT(obj, V)
+
+/* Generate "variable-changed" event if CHANGED_EVENTS flag is set */
+#undef  FN_POST_CHANGED_EVENT
+#define FN_POST_CHANGED_EVENT(obj, V) \
+	if (OBJECT(obj)->flags & AG_OBJECT_CHANGED_EVENTS) \
+		AG_PostEvent(NULL, (obj), "variable-changed", "%p", (V))
+
+/*
+ * Signal a change in the data referenced by a variable. This is intended
+ * for bindings (e.g., AG_BindInt()) whose data is modified directly through
+ * the pointer; AG_Set*() routines already signal changes implicitly.
+ *
+ * Once invoked on a variable, it is flagged AG_VARIABLE_NOTIFY and observers
+ * (such as AG_RedrawOnChange()) stop polling it.
+ */
+void
+AG_VariableChanged(void *obj, const char *name)
+{
+	AG_Variable *V;
+
+	AG_ObjectLock(obj);
+	TAILQ_FOREACH(V, &OBJECT(obj)->vars, vars) {
+		if (strcmp(V->name, name) == 0)
+			break;
+	}
+	if (V != NULL) {
+		V->flags |= AG_VARIABLE_NOTIFY;
+		V->version++;
+		FN_POST_CHANGED_EVENT(obj, V);
+	}
+	AG_ObjectUnlock(obj);
+}
 
 
 /* Body of AG_GetFoo() routines. */
@@ -375,6 +409,8 @@ AG_Unset(void *pObj, const char *name)
 	} else {						\
 		V->data._memb = v;				\
 	}							\
+	V->version++;						\
+	FN_POST_CHANGED_EVENT(obj, V);				\
 	AG_ObjectUnlock(obj);					\
 	return (V);						\
 }
@@ -1181,6 +1217,7 @@ AG_SetString(void *pObj, const char *name, const char *s)
 {
 	AG_Object *obj = pObj;
 	AG_Variable *V;
+	Uint version;
 
 	AG_ObjectLock(obj);
 #ifdef AG_DEBUG
@@ -1222,13 +1259,17 @@ AG_SetString(void *pObj, const char *name, const char *s)
 			    agVariableTypes[V->type].name,
 			    agVariableTypes[AG_VARIABLE_STRING].name);
 #endif
+			version = V->version;
 			AG_FreeVariable(V);
 			AG_InitVariable(V, AG_VARIABLE_STRING, name);
+			V->version = version;
 			V->info.size = 0;
 			V->data.s = Strdup(s);
 			break;
 		}
 	}
+	V->version++;
+	FN_POST_CHANGED_EVENT(obj, V);
 	AG_ObjectUnlock(obj);
 	return (V);
 }
@@ -1250,6 +1291,7 @@ AG_Variable *
 AG_SetStringNODUP(void *obj, const char *name, char *s)
 {
 	AG_Variable *V;
+	Uint version;
 
 	AG_ObjectLock(obj);
 #ifdef AG_DEBUG
@@ -1279,12 +1321,16 @@ AG_SetStringNODUP(void *obj, const char *name, char *s)
 		    agVariableTypes[V->type].name,
 		    agVariableTypes[AG_VARIABLE_STRING].name);
 #endif
+		version = V->version;
 		AG_FreeVariable(V);
 		AG_InitVariable(V, AG_VARIABLE_STRING, name);
+		V->version = version;
 		V->data.s = s;
 		V->info.size = 0;
 		break;
 	}
+	V->version++;
+	FN_POST_CHANGED_EVENT(obj, V);
 	AG_ObjectUnlock(obj);
 	return (V);
 }
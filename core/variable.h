@@ -146,6 +146,10 @@ typedef void *_Nullable (*AG_PointerFn)(struct ag_event *_Nonnull);
 typedef struct ag_variable {
 	char name[AG_VARIABLE_NAME_MAX]; /* Variable name (or "") */
 	AG_VariableType type;            /* Variable type */
+	Uint flags;
+#define AG_VARIABLE_NOTIFY 0x01          /* Changes to referenced data are
+                                            signaled by AG_VariableChanged() */
+	Uint version;                    /* Incremented on every change */
 #ifdef AG_THREADS
 	_Nullable_Mutex AG_Mutex *_Nullable mutex; /* Lock on data */
 #endif
@@ -188,6 +192,7 @@ int  AG_CompareVariables(const AG_Variable *_Nonnull,
                          const AG_Variable *_Nonnull)
                         _Pure_Attribute;
 void AG_Unset(void *_Nonnull, const char *_Nonnull);
+void AG_VariableChanged(void *_Nonnull, const char *_Nonnull);
 
 #ifdef AG_ENABLE_STRING
 void AG_VariableSubst(void *_Nonnull, const char *_Nonnull, char *_Nonnull,
@@ -475,6 +475,8 @@ MANLINKS+=AG_Tlist.3:AG_TlistBegin.3
 CATLINKS+=AG_Tlist.cat3:AG_TlistBegin.cat3
 MANLINKS+=AG_Tlist.3:AG_TlistEnd.3
 CATLINKS+=AG_Tlist.cat3:AG_TlistEnd.cat3
+MANLINKS+=AG_Tlist.3:AG_TlistSetVirtual.3
+CATLINKS+=AG_Tlist.cat3:AG_TlistSetVirtual.cat3
 MANLINKS+=AG_Tlist.3:AG_TlistSelect.3
 CATLINKS+=AG_Tlist.cat3:AG_TlistSelect.cat3
 MANLINKS+=AG_Tlist.3:AG_TlistSelectAll.3
@@ -895,6 +897,8 @@ MANLINKS+=AG_Pixmap.3:AG_PixmapFromSurfaceNODUP.3
 CATLINKS+=AG_Pixmap.cat3:AG_PixmapFromSurfaceNODUP.cat3
 MANLINKS+=AG_Pixmap.3:AG_PixmapFromFile.3
 CATLINKS+=AG_Pixmap.cat3:AG_PixmapFromFile.cat3
+MANLINKS+=AG_Pixmap.3:AG_PixmapFromFileAsync.3
+CATLINKS+=AG_Pixmap.cat3:AG_PixmapFromFileAsync.cat3
 MANLINKS+=AG_Pixmap.3:AG_PixmapFromTexture.3
 CATLINKS+=AG_Pixmap.cat3:AG_PixmapFromTexture.cat3
 MANLINKS+=AG_Pixmap.3:AG_PixmapAddSurface.3
@@ -903,6 +907,8 @@ MANLINKS+=AG_Pixmap.3:AG_PixmapAddSurfaceScaled.3
 CATLINKS+=AG_Pixmap.cat3:AG_PixmapAddSurfaceScaled.cat3
 MANLINKS+=AG_Pixmap.3:AG_PixmapAddSurfaceFromFile.3
 CATLINKS+=AG_Pixmap.cat3:AG_PixmapAddSurfaceFromFile.cat3
+MANLINKS+=AG_Pixmap.3:AG_PixmapAddSurfaceFromFileAsync.3
+CATLINKS+=AG_Pixmap.cat3:AG_PixmapAddSurfaceFromFileAsync.cat3
 MANLINKS+=AG_Pixmap.3:AG_PixmapSetSurface.3
 CATLINKS+=AG_Pixmap.cat3:AG_PixmapSetSurface.cat3
 MANLINKS+=AG_Pixmap.3:AG_PixmapReplaceSurface.3
@@ -1015,6 +1021,14 @@ MANLINKS+=AG_Console.3:AG_ConsoleClear.3
 CATLINKS+=AG_Console.cat3:AG_ConsoleClear.cat3
 MANLINKS+=AG_Console.3:AG_ConsoleExportText.3
 CATLINKS+=AG_Console.cat3:AG_ConsoleExportText.cat3
+MANLINKS+=AG_Console.3:AG_ConsoleSetMaxLines.3
+CATLINKS+=AG_Console.cat3:AG_ConsoleSetMaxLines.cat3
+MANLINKS+=AG_Console.3:AG_ConsoleMsgQueue.3
+CATLINKS+=AG_Console.cat3:AG_ConsoleMsgQueue.cat3
+MANLINKS+=AG_Console.3:AG_ConsoleMsgQueueS.3
+CATLINKS+=AG_Console.cat3:AG_ConsoleMsgQueueS.cat3
+MANLINKS+=AG_Console.3:AG_ConsoleGetLine.3
+CATLINKS+=AG_Console.cat3:AG_ConsoleGetLine.cat3
 MANLINKS+=AG_GLView.3:AG_GLViewNew.3
 CATLINKS+=AG_GLView.cat3:AG_GLViewNew.cat3
 MANLINKS+=AG_GLView.3:AG_GLViewSetBgColor.3
@@ -1087,6 +1101,8 @@ MANLINKS+=AG_Icon.3:AG_IconSetSurface.3
 CATLINKS+=AG_Icon.cat3:AG_IconSetSurface.cat3
 MANLINKS+=AG_Icon.3:AG_IconSetSurfaceNODUP.3
 CATLINKS+=AG_Icon.cat3:AG_IconSetSurfaceNODUP.cat3
+MANLINKS+=AG_Icon.3:AG_IconSetSurfaceFromFileAsync.3
+CATLINKS+=AG_Icon.cat3:AG_IconSetSurfaceFromFileAsync.cat3
 MANLINKS+=AG_Icon.3:AG_IconSetText.3
 CATLINKS+=AG_Icon.cat3:AG_IconSetText.cat3
 MANLINKS+=AG_Icon.3:AG_IconSetTextS.3
@@ -1255,6 +1271,8 @@ MANLINKS+=AG_Editable.3:AG_EditableGetBuffer.3
 CATLINKS+=AG_Editable.cat3:AG_EditableGetBuffer.cat3
 MANLINKS+=AG_Editable.3:AG_EditableReleaseBuffer.3
 CATLINKS+=AG_Editable.cat3:AG_EditableReleaseBuffer.cat3
+MANLINKS+=AG_Editable.3:AG_EditableBufferChanged.3
+CATLINKS+=AG_Editable.cat3:AG_EditableBufferChanged.cat3
 MANLINKS+=AG_Editable.3:AG_EditableClearBuffer.3
 CATLINKS+=AG_Editable.cat3:AG_EditableClearBuffer.cat3
 MANLINKS+=AG_Editable.3:AG_EditableGrowBuffer.3
@@ -1303,6 +1321,18 @@ MANLINKS+=AG_Surface.3:AG_SurfaceStdGL.3
 CATLINKS+=AG_Surface.cat3:AG_SurfaceStdGL.cat3
 MANLINKS+=AG_Surface.3:AG_SurfaceFromFile.3
 CATLINKS+=AG_Surface.cat3:AG_SurfaceFromFile.cat3
+MANLINKS+=AG_Surface.3:AG_SurfaceFromFiles.3
+CATLINKS+=AG_Surface.cat3:AG_SurfaceFromFiles.cat3
+MANLINKS+=AG_Surface.3:AG_SurfaceLoadAsync.3
+CATLINKS+=AG_Surface.cat3:AG_SurfaceLoadAsync.cat3
+MANLINKS+=AG_Surface.3:AG_SurfaceLoadCancel.3
+CATLINKS+=AG_Surface.cat3:AG_SurfaceLoadCancel.cat3
+MANLINKS+=AG_Surface.3:AG_SurfaceLoadProcess.3
+CATLINKS+=AG_Surface.cat3:AG_SurfaceLoadProcess.cat3
+MANLINKS+=AG_Surface.3:AG_SurfaceCacheSetSize.3
+CATLINKS+=AG_Surface.cat3:AG_SurfaceCacheSetSize.cat3
+MANLINKS+=AG_Surface.3:AG_SurfaceCacheClear.3
+CATLINKS+=AG_Surface.cat3:AG_SurfaceCacheClear.cat3
 MANLINKS+=AG_Surface.3:AG_SurfaceFromPNG.3
 CATLINKS+=AG_Surface.cat3:AG_SurfaceFromPNG.cat3
 MANLINKS+=AG_Surface.3:AG_SurfaceFromJPEG.3
@@ -1341,6 +1371,8 @@ MANLINKS+=AG_Surface.3:AG_SurfaceClipped.3
 CATLINKS+=AG_Surface.cat3:AG_SurfaceClipped.cat3
 MANLINKS+=AG_Surface.3:AG_SurfaceCopy.3
 CATLINKS+=AG_Surface.cat3:AG_SurfaceCopy.cat3
+MANLINKS+=AG_Surface.3:AG_SurfacePremultiplyAlpha.3
+CATLINKS+=AG_Surface.cat3:AG_SurfacePremultiplyAlpha.cat3
 MANLINKS+=AG_Surface.3:AG_SurfaceDup.3
 CATLINKS+=AG_Surface.cat3:AG_SurfaceDup.cat3
 MANLINKS+=AG_Surface.3:AG_SurfaceConvert.3
@@ -1545,6 +1577,8 @@ MANLINKS+=AG_Treetbl.3:AG_TreetblExpandRow.3
 CATLINKS+=AG_Treetbl.cat3:AG_TreetblExpandRow.cat3
 MANLINKS+=AG_Treetbl.3:AG_TreetblCollapseRow.3
 CATLINKS+=AG_Treetbl.cat3:AG_TreetblCollapseRow.cat3
+MANLINKS+=AG_Treetbl.3:AG_TreetblSetPopulateFn.3
+CATLINKS+=AG_Treetbl.cat3:AG_TreetblSetPopulateFn.cat3
 MANLINKS+=AG_WidgetPrimitives.3:AG_PutPixel.3
 CATLINKS+=AG_WidgetPrimitives.cat3:AG_PutPixel.cat3
 MANLINKS+=AG_WidgetPrimitives.3:AG_PutPixelRGB.3
@@ -1807,3 +1841,13 @@ MANLINKS+=AG_StyleSheet.3:AG_LoadStyleSheet.3
 CATLINKS+=AG_StyleSheet.cat3:AG_LoadStyleSheet.cat3
 MANLINKS+=AG_StyleSheet.3:AG_LookupStyleSheet.3
 CATLINKS+=AG_StyleSheet.cat3:AG_LookupStyleSheet.cat3
+MANLINKS+=AG_DriverHeadless.3:AG_HeadlessPostEvent.3
+CATLINKS+=AG_DriverHeadless.cat3:AG_HeadlessPostEvent.cat3
+MANLINKS+=AG_DriverHeadless.3:AG_HeadlessMouseMotion.3
+CATLINKS+=AG_DriverHeadless.cat3:AG_HeadlessMouseMotion.cat3
+MANLINKS+=AG_DriverHeadless.3:AG_HeadlessMouseButton.3
+CATLINKS+=AG_DriverHeadless.cat3:AG_HeadlessMouseButton.cat3
+MANLINKS+=AG_DriverHeadless.3:AG_HeadlessKey.3
+CATLINKS+=AG_DriverHeadless.cat3:AG_HeadlessKey.cat3
+MANLINKS+=AG_DriverHeadless.3:AG_HeadlessRender.3
+CATLINKS+=AG_DriverHeadless.cat3:AG_HeadlessRender.cat3
@@ -41,6 +41,26 @@
 #include <string.h>
 #include <errno.h>
 
+/* Line i of the scrollback (0 = oldest). */
+#define LINE(cons,i) ((cons)->lines[((cons)->lineHead + (i)) & \
+                                    ((cons)->linesMax - 1)])
+
+/*
+ * Lines queued by other threads are pushed onto a lock-free stack,
+ * which the GUI thread takes over in one atomic exchange.
+ */
+#if defined(AG_THREADS) && defined(__GNUC__) && defined(__ATOMIC_ACQUIRE)
+# define CONSOLE_ATOMIC_QUEUE
+#endif
+
+typedef struct ag_console_queued {
+	struct ag_console_queued *_Nullable next;
+	AG_Size len;			/* Text length (excluding NUL) */
+	char text[1];
+} AG_ConsoleQueued;
+
+static void ProcessQueue(AG_Console *_Nonnull);
+
 AG_Console *
 AG_ConsoleNew(void *parent, Uint flags)
 {
@@ -67,7 +87,7 @@ AdjustXoffs(AG_Console *_Nonnull cons)
 	for (i = 0, cons->wMax = 0;
 	     i < cons->nLines;
 	     i++) {
-		AG_ConsoleLine *ln = cons->lines[i];
+		AG_ConsoleLine *ln = LINE(cons,i);
 		int w;
 
 		if (ln->surface[0] != -1) {
@@ -185,7 +205,7 @@ AG_ConsoleExportText(AG_Console *cons, int nativeNL)
 	for (i = cons->pos;
 	     (i >= 0 && i < cons->nLines);
 	     i += dir) {
-		AG_ConsoleLine *ln = cons->lines[i];
+		AG_ConsoleLine *ln = LINE(cons,i);
 		sizeReq += ln->len + 2; /* \r\n */
 		if (i == cons->pos+cons->sel)
 			break;
@@ -198,7 +218,7 @@ AG_ConsoleExportText(AG_Console *cons, int nativeNL)
 	for (i = cons->pos;
 	     (i >= 0 && i < cons->nLines);
 	     i += dir) {
-		AG_ConsoleLine *ln = cons->lines[i];
+		AG_ConsoleLine *ln = LINE(cons,i);
 
 		memcpy(ps, ln->text, ln->len);
 #ifdef _WIN32
@@ -434,7 +454,7 @@ OnFontChange(AG_Event *_Nonnull event)
 	ComputeVisible(cons);
 
 	for (i = 0; i < cons->nLines; i++) {
-		AG_ConsoleLine *ln = cons->lines[i];
+		AG_ConsoleLine *ln = LINE(cons,i);
 
 		for (j = 0; j < 2; j++) {
 			if (ln->surface[j] != -1) {
@@ -445,6 +465,40 @@ OnFontChange(AG_Event *_Nonnull event)
 	}
 }
 
+#ifdef AG_TIMERS
+/*
+ * Queued lines are taken over on draw. While the console is hidden, drain
+ * the queue periodically so that it does not grow without bound.
+ */
+static Uint32
+QueueTimeout(AG_Timer *_Nonnull to, AG_Event *_Nonnull event)
+{
+	AG_Console *cons = AG_SELF();
+
+	AG_ObjectLock(cons);
+	ProcessQueue(cons);
+	AG_ObjectUnlock(cons);
+	return (to->ival);
+}
+
+static void
+OnHide(AG_Event *_Nonnull event)
+{
+	AG_Console *cons = AG_SELF();
+
+	if (!AG_TimerIsRunning(cons, &cons->toQueue))
+		AG_AddTimer(cons, &cons->toQueue, 500, QueueTimeout, NULL);
+}
+
+static void
+OnShow(AG_Event *_Nonnull event)
+{
+	AG_Console *cons = AG_SELF();
+
+	AG_DelTimer(cons, &cons->toQueue);
+}
+#endif /* AG_TIMERS */
+
 static void
 Init(void *_Nonnull obj)
 {
@@ -457,6 +511,12 @@ Init(void *_Nonnull obj)
 	cons->lines = NULL;
 	cons->lineskip = 0;
 	cons->nLines = 0;
+	cons->lineHead = 0;
+	cons->linesMax = 0;
+	cons->maxLines = 0;
+	cons->blk = NULL;
+	cons->queue = NULL;
+	AG_MutexInit(&cons->queueLock);
 	cons->xOffs = 0;
 	cons->wMax = 0;
 	cons->rOffs = 0;
@@ -508,6 +568,12 @@ Init(void *_Nonnull obj)
 	AG_SetEvent(cons, "mouse-motion", MouseMotion, NULL);
 	AG_AddEvent(cons, "font-changed", OnFontChange, NULL);
 	AG_AddEvent(cons, "widget-shown", OnFontChange, NULL);
+#ifdef AG_TIMERS
+	AG_InitTimer(&cons->toQueue, "queue", 0);
+	AG_AddEvent(cons, "attached", OnHide, NULL);
+	AG_AddEvent(cons, "widget-hidden", OnHide, NULL);
+	AG_AddEvent(cons, "widget-shown", OnShow, NULL);
+#endif
 #if 0
 	AG_BindUint(cons, "nLines", &cons->nLines);
 	AG_BindUint(cons, "rOffs", &cons->rOffs);
@@ -568,6 +634,8 @@ Draw(void *_Nonnull p)
 	Uint lnIdx;
 	int pos, sel;
 
+	ProcessQueue(cons);
+
 	r.x = 0;
 	r.y = 0;
 	r.w = WIDTH(cons);
@@ -593,7 +661,7 @@ Draw(void *_Nonnull p)
 	for (lnIdx = cons->rOffs;
 	     lnIdx < cons->nLines && r.y < WIDGET(cons)->h;
 	     lnIdx++) {
-		AG_ConsoleLine *ln = cons->lines[lnIdx];
+		AG_ConsoleLine *ln = LINE(cons,lnIdx);
 		AG_Color *cTxt = &WCOLOR(cons,AG_TEXT_COLOR);
 		int suIdx = 0;
 
@@ -623,19 +691,74 @@ out:
 	AG_WidgetDraw(cons->hBar);
 }
 
+/* Delete the oldest line, and its block once all of its lines are gone. */
 static void
-FreeLines(AG_Console *_Nonnull cons)
+DeleteFirstLine(AG_Console *_Nonnull cons, int unmap)
 {
-	Uint i;
-	
-	for (i = 0; i < cons->nLines; i++) {
-		AG_ConsoleLine *ln = cons->lines[i];
+	AG_ConsoleLine *ln = LINE(cons,0);
+	AG_ConsoleBlock *blk = ln->blk;
+	int i;
+
+	if (unmap) {
+		for (i = 0; i < 2; i++) {
+			if (ln->surface[i] != -1)
+				AG_WidgetUnmapSurface(cons, ln->surface[i]);
+		}
+	}
+	if (ln->flags & AG_CONSOLE_LINE_TEXT_ALLOC) {
 		free(ln->text);
-		free(ln);
 	}
+	if (--blk->nLive == 0 && blk != cons->blk) {
+		free(blk);
+	}
+	cons->lineHead = (cons->lineHead + 1) & (cons->linesMax - 1);
+	cons->nLines--;
+}
+
+/* Evict the oldest line, preserving the view and selection. */
+static void
+EvictLine(AG_Console *_Nonnull cons)
+{
+	DeleteFirstLine(cons, 1);
+
+	if (cons->rOffs > 0) {
+		cons->rOffs--;
+	}
+	if (cons->pos > 0) {
+		cons->pos--;
+	} else if (cons->pos == 0) {
+		if (cons->sel > 0) {
+			cons->sel--;
+		} else {
+			cons->pos = -1;
+			cons->sel = 0;
+		}
+	}
+}
+
+static void
+FreeLines(AG_Console *_Nonnull cons, int unmap)
+{
+	while (cons->nLines > 0) {
+		DeleteFirstLine(cons, unmap);
+	}
+	Free(cons->blk);
+	cons->blk = NULL;
 	Free(cons->lines);
 	cons->lines = NULL;
-	cons->nLines = 0;
+	cons->lineHead = 0;
+	cons->linesMax = 0;
+}
+
+static void
+FreeQueue(AG_ConsoleQueued *_Nullable q)
+{
+	AG_ConsoleQueued *qNext;
+
+	for (; q != NULL; q = qNext) {
+		qNext = q->next;
+		free(q);
+	}
 }
 
 static void
@@ -646,7 +769,9 @@ Destroy(void *_Nonnull p)
 	if (cons->pm != NULL) {
 		AG_PopupDestroy(cons->pm);
 	}
-	FreeLines(cons);
+	FreeQueue(cons->queue);
+	FreeLines(cons, 0);
+	AG_MutexDestroy(&cons->queueLock);
 }
 
 /* Configure padding in pixels */
@@ -658,33 +783,137 @@ AG_ConsoleSetPadding(AG_Console *cons, int padding)
 	AG_ObjectUnlock(cons);
 }
 
-/* Append a line to the console; backend to AG_ConsoleMsg(). */
-AG_ConsoleLine *
-AG_ConsoleAppendLine(AG_Console *cons, const char *s)
+/*
+ * Allocate a new line (and storage for len bytes of text). The oldest
+ * line is evicted if the scrollback limit is reached.
+ */
+static AG_ConsoleLine *_Nonnull
+NewLine(AG_Console *_Nonnull cons, AG_Size len)
 {
+	AG_ConsoleBlock *blk = cons->blk;
 	AG_ConsoleLine *ln;
-	
-	ln = Malloc(sizeof(AG_ConsoleLine));
-
-	AG_ObjectLock(cons);
-
-	cons->lines = Realloc(cons->lines, (cons->nLines+1) *
-	                                   sizeof(AG_ConsoleLine *));
-	cons->lines[cons->nLines++] = ln;
+	int inBlock = (len < AG_CONSOLE_BLOCK_TEXT/4);
 
-	if (s != NULL) {
-		ln->text = Strdup(s);
-		ln->len = strlen(s);
+	if (cons->maxLines > 0 && cons->nLines >= cons->maxLines) {
+		EvictLine(cons);
+	}
+	if (cons->nLines == cons->linesMax) {		/* Grow the ring */
+		Uint maxNew = (cons->linesMax > 0) ? cons->linesMax << 1 :
+		                                     AG_CONSOLE_BLOCK_LINES;
+		AG_ConsoleLine **linesNew;
+		Uint i;
+
+		linesNew = Malloc(maxNew * sizeof(AG_ConsoleLine *));
+		for (i = 0; i < cons->nLines; i++) {
+			linesNew[i] = LINE(cons,i);
+		}
+		Free(cons->lines);
+		cons->lines = linesNew;
+		cons->lineHead = 0;
+		cons->linesMax = maxNew;
+	}
+	if (blk == NULL || blk->nLines == AG_CONSOLE_BLOCK_LINES ||
+	    (inBlock && blk->textLen + len + 1 > AG_CONSOLE_BLOCK_TEXT)) {
+		if (blk != NULL && blk->nLive == 0) {
+			free(blk);
+		}
+		blk = cons->blk = Malloc(sizeof(AG_ConsoleBlock));
+		blk->nLines = 0;
+		blk->nLive = 0;
+		blk->textLen = 0;
+	}
+	ln = &blk->lines[blk->nLines++];
+	blk->nLive++;
+	if (inBlock) {
+		ln->text = &blk->text[blk->textLen];
+		ln->flags = 0;
+		blk->textLen += len + 1;
 	} else {
-		ln->text = NULL;
-		ln->len = 0;
+		ln->text = Malloc(len + 1);
+		ln->flags = AG_CONSOLE_LINE_TEXT_ALLOC;
 	}
+	ln->text[0] = '\0';
+	ln->len = 0;
+	ln->blk = blk;
 	ln->cons = cons;
 	ln->p = NULL;
 	ln->surface[0] = -1;
 	ln->surface[1] = -1;
 	AG_ColorNone(&ln->c);			/* Inherit default */
 
+	cons->lines[(cons->lineHead + cons->nLines) & (cons->linesMax - 1)] = ln;
+	cons->nLines++;
+	return (ln);
+}
+
+/* Append a line of text (stripping one trailing newline). */
+static AG_ConsoleLine *_Nonnull
+AppendText(AG_Console *_Nonnull cons, const char *_Nonnull s, AG_Size len)
+{
+	AG_ConsoleLine *ln;
+
+	if (len > 1 && s[len-1] == '\n') {
+		len--;
+	}
+	ln = NewLine(cons, len);
+	memcpy(ln->text, s, len);
+	ln->text[len] = '\0';
+	ln->len = len;
+	return (ln);
+}
+
+/* Take over the lines queued by other threads. */
+static void
+ProcessQueue(AG_Console *_Nonnull cons)
+{
+	AG_ConsoleQueued *q, *qNext, *qRev = NULL;
+
+#ifdef CONSOLE_ATOMIC_QUEUE
+	if (__atomic_load_n(&cons->queue, __ATOMIC_RELAXED) == NULL) {
+		return;
+	}
+	q = __atomic_exchange_n(&cons->queue, NULL, __ATOMIC_ACQUIRE);
+#else
+	AG_MutexLock(&cons->queueLock);
+	q = cons->queue;
+	cons->queue = NULL;
+	AG_MutexUnlock(&cons->queueLock);
+#endif
+	if (q == NULL) {
+		return;
+	}
+	for (; q != NULL; q = qNext) {			/* Restore FIFO order */
+		qNext = q->next;
+		q->next = qRev;
+		qRev = q;
+	}
+	for (q = qRev; q != NULL; q = qNext) {
+		qNext = q->next;
+		AppendText(cons, q->text, q->len);
+		free(q);
+	}
+	if ((cons->flags & AG_CONSOLE_NOAUTOSCROLL) == 0)
+		cons->scrollTo = &cons->nLines;
+}
+
+/* Append a line to the console; backend to AG_ConsoleMsg(). */
+AG_ConsoleLine *
+AG_ConsoleAppendLine(AG_Console *cons, const char *s)
+{
+	AG_ConsoleLine *ln;
+	
+	AG_ObjectLock(cons);
+
+	ProcessQueue(cons);
+	if (s != NULL) {
+		AG_Size len = strlen(s);
+
+		ln = NewLine(cons, len);
+		memcpy(ln->text, s, len+1);
+		ln->len = len;
+	} else {
+		ln = NewLine(cons, 0);
+	}
 	if ((cons->flags & AG_CONSOLE_NOAUTOSCROLL) == 0) {
 		cons->scrollTo = &cons->nLines;
 	}
@@ -699,26 +928,23 @@ AG_ConsoleMsg(AG_Console *cons, const char *fmt, ...)
 {
 	AG_ConsoleLine *ln;
 	va_list args;
-	AG_Size len;
+	char *s;
 
-	AG_ObjectLock(cons);
-	if ((ln = AG_ConsoleAppendLine(cons, NULL)) == NULL) {
-		goto fail;
-	}
 	va_start(args, fmt);
-	AG_Vasprintf(&ln->text, fmt, args);
+	AG_Vasprintf(&s, fmt, args);
 	va_end(args);
 
-	len = ln->len = strlen(ln->text);
-	if (len > 1 && ln->text[len-1] == '\n') {
-		ln->text[len-1] = '\0';
-		ln->len--;
+	AG_ObjectLock(cons);
+	ProcessQueue(cons);
+	ln = AppendText(cons, s, strlen(s));
+	if ((cons->flags & AG_CONSOLE_NOAUTOSCROLL) == 0) {
+		cons->scrollTo = &cons->nLines;
 	}
+	AG_Redraw(cons);
 	AG_ObjectUnlock(cons);
+
+	free(s);
 	return (ln);
-fail:
-	AG_ObjectUnlock(cons);
-	return (NULL);
 }
 
 /* Append a message to the console (C string). */
@@ -726,22 +952,95 @@ AG_ConsoleLine *
 AG_ConsoleMsgS(AG_Console *cons, const char *s)
 {
 	AG_ConsoleLine *ln;
-	AG_Size len;
 	
 	AG_ObjectLock(cons);
-	if ((ln = AG_ConsoleAppendLine(cons, s)) == NULL) {
-		goto fail;
+	ProcessQueue(cons);
+	ln = AppendText(cons, s, strlen(s));
+	if ((cons->flags & AG_CONSOLE_NOAUTOSCROLL) == 0) {
+		cons->scrollTo = &cons->nLines;
 	}
-	len = ln->len;
-	if (len > 1 && ln->text[len-1] == '\n') {
-		ln->text[len-1] = '\0';
-		ln->len--;
+	AG_Redraw(cons);
+	AG_ObjectUnlock(cons);
+	return (ln);
+}
+
+/*
+ * Queue a message for display (C string). This is safe to call from any
+ * thread and never blocks on the console's lock; the queued lines are
+ * appended by the GUI thread before the next redraw.
+ */
+int
+AG_ConsoleMsgQueueS(AG_Console *cons, const char *s)
+{
+	AG_ConsoleQueued *q;
+	AG_Size len = strlen(s);
+
+	if ((q = TryMalloc(sizeof(AG_ConsoleQueued) + len)) == NULL) {
+		return (-1);
+	}
+	memcpy(q->text, s, len+1);
+	q->len = len;
+#ifdef CONSOLE_ATOMIC_QUEUE
+	q->next = __atomic_load_n(&cons->queue, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&cons->queue, &q->next, q, 1,
+	    __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		;
+#else
+	AG_MutexLock(&cons->queueLock);
+	q->next = cons->queue;
+	cons->queue = q;
+	AG_MutexUnlock(&cons->queueLock);
+#endif
+	AG_Redraw(cons);
+	return (0);
+}
+
+/* Queue a message for display (format string). */
+int
+AG_ConsoleMsgQueue(AG_Console *cons, const char *fmt, ...)
+{
+	va_list args;
+	char *s;
+	int rv;
+
+	va_start(args, fmt);
+	if (AG_TryVasprintf(&s, fmt, args) == -1) {
+		va_end(args);
+		return (-1);
 	}
+	va_end(args);
+	rv = AG_ConsoleMsgQueueS(cons, s);
+	free(s);
+	return (rv);
+}
+
+/* Return line i of the scrollback (0 = oldest), or NULL. */
+AG_ConsoleLine *
+AG_ConsoleGetLine(AG_Console *cons, Uint i)
+{
+	AG_ConsoleLine *ln;
+
+	AG_ObjectLock(cons);
+	ln = (i < cons->nLines) ? LINE(cons,i) : NULL;
 	AG_ObjectUnlock(cons);
 	return (ln);
-fail:
+}
+
+/*
+ * Limit the scrollback to n lines (0 = unlimited). The oldest lines are
+ * deleted as new ones are appended.
+ */
+void
+AG_ConsoleSetMaxLines(AG_Console *cons, Uint n)
+{
+	AG_ObjectLock(cons);
+	cons->maxLines = n;
+	if (n > 0) {
+		while (cons->nLines > n)
+			EvictLine(cons);
+	}
+	AG_Redraw(cons);
 	AG_ObjectUnlock(cons);
-	return (NULL);
 }
 
 static void
@@ -765,9 +1064,12 @@ AG_ConsoleMsgEdit(AG_ConsoleLine *ln, const char *s)
 	AG_Console *cons = ln->cons;
 
 	AG_ObjectLock(cons);
-	free(ln->text);
+	if (ln->flags & AG_CONSOLE_LINE_TEXT_ALLOC) {
+		free(ln->text);
+	}
 	ln->text = Strdup(s);
 	ln->len = strlen(s);
+	ln->flags |= AG_CONSOLE_LINE_TEXT_ALLOC;
 	InvalidateCachedLabel(cons, ln);
 	AG_ObjectUnlock(cons);
 }
@@ -782,10 +1084,18 @@ AG_ConsoleMsgCatS(AG_ConsoleLine *ln, const char *s)
 	sLen = strlen(s);
 
 	AG_ObjectLock(cons);
-	newLen = ln->len + sLen + 1;
-	ln->text = Realloc(ln->text, newLen);
+	newLen = ln->len + sLen;
+	if (ln->flags & AG_CONSOLE_LINE_TEXT_ALLOC) {
+		ln->text = Realloc(ln->text, newLen + 1);
+	} else {
+		char *text = Malloc(newLen + 1);
+
+		memcpy(text, ln->text, ln->len);
+		ln->text = text;
+		ln->flags |= AG_CONSOLE_LINE_TEXT_ALLOC;
+	}
+	memcpy(&ln->text[ln->len], s, sLen + 1);
 	ln->len = newLen;
-	Strlcat(ln->text, s, newLen);
 	InvalidateCachedLabel(cons, ln);
 	AG_ObjectUnlock(cons);
 }
@@ -813,7 +1123,8 @@ void
 AG_ConsoleClear(AG_Console *cons)
 {
 	AG_ObjectLock(cons);
-	FreeLines(cons);
+	ProcessQueue(cons);
+	FreeLines(cons, 1);
 	cons->rOffs = 0;
 	cons->pos = -1;
 	cons->sel = 0;
@@ -10,8 +10,13 @@
 #include <agar/gui/begin.h>
 
 struct ag_console;
+struct ag_console_block;
+struct ag_console_queued;
 struct ag_popup_menu;
 
+#define AG_CONSOLE_BLOCK_LINES	256	/* Lines per storage block */
+#define AG_CONSOLE_BLOCK_TEXT	16384	/* Text bytes per storage block */
+
 /* TODO: timestamps, markup */
 typedef struct ag_console_line {
 	char *_Nonnull text;		  /* Line text */
@@ -20,8 +25,20 @@ typedef struct ag_console_line {
 	AG_Color c;			  /* Alternate text color */
 	void *_Nullable p;		  /* User pointer */
 	struct ag_console *_Nonnull cons; /* Back pointer to console */
+	struct ag_console_block *_Nonnull blk; /* Storage block */
+	Uint flags;
+#define AG_CONSOLE_LINE_TEXT_ALLOC 0x01	  /* Text is not in block storage */
 } AG_ConsoleLine;
 
+/* Storage for a block of lines and their text. */
+typedef struct ag_console_block {
+	Uint nLines;			  /* Lines allocated from block */
+	Uint nLive;			  /* Lines not yet deleted */
+	AG_Size textLen;		  /* Text bytes used */
+	AG_ConsoleLine lines[AG_CONSOLE_BLOCK_LINES];
+	char text[AG_CONSOLE_BLOCK_TEXT];
+} AG_ConsoleBlock;
+
 typedef struct ag_console {
 	struct ag_widget wid;		/* AG_Widget -> AG_Console */
 
@@ -35,8 +52,17 @@ typedef struct ag_console {
 	int padding;			/* Padding in pixels */
 	int lineskip;			/* Space between lines */
 
-	AG_ConsoleLine *_Nullable *_Nonnull lines; /* Lines in buffer */
+	AG_ConsoleLine *_Nonnull *_Nullable lines; /* Lines (ring buffer) */
 	Uint                               nLines; /* Line count */
+	Uint lineHead;			/* Index of first line in ring */
+	Uint linesMax;			/* Ring size (power of 2) */
+	Uint maxLines;			/* Scrollback limit (0 = unlimited) */
+	AG_ConsoleBlock *_Nullable blk;	/* Block being filled */
+	struct ag_console_queued *_Nullable queue; /* Lines from other threads */
+	_Nonnull_Mutex AG_Mutex queueLock; /* Lock on queue (if no atomics) */
+#ifdef AG_TIMERS
+	AG_Timer toQueue;		/* Drains queue while hidden */
+#endif
 
 	int xOffs;			/* Horizontal display offset (px) */
 	int wMax;			/* Width of widest line seen (px) */
@@ -61,6 +87,11 @@ AG_ConsoleLine *_Nonnull AG_ConsoleAppendLine(AG_Console *_Nonnull,
 AG_ConsoleLine *_Nonnull AG_ConsoleMsgS(AG_Console *_Nonnull, const char *_Nonnull);
 AG_ConsoleLine *_Nonnull AG_ConsoleMsg(AG_Console *_Nonnull, const char *_Nonnull, ...)
                                       FORMAT_ATTRIBUTE(printf,2,3);
+int  AG_ConsoleMsgQueueS(AG_Console *_Nonnull, const char *_Nonnull);
+int  AG_ConsoleMsgQueue(AG_Console *_Nonnull, const char *_Nonnull, ...)
+                       FORMAT_ATTRIBUTE(printf,2,3);
+AG_ConsoleLine *_Nullable AG_ConsoleGetLine(AG_Console *_Nonnull, Uint);
+void AG_ConsoleSetMaxLines(AG_Console *_Nonnull, Uint);
 
 void AG_ConsoleSetPadding(AG_Console *_Nonnull, int);
 void AG_ConsoleMsgEdit(AG_ConsoleLine *_Nonnull, const char *_Nonnull);
@@ -53,6 +53,7 @@ extern AG_DriverClass agDriverWGL;
 #if defined(HAVE_COCOA)
 extern AG_DriverClass agDriverCocoa;
 #endif
+extern AG_DriverClass agDriverHeadless;
 
 AG_Object       agDrivers;			/* Drivers VFS */
 AG_DriverClass *agDriverOps = NULL;		/* Current driver class */
@@ -73,6 +74,7 @@ AG_DriverClass *agDriverList[] = {
 #if defined(HAVE_SDL)
 	&agDriverSDLFB,
 #endif
+	&agDriverHeadless,
 	NULL
 };
 
@@ -197,7 +199,7 @@ AG_ViewCapture(void)
 
 	AG_LockVFS(&agDrivers);
 
-	if ((s = AGDRIVER_SW_CLASS(agDriverSw)->videoCapture(agDriverSw)) != NULL) {
+	if ((s = AGDRIVER_SW_CLASS(agDriverSw)->videoCapture(agDriverSw)) == NULL) {
 		Verbose("Capture failed: %s\n", AG_GetError());
 		goto out;
 	}
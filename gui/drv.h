@@ -40,6 +40,7 @@ typedef struct ag_driver_class {
 #define AG_DRIVER_OPENGL	0x01		/* Supports OpenGL calls */
 #define AG_DRIVER_SDL		0x02		/* Supports SDL calls */
 #define AG_DRIVER_TEXTURES	0x04		/* Support texture ops */
+#define AG_DRIVER_NOAUTO	0x08		/* Not auto-selected */
 
 	/* Initialization */
 	int  (*_Nonnull open)(void *_Nonnull, const char *_Nullable);
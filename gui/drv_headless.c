@@ -0,0 +1,1512 @@
+/*
+ * Copyright (c) 2026 Julien Nadeau Carriere <vedge@csoft.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Headless single-window driver. Renders into a 32-bpp AG_Surface in
+ * memory, without any display server. Input events are injected by the
+ * application with AG_HeadlessPostEvent() and friends.
+ */
+
+#include <agar/core/core.h>
+#include <agar/gui/gui.h>
+#include <agar/gui/drv.h>
+#include <agar/gui/text.h>
+#include <agar/gui/window.h>
+#include <agar/gui/cursors.h>
+#include <agar/gui/drv_headless.h>
+
+static int nDrivers = 0;			/* Opened driver instances */
+static AG_EventSink *_Nullable hlEventSpinner = NULL;
+static AG_EventSink *_Nullable hlEventEpilogue = NULL;
+
+static int  HEADLESS_ProcessEvent(void *_Nullable, AG_DriverEvent *_Nonnull);
+static void HEADLESS_DrawRectFilled(void *_Nonnull, const AG_Rect *_Nonnull,
+                                    const AG_Color *_Nonnull);
+
+static void
+Init(void *_Nonnull obj)
+{
+	AG_DriverHeadless *hl = obj;
+
+	hl->s = NULL;
+	hl->extSurface = 0;
+	hl->clipRects = NULL;
+	hl->nClipRects = 0;
+	AG_MutexInit(&hl->lock);
+	TAILQ_INIT(&hl->events);
+	hl->nFrames = 0;
+	hl->cursorVisible = 1;
+}
+
+static void
+Destroy(void *_Nonnull obj)
+{
+	AG_DriverHeadless *hl = obj;
+	AG_DriverEvent *dev, *devNext;
+
+	for (dev = TAILQ_FIRST(&hl->events);
+	     dev != TAILQ_END(&hl->events);
+	     dev = devNext) {
+		devNext = TAILQ_NEXT(dev, events);
+		free(dev);
+	}
+	AG_MutexDestroy(&hl->lock);
+	Free(hl->clipRects);
+}
+
+/*
+ * Event processing
+ */
+
+static int
+HEADLESS_EventSink(AG_EventSink *_Nonnull es, AG_Event *_Nonnull event)
+{
+	AG_DriverEvent dev;
+	AG_Driver *drv = AG_PTR(1);
+
+	if (AGDRIVER_CLASS(drv)->pendingEvents(drv)) {
+		while (AGDRIVER_CLASS(drv)->getNextEvent(drv, &dev) == 1)
+			(void)HEADLESS_ProcessEvent(drv, &dev);
+	} else {
+		AG_Delay(1);
+	}
+	return (0);
+}
+
+static int
+HEADLESS_EventEpilogue(AG_EventSink *_Nonnull es, AG_Event *_Nonnull event)
+{
+	AG_WindowDrawQueued();
+	AG_WindowProcessQueued();
+	return (0);
+}
+
+/*
+ * Generic driver operations
+ */
+
+static int
+HEADLESS_Open(void *_Nonnull obj, const char *_Nullable spec)
+{
+	AG_Driver *drv = obj;
+
+	if (nDrivers != 0) {
+		AG_SetError("Multiple headless displays are not supported");
+		return (-1);
+	}
+
+	/* Initialize the main mouse and keyboard devices. */
+	if ((drv->mouse = AG_MouseNew(drv, "Headless mouse")) == NULL ||
+	    (drv->kbd = AG_KeyboardNew(drv, "Headless keyboard")) == NULL)
+		goto fail;
+
+	if ((hlEventSpinner = AG_AddEventSpinner(HEADLESS_EventSink, "%p", drv)) == NULL ||
+	    (hlEventEpilogue = AG_AddEventEpilogue(HEADLESS_EventEpilogue, NULL)) == NULL) {
+		goto fail;
+	}
+	nDrivers = 1;
+	return (0);
+fail:
+	if (hlEventSpinner != NULL) { AG_DelEventSpinner(hlEventSpinner); hlEventSpinner = NULL; }
+	if (hlEventEpilogue != NULL) { AG_DelEventEpilogue(hlEventEpilogue); hlEventEpilogue = NULL; }
+	if (drv->kbd != NULL) { AG_ObjectDelete(drv->kbd); drv->kbd = NULL; }
+	if (drv->mouse != NULL) { AG_ObjectDelete(drv->mouse); drv->mouse = NULL; }
+	return (-1);
+}
+
+static void
+HEADLESS_Close(void *_Nonnull obj)
+{
+	AG_Driver *drv = obj;
+
+	AG_DelEventSpinner(hlEventSpinner); hlEventSpinner = NULL;
+	AG_DelEventEpilogue(hlEventEpilogue); hlEventEpilogue = NULL;
+
+#ifdef AG_DEBUG
+	if (nDrivers != 1) { AG_FatalError("Driver close without open"); }
+#endif
+	AG_FreeCursors(drv);
+
+	AG_ObjectDelete(drv->kbd); drv->kbd = NULL;
+	AG_ObjectDelete(drv->mouse); drv->mouse = NULL;
+
+	nDrivers = 0;
+}
+
+/* Return the size of the offscreen display (or a default of 640x480). */
+static int
+HEADLESS_GetDisplaySize(Uint *_Nonnull w, Uint *_Nonnull h)
+{
+	if (agDriverSw != NULL &&
+	    AGDRIVER_CLASS(agDriverSw) == (AG_DriverClass *)&agDriverHeadless) {
+		*w = agDriverSw->w;
+		*h = agDriverSw->h;
+	} else {
+		*w = 640;
+		*h = 480;
+	}
+	return (0);
+}
+
+static void
+HEADLESS_BeginEventProcessing(void *_Nonnull obj)
+{
+	/* Nothing to do */
+}
+
+static int
+HEADLESS_PendingEvents(void *_Nonnull obj)
+{
+	AG_DriverHeadless *hl = obj;
+	int rv;
+
+	AG_MutexLock(&hl->lock);
+	rv = !TAILQ_EMPTY(&hl->events);
+	AG_MutexUnlock(&hl->lock);
+	return (rv);
+}
+
+static int
+HEADLESS_GetNextEvent(void *_Nonnull obj, AG_DriverEvent *_Nonnull dev)
+{
+	AG_Driver *drv = obj;
+	AG_DriverHeadless *hl = obj;
+	AG_DriverEvent *devFirst;
+
+	AG_MutexLock(&hl->lock);
+	if ((devFirst = TAILQ_FIRST(&hl->events)) == NULL) {
+		AG_MutexUnlock(&hl->lock);
+		return (0);
+	}
+	TAILQ_REMOVE(&hl->events, devFirst, events);
+	AG_MutexUnlock(&hl->lock);
+
+	memcpy(dev, devFirst, sizeof(AG_DriverEvent));
+	free(devFirst);
+
+	/* Update the state of the input devices. */
+	switch (dev->type) {
+	case AG_DRIVER_MOUSE_MOTION:
+		AG_MouseMotionUpdate(drv->mouse,
+		    dev->data.motion.x,
+		    dev->data.motion.y);
+		break;
+	case AG_DRIVER_MOUSE_BUTTON_DOWN:
+		AG_MouseButtonUpdate(drv->mouse, AG_BUTTON_PRESSED,
+		    dev->data.button.which);
+		break;
+	case AG_DRIVER_MOUSE_BUTTON_UP:
+		AG_MouseButtonUpdate(drv->mouse, AG_BUTTON_RELEASED,
+		    dev->data.button.which);
+		break;
+	case AG_DRIVER_KEY_DOWN:
+		AG_KeyboardUpdate(drv->kbd, AG_KEY_PRESSED,
+		    dev->data.key.ks);
+		break;
+	case AG_DRIVER_KEY_UP:
+		AG_KeyboardUpdate(drv->kbd, AG_KEY_RELEASED,
+		    dev->data.key.ks);
+		break;
+	default:
+		break;
+	}
+	return (1);
+}
+
+static int
+HEADLESS_ProcessEvent(void *_Nullable obj, AG_DriverEvent *_Nonnull dev)
+{
+	AG_Driver *drv = obj;
+	AG_DriverSw *dsw = obj;
+	int rv = 1;
+
+	AG_LockVFS(&agDrivers);
+	switch (dev->type) {
+	case AG_DRIVER_MOUSE_MOTION:
+	case AG_DRIVER_MOUSE_BUTTON_UP:
+	case AG_DRIVER_KEY_UP:
+		rv = AG_WM_ProcessInput(dsw, dev);
+		break;
+	case AG_DRIVER_MOUSE_BUTTON_DOWN:
+		rv = AG_WM_ProcessInput(dsw, dev);
+		if (rv == 0 &&
+		    (dsw->flags & AG_DRIVER_SW_BGPOPUP) &&
+		    (dev->data.button.which == AG_MOUSE_MIDDLE ||
+		     dev->data.button.which == AG_MOUSE_RIGHT)) {
+			AG_WM_BackgroundPopupMenu(dsw);
+		}
+		break;
+	case AG_DRIVER_KEY_DOWN:
+		if (AG_ExecGlobalKeys(dev->data.key.ks, drv->kbd->modState) == 0) {
+			rv = AG_WM_ProcessInput(dsw, dev);
+		} else {
+			rv = 1;
+		}
+		break;
+	case AG_DRIVER_VIDEORESIZE:
+		if (AG_ResizeDisplay(dev->data.videoresize.w,
+		    dev->data.videoresize.h) == -1) {
+			Verbose("ResizeDisplay: %s\n", AG_GetError());
+		}
+		break;
+	case AG_DRIVER_CLOSE:
+		AG_Terminate(0);
+		break;
+	case AG_DRIVER_EXPOSE:
+		dsw->flags |= AG_DRIVER_SW_REDRAW;
+		break;
+	default:
+		rv = 0;
+		break;
+	}
+	AG_UnlockVFS(&agDrivers);
+
+	return (rv);
+}
+
+/*
+ * Rendering control
+ */
+
+static void
+HEADLESS_BeginRendering(void *_Nonnull obj)
+{
+	/* Nothing to do */
+}
+
+static void
+HEADLESS_RenderWindow(struct ag_window *_Nonnull win)
+{
+	AG_WidgetDraw(win);
+}
+
+static void
+HEADLESS_EndRendering(void *_Nonnull obj)
+{
+	AG_DriverHeadless *hl = obj;
+
+#ifdef AG_DEBUG
+	if (hl->nClipRects != 1)
+		AG_FatalError("Inconsistent PushClipRect() / PopClipRect()");
+#endif
+	hl->nFrames++;
+}
+
+static void
+HEADLESS_FillRect(void *_Nonnull obj, const AG_Rect *_Nonnull r,
+    const AG_Color *_Nonnull c)
+{
+	HEADLESS_DrawRectFilled(obj, r, c);
+}
+
+static void
+HEADLESS_UpdateRegion(void *_Nonnull obj, const AG_Rect *_Nonnull r)
+{
+	/* Nothing to do */
+}
+
+static int
+HEADLESS_SetRefreshRate(void *_Nonnull obj, int fps)
+{
+	AG_DriverSw *dsw = obj;
+
+	if (fps < 1) {
+		AG_SetError("Invalid refresh rate");
+		return (-1);
+	}
+	dsw->rNom = 1000/fps;
+	return (0);
+}
+
+/*
+ * Clipping and blending control (rendering context)
+ */
+
+static void
+HEADLESS_PushClipRect(void *_Nonnull obj, const AG_Rect *_Nonnull r)
+{
+	AG_DriverHeadless *hl = obj;
+	AG_ClipRect *cr, *crPrev;
+
+	hl->clipRects = Realloc(hl->clipRects, (hl->nClipRects+1) *
+	                                       sizeof(AG_ClipRect));
+	crPrev = &hl->clipRects[hl->nClipRects-1];
+	cr = &hl->clipRects[hl->nClipRects++];
+
+	AG_RectIntersect(&cr->r, &crPrev->r, r);
+	hl->s->clipRect = cr->r;
+}
+
+static void
+HEADLESS_PopClipRect(void *_Nonnull obj)
+{
+	AG_DriverHeadless *hl = obj;
+
+#ifdef AG_DEBUG
+	if (hl->nClipRects < 2)
+		AG_FatalError("PopClipRect() without PushClipRect()");
+#endif
+	hl->nClipRects--;
+	hl->s->clipRect = hl->clipRects[hl->nClipRects-1].r;
+}
+
+static void
+HEADLESS_PushBlendingMode(void *_Nonnull drv, AG_AlphaFn fnSrc,
+    AG_AlphaFn fnDst)
+{
+	/* No-op (handle blending on a per-blit basis) */
+}
+static void
+HEADLESS_PopBlendingMode(void *_Nonnull drv)
+{
+	/* No-op (handle blending on a per-blit basis) */
+}
+
+/*
+ * Cursor operations. Cursors are only tracked, never displayed.
+ */
+
+static AG_Cursor *
+HEADLESS_CreateCursor(void *_Nonnull obj, Uint w, Uint h,
+    const Uint8 *_Nonnull data, const Uint8 *_Nonnull mask, int xHot, int yHot)
+{
+	AG_Cursor *ac;
+	Uint size = w*h;
+
+	if ((ac = TryMalloc(sizeof(AG_Cursor))) == NULL) {
+		return (NULL);
+	}
+	AG_CursorInit(ac);
+	if ((ac->data = TryMalloc(size)) == NULL) {
+		free(ac);
+		return (NULL);
+	}
+	if ((ac->mask = TryMalloc(size)) == NULL) {
+		free(ac->data);
+		free(ac);
+		return (NULL);
+	}
+	memcpy(ac->data, data, size);
+	memcpy(ac->mask, mask, size);
+	ac->w = w;
+	ac->h = h;
+	ac->xHot = xHot;
+	ac->yHot = yHot;
+	return (ac);
+}
+
+static void
+HEADLESS_FreeCursor(void *_Nonnull obj, AG_Cursor *_Nonnull ac)
+{
+	AG_Driver *drv = obj;
+
+	if (ac == drv->activeCursor)
+		drv->activeCursor = NULL;
+
+	Free(ac->data);
+	Free(ac->mask);
+	free(ac);
+}
+
+static int
+HEADLESS_SetCursor(void *_Nonnull obj, AG_Cursor *_Nonnull ac)
+{
+	AG_Driver *drv = obj;
+
+	drv->activeCursor = ac;
+	return (0);
+}
+
+static void
+HEADLESS_UnsetCursor(void *_Nonnull obj)
+{
+	AG_Driver *drv = obj;
+
+	drv->activeCursor = TAILQ_FIRST(&drv->cursors);
+}
+
+static int
+HEADLESS_GetCursorVisibility(void *_Nonnull obj)
+{
+	AG_DriverHeadless *hl = obj;
+
+	return (hl->cursorVisible);
+}
+
+static void
+HEADLESS_SetCursorVisibility(void *_Nonnull obj, int flag)
+{
+	AG_DriverHeadless *hl = obj;
+
+	hl->cursorVisible = flag;
+}
+
+/* Initialize the default cursor (at the head of the cursor list). */
+static void
+InitDefaultCursor(AG_Driver *_Nonnull drv)
+{
+	AG_Cursor *ac;
+
+	ac = Malloc(sizeof(AG_Cursor));
+	AG_CursorInit(ac);
+	TAILQ_INSERT_HEAD(&drv->cursors, ac, cursors);
+	drv->nCursors++;
+	drv->activeCursor = ac;
+}
+
+/*
+ * Surface operations (rendering context)
+ */
+
+static void
+HEADLESS_BlitSurface(void *_Nonnull drv, AG_Widget *_Nonnull wid,
+    AG_Surface *_Nonnull s, int x, int y)
+{
+	AG_DriverHeadless *hl = drv;
+
+	AG_SurfaceBlit(s, NULL, hl->s, x,y);
+}
+
+static void
+HEADLESS_BlitSurfaceFrom(void *_Nonnull drv, AG_Widget *_Nonnull wid,
+    int s, const AG_Rect *_Nullable rSrc, int x, int y)
+{
+	AG_DriverHeadless *hl = drv;
+
+	AG_SurfaceBlit(wid->surfaces[s], rSrc, hl->s, x,y);
+}
+
+static void
+HEADLESS_BlitSurfaceGL(void *_Nonnull drv, AG_Widget *_Nonnull wid,
+    AG_Surface *_Nonnull s, float w, float h)
+{
+	/* Not applicable */
+}
+
+static void
+HEADLESS_BlitSurfaceFromGL(void *_Nonnull drv, AG_Widget *_Nonnull wid,
+    int s, float w, float h)
+{
+	/* Not applicable */
+}
+
+static void
+HEADLESS_BlitSurfaceFlippedGL(void *_Nonnull drv, AG_Widget *_Nonnull wid,
+    int s, float w, float h)
+{
+	/* Not applicable */
+}
+
+static int
+HEADLESS_RenderToSurface(void *_Nonnull drv, AG_Widget *_Nonnull wid,
+    AG_Surface *_Nonnull *_Nullable pS)
+{
+	AG_DriverHeadless *hl = drv;
+	AG_Surface *S;
+	AG_Rect sr;
+	int visiblePrev;
+
+	AG_BeginRendering(hl);
+	visiblePrev = wid->window->visible;
+	wid->window->visible = 1;
+	AG_WindowDraw(wid->window);
+	wid->window->visible = visiblePrev;
+	AG_EndRendering(hl);
+
+	sr.x = wid->rView.x1;
+	sr.y = wid->rView.y1;
+	sr.w = wid->w;
+	sr.h = wid->h;
+	S = AG_SurfaceNew(&hl->s->format, wid->w, wid->h, 0);
+	AG_SurfaceBlit(hl->s, &sr, S, 0,0);
+	*pS = S;
+	return (0);
+}
+
+/*
+ * Rendering operations (rendering context)
+ */
+
+/* Return the address of pixel x,y in the display surface. */
+static __inline__ Uint8 *_Nonnull
+PixelAddr(const AG_Surface *_Nonnull S, int x, int y)
+{
+	return (S->pixels + y*S->pitch + (x << 2));
+}
+
+static void
+HEADLESS_PutPixel32(void *_Nonnull obj, int x, int y, Uint32 px)
+{
+	AG_DriverHeadless *hl = obj;
+	AG_Surface *S = hl->s;
+
+	if (AG_SurfaceClipped(S, x,y)) {
+		return;
+	}
+	*(Uint32 *)PixelAddr(S, x,y) = px;
+}
+
+static void
+HEADLESS_PutPixel(void *_Nonnull obj, int x, int y, const AG_Color *_Nonnull c)
+{
+	AG_DriverHeadless *hl = obj;
+
+	HEADLESS_PutPixel32(obj, x,y, AG_MapPixel32(&hl->s->format, c));
+}
+
+static void
+HEADLESS_PutPixelRGB8(void *_Nonnull obj, int x, int y, Uint8 r, Uint8 g,
+    Uint8 b)
+{
+	AG_DriverHeadless *hl = obj;
+	AG_Color c;
+
+	AG_ColorRGB_8(&c, r,g,b);
+	HEADLESS_PutPixel32(obj, x,y, AG_MapPixel32(&hl->s->format, &c));
+}
+
+#if AG_MODEL == AG_LARGE
+static void
+HEADLESS_PutPixel64(void *_Nonnull obj, int x, int y, Uint64 px)
+{
+	AG_Driver *drv = obj;
+	AG_DriverHeadless *hl = obj;
+	Uint16 r,g,b;
+	AG_Color c;
+
+	AG_GetColor64_RGB16(px, drv->videoFmt, &r,&g,&b);
+	AG_ColorRGB_16(&c, r,g,b);
+	HEADLESS_PutPixel32(obj, x,y, AG_MapPixel32(&hl->s->format, &c));
+}
+
+static void
+HEADLESS_PutPixelRGB16(void *_Nonnull obj, int x, int y, Uint16 r, Uint16 g,
+    Uint16 b)
+{
+	AG_DriverHeadless *hl = obj;
+	AG_Color c;
+
+	AG_ColorRGB_16(&c, r,g,b);
+	HEADLESS_PutPixel32(obj, x,y, AG_MapPixel32(&hl->s->format, &c));
+}
+#endif /* AG_LARGE */
+
+static void
+HEADLESS_BlendPixel(void *_Nonnull obj, int x, int y,
+    const AG_Color *_Nonnull c, AG_AlphaFn fnSrc, AG_AlphaFn fnDst)
+{
+	AG_DriverHeadless *hl = obj;
+	AG_Surface *S = hl->s;
+
+	if (AG_SurfaceClipped(S, x,y)) {
+		return;
+	}
+	AG_SurfaceBlend_At(S, PixelAddr(S, x,y), c, fnSrc);
+}
+
+static void
+HEADLESS_DrawLine(void *_Nonnull obj, int x1, int y1, int x2, int y2,
+    const AG_Color *_Nonnull C)
+{
+	AG_DriverHeadless *hl = obj;
+	Uint32 c = AG_MapPixel32(&hl->s->format, C);
+	int dx = abs(x2 - x1), sx = (x1 < x2) ? 1 : -1;
+	int dy = -abs(y2 - y1), sy = (y1 < y2) ? 1 : -1;
+	int e = dx + dy, e2;
+
+	for (;;) {
+		HEADLESS_PutPixel32(obj, x1,y1, c);
+		if (x1 == x2 && y1 == y2) {
+			break;
+		}
+		e2 = e << 1;
+		if (e2 >= dy) { e += dy; x1 += sx; }
+		if (e2 <= dx) { e += dx; y1 += sy; }
+	}
+}
+
+static void
+HEADLESS_DrawLineH(void *_Nonnull obj, int x1, int x2, int y,
+    const AG_Color *_Nonnull C)
+{
+	AG_DriverHeadless *hl = obj;
+	AG_Surface *S = hl->s;
+	const AG_Rect *rd = &S->clipRect;
+	Uint32 *pDst, *pEnd, c;
+
+	if (y < rd->y || y >= rd->y+rd->h) {
+		return;
+	}
+	if (x1 > x2) {
+		int xTmp = x1;
+		x1 = x2;
+		x2 = xTmp;
+	}
+	if (x1 < rd->x) { x1 = rd->x; }
+	if (x2 > rd->x+rd->w) { x2 = rd->x+rd->w; }
+	if (x2 <= x1)
+		return;
+
+	c = AG_MapPixel32(&S->format, C);
+	pDst = (Uint32 *)PixelAddr(S, x1,y);
+	pEnd = pDst + (x2 - x1);
+	while (pDst < pEnd)
+		*pDst++ = c;
+}
+
+static void
+HEADLESS_DrawLineV(void *_Nonnull obj, int x, int y1, int y2,
+    const AG_Color *_Nonnull C)
+{
+	AG_DriverHeadless *hl = obj;
+	AG_Surface *S = hl->s;
+	const AG_Rect *rd = &S->clipRect;
+	Uint8 *pDst, *pEnd;
+	Uint32 c;
+
+	if (x < rd->x || x >= rd->x+rd->w) {
+		return;
+	}
+	if (y1 > y2) {
+		int yTmp = y1;
+		y1 = y2;
+		y2 = yTmp;
+	}
+	if (y1 < rd->y) { y1 = rd->y; }
+	if (y2 > rd->y+rd->h) { y2 = rd->y+rd->h; }
+	if (y2 <= y1)
+		return;
+
+	c = AG_MapPixel32(&S->format, C);
+	pDst = PixelAddr(S, x,y1);
+	pEnd = pDst + (y2 - y1)*S->pitch;
+	while (pDst < pEnd) {
+		*(Uint32 *)pDst = c;
+		pDst += S->pitch;
+	}
+}
+
+static void
+HEADLESS_DrawLineBlended(void *_Nonnull obj, int x1, int y1, int x2, int y2,
+    const AG_Color *_Nonnull c, AG_AlphaFn fnSrc, AG_AlphaFn fnDst)
+{
+	int dx = abs(x2 - x1), sx = (x1 < x2) ? 1 : -1;
+	int dy = -abs(y2 - y1), sy = (y1 < y2) ? 1 : -1;
+	int e = dx + dy, e2;
+
+	for (;;) {
+		HEADLESS_BlendPixel(obj, x1,y1, c, fnSrc, fnDst);
+		if (x1 == x2 && y1 == y2) {
+			break;
+		}
+		e2 = e << 1;
+		if (e2 >= dy) { e += dy; x1 += sx; }
+		if (e2 <= dx) { e += dx; y1 += sy; }
+	}
+}
+
+static void
+HEADLESS_DrawTriangle(void *_Nonnull obj, const AG_Pt *_Nonnull v1,
+    const AG_Pt *_Nonnull v2, const AG_Pt *_Nonnull v3,
+    const AG_Color *_Nonnull c)
+{
+	const AG_Pt *t;
+	int y;
+
+	/* Sort the three vertices by y coordinate ascending. */
+	if (v1->y > v2->y) { t = v1; v1 = v2; v2 = t; }
+	if (v2->y > v3->y) { t = v2; v2 = v3; v3 = t; }
+	if (v1->y > v2->y) { t = v1; v1 = v2; v2 = t; }
+
+	if (v3->y == v1->y) {
+		int xMin = MIN(v1->x, MIN(v2->x, v3->x));
+		int xMax = MAX(v1->x, MAX(v2->x, v3->x));
+
+		HEADLESS_DrawLineH(obj, xMin, xMax+1, v1->y, c);
+		return;
+	}
+	for (y = v1->y; y <= v3->y; y++) {
+		int xa, xb;
+
+		/* Long edge v1-v3 against the short edges v1-v2, v2-v3. */
+		xa = v1->x + (v3->x - v1->x)*(y - v1->y) / (v3->y - v1->y);
+		if (y < v2->y) {
+			xb = v1->x + (v2->x - v1->x)*(y - v1->y) /
+			             (v2->y - v1->y);
+		} else if (v3->y != v2->y) {
+			xb = v2->x + (v3->x - v2->x)*(y - v2->y) /
+			             (v3->y - v2->y);
+		} else {
+			xb = v2->x;
+		}
+		if (xa > xb) {
+			int xTmp = xa;
+			xa = xb;
+			xb = xTmp;
+		}
+		HEADLESS_DrawLineH(obj, xa, xb+1, y, c);
+	}
+}
+
+static void
+HEADLESS_DrawArrow(void *_Nonnull obj, Uint8 angle, int x0, int y0, int h,
+    const AG_Color *_Nonnull C)
+{
+	AG_DriverHeadless *hl = obj;
+	Uint32 c = AG_MapPixel32(&hl->s->format, C);
+	int a = x0 - (h >> 1) + 1;		/* Start of the arrow's axis */
+	int b = a + h-2;			/* End of the arrow's axis */
+	int i, j, s, e;
+
+#ifdef AG_DEBUG
+	if (angle >= 4) { AG_FatalError("Bad angle"); }
+#endif
+	if (angle == 0 || angle == 2) {			/* Up, Down */
+		a = y0 - (h >> 1) + 1;
+		b = a + h-2;
+	}
+	for (i = 0, s = 0, e = 0; i < b-a; i++, s--, e++) {
+		for (j = s; j <= e; j++) {
+			switch (angle) {
+			case 0:
+				HEADLESS_PutPixel32(obj, x0+j, a+i, c);
+				break;
+			case 1:
+				HEADLESS_PutPixel32(obj, b-i, y0+j, c);
+				break;
+			case 2:
+				HEADLESS_PutPixel32(obj, x0+j, b-i, c);
+				break;
+			case 3:
+				HEADLESS_PutPixel32(obj, a+i, y0+j, c);
+				break;
+			}
+		}
+	}
+}
+
+static void
+HEADLESS_DrawBoxRoundedTop(void *_Nonnull obj, const AG_Rect *_Nonnull r,
+    int z, int rad, const AG_Color *_Nonnull c1, const AG_Color *_Nonnull c2,
+    const AG_Color *_Nonnull c3)
+{
+	AG_DriverHeadless *hl = obj;
+	const AG_PixelFormat *pf = &hl->s->format;
+	AG_Rect rd;
+	int rx = r->x;
+	int ry = r->y;
+	int rw = r->w;
+	int rh = r->h;
+	int x2 = rx + rad;
+	int x3 = rx - rad + rw - 1;
+	int y2 = ry + rad;
+	int v, e, u;
+	int x, y, i;
+	Uint32 c[3];
+
+	c[0] = AG_MapPixel32(pf, c1);
+	c[1] = AG_MapPixel32(pf, c2);
+	c[2] = AG_MapPixel32(pf, c3);
+
+	rd.x = x2;					/* Center and top */
+	rd.y = ry;
+	rd.w = rw - (rad << 1);
+	rd.h = rh;
+	HEADLESS_DrawRectFilled(obj, &rd, c1);
+	rd.x = rx;					/* Left */
+	rd.y = y2;
+	rd.w = rad;
+	rd.h = rh - rad;
+	HEADLESS_DrawRectFilled(obj, &rd, c1);
+	rd.x = rx + rw - rad;				/* Right */
+	HEADLESS_DrawRectFilled(obj, &rd, c1);
+
+	/* Left and right lines */
+	HEADLESS_DrawLineV(obj, rx,      y2, ry+rh, c2);
+	HEADLESS_DrawLineV(obj, rx+rw-1, y2, ry+rh, c3);
+
+	/* Top left and top right rounded edges */
+	v = (rad << 1) - 1;
+	e = 0;
+	u = 0;
+	x = 0;
+	y = rad;
+	while (x <= y) {
+		for (i = 0; i < x; i++) {
+			HEADLESS_PutPixel32(obj, x2-i, y2-y, c[0]);
+			HEADLESS_PutPixel32(obj, x3+i, y2-y, c[0]);
+		}
+		for (i = 0; i < y; i++) {
+			HEADLESS_PutPixel32(obj, x2-i, y2-x, c[0]);
+			HEADLESS_PutPixel32(obj, x3+i, y2-x, c[0]);
+		}
+		HEADLESS_PutPixel32(obj, x2-x, y2-y, c[1]);
+		HEADLESS_PutPixel32(obj, x2-y, y2-x, c[1]);
+		HEADLESS_PutPixel32(obj, x3+x, y2-y, c[2]);
+		HEADLESS_PutPixel32(obj, x3+y, y2-x, c[2]);
+		e += u;
+		u += 2;
+		if (v < (e << 1)) {
+			y--;
+			e -= v;
+			v -= 2;
+		}
+		x++;
+	}
+}
+
+static void
+HEADLESS_DrawBoxRounded(void *_Nonnull obj, const AG_Rect *_Nonnull r, int z,
+    int rad, const AG_Color *_Nonnull c1, const AG_Color *_Nonnull c2,
+    const AG_Color *_Nonnull c3)
+{
+	AG_DriverHeadless *hl = obj;
+	const AG_PixelFormat *pf = &hl->s->format;
+	AG_Rect rd;
+	Uint32 c[3];
+	int v, e, u;
+	int x, y, i;
+	int rx = r->x, ry = r->y;
+	int rw = r->w, rh = r->h;
+	int w1 = rw - 1;
+	int x2, y2, x3, y3;
+
+	if (rw < 4 || rh < 4) {
+		return;
+	}
+	if ((rad << 1) > rw || (rad << 1) > rh) {
+		rad = MIN(rw >> 1, rh >> 1);
+	}
+	x2 = rx + rad;
+	y2 = ry + rad;
+	x3 = rx - rad + w1;
+	y3 = ry + rh - rad - 1;
+
+	c[0] = AG_MapPixel32(pf, c1);
+	c[1] = AG_MapPixel32(pf, c2);
+	c[2] = AG_MapPixel32(pf, c3);
+
+	rd.x = x2;					/* Center, top, bottom */
+	rd.y = ry;
+	rd.w = rw - (rad << 1);
+	rd.h = rh;
+	HEADLESS_DrawRectFilled(obj, &rd, c1);
+	rd.x = rx;					/* Left */
+	rd.y = y2;
+	rd.w = rad;
+	rd.h = rh - (rad << 1);
+	HEADLESS_DrawRectFilled(obj, &rd, c1);
+	rd.x = rx + rw - rad;				/* Right */
+	HEADLESS_DrawRectFilled(obj, &rd, c1);
+
+	/* Rounded edges */
+	v = (rad << 1) - 1;
+	e = 0;
+	u = 0;
+	x = 0;
+	y = rad;
+	while (x <= y) {
+		for (i = 0; i < x; i++) {
+			HEADLESS_PutPixel32(obj, x2-i, y2-y, c[0]);
+			HEADLESS_PutPixel32(obj, x3+i, y2-y, c[0]);
+			HEADLESS_PutPixel32(obj, x2-i, y3+y, c[0]);
+			HEADLESS_PutPixel32(obj, x3+i, y3+y, c[0]);
+		}
+		for (i = 0; i < y; i++) {
+			HEADLESS_PutPixel32(obj, x2-i, y2-x, c[0]);
+			HEADLESS_PutPixel32(obj, x3+i, y2-x, c[0]);
+			HEADLESS_PutPixel32(obj, x2-i, y3+x, c[0]);
+			HEADLESS_PutPixel32(obj, x3+i, y3+x, c[0]);
+		}
+		HEADLESS_PutPixel32(obj, x2-x, y2-y, c[1]);
+		HEADLESS_PutPixel32(obj, x2-y, y2-x, c[1]);
+		HEADLESS_PutPixel32(obj, x3+x, y2-y, c[2]);
+		HEADLESS_PutPixel32(obj, x3+y, y2-x, c[2]);
+		HEADLESS_PutPixel32(obj, x2-x, y3+y, c[1]);
+		HEADLESS_PutPixel32(obj, x2-y, y3+x, c[1]);
+		HEADLESS_PutPixel32(obj, x3+x, y3+y, c[2]);
+		HEADLESS_PutPixel32(obj, x3+y, y3+x, c[2]);
+		e += u;
+		u += 2;
+		if (v < (e << 1)) {
+			y--;
+			e -= v;
+			v -= 2;
+		}
+		x++;
+	}
+
+	/* Contour lines */
+	HEADLESS_DrawLineH(obj, x2,    x3+1, ry,      c2);
+	HEADLESS_DrawLineH(obj, x2,    x3+1, ry+rh-1, c3);
+	HEADLESS_DrawLineV(obj, rx,    y2,   y3+1,    c2);
+	HEADLESS_DrawLineV(obj, rx+w1, y2,   y3+1,    c3);
+}
+
+static void
+HEADLESS_DrawCircle(void *_Nonnull obj, int x1, int y1, int radius,
+    const AG_Color *_Nonnull C)
+{
+	AG_DriverHeadless *hl = obj;
+	Uint32 c = AG_MapPixel32(&hl->s->format, C);
+	int v = (radius << 1) - 1;
+	int e = 0, u = 1;
+	int x = 0, y = radius;
+
+	while (x < y) {
+		HEADLESS_PutPixel32(obj, x1+x, y1+y, c);
+		HEADLESS_PutPixel32(obj, x1+x, y1-y, c);
+		HEADLESS_PutPixel32(obj, x1-x, y1+y, c);
+		HEADLESS_PutPixel32(obj, x1-x, y1-y, c);
+		e += u;
+		u += 2;
+		if (v < (e << 1)) {
+			y--;
+			e -= v;
+			v -= 2;
+		}
+		x++;
+		HEADLESS_PutPixel32(obj, x1+y, y1+x, c);
+		HEADLESS_PutPixel32(obj, x1+y, y1-x, c);
+		HEADLESS_PutPixel32(obj, x1-y, y1+x, c);
+		HEADLESS_PutPixel32(obj, x1-y, y1-x, c);
+	}
+	HEADLESS_PutPixel32(obj, x1-radius, y1, c);
+	HEADLESS_PutPixel32(obj, x1+radius, y1, c);
+}
+
+static void
+HEADLESS_DrawCircleFilled(void *_Nonnull obj, int x1, int y1, int radius,
+    const AG_Color *_Nonnull c)
+{
+	int v = (radius << 1) - 1;
+	int e = 0, u = 1;
+	int x = 0, y = radius;
+
+	while (x < y) {
+		HEADLESS_DrawLineV(obj, x1+x, y1-y, y1+y, c);
+		HEADLESS_DrawLineV(obj, x1-x, y1-y, y1+y, c);
+		e += u;
+		u += 2;
+		if (v < (e << 1)) {
+			y--;
+			e -= v;
+			v -= 2;
+		}
+		x++;
+		HEADLESS_DrawLineV(obj, x1+y, y1-x, y1+x, c);
+		HEADLESS_DrawLineV(obj, x1-y, y1-x, y1+x, c);
+	}
+}
+
+static void
+HEADLESS_DrawRectFilled(void *_Nonnull obj, const AG_Rect *_Nonnull r,
+    const AG_Color *_Nonnull C)
+{
+	AG_DriverHeadless *hl = obj;
+	AG_Surface *S = hl->s;
+	AG_Rect rd;
+	Uint8 *pRow;
+	Uint32 c;
+	int x, y;
+
+	if (!AG_RectIntersect(&rd, &S->clipRect, r)) {
+		return;
+	}
+	c = AG_MapPixel32(&S->format, C);
+	pRow = PixelAddr(S, rd.x, rd.y);
+	for (y = 0; y < rd.h; y++) {
+		Uint32 *pDst = (Uint32 *)pRow;
+
+		for (x = 0; x < rd.w; x++) {
+			*pDst++ = c;
+		}
+		pRow += S->pitch;
+	}
+}
+
+static void
+HEADLESS_DrawRectBlended(void *_Nonnull obj, const AG_Rect *_Nonnull r,
+    const AG_Color *_Nonnull c, AG_AlphaFn fnSrc, AG_AlphaFn fnDst)
+{
+	AG_DriverHeadless *hl = obj;
+	AG_Surface *S = hl->s;
+	AG_Rect rd;
+	Uint8 *pRow;
+	int x, y;
+
+	if (!AG_RectIntersect(&rd, &S->clipRect, r)) {
+		return;
+	}
+	pRow = PixelAddr(S, rd.x, rd.y);
+	for (y = 0; y < rd.h; y++) {
+		Uint8 *pDst = pRow;
+
+		for (x = 0; x < rd.w; x++) {
+			AG_SurfaceBlend_At(S, pDst, c, fnSrc);
+			pDst += 4;
+		}
+		pRow += S->pitch;
+	}
+}
+
+static void
+HEADLESS_DrawRectDithered(void *_Nonnull obj, const AG_Rect *_Nonnull r,
+    const AG_Color *_Nonnull C)
+{
+	AG_DriverHeadless *hl = obj;
+	Uint32 c = AG_MapPixel32(&hl->s->format, C);
+	int ry = r->y;
+	int rx = r->x;
+	int x2 = rx + r->w - 2;
+	int y2 = ry + r->h - 2;
+	int x, y;
+	int flag = 0;
+
+	for (y = ry; y < y2; y++) {
+		flag = !flag;
+		for (x = rx+1+flag; x < x2; x+=2)
+			HEADLESS_PutPixel32(obj, x,y, c);
+	}
+}
+
+static void
+HEADLESS_UpdateGlyph(void *_Nonnull drv, AG_Glyph *_Nonnull gl)
+{
+	/* Nothing to do */
+}
+
+static void
+HEADLESS_DrawGlyph(void *_Nonnull drv, const AG_Glyph *_Nonnull gl, int x,
+    int y)
+{
+	AG_DriverHeadless *hl = drv;
+
+	AG_SurfaceBlit(gl->su, NULL, hl->s, x,y);
+}
+
+/* Initialize the clipping rectangle stack. */
+static int
+InitClipRects(AG_DriverHeadless *_Nonnull hl, int wView, int hView)
+{
+	AG_ClipRect *cr;
+
+	/* Rectangle 0 always covers the whole view. */
+	if ((hl->clipRects = TryMalloc(sizeof(AG_ClipRect))) == NULL) {
+		return (-1);
+	}
+	cr = &hl->clipRects[0];
+	cr->r.x = 0;
+	cr->r.y = 0;
+	cr->r.w = wView;
+	cr->r.h = hView;
+	hl->nClipRects = 1;
+	return (0);
+}
+
+/*
+ * Single-display specific operations.
+ */
+
+/* Apply the display settings and options of the driver instance. */
+static void
+GetPrefDisplaySettings(AG_Driver *_Nonnull drv, Uint *_Nonnull w,
+    Uint *_Nonnull h)
+{
+	AG_DriverSw *dsw = (AG_DriverSw *)drv;
+	char buf[16];
+
+	if (*w == 0) {
+		if (AG_Defined(drv, "width")) {
+			AG_GetString(drv, "width", buf, sizeof(buf));
+			*w = (Uint)atoi(buf);
+		}
+		if (*w == 0) { *w = 640; }
+	}
+	if (*h == 0) {
+		if (AG_Defined(drv, "height")) {
+			AG_GetString(drv, "height", buf, sizeof(buf));
+			*h = (Uint)atoi(buf);
+		}
+		if (*h == 0) { *h = 480; }
+	}
+	if (AG_Defined(drv, "fpsMax")) {
+		Uint v;
+
+		AG_GetString(drv, "fpsMax", buf, sizeof(buf));
+		if ((v = (Uint)atoi(buf)) > 0)
+			dsw->rNom = 1000/v;
+	}
+	if (AG_Defined(drv, "bgColor")) {
+		AG_ColorFromString(&dsw->bgColor, AG_GetStringP(drv,"bgColor"),
+		    NULL);
+	}
+	if (AG_Defined(drv, "bgPopup"))
+		dsw->flags |= AG_DRIVER_SW_BGPOPUP;
+}
+
+/* Use S as the display surface and initialize the rendering state. */
+static int
+InitDisplay(AG_DriverHeadless *_Nonnull hl, AG_Surface *_Nonnull S)
+{
+	AG_Driver *drv = AGDRIVER(hl);
+	AG_DriverSw *dsw = AGDRIVER_SW(hl);
+
+	if (S->format.BitsPerPixel != 32) {
+		AG_SetError("Headless display must be 32-bpp (not %d)",
+		    S->format.BitsPerPixel);
+		return (-1);
+	}
+	if ((drv->videoFmt = AG_PixelFormatDup(&S->format)) == NULL) {
+		return (-1);
+	}
+	hl->s = S;
+	dsw->w = S->w;
+	dsw->h = S->h;
+	dsw->depth = 32;
+
+	if (InitClipRects(hl, dsw->w, dsw->h) == -1) {
+		AG_PixelFormatFree(drv->videoFmt);
+		free(drv->videoFmt);
+		drv->videoFmt = NULL;
+		return (-1);
+	}
+	S->clipRect = hl->clipRects[0].r;
+
+	/* Create the cursors. */
+	InitDefaultCursor(drv);
+	AG_InitStockCursors(drv);
+	return (0);
+}
+
+static int
+HEADLESS_OpenVideo(void *_Nonnull obj, Uint w, Uint h, int depth, Uint flags)
+{
+	AG_DriverHeadless *hl = obj;
+	AG_DriverSw *dsw = obj;
+	AG_Surface *S;
+
+	if (flags & AG_VIDEO_OVERLAY)
+		dsw->flags |= AG_DRIVER_SW_OVERLAY;
+	if (flags & AG_VIDEO_BGPOPUPMENU)
+		dsw->flags |= AG_DRIVER_SW_BGPOPUP;
+
+	GetPrefDisplaySettings(AGDRIVER(hl), &w, &h);
+	Verbose(_("Headless: Setting mode %ux%u (32 bpp)\n"), w, h);
+
+	S = AG_SurfaceRGB(w, h, 32, 0,
+#if AG_BYTEORDER == AG_BIG_ENDIAN
+	    0xff000000, 0x00ff0000, 0x0000ff00
+#else
+	    0x000000ff, 0x0000ff00, 0x00ff0000
+#endif
+	);
+	if (InitDisplay(hl, S) == -1) {
+		AG_SurfaceFree(S);
+		hl->s = NULL;
+		return (-1);
+	}
+	HEADLESS_DrawRectFilled(hl, &hl->clipRects[0].r, &dsw->bgColor);
+	return (0);
+}
+
+static int
+HEADLESS_OpenVideoContext(void *_Nonnull obj, void *_Nonnull ctx, Uint flags)
+{
+	AG_DriverHeadless *hl = obj;
+	AG_DriverSw *dsw = obj;
+
+	if (flags & AG_VIDEO_OVERLAY)
+		dsw->flags |= AG_DRIVER_SW_OVERLAY;
+	if (flags & AG_VIDEO_BGPOPUPMENU)
+		dsw->flags |= AG_DRIVER_SW_BGPOPUP;
+
+	/* Render into the given surface, which remains owned by the caller. */
+	if (InitDisplay(hl, (AG_Surface *)ctx) == -1) {
+		hl->s = NULL;
+		return (-1);
+	}
+	hl->extSurface = 1;
+	return (0);
+}
+
+static int
+HEADLESS_SetVideoContext(void *_Nonnull obj, void *_Nonnull pSurface)
+{
+	AG_DriverHeadless *hl = obj;
+	AG_DriverSw *dsw = obj;
+	AG_Surface *S = pSurface;
+	AG_ClipRect *cr0;
+
+	if (S->format.BitsPerPixel != 32) {
+		AG_SetError("Headless display must be 32-bpp (not %d)",
+		    S->format.BitsPerPixel);
+		return (-1);
+	}
+	if (hl->s != NULL && !hl->extSurface)
+		AG_SurfaceFree(hl->s);
+
+	hl->s = S;
+	hl->extSurface = 1;
+	dsw->w = S->w;
+	dsw->h = S->h;
+
+	/* Update clipping rectangle 0. */
+	cr0 = &hl->clipRects[0];
+	cr0->r.w = S->w;
+	cr0->r.h = S->h;
+	S->clipRect = cr0->r;
+	return (0);
+}
+
+static void
+HEADLESS_CloseVideo(void *_Nonnull obj)
+{
+	AG_DriverHeadless *hl = obj;
+
+	if (hl->s != NULL && !hl->extSurface) {
+		AG_SurfaceFree(hl->s);
+	}
+	hl->s = NULL;
+}
+
+static int
+HEADLESS_VideoResize(void *_Nonnull obj, Uint w, Uint h)
+{
+	AG_DriverHeadless *hl = obj;
+	AG_DriverSw *dsw = obj;
+	AG_ClipRect *cr0;
+
+	if (AG_SurfaceResize(hl->s, w, h) == -1) {
+		return (-1);
+	}
+	dsw->w = w;
+	dsw->h = h;
+
+	/* Update clipping rectangle 0. */
+	cr0 = &hl->clipRects[0];
+	cr0->r.w = w;
+	cr0->r.h = h;
+	hl->s->clipRect = cr0->r;
+
+	/* Clear the background. */
+	if (!(dsw->flags & AG_DRIVER_SW_OVERLAY))
+		HEADLESS_DrawRectFilled(hl, &cr0->r, &dsw->bgColor);
+
+	return (0);
+}
+
+static AG_Surface *
+HEADLESS_VideoCapture(void *_Nonnull obj)
+{
+	AG_DriverHeadless *hl = obj;
+
+	return AG_SurfaceDup(hl->s);
+}
+
+static void
+HEADLESS_VideoClear(void *_Nonnull obj, const AG_Color *_Nonnull c)
+{
+	AG_DriverHeadless *hl = obj;
+
+	HEADLESS_DrawRectFilled(hl, &hl->clipRects[0].r, c);
+}
+
+/*
+ * Public interface
+ */
+
+/* Queue an input event for processing by the event loop. */
+void
+AG_HeadlessPostEvent(void *obj, const AG_DriverEvent *dev)
+{
+	AG_DriverHeadless *hl = obj;
+	AG_DriverEvent *devNew;
+
+	devNew = Malloc(sizeof(AG_DriverEvent));
+	memcpy(devNew, dev, sizeof(AG_DriverEvent));
+	devNew->win = NULL;
+
+	AG_MutexLock(&hl->lock);
+	TAILQ_INSERT_TAIL(&hl->events, devNew, events);
+	AG_MutexUnlock(&hl->lock);
+}
+
+/* Queue a mouse motion event. */
+void
+AG_HeadlessMouseMotion(void *obj, int x, int y)
+{
+	AG_DriverEvent dev;
+
+	dev.type = AG_DRIVER_MOUSE_MOTION;
+	dev.data.motion.x = x;
+	dev.data.motion.y = y;
+	AG_HeadlessPostEvent(obj, &dev);
+}
+
+/* Queue a mouse button press or release event. */
+void
+AG_HeadlessMouseButton(void *obj, AG_MouseButton which,
+    AG_MouseButtonAction action, int x, int y)
+{
+	AG_DriverEvent dev;
+
+	dev.type = (action == AG_BUTTON_PRESSED) ? AG_DRIVER_MOUSE_BUTTON_DOWN :
+	                                           AG_DRIVER_MOUSE_BUTTON_UP;
+	dev.data.button.which = which;
+	dev.data.button.x = x;
+	dev.data.button.y = y;
+	AG_HeadlessPostEvent(obj, &dev);
+}
+
+/* Queue a key press or release event. */
+void
+AG_HeadlessKey(void *obj, AG_KeySym ks, AG_Char ch, AG_KeyboardAction action)
+{
+	AG_DriverEvent dev;
+
+	dev.type = (action == AG_KEY_PRESSED) ? AG_DRIVER_KEY_DOWN :
+	                                        AG_DRIVER_KEY_UP;
+	dev.data.key.ks = ks;
+	dev.data.key.ucs = (Uint32)ch;
+	AG_HeadlessPostEvent(obj, &dev);
+}
+
+/*
+ * Process all queued input events, then redraw every window into the
+ * display surface, regardless of the refresh rate. This allows frames to
+ * be produced deterministically without running AG_EventLoop().
+ */
+void
+AG_HeadlessRender(void *obj)
+{
+	AG_Driver *drv = obj;
+	AG_DriverEvent dev;
+	AG_Window *win;
+
+	while (HEADLESS_GetNextEvent(drv, &dev) == 1) {
+		(void)HEADLESS_ProcessEvent(drv, &dev);
+	}
+	AG_WindowProcessQueued();
+
+	AG_LockVFS(&agDrivers);
+	AG_BeginRendering(drv);
+	AG_FOREACH_WINDOW(win, drv) {
+		AG_ObjectLock(win);
+		AG_WindowDraw(win);
+		AG_ObjectUnlock(win);
+	}
+	AG_EndRendering(drv);
+	AG_UnlockVFS(&agDrivers);
+}
+
+AG_DriverSwClass agDriverHeadless = {
+	{
+		{
+			"AG_Driver:AG_DriverSw:AG_DriverHeadless",
+			sizeof(AG_DriverHeadless),
+			{ 1,6 },
+			Init,
+			NULL,		/* reset */
+			Destroy,
+			NULL,		/* load */
+			NULL,		/* save */
+			NULL,		/* edit */
+		},
+		"headless",
+		AG_FRAMEBUFFER,
+		AG_WM_SINGLE,
+		AG_DRIVER_NOAUTO,
+		HEADLESS_Open,
+		HEADLESS_Close,
+		HEADLESS_GetDisplaySize,
+		HEADLESS_BeginEventProcessing,
+		HEADLESS_PendingEvents,
+		HEADLESS_GetNextEvent,
+		HEADLESS_ProcessEvent,
+		NULL,				/* genericEventLoop */
+		NULL,				/* endEventProcessing */
+		NULL,				/* terminate */
+		HEADLESS_BeginRendering,
+		HEADLESS_RenderWindow,
+		HEADLESS_EndRendering,
+		HEADLESS_FillRect,
+		HEADLESS_UpdateRegion,
+		NULL,				/* uploadTexture */
+		NULL,				/* updateTexture */
+		NULL,				/* deleteTexture */
+		HEADLESS_SetRefreshRate,
+		HEADLESS_PushClipRect,
+		HEADLESS_PopClipRect,
+		HEADLESS_PushBlendingMode,
+		HEADLESS_PopBlendingMode,
+		HEADLESS_CreateCursor,
+		HEADLESS_FreeCursor,
+		HEADLESS_SetCursor,
+		HEADLESS_UnsetCursor,
+		HEADLESS_GetCursorVisibility,
+		HEADLESS_SetCursorVisibility,
+		HEADLESS_BlitSurface,
+		HEADLESS_BlitSurfaceFrom,
+		HEADLESS_BlitSurfaceGL,
+		HEADLESS_BlitSurfaceFromGL,
+		HEADLESS_BlitSurfaceFlippedGL,
+		NULL,				/* backupSurfaces */
+		NULL,				/* restoreSurfaces */
+		HEADLESS_RenderToSurface,
+		HEADLESS_PutPixel,
+		HEADLESS_PutPixel32,
+		HEADLESS_PutPixelRGB8,
+#if AG_MODEL == AG_LARGE
+		HEADLESS_PutPixel64,
+		HEADLESS_PutPixelRGB16,
+#endif
+		HEADLESS_BlendPixel,
+		HEADLESS_DrawLine,
+		HEADLESS_DrawLineH,
+		HEADLESS_DrawLineV,
+		HEADLESS_DrawLineBlended,
+		HEADLESS_DrawTriangle,
+		HEADLESS_DrawArrow,
+		HEADLESS_DrawBoxRounded,
+		HEADLESS_DrawBoxRoundedTop,
+		HEADLESS_DrawCircle,
+		HEADLESS_DrawCircleFilled,
+		HEADLESS_DrawRectFilled,
+		HEADLESS_DrawRectBlended,
+		HEADLESS_DrawRectDithered,
+		HEADLESS_UpdateGlyph,
+		HEADLESS_DrawGlyph,
+		NULL				/* deleteList */
+	},
+	0,
+	HEADLESS_OpenVideo,
+	HEADLESS_OpenVideoContext,
+	HEADLESS_SetVideoContext,
+	HEADLESS_CloseVideo,
+	HEADLESS_VideoResize,
+	HEADLESS_VideoCapture,
+	HEADLESS_VideoClear
+};
@@ -0,0 +1,37 @@
+/*	Public domain	*/
+/*
+ * Headless driver: renders to an offscreen surface in memory.
+ */
+
+#ifndef _AGAR_GUI_DRV_HEADLESS_H_
+#define _AGAR_GUI_DRV_HEADLESS_H_
+
+#include <agar/gui/drv.h>
+#include <agar/gui/begin.h>
+
+typedef struct ag_driver_headless {
+	struct ag_driver_sw _inherit;
+
+	AG_Surface *_Nullable s;		/* Display surface */
+	int extSurface;			/* Surface is owned by the caller */
+	AG_ClipRect *_Nullable clipRects;	/* Clipping rectangle stack */
+	Uint                  nClipRects;
+	_Nonnull_Mutex AG_Mutex lock;		/* Lock on event queue */
+	AG_DriverEventQ events;			/* Injected input events */
+	Uint nFrames;				/* Frames rendered */
+	int cursorVisible;			/* Cursor visibility flag */
+} AG_DriverHeadless;
+
+__BEGIN_DECLS
+extern AG_DriverSwClass agDriverHeadless;
+
+void AG_HeadlessPostEvent(void *_Nonnull, const AG_DriverEvent *_Nonnull);
+void AG_HeadlessMouseMotion(void *_Nonnull, int,int);
+void AG_HeadlessMouseButton(void *_Nonnull, AG_MouseButton,
+                            AG_MouseButtonAction, int,int);
+void AG_HeadlessKey(void *_Nonnull, AG_KeySym, AG_Char, AG_KeyboardAction);
+void AG_HeadlessRender(void *_Nonnull);
+__END_DECLS
+
+#include <agar/gui/close.h>
+#endif /* _AGAR_GUI_DRV_HEADLESS_H_ */
@@ -835,134 +835,6 @@ AG_SDL_GetNextEvent(void *obj, AG_DriverEvent *dev)
 	return (1);
 }
 
-/* Test if the given coordinates overlap a window resize control. */
-static __inline__ int
-GenericMouseOverCtrl(AG_Window *_Nonnull win, int x, int y)
-{
-	if ((y - WIDGET(win)->y) > (HEIGHT(win) - win->wBorderBot)) {
-		int xRel = x - WIDGET(win)->x;
-	    	if (xRel < win->wResizeCtrl) {
-			return (AG_WINOP_LRESIZE);
-		} else if (xRel > (WIDTH(win) - win->wResizeCtrl)) {
-			return (AG_WINOP_RRESIZE);
-		} else if ((win->flags & AG_WINDOW_NOVRESIZE) == 0) {
-			return (AG_WINOP_HRESIZE);
-		}
-	}
-	return (AG_WINOP_NONE);
-}
-
-/*
- * Process an input device event.
- * The agDrivers VFS must be locked.
- * TODO: generalize this code to SW drivers.
- */
-static int
-ProcessInputEvent(AG_Driver *_Nonnull drv, AG_DriverEvent *_Nonnull dev)
-{
-	AG_DriverSw *dsw = (AG_DriverSw *)drv;
-	AG_Window *win, *winTop = NULL;
-
-	if (dev->type == AG_DRIVER_MOUSE_BUTTON_UP) {
-		dsw->winop = AG_WINOP_NONE;
-		dsw->winSelected = NULL;
-	}
-	AG_FOREACH_WINDOW_REVERSE(win, dsw) {
-		AG_ObjectLock(win);
-
-		/* XXX TODO move invisible windows to different tailq! */
-		if (!win->visible) {
-			AG_ObjectUnlock(win);
-			continue;
-		}
-		switch (dev->type) {
-		case AG_DRIVER_MOUSE_MOTION:
-			if (dsw->winop != AG_WINOP_NONE) {
-				if (dsw->winSelected != win) {
-					AG_ObjectUnlock(win);
-					continue;
-				}
-				AG_WM_MouseMotion(dsw, win,
-				    drv->mouse->xRel,
-				    drv->mouse->yRel);
-			}
-			AG_ProcessMouseMotion(win,
-			    dev->data.motion.x, dev->data.motion.y,
-			    drv->mouse->xRel, drv->mouse->yRel,
-			    drv->mouse->btnState);
-			if (winTop == NULL &&
-			    AG_WidgetArea(win, dev->data.motion.x, dev->data.motion.y)) {
-				winTop = win;
-				AG_MouseCursorUpdate(win,
-				    dev->data.motion.x,
-				    dev->data.motion.y);
-			}
-			break;
-		case AG_DRIVER_MOUSE_BUTTON_UP:
-			AG_ProcessMouseButtonUp(win,
-			    dev->data.button.x, dev->data.button.y,
-			    dev->data.button.which);
-			if (agWindowToFocus != NULL ||
-			    !TAILQ_EMPTY(&agWindowDetachQ)) {
-				AG_ObjectUnlock(win);
-				return (1);
-			}
-			break;
-		case AG_DRIVER_MOUSE_BUTTON_DOWN:
-			if (!AG_WidgetArea(win, dev->data.button.x,
-			    dev->data.button.y)) {
-				AG_ObjectUnlock(win);
-				continue;
-			}
-			if (win != agWindowFocused &&
-			    !(win->flags & AG_WINDOW_DENYFOCUS)) {
-				agWindowToFocus = win;
-			}
-			if (win->wBorderBot > 0 &&
-			    !(win->flags & AG_WINDOW_NORESIZE)) {
-				dsw->winop = GenericMouseOverCtrl(win,
-				    dev->data.button.x, dev->data.button.y);
-				if (dsw->winop != AG_WINOP_NONE) {
-					win->dirty = 1;
-					dsw->winSelected = win;
-					AG_ObjectUnlock(win);
-					return (1);
-				}
-			}
-			AG_ProcessMouseButtonDown(win,
-			    dev->data.button.x, dev->data.button.y,
-			    dev->data.button.which);
-			AG_ObjectUnlock(win);
-			return (1);
-		case AG_DRIVER_KEY_UP:
-			if (dsw->winLastKeydown != NULL &&
-			    dsw->winLastKeydown != win) {
-				/*
-				 * Key was initially pressed while another
-				 * window was holding focus, ignore.
-				 */
-				dsw->winLastKeydown = NULL;
-				break;
-			}
-			AG_ProcessKey(drv->kbd, win, AG_KEY_RELEASED,
-			    dev->data.key.ks, dev->data.key.ucs);
-			break;
-		case AG_DRIVER_KEY_DOWN:
-			AG_ProcessKey(drv->kbd, win, AG_KEY_PRESSED,
-			    dev->data.key.ks, dev->data.key.ucs);
-			break;
-		default:
-			break;
-		}
-		AG_ObjectUnlock(win);
-	}
-	if (dev->type == AG_DRIVER_MOUSE_MOTION &&
-	    winTop == NULL) {
-		AGDRIVER_CLASS(drv)->unsetCursor(drv);
-	}
-	return (0);
-}
-
 /* Standard processEvent() method for SDL drivers. */
 int
 AG_SDL_ProcessEvent(void *obj, AG_DriverEvent *dev)
@@ -974,13 +846,13 @@ AG_SDL_ProcessEvent(void *obj, AG_DriverEvent *dev)
 	AG_LockVFS(&agDrivers);
 	switch (dev->type) {
 	case AG_DRIVER_MOUSE_MOTION:
-		rv = ProcessInputEvent(drv, dev);
+		rv = AG_WM_ProcessInput(dsw, dev);
 		break;
 	case AG_DRIVER_MOUSE_BUTTON_UP:
-		rv = ProcessInputEvent(drv, dev);
+		rv = AG_WM_ProcessInput(dsw, dev);
 		break;
 	case AG_DRIVER_MOUSE_BUTTON_DOWN:
-		rv = ProcessInputEvent(drv, dev);
+		rv = AG_WM_ProcessInput(dsw, dev);
 		if (rv == 0 &&
 		    (dsw->flags & AG_DRIVER_SW_BGPOPUP) &&
 		    (dev->data.button.which == AG_MOUSE_MIDDLE ||
@@ -991,13 +863,13 @@ AG_SDL_ProcessEvent(void *obj, AG_DriverEvent *dev)
 		break;
 	case AG_DRIVER_KEY_DOWN:
 		if (AG_ExecGlobalKeys(dev->data.key.ks, drv->kbd->modState) == 0) {
-			rv = ProcessInputEvent(drv, dev);
+			rv = AG_WM_ProcessInput(dsw, dev);
 		} else {
 			rv = 1;
 		}
 		break;
 	case AG_DRIVER_KEY_UP:
-		rv = ProcessInputEvent(drv, dev);
+		rv = AG_WM_ProcessInput(dsw, dev);
 		break;
 	case AG_DRIVER_VIDEORESIZE:
 		if (AG_ResizeDisplay(dev->data.videoresize.w,
@@ -634,6 +634,134 @@ AG_WM_GetPrefPosition(AG_Window *win, int *x, int *y, int w, int h)
 	}
 }
 
+/* Test if the given coordinates overlap a window resize control. */
+static __inline__ int
+GenericMouseOverCtrl(AG_Window *_Nonnull win, int x, int y)
+{
+	if ((y - WIDGET(win)->y) > (HEIGHT(win) - win->wBorderBot)) {
+		int xRel = x - WIDGET(win)->x;
+	    	if (xRel < win->wResizeCtrl) {
+			return (AG_WINOP_LRESIZE);
+		} else if (xRel > (WIDTH(win) - win->wResizeCtrl)) {
+			return (AG_WINOP_RRESIZE);
+		} else if ((win->flags & AG_WINDOW_NOVRESIZE) == 0) {
+			return (AG_WINOP_HRESIZE);
+		}
+	}
+	return (AG_WINOP_NONE);
+}
+
+/*
+ * Generic processing of an input device event for single-window drivers.
+ * Return 1 if the event was handled by a window, 0 otherwise.
+ * The agDrivers VFS must be locked.
+ */
+int
+AG_WM_ProcessInput(AG_DriverSw *dsw, AG_DriverEvent *dev)
+{
+	AG_Driver *drv = AGDRIVER(dsw);
+	AG_Window *win, *winTop = NULL;
+
+	if (dev->type == AG_DRIVER_MOUSE_BUTTON_UP) {
+		dsw->winop = AG_WINOP_NONE;
+		dsw->winSelected = NULL;
+	}
+	AG_FOREACH_WINDOW_REVERSE(win, dsw) {
+		AG_ObjectLock(win);
+
+		/* XXX TODO move invisible windows to different tailq! */
+		if (!win->visible) {
+			AG_ObjectUnlock(win);
+			continue;
+		}
+		switch (dev->type) {
+		case AG_DRIVER_MOUSE_MOTION:
+			if (dsw->winop != AG_WINOP_NONE) {
+				if (dsw->winSelected != win) {
+					AG_ObjectUnlock(win);
+					continue;
+				}
+				AG_WM_MouseMotion(dsw, win,
+				    drv->mouse->xRel,
+				    drv->mouse->yRel);
+			}
+			AG_ProcessMouseMotion(win,
+			    dev->data.motion.x, dev->data.motion.y,
+			    drv->mouse->xRel, drv->mouse->yRel,
+			    drv->mouse->btnState);
+			if (winTop == NULL &&
+			    AG_WidgetArea(win, dev->data.motion.x, dev->data.motion.y)) {
+				winTop = win;
+				AG_MouseCursorUpdate(win,
+				    dev->data.motion.x,
+				    dev->data.motion.y);
+			}
+			break;
+		case AG_DRIVER_MOUSE_BUTTON_UP:
+			AG_ProcessMouseButtonUp(win,
+			    dev->data.button.x, dev->data.button.y,
+			    dev->data.button.which);
+			if (agWindowToFocus != NULL ||
+			    !TAILQ_EMPTY(&agWindowDetachQ)) {
+				AG_ObjectUnlock(win);
+				return (1);
+			}
+			break;
+		case AG_DRIVER_MOUSE_BUTTON_DOWN:
+			if (!AG_WidgetArea(win, dev->data.button.x,
+			    dev->data.button.y)) {
+				AG_ObjectUnlock(win);
+				continue;
+			}
+			if (win != agWindowFocused &&
+			    !(win->flags & AG_WINDOW_DENYFOCUS)) {
+				agWindowToFocus = win;
+			}
+			if (win->wBorderBot > 0 &&
+			    !(win->flags & AG_WINDOW_NORESIZE)) {
+				dsw->winop = GenericMouseOverCtrl(win,
+				    dev->data.button.x, dev->data.button.y);
+				if (dsw->winop != AG_WINOP_NONE) {
+					win->dirty = 1;
+					dsw->winSelected = win;
+					AG_ObjectUnlock(win);
+					return (1);
+				}
+			}
+			AG_ProcessMouseButtonDown(win,
+			    dev->data.button.x, dev->data.button.y,
+			    dev->data.button.which);
+			AG_ObjectUnlock(win);
+			return (1);
+		case AG_DRIVER_KEY_UP:
+			if (dsw->winLastKeydown != NULL &&
+			    dsw->winLastKeydown != win) {
+				/*
+				 * Key was initially pressed while another
+				 * window was holding focus, ignore.
+				 */
+				dsw->winLastKeydown = NULL;
+				break;
+			}
+			AG_ProcessKey(drv->kbd, win, AG_KEY_RELEASED,
+			    dev->data.key.ks, dev->data.key.ucs);
+			break;
+		case AG_DRIVER_KEY_DOWN:
+			AG_ProcessKey(drv->kbd, win, AG_KEY_PRESSED,
+			    dev->data.key.ks, dev->data.key.ucs);
+			break;
+		default:
+			break;
+		}
+		AG_ObjectUnlock(win);
+	}
+	if (dev->type == AG_DRIVER_MOUSE_MOTION &&
+	    winTop == NULL) {
+		AGDRIVER_CLASS(drv)->unsetCursor(drv);
+	}
+	return (0);
+}
+
 /* Blank the display background. */
 void
 AG_ClearBackground(void)
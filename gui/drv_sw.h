@@ -103,6 +103,7 @@ void AG_WM_MoveBegin(struct ag_window *_Nonnull);
 void AG_WM_MoveEnd(struct ag_window *_Nonnull);
 void AG_WM_MouseMotion(AG_DriverSw *_Nonnull, struct ag_window *_Nonnull,
                        int,int);
+int  AG_WM_ProcessInput(AG_DriverSw *_Nonnull, AG_DriverEvent *_Nonnull);
 
 void AG_ClearBackground(void);
 int  AG_SetRefreshRate(int);
@@ -50,25 +50,110 @@
 AG_EditableClipboard agEditableClipbrd;		/* For Copy/Cut/Paste */
 AG_EditableClipboard agEditableKillring;	/* For Emacs-style Kill/Yank */
 
-/*
- * Return a new working buffer. The variable is returned locked; the caller
- * should invoke ReleaseBuffer() after use.
- */
-static __inline__ AG_EditableBuffer *_Nullable
-GetBuffer(AG_Editable *_Nonnull ed)
+static AG_Size OffsetUTF8(AG_Editable *_Nonnull, AG_EditableBuffer *_Nonnull,
+                          AG_Size);
+
+/* Invalidate the working buffer and the line index. */
+static __inline__ void
+ClearBuffer(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf)
 {
-	AG_EditableBuffer *buf;
+	AG_Free(buf->s);
+	buf->s = NULL;
+	buf->len = 0;
+	buf->maxLen = 0;
+	ed->syncTxt = NULL;
+	ed->chg = 0;
+	ed->nLines = 0;
+}
+
+/* Replace the contents of the working buffer. */
+static __inline__ void
+SetBuffer(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf,
+    AG_Char *_Nonnull s, AG_Size len, AG_Size maxLen)
+{
+	AG_Free(buf->s);
+	buf->s = s;
+	buf->len = len;
+	buf->maxLen = maxLen;
+	ed->chg = 0;
+	ed->nLines = 0;
+}
+
+#ifdef AG_UNICODE
+/* Import the working buffer from an AG_Text element. */
+static int
+ImportText(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf,
+    AG_Text *_Nonnull txt)
+{
+	AG_TextEnt *te = &txt->ent[ed->lang];
+	AG_Char *s;
+	AG_Size len, maxLen;
 
-	if (ed->flags & AG_EDITABLE_EXCL) {
-		buf = &ed->sBuf;
+	if (te->buf != NULL) {
+		if ((s = AG_ImportUnicode("UTF-8", te->buf, &len,
+		    &maxLen)) == NULL)
+			return (-1);
 	} else {
-		if ((buf = TryMalloc(sizeof(AG_EditableBuffer))) == NULL) {
-			return (NULL);
+		if ((s = TryMalloc(sizeof(AG_Char))) == NULL) {
+			return (-1);
 		}
-		buf->s = NULL;
-		buf->len = 0;
-		buf->maxLen = 0;
+		s[0] = (AG_Char)'\0';
+		len = 0;
+		maxLen = sizeof(AG_Char);
+	}
+	SetBuffer(ed, buf, s, len, maxLen);
+	ed->syncTxt = txt;
+	ed->syncGen = txt->gen;
+	ed->syncLang = ed->lang;
+	return (0);
+}
+#endif /* AG_UNICODE */
+
+/*
+ * Import the working buffer from a C string. If the contents are unchanged,
+ * keep the current buffer (and line index).
+ */
+static int
+ImportString(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf,
+    char *_Nonnull sSrc)
+{
+	AG_Char *s;
+	AG_Size len, maxLen;
+
+#ifdef AG_UNICODE
+	if ((s = AG_ImportUnicode(ed->encoding, sSrc, &len, &maxLen)) == NULL)
+		return (-1);
+#else
+	if ((s = (Uint8 *)TryStrdup(sSrc)) == NULL) {
+		return (-1);
+	}
+	maxLen = len = strlen(sSrc);
+#endif
+	ed->syncTxt = sSrc;
+	ed->syncGen = buf->var->version;
+	ed->syncLen = strlen(sSrc);
+
+	if (buf->s != NULL && buf->len == len &&
+	    memcmp(buf->s, s, len*sizeof(AG_Char)) == 0) {
+		free(s);
+		return (0);
 	}
+	SetBuffer(ed, buf, s, len, maxLen);
+	return (0);
+}
+
+/*
+ * Return the working buffer. The buffer persists across calls and is
+ * imported again from the binding only if the bound text has changed (or
+ * once if AG_EDITABLE_EXCL is set). C strings whose changes are signaled
+ * with AG_VariableChanged() are imported again only when the version of
+ * the variable changes. The variable is returned locked; the caller should
+ * invoke ReleaseBuffer() after use.
+ */
+static __inline__ AG_EditableBuffer *_Nullable
+GetBuffer(AG_Editable *_Nonnull ed)
+{
+	AG_EditableBuffer *buf = &ed->sBuf;
 
 #ifdef AG_UNICODE
 	if (AG_Defined(ed, "text")) {			/* AG_Text element */
@@ -79,24 +164,15 @@ GetBuffer(AG_Editable *_Nonnull ed)
 
 		AG_MutexLock(&txt->lock);
 
-		if ((ed->flags & AG_EDITABLE_EXCL) == 0 ||
-		    buf->s == NULL) {
-			AG_TextEnt *te = &txt->ent[ed->lang];
-
-			if (te->buf != NULL) {
-				buf->s = AG_ImportUnicode("UTF-8", te->buf,
-				    &buf->len, &buf->maxLen);
-			} else {
-				if ((buf->s = TryMalloc(sizeof(AG_Char))) != NULL) {
-					buf->s[0] = (AG_Char)'\0';
-				}
-				buf->len = 0;
-			}
-			if (buf->s == NULL) {
+		if (buf->s == NULL ||
+		    ((ed->flags & AG_EDITABLE_EXCL) == 0 &&
+		     (ed->syncTxt != txt || ed->syncGen != txt->gen ||
+		      ed->syncLang != ed->lang))) {
+			if (ImportText(ed, buf, txt) == -1) {
 				AG_MutexUnlock(&txt->lock);
 				AG_UnlockVariable(buf->var);
 				buf->var = NULL;
-				goto fail;
+				return (NULL);
 			}
 		}
 	} else
@@ -107,38 +183,97 @@ GetBuffer(AG_Editable *_Nonnull ed)
 		buf->var = AG_GetVariable(ed, "string", &s);
 		buf->reallocable = 0;
 
-		if ((ed->flags & AG_EDITABLE_EXCL) == 0 ||
-		    buf->s == NULL) {
-#ifdef AG_UNICODE
-			buf->s = AG_ImportUnicode(ed->encoding, s, &buf->len,
-			    &buf->maxLen);
-#else
-			buf->s = (Uint8 *)TryStrdup(s);
-			buf->maxLen = buf->len = strlen(s);
-#endif
-			if (buf->s == NULL) {
+		if (buf->s == NULL ||
+		    ((ed->flags & AG_EDITABLE_EXCL) == 0 &&
+		     ((buf->var->flags & AG_VARIABLE_NOTIFY) == 0 ||
+		      ed->syncTxt != s || ed->syncGen != buf->var->version))) {
+			if (ImportString(ed, buf, s) == -1) {
 				AG_UnlockVariable(buf->var);
-				goto fail;
+				buf->var = NULL;
+				return (NULL);
 			}
 		}
 	}
 	return (buf);
-fail:
-	if ((ed->flags & AG_EDITABLE_EXCL) == 0) { Free(buf); }
-	return (NULL);
 }
 
-/* Clear a working buffer. */
-static __inline__ void
-ClearBuffer(AG_EditableBuffer *_Nonnull buf)
+#ifdef AG_UNICODE
+/*
+ * Apply the pending change in place to an UTF-8 string of len bytes (in a
+ * buffer of size bytes), without exporting the whole buffer. The buffer
+ * of an AG_Text element te may be grown; other buffers are fixed-size.
+ */
+static int
+CommitChangeUTF8(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf,
+    char *_Nullable *_Nonnull pDst, AG_Size *_Nonnull pLen, AG_Size size,
+    AG_TextEnt *_Nullable te)
 {
-	AG_Free(buf->s);
-	buf->s = NULL;
-	buf->len = 0;
-	buf->maxLen = 0;
+	static const Uint8 lead[7] = { 0, 0, 0xc0, 0xe0, 0xf0, 0xf8, 0xfc };
+	const AG_Char *sIns = &buf->s[ed->chgPos];
+	AG_Size i, offs, offsEnd, lenIns = 0, lenNew, len = *pLen;
+	char *dst = *pDst, *d;
+
+	if (dst == NULL || len >= size || dst[len] != '\0' ||
+	    Strcasecmp(ed->encoding, "UTF-8") != 0)
+		return (-1);
+
+	offs = OffsetUTF8(ed, buf, ed->chgPos);
+	for (i = 0, offsEnd = offs; i < ed->chgDel; i++) {
+		int chLen;
+
+		if (offsEnd >= len ||
+		    (chLen = AG_CharLengthUTF8((unsigned char)dst[offsEnd])) < 1) {
+			return (-1);
+		}
+		offsEnd += chLen;
+	}
+	if (offsEnd > len) {
+		return (-1);
+	}
+	for (i = 0; i < ed->chgIns; i++) {
+		int chLen;
+
+		if ((chLen = AG_CharLengthUTF8FromUCS4(sIns[i])) == -1) {
+			return (-1);
+		}
+		lenIns += chLen;
+	}
+	lenNew = len - (offsEnd - offs) + lenIns;
+	if (lenNew+1 > size) {
+		if (te == NULL ||
+		    AG_TextRealloc(te, MAX(lenNew+1, size << 1)) == -1) {
+			return (-1);
+		}
+		dst = *pDst;
+	}
+	memmove(&dst[offs + lenIns], &dst[offsEnd], len - offsEnd + 1);
+
+	for (i = 0, d = &dst[offs]; i < ed->chgIns; i++) {
+		AG_Char uch = sIns[i];
+		int chLen = AG_CharLengthUTF8FromUCS4(uch), j;
+
+		if (chLen == 1) {
+			*d++ = (char)uch;
+			continue;
+		}
+		for (j = chLen-1; j > 0; j--) {
+			d[j] = (uch & 0x3f) | 0x80;
+			uch >>= 6;
+		}
+		d[0] = uch | lead[chLen];
+		d += chLen;
+	}
+	*pLen = lenNew;
+	return (0);
 }
+#endif /* AG_UNICODE */
 
-/* Commit changes to the working buffer. */
+/*
+ * Commit changes to the working buffer. When bound to an AG_Text element
+ * or a C string in UTF-8, a single changed range (as reported by
+ * AG_EditableBufferChanged()) is updated in place; otherwise the whole
+ * buffer is exported.
+ */
 static void
 CommitBuffer(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf)
 {
@@ -148,36 +283,62 @@ CommitBuffer(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf)
 		AG_TextEnt *te = &txt->ent[ed->lang];
 		AG_Size lenEnc;
 
-		if (AG_LengthUTF8FromUCS4(buf->s, &lenEnc) == -1) {
-			goto fail;
-		}
-		lenEnc++;
-
-		if (lenEnc > te->maxLen &&
-		    AG_TextRealloc(te, lenEnc) == -1) {
-			goto fail;
-		}
-		if (AG_ExportUnicode(ed->encoding, te->buf, buf->s,
-		    te->maxLen+1) == -1) {
-			goto fail;
+		if (ed->chg != 1 ||
+		    CommitChangeUTF8(ed, buf, &te->buf, &te->len, te->maxLen,
+		    te) == -1) {
+			if (AG_LengthUTF8FromUCS4(buf->s, &lenEnc) == -1) {
+				goto fail;
+			}
+			if (lenEnc+1 > te->maxLen &&
+			    AG_TextRealloc(te, lenEnc+1) == -1) {
+				goto fail;
+			}
+			if (AG_ExportUnicode(ed->encoding, te->buf, buf->s,
+			    te->maxLen+1) == -1) {
+				goto fail;
+			}
+			te->len = lenEnc;
 		}
+		ed->syncTxt = txt;
+		ed->syncGen = ++txt->gen;
+		ed->syncLang = ed->lang;
 	} else {					/* C string binding */
-		if (AG_ExportUnicode(ed->encoding, buf->var->data.s, buf->s,
-		    buf->var->info.size) == -1)
-			goto fail;
+		AG_Variable *V = buf->var;
+		char *s = V->data.s;
+
+		if (ed->chg != 1 || ed->syncTxt != s ||
+		    CommitChangeUTF8(ed, buf, &s, &ed->syncLen, V->info.size,
+		    NULL) == -1) {
+			if (AG_ExportUnicode(ed->encoding, s, buf->s,
+			    V->info.size) == -1) {
+				goto fail;
+			}
+			ed->syncLen = strlen(s);
+		}
+		/* A full buffer may be truncated; import it again if so. */
+		ed->syncTxt = (ed->syncLen+1 < V->info.size) ? s : NULL;
+		ed->syncGen = ++V->version;
 	}
 #else  /* !AG_UNICODE */
 
 	Strlcpy(buf->var->data.s, (const char *)buf->s, buf->var->info.size);
+	buf->var->version++;
 
 #endif /* !AG_UNICODE */
 
+	if (ed->chg != 1) {
+		ed->nLines = 0;
+	}
+	ed->chg = 0;
 	ed->flags |= AG_EDITABLE_MARKPREF;
 	AG_PostEvent(NULL, ed, "editable-postchg", NULL);
 	return;
 #ifdef AG_UNICODE
 fail:
 	Verbose("CommitBuffer: %s; ignoring\n", AG_GetError());
+	ed->syncTxt = NULL;
+	ed->chg = 0;
+	ed->nLines = 0;
 #endif
 }
 
@@ -195,13 +356,9 @@ ReleaseBuffer(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf)
 		AG_UnlockVariable(buf->var);
 		buf->var = NULL;
 	}
-	if (!(ed->flags & AG_EDITABLE_EXCL)) {
-		ClearBuffer(buf);
-		Free(buf);
-	}
 }
 
-/* Allocate and return a new buffer handle in a locked condition */
+/* Return the working buffer handle in a locked condition */
 AG_EditableBuffer *
 AG_EditableGetBuffer(AG_Editable *ed)
 {
@@ -218,7 +375,7 @@ AG_EditableGetBuffer(AG_Editable *ed)
 void
 AG_EditableClearBuffer(AG_Editable *ed, AG_EditableBuffer *buf)
 {
-	ClearBuffer(buf);
+	ClearBuffer(ed, buf);
 }
 
 /* Increase the working buffer size to accomodate new characters. */
@@ -232,36 +389,38 @@ AG_EditableGrowBuffer(AG_Editable *ed, AG_EditableBuffer *buf, AG_Char *ins,
 
 	newLen = (buf->len + nIns + 1)*sizeof(AG_Char);
 
+	if (!buf->reallocable) {
 #ifdef AG_UNICODE
-	if (Strcasecmp(ed->encoding, "UTF-8") == 0) {
-		AG_Size sLen, insLen;
+		if (Strcasecmp(ed->encoding, "UTF-8") == 0) {
+			AG_Size sLen, insLen;
 
-		if (AG_LengthUTF8FromUCS4(buf->s, &sLen) == -1 ||
-		    AG_LengthUTF8FromUCS4(ins, &insLen) == -1) {
-			return (-1);
+			if (AG_LengthUTF8FromUCS4(buf->s, &sLen) == -1 ||
+			    AG_LengthUTF8FromUCS4(ins, &insLen) == -1) {
+				return (-1);
+			}
+			convLen = sLen + insLen + 1;
+		} else if (Strcasecmp(ed->encoding, "US-ASCII") == 0) {
+			convLen = AG_LengthUCS4(buf->s) + nIns + 1;
+		} else {
+			/* TODO Proper estimates for other charsets */
+			convLen = newLen;
 		}
-		convLen = sLen + insLen + 1;
-	} else if (Strcasecmp(ed->encoding, "US-ASCII") == 0) {
-		convLen = AG_LengthUCS4(buf->s) + nIns + 1;
-	} else {
-		/* TODO Proper estimates for other charsets */
-		convLen = newLen;
-	}
 #else /* !AG_UNICODE */
-	if (Strcasecmp(ed->encoding, "US-ASCII") == 0) {
-		convLen = strlen((const char *)buf->s) + nIns + 1;
-	} else {
-		convLen = newLen;
-	}
+		if (Strcasecmp(ed->encoding, "US-ASCII") == 0) {
+			convLen = strlen((const char *)buf->s) + nIns + 1;
+		} else {
+			convLen = newLen;
+		}
 #endif /* AG_UNICODE */
-
-	if (!buf->reallocable) {
 		if (convLen > buf->var->info.size) {
 			AG_SetError("%u > %u bytes", (Uint)convLen, (Uint)buf->var->info.size);
 			return (-1);
 		}
 	}
 	if (newLen > buf->maxLen) {
+		if (buf->reallocable && newLen < (buf->maxLen << 1)) {
+			newLen = buf->maxLen << 1;
+		}
 		if ((sNew = TryRealloc(buf->s, newLen)) == NULL) {
 			return (-1);
 		}
@@ -271,10 +430,20 @@ AG_EditableGrowBuffer(AG_Editable *ed, AG_EditableBuffer *buf, AG_Char *ins,
 	return (0);
 }
 
-/* Release a working buffer. */
+/*
+ * Release a working buffer. Unless reported with AG_EditableBufferChanged(),
+ * assume that the caller may have modified the buffer.
+ */
 void
 AG_EditableReleaseBuffer(AG_Editable *ed, AG_EditableBuffer *buf)
 {
+	if (ed->chg == 0) {
+		ed->chg = -1;
+		ed->nLines = 0;
+	}
+	if ((ed->flags & AG_EDITABLE_EXCL) == 0) {
+		ed->syncTxt = NULL;		/* Discard uncommitted changes */
+	}
 	ReleaseBuffer(ed, buf);
 	AG_ObjectUnlock(ed);
 }
@@ -357,6 +526,7 @@ AG_EditableSetLang(AG_Editable *ed, enum ag_language lang)
 	ed->lang = lang;
 	ed->pos = 0;
 	ed->sel = 0;
+	ClearBuffer(ed, &ed->sBuf);
 	AG_ObjectUnlock(ed);
 	AG_Redraw(ed);
 }
@@ -392,7 +562,7 @@ void
 AG_EditableSetExcl(AG_Editable *ed, int enable)
 {
 	AG_ObjectLock(ed);
-	ClearBuffer(&ed->sBuf);
+	ClearBuffer(ed, &ed->sBuf);
 
 	if (enable) {
 		ed->flags |= AG_EDITABLE_EXCL;
@@ -648,6 +818,7 @@ OnFontChange(AG_Event *_Nonnull event)
 	ed->lineSkip = font->lineskip;
 	ed->fontMaxHeight = font->lineskip;
 	ed->yVis = WIDGET(ed)->h / ed->lineSkip;
+	ed->nLines = 0;
 }
 
 /*
@@ -708,21 +879,329 @@ WrapAtChar(AG_Editable *_Nonnull ed, int x, AG_Char *_Nonnull s)
 	return (0);
 }
 
+/*
+ * Line-start index. The index holds the starting position, UTF-8 offset
+ * and width of every displayed line (after word wrapping). It is rebuilt
+ * when the layout parameters change and updated incrementally on edits,
+ * such that drawing and hit-testing only need to process visible lines.
+ */
+
+/* Return the width of a character in the current layout. */
+static __inline__ int
+CharAdvance(AG_Editable *_Nonnull ed, AG_Char c)
+{
+	AG_Glyph *gl;
+
+	if (c == '\t') {
+		return (agTextTabWidth);
+	} else if (c == '\n') {
+		return (0);
+	}
+	gl = AG_TextRenderGlyph(WIDGET(ed)->drv,
+	    (ed->flags & AG_EDITABLE_PASSWORD) ? '*' : c);
+	return (gl->advance);
+}
+
+/* Return the number of bytes needed to encode characters in UTF-8. */
+static __inline__ AG_Size
+LengthUTF8(const AG_Char *_Nonnull s, AG_Size len)
+{
+#ifdef AG_UNICODE
+	AG_Size i, lenEnc = 0;
+
+	for (i = 0; i < len; i++) {
+		if (s[i] < 0x80) {
+			lenEnc++;
+		} else {
+			int chLen = AG_CharLengthUTF8FromUCS4(s[i]);
+			lenEnc += (chLen > 0) ? chLen : 1;
+		}
+	}
+	return (lenEnc);
+#else
+	return (len);
+#endif
+}
+
+/* Evaluate whether the line index is current for a buffer of given length. */
+static __inline__ int
+LinesValid(AG_Editable *_Nonnull ed, AG_Size len)
+{
+	return (ed->nLines > 0 && ed->linesLen == len &&
+	        ed->linesFlags == (ed->flags & (AG_EDITABLE_WORDWRAP |
+	                                        AG_EDITABLE_PASSWORD)) &&
+	        ((ed->flags & AG_EDITABLE_WORDWRAP) == 0 ||
+	         ed->linesW == WIDTH(ed)));
+}
+
+/* Record the layout parameters of an updated line index. */
+static void
+LinesUpdated(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf)
+{
+	Uint i;
+	int wMax = 0;
+
+	ed->linesLen = buf->len;
+	ed->linesFlags = ed->flags & (AG_EDITABLE_WORDWRAP|AG_EDITABLE_PASSWORD);
+	ed->linesW = WIDTH(ed);
+
+	for (i = 0; i < ed->nLines; i++) {
+		if (ed->lines[i].w > wMax)
+			wMax = ed->lines[i].w;
+	}
+	ed->xMax = (ed->nLines > 1) ? MAX(wMax, 10) : ed->lines[0].w;
+	ed->yMax = (int)ed->nLines;
+}
+
+static int
+GrowLines(AG_Editable *_Nonnull ed, Uint n)
+{
+	AG_EditableLine *linesNew;
+	Uint maxNew;
+
+	if (n <= ed->maxLines) {
+		return (0);
+	}
+	maxNew = MAX(n, ed->maxLines << 1);
+	if ((linesNew = TryRealloc(ed->lines,
+	    maxNew*sizeof(AG_EditableLine))) == NULL) {
+		return (-1);
+	}
+	ed->lines = linesNew;
+	ed->maxLines = maxNew;
+	return (0);
+}
+
+/*
+ * Lay out the line starting at position i. Return the position of the
+ * next line (or buf->len+1 if this is the last line), and the width and
+ * encoded length of the line.
+ */
+static AG_Size
+LayoutLine(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf,
+    AG_Size i, int *_Nonnull w, AG_Size *_Nonnull lenEnc)
+{
+	AG_Size iStart = i;
+	int x = 0;
+
+	for (; i < buf->len; i++) {
+		AG_Char c = buf->s[i];
+
+		if (WrapAtChar(ed, x, &buf->s[i])) {
+			*w = x;
+			*lenEnc = LengthUTF8(&buf->s[iStart], i - iStart);
+			return (i);
+		}
+		if (c == '\n') {
+			*w = x + 10;
+			*lenEnc = LengthUTF8(&buf->s[iStart], i+1 - iStart);
+			return (i+1);
+		}
+		x += CharAdvance(ed, c);
+	}
+	*w = x;
+	*lenEnc = LengthUTF8(&buf->s[iStart], i - iStart);
+	return (buf->len + 1);
+}
+
+/* Rebuild the line index. */
+static int
+BuildLines(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf)
+{
+	AG_Size i = 0, offs = 0, lenEnc;
+	Uint n = 0;
+
+	ed->nLines = 0;
+	if (WIDGET(ed)->drv == NULL) {
+		return (-1);
+	}
+	do {
+		AG_EditableLine *ln;
+
+		if (GrowLines(ed, n+1) == -1) {
+			return (-1);
+		}
+		ln = &ed->lines[n++];
+		ln->pos = i;
+		ln->offs = offs;
+		i = LayoutLine(ed, buf, i, &ln->w, &lenEnc);
+		offs += lenEnc;
+	} while (i <= buf->len);
+
+	ed->nLines = n;
+	LinesUpdated(ed, buf);
+	return (0);
+}
+
+/* Return the index of the line containing position pos. */
+static Uint
+FindLine(AG_Editable *_Nonnull ed, AG_Size pos)
+{
+	Uint lo = 0, hi = ed->nLines;
+
+	while (hi - lo > 1) {
+		Uint mid = (lo + hi) >> 1;
+
+		if (ed->lines[mid].pos <= pos) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+	return (lo);
+}
+
+/*
+ * Update the line index following the replacement of nDel characters at
+ * pos by nIns characters. Lines are laid out again from shortly before
+ * the change (a wrap decision depends on the following word) until a line
+ * starts in unmodified text at the same place as an existing line; the
+ * following lines are only shifted.
+ */
+static void
+UpdateLines(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf,
+    AG_Size pos, AG_Size nDel, AG_Size nIns)
+{
+	AG_EditableLine *lnNew = NULL, *ln;
+	AG_Size i, offs, offsOld = 0, lenEnc;
+	Uint k, m, j, nNew = 0, maxNew = 0, nTail;
+
+	if (!LinesValid(ed, buf->len - nIns + nDel) ||
+	    WIDGET(ed)->drv == NULL) {
+		goto fail;
+	}
+	k = FindLine(ed, pos);
+	k = (k > 2) ? k-2 : 0;
+	i = ed->lines[k].pos;
+	offs = ed->lines[k].offs;
+	m = k+1;
+	for (;;) {
+		if (nNew+1 > maxNew) {
+			AG_EditableLine *lnNewNew;
+
+			maxNew = (maxNew > 0) ? (maxNew << 1) : 8;
+			if ((lnNewNew = TryRealloc(lnNew,
+			    maxNew*sizeof(AG_EditableLine))) == NULL) {
+				goto fail;
+			}
+			lnNew = lnNewNew;
+		}
+		ln = &lnNew[nNew++];
+		ln->pos = i;
+		ln->offs = offs;
+		i = LayoutLine(ed, buf, i, &ln->w, &lenEnc);
+		offs += lenEnc;
+		if (i > buf->len) {
+			m = ed->nLines;
+			break;
+		}
+		if (i < pos + nIns) {
+			continue;
+		}
+		while (m < ed->nLines && ed->lines[m].pos + nIns < i + nDel) {
+			m++;
+		}
+		if (m < ed->nLines && ed->lines[m].pos + nIns == i + nDel) {
+			offsOld = ed->lines[m].offs;
+			break;
+		}
+	}
+
+	nTail = ed->nLines - m;
+	if (GrowLines(ed, k + nNew + nTail) == -1) {
+		goto fail;
+	}
+	memmove(&ed->lines[k + nNew], &ed->lines[m],
+	    nTail*sizeof(AG_EditableLine));
+	memcpy(&ed->lines[k], lnNew, nNew*sizeof(AG_EditableLine));
+	for (j = k + nNew; j < k + nNew + nTail; j++) {
+		ln = &ed->lines[j];
+		ln->pos = ln->pos - nDel + nIns;
+		ln->offs = ln->offs - offsOld + offs;
+	}
+	ed->nLines = k + nNew + nTail;
+	LinesUpdated(ed, buf);
+	Free(lnNew);
+	return;
+fail:
+	Free(lnNew);
+	ed->nLines = 0;
+}
+
+/*
+ * Return the line containing position pos (which must be valid), and the
+ * x-coordinate of pos within that line. A position at which a line was
+ * wrapped is considered to be at the end of the preceding line.
+ */
+static Uint
+PosToLine(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf,
+    AG_Size pos, int *_Nonnull x)
+{
+	Uint k = FindLine(ed, pos);
+	AG_Size i;
+	int xPos = 0;
+
+	if (k > 0 && pos == ed->lines[k].pos && buf->s[pos-1] != '\n') {
+		k--;
+	}
+	for (i = ed->lines[k].pos; i < pos; i++) {
+		xPos += CharAdvance(ed, buf->s[i]);
+	}
+	*x = xPos;
+	return (k);
+}
+
+/* Return the offset in bytes of position pos in the UTF-8 encoded text. */
+static AG_Size
+OffsetUTF8(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf,
+    AG_Size pos)
+{
+	AG_EditableLine *ln;
+
+	if (!LinesValid(ed, buf->len)) {
+		return LengthUTF8(buf->s, pos);
+	}
+	ln = &ed->lines[FindLine(ed, pos)];
+	return (ln->offs + LengthUTF8(&buf->s[ln->pos], pos - ln->pos));
+}
+
+/*
+ * Notify the widget that nDel characters at position pos in the working
+ * buffer have been replaced by nIns characters. The line index is updated
+ * and the change is recorded so that it can be committed in place.
+ */
+void
+AG_EditableBufferChanged(AG_Editable *ed, AG_EditableBuffer *buf, AG_Size pos,
+    AG_Size nDel, AG_Size nIns)
+{
+	UpdateLines(ed, buf, pos, nDel, nIns);
+
+	if (ed->chg == 0) {
+		ed->chg = 1;
+		ed->chgPos = pos;
+		ed->chgDel = nDel;
+		ed->chgIns = nIns;
+	} else if (ed->chg == 1) {		/* Merge with previous change */
+		AG_Size start = MIN(ed->chgPos, pos);
+		AG_Size end = MAX(ed->chgPos + ed->chgIns, pos + nDel);
+
+		ed->chgDel = end - ed->chgIns + ed->chgDel - start;
+		ed->chgIns = end - nDel + nIns - start;
+		ed->chgPos = start;
+	}
+}
+
 /*
  * Map mouse coordinates to a position within the buffer.
  */
-#define ON_LINE(my,y)       ((my) >= (y) && (my) <= (y)+ed->lineSkip)
-#define ON_CHAR(mx,x,glyph) ((mx) >= (x) && (mx) <= (x)+(glyph)->advance)
 int
 AG_EditableMapPosition(AG_Editable *ed, AG_EditableBuffer *buf, int mx, int my,
     int *pos)
 {
-	AG_Driver *drv = WIDGET(ed)->drv;
-	AG_Font *font = WIDGET(ed)->font;
-	AG_Char ch;
-	int i, x, y, line = 0;
-	int nLines = 1;
-	int yMouse;
+	AG_EditableLine *ln;
+	AG_Size i, iEnd;
+	Uint k;
+	int x, yMouse, rv = 0;
 	
 	AG_ObjectLock(ed);
 
@@ -731,138 +1210,43 @@ AG_EditableMapPosition(AG_Editable *ed, AG_EditableBuffer *buf, int mx, int my,
 		*pos = 0;
 		goto out;
 	}
-
-	x = 0;
-	y = 0;
- 	for (i = 0; i < buf->len; i++) {
-		AG_Char ch = buf->s[i];
-
-		if (WrapAtChar(ed, x, &buf->s[i])) {
-			x = 0;
-			nLines++;
-		}
-		if (ch == '\n') {
-			x = 0;
-			nLines++;
-		} else if (ch == '\t') {
-			x += agTextTabWidth;
-		} else {
-			switch (font->spec.type) {
-#ifdef HAVE_FREETYPE
-			case AG_FONT_VECTOR:
-				{
-					AG_TTFFont *ttf = font->ttf;
-					AG_TTFGlyph *glyph;
-
-					if (AG_TTFFindGlyph(ttf, ch,
-					    TTF_CACHED_METRICS|TTF_CACHED_BITMAP) != 0) {
-						continue;
-					}
-					glyph = ttf->current;
-					x += glyph->advance;
-				}
-				break;
-#endif /* HAVE_FREETYPE */
-#ifdef AG_SERIALIZATION
-			case AG_FONT_BITMAP:
-				{
-					AG_Glyph *gl;
-			
-					gl = AG_TextRenderGlyph(drv, ch);
-					x += gl->su->w;
-				}
-				break;
-#endif /* AG_SERIALIZATION */
-			case AG_FONT_DUMMY:
-				break;
-			}
-		}
+	if (!LinesValid(ed, buf->len) && BuildLines(ed, buf) == -1) {
+		rv = -1;
+		goto out;
 	}
-
-	x = 0;
-	for (i = 0; i < buf->len; i++) {
-		ch = buf->s[i];
-		if (mx <= 0 && ON_LINE(yMouse,y)) {
-			*pos = i;
-			goto out;
-		}
-		if (WrapAtChar(ed, x, &buf->s[i])) {
-			if (ON_LINE(yMouse,y) && mx > x) {
-				*pos = i;
-				goto out;
-			}
-			y += ed->lineSkip;
-			x = 0;
-			line++;
-		}
-		if (ch == '\n') {
-			if (ON_LINE(yMouse,y) && mx > x) {
-				*pos = i;
-				goto out;
-			}
-			y += ed->lineSkip;
-			x = 0;
-			line++;
-			continue;
-		} else if (ch == '\t') {
-			if (ON_LINE(yMouse,y) &&
-			    mx >= x && mx <= x+agTextTabWidth) {
-				*pos = (mx < x + (agTextTabWidth >> 1)) ? i : i+1;
-				goto out;
-			}
-			x += agTextTabWidth;
-			continue;
+	if ((k = (Uint)(yMouse / ed->lineSkip)) >= ed->nLines) {
+		*pos = (int)buf->len;
+		goto out;
+	}
+	ln = &ed->lines[k];
+	iEnd = (k+1 < ed->nLines) ? ed->lines[k+1].pos : buf->len;
+	i = ln->pos;
+	if (mx <= 0) {
+		if (k > 0 && buf->s[i-1] != '\n' && i < iEnd) {
+			i++;			/* Skip over the wrapping space */
 		}
-		
-		switch (font->spec.type) {
-#ifdef HAVE_FREETYPE
-		case AG_FONT_VECTOR:
-			{
-				AG_TTFFont *ttf = font->ttf;
-				AG_TTFGlyph *glyph;
-
-				if (AG_TTFFindGlyph(ttf, ch,
-				    TTF_CACHED_METRICS|TTF_CACHED_BITMAP) != 0) {
-					continue;
-				}
-				glyph = ttf->current;
+		*pos = (int)i;
+		goto out;
+	}
+	for (x = 0; i < iEnd; i++) {
+		AG_Char c = buf->s[i];
+		int adv;
 
-				if (ON_LINE(yMouse,y) && ON_CHAR(mx,x,glyph)) {
-					*pos = (mx < x+(glyph->advance >> 1)) ?
-					       i : i+1;
-					goto out;
-				}
-				x += glyph->advance;
-			}
-			break;
-#endif /* HAVE_FREETYPE */
-#ifdef AG_SERIALIZATION
-		case AG_FONT_BITMAP:
-			{
-				AG_Glyph *gl;
-			
-				gl = AG_TextRenderGlyph(drv, ch);
-				if (ON_LINE(yMouse,y) &&
-				    mx >= x &&
-				    mx <= x+gl->su->w) {
-					*pos = i;
-					goto out;
-				}
-				x += gl->su->w;
-			}
-			break;
-#endif /* AG_SERIALIZATION */
-		case AG_FONT_DUMMY:
+		if (c == '\n') {
 			break;
 		}
+		adv = CharAdvance(ed, c);
+		if (mx >= x && mx <= x+adv) {
+			*pos = (int)((mx < x + (adv >> 1)) ? i : i+1);
+			goto out;
+		}
+		x += adv;
 	}
-	*pos = buf->len;
+	*pos = (int)i;
 out:
 	AG_ObjectUnlock(ed);
-	return (0);
+	return (rv);
 }
-#undef ON_LINE
-#undef ON_CHAR
 
 /* Move cursor to the given position in pixels. */
 void
@@ -937,13 +1321,19 @@ Draw(void *_Nonnull obj)
 	AG_DriverClass *drvOps = WIDGET(ed)->drvOps;
 	AG_EditableBuffer *buf;
 	AG_Rect2 rClip;
-	int i, dx, dy, x, y;
-	int inSel = 0;
+	AG_Size i, iEnd, selStart, selEnd;
+	Uint k, kEnd;
+	int dx, dy, x, y;
 
 	if ((buf = GetBuffer(ed)) == NULL) {
 		return;
 	}
 	AG_EditableValidateSelection(ed, buf);
+
+	if (!LinesValid(ed, buf->len) && BuildLines(ed, buf) == -1) {
+		ReleaseBuffer(ed, buf);
+		return;
+	}
 	
 	rClip = WIDGET(ed)->rView;
 	rClip.x1 -= (ed->fontMaxHeight << 1);
@@ -954,97 +1344,86 @@ Draw(void *_Nonnull obj)
 	AG_PushBlendingMode(ed, AG_ALPHA_SRC, AG_ALPHA_ONE_MINUS_SRC);
 	AG_PushClipRect(ed, &ed->r);
 
-	x = 0;
-	y = -ed->y * ed->lineSkip;
-	ed->xMax = 10;
-	ed->yMax = 1;
-	for (i = 0; i <= buf->len; i++) {
-		AG_Glyph *gl;
-		AG_Char c = buf->s[i];
-
-		if (i == ed->pos) {			/* At cursor */
-			if (ed->sel == 0 &&
-			    (ed->flags & AG_EDITABLE_BLINK_ON) &&
-			    (ed->y >= 0 && ed->y <= ed->yMax-1) &&
-			    AG_WidgetIsFocused(ed)) {
-				AG_DrawLineV(ed,
-				    x - ed->x, (y + 1),
-				    (y + ed->lineSkip - 1),
-				    &WCOLOR(ed,TEXT_COLOR));
-			}
-			ed->xCurs = x;
-			if (ed->flags & AG_EDITABLE_MARKPREF) {
-				ed->flags &= ~(AG_EDITABLE_MARKPREF);
-				ed->xCursPref = x;
+	/* Locate the cursor and the selection. */
+	ed->yCurs = (int)PosToLine(ed, buf, ed->pos, &ed->xCurs);
+	if (ed->flags & AG_EDITABLE_MARKPREF) {
+		ed->flags &= ~(AG_EDITABLE_MARKPREF);
+		ed->xCursPref = ed->xCurs;
+	}
+	if (ed->sel > 0) {
+		selStart = ed->pos;
+		selEnd = ed->pos + ed->sel;
+	} else {
+		selStart = ed->pos + ed->sel;
+		selEnd = ed->pos;
+	}
+	if (ed->sel != 0) {
+		ed->ySelStart = (int)PosToLine(ed, buf, selStart, &ed->xSelStart);
+		ed->ySelEnd = (int)PosToLine(ed, buf, selEnd, &ed->xSelEnd);
+	}
+	if (ed->sel == 0 &&
+	    (ed->flags & AG_EDITABLE_BLINK_ON) &&
+	    (ed->y >= 0 && ed->y <= ed->yMax-1) &&
+	    AG_WidgetIsFocused(ed)) {
+		y = (ed->yCurs - ed->y) * ed->lineSkip;
+		AG_DrawLineV(ed,
+		    ed->xCurs - ed->x, (y + 1),
+		    (y + ed->lineSkip - 1),
+		    &WCOLOR(ed,TEXT_COLOR));
+	}
+
+	/* Render the visible lines only. */
+	k = (ed->y > 0) ? (Uint)ed->y : 0;
+	kEnd = MIN(ed->nLines, k + (Uint)MAX(ed->yVis,0) + 1);
+	for (; k < kEnd; k++) {
+		y = ((int)k - ed->y) * ed->lineSkip;
+		iEnd = (k+1 < ed->nLines) ? ed->lines[k+1].pos : buf->len;
+		for (i = ed->lines[k].pos, x = 0; i < iEnd; i++) {
+			AG_Glyph *gl;
+			AG_Char c = buf->s[i];
+			int inSel = (i >= selStart && i < selEnd);
+
+			if (c == '\n') {
+				break;
+			} else if (c == '\t') {
+				if (inSel) {
+					AG_Rect r;
+
+					r.x = x - ed->x;
+					r.y = y;
+					r.w = agTextTabWidth + 1;
+					r.h = ed->lineSkip + 1;
+					AG_DrawRectFilled(ed, &r,
+					    &WCOLOR_SEL(ed,0));
+				}
+				x += agTextTabWidth;
+				continue;
 			}
-			ed->yCurs = y/ed->lineSkip + ed->y;
-		}
-		if ((ed->sel > 0 && i >= ed->pos && i < ed->pos + ed->sel) ||
-		    (ed->sel < 0 && i <  ed->pos && i > ed->pos + ed->sel - 1)) {
-			if (!inSel) {
-				inSel = 1;
-				ed->xSelStart = x;
-				ed->ySelStart = y/ed->lineSkip + ed->y;
+			c = (ed->flags & AG_EDITABLE_PASSWORD) ? '*' : c;
+			gl = AG_TextRenderGlyph(drv, c);
+			dx = WIDGET(ed)->rView.x1 + x - ed->x;
+			dy = WIDGET(ed)->rView.y1 + y;
+
+			if (dx >= rClip.x2) {
+				break;
 			}
-		} else {
-			if (inSel) {
-				inSel = 0;
-				ed->xSelEnd = x;
-				ed->ySelEnd = y/ed->lineSkip + ed->y;
+			if (!AG_RectInside2(&rClip, dx, dy)) {
+				x += gl->advance;
+				continue;
 			}
-		}
-		if (i == buf->len)
-			break;
-
-		if (WrapAtChar(ed, x, &buf->s[i])) {
-			y += ed->lineSkip;
-			ed->xMax = MAX(ed->xMax, x);
-			ed->yMax++;
-			x = 0;
-		}
-		if (c == '\n') {
-			y += ed->lineSkip;
-			ed->xMax = MAX(ed->xMax, x+10);
-			ed->yMax++;
-			x = 0;
-			continue;
-		} else if (c == '\t') {
 			if (inSel) {
 				AG_Rect r;
 
 				r.x = x - ed->x;
 				r.y = y;
-				r.w = agTextTabWidth + 1;
-				r.h = ed->lineSkip + 1;
+				r.w = gl->su->w + 1;
+				r.h = gl->su->h;
 				AG_DrawRectFilled(ed, &r, &WCOLOR_SEL(ed,0));
 			}
-			x += agTextTabWidth;
-			continue;
-		}
-
-		c = (ed->flags & AG_EDITABLE_PASSWORD) ? '*' : c;
-		gl = AG_TextRenderGlyph(drv, c);
-		dx = WIDGET(ed)->rView.x1 + x - ed->x;
-		dy = WIDGET(ed)->rView.y1 + y;
-
-		if (!AG_RectInside2(&rClip, dx, dy)) {
+			drvOps->drawGlyph(drv, gl, dx,dy);
 			x += gl->advance;
-			continue;
-		}
-		if (inSel) {
-			AG_Rect r;
-
-			r.x = x - ed->x;
-			r.y = y;
-			r.w = gl->su->w + 1;
-			r.h = gl->su->h;
-			AG_DrawRectFilled(ed, &r, &WCOLOR_SEL(ed,0));
 		}
-		drvOps->drawGlyph(drv, gl, dx,dy);
-		x += gl->advance;
 	}
-	if (ed->yMax == 1)
-		ed->xMax = x;
 	
 	/* Process any scrolling requests. */
 	if (ed->flags & AG_EDITABLE_KEEPVISCURSOR) {
@@ -1359,6 +1738,7 @@ AG_EditablePaste(AG_Editable *ed, AG_EditableBuffer *buf,
 	memcpy(&buf->s[ed->pos], cb->s, cb->len*sizeof(AG_Char));
 	buf->len += cb->len;
 	buf->s[buf->len] = '\0';
+	AG_EditableBufferChanged(ed, buf, ed->pos, 0, cb->len);
 	ed->pos += cb->len;
 	ed->xScrollTo = &ed->xCurs;
 	ed->yScrollTo = &ed->yCurs;
@@ -1387,6 +1767,7 @@ AG_EditableDelete(AG_Editable *ed, AG_EditableBuffer *buf)
 		    (buf->len - ed->sel + 1 - ed->pos)*sizeof(AG_Char));
 	}
 	buf->len -= ed->sel;
+	AG_EditableBufferChanged(ed, buf, ed->pos, ed->sel, 0);
 	ed->sel = 0;
 	ed->xScrollTo = &ed->xCurs;
 	ed->yScrollTo = &ed->yCurs;
@@ -1762,6 +2143,8 @@ AG_EditableSetString(AG_Editable *ed, const char *text)
 		}
 	}
 	ed->sel = 0;
+	ed->chg = -1;
+	ed->nLines = 0;
 	CommitBuffer(ed, buf);
 	ReleaseBuffer(ed, buf);
 out:
@@ -1825,6 +2208,8 @@ AG_EditablePrintf(void *obj, const char *fmt, ...)
 		buf->len = 0;
 	}
 	ed->sel = 0;
+	ed->chg = -1;
+	ed->nLines = 0;
 	CommitBuffer(ed, buf);
 	ReleaseBuffer(ed, buf);
 out:
@@ -1959,6 +2344,7 @@ OnBindingChange(AG_Event *_Nonnull event)
 	} else if (strcmp(binding->name, "text") == 0) {
 		AG_Unset(ed, "string");
 	}
+	ClearBuffer(ed, &ed->sBuf);
 }
 
 static void
@@ -2013,6 +2399,20 @@ Init(void *_Nonnull obj)
 	ed->sBuf.len = 0;
 	ed->sBuf.maxLen = 0;
 	ed->sBuf.reallocable = 0;
+	ed->syncTxt = NULL;
+	ed->syncGen = 0;
+	ed->syncLang = AG_LANG_NONE;
+	ed->syncLen = 0;
+	ed->chg = 0;
+	ed->chgPos = 0;
+	ed->chgDel = 0;
+	ed->chgIns = 0;
+	ed->lines = NULL;
+	ed->nLines = 0;
+	ed->maxLines = 0;
+	ed->linesLen = 0;
+	ed->linesFlags = 0;
+	ed->linesW = 0;
 
 	AG_SetEvent(ed, "bound", OnBindingChange, NULL);
 	OBJECT(ed)->flags |= AG_OBJECT_BOUND_EVENTS;
@@ -2059,8 +2459,8 @@ Destroy(void *_Nonnull obj)
 	if (ed->pm != NULL) {
 		AG_PopupDestroy(ed->pm);
 	}
-	if (ed->flags & AG_EDITABLE_EXCL)
-		Free(ed->sBuf.s);
+	Free(ed->sBuf.s);
+	Free(ed->lines);
 
 #ifdef AG_UNICODE
 	AG_TextFree(ed->text);
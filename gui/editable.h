@@ -19,6 +19,14 @@ typedef struct ag_editable_buffer {
 	int reallocable;		/* Buffer can be realloc'd */
 } AG_EditableBuffer;
 
+/* Entry in the line-start index (one per displayed line) */
+typedef struct ag_editable_line {
+	AG_Size pos;			/* Position of first character */
+	AG_Size offs;			/* Offset in bytes (in UTF-8) */
+	int w;				/* Width in pixels */
+	int _pad;
+} AG_EditableLine;
+
 /* Internal clipboard for copy/paste and kill/yank */
 typedef struct ag_editable_clipboard {
 	_Nonnull_Mutex AG_Mutex lock;
@@ -75,7 +83,20 @@ typedef struct ag_editable {
 	int yMax;			/* Lowest y (lines) */
 	int yVis;			/* Maximum visible area (lines) */
 	Uint32 wheelTicks;		/* For wheel acceleration */
-	AG_EditableBuffer sBuf;		/* Working buffer (for STATIC) */
+	AG_EditableBuffer sBuf;		/* Working buffer */
+	void *_Nullable syncTxt;	/* AG_Text or string last synced */
+	Uint syncGen;			/* Its generation (or variable version) */
+	enum ag_language syncLang;	/* Its language at last sync */
+	AG_Size syncLen;		/* Encoded string length at last sync */
+	int chg;			/* Uncommitted change (1 = range below,
+	                                   -1 = unknown) */
+	AG_Size chgPos, chgDel, chgIns;	/* Changed range */
+	AG_EditableLine *_Nullable lines; /* Line-start index */
+	Uint nLines;			/* Lines in index (0 = invalid) */
+	Uint maxLines;			/* Allocated index entries */
+	AG_Size linesLen;		/* Buffer length at last layout */
+	Uint linesFlags;		/* Layout flags at last layout */
+	int linesW;			/* Wrap width at last layout */
 	AG_Rect r;			/* View area */
 	AG_CursorArea *_Nullable ca;	/* Text cursor-change area */
 	int fontMaxHeight;		/* Maximum character height */
@@ -113,6 +134,9 @@ void AG_EditableReleaseBuffer(AG_Editable *_Nonnull, AG_EditableBuffer *_Nonnull
 void AG_EditableClearBuffer(AG_Editable *_Nonnull, AG_EditableBuffer *_Nonnull);
 int  AG_EditableGrowBuffer(AG_Editable *_Nonnull, AG_EditableBuffer *_Nonnull,
                            AG_Char *_Nonnull, AG_Size);
+void AG_EditableBufferChanged(AG_Editable *_Nonnull,
+                              AG_EditableBuffer *_Nonnull,
+                              AG_Size, AG_Size, AG_Size);
 
 int  AG_EditableCut(AG_Editable *_Nonnull, AG_EditableBuffer *_Nonnull,
                     AG_EditableClipboard *_Nonnull);
@@ -262,6 +262,7 @@ AG_InitGUIGlobals(void)
 		AG_BindInt(cfg, agGUIOptions[i].key, agGUIOptions[i].p);
 	}
 	AG_LoadStyleSheet(NULL, "_agStyleDefault");
+	AG_InitSurfaceLoader();
 #endif
 	return (0);
 }
@@ -285,6 +286,7 @@ AG_DestroyGUIGlobals(void)
 
 	AG_DestroyStyleSheet(&agDefaultCSS);
 #ifdef AG_SERIALIZATION
+	AG_DestroySurfaceLoader();
 	cfg = AG_ConfigObject();
 	for (i = 0; i < agGUIOptionCount; i++)
 		AG_Unset(cfg, agGUIOptions[i].key);
@@ -334,6 +336,9 @@ AG_InitGUI(Uint flags)
 	}
 	AG_InitWindowSystem();
 	AG_InitAppMenu();
+#ifdef AG_SERIALIZATION
+	AG_InitSurfaceLoader();
+#endif
 	return (0);
 }
 
@@ -382,6 +387,9 @@ AG_DestroyGUI(void)
 	agDriverOps = NULL;
 	AG_UnlockVFS(&agDrivers);
 
+#ifdef AG_SERIALIZATION
+	AG_DestroySurfaceLoader();
+#endif
 	AG_DestroyAppMenu();
 	AG_DestroyWindowSystem();
 	AG_DestroyTextSubsystem();
@@ -501,6 +509,9 @@ AG_InitGraphics(const char *spec)
 		 * Auto-select best available driver.
 		 */
 		for (pd = &agDriverList[0]; *pd != NULL; pd++) {
+			if ((*pd)->flags & AG_DRIVER_NOAUTO) {
+				continue;
+			}
 			if ((drv = AG_DriverOpen(*pd)) != NULL) {
 				dc = *pd;
 				break;
@@ -92,18 +92,27 @@ Init(void *_Nonnull obj)
 	AG_ColorNone(&icon->cBackground);
 }
 
+#ifdef AG_SERIALIZATION
+static void
+Destroy(void *_Nonnull obj)
+{
+	AG_SurfaceLoadCancel(obj);
+}
+#endif
+
 static void
 SizeRequest(void *_Nonnull obj, AG_SizeReq *_Nonnull r)
 {
 	AG_Icon *icon = obj;
 	int wLbl, hLbl;
 
-	if (icon->surface == -1) {
+	if (icon->surface == -1) {		/* No surface (yet) */
 		r->w = 0;
 		r->h = 0;
+	} else {
+		r->w = WSURFACE(icon,icon->surface)->w;
+		r->h = WSURFACE(icon,icon->surface)->h;
 	}
-	r->w = WSURFACE(icon,icon->surface)->w;
-	r->h = WSURFACE(icon,icon->surface)->h;
 	if (icon->labelTxt[0] != '\0') {
 		if (icon->labelSurface != -1) {
 			wLbl = WSURFACE(icon,icon->labelSurface)->w;
@@ -201,6 +210,39 @@ AG_IconSetSurfaceNODUP(AG_Icon *icon, AG_Surface *su)
 	AG_Redraw(icon);
 }
 
+#ifdef AG_SERIALIZATION
+static void
+IconLoaded(AG_Event *_Nonnull event)
+{
+	AG_Icon *icon = AG_SELF();
+	const AG_Surface *S = AG_PTR(1);
+
+	if (S == NULL) {
+		Verbose("%s: %s\n", AG_STRING(2), AG_GetError());
+		return;
+	}
+	AG_IconSetSurface(icon, S);
+	AG_WidgetUpdate(icon);
+}
+
+/*
+ * Load the icon surface from an image file in the background (see
+ * AG_SurfaceLoadAsync(3)). The current surface, if any, is displayed
+ * until the file has been decoded.
+ */
+int
+AG_IconSetSurfaceFromFileAsync(AG_Icon *icon, const char *path)
+{
+	int rv;
+
+	AG_ObjectLock(icon);
+	AG_SurfaceLoadCancel(icon);
+	rv = AG_SurfaceLoadAsync(icon, path, IconLoaded, NULL);
+	AG_ObjectUnlock(icon);
+	return (rv);
+}
+#endif /* AG_SERIALIZATION */
+
 void
 AG_IconSetText(AG_Icon *icon, const char *fmt, ...)
 {
@@ -244,7 +286,11 @@ AG_WidgetClass agIconClass = {
 		{ 0,0 },
 		Init,
 		NULL,		/* reset */
+#ifdef AG_SERIALIZATION
+		Destroy,
+#else
 		NULL,		/* destroy */
+#endif
 		NULL,		/* load */
 		NULL,		/* save */
 		NULL		/* edit */
@@ -44,6 +44,9 @@ AG_Icon *_Nullable AG_IconFromBMP(const char *_Nonnull);
 
 void AG_IconSetSurface(AG_Icon *_Nonnull, const AG_Surface *_Nullable);
 void AG_IconSetSurfaceNODUP(AG_Icon *_Nonnull, AG_Surface *_Nonnull);
+#ifdef AG_SERIALIZATION
+int  AG_IconSetSurfaceFromFileAsync(AG_Icon *_Nonnull, const char *_Nonnull);
+#endif
 void AG_IconSetTextS(AG_Icon *_Nonnull, const char *_Nullable);
 void AG_IconSetText(AG_Icon *_Nonnull, const char *_Nonnull, ...)
                    FORMAT_ATTRIBUTE(printf,2,3);
@@ -115,6 +115,7 @@ Insert(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf,
 	}
 	buf->len += nIns;
 	buf->s[buf->len] = '\0';
+	AG_EditableBufferChanged(ed, buf, ed->pos, 0, nIns);
 	ed->pos += nIns;
 
 #ifdef AG_UNICODE
@@ -155,6 +156,7 @@ Delete(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf,
 	if (ed->pos == buf->len) { 
 		ed->pos--;
 		buf->s[--buf->len] = '\0';
+		AG_EditableBufferChanged(ed, buf, buf->len, 1, 0);
 
 		if (ed->flags & AG_EDITABLE_MULTILINE) {
 			ed->xScrollTo = &ed->xCurs;
@@ -196,6 +198,7 @@ Delete(AG_Editable *_Nonnull ed, AG_EditableBuffer *_Nonnull buf,
 			break;
 	}
 	buf->len--;
+	AG_EditableBufferChanged(ed, buf, ed->pos, 1, 0);
 	return (1);
 }
 
@@ -34,6 +34,162 @@
 #include <stdarg.h>
 
 #ifdef AG_ENABLE_STRING
+/*
+ * Format the text of a polled label into a buffer (which is grown as
+ * needed). Return -1 if the buffer could not be grown.
+ */
+static int
+FormatPolled(AG_Label *_Nonnull lbl, char *_Nonnull *_Nonnull buf,
+    AG_Size *_Nonnull bufSize)
+{
+	AG_Size rv;
+	char *bufNew;
+
+	for (;;) {
+		rv = AG_ProcessFmtString(lbl->fmt, *buf, *bufSize);
+		if (rv < *bufSize) {
+			break;
+		}
+		if ((bufNew = TryRealloc(*buf, (rv+AG_FMTSTRING_BUFFER_GROW)))
+		    == NULL) {
+			return (-1);
+		}
+		*buf = bufNew;
+		*bufSize = (rv+AG_FMTSTRING_BUFFER_GROW);
+	}
+	return (0);
+}
+
+# ifdef AG_TIMERS
+/*
+ * Format the text of a polled label and request a redraw if it differs
+ * from the text currently displayed.
+ */
+static void
+UpdatePolled(AG_Label *_Nonnull lbl)
+{
+	char *bufSwap;
+	AG_Size sizeSwap;
+
+	if (lbl->fmt == NULL ||
+	    FormatPolled(lbl, &lbl->pollBufNew, &lbl->pollBufNewSize) == -1) {
+		return;
+	}
+	if (strcmp(lbl->pollBufNew, lbl->pollBuf) != 0) {
+		bufSwap = lbl->pollBuf;
+		sizeSwap = lbl->pollBufSize;
+		lbl->pollBuf = lbl->pollBufNew;
+		lbl->pollBufSize = lbl->pollBufNewSize;
+		lbl->pollBufNew = bufSwap;
+		lbl->pollBufNewSize = sizeSwap;
+		AG_Redraw(lbl);
+	}
+}
+
+/*
+ * Return 1 if every argument of a polled label points to the data of a
+ * binding of the label whose changes are signaled by AG_VariableChanged(3),
+ * such that the label needs no polling.
+ */
+static int
+PolledArgsPushed(AG_Label *_Nonnull lbl)
+{
+	const AG_FmtString *fs = lbl->fmt;
+	const AG_Variable *V;
+	Uint i;
+
+	if (fs == NULL) {
+		return (1);
+	}
+	for (i = 0; i < fs->n; i++) {
+		TAILQ_FOREACH(V, &OBJECT(lbl)->vars, vars) {
+			if ((V->flags & AG_VARIABLE_NOTIFY) &&
+			    V->type != AG_VARIABLE_P_VARIABLE &&
+			    agVariableTypes[V->type].indirLvl > 0 &&
+			    V->data.p == fs->p[i])
+				break;
+		}
+		if (V == NULL)
+			return (0);
+	}
+	return (1);
+}
+
+/* Timer callback for polled labels whose arguments cannot notify. */
+static Uint32
+PollTimeout(AG_Timer *_Nonnull to, AG_Event *_Nonnull event)
+{
+	AG_Label *lbl = AG_SELF();
+
+	UpdatePolled(lbl);
+	return (to->ival);
+}
+
+/* Start or stop the polling timer as required by the label arguments. */
+static void
+SetPolling(AG_Label *_Nonnull lbl)
+{
+	if (PolledArgsPushed(lbl)) {
+		if (!(lbl->flags & AG_LABEL_PUSHED)) {
+			lbl->flags |= AG_LABEL_PUSHED;
+			AG_DelTimer(lbl, &lbl->toPoll);
+		}
+	} else if (lbl->flags & AG_LABEL_PUSHED) {
+		lbl->flags &= ~(AG_LABEL_PUSHED);
+		AG_AddTimer(lbl, &lbl->toPoll, 500, PollTimeout, NULL);
+	}
+}
+
+/* Reformat a polled label whenever one of its bindings signals a change. */
+static void
+OnVariableChangedPolled(AG_Event *_Nonnull event)
+{
+	AG_Label *lbl = AG_SELF();
+
+	if (!(WIDGET(lbl)->flags & AG_WIDGET_VISIBLE))
+		return;					/* Updated in OnShow */
+
+	UpdatePolled(lbl);
+	SetPolling(lbl);
+}
+
+static void
+OnShowPolled(AG_Event *_Nonnull event)
+{
+	AG_Label *lbl = AG_SELF();
+
+	if (lbl->fmt != NULL) {
+		FormatPolled(lbl, &lbl->pollBuf, &lbl->pollBufSize);
+	}
+	lbl->flags |= AG_LABEL_PUSHED;			/* Timer is stopped */
+	SetPolling(lbl);
+}
+
+static void
+OnHidePolled(AG_Event *_Nonnull event)
+{
+	AG_Label *lbl = AG_SELF();
+
+	AG_DelTimer(lbl, &lbl->toPoll);
+}
+# endif /* AG_TIMERS */
+
+/* Set up the polling buffers and timer of a new polled label. */
+static void
+InitPolled(AG_Label *_Nonnull lbl)
+{
+	lbl->pollBuf[0] = '\0';
+# ifdef AG_TIMERS
+	lbl->pollBufNewSize = AG_FMTSTRING_BUFFER_INIT;
+	lbl->pollBufNew = Malloc(lbl->pollBufNewSize);
+	lbl->pollBufNew[0] = '\0';
+	OBJECT(lbl)->flags |= AG_OBJECT_CHANGED_EVENTS;
+	AG_AddEvent(lbl, "variable-changed", OnVariableChangedPolled, NULL);
+	AG_AddEvent(lbl, "widget-shown", OnShowPolled, NULL);
+	AG_AddEvent(lbl, "widget-hidden", OnHidePolled, NULL);
+# endif
+}
+
 /*
  * Create a new polled label (AG_LEGACY: API predates the generalization of
  * the formatting engine, in 2.0 this will take an AG_FmtString argument).
@@ -88,7 +244,7 @@ AG_LabelNewPolled(void *parent, Uint flags, const char *fmt, ...)
 	va_end(ap);
 	/* AG_LEGACY */
 
-	AG_RedrawOnTick(lbl, 500);
+	InitPolled(lbl);
 	AG_ObjectAttach(parent, lbl);
 	return (lbl);
 }
@@ -147,7 +303,7 @@ AG_LabelNewPolledMT(void *parent, Uint flags, AG_Mutex *mu, const char *fmt, ...
 	}
 	va_end(ap);
 
-	AG_RedrawOnTick(lbl, 500);
+	InitPolled(lbl);
 	AG_ObjectAttach(parent, lbl);
 	return (lbl);
 }
@@ -302,6 +458,11 @@ Init(void *_Nonnull obj)
 	lbl->fmt = NULL;
 	lbl->pollBuf = NULL;
 	lbl->pollBufSize = 0;
+# ifdef AG_TIMERS
+	lbl->pollBufNew = NULL;
+	lbl->pollBufNewSize = 0;
+	AG_InitTimer(&lbl->toPoll, "poll", 0);
+# endif
 #endif
 	AG_SetEvent(lbl, "font-changed", OnFontChange, NULL);
 }
@@ -391,28 +552,16 @@ GetPosition(AG_Label *_Nonnull lbl, AG_Surface *_Nonnull su,
 static void
 DrawPolled(AG_Label *_Nonnull lbl)
 {
-	AG_Size rv;
-	char *pollBufNew;
 	int x, y;
 	int su;
 
 	if (lbl->fmt == NULL || lbl->fmt->s[0] == '\0') {
 		return;
 	}
-	for (;;) {
-		rv = AG_ProcessFmtString(lbl->fmt, lbl->pollBuf, lbl->pollBufSize);
-		if (rv >= lbl->pollBufSize) {
-			if ((pollBufNew = TryRealloc(lbl->pollBuf,
-			    (rv+AG_FMTSTRING_BUFFER_GROW))) == NULL) {
-				return;
-			}
-			lbl->pollBuf = pollBufNew;
-			lbl->pollBufSize = (rv+AG_FMTSTRING_BUFFER_GROW);
-		} else {
-			break;
-		}
-	}
-
+#ifndef AG_TIMERS
+	if (FormatPolled(lbl, &lbl->pollBuf, &lbl->pollBufSize) == -1)
+		return;
+#endif
 	if ((su = AG_TextCacheGet(lbl->tCache,lbl->pollBuf)) != -1) {
 		GetPosition(lbl, WSURFACE(lbl,su), &x, &y);
 		AG_WidgetBlitSurface(lbl, su, x, y);
@@ -506,6 +655,9 @@ Destroy(void *_Nonnull p)
 		AG_FreeFmtString(lbl->fmt);
 	}
 	Free(lbl->pollBuf);
+# ifdef AG_TIMERS
+	Free(lbl->pollBufNew);
+# endif
 #endif
 	if (lbl->tCache != NULL)
 		AG_TextCacheDestroy(lbl->tCache);
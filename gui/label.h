@@ -34,6 +34,8 @@ typedef struct ag_label {
 #define AG_LABEL_NOMINSIZE	0x04		/* No minimum enforced size */
 #define AG_LABEL_PARTIAL	0x10		/* Partial mode (RO) */
 #define AG_LABEL_REGEN		0x20		/* Regenerate surface at next draw */
+#define AG_LABEL_PUSHED		0x40		/* Polled arguments all signal
+						   their changes (RO) */
 #define AG_LABEL_FRAME		0x80		/* Draw visible frame */
 #define AG_LABEL_EXPAND		(AG_LABEL_HFILL|AG_LABEL_VFILL)
 	char *_Nullable text;			/* Text buffer (for static labels) */
@@ -49,6 +51,11 @@ typedef struct ag_label {
 	AG_FmtString *_Nullable fmt;		/* Polled label data */
 	char *_Nullable pollBuf;		/* Buffer for polled labels */
 	AG_Size         pollBufSize;
+# ifdef AG_TIMERS
+	char *_Nullable pollBufNew;		/* Scratch buffer for polling */
+	AG_Size         pollBufNewSize;
+	AG_Timer toPoll;			/* Polling timer */
+# endif
 #endif
 } AG_Label;
 
@@ -171,14 +171,14 @@ AG_Surface *
 AG_ReadSurfaceFromBMP(AG_DataSource *_Nonnull ds)
 {
 	AG_Surface *S;
-	int i, pad, topDown, expandBMP;
+	int i, pad, topDown, expandBMP, bmpPitch=0;
 	AG_ByteOrder orderSaved;
 	AG_Offset bmpHeaderOffset;
 	AG_Pixel Rmask = 0;
 	AG_Pixel Gmask = 0;
 	AG_Pixel Bmask = 0;
 	AG_Pixel Amask = 0;
-	Uint8 *bits, *top, *end;
+	Uint8 *bits, *top, *end, *rowBuf = NULL;
 	int haveRGBMasks=0, haveAlphaMask=0, willCorrectAlpha=0;
 	/* The Win32 BMP file header (14 bytes) */
 	char magic[2];
@@ -416,20 +416,21 @@ AG_ReadSurfaceFromBMP(AG_DataSource *_Nonnull ds)
 	top = S->pixels;
 	end = S->pixels + (S->h * S->pitch);
 	switch (expandBMP) {
-	case 1: {
-		int bmpPitch = (biWidth + 7) >> 3;
+	case 1:
+		bmpPitch = (biWidth + 7) >> 3;
 		pad = (((bmpPitch) % 4) ? (4 - ((bmpPitch) % 4)) : 0);
 		break;
-	}
-	case 4: {
-		int bmpPitch = (biWidth + 1) >> 1;
+	case 4:
+		bmpPitch = (biWidth + 1) >> 1;
 		pad = (((bmpPitch) % 4) ? (4 - ((bmpPitch) % 4)) : 0);
 		break;
-	}
 	default:
 		pad = ((S->pitch % 4) ? (4 - (S->pitch % 4)) : 0);
 		break;
 	}
+	if (expandBMP &&			/* Packed rows (with padding) */
+	    (rowBuf = TryMalloc(bmpPitch + pad)) == NULL)
+		goto fail_surf;
 	if (topDown) {
 		bits = top;
 	} else {
@@ -439,13 +440,16 @@ AG_ReadSurfaceFromBMP(AG_DataSource *_Nonnull ds)
 		switch (expandBMP) {
 		case 1:
 		case 4: {
+			const Uint8 *pBmp = rowBuf;
 			Uint8 px = 0;
 			int shift = (8 - expandBMP);
 
+			if (AG_Read(ds, rowBuf, bmpPitch + pad) != 0) {
+				goto fail_surf;
+			}
 	  		for (i = 0; i < S->w; ++i) {
 				if (i % (8 / expandBMP) == 0) {
-					if (AG_Read(ds, &px, 1) != 0)
-						goto fail_surf;
+					px = *pBmp++;
 				}
 				*(bits + i) = (px >> shift);
 				px <<= expandBMP;
@@ -480,13 +484,12 @@ AG_ReadSurfaceFromBMP(AG_DataSource *_Nonnull ds)
 #endif /* BE */
 			break;
 		}
-	        /* Skip padding bytes, ugh */
-		if (pad) {
-			Uint8 padbyte;
-			for (i = 0; i < pad; ++i) {
-				if (AG_Read(ds, &padbyte, 1) == -1)
-					goto fail_surf;
-			}
+	        /* Skip padding bytes (already read along with packed rows) */
+		if (pad && !expandBMP) {
+			Uint8 padBytes[4];
+
+			if (AG_Read(ds, padBytes, pad) == -1)
+				goto fail_surf;
 		}
 		if (topDown) {
 			bits += S->pitch;
@@ -497,9 +500,11 @@ AG_ReadSurfaceFromBMP(AG_DataSource *_Nonnull ds)
 	if (willCorrectAlpha) {
 		CorrectAlphaChannel_32RGB(S);
 	}
+	Free(rowBuf);
 	AG_SetByteOrder(ds, orderSaved);        /* Restore stream's byte order */
 	return (S);
 fail_surf:
+	Free(rowBuf);
 	AG_SurfaceFree(S);
 fail:
 	AG_SetByteOrder(ds, orderSaved);
@@ -657,7 +662,8 @@ AG_WriteSurfaceToBMP(AG_DataSource *ds, const AG_Surface *Sarg, Uint8 flags)
 	}
 
 	/* Write the palette (in BGR color order) */
-	if ((pal = S->format.palette) != NULL) {
+	if (S->format.mode == AG_SURFACE_INDEXED &&
+	    (pal = S->format.palette) != NULL) {
 		for (i = 0; i < pal->nColors; ++i) {
 			AG_WriteUint8(ds, pal->colors[i].b);
 			AG_WriteUint8(ds, pal->colors[i].g);
@@ -685,10 +691,9 @@ AG_WriteSurfaceToBMP(AG_DataSource *ds, const AG_Surface *Sarg, Uint8 flags)
 			break;
 		}
 		if (pad) {
-			const Uint8 padbyte = 0;
-			for (i = 0; i < pad; ++i) {
-				AG_Write(ds, &padbyte, 1);
-			}
+			static const Uint8 padBytes[4] = { 0,0,0,0 };
+
+			AG_Write(ds, padBytes, pad);
 		}
 	}
 
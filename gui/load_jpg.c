@@ -34,6 +34,7 @@
 
 #include <agar/gui/gui.h>
 #include <agar/gui/surface.h>
+#include <agar/gui/packedpixel.h>
 
 #include <agar/config/have_jpeg.h>
 #ifdef HAVE_JPEG
@@ -137,10 +138,11 @@ AG_SurfaceExportJPEG(const AG_Surface *_Nonnull S, const char *_Nonnull path,
 	const Uint BytesPerPixel = S->format.BytesPerPixel;
 	struct jpeg_error_mgr jerrmgr;
 	struct jpeg_compress_struct jcomp;
+	AG_PackedPixelLayout Ls, Ljpg;
 	JSAMPROW row[1];
 	Uint8 *jcopybuf;
 	FILE *f;
-	int x;
+	int x, rowwise;
 
 	if ((f = fopen(path, "wb")) == NULL) {
 		AG_SetError("fdopen: %s", strerror(errno));
@@ -171,13 +173,29 @@ AG_SurfaceExportJPEG(const AG_Surface *_Nonnull S, const char *_Nonnull path,
 		return (-1);
 	}
 	
-	/* TODO block copiable and optimized cases */
+	/*
+	 * Surfaces with 8-bit components are converted with the row
+	 * converters, or passed to libjpeg directly if already in RGB order.
+	 */
+	rowwise = (AG_PackedPixelGetLayout(&S->format, &Ls) == 0);
+	AG_PackedPixelLayoutRGB(&Ljpg, 0);
 
 	jpeg_start_compress(&jcomp, TRUE);
 	while (jcomp.next_scanline < jcomp.image_height) {
 		Uint8 *p = S->pixels + jcomp.next_scanline*S->pitch;
 		Uint8 *jp = jcopybuf;
 
+		if (rowwise) {
+			if (AG_PackedPixelLayoutCompare(&Ls, &Ljpg) == 0) {
+				row[0] = p;			/* Zero copy */
+			} else {
+				AG_PackedPixelConvertRow(jcopybuf, &Ljpg,
+				    p, &Ls, S->w);
+				row[0] = jcopybuf;
+			}
+			jpeg_write_scanlines(&jcomp, row, 1);
+			continue;
+		}
 		for (x = 0; x < S->w; x++) {
 			AG_Color c;
 			
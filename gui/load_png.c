@@ -33,6 +33,7 @@
 #include <agar/core/core.h>
 #include <agar/gui/gui.h>
 #include <agar/gui/surface.h>
+#include <agar/gui/packedpixel.h>
 
 #include <agar/config/have_png.h>
 #if defined(HAVE_PNG)
@@ -137,7 +138,7 @@ AG_ReadSurfaceFromPNG(AG_DataSource *ds)
 	png_uint_32 width, height;
 	Uint32 Rmask=0, Gmask=0, Bmask=0, Amask=0;
 	AG_Offset start = AG_Tell(ds);
-	int depth, colorType, intlaceType, channels, row;
+	int depth, origDepth, colorType, intlaceType, channels, row;
 
 	if ((png = png_create_read_struct(PNG_LIBPNG_VER_STRING,NULL,NULL,NULL))
 	    == NULL) {
@@ -152,6 +153,7 @@ AG_ReadSurfaceFromPNG(AG_DataSource *ds)
 	png_read_info(png, info);
 	png_get_IHDR(png, info, &width,&height, &depth,
 	    &colorType, &intlaceType, NULL, NULL);
+	origDepth = depth;
 
 #if AG_MODEL != AG_LARGE
 	png_set_strip_16(png);
@@ -161,24 +163,6 @@ AG_ReadSurfaceFromPNG(AG_DataSource *ds)
 	    colorType == PNG_COLOR_TYPE_GA)
 		png_set_expand_gray_1_2_4_to_8(png);
 #endif
-	if (png_get_valid(png, info, PNG_INFO_tRNS)) {
-		png_color_16 *tc;
-		Uint8 *trans;
-		AG_Pixel colorkey;
-	        int nTrans;
-
-		png_get_tRNS(png, info, &trans, &nTrans, &tc);
-		colorkey = AG_MapPixel_RGB16(&S->format,
-		    tc->red, tc->green, tc->blue);
-#if AG_MODEL == AG_LARGE
-		Debug(NULL, "PNG transparent colorkey: 0x%llx\n",
-		    (unsigned long long)colorkey);
-#else
-		Debug(NULL, "PNG transparent colorkey: 0x%x\n", colorkey);
-#endif
-	        AG_SurfaceSetColorKey(S, AG_SURFACE_COLORKEY, colorkey);
-	}
-
 	/* Update png_info structure per our requirements. */
 	png_read_update_info(png, info);
 
@@ -265,6 +249,38 @@ AG_ReadSurfaceFromPNG(AG_DataSource *ds)
 #endif
 	}
 
+	if (png_get_valid(png, info, PNG_INFO_tRNS)) {
+		png_color_16 *tc = NULL;
+		png_bytep trans = NULL;
+		int nTrans = 0;
+
+		png_get_tRNS(png, info, &trans, &nTrans, &tc);
+
+		if (S->format.mode == AG_SURFACE_INDEXED) {   /* Alpha table */
+			AG_Palette *pal = S->format.palette;
+			int i;
+
+			for (i = 0; i < nTrans && i < pal->nColors; i++)
+				pal->colors[i].a = AG_8toH(trans[i]);
+		} else if (S->format.mode == AG_SURFACE_PACKED &&
+		           tc != NULL) {                     /* Colorkey */
+			AG_Pixel colorkey;
+
+			colorkey = (origDepth == 16) ?
+			    AG_MapPixel_RGB16(&S->format,
+			        tc->red, tc->green, tc->blue) :
+			    AG_MapPixel_RGB8(&S->format,
+			        tc->red, tc->green, tc->blue);
+#if AG_MODEL == AG_LARGE
+			Debug(NULL, "PNG transparent colorkey: 0x%llx\n",
+			    (unsigned long long)colorkey);
+#else
+			Debug(NULL, "PNG transparent colorkey: 0x%x\n", colorkey);
+#endif
+			AG_SurfaceSetColorKey(S, AG_SURFACE_COLORKEY, colorkey);
+		}
+	}
+
 	png_destroy_read_struct(&png,
 	    info ? &info : (png_infopp)0, (png_infopp)0);
 
@@ -294,7 +310,8 @@ AG_SurfaceExportPNG(const AG_Surface *S, const char *path, Uint flags)
 	png_color_8 sig_bit;
 	png_byte **rows = NULL, *row;
 	AG_Palette *pal = S->format.palette;
-	int i, x,y, w,h;
+	AG_PackedPixelLayout Ls, Lpng;
+	int i, x,y, w,h, rowwise=0, rowsOwned=1;
 	Uint8 *pSrc;
 
 #ifdef AG_DEBUG
@@ -372,19 +389,40 @@ AG_SurfaceExportPNG(const AG_Surface *S, const char *path, Uint flags)
 		AG_SetErrorS("png_malloc rows");
 		goto fail;
 	}
-	/* TODO: zero-copy optimized cases (i.e., surfaces in RGBA or RGB). */
-	
+	/*
+	 * Surfaces with 8-bit components are converted with the row
+	 * converters, or passed to libpng directly if already in RGB(A) order.
+	 */
+	if (depth == 8 && pngType != PNG_COLOR_TYPE_PALETTE &&
+	    AG_PackedPixelGetLayout(&S->format, &Ls) == 0) {
+		AG_PackedPixelLayoutRGB(&Lpng, (pngType == PNG_COLOR_TYPE_RGB_ALPHA));
+		if (AG_PackedPixelLayoutCompare(&Ls, &Lpng) == 0) {
+			rowsOwned = 0;
+		} else {
+			rowwise = 1;
+		}
+	}
+
 	switch (pngType) {
 	case PNG_COLOR_TYPE_RGB_ALPHA:
 		BytesPerPixel = ((depth >> 3) << 2) * sizeof(png_byte);
 		SrcBytesPerPixel = S->format.BytesPerPixel;
 		Debug(NULL, "Saving %ux%u %dbpp surface <%p> to %s [RGBA%d]\n",
 		    w,h, S->format.BitsPerPixel, S, path, depth);
-		for (y=0, pSrc=S->pixels; y < h; y++) {
+		for (y = 0; y < h; y++) {
+			pSrc = S->pixels + y*S->pitch;
+			if (!rowsOwned) {
+				rows[y] = pSrc;			/* Zero copy */
+				continue;
+			}
 			if ((row = png_malloc(png, w*BytesPerPixel)) == NULL) {
 				goto fail_row;
 			}
 			rows[y] = row;
+			if (rowwise) {
+				AG_PackedPixelConvertRow(row, &Lpng, pSrc, &Ls, w);
+				continue;
+			}
 			switch (depth) {
 			case 16:
 				for (x = 0; x < w; x++) {
@@ -413,7 +451,6 @@ AG_SurfaceExportPNG(const AG_Surface *S, const char *path, Uint flags)
 					pSrc += SrcBytesPerPixel;
 				}
 			}
-			pSrc += S->padding;
 		}
 		break;
 	case PNG_COLOR_TYPE_RGB:
@@ -422,10 +459,19 @@ AG_SurfaceExportPNG(const AG_Surface *S, const char *path, Uint flags)
 		Debug(NULL, "Saving %ux%u %dbpp surface <%p> to %s [RGB%d]\n",
 		    w,h, S->format.BitsPerPixel, S, path, depth);
 		for (y = 0; y < h; y++) {
+			pSrc = S->pixels + y*S->pitch;
+			if (!rowsOwned) {
+				rows[y] = pSrc;			/* Zero copy */
+				continue;
+			}
 			if ((row = png_malloc(png, w*BytesPerPixel)) == NULL) {
 				goto fail_row;
 			}
 			rows[y] = row;
+			if (rowwise) {
+				AG_PackedPixelConvertRow(row, &Lpng, pSrc, &Ls, w);
+				continue;
+			}
 			switch (depth) {
 			case 16:
 				for (x = 0; x < w; x++) {
@@ -453,7 +499,6 @@ AG_SurfaceExportPNG(const AG_Surface *S, const char *path, Uint flags)
 				}
 				break;
 			}
-			pSrc += S->padding;
 		}
 		break;
 	case PNG_COLOR_TYPE_PALETTE:				/* Use PLTE */
@@ -524,14 +569,14 @@ AG_SurfaceExportPNG(const AG_Surface *S, const char *path, Uint flags)
 
 	if (setjmp(png_jmpbuf(png))) {
 		AG_SetErrorS("png_write_image() failed");
-		for (y = 0; y < h; y++) { png_free(png, rows[y]); }
+		for (y = 0; y < h && rowsOwned; y++) { png_free(png, rows[y]); }
 		png_free(png, rows);
 		goto fail;
 	}
 	png_write_image(png, rows);
 	png_write_end(png, info);
 
-	for (y = 0; y < h; y++) { png_free(png, rows[y]); }
+	for (y = 0; y < h && rowsOwned; y++) { png_free(png, rows[y]); }
 	png_free(png, rows);
 	png_destroy_write_struct(&png, &info);
 	Free(plte);
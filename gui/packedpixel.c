@@ -29,6 +29,12 @@
 
 #include <string.h>
 
+#include <agar/config/have_sse2.h>
+#if defined(HAVE_SSE2) && defined(__SSE2__)
+# include <emmintrin.h>
+# define AG_PACKEDPIXEL_SSE2
+#endif
+
 /*
  * Flip the lines of a packed-pixel surface; this is useful with OpenGL
  * conversions.
@@ -56,3 +62,250 @@ AG_PackedPixelFlip(Uint8 *src, Uint h, int pitch)
 	Free(tmp);
 	return (0);
 }
+
+/*
+ * Describe the layout of a packed 24- or 32-bpp format with 8-bit, byte
+ * aligned components, for use with the row converters below. Return -1
+ * if the format does not qualify (the caller should fall back to the
+ * generic AG_GetColor() / AG_MapPixel() path).
+ */
+int
+AG_PackedPixelGetLayout(const AG_PixelFormat *pf, AG_PackedPixelLayout *L)
+{
+	if (pf->mode != AG_SURFACE_PACKED ||
+	    (pf->BitsPerPixel != 24 && pf->BitsPerPixel != 32) ||
+	    (pf->Rmask >> pf->Rshift) != 0xff || (pf->Rshift & 7) ||
+	    (pf->Gmask >> pf->Gshift) != 0xff || (pf->Gshift & 7) ||
+	    (pf->Bmask >> pf->Bshift) != 0xff || (pf->Bshift & 7)) {
+		return (-1);
+	}
+	if (pf->Amask != 0) {
+		if (pf->BitsPerPixel != 32 ||
+		    (pf->Amask >> pf->Ashift) != 0xff || (pf->Ashift & 7))
+			return (-1);
+	}
+	L->BytesPerPixel = pf->BytesPerPixel;
+	L->hasAlpha = (pf->Amask != 0);
+	L->Rshift = pf->Rshift;
+	L->Gshift = pf->Gshift;
+	L->Bshift = pf->Bshift;
+	L->Ashift = L->hasAlpha ? pf->Ashift : 0;
+	return (0);
+}
+
+/*
+ * Initialize a layout for R,G,B(,A) components stored in that byte order
+ * in memory (as used by libpng and libjpeg).
+ */
+void
+AG_PackedPixelLayoutRGB(AG_PackedPixelLayout *L, int alpha)
+{
+	L->hasAlpha = alpha;
+#if AG_BYTEORDER == AG_BIG_ENDIAN
+	if (alpha) {
+		L->BytesPerPixel = 4;
+		L->Rshift = 24;
+		L->Gshift = 16;
+		L->Bshift = 8;
+	} else {
+		L->BytesPerPixel = 3;
+		L->Rshift = 16;
+		L->Gshift = 8;
+		L->Bshift = 0;
+	}
+	L->Ashift = 0;
+#else
+	L->BytesPerPixel = alpha ? 4 : 3;
+	L->Rshift = 0;
+	L->Gshift = 8;
+	L->Bshift = 16;
+	L->Ashift = alpha ? 24 : 0;
+#endif
+}
+
+/* Return 0 if two layouts are identical. */
+int
+AG_PackedPixelLayoutCompare(const AG_PackedPixelLayout *a,
+    const AG_PackedPixelLayout *b)
+{
+	return !(a->BytesPerPixel == b->BytesPerPixel &&
+	         a->hasAlpha == b->hasAlpha &&
+	         a->Rshift == b->Rshift && a->Gshift == b->Gshift &&
+	         a->Bshift == b->Bshift && a->Ashift == b->Ashift);
+}
+
+/*
+ * Convert a row of n pixels between two packed layouts. Covers byte
+ * swizzling (e.g., RGBA <-> BGRA), RGB -> RGBA expansion (alpha is set
+ * opaque) and RGBA -> RGB reduction. The conversion can be done in place
+ * if both layouts have the same BytesPerPixel.
+ */
+void
+AG_PackedPixelConvertRow(Uint8 *dst, const AG_PackedPixelLayout *Ld,
+    const Uint8 *src, const AG_PackedPixelLayout *Ls, Uint n)
+{
+	const Uint sR = Ls->Rshift, sG = Ls->Gshift, sB = Ls->Bshift;
+	const Uint dR = Ld->Rshift, dG = Ld->Gshift, dB = Ld->Bshift;
+	const Uint sA = Ls->Ashift, dA = Ld->Ashift;
+	const Uint32 aMask = (Ls->hasAlpha && Ld->hasAlpha) ? 0xff : 0;
+	const Uint32 aFill = (!Ls->hasAlpha && Ld->hasAlpha) ? (0xffU << dA) : 0;
+	Uint i = 0;
+	Uint32 c;
+
+#define REPACK(c) ((((c) >> sR) & 0xff) << dR | \
+                   (((c) >> sG) & 0xff) << dG | \
+                   (((c) >> sB) & 0xff) << dB | \
+                   (((c) >> sA) & aMask) << dA | aFill)
+
+	if (Ls->BytesPerPixel == 4 && Ld->BytesPerPixel == 4) {
+		const Uint32 *pSrc = (const Uint32 *)src;
+		Uint32 *pDst = (Uint32 *)dst;
+#ifdef AG_PACKEDPIXEL_SSE2
+		const __m128i ff = _mm_set1_epi32(0xff);
+		const __m128i am = _mm_set1_epi32((int)aMask);
+		const __m128i fill = _mm_set1_epi32((int)aFill);
+		const __m128i csR = _mm_cvtsi32_si128(sR), cdR = _mm_cvtsi32_si128(dR);
+		const __m128i csG = _mm_cvtsi32_si128(sG), cdG = _mm_cvtsi32_si128(dG);
+		const __m128i csB = _mm_cvtsi32_si128(sB), cdB = _mm_cvtsi32_si128(dB);
+		const __m128i csA = _mm_cvtsi32_si128(sA), cdA = _mm_cvtsi32_si128(dA);
+
+		for (; i+4 <= n; i += 4) {
+			__m128i v = _mm_loadu_si128((const __m128i *)&pSrc[i]);
+			__m128i o;
+
+			o = _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(v,csR),ff), cdR);
+			o = _mm_or_si128(o,
+			    _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(v,csG),ff), cdG));
+			o = _mm_or_si128(o,
+			    _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(v,csB),ff), cdB));
+			o = _mm_or_si128(o,
+			    _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(v,csA),am), cdA));
+			o = _mm_or_si128(o, fill);
+			_mm_storeu_si128((__m128i *)&pDst[i], o);
+		}
+#endif
+		for (; i < n; i++) {
+			c = pSrc[i];
+			pDst[i] = REPACK(c);
+		}
+	} else if (Ls->BytesPerPixel == 3 && Ld->BytesPerPixel == 4) {
+		Uint32 *pDst = (Uint32 *)dst;
+
+		for (; i < n; i++) {
+			AG_PACKEDPIXEL_GET(3, c, src);
+			pDst[i] = REPACK(c);
+			src += 3;
+		}
+	} else if (Ls->BytesPerPixel == 4) {
+		const Uint32 *pSrc = (const Uint32 *)src;
+
+		for (; i < n; i++) {
+			c = pSrc[i];
+			c = REPACK(c);
+			AG_PACKEDPIXEL_PUT(3, dst, c);
+			dst += 3;
+		}
+	} else {
+		for (; i < n; i++) {
+			AG_PACKEDPIXEL_GET(3, c, src);
+			c = REPACK(c);
+			AG_PACKEDPIXEL_PUT(3, dst, c);
+			src += 3;
+			dst += 3;
+		}
+	}
+#undef REPACK
+}
+
+/*
+ * Expand a row of n 8-bit colormap indices to packed 24- or 32-bit pixels
+ * using a 256-entry lookup table of destination pixel values.
+ */
+void
+AG_PackedPixelLookupRow(Uint8 *dst, int BytesPerPixel, const Uint8 *src,
+    const Uint32 *lut, Uint n)
+{
+	Uint i;
+
+	if (BytesPerPixel == 4) {
+		Uint32 *pDst = (Uint32 *)dst;
+
+		for (i = 0; i < n; i++)
+			pDst[i] = lut[src[i]];
+	} else {
+		for (i = 0; i < n; i++) {
+			const Uint32 c = lut[src[i]];
+
+			AG_PACKEDPIXEL_PUT(3, dst, c);
+			dst += 3;
+		}
+	}
+}
+
+/* Return c*a/255, rounded to nearest. */
+static __inline__ Uint32
+Premultiply8(Uint32 c, Uint32 a)
+{
+	Uint32 t = c*a + 128;
+
+	return ((t + (t >> 8)) >> 8);
+}
+
+/*
+ * Multiply the color components of a row of n pixels by their alpha
+ * (in place). Layouts without an alpha component are left unchanged.
+ */
+void
+AG_PackedPixelPremultiplyRow(Uint8 *pixels, const AG_PackedPixelLayout *L,
+    Uint n)
+{
+	const Uint sR = L->Rshift, sG = L->Gshift, sB = L->Bshift;
+	const Uint sA = L->Ashift;
+	Uint32 *p = (Uint32 *)pixels;
+	Uint i = 0;
+
+	if (!L->hasAlpha || L->BytesPerPixel != 4)
+		return;
+#ifdef AG_PACKEDPIXEL_SSE2
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i ff = _mm_set1_epi32(0xff);
+		const __m128i half = _mm_set1_epi16(128);
+		const __m128i aKeep = _mm_set1_epi32((int)(0xffU << sA));
+		const __m128i csA = _mm_cvtsi32_si128(sA);
+
+		/*
+		 * Broadcast alpha to all four bytes (the alpha byte itself
+		 * gets multiplied by 255) and multiply in 16-bit lanes.
+		 */
+		for (; i+4 <= n; i += 4) {
+			__m128i v = _mm_loadu_si128((const __m128i *)&p[i]);
+			__m128i a, lo, hi;
+
+			a = _mm_and_si128(_mm_srl_epi32(v, csA), ff);
+			a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+			a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+			a = _mm_or_si128(a, aKeep);
+
+			lo = _mm_mullo_epi16(_mm_unpacklo_epi8(v, zero),
+			                     _mm_unpacklo_epi8(a, zero));
+			hi = _mm_mullo_epi16(_mm_unpackhi_epi8(v, zero),
+			                     _mm_unpackhi_epi8(a, zero));
+			lo = _mm_add_epi16(lo, half);
+			hi = _mm_add_epi16(hi, half);
+			lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo,8)), 8);
+			hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi,8)), 8);
+			_mm_storeu_si128((__m128i *)&p[i], _mm_packus_epi16(lo, hi));
+		}
+	}
+#endif
+	for (; i < n; i++) {
+		const Uint32 c = p[i];
+		const Uint32 a = (c >> sA) & 0xff;
+
+		p[i] = Premultiply8((c >> sR) & 0xff, a) << sR |
+		       Premultiply8((c >> sG) & 0xff, a) << sG |
+		       Premultiply8((c >> sB) & 0xff, a) << sB |
+		       a << sA;
+	}
+}
@@ -93,8 +93,33 @@
 	AG_PACKEDPIXEL_PUT((Bpp),p,(c));			\
 } while (0)
 
+/*
+ * Component layout of a packed 24- or 32-bpp format with 8-bit components,
+ * as used by the AG_PackedPixel*Row() converters.
+ */
+typedef struct ag_packed_pixel_layout {
+	int BytesPerPixel;			/* 3 or 4 */
+	int hasAlpha;				/* Alpha component present */
+	Uint8 Rshift, Gshift, Bshift, Ashift;	/* Bits at right of component */
+} AG_PackedPixelLayout;
+
+struct ag_pixel_format;
+
 __BEGIN_DECLS
-int AG_PackedPixelFlip(Uint8 *_Nonnull, Uint, int);
+int  AG_PackedPixelFlip(Uint8 *_Nonnull, Uint, int);
+int  AG_PackedPixelGetLayout(const struct ag_pixel_format *_Nonnull,
+                             AG_PackedPixelLayout *_Nonnull);
+void AG_PackedPixelLayoutRGB(AG_PackedPixelLayout *_Nonnull, int);
+int  AG_PackedPixelLayoutCompare(const AG_PackedPixelLayout *_Nonnull,
+                                 const AG_PackedPixelLayout *_Nonnull);
+void AG_PackedPixelConvertRow(Uint8 *_Nonnull,
+                              const AG_PackedPixelLayout *_Nonnull,
+                              const Uint8 *_Nonnull,
+                              const AG_PackedPixelLayout *_Nonnull, Uint);
+void AG_PackedPixelLookupRow(Uint8 *_Nonnull, int, const Uint8 *_Nonnull,
+                             const Uint32 *_Nonnull, Uint);
+void AG_PackedPixelPremultiplyRow(Uint8 *_Nonnull,
+                                  const AG_PackedPixelLayout *_Nonnull, Uint);
 __END_DECLS
 
 #include <agar/gui/close.h>
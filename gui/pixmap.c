@@ -280,6 +280,66 @@ AG_PixmapAddSurfaceFromFile(AG_Pixmap *px, const char *path)
 	AG_SurfaceFree(suFile);
 	return (name);
 }
+
+/* Replace a placeholder surface once its image file has been decoded. */
+static void
+PixmapLoaded(AG_Event *_Nonnull event)
+{
+	AG_Pixmap *px = AG_SELF();
+	const int name = AG_INT(1);
+	const AG_Surface *S = AG_PTR(2);
+	AG_Surface *su;
+
+	if (S == NULL) {
+		Verbose("%s: %s\n", AG_STRING(3), AG_GetError());
+		return;
+	}
+	if ((su = AG_SurfaceConvert(S, agSurfaceFmt)) == NULL) {
+		return;
+	}
+	AG_PixmapReplaceSurface(px, name, su);
+	px->flags |= AG_PIXMAP_UPDATE;
+	if ((px->flags & AG_PIXMAP_FORCE_SIZE) == 0)
+		AG_WidgetUpdate(px);
+}
+
+/*
+ * Map an empty placeholder surface and load the image file in the
+ * background (see AG_SurfaceLoadAsync(3)). The placeholder is replaced
+ * once the file has been decoded.
+ * Returned surface ID is valid as long as pixmap is locked.
+ */
+int
+AG_PixmapAddSurfaceFromFileAsync(AG_Pixmap *px, const char *path)
+{
+	int name;
+
+	AG_ObjectLock(px);
+	name = AG_WidgetMapSurface(px, AG_SurfaceEmpty());
+	if (AG_SurfaceLoadAsync(px, path, PixmapLoaded, "%i", name) == -1) {
+		AG_WidgetUnmapSurface(px, name);
+		name = -1;
+	}
+	AG_ObjectUnlock(px);
+	return (name);
+}
+
+/*
+ * Create a new w x h pixmap and load its contents from an image file
+ * in the background. The pixmap is empty until the file is decoded.
+ */
+AG_Pixmap *
+AG_PixmapFromFileAsync(void *parent, Uint flags, const char *path,
+    Uint w, Uint h)
+{
+	AG_Pixmap *px;
+
+	px = AG_PixmapNew(parent, flags, w,h);
+	if (AG_SurfaceLoadAsync(px, path, PixmapLoaded, "%i", 0) == -1) {
+		Verbose("%s: %s\n", path, AG_GetError());
+	}
+	return (px);
+}
 #endif /* AG_SERIALIZATION */
 
 /* Replace the contents of a mapped surface. */
@@ -323,6 +383,14 @@ AG_PixmapSetCoords(AG_Pixmap *px, int s, int t)
 	AG_ObjectUnlock(px);
 }
 
+#ifdef AG_SERIALIZATION
+static void
+Destroy(void *_Nonnull obj)
+{
+	AG_SurfaceLoadCancel(obj);
+}
+#endif
+
 static void
 Init(void *_Nonnull obj)
 {
@@ -429,7 +497,11 @@ AG_WidgetClass agPixmapClass = {
 		{ 0,0 },
 		Init,
 		NULL,		/* reset */
+#ifdef AG_SERIALIZATION
+		Destroy,
+#else
 		NULL,		/* destroy */
+#endif
 		NULL,		/* load */
 		NULL,		/* save */
 		NULL		/* edit */
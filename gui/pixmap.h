@@ -45,6 +45,9 @@ int AG_PixmapAddSurfaceScaled(AG_Pixmap *_Nonnull, const AG_Surface *_Nonnull,
                               Uint,Uint);
 #ifdef AG_SERIALIZATION
 int AG_PixmapAddSurfaceFromFile(AG_Pixmap *_Nonnull, const char *_Nonnull);
+int AG_PixmapAddSurfaceFromFileAsync(AG_Pixmap *_Nonnull, const char *_Nonnull);
+AG_Pixmap *_Nonnull AG_PixmapFromFileAsync(void *_Nullable, Uint,
+                                           const char *_Nonnull, Uint,Uint);
 #endif
 
 void AG_PixmapReplaceSurface(AG_Pixmap *_Nonnull, int, AG_Surface *_Nonnull);
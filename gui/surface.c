@@ -26,6 +26,7 @@
 #include <agar/core/core.h>
 #include <agar/gui/surface.h>
 #include <agar/gui/gui_math.h>
+#include <agar/gui/packedpixel.h>
 
 #include <agar/config/have_opengl.h>
 
@@ -677,6 +678,40 @@ AG_SurfaceSetPixels(AG_Surface *S, const AG_Color *c)
 	}
 }
 
+/*
+ * Multiply the color components of every pixel by its alpha component.
+ * Surfaces without an alpha channel are left unchanged.
+ */
+void
+AG_SurfacePremultiplyAlpha(AG_Surface *S)
+{
+	AG_PackedPixelLayout L;
+	Uint8 *p = S->pixels;
+	Uint x, y;
+
+	if (S->format.mode != AG_SURFACE_PACKED || S->format.Amask == 0)
+		return;
+
+	if (AG_PackedPixelGetLayout(&S->format, &L) == 0) {
+		for (y = 0; y < S->h; y++) {
+			AG_PackedPixelPremultiplyRow(p, &L, S->w);
+			p += S->pitch;
+		}
+		return;
+	}
+	for (y = 0; y < S->h; y++) {
+		for (x = 0; x < S->w; x++) {
+			AG_Color c;
+
+			AG_GetColor(&c, AG_SurfaceGet(S,x,y), &S->format);
+			c.r = (Uint32)c.r * c.a / AG_COLOR_LAST;
+			c.g = (Uint32)c.g * c.a / AG_COLOR_LAST;
+			c.b = (Uint32)c.b * c.a / AG_COLOR_LAST;
+			AG_SurfacePut(S, x,y, AG_MapPixel(&S->format, &c));
+		}
+	}
+}
+
 /* Return a newly-allocated duplicate of a surface (in the same format). */
 AG_Surface *
 AG_SurfaceDup(const AG_Surface *a)
@@ -725,6 +760,7 @@ AG_SurfaceConvert(const AG_Surface *a, const AG_PixelFormat *pf)
 void
 AG_SurfaceCopy(AG_Surface *D, const AG_Surface *S)
 {
+	AG_PackedPixelLayout Ls, Ld;
 	Uint w = MIN(S->w, D->w);
 	Uint h = MIN(S->h, D->h);
 	int x, y;
@@ -764,12 +800,47 @@ AG_SurfaceCopy(AG_Surface *D, const AG_Surface *S)
 			pSrc += pitch + Spadding;
 			pDst += pitch + Dpadding;
 		}
+	} else if (AG_PackedPixelGetLayout(&D->format, &Ld) == 0 &&
+	           (AG_PackedPixelGetLayout(&S->format, &Ls) == 0 ||
+	            (S->format.mode == AG_SURFACE_INDEXED &&
+		     S->format.BitsPerPixel == 8))) {            /* Rowwise */
+		const Uint8 *pSrc = S->pixels;
+		Uint8 *pDst = D->pixels;
+#ifdef AG_DEBUG
+		if (S->flags & AG_SURFACE_TRACE)
+			Debug(NULL, "Surface <%p>: Rowwise Copy\n", S);
+#endif
+		if (S->format.mode == AG_SURFACE_INDEXED) {
+			const AG_Palette *pal = S->format.palette;
+			Uint32 lut[256];
+			Uint i;
+
+			if (pal->nColors > 0) {
+				for (i = 0; i < 256; i++) {
+					lut[i] = (Uint32)AG_MapPixel(&D->format,
+					    &pal->colors[i % pal->nColors]);
+				}
+			} else {
+				memset(lut, 0, sizeof(lut));  /* Empty palette */
+			}
+			for (y = 0; y < h; y++) {
+				AG_PackedPixelLookupRow(pDst, Ld.BytesPerPixel,
+				    pSrc, lut, w);
+				pSrc += S->pitch;
+				pDst += D->pitch;
+			}
+		} else {
+			for (y = 0; y < h; y++) {
+				AG_PackedPixelConvertRow(pDst, &Ld, pSrc, &Ls, w);
+				pSrc += S->pitch;
+				pDst += D->pitch;
+			}
+		}
 	} else {                                                 /* Pixelwise */
 #ifdef AG_DEBUG
 		if (S->flags & AG_SURFACE_TRACE)
 			Debug(NULL, "Surface <%p>: Pixelwise Copy\n", S);
 #endif
-		/* TODO optimized cases */
 		for (y = 0; y < h; y++) {
 			for (x = 0; x < w; x++) {
 				AG_Pixel px;
@@ -793,7 +864,7 @@ AG_SurfaceCopy(AG_Surface *D, const AG_Surface *S)
  */
 static void
 AG_SurfaceBlit_AlCo(const AG_Surface *_Nonnull S, AG_Surface *_Nonnull D,
-    const AG_Rect *_Nonnull dr, int xDst, int yDst)
+    const AG_Rect *_Nonnull sr, const AG_Rect *_Nonnull dr)
 {
 	AG_Pixel srcColorkey = S->colorkey;
 	int x,y;
@@ -809,7 +880,7 @@ AG_SurfaceBlit_AlCo(const AG_Surface *_Nonnull S, AG_Surface *_Nonnull D,
 			AG_Pixel px;
 			AG_Color c;
 
-			px = AG_SurfaceGet(S, x,y);
+			px = AG_SurfaceGet(S, sr->x+x, sr->y+y);
 			if (px == srcColorkey) {
 				continue;
 			}
@@ -818,7 +889,8 @@ AG_SurfaceBlit_AlCo(const AG_Surface *_Nonnull S, AG_Surface *_Nonnull D,
 			if (c.a == AG_TRANSPARENT) {
 				continue;
 			}
-			AG_SurfaceBlend(D, xDst+x, yDst+y, &c, AG_ALPHA_OVERLAY);
+			AG_SurfaceBlend(D, dr->x+x, dr->y+y, &c,
+			    AG_ALPHA_OVERLAY);
 		}
 	}
 }
@@ -829,7 +901,7 @@ AG_SurfaceBlit_AlCo(const AG_Surface *_Nonnull S, AG_Surface *_Nonnull D,
  */
 static void
 AG_SurfaceBlit_Co(const AG_Surface *_Nonnull S, AG_Surface *_Nonnull D,
-    const AG_Rect *_Nonnull dr, int xDst, int yDst)
+    const AG_Rect *_Nonnull sr, const AG_Rect *_Nonnull dr)
 {
 	AG_Pixel srcColorkey = S->colorkey;
 	int w = dr->w;
@@ -845,7 +917,7 @@ AG_SurfaceBlit_Co(const AG_Surface *_Nonnull S, AG_Surface *_Nonnull D,
 			AG_Pixel px;
 			AG_Color c;
 
-			px = AG_SurfaceGet(S, x,y);
+			px = AG_SurfaceGet(S, sr->x+x, sr->y+y);
 			if (px == srcColorkey) {
 				continue;
 			}
@@ -854,10 +926,10 @@ AG_SurfaceBlit_Co(const AG_Surface *_Nonnull S, AG_Surface *_Nonnull D,
 				continue;
 			}
 			if (c.a == AG_OPAQUE) {
-				AG_SurfacePut(D, xDst+x, yDst+y,
+				AG_SurfacePut(D, dr->x+x, dr->y+y,
 				    AG_MapPixel(&D->format, &c));
 			} else {
-				AG_SurfaceBlend(D, xDst+x, yDst+y, &c,
+				AG_SurfaceBlend(D, dr->x+x, dr->y+y, &c,
 				    AG_ALPHA_OVERLAY);
 			}
 		}
@@ -918,24 +990,14 @@ AG_SurfaceBlit(const AG_Surface *S, const AG_Rect *srcRect, AG_Surface *D,
 	if (!AG_RectIntersect(&dr, &dr, &D->clipRect)) {
 		return;
 	}
-	if (dr.w < sr.w) {					/* Partial */
-		int diff = (sr.w - dr.w);
-		if (xDst+sr.w < D->clipRect.x + D->clipRect.w) {
-			sr.x += diff;
-		}
-		sr.w -= diff;
-	}
-	if (dr.h < sr.h) {
-		int diff = (sr.h - dr.h);
-		if (yDst+sr.h < D->clipRect.y + D->clipRect.h) {
-			sr.y += diff;
-		}
-		sr.h -= diff;
-	}
+	sr.x += dr.x - xDst;				/* Partial */
+	sr.y += dr.y - yDst;
+	sr.w = dr.w;
+	sr.h = dr.h;
 
 	if (S->alpha < AG_OPAQUE) {
 		if (S->flags & AG_SURFACE_COLORKEY) {
-			AG_SurfaceBlit_AlCo(S, D, &dr, xDst,yDst);
+			AG_SurfaceBlit_AlCo(S, D, &sr, &dr);
 			return;
 		}
 		for (y = 0; y < dr.h; y++) {
@@ -943,21 +1005,21 @@ AG_SurfaceBlit(const AG_Surface *S, const AG_Rect *srcRect, AG_Surface *D,
 				AG_Pixel px;
 				AG_Color c;
 			
-				px = AG_SurfaceGet(S, x,y);
+				px = AG_SurfaceGet(S, sr.x+x, sr.y+y);
 				AG_GetColor(&c, px, &S->format);
 
 				c.a = MIN(c.a, S->alpha);
 				if (c.a == AG_TRANSPARENT) {
 					continue;
 				}
-				AG_SurfaceBlend(D, xDst+x, yDst+y, &c,
+				AG_SurfaceBlend(D, dr.x+x, dr.y+y, &c,
 				    AG_ALPHA_OVERLAY);
 			}
 		}
 		return;
 	}
 	if (S->flags & AG_SURFACE_COLORKEY) {
-		AG_SurfaceBlit_Co(S, D, &dr, xDst,yDst);
+		AG_SurfaceBlit_Co(S, D, &sr, &dr);
 		return;
 	}
 	if (S->format.Amask != 0) {
@@ -966,17 +1028,17 @@ AG_SurfaceBlit(const AG_Surface *S, const AG_Rect *srcRect, AG_Surface *D,
 				AG_Pixel px;
 				AG_Color c;
 			
-				px = AG_SurfaceGet(S, x,y);
+				px = AG_SurfaceGet(S, sr.x+x, sr.y+y);
 				AG_GetColor(&c, px, &S->format);
 
 				if (c.a == AG_TRANSPARENT) {
 					continue;
 				}
 				if (c.a < AG_OPAQUE) {
-					AG_SurfaceBlend(D, xDst+x,yDst+y, &c,
+					AG_SurfaceBlend(D, dr.x+x, dr.y+y, &c,
 					    AG_ALPHA_OVERLAY);
 				} else {
-					AG_SurfacePut(D, xDst+x,yDst+y,
+					AG_SurfacePut(D, dr.x+x, dr.y+y,
 					    AG_MapPixel(&D->format, &c));
 				}
 			}
@@ -987,9 +1049,9 @@ AG_SurfaceBlit(const AG_Surface *S, const AG_Rect *srcRect, AG_Surface *D,
 				AG_Pixel px;
 				AG_Color c;
 
-				px = AG_SurfaceGet(S, x,y);
+				px = AG_SurfaceGet(S, sr.x+x, sr.y+y);
 				AG_GetColor(&c, px, &S->format);
-				AG_SurfacePut(D, xDst+x, yDst+y,
+				AG_SurfacePut(D, dr.x+x, dr.y+y,
 				    AG_MapPixel(&D->format, &c));
 			}
 		}
@@ -1286,10 +1348,10 @@ AG_MapPixel32_RGB8(const AG_PixelFormat *pf, Uint8 r, Uint8 g, Uint8 b)
 	switch (pf->mode) {
 	case AG_SURFACE_PACKED:
 	default:
-		return (r    >> pf->Rloss) << pf->Rshift |
-		       (g    >> pf->Gloss) << pf->Gshift |
-		       (b    >> pf->Bloss) << pf->Bshift |
-		      ((0xff >> pf->Aloss) << pf->Ashift & (Uint32)pf->Amask);
+		return (AG_8toH(r) >> pf->Rloss) << pf->Rshift |
+		       (AG_8toH(g) >> pf->Gloss) << pf->Gshift |
+		       (AG_8toH(b) >> pf->Bloss) << pf->Bshift |
+		      ((AG_OPAQUE  >> pf->Aloss) << pf->Ashift & (Uint32)pf->Amask);
 	case AG_SURFACE_INDEXED:
 		return AG_MapPixelIndexed(pf,
 		    AG_8toH(r),
@@ -1314,10 +1376,10 @@ AG_MapPixel32_RGBA8(const AG_PixelFormat *pf, Uint8 r, Uint8 g, Uint8 b, Uint8 a
 	switch (pf->mode) {
 	case AG_SURFACE_PACKED:
 	default:
-		return (r >> pf->Rloss) << pf->Rshift |
-		       (g >> pf->Gloss) << pf->Gshift |
-		       (b >> pf->Bloss) << pf->Bshift |
-		      ((a >> pf->Aloss) << pf->Ashift & (Uint32)pf->Amask);
+		return (AG_8toH(r) >> pf->Rloss) << pf->Rshift |
+		       (AG_8toH(g) >> pf->Gloss) << pf->Gshift |
+		       (AG_8toH(b) >> pf->Bloss) << pf->Bshift |
+		      ((AG_8toH(a) >> pf->Aloss) << pf->Ashift & (Uint32)pf->Amask);
 	case AG_SURFACE_INDEXED:
 		return AG_MapPixelIndexed(pf,
 		    AG_8toH(r),
@@ -1342,10 +1404,10 @@ AG_MapPixel32_RGB16(const AG_PixelFormat *pf, Uint16 r, Uint16 g, Uint16 b)
 	switch (pf->mode) {
 	case AG_SURFACE_PACKED:
 	default:
-		return (AG_16to8(r) >> pf->Rloss) << pf->Rshift |
-		       (AG_16to8(g) >> pf->Gloss) << pf->Gshift |
-		       (AG_16to8(b) >> pf->Bloss) << pf->Bshift |
-		      ((0xff        >> pf->Aloss) << pf->Ashift & (Uint32)pf->Amask);
+		return (AG_16toH(r) >> pf->Rloss) << pf->Rshift |
+		       (AG_16toH(g) >> pf->Gloss) << pf->Gshift |
+		       (AG_16toH(b) >> pf->Bloss) << pf->Bshift |
+		      ((AG_OPAQUE   >> pf->Aloss) << pf->Ashift & (Uint32)pf->Amask);
 	case AG_SURFACE_INDEXED:
 		return AG_MapPixelIndexed(pf,
 		    AG_16toH(r),
@@ -1371,15 +1433,23 @@ AG_MapPixel32_RGBA16(const AG_PixelFormat *pf, Uint16 r, Uint16 g, Uint16 b,
 	switch (pf->mode) {
 	case AG_SURFACE_PACKED:
 	default:
-		return (AG_16to8(r) >> pf->Rloss) << pf->Rshift |
-		       (AG_16to8(g) >> pf->Gloss) << pf->Gshift |
-		       (AG_16to8(b) >> pf->Bloss) << pf->Bshift |
-		      ((AG_16to8(a) >> pf->Aloss) << pf->Ashift & (Uint32)pf->Amask);
+		return (AG_16toH(r) >> pf->Rloss) << pf->Rshift |
+		       (AG_16toH(g) >> pf->Gloss) << pf->Gshift |
+		       (AG_16toH(b) >> pf->Bloss) << pf->Bshift |
+		      ((AG_16toH(a) >> pf->Aloss) << pf->Ashift & (Uint32)pf->Amask);
 	case AG_SURFACE_INDEXED:
-		return AG_MapPixelIndexed(pf, r,g,b,a);
+		return AG_MapPixelIndexed(pf,
+		    AG_16toH(r),
+		    AG_16toH(g),
+		    AG_16toH(b),
+		    AG_16toH(a));
 #ifdef HAVE_FLOAT
 	case AG_SURFACE_GRAYSCALE:
-		return AG_MapPixelGrayscale(pf, r,g,b,a);
+		return AG_MapPixelGrayscale(pf,
+		    AG_16toH(r),
+		    AG_16toH(g),
+		    AG_16toH(b),
+		    AG_16toH(a));
 #endif
 	}
 }
@@ -174,6 +174,13 @@ typedef enum ag_alpha_func {
 	AG_ALPHA_LAST
 } AG_AlphaFn;
 
+/* Flags for AG_SurfaceFromFiles() */
+#define AG_SURFACE_LOAD_ASYNC 0x01	/* Return immediately */
+
+/* Completion callback for AG_SurfaceFromFiles() */
+typedef void (*AG_SurfaceLoadFn)(AG_Surface *_Nullable,
+                                 const char *_Nonnull, void *_Nullable);
+
 /* Flags for AG_SurfaceExportBMP () */
 #define AG_EXPORT_BMP_NO_32BIT 0x01	/* Don't export a 32-bit BMP even when
                                            surface has an alpha channel */
@@ -243,6 +250,7 @@ void AG_SurfaceSetColors(AG_Surface *_Nonnull, AG_Color *_Nonnull, Uint, Uint);
 void AG_SurfaceSetPalette(AG_Surface *_Nonnull, const AG_Palette *_Nonnull);
 void AG_SurfaceCopyPixels(AG_Surface *_Nonnull, const Uint8 *_Nonnull);
 void AG_SurfaceSetPixels(AG_Surface *_Nonnull, const AG_Color *_Nonnull);
+void AG_SurfacePremultiplyAlpha(AG_Surface *_Nonnull);
 
 void AG_SurfaceBlit(const AG_Surface *_Nonnull, const AG_Rect *_Nullable,
 		    AG_Surface *_Nonnull, int,int);
@@ -272,6 +280,19 @@ AG_Surface *_Nullable AG_SurfaceFromFile(const char *_Nonnull)
                                         _Warn_Unused_Result;
 int                   AG_SurfaceExportFile(const AG_Surface *_Nonnull,
                                            const char *_Nonnull);
+int                   AG_SurfaceFromFiles(const char *_Nonnull const *_Nonnull,
+                                          Uint, Uint, Uint,
+                                          _Nonnull AG_SurfaceLoadFn,
+                                          void *_Nullable);
+
+int  AG_SurfaceLoadAsync(void *_Nonnull, const char *_Nonnull,
+                         _Nonnull AG_EventFn, const char *_Nullable, ...);
+void AG_SurfaceLoadCancel(void *_Nonnull);
+int  AG_SurfaceLoadProcess(void);
+void AG_SurfaceCacheSetSize(AG_Size);
+void AG_SurfaceCacheClear(void);
+void AG_InitSurfaceLoader(void);
+void AG_DestroySurfaceLoader(void);
 
 AG_Surface *_Nullable AG_SurfaceFromBMP(const char *_Nonnull)
                                        _Warn_Unused_Result;
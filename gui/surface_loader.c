@@ -0,0 +1,827 @@
+/*
+ * Copyright (c) 2026 Julien Nadeau Carriere <vedge@csoft.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Image loader. Image files are decoded by a persistent pool of worker
+ * threads, which is grown on demand and stopped by AG_DestroyGUI().
+ *
+ * AG_SurfaceFromFiles() submits batches of files to the pool and invokes
+ * a callback from the decoding threads. AG_SurfaceLoadAsync() submits
+ * single files whose surfaces are handed back to the GUI thread, where
+ * completion handlers are invoked from the event loop. Surfaces decoded
+ * for AG_SurfaceLoadAsync() are cached by path and modification time.
+ */
+
+#include <agar/config/ag_serialization.h>
+#include <agar/core/core.h>
+
+#ifdef AG_SERIALIZATION
+
+#include <agar/gui/surface.h>
+
+#include <agar/config/_mk_have_sys_stat_h.h>
+#ifdef _MK_HAVE_SYS_STAT_H
+# include <sys/types.h>
+# include <sys/stat.h>
+#endif
+#if defined(AG_THREADS) && !defined(_WIN32)
+# include <unistd.h>
+# include <fcntl.h>
+# define AG_SURFACE_LOADER_PIPE
+#endif
+
+#include <string.h>
+
+#ifndef AG_SURFACE_LOADER_THREADS
+#define AG_SURFACE_LOADER_THREADS 2		/* Threads for async requests */
+#endif
+#define AG_SURFACE_LOAD_THREADS_DEFAULT 4	/* Threads for a batch */
+#define AG_SURFACE_LOAD_THREADS_MAX     32	/* Size limit of the pool */
+#if AG_MODEL == AG_SMALL
+# define AG_SURFACE_CACHE_SIZE_DEFAULT 0x4000
+#else
+# define AG_SURFACE_CACHE_SIZE_DEFAULT 0x2000000
+#endif
+
+/* A request to load an image file. */
+typedef struct ag_surface_load_req {
+	char *_Nonnull path;			/* Image file */
+	void *_Nullable obj;			/* Owner object (NULL = cancelled) */
+	time_t mtime;				/* Modification time of file */
+	AG_Surface *_Nullable S;		/* Decoded surface */
+	char *_Nullable errMsg;			/* Error message (if S is NULL) */
+	AG_Event ev;				/* Completion handler */
+	AG_TAILQ_ENTRY(ag_surface_load_req) reqs;
+} AG_SurfaceLoadReq;
+
+/* A batch of image files submitted by AG_SurfaceFromFiles(). */
+typedef struct ag_surface_load_batch {
+	char *_Nonnull *_Nonnull paths;		/* Image files */
+	Uint count;				/* Number of paths */
+	Uint next;				/* Next path to decode */
+	Uint nDone;				/* Paths decoded */
+	Uint nLoaded;				/* Surfaces successfully loaded */
+	Uint nRunning;				/* Paths being decoded */
+	Uint nThreads;				/* Limit on nRunning */
+	Uint flags;				/* AG_SURFACE_LOAD_* flags */
+	AG_SurfaceLoadFn fn;			/* Completion callback */
+	void *_Nullable arg;			/* User argument to fn */
+#ifdef AG_THREADS
+	_Nonnull_Cond AG_Cond done;		/* Progress (synchronous mode) */
+#endif
+	AG_TAILQ_ENTRY(ag_surface_load_batch) batches;
+} AG_SurfaceLoadBatch;
+
+/* A decoded surface in the cache. */
+typedef struct ag_surface_cache_ent {
+	char *_Nonnull path;			/* Image file (key) */
+	time_t mtime;				/* Modification time of file */
+	AG_Surface *_Nonnull S;			/* Decoded surface */
+	AG_Size size;				/* Size of pixel data in bytes */
+	AG_TAILQ_ENTRY(ag_surface_cache_ent) ents;  /* In LRU order */
+} AG_SurfaceCacheEnt;
+
+static int loaderInited = 0;			/* Pool and queues */
+static int loaderGUI = 0;			/* Delivery and cache */
+static TAILQ_HEAD(ag_surface_load_reqq, ag_surface_load_req) loaderPending;
+static struct ag_surface_load_reqq loaderActive;	/* Being decoded */
+static struct ag_surface_load_reqq loaderDone;	/* Awaiting delivery */
+static TAILQ_HEAD(ag_surface_load_batchq, ag_surface_load_batch) loaderBatches;
+#ifdef AG_THREADS
+static _Nonnull_Mutex AG_Mutex loaderLock;
+static _Nonnull_Cond AG_Cond loaderCond;
+static AG_Thread loaderThreads[AG_SURFACE_LOAD_THREADS_MAX];
+static Uint loaderThreadCount = 0;
+static int loaderExit = 0;
+#endif
+#ifdef AG_SURFACE_LOADER_PIPE
+static int loaderPipe[2] = { -1, -1 };
+static AG_EventSink *_Nullable loaderSink = NULL;
+#endif
+static AG_EventSink *_Nullable loaderEpilogue = NULL;
+
+static AG_Tbl *_Nullable cacheTbl = NULL;
+static TAILQ_HEAD(ag_surface_cache_entq, ag_surface_cache_ent) cacheLRU;
+static AG_Size cacheSize = 0;
+static AG_Size cacheSizeMax = AG_SURFACE_CACHE_SIZE_DEFAULT;
+
+static time_t
+GetFileMTime(const char *_Nonnull path)
+{
+#ifdef _MK_HAVE_SYS_STAT_H
+	struct stat sb;
+
+	if (stat(path, &sb) == 0)
+		return (sb.st_mtime);
+#endif
+	return (0);
+}
+
+/*
+ * Decoded surface cache. Only accessed from the GUI thread.
+ */
+static void
+CacheFreeEnt(AG_SurfaceCacheEnt *_Nonnull ce)
+{
+	AG_TblDelete(cacheTbl, ce->path);
+	TAILQ_REMOVE(&cacheLRU, ce, ents);
+	cacheSize -= ce->size;
+	AG_SurfaceFree(ce->S);
+	free(ce->path);
+	free(ce);
+}
+
+static void
+CacheEvict(void)
+{
+	AG_SurfaceCacheEnt *ce;
+
+	while (cacheSize > cacheSizeMax &&
+	      (ce = TAILQ_LAST(&cacheLRU, ag_surface_cache_entq)) != NULL)
+		CacheFreeEnt(ce);
+}
+
+static AG_Surface *_Nullable
+CacheLookup(const char *_Nonnull path, time_t mtime)
+{
+	void *p;
+	AG_SurfaceCacheEnt *ce;
+
+	if (cacheTbl == NULL ||
+	    AG_TblLookupPointer(cacheTbl, path, &p) == -1) {
+		return (NULL);
+	}
+	ce = p;
+	if (ce->mtime != mtime) {			/* File has changed */
+		CacheFreeEnt(ce);
+		return (NULL);
+	}
+	if (ce != TAILQ_FIRST(&cacheLRU)) {
+		TAILQ_REMOVE(&cacheLRU, ce, ents);
+		TAILQ_INSERT_HEAD(&cacheLRU, ce, ents);
+	}
+	return (ce->S);
+}
+
+/* Insert a surface into the cache; the cache takes ownership of S. */
+static void
+CacheInsert(const char *_Nonnull path, time_t mtime, AG_Surface *_Nonnull S)
+{
+	AG_SurfaceCacheEnt *ce;
+	void *p;
+
+	if (cacheTbl != NULL &&
+	    AG_TblLookupPointer(cacheTbl, path, &p) == 0)
+		CacheFreeEnt((AG_SurfaceCacheEnt *)p);
+
+	if ((ce = TryMalloc(sizeof(AG_SurfaceCacheEnt))) == NULL) {
+		goto fail;
+	}
+	if ((ce->path = TryStrdup(path)) == NULL) {
+		free(ce);
+		goto fail;
+	}
+	if (AG_TblInsertPointer(cacheTbl, path, ce) == -1) {
+		free(ce->path);
+		free(ce);
+		goto fail;
+	}
+	ce->mtime = mtime;
+	ce->S = S;
+	ce->size = (AG_Size)S->h * S->pitch;
+	TAILQ_INSERT_HEAD(&cacheLRU, ce, ents);
+	cacheSize += ce->size;
+	return;
+fail:
+	AG_SurfaceFree(S);
+}
+
+/*
+ * Set the memory budget (in bytes of pixel data) of the decoded surface
+ * cache, evicting least recently used entries as needed. A size of 0
+ * disables caching.
+ */
+void
+AG_SurfaceCacheSetSize(AG_Size size)
+{
+	cacheSizeMax = size;
+	if (cacheTbl != NULL)
+		CacheEvict();
+}
+
+/* Release all surfaces in the decoded surface cache. */
+void
+AG_SurfaceCacheClear(void)
+{
+	AG_SurfaceCacheEnt *ce;
+
+	while ((ce = TAILQ_FIRST(&cacheLRU)) != NULL)
+		CacheFreeEnt(ce);
+}
+
+static void
+FreeReq(AG_SurfaceLoadReq *_Nonnull req)
+{
+	if (req->S != NULL) {
+		AG_SurfaceFree(req->S);
+	}
+	Free(req->errMsg);
+	free(req->path);
+	free(req);
+}
+
+/* Decode the image file (the request is not on any queue). */
+static void
+DecodeReq(AG_SurfaceLoadReq *_Nonnull req)
+{
+	if ((req->S = AG_SurfaceFromFile(req->path)) == NULL)
+		req->errMsg = TryStrdup(AG_GetError());
+}
+
+/* Append arguments to a completion handler (as AG_PostEvent(3) would). */
+static void
+PushArgs(AG_Event *_Nonnull ev, const char *_Nonnull fmt, ...)
+{
+	AG_EVENT_GET_ARGS(ev, fmt);
+}
+
+/*
+ * Invoke the completion handler of a request from the GUI thread. The
+ * surface remains owned by the cache (or by the request), and is only
+ * valid for the duration of the handler.
+ */
+static void
+DeliverReq(AG_SurfaceLoadReq *_Nonnull req, AG_Surface *_Nullable S)
+{
+	AG_Event *ev = &req->ev;
+	AG_Object *obj = req->obj;
+
+	if (S == NULL) {
+		AG_SetErrorS((req->errMsg != NULL) ? req->errMsg :
+		                                     _("Out of memory"));
+	}
+	PushArgs(ev, "%p,%s", S, req->path);
+	AG_ObjectLock(obj);
+	ev->fn(ev);
+	AG_ObjectUnlock(obj);
+}
+
+static void
+FreeBatch(AG_SurfaceLoadBatch *_Nonnull lb)
+{
+	Uint i;
+
+	for (i = 0; i < lb->count; i++) {
+		free(lb->paths[i]);
+	}
+	free(lb->paths);
+#ifdef AG_THREADS
+	AG_CondDestroy(&lb->done);
+#endif
+	free(lb);
+}
+
+/*
+ * Decode the next file of a batch and invoke its callback. Called with
+ * loaderLock held, which is released while decoding.
+ */
+static void
+RunBatch(AG_SurfaceLoadBatch *_Nonnull lb)
+{
+	AG_Surface *S;
+	Uint i = lb->next++;
+
+	if (lb->next == lb->count) {			/* All files started */
+		TAILQ_REMOVE(&loaderBatches, lb, batches);
+	}
+	lb->nRunning++;
+#ifdef AG_THREADS
+	AG_MutexUnlock(&loaderLock);
+#endif
+	S = AG_SurfaceFromFile(lb->paths[i]);
+	lb->fn(S, lb->paths[i], lb->arg);
+#ifdef AG_THREADS
+	AG_MutexLock(&loaderLock);
+#endif
+	lb->nRunning--;
+	lb->nDone++;
+	if (S != NULL)
+		lb->nLoaded++;
+
+	if (!(lb->flags & AG_SURFACE_LOAD_ASYNC)) {
+#ifdef AG_THREADS
+		AG_CondSignal(&lb->done);		/* Wake up the caller */
+#endif
+	} else if (lb->nDone == lb->count) {
+		FreeBatch(lb);
+	}
+}
+
+#ifdef AG_THREADS
+/* Return the first batch which can use another thread. */
+static AG_SurfaceLoadBatch *_Nullable
+NextBatch(void)
+{
+	AG_SurfaceLoadBatch *lb;
+
+	TAILQ_FOREACH(lb, &loaderBatches, batches) {
+		if (lb->nRunning < lb->nThreads)
+			return (lb);
+	}
+	return (NULL);
+}
+
+/*
+ * Worker thread of the decoding pool. Requests from AG_SurfaceLoadAsync()
+ * take precedence over batches from AG_SurfaceFromFiles().
+ */
+static void *_Nullable
+LoaderWorker(void *_Nullable arg)
+{
+	AG_SurfaceLoadReq *req;
+	AG_SurfaceLoadBatch *lb = NULL;
+
+	AG_MutexLock(&loaderLock);
+	for (;;) {
+		while (!loaderExit && TAILQ_EMPTY(&loaderPending) &&
+		       (lb = NextBatch()) == NULL) {
+			AG_CondWait(&loaderCond, &loaderLock);
+		}
+		if (loaderExit) {
+			break;
+		}
+		if ((req = TAILQ_FIRST(&loaderPending)) == NULL) {
+			RunBatch(lb);
+			continue;
+		}
+		TAILQ_REMOVE(&loaderPending, req, reqs);
+		TAILQ_INSERT_TAIL(&loaderActive, req, reqs);
+		AG_MutexUnlock(&loaderLock);
+
+		DecodeReq(req);
+
+		AG_MutexLock(&loaderLock);
+		TAILQ_REMOVE(&loaderActive, req, reqs);
+		TAILQ_INSERT_TAIL(&loaderDone, req, reqs);
+# ifdef AG_SURFACE_LOADER_PIPE
+		if (loaderPipe[1] != -1)
+			(void)write(loaderPipe[1], "", 1);  /* Wake event loop */
+# endif
+	}
+	AG_MutexUnlock(&loaderLock);
+	return (NULL);
+}
+
+/*
+ * Grow the pool to at least n threads (with loaderLock held). Threads
+ * persist until AG_DestroySurfaceLoader().
+ */
+static void
+StartWorkers(Uint n)
+{
+	if (n > AG_SURFACE_LOAD_THREADS_MAX) {
+		n = AG_SURFACE_LOAD_THREADS_MAX;
+	}
+	while (loaderThreadCount < n) {
+		if (AG_ThreadTryCreate(&loaderThreads[loaderThreadCount],
+		    LoaderWorker, NULL) == -1) {
+			break;			/* Carry on with fewer threads */
+		}
+		loaderThreadCount++;
+	}
+}
+#endif /* AG_THREADS */
+
+/*
+ * Load a set of image files concurrently, using up to nThreads threads
+ * of the decoding pool (0 = default). The callback fn is invoked once for
+ * every path, from the decoding thread, with the new surface (or NULL on
+ * failure). In AG_SURFACE_LOAD_ASYNC mode, return immediately (0 on
+ * success). Otherwise, the calling thread takes part in decoding; wait for
+ * completion and return the number of surfaces loaded.
+ */
+int
+AG_SurfaceFromFiles(const char *const *paths, Uint count, Uint nThreads,
+    Uint flags, AG_SurfaceLoadFn fn, void *arg)
+{
+	AG_SurfaceLoadBatch lbSync, *lb;
+	Uint i;
+	int nLoaded;
+
+	if (!loaderInited) {
+		AG_SetErrorS("Agar-GUI is not initialized");
+		return (-1);
+	}
+	if (count == 0) {
+		return (0);
+	}
+	if (nThreads == 0) {
+		nThreads = AG_SURFACE_LOAD_THREADS_DEFAULT;
+	} else if (nThreads > AG_SURFACE_LOAD_THREADS_MAX) {
+		nThreads = AG_SURFACE_LOAD_THREADS_MAX;
+	}
+#ifndef AG_THREADS
+	flags &= ~(AG_SURFACE_LOAD_ASYNC);
+#endif
+	if (flags & AG_SURFACE_LOAD_ASYNC) {
+		if ((lb = TryMalloc(sizeof(AG_SurfaceLoadBatch))) == NULL) {
+			return (-1);
+		}
+		if ((lb->paths = TryMalloc(count*sizeof(char *))) == NULL) {
+			free(lb);
+			return (-1);
+		}
+		for (i = 0; i < count; i++) {
+			if ((lb->paths[i] = TryStrdup(paths[i])) == NULL) {
+				while (i > 0) { free(lb->paths[--i]); }
+				free(lb->paths);
+				free(lb);
+				return (-1);
+			}
+		}
+	} else {
+		lb = &lbSync;
+		lb->paths = (char **)paths;
+	}
+	lb->count = count;
+	lb->next = 0;
+	lb->nDone = 0;
+	lb->nLoaded = 0;
+	lb->nRunning = 0;
+	lb->nThreads = nThreads;
+	lb->flags = flags;
+	lb->fn = fn;
+	lb->arg = arg;
+#ifdef AG_THREADS
+	AG_CondInit(&lb->done);
+
+	AG_MutexLock(&loaderLock);
+	if (flags & AG_SURFACE_LOAD_ASYNC) {
+		StartWorkers(nThreads);
+		if (loaderThreadCount > 0) {
+			TAILQ_INSERT_TAIL(&loaderBatches, lb, batches);
+			AG_CondBroadcast(&loaderCond);
+			AG_MutexUnlock(&loaderLock);
+			return (0);
+		}
+		lb->flags &= ~(AG_SURFACE_LOAD_ASYNC);	/* No threads */
+	} else {
+		StartWorkers(nThreads - 1);
+	}
+	TAILQ_INSERT_TAIL(&loaderBatches, lb, batches);
+	AG_CondBroadcast(&loaderCond);
+	while (lb->nDone < lb->count) {
+		if (lb->next < lb->count && lb->nRunning < lb->nThreads) {
+			RunBatch(lb);
+		} else {
+			AG_CondWait(&lb->done, &loaderLock);
+		}
+	}
+	AG_MutexUnlock(&loaderLock);
+#else
+	TAILQ_INSERT_TAIL(&loaderBatches, lb, batches);
+	while (lb->next < lb->count)
+		RunBatch(lb);
+#endif /* AG_THREADS */
+
+	nLoaded = (int)lb->nLoaded;
+	if (flags & AG_SURFACE_LOAD_ASYNC) {
+		FreeBatch(lb);
+		return (0);
+	}
+#ifdef AG_THREADS
+	AG_CondDestroy(&lb->done);
+#endif
+	return (nLoaded);
+}
+
+/*
+ * Deliver completed requests to their handlers. This is called from the
+ * event loop, and may be called explicitly by applications which use a
+ * custom event loop. Return the number of handlers invoked.
+ */
+int
+AG_SurfaceLoadProcess(void)
+{
+	AG_SurfaceLoadReq *req;
+	AG_Surface *S;
+	int nDelivered = 0;
+
+	if (!loaderGUI)
+		return (0);
+
+	for (;;) {
+#ifdef AG_THREADS
+		AG_MutexLock(&loaderLock);
+#endif
+		if ((req = TAILQ_FIRST(&loaderDone)) != NULL) {
+			TAILQ_REMOVE(&loaderDone, req, reqs);
+		}
+#ifdef AG_THREADS
+		AG_MutexUnlock(&loaderLock);
+#endif
+		if (req == NULL)
+			break;
+
+		if ((S = req->S) != NULL && cacheSizeMax > 0) {
+			CacheInsert(req->path, req->mtime, S);
+			req->S = NULL;
+			S = CacheLookup(req->path, req->mtime);
+		}
+		if (req->obj != NULL) {
+			DeliverReq(req, S);
+			nDelivered++;
+		}
+		FreeReq(req);
+	}
+	CacheEvict();
+	return (nDelivered);
+}
+
+static int
+LoaderEventEpilogue(AG_EventSink *_Nonnull es, AG_Event *_Nonnull event)
+{
+	AG_SurfaceLoadProcess();
+	return (0);
+}
+
+#ifdef AG_SURFACE_LOADER_PIPE
+static int
+LoaderEventSink(AG_EventSink *_Nonnull es, AG_Event *_Nonnull event)
+{
+	char buf[64];
+
+	while (read(es->ident, buf, sizeof(buf)) > 0)
+		;
+	AG_SurfaceLoadProcess();
+	return (1);
+}
+#endif
+
+/*
+ * Initialize the decoding pool and its queues if needed. Threads are
+ * created on demand. Called from AG_InitGUIGlobals() and AG_InitGUI().
+ */
+void
+AG_InitSurfaceLoader(void)
+{
+	if (loaderInited) {
+		return;
+	}
+	TAILQ_INIT(&loaderPending);
+	TAILQ_INIT(&loaderActive);
+	TAILQ_INIT(&loaderDone);
+	TAILQ_INIT(&loaderBatches);
+	TAILQ_INIT(&cacheLRU);
+	cacheSize = 0;
+#ifdef AG_THREADS
+	AG_MutexInit(&loaderLock);
+	AG_CondInit(&loaderCond);
+	loaderExit = 0;
+	loaderThreadCount = 0;
+#endif
+	loaderInited = 1;
+}
+
+/*
+ * Set up delivery of completed requests to the GUI thread along with the
+ * decoded surface cache, on the first AG_SurfaceLoadAsync().
+ */
+static int
+InitDelivery(void)
+{
+	if ((cacheTbl = AG_TblNew(256, 0)) == NULL)
+		return (-1);
+
+	if ((loaderEpilogue = AG_AddEventEpilogue(LoaderEventEpilogue,
+	    NULL)) == NULL) {
+		AG_TblDestroy(cacheTbl);
+		free(cacheTbl);
+		cacheTbl = NULL;
+		return (-1);
+	}
+#ifdef AG_SURFACE_LOADER_PIPE
+	/*
+	 * Workers write to a pipe in order to wake up an event loop blocked
+	 * on I/O. Without it, completions are still delivered by the event
+	 * epilogue on the next iteration.
+	 */
+	AG_MutexLock(&loaderLock);
+	if (pipe(loaderPipe) == 0) {
+		(void)fcntl(loaderPipe[0], F_SETFL, O_NONBLOCK);
+		(void)fcntl(loaderPipe[1], F_SETFL, O_NONBLOCK);
+		if ((loaderSink = AG_AddEventSink(AG_SINK_READ, loaderPipe[0],
+		    0, LoaderEventSink, NULL)) == NULL) {
+			close(loaderPipe[0]);
+			close(loaderPipe[1]);
+			loaderPipe[0] = -1;
+			loaderPipe[1] = -1;
+		}
+	}
+	AG_MutexUnlock(&loaderLock);
+#endif
+	loaderGUI = 1;
+	return (0);
+}
+
+/*
+ * Stop the decoding threads and release all pending requests and batches
+ * along with the decoded surface cache. Called from AG_DestroyGUI() and
+ * AG_DestroyGUIGlobals().
+ */
+void
+AG_DestroySurfaceLoader(void)
+{
+	AG_SurfaceLoadReq *req;
+	AG_SurfaceLoadBatch *lb;
+#ifdef AG_THREADS
+	Uint i;
+#endif
+	if (!loaderInited)
+		return;
+
+#ifdef AG_THREADS
+	AG_MutexLock(&loaderLock);
+	loaderExit = 1;
+	AG_CondBroadcast(&loaderCond);
+	AG_MutexUnlock(&loaderLock);
+	for (i = 0; i < loaderThreadCount; i++) {
+		AG_ThreadJoin(loaderThreads[i], NULL);
+	}
+	loaderThreadCount = 0;
+# ifdef AG_SURFACE_LOADER_PIPE
+	if (loaderSink != NULL) {
+		AG_DelEventSink(loaderSink);
+		loaderSink = NULL;
+		close(loaderPipe[0]);
+		close(loaderPipe[1]);
+		loaderPipe[0] = -1;
+		loaderPipe[1] = -1;
+	}
+# endif
+#endif /* AG_THREADS */
+	if (loaderEpilogue != NULL) {
+		AG_DelEventEpilogue(loaderEpilogue);
+		loaderEpilogue = NULL;
+	}
+	while ((req = TAILQ_FIRST(&loaderPending)) != NULL) {
+		TAILQ_REMOVE(&loaderPending, req, reqs);
+		FreeReq(req);
+	}
+	while ((req = TAILQ_FIRST(&loaderDone)) != NULL) {
+		TAILQ_REMOVE(&loaderDone, req, reqs);
+		FreeReq(req);
+	}
+	while ((lb = TAILQ_FIRST(&loaderBatches)) != NULL) {
+		TAILQ_REMOVE(&loaderBatches, lb, batches);
+		if (lb->flags & AG_SURFACE_LOAD_ASYNC)
+			FreeBatch(lb);
+	}
+#ifdef AG_THREADS
+	AG_CondDestroy(&loaderCond);
+	AG_MutexDestroy(&loaderLock);
+#endif
+	AG_SurfaceCacheClear();
+	if (cacheTbl != NULL) {
+		AG_TblDestroy(cacheTbl);
+		free(cacheTbl);
+		cacheTbl = NULL;
+	}
+	loaderGUI = 0;
+	loaderInited = 0;
+}
+
+/*
+ * Load an image file in the background and invoke fn from the GUI thread
+ * once it has been decoded. The handler receives the arguments given by
+ * fmt, followed by a pointer to the surface (NULL on failure, with the
+ * error available from AG_GetError()) and the path. The surface belongs
+ * to the loader and is only valid for the duration of the handler.
+ *
+ * If the file is in the cache and unchanged, fn is invoked immediately.
+ * The request is tied to obj, which is locked around the handler; pending
+ * requests must be cancelled with AG_SurfaceLoadCancel() before obj is
+ * destroyed. Must be called from the GUI thread.
+ */
+int
+AG_SurfaceLoadAsync(void *obj, const char *path, AG_EventFn fn,
+    const char *fmt, ...)
+{
+	AG_SurfaceLoadReq *req;
+	AG_Surface *S;
+	AG_Event *ev;
+
+	if (!loaderInited) {
+		AG_SetErrorS("Agar-GUI is not initialized");
+		return (-1);
+	}
+	if (!loaderGUI && InitDelivery() == -1)
+		return (-1);
+
+	if ((req = TryMalloc(sizeof(AG_SurfaceLoadReq))) == NULL) {
+		return (-1);
+	}
+	if ((req->path = TryStrdup(path)) == NULL) {
+		free(req);
+		return (-1);
+	}
+	req->obj = obj;
+	req->mtime = GetFileMTime(path);
+	req->S = NULL;
+	req->errMsg = NULL;
+
+	ev = &req->ev;
+	AG_EventInit(ev);
+	ev->fn = (AG_VoidFn)fn;
+	ev->argv[0].data.p = obj;
+	AG_EVENT_GET_ARGS(ev, fmt);
+	ev->argc0 = ev->argc;
+
+	if ((S = CacheLookup(req->path, req->mtime)) != NULL) {
+		DeliverReq(req, S);
+		FreeReq(req);
+		return (0);
+	}
+#ifdef AG_THREADS
+	AG_MutexLock(&loaderLock);
+	StartWorkers(AG_SURFACE_LOADER_THREADS);
+	if (loaderThreadCount > 0) {
+		TAILQ_INSERT_TAIL(&loaderPending, req, reqs);
+		AG_CondSignal(&loaderCond);
+		AG_MutexUnlock(&loaderLock);
+		return (0);
+	}
+	AG_MutexUnlock(&loaderLock);
+#endif
+	DecodeReq(req);				/* No threads */
+#ifdef AG_THREADS
+	AG_MutexLock(&loaderLock);
+#endif
+	TAILQ_INSERT_TAIL(&loaderDone, req, reqs);
+#ifdef AG_THREADS
+	AG_MutexUnlock(&loaderLock);
+#endif
+	AG_SurfaceLoadProcess();
+	return (0);
+}
+
+/*
+ * Cancel all requests tied to the given object. Requests which have not
+ * been started yet are discarded. Requests being decoded are completed,
+ * and their surfaces cached, but their handlers are not invoked.
+ */
+void
+AG_SurfaceLoadCancel(void *obj)
+{
+	AG_SurfaceLoadReq *req, *reqNext;
+
+	if (!loaderGUI)
+		return;
+#ifdef AG_THREADS
+	AG_MutexLock(&loaderLock);
+#endif
+	for (req = TAILQ_FIRST(&loaderPending);
+	     req != TAILQ_END(&loaderPending);
+	     req = reqNext) {
+		reqNext = TAILQ_NEXT(req, reqs);
+		if (req->obj == obj) {
+			TAILQ_REMOVE(&loaderPending, req, reqs);
+			FreeReq(req);
+		}
+	}
+	TAILQ_FOREACH(req, &loaderActive, reqs) {
+		if (req->obj == obj)
+			req->obj = NULL;
+	}
+	TAILQ_FOREACH(req, &loaderDone, reqs) {
+		if (req->obj == obj)
+			req->obj = NULL;
+	}
+#ifdef AG_THREADS
+	AG_MutexUnlock(&loaderLock);
+#endif
+}
+
+#endif /* AG_SERIALIZATION */
@@ -33,6 +33,14 @@
 #ifndef AG_TLIST_PADDING
 #define AG_TLIST_PADDING 2	/* Label padding (pixels) */
 #endif
+#ifndef AG_TLIST_HASH_MIN
+#define AG_TLIST_HASH_MIN 64	/* Minimum buckets in saved item table */
+#endif
+#ifndef AG_TLIST_HASH_MAX
+#define AG_TLIST_HASH_MAX 16384	/* Maximum buckets in saved item table */
+#endif
+
+static void VirtualFetch(AG_Tlist *_Nonnull);
 
 AG_Tlist *
 AG_TlistNew(void *parent, Uint flags)
@@ -75,29 +83,87 @@ UpdatePolled(AG_Tlist *_Nonnull tl)
 	    (tl->flags & AG_TLIST_REFRESH)) {
 		tl->flags &= ~(AG_TLIST_REFRESH);
 		AG_PostEvent(NULL, tl, "tlist-poll", NULL);
+		if (tl->flags & AG_TLIST_VIRTUAL)
+			tl->virtFirst = -1;
 	}
 }
 #endif /* AG_TIMERS */
 
+/*
+ * Rebuild the row index from the list of items.
+ * The Tlist must be locked.
+ */
+static int
+UpdateIndex(AG_Tlist *_Nonnull tl)
+{
+	AG_TlistItem *it, **indexNew;
+	Uint i = 0, indexMaxNew;
+
+	TAILQ_FOREACH(it, &tl->items, items) {
+		if (i == tl->indexMax) {
+			indexMaxNew = MAX(tl->indexMax << 1, (Uint)tl->nitems);
+			indexMaxNew = MAX(indexMaxNew, 64);
+			if ((indexNew = TryRealloc(tl->index,
+			    indexMaxNew*sizeof(AG_TlistItem *))) == NULL) {
+				return (-1);
+			}
+			tl->index = indexNew;
+			tl->indexMax = indexMaxNew;
+		}
+		tl->index[i++] = it;
+	}
+	tl->indexOK = 1;
+	return (0);
+}
+
+/*
+ * Return the item at row i (from 0), or NULL. The row index is rebuilt
+ * lazily whenever the list changes. In AG_TLIST_VIRTUAL mode, only the
+ * materialized rows are accessible. The Tlist must be locked.
+ */
+static AG_TlistItem *_Nullable
+ItemAt(AG_Tlist *_Nonnull tl, int i)
+{
+	AG_TlistItem *it;
+	int n = tl->nitems;
+
+	if (tl->flags & AG_TLIST_VIRTUAL) {
+		i -= tl->virtFirst;
+		n = tl->virtCount;
+	}
+	if (i < 0 || i >= n) {
+		return (NULL);
+	}
+	if (!tl->indexOK && UpdateIndex(tl) == -1) {
+		TAILQ_FOREACH(it, &tl->items, items) {	/* Fallback */
+			if (i-- == 0)
+				break;
+		}
+		return (it);
+	}
+	return (tl->index[i]);
+}
+
 /* Return 1 if at least one selected item is visible */
 static int
 SelectionVisible(AG_Tlist *_Nonnull tl)
 {
 	AG_TlistItem *it;
-	int y=0, i=0, rOffs, yLast, item_h;
+	int y=0, rOffs, yLast, item_h;
 
 #ifdef AG_TIMERS
 	UpdatePolled(tl);
 #endif
+	if (tl->flags & AG_TLIST_VIRTUAL) {
+		VirtualFetch(tl);
+	}
 	item_h = tl->item_h;
 	yLast = HEIGHT(tl)-item_h;
 	rOffs = tl->rOffs;
 
-	TAILQ_FOREACH(it, &tl->items, items) {
-		if (i++ < rOffs)
-			continue;
-		if (y > yLast)
-			break;
+	for (it = ItemAt(tl, rOffs);
+	     it != NULL && y <= yLast;
+	     it = TAILQ_NEXT(it, items)) {
 		if (it->selected)
 			return (1);
 
@@ -165,12 +231,59 @@ DeselectItem(AG_Tlist *_Nonnull tl, AG_TlistItem *_Nonnull it)
 	AG_Redraw(tl);
 }
 
+/*
+ * Move the selection by inc rows in AG_TLIST_VIRTUAL mode, scrolling as
+ * needed to bring the new selection into view.
+ */
+static void
+VirtualMoveSelection(AG_Tlist *_Nonnull tl, int inc)
+{
+	AG_TlistItem *it;
+	int i = 0, iSel = -1;
+
+	VirtualFetch(tl);
+	if (tl->nitems == 0) {
+		return;
+	}
+	TAILQ_FOREACH(it, &tl->items, items) {
+		if (it->selected) {
+			iSel = tl->virtFirst + i;
+			break;
+		}
+		i++;
+	}
+	if (it != NULL) {
+		DeselectItem(tl, it);
+		iSel += inc;
+	} else {
+		AG_TlistDeselectAll(tl);
+		iSel = tl->rOffs;
+	}
+	if (iSel < 0) {
+		iSel = 0;
+	} else if (iSel >= tl->nitems) {
+		iSel = tl->nitems - 1;
+	}
+	if (iSel < tl->rOffs) {
+		tl->rOffs = iSel;
+	} else if (iSel >= tl->rOffs + tl->nvisitems) {
+		tl->rOffs = MAX(0, iSel - tl->nvisitems + 1);
+	}
+	VirtualFetch(tl);
+	if ((it = ItemAt(tl, iSel)) != NULL)
+		SelectItem(tl, it);
+}
+
 static void
 DecrementSelection(AG_Tlist *_Nonnull tl, int inc)
 {
 	AG_TlistItem *it, *itPrev;
 	int i;
 
+	if (tl->flags & AG_TLIST_VIRTUAL) {
+		VirtualMoveSelection(tl, -inc);
+		return;
+	}
 	for (i = 0; i < inc; i++) {
 		TAILQ_FOREACH(it, &tl->items, items) {
 			if (!it->selected) {
@@ -196,6 +309,10 @@ IncrementSelection(AG_Tlist *_Nonnull tl, int inc)
 	AG_TlistItem *it, *itNext;
 	int i;
 
+	if (tl->flags & AG_TLIST_VIRTUAL) {
+		VirtualMoveSelection(tl, inc);
+		return;
+	}
 	for (i = 0; i < inc; i++) {
 		TAILQ_FOREACH(it, &tl->items, items) {
 			if (!it->selected) {
@@ -349,12 +466,179 @@ FreeItem(AG_Tlist *_Nonnull tl, AG_TlistItem *_Nonnull it)
 	free(it);
 }
 
+/*
+ * Return 1 if the item's compare function admits a hashable key (so that
+ * items can be matched by lookup rather than by exhaustive comparison).
+ */
+static __inline__ int
+KeyedCompareFn(const AG_Tlist *_Nonnull tl)
+{
+	return (tl->compare_fn == AG_TlistComparePtrs ||
+	        tl->compare_fn == AG_TlistComparePtrsAndClasses ||
+	        tl->compare_fn == AG_TlistCompareStrings);
+}
+
+/*
+ * Return the hash bucket of an item in the saved item table. Items which
+ * cannot be hashed (under a custom compare function) share bucket 0.
+ */
+static Uint
+HashItem(const AG_Tlist *_Nonnull tl, const AG_TlistItem *_Nonnull it)
+{
+	const Uint8 *p, *pEnd;
+	Uint32 h = 2166136261UL;
+
+	if (tl->compare_fn == AG_TlistComparePtrs ||
+	    tl->compare_fn == AG_TlistComparePtrsAndClasses) {
+		p = (const Uint8 *)&it->p1;
+		pEnd = p + sizeof(void *);
+	} else if (tl->compare_fn == AG_TlistCompareStrings) {
+		p = (const Uint8 *)it->text;
+		pEnd = p + strlen(it->text);
+	} else {
+		return (0);
+	}
+	for (; p < pEnd; p++) {
+		h ^= *p;
+		h *= 16777619UL;
+	}
+	return (Uint)(h % tl->nSelHash);
+}
+
+/* Rebuild the hash chains of the saved item table. */
 static void
-Destroy(void *_Nonnull p)
+RehashSaved(AG_Tlist *_Nonnull tl)
+{
+	AG_TlistItem *it;
+	Uint h;
+
+	memset(tl->selHash, 0, tl->nSelHash*sizeof(AG_TlistItem *));
+	TAILQ_FOREACH(it, &tl->selitems, selitems) {
+		h = HashItem(tl, it);
+		it->hNext = tl->selHash[h];
+		tl->selHash[h] = it;
+	}
+}
+
+/* Grow the saved item table to accomodate about n items. */
+static void
+ResizeSaved(AG_Tlist *_Nonnull tl, Uint n)
+{
+	AG_TlistItem **selHashNew;
+	Uint nSelHashNew = tl->nSelHash;
+
+	while (nSelHashNew < n && nSelHashNew < AG_TLIST_HASH_MAX) {
+		nSelHashNew <<= 1;
+	}
+	if (nSelHashNew == tl->nSelHash) {
+		return;
+	}
+	if ((selHashNew = TryMalloc(nSelHashNew*sizeof(AG_TlistItem *))) == NULL) {
+		return;				/* Keep the current table */
+	}
+	free(tl->selHash);
+	tl->selHash = selHashNew;
+	tl->nSelHash = nSelHashNew;
+	RehashSaved(tl);
+}
+
+/* Save an item for matching against the items of the next refresh. */
+static void
+SaveItem(AG_Tlist *_Nonnull tl, AG_TlistItem *_Nonnull it)
+{
+	Uint h = HashItem(tl, it);
+
+	TAILQ_INSERT_HEAD(&tl->selitems, it, selitems);
+	it->hNext = tl->selHash[h];
+	tl->selHash[h] = it;
+}
+
+static void
+UnsaveItem(AG_Tlist *_Nonnull tl, AG_TlistItem *_Nonnull it)
+{
+	AG_TlistItem **pIt;
+
+	for (pIt = &tl->selHash[HashItem(tl, it)];
+	     *pIt != NULL;
+	     pIt = &(*pIt)->hNext) {
+		if (*pIt == it) {
+			*pIt = it->hNext;
+			break;
+		}
+	}
+	TAILQ_REMOVE(&tl->selitems, it, selitems);
+}
+
+/*
+ * Return 1 if a saved item carries state which AG_TlistEnd() restores
+ * (selection and expansion of child items).
+ */
+static __inline__ int
+HasSavedState(const AG_Tlist *_Nonnull tl, const AG_TlistItem *_Nonnull it)
+{
+	return ((!(tl->flags & AG_TLIST_NOSELSTATE) && it->selected) ||
+	        (it->flags & AG_TLIST_HAS_CHILDREN));
+}
+
+static int
+SameIcon(const AG_Surface *_Nullable a, const AG_Surface *_Nullable b)
+{
+	if (a == NULL || b == NULL ||
+	    a->w != b->w || a->h != b->h || a->pitch != b->pitch ||
+	    AG_PixelFormatCompare(&a->format, &b->format) != 0) {
+		return (0);
+	}
+	return (memcmp(a->pixels, b->pixels, a->h*a->pitch) == 0);
+}
+
+/*
+ * Restore the state of a new item from the matching saved items, and take
+ * over their cached label and icon surfaces if still valid. If consume is
+ * set, the matching saved items are freed. The Tlist must be locked.
+ */
+static void
+RestoreItem(AG_Tlist *_Nonnull tl, AG_TlistItem *_Nonnull cit, int consume)
+{
+	AG_TlistItem *sit, *nsit;
+
+	for (sit = tl->selHash[HashItem(tl, cit)]; sit != NULL; sit = nsit) {
+		nsit = sit->hNext;
+		if (!tl->compare_fn(sit, cit)) {
+			continue;
+		}
+		if (HasSavedState(tl, sit)) {
+			if (!(tl->flags & AG_TLIST_NOSELSTATE)) {
+				cit->selected = sit->selected;
+			}
+			if (sit->flags & AG_TLIST_VISIBLE_CHILDREN) {
+				cit->flags |= AG_TLIST_VISIBLE_CHILDREN;
+			} else {
+				cit->flags &= ~(AG_TLIST_VISIBLE_CHILDREN);
+			}
+		}
+		if (cit->label == -1 && sit->label != -1 &&
+		    cit->selected == sit->selected &&
+		    strcmp(cit->text, sit->text) == 0) {
+			cit->label = sit->label;
+			sit->label = -1;
+		}
+		if (cit->icon == -1 && sit->icon != -1 &&
+		    SameIcon(cit->iconsrc, sit->iconsrc)) {
+			cit->icon = sit->icon;
+			sit->icon = -1;
+		}
+		if (consume) {
+			UnsaveItem(tl, sit);
+			FreeItem(tl, sit);
+		}
+	}
+}
+
+/* Free all items (including saved items). */
+static void
+FreeItems(AG_Tlist *_Nonnull tl)
 {
-	AG_Tlist *tl = p;
 	AG_TlistItem *it, *nit;
-	AG_TlistPopup *tp, *ntp;
 
 	for (it = TAILQ_FIRST(&tl->selitems);
 	     it != TAILQ_END(&tl->selitems);
@@ -368,6 +652,115 @@ Destroy(void *_Nonnull p)
 		nit = TAILQ_NEXT(it, items);
 		FreeItem(tl, it);
 	}
+	TAILQ_INIT(&tl->selitems);
+	TAILQ_INIT(&tl->items);
+	memset(tl->selHash, 0, tl->nSelHash*sizeof(AG_TlistItem *));
+	tl->nitems = 0;
+	tl->indexOK = 0;
+}
+
+/*
+ * In AG_TLIST_VIRTUAL mode, materialize the items of the visible rows with
+ * the fetch callback (unless already done). Items are matched by key with
+ * the previously materialized rows, which preserves their selection and
+ * expansion state as well as their cached surfaces. Items which scroll out
+ * of view are freed, unless they carry state in which case they are saved
+ * (without their surfaces). The Tlist must be locked.
+ */
+static void
+VirtualFetch(AG_Tlist *_Nonnull tl)
+{
+	AG_TlistItem *it, *nit;
+	int n, i, first, count;
+
+	if ((tl->flags & AG_TLIST_REFRESH) && !(tl->flags & AG_TLIST_POLL)) {
+		tl->flags &= ~(AG_TLIST_REFRESH);
+		tl->virtFirst = -1;
+	}
+	if ((n = tl->countFn(tl, tl->virtArg)) < 0) {
+		n = 0;
+	}
+	tl->nitems = n;
+	if (tl->rOffs+tl->nvisitems > n) {
+		tl->rOffs = MAX(0, n - tl->nvisitems);
+	}
+	first = tl->rOffs;
+	count = MIN(tl->nvisitems+1, n - first);
+	if (first == tl->virtFirst && count == tl->virtCount)
+		return;
+
+	for (it = TAILQ_FIRST(&tl->items);
+	     it != TAILQ_END(&tl->items);
+	     it = nit) {
+		nit = TAILQ_NEXT(it, items);
+		SaveItem(tl, it);
+	}
+	TAILQ_INIT(&tl->items);
+	for (i = first; i < first+count; i++) {
+		it = AG_TlistItemNew(tl, NULL);
+		tl->fetchFn(tl, it, i, tl->virtArg);
+		TAILQ_INSERT_TAIL(&tl->items, it, items);
+		RestoreItem(tl, it, 1);
+	}
+	for (it = TAILQ_FIRST(&tl->selitems);
+	     it != TAILQ_END(&tl->selitems);
+	     it = nit) {
+		nit = TAILQ_NEXT(it, selitems);
+		if (!HasSavedState(tl, it)) {
+			UnsaveItem(tl, it);
+			FreeItem(tl, it);
+			continue;
+		}
+		if (it->icon != -1) {
+			AG_WidgetUnmapSurface(tl, it->icon);
+			it->icon = -1;
+		}
+		if (it->label != -1) {
+			AG_WidgetUnmapSurface(tl, it->label);
+			it->label = -1;
+		}
+	}
+	tl->virtFirst = first;
+	tl->virtCount = count;
+	tl->indexOK = 0;
+}
+
+/*
+ * Make the list virtual: rather than holding all items, the list only
+ * materializes the visible rows (by invoking fetchFn) out of a total of
+ * countFn rows. Passing NULL callbacks reverts to a regular list.
+ */
+void
+AG_TlistSetVirtual(AG_Tlist *tl, AG_TlistCountFn countFn,
+    AG_TlistFetchFn fetchFn, void *arg)
+{
+	AG_ObjectLock(tl);
+	FreeItems(tl);
+	tl->countFn = countFn;
+	tl->fetchFn = fetchFn;
+	tl->virtArg = arg;
+	tl->virtFirst = -1;
+	tl->virtCount = 0;
+	tl->rOffs = 0;
+	if (countFn != NULL && fetchFn != NULL) {
+		tl->flags |= AG_TLIST_VIRTUAL;
+	} else {
+		tl->flags &= ~(AG_TLIST_VIRTUAL);
+	}
+	AG_ObjectUnlock(tl);
+	AG_Redraw(tl);
+}
+
+static void
+Destroy(void *_Nonnull p)
+{
+	AG_Tlist *tl = p;
+	AG_TlistPopup *tp, *ntp;
+
+	FreeItems(tl);
+	free(tl->selHash);
+	free(tl->index);
+
 	for (tp = TAILQ_FIRST(&tl->popups);
 	     tp != TAILQ_END(&tl->popups);
 	     tp = ntp) {
@@ -450,12 +843,16 @@ Draw(void *_Nonnull obj)
 	AG_TlistItem *it;
 	AG_Rect r;
 	AG_Color cSel;
-	int x, y=0, i=0, selSeen=0, selPos=1, h=HEIGHT(tl);
+	int x, y=0, i, selSeen=0, selPos=1, h=HEIGHT(tl);
 	int hItem, wIcon, wSpace, yLast, wRow, rOffs;
 
 #ifdef AG_TIMERS
 	UpdatePolled(tl);
 #endif
+	if (tl->flags & AG_TLIST_VIRTUAL) {
+		VirtualFetch(tl);
+		tl->flags &= ~(AG_TLIST_SCROLLTOSEL);
+	}
 	AG_DrawBox(tl, &tl->r, -1, &WCOLOR(tl,AG_COLOR));
 	cSel = WCOLOR_SEL(tl,AG_COLOR);
 	AG_WidgetDraw(tl->sbar);
@@ -468,16 +865,17 @@ Draw(void *_Nonnull obj)
 	rOffs = tl->rOffs;
 	yLast = h;
 
-	TAILQ_FOREACH(it, &tl->items, items) {
-		if (i++ < rOffs) {
-			if (it->selected) {
+	if (tl->flags & AG_TLIST_SCROLLTOSEL) {
+		for (i = 0; i < rOffs; i++) {
+			if ((it = ItemAt(tl, i)) != NULL && it->selected) {
 				selPos = -1;
+				break;
 			}
-			continue;
 		}
-		if (y > yLast)
-			break;
-
+	}
+	for (it = ItemAt(tl, rOffs);
+	     it != NULL && y <= yLast;
+	     it = TAILQ_NEXT(it, items)) {
 		x = wIcon * it->depth;
 
 		if (it->selected) {
@@ -557,6 +955,7 @@ AG_TlistDel(AG_Tlist *tl, AG_TlistItem *it)
 	AG_ObjectLock(tl);
 	TAILQ_REMOVE(&tl->items, it, items);
 	tl->nitems--;
+	tl->indexOK = 0;
 	FreeItem(tl, it);
 
 	/* Update the scrollbar range and offset accordingly. */
@@ -592,22 +991,30 @@ void
 AG_TlistBegin(AG_Tlist *tl)
 {
 	AG_TlistItem *it, *nit;
+	int keyed;
 	
 	AG_ObjectLock(tl);
 
+	/*
+	 * If items can be matched by key, save all of them so that
+	 * AG_TlistEnd() can also recycle their cached surfaces.
+	 */
+	if ((keyed = KeyedCompareFn(tl)))
+		ResizeSaved(tl, tl->nitems);
+
 	for (it = TAILQ_FIRST(&tl->items);
 	     it != TAILQ_END(&tl->items);
 	     it = nit) {
 		nit = TAILQ_NEXT(it, items);
-		if ((!(tl->flags & AG_TLIST_NOSELSTATE) && it->selected) ||
-		      (it->flags & AG_TLIST_HAS_CHILDREN)) {
-			TAILQ_INSERT_HEAD(&tl->selitems, it, selitems);
+		if (keyed || HasSavedState(tl, it)) {
+			SaveItem(tl, it);
 		} else {
 			FreeItem(tl, it);
 		}
 	}
 	TAILQ_INIT(&tl->items);
 	tl->nitems = 0;
+	tl->indexOK = 0;
 	AG_ObjectUnlock(tl);
 
 	AG_Redraw(tl);
@@ -643,6 +1050,7 @@ AG_TlistSetCompareFn(AG_Tlist *tl,
 {
 	AG_ObjectLock(tl);
 	tl->compare_fn = fn;
+	RehashSaved(tl);
 	AG_ObjectUnlock(tl);
 }
 
@@ -661,7 +1069,10 @@ AG_TlistSetRefresh(AG_Tlist *tl, int ms)
 }
 #endif /* AG_TIMERS */
 
-/* Restore previous item selection state. */
+/*
+ * Restore previous item selection state. Items are matched by key (by
+ * hash lookup) under the standard compare functions.
+ */
 void
 AG_TlistEnd(AG_Tlist *tl)
 {
@@ -669,26 +1080,17 @@ AG_TlistEnd(AG_Tlist *tl)
 
 	AG_ObjectLock(tl);
 
+	TAILQ_FOREACH(cit, &tl->items, items) {
+		RestoreItem(tl, cit, 0);
+	}
 	for (sit = TAILQ_FIRST(&tl->selitems);
 	     sit != TAILQ_END(&tl->selitems);
 	     sit = nsit) {
 		nsit = TAILQ_NEXT(sit, selitems);
-		TAILQ_FOREACH(cit, &tl->items, items) {
-			if (!tl->compare_fn(sit, cit)) {
-				continue;
-			}
-			if (!(tl->flags & AG_TLIST_NOSELSTATE)) {
-				cit->selected = sit->selected;
-			}
-			if (sit->flags & AG_TLIST_VISIBLE_CHILDREN) {
-				cit->flags |= AG_TLIST_VISIBLE_CHILDREN;
-			} else {
-				cit->flags &= ~(AG_TLIST_VISIBLE_CHILDREN);
-			}
-		}
 		FreeItem(tl, sit);
 	}
 	TAILQ_INIT(&tl->selitems);
+	memset(tl->selHash, 0, tl->nSelHash*sizeof(AG_TlistItem *));
 
 	AG_ObjectUnlock(tl);
 }
@@ -710,8 +1112,10 @@ AG_TlistVisibleChildren(AG_Tlist *tl, AG_TlistItem *cit)
 {
 	AG_TlistItem *sit;
 
-	AG_TAILQ_FOREACH(sit, &tl->selitems, selitems) {
-		if (tl->compare_fn(sit, cit))
+	for (sit = tl->selHash[HashItem(tl, cit)];
+	     sit != NULL;
+	     sit = sit->hNext) {
+		if (HasSavedState(tl, sit) && tl->compare_fn(sit, cit))
 			break;
 	}
 	if (sit == NULL) { 
@@ -743,6 +1147,7 @@ AG_TlistItemNew(AG_Tlist *_Nonnull tl, const AG_Surface *icon)
 	it->label = -1;
 	it->depth = 0;
 	it->flags = 0;
+	it->hNext = NULL;
 	it->text[0] = '\0';
 	return (it);
 }
@@ -757,6 +1162,7 @@ InsertItem(AG_Tlist *_Nonnull tl, AG_TlistItem *_Nonnull it, int ins_head)
 		TAILQ_INSERT_TAIL(&tl->items, it, items);
 	}
 	tl->nitems++;
+	tl->indexOK = 0;
 
 	AG_Redraw(tl);
 }
@@ -936,7 +1342,10 @@ AG_TlistSelectAll(AG_Tlist *tl)
 	AG_ObjectUnlock(tl);
 }
 
-/* Unset the selection flag on all items. */
+/*
+ * Unset the selection flag on all items (in AG_TLIST_VIRTUAL mode, this
+ * includes saved items which are not currently materialized).
+ */
 void
 AG_TlistDeselectAll(AG_Tlist *tl)
 {
@@ -946,6 +1355,10 @@ AG_TlistDeselectAll(AG_Tlist *tl)
 	TAILQ_FOREACH(it, &tl->items, items) {
 		DeselectItem(tl, it);
 	}
+	if (tl->flags & AG_TLIST_VIRTUAL) {
+		TAILQ_FOREACH(it, &tl->selitems, selitems)
+			DeselectItem(tl, it);
+	}
 	AG_ObjectUnlock(tl);
 }
 
@@ -974,11 +1387,14 @@ MouseButtonDown(AG_Event *_Nonnull event)
 	int x = AG_INT(2);
 	int y = AG_INT(3);
 	AG_TlistItem *ti;
-	int tind;
+	int tind, base = 0;
 
+	if (tl->flags & AG_TLIST_VIRTUAL) {
+		VirtualFetch(tl);
+		base = tl->virtFirst;
+	}
 	tind = tl->rOffs + y/tl->item_h + 1;
 
-	/* XXX use array */
 	if ((ti = AG_TlistFindByIndex(tl, tind)) == NULL)
 		return;
 	
@@ -1025,7 +1441,7 @@ MouseButtonDown(AG_Event *_Nonnull event)
 		if ((tl->flags & AG_TLIST_MULTI) &&
 		    (AG_GetModState(tl) & AG_KEYMOD_SHIFT)) {
 			AG_TlistItem *oitem;
-			int oind = -1, i = 0, nitems = 0;
+			int oind = -1, i = base, nitems = base;
 
 			TAILQ_FOREACH(oitem, &tl->items, items) {
 				if (oitem->selected) {
@@ -1038,7 +1454,7 @@ MouseButtonDown(AG_Event *_Nonnull event)
 				return;
 			}
 			if (oind < tind) {			  /* Forward */
-				i = 0;
+				i = base;
 				TAILQ_FOREACH(oitem, &tl->items, items) {
 					if (i == tind)
 						break;
@@ -1213,6 +1629,17 @@ Init(void *_Nonnull obj)
 	TAILQ_INIT(&tl->items);
 	TAILQ_INIT(&tl->selitems);
 	TAILQ_INIT(&tl->popups);
+	tl->index = NULL;
+	tl->indexMax = 0;
+	tl->indexOK = 0;
+	tl->selHash = Malloc(AG_TLIST_HASH_MIN*sizeof(AG_TlistItem *));
+	tl->nSelHash = AG_TLIST_HASH_MIN;
+	memset(tl->selHash, 0, AG_TLIST_HASH_MIN*sizeof(AG_TlistItem *));
+	tl->countFn = NULL;
+	tl->fetchFn = NULL;
+	tl->virtArg = NULL;
+	tl->virtFirst = -1;
+	tl->virtCount = 0;
 #ifdef AG_TIMERS
 	AG_InitTimer(&tl->moveTo, "move", 0);
 	AG_InitTimer(&tl->refreshTo, "refresh", 0);
@@ -1242,23 +1669,43 @@ Init(void *_Nonnull obj)
 }
 
 /*
- * Return the item at the given index. Result is only valid as long as
- * the Tlist is locked.
+ * Return the item at the given index (from 1). In AG_TLIST_VIRTUAL mode,
+ * the rows in view are materialized first. Result is only valid as long
+ * as the Tlist is locked.
  */
 AG_TlistItem *
 AG_TlistFindByIndex(AG_Tlist *tl, int index)
 {
 	AG_TlistItem *it;
-	int i = 0;
 
 	AG_ObjectLock(tl);
+	if (tl->flags & AG_TLIST_VIRTUAL) {
+		VirtualFetch(tl);
+	}
+	it = ItemAt(tl, index-1);
+	AG_ObjectUnlock(tl);
+	return (it);
+}
+
+/*
+ * Return the first selected item. In AG_TLIST_VIRTUAL mode, fall back to
+ * saved items which are not currently materialized.
+ */
+static AG_TlistItem *_Nullable
+FirstSelected(AG_Tlist *_Nonnull tl)
+{
+	AG_TlistItem *it;
+
 	TAILQ_FOREACH(it, &tl->items, items) {
-		if (++i == index) {
-			AG_ObjectUnlock(tl);
+		if (it->selected)
 			return (it);
+	}
+	if (tl->flags & AG_TLIST_VIRTUAL) {
+		TAILQ_FOREACH(it, &tl->selitems, selitems) {
+			if (it->selected)
+				return (it);
 		}
 	}
-	AG_ObjectUnlock(tl);
 	return (NULL);
 }
 
@@ -1272,14 +1719,9 @@ AG_TlistSelectedItem(AG_Tlist *tl)
 	AG_TlistItem *it;
 
 	AG_ObjectLock(tl);
-	TAILQ_FOREACH(it, &tl->items, items) {
-		if (it->selected) {
-			AG_ObjectUnlock(tl);
-			return (it);
-		}
-	}
+	it = FirstSelected(tl);
 	AG_ObjectUnlock(tl);
-	return (NULL);
+	return (it);
 }
 
 /*
@@ -1293,15 +1735,9 @@ AG_TlistSelectedItemPtr(AG_Tlist *tl)
 	void *rv;
 
 	AG_ObjectLock(tl);
-	TAILQ_FOREACH(it, &tl->items, items) {
-		if (it->selected) {
-			rv = it->p1;
-			AG_ObjectUnlock(tl);
-			return (rv);
-		}
-	}
+	rv = ((it = FirstSelected(tl)) != NULL) ? it->p1 : NULL;
 	AG_ObjectUnlock(tl);
-	return (NULL);
+	return (rv);
 }
 
 /*
@@ -1315,15 +1751,9 @@ AG_TlistFindPtr(AG_Tlist *tl)
 	void *rv;
 
 	AG_ObjectLock(tl);
-	TAILQ_FOREACH(it, &tl->items, items) {
-		if (it->selected) {
-			rv = it->p1;
-			AG_ObjectUnlock(tl);
-			return (rv);
-		}
-	}
+	rv = ((it = FirstSelected(tl)) != NULL) ? it->p1 : NULL;
 	AG_ObjectUnlock(tl);
-	return (NULL);
+	return (rv);
 }
 
 /*
@@ -1511,14 +1941,32 @@ CompareText(const void *_Nonnull p1, const void *_Nonnull p2)
 	return strcoll(it1->text, it2->text);
 }
 
-/* Sort list items by text using quicksort. */
+/*
+ * Sort list items by text using quicksort. If the list is already sorted
+ * (as is typical of polled lists sorted on every refresh), do nothing.
+ * In AG_TLIST_VIRTUAL mode, ordering is up to the fetch function.
+ */
 int
 AG_TlistSort(AG_Tlist *tl)
 {
-	AG_TlistItem *it, **items;
+	AG_TlistItem *it, *itPrev = NULL, **items;
 	Uint i = 0;
 
+	AG_ObjectLock(tl);
+	if (tl->flags & AG_TLIST_VIRTUAL) {
+		goto out;
+	}
+	TAILQ_FOREACH(it, &tl->items, items) {
+		if (itPrev != NULL && strcoll(itPrev->text, it->text) > 0) {
+			break;
+		}
+		itPrev = it;
+	}
+	if (it == NULL)					/* Already sorted */
+		goto out;
+
 	if ((items = TryMalloc(tl->nitems*sizeof(AG_TlistItem *))) == NULL) {
+		AG_ObjectUnlock(tl);
 		return (-1);
 	}
 	TAILQ_FOREACH(it, &tl->items, items) {
@@ -1530,7 +1978,10 @@ AG_TlistSort(AG_Tlist *tl)
 		TAILQ_INSERT_TAIL(&tl->items, items[i], items);
 	}
 	free(items);
+	tl->indexOK = 0;
 	AG_Redraw(tl);
+out:
+	AG_ObjectUnlock(tl);
 	return (0);
 }
 
@@ -39,12 +39,20 @@ typedef struct ag_tlist_item {
 
 	AG_TAILQ_ENTRY(ag_tlist_item) items;	/* Items in list */
 	AG_TAILQ_ENTRY(ag_tlist_item) selitems;	/* Saved selection state */
-	
+	struct ag_tlist_item *_Nullable hNext;	/* In saved item hash bucket */
+
 	char text[AG_TLIST_LABEL_MAX];	/* Label text */
 } AG_TlistItem;
 
 typedef AG_TAILQ_HEAD(ag_tlist_itemq, ag_tlist_item) AG_TlistItemQ;
 
+struct ag_tlist;
+
+/* Callbacks for virtual (AG_TlistSetVirtual) mode. */
+typedef int  (*AG_TlistCountFn)(struct ag_tlist *_Nonnull, void *_Nullable);
+typedef void (*AG_TlistFetchFn)(struct ag_tlist *_Nonnull,
+                                AG_TlistItem *_Nonnull, int, void *_Nullable);
+
 typedef struct ag_tlist {
 	struct ag_widget wid;		/* AG_Widget -> AG_Tlist */
 	Uint flags;
@@ -54,6 +62,7 @@ typedef struct ag_tlist {
 #define AG_TLIST_TREE		0x010	/* Hack to display trees */
 #define AG_TLIST_HFILL		0x020
 #define AG_TLIST_VFILL		0x040
+#define AG_TLIST_VIRTUAL	0x080	/* Items supplied by fetch callback */
 #define AG_TLIST_NOSELSTATE	0x100	/* Don't preserve sel state in poll */
 #define AG_TLIST_SCROLLTOSEL	0x200	/* Scroll to initial selection */
 #define AG_TLIST_REFRESH	0x400	/* Repopulate display (for polling) */
@@ -73,6 +82,16 @@ typedef struct ag_tlist {
 	int nitems;			/* Current item count */
 	int nvisitems;			/* Visible item count */
 	AG_Scrollbar *_Nonnull sbar;	/* Vertical scrollbar */
+	AG_TlistItem *_Nullable *_Nullable index; /* Row index (by position) */
+	Uint indexMax;			/* Allocated row index entries */
+	int indexOK;			/* Row index is up to date */
+	AG_TlistItem *_Nullable *_Nullable selHash; /* Saved items by key */
+	Uint nSelHash;			/* Buckets in selHash */
+	_Nullable AG_TlistCountFn countFn; /* Item count (virtual mode) */
+	_Nullable AG_TlistFetchFn fetchFn; /* Fetch item (virtual mode) */
+	void *_Nullable virtArg;	/* User argument to countFn/fetchFn */
+	int virtFirst;			/* First materialized row (or -1) */
+	int virtCount;			/* Materialized row count */
 	AG_TAILQ_HEAD_(ag_tlist_popup) popups; /* Popup menus */
 
 	int (*_Nonnull compare_fn)(const AG_TlistItem *_Nonnull,
@@ -129,6 +148,9 @@ void AG_TlistRestore(AG_Tlist *_Nonnull);
 void AG_TlistBegin(AG_Tlist *_Nonnull);
 void AG_TlistEnd(AG_Tlist *_Nonnull);
 
+void AG_TlistSetVirtual(AG_Tlist *_Nonnull, _Nullable AG_TlistCountFn,
+                        _Nullable AG_TlistFetchFn, void *_Nullable);
+
 AG_TlistItem *_Nonnull AG_TlistItemNew(AG_Tlist *_Nonnull,
                                        const AG_Surface *_Nullable);
 
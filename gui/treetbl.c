@@ -41,6 +41,10 @@ typedef int (*VisibleForeachFn)(AG_Treetbl *tt, int x1, int x2, Uint32 visidx,
 #define VISROW(tt,i) ((tt)->visible.items[i].row)
 #define VISDEPTH(tt,i) ((tt)->visible.items[i].depth)
 
+/* Row has child rows (or children to be created on expand). */
+#define ROW_HAS_CHILDREN(row) \
+	(!TAILQ_EMPTY(&(row)->children) || ((row)->flags & AG_TREETBL_ROW_LAZY))
+
 AG_Treetbl *
 AG_TreetblNew(void *parent, Uint flags, AG_TreetblDataFn cellDataFn,
     AG_TreetblSortFn sortFn)
@@ -405,24 +409,15 @@ ClickedRow(AG_Treetbl *_Nonnull tt, int x1, int x2, Uint32 idx,
 
 	/* Check for a click on the +/- button, if applicable. */
 	if ((tt->column[idx].flags & AG_TREETBL_COL_EXPANDER) &&
-	    !TAILQ_EMPTY(&row->children) &&
+	    ROW_HAS_CHILDREN(row) &&
 	    x > (x1+4+(depth*(ts+4))) &&
 	    x < (x1+4+(depth*(ts+4))+ts)) {
 		if (row->flags & AG_TREETBL_ROW_EXPANDED) {
-			row->flags &= ~(AG_TREETBL_ROW_EXPANDED);
-			/*
-			 * XXX DeselectAll could return count to save
-			 * redundant call to CountVisibleChld
-			 */
 			DeselectAll(&row->children);
-			tt->nExpandedRows -= CountVisibleChld(
-			    &row->children, 0);
+			AG_TreetblCollapseRow(tt, row);
 		} else {
-			row->flags |= AG_TREETBL_ROW_EXPANDED;
-			tt->nExpandedRows += CountVisibleChld(&row->children, 0);
+			AG_TreetblExpandRow(tt, row);
 		}
-		tt->visible.dirty = 1;
-		AG_Redraw(tt);
 		return (0);
 	}
 	
@@ -481,7 +476,7 @@ ClickedRow(AG_Treetbl *_Nonnull tt, int x1, int x2, Uint32 idx,
 	/* Handle double-clicks. */
 	if (tt->dblClicked) {
 		AG_DelTimer(tt, &tt->toDblClick);
-		if(!TAILQ_EMPTY(&row->children)) {
+		if (ROW_HAS_CHILDREN(row)) {
 			if (row->flags & AG_TREETBL_ROW_EXPANDED) {
 				AG_TreetblCollapseRow(tt, row);
 			} else {
@@ -561,6 +556,13 @@ Init(void *_Nonnull obj)
 	TAILQ_INIT(&tt->children);
 	TAILQ_INIT(&tt->backstore);
 	tt->nExpandedRows = 0;
+	tt->expRows = NULL;
+	tt->expRowsMax = 0;
+	tt->expRowsOK = 1;
+	tt->rowHash = NULL;
+	tt->nRowHash = 0;
+	tt->nRows = 0;
+	tt->populateFn = NULL;
 
 	tt->visible.redraw_rate = 0;
 	tt->visible.redraw_last = AG_GetTicks();
@@ -719,6 +721,18 @@ AG_TreetblSetExpanderCol(AG_Treetbl *tt, AG_TreetblCol *col)
 	AG_Redraw(tt);
 }
 
+/*
+ * Set the function which creates the child rows of AG_TREETBL_ROW_LAZY
+ * rows, the first time they are expanded.
+ */
+void
+AG_TreetblSetPopulateFn(AG_Treetbl *tt, AG_TreetblPopulateFn fn)
+{
+	AG_ObjectLock(tt);
+	tt->populateFn = fn;
+	AG_ObjectUnlock(tt);
+}
+
 /* Select a column. */
 void
 AG_TreetblSelectCol(AG_Treetbl *tt, AG_TreetblCol *col)
@@ -807,6 +821,157 @@ RowIsVisible(AG_TreetblRow *_Nonnull in)
 	return (1);
 }
 
+static __inline__ Uint
+HashRowID(int rid, Uint nBuckets)
+{
+	return (Uint)(((Uint32)rid * 2654435761UL) % nBuckets);
+}
+
+/* Double the number of buckets in the row ID hash table. */
+static int
+GrowRowHash(AG_Treetbl *_Nonnull tt)
+{
+	AG_TreetblRow **rowHashNew, *row, *nrow;
+	Uint nRowHashNew, i, h;
+
+	nRowHashNew = (tt->nRowHash > 0) ? (tt->nRowHash << 1) : 64;
+	if ((rowHashNew = TryMalloc(nRowHashNew*sizeof(AG_TreetblRow *)))
+	    == NULL) {
+		return (-1);
+	}
+	memset(rowHashNew, 0, nRowHashNew*sizeof(AG_TreetblRow *));
+	for (i = 0; i < tt->nRowHash; i++) {
+		for (row = tt->rowHash[i]; row != NULL; row = nrow) {
+			nrow = row->hNext;
+			h = HashRowID(row->rid, nRowHashNew);
+			row->hNext = rowHashNew[h];
+			rowHashNew[h] = row;
+		}
+	}
+	Free(tt->rowHash);
+	tt->rowHash = rowHashNew;
+	tt->nRowHash = nRowHashNew;
+	return (0);
+}
+
+static void
+UnhashRow(AG_Treetbl *_Nonnull tt, AG_TreetblRow *_Nonnull row)
+{
+	AG_TreetblRow **pRow;
+
+	for (pRow = &tt->rowHash[HashRowID(row->rid, tt->nRowHash)];
+	     *pRow != NULL;
+	     pRow = &(*pRow)->hNext) {
+		if (*pRow == row) {
+			*pRow = row->hNext;
+			break;
+		}
+	}
+}
+
+/* Ensure that the flattened row array can hold n rows. */
+static int
+GrowExpRows(AG_Treetbl *_Nonnull tt, Uint n)
+{
+	AG_TreetblRow **expRowsNew;
+	Uint expRowsMaxNew;
+
+	if (n <= tt->expRowsMax) {
+		return (0);
+	}
+	expRowsMaxNew = MAX(n, tt->expRowsMax << 1);
+	if ((expRowsNew = TryRealloc(tt->expRows,
+	    expRowsMaxNew*sizeof(AG_TreetblRow *))) == NULL) {
+		return (-1);
+	}
+	tt->expRows = expRowsNew;
+	tt->expRowsMax = expRowsMaxNew;
+	return (0);
+}
+
+/* Store the visible rows of a subtree in display order, starting at *n. */
+static void
+FlattenRows(AG_Treetbl *_Nonnull tt, AG_TreetblRowQ *_Nonnull in,
+    Uint *_Nonnull n)
+{
+	AG_TreetblRow *row;
+
+	TAILQ_FOREACH(row, in, siblings) {
+		if (*n < tt->expRowsMax) {
+			tt->expRows[*n] = row;
+		}
+		(*n)++;
+		if ((row->flags & AG_TREETBL_ROW_EXPANDED) &&
+		    !TAILQ_EMPTY(&row->children))
+			FlattenRows(tt, &row->children, n);
+	}
+}
+
+/* Rebuild the flattened row array if it is out of date. */
+static int
+UpdateExpRows(AG_Treetbl *_Nonnull tt)
+{
+	Uint n = 0;
+
+	if (tt->expRowsOK) {
+		return (0);
+	}
+	if (GrowExpRows(tt, (Uint)tt->nExpandedRows) == -1) {
+		return (-1);
+	}
+	FlattenRows(tt, &tt->children, &n);
+	if (n > tt->expRowsMax) {
+		if (GrowExpRows(tt, n) == -1) {
+			return (-1);
+		}
+		n = 0;
+		FlattenRows(tt, &tt->children, &n);
+	}
+	tt->nExpandedRows = (int)n;
+	tt->expRowsOK = 1;
+	return (0);
+}
+
+/*
+ * Insert (or remove) the nChld visible descendants of a row being expanded
+ * (or collapsed) after the row in the flattened row array. Must be called
+ * before nExpandedRows is updated.
+ */
+static void
+SpliceExpRows(AG_Treetbl *_Nonnull tt, AG_TreetblRow *_Nonnull row,
+    Uint nChld, int expand)
+{
+	Uint n = (Uint)tt->nExpandedRows, i;
+
+	if (!tt->expRowsOK || nChld == 0) {
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		if (tt->expRows[i] == row)
+			break;
+	}
+	if (i++ == n) {
+		goto invalidate;
+	}
+	if (expand) {
+		if (GrowExpRows(tt, n+nChld) == -1) {
+			goto invalidate;
+		}
+		memmove(&tt->expRows[i+nChld], &tt->expRows[i],
+		    (n-i)*sizeof(AG_TreetblRow *));
+		FlattenRows(tt, &row->children, &i);
+	} else {
+		if (i+nChld > n) {
+			goto invalidate;
+		}
+		memmove(&tt->expRows[i], &tt->expRows[i+nChld],
+		    (n-i-nChld)*sizeof(AG_TreetblRow *));
+	}
+	return;
+invalidate:
+	tt->expRowsOK = 0;
+}
+
 /* Insert a row in the table. */
 AG_TreetblRow *
 AG_TreetblAddRow(AG_Treetbl *tt, AG_TreetblRow *pRow, int rowID,
@@ -826,10 +991,13 @@ AG_TreetblAddRow(AG_Treetbl *tt, AG_TreetblRow *pRow, int rowID,
 
 	/* Check if row ID is already use */
 	if (!(tt->flags & AG_TREETBL_NODUPCHECKS) &&
-	    AG_TreetblLookupRowRecurse(&tt->children, rowID)) {
+	    AG_TreetblLookupRow(tt, rowID) != NULL) {
 		AG_SetError("Existing row ID: %d", rowID);
 		goto fail;
 	}
+	if (tt->nRows >= (tt->nRowHash << 1) &&
+	    GrowRowHash(tt) == -1 && tt->nRowHash == 0)
+		goto fail;
 	
 	if ((row = TryMalloc(sizeof(AG_TreetblRow))) == NULL) {
 		goto fail;
@@ -840,6 +1008,7 @@ AG_TreetblAddRow(AG_Treetbl *tt, AG_TreetblRow *pRow, int rowID,
 		goto fail;
 	}
 	row->flags = 0;
+	row->depth = (pRow != NULL) ? pRow->depth+1 : 0;
 	row->parent = pRow;
 	TAILQ_INIT(&row->children);
 
@@ -881,10 +1050,21 @@ AG_TreetblAddRow(AG_Treetbl *tt, AG_TreetblRow *pRow, int rowID,
 	} else {
 		TAILQ_INSERT_TAIL(&tt->children, row, siblings);
 	}
+	i = HashRowID(rowID, tt->nRowHash);
+	row->hNext = tt->rowHash[i];
+	tt->rowHash[i] = row;
+	tt->nRows++;
 
 	/* increment scroll only if visible: */
-	if (RowIsVisible(row))
+	if (RowIsVisible(row)) {
+		if (pRow == NULL && tt->expRowsOK &&
+		    GrowExpRows(tt, (Uint)tt->nExpandedRows+1) == 0) {
+			tt->expRows[tt->nExpandedRows] = row;	/* Last row */
+		} else {
+			tt->expRowsOK = 0;
+		}
 		tt->nExpandedRows++;
+	}
 
 	tt->visible.dirty = 1;
 
@@ -919,16 +1099,23 @@ AG_TreetblLookupRowRecurse(AG_TreetblRowQ *searchIn, int rid)
 }
 
 /*
- * Lookup a row by ID.
+ * Lookup a row by ID (using the row ID hash table).
  * Return value is valid as long as Treetbl is locked.
  */
 AG_TreetblRow *_Nullable
 AG_TreetblLookupRow(AG_Treetbl *tt, int rowID)
 {
-	AG_TreetblRow *row;
+	AG_TreetblRow *row = NULL;
 
 	AG_ObjectLock(tt);
-	row = AG_TreetblLookupRowRecurse(&tt->children, rowID);
+	if (tt->nRowHash > 0) {
+		for (row = tt->rowHash[HashRowID(rowID, tt->nRowHash)];
+		     row != NULL;
+		     row = row->hNext) {
+			if (row->rid == rowID)
+				break;
+		}
+	}
 	AG_ObjectUnlock(tt);
 	return (row);
 }
@@ -1021,8 +1208,12 @@ AG_TreetblDelRow(AG_Treetbl *tt, AG_TreetblRow *row)
 	}
 
 	/* now that children are gone, remove this row */
-	if (RowIsVisible(row))
+	if (RowIsVisible(row)) {
 		tt->nExpandedRows--;
+		tt->expRowsOK = 0;
+	}
+	UnhashRow(tt, row);
+	tt->nRows--;
 
 	if (row->parent) {
 		TAILQ_REMOVE(&row->parent->children, row, siblings);
@@ -1059,6 +1250,7 @@ AG_TreetblClearRows(AG_Treetbl *tt)
 	TAILQ_INIT(&tt->children);
 	
 	tt->nExpandedRows = 0;
+	tt->expRowsOK = 1;
 	tt->visible.dirty = 1;
 	AG_ObjectUnlock(tt);
 	AG_Redraw(tt);
@@ -1172,11 +1364,20 @@ AG_TreetblDeselectRow(AG_Treetbl *tt, AG_TreetblRow *row)
 void
 AG_TreetblExpandRow(AG_Treetbl *tt, AG_TreetblRow *in)
 {
+	int nChld;
+
 	AG_ObjectLock(tt);
 	if (!(in->flags & AG_TREETBL_ROW_EXPANDED)) {
+		if ((in->flags & AG_TREETBL_ROW_LAZY) &&
+		    tt->populateFn != NULL) {
+			in->flags &= ~(AG_TREETBL_ROW_LAZY);
+			tt->populateFn(tt, in);
+		}
 		in->flags |= AG_TREETBL_ROW_EXPANDED;
 		if (RowIsVisible(in)) {
-			tt->nExpandedRows += CountVisibleChld(&in->children, 0);
+			nChld = CountVisibleChld(&in->children, 0);
+			SpliceExpRows(tt, in, (Uint)nChld, 1);
+			tt->nExpandedRows += nChld;
 			tt->visible.dirty = 1;
 			AG_Redraw(tt);
 		}
@@ -1188,11 +1389,15 @@ AG_TreetblExpandRow(AG_Treetbl *tt, AG_TreetblRow *in)
 void
 AG_TreetblCollapseRow(AG_Treetbl *tt, AG_TreetblRow *in)
 {
+	int nChld;
+
 	AG_ObjectLock(tt);
 	if (in->flags & AG_TREETBL_ROW_EXPANDED) {
 		in->flags &= ~(AG_TREETBL_ROW_EXPANDED);
 		if (RowIsVisible(in)) {
-			tt->nExpandedRows -= CountVisibleChld(&in->children, 0);
+			nChld = CountVisibleChld(&in->children, 0);
+			SpliceExpRows(tt, in, (Uint)nChld, 0);
+			tt->nExpandedRows -= nChld;
 			tt->visible.dirty = 1;
 			AG_Redraw(tt);
 		}
@@ -1208,6 +1413,8 @@ Destroy(void *_Nonnull p)
 	AG_TreetblClearRows(tt);
 	Free(tt->column);
 	Free(tt->visible.items);
+	Free(tt->expRows);
+	Free(tt->rowHash);
 }
 
 static void
@@ -1462,7 +1669,7 @@ DrawColumn(AG_Treetbl *_Nonnull tt, int x1, int x2, Uint32 idx,
 			int tw = (tt->hRow >> 1) + 1;
 
 			x += VISDEPTH(tt,j)*(tw+4);
-			if (!TAILQ_EMPTY(&VISROW(tt,j)->children)) {
+			if (ROW_HAS_CHILDREN(VISROW(tt,j))) {
 				rd.x = x;
 				rd.y = y + (tw >> 1);
 				rd.w = tw;
@@ -1538,7 +1745,7 @@ ViewChangedRecurse(AG_Treetbl *_Nonnull tt, AG_TreetblRowQ *_Nonnull in,
 static void
 ViewChanged(AG_Treetbl *_Nonnull tt)
 {
-	int rows_per_view, max, filled, value;
+	int rows_per_view, max, filled, value, expRowsOK;
 	int scrolling_area = HEIGHT(tt->vBar) - tt->vBar->width*2;
 	Uint i;
 
@@ -1547,6 +1754,8 @@ ViewChanged(AG_Treetbl *_Nonnull tt)
 	AG_DelTimer(tt, &tt->toDblClick);
 	tt->dblClicked = 0;
 #endif
+	expRowsOK = (UpdateExpRows(tt) == 0);
+
 	rows_per_view = tt->r.h/tt->hRow;
 	if (tt->r.h % tt->hRow)
 		rows_per_view++;
@@ -1572,7 +1781,19 @@ ViewChanged(AG_Treetbl *_Nonnull tt)
 
 	/* locate visible rows */
 	value = AG_GetInt(tt->vBar, "value");
-	filled = ViewChangedRecurse(tt, &tt->children, 0, 0, &value);
+	if (expRowsOK) {
+		for (filled = 0;
+		     filled < (int)tt->visible.count &&
+		     value+filled < tt->nExpandedRows;
+		     filled++) {
+			AG_TreetblRow *row = tt->expRows[value+filled];
+
+			VISROW(tt,filled) = row;
+			VISDEPTH(tt,filled) = row->depth;
+		}
+	} else {
+		filled = ViewChangedRecurse(tt, &tt->children, 0, 0, &value);
+	}
 
 	/* blank empty rows */
 	for (i = filled; i < tt->visible.count; i++)
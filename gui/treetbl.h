@@ -8,10 +8,13 @@
 #include <agar/gui/begin.h>
 
 struct ag_treetbl;
+struct ag_treetbl_row;
 
 typedef char *_Nullable (*AG_TreetblDataFn)(struct ag_treetbl *_Nonnull, int,int);
 typedef int             (*AG_TreetblSortFn)(struct ag_treetbl *_Nonnull, int,
                                             int, int, int);
+typedef void            (*AG_TreetblPopulateFn)(struct ag_treetbl *_Nonnull,
+                                                struct ag_treetbl_row *_Nonnull);
 
 enum ag_treetbl_sort_mode {
 	AG_TREETBL_SORT_NOT = 0,
@@ -55,11 +58,14 @@ typedef struct ag_treetbl_row {
 #define AG_TREETBL_ROW_EXPANDED	0x01	/* Tree expanded */
 #define AG_TREETBL_ROW_DYNAMIC	0x02	/* Update dynamically */
 #define AG_TREETBL_ROW_SELECTED	0x04	/* Row is selected */
+#define AG_TREETBL_ROW_LAZY	0x08	/* Populate children on expand */
 
+	Uint depth;			/* Depth in tree */
 	struct ag_treetbl_row *_Nullable parent;
 	AG_TreetblRowQ children;
 	AG_TAILQ_ENTRY(ag_treetbl_row) siblings;
 	AG_TAILQ_ENTRY(ag_treetbl_row) backstore;
+	struct ag_treetbl_row *_Nullable hNext;	/* In row ID hash bucket */
 } AG_TreetblRow;
 
 typedef struct ag_treetbl {
@@ -90,12 +96,19 @@ typedef struct ag_treetbl {
 	AG_TreetblRowQ children;	/* Tree of rows */
 	AG_TreetblRowQ backstore;	/* For polling */
 	int nExpandedRows;		/* Number of rows visible */
+	AG_TreetblRow *_Nullable *_Nullable expRows; /* Flattened visible rows */
+	Uint expRowsMax;		/* Allocated expRows entries */
+	int expRowsOK;			/* expRows is up to date */
+	AG_TreetblRow *_Nullable *_Nullable rowHash; /* Rows by ID */
+	Uint nRowHash;			/* Buckets in rowHash */
+	Uint nRows;			/* Rows in the tree */
 	
 	AG_Scrollbar *_Nonnull  vBar;	/* Vertical scrollbar */
 	AG_Scrollbar *_Nullable hBar;	/* Horizontal scrollbar */
 	
 	_Nullable AG_TreetblDataFn cellDataFn;	/* Callback to get cell data */
 	_Nullable AG_TreetblSortFn sortFn;	/* Compare function */
+	_Nullable AG_TreetblPopulateFn populateFn; /* Create child rows */
 	
 	struct {
 		Uint redraw_last;			/* Last drawn */
@@ -123,6 +136,8 @@ void AG_TreetblSetColHeight(AG_Treetbl *_Nonnull, int);
 void AG_TreetblSetSortCol(AG_Treetbl *_Nonnull, AG_TreetblCol *_Nonnull);
 void AG_TreetblSetSortMode(AG_Treetbl *_Nonnull, enum ag_treetbl_sort_mode);
 void AG_TreetblSetExpanderCol(AG_Treetbl *_Nonnull, AG_TreetblCol *_Nonnull);
+void AG_TreetblSetPopulateFn(AG_Treetbl *_Nonnull,
+                             _Nullable AG_TreetblPopulateFn);
 
 AG_TreetblCol *_Nullable AG_TreetblAddCol(AG_Treetbl *_Nonnull, int,
                                           const char *_Nullable,
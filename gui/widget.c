@@ -262,6 +262,18 @@ RedrawOnTickTimeout(AG_Timer *_Nonnull to, AG_Event *_Nonnull event)
 	return (to->ival);
 }
 
+/*
+ * Return 1 if changes to the given widget variable are signaled by
+ * "variable-changed" events, such that AG_RedrawOnChange() needs no polling.
+ * References to other variables are not followed and are always polled.
+ */
+static __inline__ int
+VariableIsPushed(const AG_Variable *_Nonnull V)
+{
+	return (V->type != AG_VARIABLE_P_VARIABLE &&
+	        (V->flags & AG_VARIABLE_NOTIFY));
+}
+
 /* Timer callback for AG_RedrawOnChange(). */
 static Uint32
 RedrawOnChangeTimeout(AG_Timer *_Nonnull to, AG_Event *_Nonnull event)
@@ -271,6 +283,15 @@ RedrawOnChangeTimeout(AG_Timer *_Nonnull to, AG_Event *_Nonnull event)
 	AG_Variable *V, Vd;
 	void *p;
 
+	TAILQ_FOREACH(V, &OBJECT(wid)->vars, vars) {
+		if (strcmp(V->name, rt->name) == 0)
+			break;
+	}
+	if (V != NULL && VariableIsPushed(V)) {
+		rt->flags |= AG_REDRAW_TIE_PUSHED;     /* Stop polling */
+		return (0);
+	}
+
 	V = AG_GetVariable(wid, rt->name, &p);
 	AG_DerefVariable(&Vd, V);
 	if (!rt->VlastInited || AG_CompareVariables(&Vd, &rt->Vlast) != 0) {
@@ -283,6 +304,42 @@ RedrawOnChangeTimeout(AG_Timer *_Nonnull to, AG_Event *_Nonnull event)
 	AG_UnlockVariable(V);
 	return (to->ival);
 }
+
+/*
+ * Handler for "variable-changed" (for AG_RedrawOnChange()). Redraw if the
+ * variable is tied, and switch the tie between polling and push modes if
+ * the variable has gained (or lost) the ability to signal its changes.
+ */
+static void
+OnVariableChanged(AG_Event *_Nonnull event)
+{
+	AG_Widget *wid = AG_SELF();
+	const AG_Variable *V = AG_PTR(1);
+	AG_RedrawTie *rt;
+
+	TAILQ_FOREACH(rt, &wid->pvt.redrawTies, redrawTies) {
+		if (rt->type != AG_REDRAW_ON_CHANGE ||
+		    strcmp(rt->name, V->name) != 0) {
+			continue;
+		}
+		if (!(wid->flags & AG_WIDGET_VISIBLE))
+			continue;			/* Re-evaluate in OnShow() */
+
+		AG_Redraw(wid);
+
+		if (VariableIsPushed(V)) {
+			if (!(rt->flags & AG_REDRAW_TIE_PUSHED)) {
+				rt->flags |= AG_REDRAW_TIE_PUSHED;
+				AG_DelTimer(wid, &rt->to);
+			}
+		} else if (rt->flags & AG_REDRAW_TIE_PUSHED) {
+			rt->flags &= ~(AG_REDRAW_TIE_PUSHED);
+			rt->VlastInited = 0;
+			AG_AddTimer(wid, &rt->to, rt->ival,
+			    RedrawOnChangeTimeout, "%p", rt);
+		}
+	}
+}
 #endif /* AG_TIMERS */
 
 static void
@@ -306,6 +363,8 @@ OnShow(AG_Event *_Nonnull event)
 			    RedrawOnTickTimeout, NULL);
 			break;
 		case AG_REDRAW_ON_CHANGE:
+			rt->flags &= ~(AG_REDRAW_TIE_PUSHED);
+			rt->VlastInited = 0;
 			AG_AddTimer(wid, &rt->to, rt->ival,
 			    RedrawOnChangeTimeout, "%p", rt);
 			break;
@@ -410,14 +469,21 @@ AG_RedrawOnChange(void *obj, int refresh_ms, const char *name)
 			break;
 	}
 	if (rt != NULL) {
-		AG_ResetTimer(wid, &rt->to, refresh_ms);
+		if (!(rt->flags & AG_REDRAW_TIE_PUSHED)) {
+			AG_ResetTimer(wid, &rt->to, refresh_ms);
+		}
 		return;
 	}
+	if (!(OBJECT(wid)->flags & AG_OBJECT_CHANGED_EVENTS)) {
+		OBJECT(wid)->flags |= AG_OBJECT_CHANGED_EVENTS;
+		AG_AddEvent(wid, "variable-changed", OnVariableChanged, NULL);
+	}
 	
 	rt = Malloc(sizeof(AG_RedrawTie));
 	rt->type = AG_REDRAW_ON_CHANGE;
 	rt->ival = refresh_ms;
 	rt->VlastInited = 0;
+	rt->flags = 0;
 	Strlcpy(rt->name, name, sizeof(rt->name));
 	AG_InitTimer(&rt->to, "redrawTie-", 0);
 #ifdef AG_DEBUG
@@ -457,6 +523,7 @@ AG_RedrawOnTick(void *obj, int refresh_ms)
 	rt = Malloc(sizeof(AG_RedrawTie));
 	rt->type = AG_REDRAW_ON_TICK;
 	rt->ival = refresh_ms;
+	rt->flags = 0;
 	rt->name[0] = '\0';
 	AG_InitTimer(&rt->to, "redrawTick", 0);
 	TAILQ_INSERT_TAIL(&wid->pvt.redrawTies, rt, redrawTies);
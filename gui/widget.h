@@ -115,6 +115,9 @@ typedef struct ag_redraw_tie {
 	char name[AG_VARIABLE_NAME_MAX];	/* Polled variable */
 	AG_Variable Vlast;			/* Last accessed data */
 	int         VlastInited;
+	Uint flags;
+#define AG_REDRAW_TIE_PUSHED 0x01		/* Redraw on "variable-changed"
+						   (polling timer is stopped) */
 	AG_Timer to;				/* Polling timer */
 	Uint ival;				/* Polling interval */
 	AG_TAILQ_ENTRY(ag_redraw_tie) redrawTies; /* In widget */
@@ -167,6 +167,8 @@ MoveNodes(MAP_Actor *a, int xo, int yo)
 					TAILQ_INSERT_TAIL(&n2->nrefs, r, nrefs);
 					r->r_gfx.xmotion = a->g_map.xmot;
 					r->r_gfx.ymotion = a->g_map.ymot;
+					MAP_InvalidateNode(m, x, y);
+					MAP_InvalidateNode(m, x+xo, y+yo);
 					break;
 				}
 			}
@@ -206,6 +208,7 @@ MAP_ActorMoveTile(void *obj, int xo, int yo)
 
 				r->r_gfx.xmotion = a->g_map.xmot;
 				r->r_gfx.ymotion = a->g_map.ymot;
+				MAP_InvalidateNode(m, x, y);
 					
 				switch (a->g_map.da) {
 				case 0:
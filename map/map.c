@@ -243,11 +243,14 @@ MAP_ItemAttrColor(Uint flag, int state, AG_Color *c)
 	}
 }
 
-/* Allocate and initialize the node map. */
+/*
+ * Allocate and initialize the node map. The nodes are allocated as a
+ * single block and m->map[y] points to the start of row y.
+ */
 int
 MAP_AllocNodes(MAP *m, Uint w, Uint h)
 {
-	Uint x, y;
+	Uint i, n;
 	
 	if (w > MAP_WIDTH_MAX || h > MAP_HEIGHT_MAX) {
 		AG_SetError(_("%ux%u nodes exceed %ux%u."), w, h,
@@ -259,12 +262,18 @@ MAP_AllocNodes(MAP *m, Uint w, Uint h)
 	m->mapw = w;
 	m->maph = h;
 	m->map = Malloc(h*sizeof(MAP_Node *));
-	for (y = 0; y < h; y++) {
-		m->map[y] = Malloc(w*sizeof(MAP_Node));
-		for (x = 0; x < w; x++) {
-			MAP_NodeInit(&m->map[y][x]);
-		}
-	}
+	m->nodes = Malloc(w*h*sizeof(MAP_Node));
+	for (i = 0, n = w*h; i < n; i++) {
+		MAP_NodeInit(&m->nodes[i]);
+	}
+	for (i = 0; i < h; i++) {
+		m->map[i] = &m->nodes[i*w];
+	}
+	m->chunkw = (w + MAP_CHUNK_SIZE-1) / MAP_CHUNK_SIZE;
+	m->chunkh = (h + MAP_CHUNK_SIZE-1) / MAP_CHUNK_SIZE;
+	m->chunkGen = Malloc(m->chunkw*m->chunkh*sizeof(Uint32));
+	memset(m->chunkGen, 0, m->chunkw*m->chunkh*sizeof(Uint32));
+	m->gen++;
 	AG_ObjectUnlock(m);
 	return (0);
 }
@@ -273,24 +282,81 @@ MAP_AllocNodes(MAP *m, Uint w, Uint h)
 void
 MAP_FreeNodes(MAP *m)
 {
-	Uint x, y;
-	MAP_Node *node;
+	Uint i, n;
 
 	AG_ObjectLock(m);
 	if (m->map != NULL) {
-		for (y = 0; y < m->maph; y++) {
-			for (x = 0; x < m->mapw; x++) {
-				node = &m->map[y][x];
-				MAP_NodeDestroy(m, node);
-			}
-			free(m->map[y]);
+		for (i = 0, n = m->mapw*m->maph; i < n; i++) {
+			MAP_NodeDestroy(m, &m->nodes[i]);
 		}
+		free(m->nodes);
 		free(m->map);
+		m->nodes = NULL;
 		m->map = NULL;
 	}
+	Free(m->chunkGen);
+	m->chunkGen = NULL;
+	m->chunkw = 0;
+	m->chunkh = 0;
+	m->gen++;
+	AG_ObjectUnlock(m);
+}
+
+/*
+ * Signal that the contents of node x,y have changed. Bump the change
+ * counter of its chunk, and of any neighbouring chunk whose margin
+ * includes the node.
+ */
+void
+MAP_InvalidateNode(MAP *m, int x, int y)
+{
+	int cx, cy, cx1, cy1, cx2, cy2;
+
+	if (m->chunkGen == NULL ||
+	    x < 0 || y < 0 || x >= (int)m->mapw || y >= (int)m->maph) {
+		return;
+	}
+	cx1 = (x - MAP_CHUNK_MARGIN) / MAP_CHUNK_SIZE;
+	cy1 = (y - MAP_CHUNK_MARGIN) / MAP_CHUNK_SIZE;
+	cx2 = (x + MAP_CHUNK_MARGIN) / MAP_CHUNK_SIZE;
+	cy2 = (y + MAP_CHUNK_MARGIN) / MAP_CHUNK_SIZE;
+	if (x < MAP_CHUNK_MARGIN) { cx1 = 0; }
+	if (y < MAP_CHUNK_MARGIN) { cy1 = 0; }
+	if (cx2 >= (int)m->chunkw) { cx2 = (int)m->chunkw-1; }
+	if (cy2 >= (int)m->chunkh) { cy2 = (int)m->chunkh-1; }
+
+	for (cy = cy1; cy <= cy2; cy++) {
+		for (cx = cx1; cx <= cx2; cx++)
+			m->chunkGen[cy*m->chunkw + cx]++;
+	}
+}
+
+/*
+ * Signal a map-wide change (such as a change in the set of layers),
+ * invalidating all cached renderings.
+ */
+void
+MAP_Invalidate(MAP *m)
+{
+	AG_ObjectLock(m);
+	m->gen++;
 	AG_ObjectUnlock(m);
 }
 
+/* Invalidate a node given its address, if it belongs to the node map of m. */
+static void
+NodeChanged(MAP *_Nonnull m, const MAP_Node *_Nonnull node)
+{
+	Uint i;
+
+	if (m->nodes == NULL ||
+	    node < m->nodes || node >= &m->nodes[m->mapw*m->maph]) {
+		return;
+	}
+	i = (Uint)(node - m->nodes);
+	MAP_InvalidateNode(m, (int)(i % m->mapw), (int)(i / m->mapw));
+}
+
 static void
 FreeLayers(MAP *_Nonnull m)
 {
@@ -481,6 +547,11 @@ Init(void *_Nonnull obj)
 	m->origin.y = 0;
 	m->origin.layer = 0;
 	m->map = NULL;
+	m->nodes = NULL;
+	m->chunkGen = NULL;
+	m->chunkw = 0;
+	m->chunkh = 0;
+	m->gen = 0;
 	m->cur_layer = 0;
 	m->layers = Malloc(sizeof(MAP_Layer));
 	m->nlayers = 1;
@@ -520,6 +591,7 @@ MAP_PushLayer(MAP *m, const char *name)
 	m->layers = Realloc(m->layers, (m->nlayers+1)*sizeof(MAP_Layer));
 	MAP_InitLayer(&m->layers[m->nlayers], layname);
 	m->nlayers++;
+	m->gen++;
 	return (0);
 }
 
@@ -529,6 +601,8 @@ MAP_PopLayer(MAP *m)
 {
 	if (--m->nlayers < 1)
 		m->nlayers = 1;
+
+	m->gen++;
 }
 
 /* Set or change the tile reference of a TILE item. */
@@ -571,6 +645,7 @@ MAP_NodeAddTile(MAP *map, MAP_Node *node, RG_Tileset *ts, Uint32 tileid)
 	MAP_ItemInit(r, MAP_ITEM_TILE);
 	MAP_ItemSetTile(r, map, ts, tileid);
 	TAILQ_INSERT_TAIL(&node->nrefs, r, nrefs);
+	NodeChanged(map, node);
 	return (r);
 }
 
@@ -620,6 +695,7 @@ MAP_NodeAddAnim(MAP *map, MAP_Node *node, RG_Tileset *ts, Uint32 animid)
 	MAP_ItemInit(r, MAP_ITEM_ANIM);
 	MAP_ItemSetAnim(r, map, ts, animid);
 	TAILQ_INSERT_TAIL(&node->nrefs, r, nrefs);
+	NodeChanged(map, node);
 	return (r);
 }
 
@@ -660,6 +736,9 @@ MAP_NodeMoveItem(MAP *sm, MAP_Node *sn, MAP_Item *r, MAP *dm, MAP_Node *dn,
 	if (dlayer != -1)
 		r->layer = dlayer;
 
+	NodeChanged(sm, sn);
+	NodeChanged(dm, dn);
+
 	switch (r->type) {
 	case MAP_ITEM_TILE:
 		AG_ObjectDelDep(sm, r->r_tile.obj);
@@ -773,6 +852,7 @@ MAP_NodeDelItem(MAP *m, MAP_Node *node, MAP_Item *r)
 	AG_ObjectLock(m);
 	TAILQ_REMOVE(&node->nrefs, r, nrefs);
 	MAP_ItemDestroy(m, r);
+	NodeChanged(m, node);
 	AG_ObjectUnlock(m);
 	
 	free(r);
@@ -798,6 +878,7 @@ MAP_NodeRemoveAll(MAP *m, MAP_Node *node, int layer)
 		MAP_ItemDestroy(m, r);
 		free(r);
 	}
+	NodeChanged(m, node);
 
 	AG_ObjectUnlock(m);
 }
@@ -813,6 +894,7 @@ MAP_NodeSwapLayers(MAP *m, MAP_Node *node, int layer1, int layer2)
 		if (r->layer == layer1)
 			r->layer = layer2;
 	}
+	NodeChanged(m, node);
 	AG_ObjectUnlock(m);
 }
 
@@ -821,13 +903,14 @@ MAP_NodeSwapLayers(MAP *m, MAP_Node *node, int layer1, int layer2)
  * The map containing the node must be locked.
  */
 void
-MAP_NodeMoveItemUp(MAP_Node *node, MAP_Item *r)
+MAP_NodeMoveItemUp(MAP *m, MAP_Node *node, MAP_Item *r)
 {
 	MAP_Item *next = TAILQ_NEXT(r, nrefs);
 
 	if (next != NULL) {
 		TAILQ_REMOVE(&node->nrefs, r, nrefs);
 		TAILQ_INSERT_AFTER(&node->nrefs, next, r, nrefs);
+		NodeChanged(m, node);
 	}
 }
 
@@ -836,13 +919,14 @@ MAP_NodeMoveItemUp(MAP_Node *node, MAP_Item *r)
  * The map containing the node must be locked.
  */
 void
-MAP_NodeMoveItemDown(MAP_Node *node, MAP_Item *r)
+MAP_NodeMoveItemDown(MAP *m, MAP_Node *node, MAP_Item *r)
 {
 	MAP_Item *prev = TAILQ_PREV(r, map_itemq, nrefs);
 
 	if (prev != NULL) {
 		TAILQ_REMOVE(&node->nrefs, r, nrefs);
 		TAILQ_INSERT_BEFORE(prev, r, nrefs);
+		NodeChanged(m, node);
 	}
 }
 
@@ -851,11 +935,12 @@ MAP_NodeMoveItemDown(MAP_Node *node, MAP_Item *r)
  * The map containing the node must be locked.
  */
 void
-MAP_NodeMoveItemToTail(MAP_Node *node, MAP_Item *r)
+MAP_NodeMoveItemToTail(MAP *m, MAP_Node *node, MAP_Item *r)
 {
 	if (r != TAILQ_LAST(&node->nrefs, map_itemq)) {
 		TAILQ_REMOVE(&node->nrefs, r, nrefs);
 		TAILQ_INSERT_TAIL(&node->nrefs, r, nrefs);
+		NodeChanged(m, node);
 	}
 }
 
@@ -864,11 +949,12 @@ MAP_NodeMoveItemToTail(MAP_Node *node, MAP_Item *r)
  * The map containing the node must be locked.
  */
 void
-MAP_NodeMoveItemToHead(MAP_Node *node, MAP_Item *r)
+MAP_NodeMoveItemToHead(MAP *m, MAP_Node *node, MAP_Item *r)
 {
 	if (r != TAILQ_FIRST(&node->nrefs)) {
 		TAILQ_REMOVE(&node->nrefs, r, nrefs);
 		TAILQ_INSERT_HEAD(&node->nrefs, r, nrefs);
+		NodeChanged(m, node);
 	}
 }
 
@@ -1185,10 +1271,22 @@ Load(void *_Nonnull ob, AG_DataSource *_Nonnull ds, const AG_Version *_Nonnull v
 	if (MAP_AllocNodes(m, m->mapw, m->maph) == -1) {
 		goto fail;
 	}
-	for (y = 0; y < m->maph; y++) {
-		for (x = 0; x < m->mapw; x++) {
-			if (MAP_NodeLoad(m, ds, &m->map[y][x]) == -1)
-				goto fail;
+	if (m->flags & AG_MAP_SAVE_COMPACT) {
+		MAP_Store st;
+
+		MAP_StoreInit(&st, m, m->mapw, m->maph);
+		if (MAP_StoreLoad(&st, ds) == -1 ||
+		    MAP_StoreGet(&st, 0,0, m, 0,0, m->mapw, m->maph) == -1) {
+			MAP_StoreDestroy(&st);
+			goto fail;
+		}
+		MAP_StoreDestroy(&st);
+	} else {
+		for (y = 0; y < m->maph; y++) {
+			for (x = 0; x < m->mapw; x++) {
+				if (MAP_NodeLoad(m, ds, &m->map[y][x]) == -1)
+					goto fail;
+			}
 		}
 	}
 
@@ -1333,9 +1431,21 @@ Save(void *_Nonnull p, AG_DataSource *_Nonnull ds)
 	}
 
 	/* Write the nodes. */
-	for (y = 0; y < m->maph; y++) {
-		for (x = 0; x < m->mapw; x++)
-			MAP_NodeSave(m, ds, &m->map[y][x]);
+	if (m->flags & AG_MAP_SAVE_COMPACT) {
+		MAP_Store st;
+
+		MAP_StoreInit(&st, m, m->mapw, m->maph);
+		if (MAP_StorePut(&st, 0,0, m, 0,0, m->mapw, m->maph) == -1) {
+			MAP_StoreDestroy(&st);
+			return (-1);
+		}
+		MAP_StoreSave(&st, ds);
+		MAP_StoreDestroy(&st);
+	} else {
+		for (y = 0; y < m->maph; y++) {
+			for (x = 0; x < m->mapw; x++)
+				MAP_NodeSave(m, ds, &m->map[y][x]);
+		}
 	}
 	return (0);
 }
@@ -1611,6 +1721,8 @@ MAP_ModNodeChg(MAP *m, int x, int y)
 	MAP_Item *sr;
 	Uint i;
 
+	MAP_InvalidateNode(m, x, y);
+
 	for (i = 0; i < blk->nmods; i++) {
 		mm = &blk->mods[i];
 		if (mm->type == AG_MAPMOD_NODECHG &&
@@ -2135,6 +2247,7 @@ DeleteLayer(AG_Event *_Nonnull event)
 			}
 		}
 	}
+	MAP_Invalidate(m);
 }
 
 /* Destroy all items on a given layer. */
@@ -2166,6 +2279,7 @@ ClearLayer(AG_Event *_Nonnull event)
 			}
 		}
 	}
+	MAP_Invalidate(m);
 }
 
 /* Move a layer (and its associated items) up or down the stack. */
@@ -2214,6 +2328,7 @@ MoveLayer(AG_Event *_Nonnull event)
 			}
 		}
 	}
+	MAP_Invalidate(m);
 	AG_TlistSelectPtr(tlLayers, lay2);
 }
 
@@ -2666,7 +2781,7 @@ Edit(void *_Nonnull p)
 AG_ObjectClass mapClass = {
 	"MAP",
 	sizeof(MAP),
-	{ 11, 0 },
+	{ 11, 1 },
 	Init,
 	Reset,
 	Destroy,
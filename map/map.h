@@ -16,6 +16,8 @@
 #define MAP_CAMERA_NAME_MAX	128
 #define MAP_NODE_ITEMS_MAX	32767
 #define MAP_ITEM_MAXMASKS	16384
+#define MAP_CHUNK_SIZE		16	/* Nodes per side of a chunk */
+#define MAP_CHUNK_MARGIN	1	/* Node overlap between chunks */
 
 #include <agar/map/nodemask.h>
 
@@ -144,7 +146,9 @@ typedef struct map {
 	Uint flags;
 #define AG_MAP_SAVE_CAM0POS	0x01	/* Save the camera 0 position */
 #define AG_MAP_SAVE_CAM0ZOOM	0x02	/* Save the camera 0 zoom factor */
-#define AG_MAP_SAVED_FLAGS	(AG_MAP_SAVE_CAM0POS|AG_MAP_SAVE_CAM0ZOOM)
+#define AG_MAP_SAVE_COMPACT	0x04	/* Save nodes in bulk (MAP_Store) form */
+#define AG_MAP_SAVED_FLAGS	(AG_MAP_SAVE_CAM0POS|AG_MAP_SAVE_CAM0ZOOM| \
+				 AG_MAP_SAVE_COMPACT)
 
 	Uint mapw, maph;		/* Map geometry */
 	int cur_layer;			/* Layer being edited */
@@ -153,8 +157,13 @@ typedef struct map {
 		int layer;		/* Default tile layer */
 	} origin;
 	MAP_Node *_Nullable *_Nonnull map;	/* Arrays of nodes */
+	MAP_Node *_Nullable nodes;		/* Node storage (mapw*maph) */
 	int redraw;				/* Redraw (for tile-based mode) */
 
+	Uint32 *_Nullable chunkGen;		/* Per-chunk change counters */
+	Uint chunkw, chunkh;			/* Chunk grid geometry */
+	Uint32 gen;				/* Map-wide change counter */
+
 	MAP_Layer *_Nonnull layers;		/* List of layers */
 	Uint               nlayers;
 
@@ -181,6 +190,8 @@ int  MAP_AllocNodes(MAP *_Nonnull, Uint,Uint);
 void MAP_FreeNodes(MAP *_Nonnull);
 int  MAP_Resize(MAP *_Nonnull, Uint,Uint);
 void MAP_SetZoom(MAP *_Nonnull, int, Uint);
+void MAP_InvalidateNode(MAP *_Nonnull, int,int);
+void MAP_Invalidate(MAP *_Nonnull);
 int  MAP_PushLayer(MAP *_Nonnull, const char *_Nonnull);
 void MAP_PopLayer(MAP *_Nonnull);
 void MAP_InitLayer(MAP_Layer *_Nonnull, const char *_Nonnull);
@@ -230,10 +241,14 @@ void MAP_NodeMoveItem(MAP *_Nonnull, MAP_Node *_Nonnull, MAP_Item *_Nonnull,
 MAP_Item *_Nonnull MAP_NodeCopyItem(const MAP_Item *_Nonnull, MAP *_Nonnull,
                                     MAP_Node *_Nonnull, int);
 
-void MAP_NodeMoveItemUp(MAP_Node *_Nonnull, MAP_Item *_Nonnull);
-void MAP_NodeMoveItemDown(MAP_Node *_Nonnull, MAP_Item *_Nonnull);
-void MAP_NodeMoveItemToTail(MAP_Node *_Nonnull, MAP_Item *_Nonnull);
-void MAP_NodeMoveItemToHead(MAP_Node *_Nonnull, MAP_Item *_Nonnull);
+void MAP_NodeMoveItemUp(MAP *_Nonnull, MAP_Node *_Nonnull,
+                        MAP_Item *_Nonnull);
+void MAP_NodeMoveItemDown(MAP *_Nonnull, MAP_Node *_Nonnull,
+                          MAP_Item *_Nonnull);
+void MAP_NodeMoveItemToTail(MAP *_Nonnull, MAP_Node *_Nonnull,
+                            MAP_Item *_Nonnull);
+void MAP_NodeMoveItemToHead(MAP *_Nonnull, MAP_Node *_Nonnull,
+                            MAP_Item *_Nonnull);
 void MAP_NodeDelItem(MAP *_Nonnull, MAP_Node *_Nonnull, MAP_Item *_Nonnull);
 void MAP_NodeSwapLayers(MAP *_Nonnull, MAP_Node *_Nonnull, int,int);
 
@@ -250,6 +265,7 @@ __END_DECLS
 
 #include <agar/map/close.h>
 
+#include <agar/map/store.h>
 #include <agar/map/actor.h>
 #include <agar/map/tool.h>
 #include <agar/map/mapview.h>
@@ -55,6 +55,7 @@ int mapViewAnimatedBg = 1;	/* Background tiles moving */
 int mapViewBgTileSize = 8;	/* Background tile size */
 int mapViewEditSelOnly = 0;	/* Restrict edition to selection */
 int mapViewZoomInc = 8;
+int mapViewChunkMem = 64;	/* Chunk cache size limit per view (MB) */
 
 MAP_View *
 MAP_ViewNew(void *parent, MAP *m, Uint flags, struct ag_toolbar *toolbar,
@@ -213,6 +214,9 @@ Destroy(void *_Nonnull p)
 	MAP_View *mv = p;
 	MAP_ViewDrawCb *dcb, *ndcb;
 
+	MAP_ViewFlushChunks(mv);
+	free(mv->chunks);
+
 	for (dcb = SLIST_FIRST(&mv->draw_cbs);
 	     dcb != SLIST_END(&mv->draw_cbs);
 	     dcb = ndcb) {
@@ -443,112 +447,92 @@ RenderAnimItem(MAP_Item *_Nonnull r, RG_Anim *_Nonnull anim,
 
 /*
  * Return a pointer to a tile item surface. If there are transforms to
- * apply, perform a cache lookup/insert.
+ * apply, look up (or generate) the variant in the tile's variant cache.
  */
 static __inline__ void
 RenderTileItem(MAP_Item *_Nonnull r, RG_Tile *_Nonnull tile,
     AG_Surface *_Nonnull *_Nonnull pSurface,
     Uint *_Nullable pTexture) /* TODO */
 {
-	RG_TileVariant *var;
-	RG_Transform *xf, *xf2;
-
 	if (TAILQ_EMPTY(&r->transforms)) {
 		*pSurface = tile->su;
 		return;
 	}
-	SLIST_FOREACH(var, &tile->vars, vars) {
-		for (xf = TAILQ_FIRST(&r->transforms),
-		     xf2 = TAILQ_FIRST(&var->transforms);
-		     xf != TAILQ_END(&r->transforms) &&
-		     xf2 != TAILQ_END(&var->transforms);
-		     xf = TAILQ_NEXT(xf, transforms),
-		     xf2 = TAILQ_NEXT(xf2, transforms)) {
-			if (!RG_TransformCompare(xf, xf2))
-				break;
-		}
-		if (xf == TAILQ_END(&r->transforms) &&
-		    xf2 == TAILQ_END(&var->transforms))
-			break;
-	}
-	if (var == NULL) {
-		RG_Transform *xf;
-		AG_Surface *Sx, *Stile;
-		
-		var = Malloc(sizeof(RG_TileVariant));
-		TAILQ_INIT(&var->transforms);
-		RG_TransformChainDup(&r->transforms, &var->transforms);
-		var->last_drawn = AG_GetTicks();
-		Stile = tile->su;
-		var->su = AG_SurfaceRGBA(
-		    Stile->w, Stile->h, Stile->format.BitsPerPixel,
-		    Stile->flags & (AG_SURFACE_ALPHA|AG_SURFACE_COLORKEY),
-		    Stile->format.Rmask,
-		    Stile->format.Gmask,
-		    Stile->format.Bmask,
-		    Stile->format.Amask);
-		if (var->su == NULL) {
-			AG_FatalError(NULL);
-		}
-		AG_SurfaceCopy(var->su, Stile);
-
-		TAILQ_FOREACH(xf, &r->transforms, transforms) {
-			Sx = xf->func(var->su, xf->nargs, xf->args);
-			if (Sx != var->su) {
-				AG_SurfaceFree(var->su);
-				var->su = Sx;
-			}
-		}
-		SLIST_INSERT_HEAD(&tile->vars, var, vars);
-	}
-	var->last_drawn = AG_GetTicks();
-	*pSurface = var->su;
+	*pSurface = RG_TileGetVariant(tile, &r->transforms)->su;
 }
 
 /*
- * Render a graphical map item to absolute view coordinates rx,ry.
- * The map must be locked. Must be called from widget draw context only.
+ * Return the surface of a graphical map item, which must be released with
+ * ReleaseItemSurface() after use. The tileset of a tile item is kept locked
+ * until then, since its cached variants may otherwise be evicted. If the
+ * item references a missing tile or animation, return a newly rendered text
+ * surface (and set *isDebug).
  */
-static void
-DrawItem(MAP_View *_Nonnull mv, MAP *_Nonnull m, MAP_Item *_Nonnull r,
-    int rx, int ry, int cam)
+static int
+ItemSurface(MAP_Item *_Nonnull r, AG_Surface *_Nonnull *_Nonnull su,
+    int *_Nonnull isDebug)
 {
 	char num[16];
-	int debug_su = 0;
-	AG_Surface *su;
-	int tilesz = m->cameras[cam].tilesz;
 	RG_Tile *tile;
 	RG_Anim *anim;
-	int x, y;
+
+	*isDebug = 0;
 
 	switch (r->type) {
 	case MAP_ITEM_TILE:
+		AG_ObjectLock(r->r_tile.obj);
 		if (RG_LookupTile(r->r_tile.obj,r->r_tile.id, &tile) == 0) {
-			RenderTileItem(r, tile, &su, NULL);
+			RenderTileItem(r, tile, su, NULL);
 		} else {
+			AG_ObjectUnlock(r->r_tile.obj);
 			Snprintf(num, sizeof(num), "(s%u)", (Uint)r->r_tile.id);
 			AG_TextColorRGBA(250,250,50,150);
-			su = AG_TextRender(num);
-			debug_su++;
-			goto draw;
+			*su = AG_TextRender(num);
+			*isDebug = 1;
 		}
-		break;
+		return (0);
 	case MAP_ITEM_ANIM:
 		if (RG_LookupAnim(r->r_anim.obj,r->r_anim.id, &anim) == 0) {
-			RenderAnimItem(r, anim, &su, NULL);
+			RenderAnimItem(r, anim, su, NULL);
 		} else {
 			Snprintf(num, sizeof(num), "(a%u)", r->r_anim.id);
 			AG_TextColorRGBA(250,250,50,150);
-			su = AG_TextRender(num);
-			debug_su++;
-			goto draw;
+			*su = AG_TextRender(num);
+			*isDebug = 1;
 		}
-		break;
+		return (0);
 	default:				/* Not a drawable */
-		return;
+		return (-1);
 	}
+}
+
+/* Release a surface returned by ItemSurface(). */
+static void
+ReleaseItemSurface(MAP_Item *_Nonnull r, AG_Surface *_Nonnull su, int isDebug)
+{
+	if (isDebug) {
+		AG_SurfaceFree(su);
+	} else if (r->type == MAP_ITEM_TILE) {
+		AG_ObjectUnlock(r->r_tile.obj);
+	}
+}
+
+/*
+ * Render a graphical map item to absolute view coordinates rx,ry.
+ * The map must be locked. Must be called from widget draw context only.
+ */
+static void
+DrawItem(MAP_View *_Nonnull mv, MAP *_Nonnull m, MAP_Item *_Nonnull r,
+    int rx, int ry, int cam)
+{
+	int debug_su;
+	AG_Surface *su;
+	int tilesz = m->cameras[cam].tilesz;
+	int x, y;
+
+	if (ItemSurface(r, &su, &debug_su) == -1)
+		return;
 
-draw:
 	if (tilesz != MAPTILESZ) {
 		x = rx + r->r_gfx.xcenter*tilesz/MAPTILESZ +
 		         r->r_gfx.xmotion*tilesz/MAPTILESZ -
@@ -576,82 +560,341 @@ draw:
 #endif
 	}
 
-	if (debug_su)
-		AG_SurfaceFree(su);
+	ReleaseItemSurface(r, su, debug_su);
 }
 
+/*
+ * Draw the items of the given layer for nodes x1,y1 to x2,y2 (exclusive),
+ * without caching.
+ */
 static void
-Draw(void *_Nonnull obj)
+DrawNodes(MAP_View *_Nonnull mv, MAP *_Nonnull m, int layer,
+    int x1, int y1, int x2, int y2)
 {
-	MAP_View *mv = obj;
-	MAP_ViewDrawCb *dcb;
-	MAP *m = mv->map;
-	MAP_Node *node;
 	MAP_Item *nref;
-	int mx, my, rx = 0, ry = 0;
-	int layer = 0;
-	AG_Rect r, rSel, mSel, rExtent;
-	AG_Color c, c2;
+	int mx, my, rx, ry;
 
-	rSel.x = -1; mSel.x = -1;
-	rSel.y = -1; mSel.y = -1;
-	rSel.w = -1; mSel.w = -1;
-	rSel.h = -1; mSel.h = -1;
+	for (my = y1, ry = mv->yoffs + (y1 - mv->my)*AGMTILESZ(mv);
+	     my < y2;
+	     my++, ry += AGMTILESZ(mv)) {
+		for (mx = x1, rx = mv->xoffs + (x1 - mv->mx)*AGMTILESZ(mv);
+		     mx < x2;
+		     mx++, rx += AGMTILESZ(mv)) {
+			TAILQ_FOREACH(nref, &m->map[my][mx].nrefs, nrefs) {
+				if (nref->layer == layer)
+					DrawItem(mv, m, nref, rx, ry, mv->cam);
+			}
+		}
+	}
+}
 
-	if (WIDTH(mv) < MAPTILESZ || HEIGHT(mv) < MAPTILESZ)
-		return;
+static __inline__ Uint
+ChunkHash(int x, int y, int layer)
+{
+	return (((Uint)x*73856093U) ^ ((Uint)y*19349663U) ^
+	        ((Uint)layer*83492791U)) % MAP_VIEW_CHUNK_BUCKETS;
+}
 
-	if (mv->hbar != NULL) { AG_WidgetDraw(mv->hbar); }
-	if (mv->vbar != NULL) { AG_WidgetDraw(mv->vbar); }
+static void
+FreeChunk(MAP_View *_Nonnull mv, MAP_ViewChunk *_Nonnull ch)
+{
+	if (ch->su != -1) {
+		AG_WidgetUnmapSurface(mv, ch->su);
+		mv->chunkBytes -= ch->size;
+	}
+	free(ch);
+}
 
-	AG_PushClipRect(mv, &mv->r);
+/* Release all cached chunks. */
+void
+MAP_ViewFlushChunks(MAP_View *mv)
+{
+	MAP_ViewChunk *ch, *chNext;
+	Uint i;
 
-	if (WIDGET(mv)->flags & AG_WIDGET_FOCUSED) {
-		AG_ColorRGB_8(&c, 150,150,150);
-		AG_DrawRectOutline(mv, &mv->r, &c);
+	AG_ObjectLock(mv);
+	for (i = 0; i < MAP_VIEW_CHUNK_BUCKETS; i++) {
+		for (ch = mv->chunks[i]; ch != NULL; ch = chNext) {
+			chNext = ch->next;
+			FreeChunk(mv, ch);
+		}
+		mv->chunks[i] = NULL;
 	}
+	mv->nChunks = 0;
+	mv->chunkBytes = 0;
+	AG_ObjectUnlock(mv);
+}
 
-	SLIST_FOREACH(dcb, &mv->draw_cbs, draw_cbs)
-		dcb->func(mv, dcb->p);
-	
-	if (mv->flags & MAP_VIEW_CENTER) {
-		mv->flags &= ~(MAP_VIEW_CENTER);
-		CenterToOrigin(mv);
+/*
+ * Release the least recently used chunk, if any chunk was not used in the
+ * current frame. Return -1 if there is nothing to release.
+ */
+static int
+EvictChunk(MAP_View *_Nonnull mv)
+{
+	MAP_ViewChunk *ch, **pCh, **pOldest = NULL;
+	Uint i;
+
+	for (i = 0; i < MAP_VIEW_CHUNK_BUCKETS; i++) {
+		for (pCh = &mv->chunks[i]; (ch = *pCh) != NULL;
+		     pCh = &ch->next) {
+			if (ch->lastUsed == mv->chunkFrame) {
+				continue;
+			}
+			if (pOldest == NULL ||
+			    ch->lastUsed < (*pOldest)->lastUsed)
+				pOldest = pCh;
+		}
 	}
+	if (pOldest == NULL) {
+		return (-1);
+	}
+	ch = *pOldest;
+	*pOldest = ch->next;
+	FreeChunk(mv, ch);
+	mv->nChunks--;
+	return (0);
+}
 
-	if ((mv->flags & MAP_VIEW_NO_BG) == 0) {
-		r.x = 0;
-		r.y = 0;
-		r.w = WIDTH(mv);
-		r.h = HEIGHT(mv);
-		AG_ColorRGB_8(&c, 50,50,50);
-		AG_ColorRGB_8(&c2, 40,40,40);
-		AG_DrawTiling(mv, &r, mapViewBgTileSize, 0, &c, &c2);
+/* Look up a chunk in the cache, creating an unrendered entry if needed. */
+static MAP_ViewChunk *_Nonnull
+GetChunk(MAP_View *_Nonnull mv, int x, int y, int layer)
+{
+	MAP_ViewChunk *ch;
+	Uint h = ChunkHash(x, y, layer);
+
+	for (ch = mv->chunks[h]; ch != NULL; ch = ch->next) {
+		if (ch->x == x && ch->y == y && ch->layer == layer)
+			return (ch);
 	}
+	ch = Malloc(sizeof(MAP_ViewChunk));
+	ch->x = x;
+	ch->y = y;
+	ch->layer = layer;
+	ch->tilesz = 0;
+	ch->su = -1;
+	ch->gen = 0;
+	ch->lastUsed = mv->chunkFrame;
+	ch->size = 0;
+	ch->dynamic = 0;
+	ch->next = mv->chunks[h];
+	mv->chunks[h] = ch;
+	mv->nChunks++;
+	return (ch);
+}
 
-	AG_ObjectLock(m);
+/*
+ * Clip the surface of an item at xd,yd to the rectangle of a chunk. Set
+ * rs to the part of the surface that falls within the chunk, and adjust
+ * xd,yd accordingly. Return 0 if the item lies entirely outside.
+ */
+static int
+ClipToChunk(const AG_Surface *_Nonnull su, AG_Rect *_Nonnull rs,
+    int *_Nonnull xd, int *_Nonnull yd)
+{
+	const int wChunk = MAP_CHUNK_SIZE*MAPTILESZ;
+
+	rs->x = 0;
+	rs->y = 0;
+	rs->w = su->w;
+	rs->h = su->h;
+	if (*xd < 0) { rs->x = -(*xd); rs->w += *xd; *xd = 0; }
+	if (*yd < 0) { rs->y = -(*yd); rs->h += *yd; *yd = 0; }
+	if (*xd + rs->w > wChunk) { rs->w = wChunk - *xd; }
+	if (*yd + rs->h > wChunk) { rs->h = wChunk - *yd; }
+	return (rs->w > 0 && rs->h > 0);
+}
 
-	if (m->map == NULL)
-		goto out;
-draw_layer:
-	if (!m->layers[layer].visible) {
-		goto next_layer;
+/*
+ * Composite the items of a chunk's layer into a surface at the current
+ * tile size. Items of nodes within MAP_CHUNK_MARGIN of the chunk are
+ * included, so that items extending across chunk boundaries are rendered.
+ * Each item is clipped to the chunk rectangle, so that the part of it
+ * lying in a neighbouring chunk is drawn by that chunk only.
+ * Chunks containing animations are flagged dynamic and not cached.
+ */
+static void
+RenderChunk(MAP_View *_Nonnull mv, MAP *_Nonnull m, MAP_ViewChunk *_Nonnull ch)
+{
+	const int wChunk = MAP_CHUNK_SIZE*MAPTILESZ;
+	const int x0 = ch->x*MAP_CHUNK_SIZE;
+	const int y0 = ch->y*MAP_CHUNK_SIZE;
+	int tilesz = AGMTILESZ(mv);
+	int x1 = MAX(x0 - MAP_CHUNK_MARGIN, 0);
+	int y1 = MAX(y0 - MAP_CHUNK_MARGIN, 0);
+	int x2 = MIN(x0 + MAP_CHUNK_SIZE + MAP_CHUNK_MARGIN, (int)m->mapw);
+	int y2 = MIN(y0 + MAP_CHUNK_SIZE + MAP_CHUNK_MARGIN, (int)m->maph);
+	AG_Surface *S = NULL, *su;
+	MAP_Item *r;
+	AG_Rect rs;
+	int x, y, xd, yd, isDebug;
+
+	ch->gen = m->chunkGen[ch->y*m->chunkw + ch->x];
+	ch->tilesz = tilesz;
+	ch->dynamic = 0;
+
+	for (y = y1; y < y2; y++) {
+		for (x = x1; x < x2; x++) {
+			TAILQ_FOREACH(r, &m->map[y][x].nrefs, nrefs) {
+				if (r->layer != ch->layer) {
+					continue;
+				}
+				if (r->type == MAP_ITEM_ANIM) {
+					ch->dynamic = 1;
+					goto out;
+				}
+				if (ItemSurface(r, &su, &isDebug) == -1) {
+					continue;
+				}
+				if (S == NULL) {
+					AG_Color c;
+
+					S = AG_SurfaceNew(agSurfaceFmt,
+					    wChunk, wChunk, 0);
+					AG_ColorNone(&c);
+					AG_FillRect(S, NULL, &c);
+					AG_SurfaceSetAlpha(S, AG_SURFACE_ALPHA,
+					    AG_OPAQUE);
+				}
+				xd = (x - x0)*MAPTILESZ + r->r_gfx.xcenter +
+				     r->r_gfx.xmotion - r->r_gfx.xorigin;
+				yd = (y - y0)*MAPTILESZ + r->r_gfx.ycenter +
+				     r->r_gfx.ymotion - r->r_gfx.yorigin;
+				if (ClipToChunk(su, &rs, &xd, &yd))
+					AG_SurfaceBlit(su, &rs, S, xd, yd);
+
+				ReleaseItemSurface(r, su, isDebug);
+			}
+		}
+	}
+	if (S != NULL && tilesz != MAPTILESZ) {
+		AG_Surface *Sx;
+
+		Sx = AG_SurfaceScale(S, wChunk*tilesz/MAPTILESZ,
+		                        wChunk*tilesz/MAPTILESZ, 0);
+		AG_SurfaceFree(S);
+		S = Sx;
+	}
+out:
+	if (ch->dynamic && S != NULL) {
+		AG_SurfaceFree(S);
+		S = NULL;
 	}
+	if (ch->su != -1) {
+		mv->chunkBytes -= ch->size;
+		if (S != NULL) {
+			AG_WidgetReplaceSurface(mv, ch->su, S);
+		} else {
+			AG_WidgetUnmapSurface(mv, ch->su);
+			ch->su = -1;
+		}
+	} else if (S != NULL) {
+		ch->su = AG_WidgetMapSurface(mv, S);
+	}
+	ch->size = (S != NULL) ? S->h*S->pitch : 0;
+	mv->chunkBytes += ch->size;
+}
+
+/*
+ * Draw the visible map layers using the chunk cache. Each visible chunk
+ * is blitted from its cached surface, re-rendering it first if its nodes
+ * have changed since (per the MAP's chunk counters).
+ */
+static void
+DrawLayers(MAP_View *_Nonnull mv, MAP *_Nonnull m, int xEnd, int yEnd)
+{
+	const int tilesz = AGMTILESZ(mv);
+	int cx1, cy1, cx2, cy2, cx, cy, layer;
+
+	if (mv->chunkMap != m ||
+	    mv->chunkMapGen != m->gen ||
+	    mv->chunkTileGen != rgTileGen) {
+		MAP_ViewFlushChunks(mv);
+		mv->chunkMap = m;
+		mv->chunkMapGen = m->gen;
+		mv->chunkTileGen = rgTileGen;
+	}
+	mv->chunkFrame++;
+
+	cx1 = mv->mx / MAP_CHUNK_SIZE;
+	cy1 = mv->my / MAP_CHUNK_SIZE;
+	cx2 = (xEnd - 1) / MAP_CHUNK_SIZE;
+	cy2 = (yEnd - 1) / MAP_CHUNK_SIZE;
+
+	for (layer = 0; layer < (int)m->nlayers; layer++) {
+		if (!m->layers[layer].visible)
+			continue;
+
+		for (cy = cy1; cy <= cy2; cy++) {
+			for (cx = cx1; cx <= cx2; cx++) {
+				MAP_ViewChunk *ch;
+				int rx = mv->xoffs +
+				    (cx*MAP_CHUNK_SIZE - mv->mx)*tilesz;
+				int ry = mv->yoffs +
+				    (cy*MAP_CHUNK_SIZE - mv->my)*tilesz;
+
+				ch = GetChunk(mv, cx, cy, layer);
+				ch->lastUsed = mv->chunkFrame;
+
+				if (ch->tilesz != tilesz ||
+				    ch->gen != m->chunkGen[cy*m->chunkw + cx]) {
+					RenderChunk(mv, m, ch);
+					while ((mv->chunkBytes >
+					        (Uint)mapViewChunkMem*1024*1024 ||
+					        mv->nChunks > MAP_VIEW_CHUNKS_MAX) &&
+					       EvictChunk(mv) == 0)
+						;
+				}
+				if (ch->dynamic) {
+					AG_Rect r;
+
+					r.x = rx;
+					r.y = ry;
+					r.w = MAP_CHUNK_SIZE*tilesz;
+					r.h = MAP_CHUNK_SIZE*tilesz;
+					AG_PushClipRect(mv, &r);
+					DrawNodes(mv, m, layer,
+					    MAX(cx*MAP_CHUNK_SIZE -
+					        MAP_CHUNK_MARGIN, 0),
+					    MAX(cy*MAP_CHUNK_SIZE -
+					        MAP_CHUNK_MARGIN, 0),
+					    MIN((cx+1)*MAP_CHUNK_SIZE +
+					        MAP_CHUNK_MARGIN, (int)m->mapw),
+					    MIN((cy+1)*MAP_CHUNK_SIZE +
+					        MAP_CHUNK_MARGIN, (int)m->maph));
+					AG_PopClipRect(mv);
+				} else if (ch->su != -1) {
+					AG_WidgetBlitSurface(mv, ch->su, rx,ry);
+				}
+			}
+		}
+	}
+}
+
+/*
+ * Draw the per-item overlays (offsets, attributes and selection) and the
+ * per-node edition overlays.
+ */
+static void
+DrawOverlays(MAP_View *_Nonnull mv, MAP *_Nonnull m, int xEnd, int yEnd,
+    AG_Rect *_Nonnull rSel, AG_Rect *_Nonnull mSel)
+{
+	MAP_Item *nref;
+	AG_Rect r, rExtent;
+	AG_Color c;
+	int mx, my, rx, ry;
+
 	for (my = mv->my, ry = mv->yoffs;
-	     ((my - mv->my) <= (int)mv->mh) && (my < (int)m->maph);
+	     my < yEnd;
 	     my++, ry += AGMTILESZ(mv)) {
-
 		for (mx = mv->mx, rx = mv->xoffs;
-	     	     ((mx - mv->mx) <= (int)mv->mw) && (mx < (int)m->mapw);
+		     mx < xEnd;
 		     mx++, rx += AGMTILESZ(mv)) {
-
-			node = &m->map[my][mx];
+			MAP_Node *node = &m->map[my][mx];
 
 			TAILQ_FOREACH(nref, &node->nrefs, nrefs) {
-				if (nref->layer != layer)
+				if (!m->layers[nref->layer].visible)
 					continue;
-
-				DrawItem(mv, m, nref, rx, ry, mv->cam);
 #ifdef AG_DEBUG
 				if (mv->flags & MAP_VIEW_SHOW_OFFSETS) {
 					AG_ColorRGB_8(&c, 60,250,60);
@@ -705,27 +948,99 @@ draw_layer:
 			}
 			if (mv->msel.set &&
 			    mv->msel.x == mx && mv->msel.y == my) {
-				mSel.x = rx + 1;
-				mSel.y = ry + 1;
-				mSel.w = mv->msel.xoffs * AGMTILESZ(mv) - 2;
-				mSel.h = mv->msel.yoffs * AGMTILESZ(mv) - 2;
+				mSel->x = rx + 1;
+				mSel->y = ry + 1;
+				mSel->w = mv->msel.xoffs * AGMTILESZ(mv) - 2;
+				mSel->h = mv->msel.yoffs * AGMTILESZ(mv) - 2;
 			}
 			if (mv->esel.set &&
 			    mv->esel.x == mx && mv->esel.y == my) {
-				rSel.x = rx;
-				rSel.y = ry;
-				rSel.w = AGMTILESZ(mv) * mv->esel.w;
-				rSel.h = AGMTILESZ(mv) * mv->esel.h;
+				rSel->x = rx;
+				rSel->y = ry;
+				rSel->w = AGMTILESZ(mv) * mv->esel.w;
+				rSel->h = AGMTILESZ(mv) * mv->esel.h;
 			}
 		}
 	}
-next_layer:
-	if (++layer < (int)m->nlayers)
-		goto draw_layer;			/* Draw next layer */
+}
+
+static void
+Draw(void *_Nonnull obj)
+{
+	MAP_View *mv = obj;
+	MAP_ViewDrawCb *dcb;
+	MAP *m = mv->map;
+	int layer, xEnd, yEnd, rx, ry;
+	AG_Rect r, rSel, mSel;
+	AG_Color c, c2;
+
+	rSel.x = -1; mSel.x = -1;
+	rSel.y = -1; mSel.y = -1;
+	rSel.w = -1; mSel.w = -1;
+	rSel.h = -1; mSel.h = -1;
+
+	if (WIDTH(mv) < MAPTILESZ || HEIGHT(mv) < MAPTILESZ)
+		return;
+
+	if (mv->hbar != NULL) { AG_WidgetDraw(mv->hbar); }
+	if (mv->vbar != NULL) { AG_WidgetDraw(mv->vbar); }
+
+	AG_PushClipRect(mv, &mv->r);
+
+	if (WIDGET(mv)->flags & AG_WIDGET_FOCUSED) {
+		AG_ColorRGB_8(&c, 150,150,150);
+		AG_DrawRectOutline(mv, &mv->r, &c);
+	}
+
+	SLIST_FOREACH(dcb, &mv->draw_cbs, draw_cbs)
+		dcb->func(mv, dcb->p);
+	
+	if (mv->flags & MAP_VIEW_CENTER) {
+		mv->flags &= ~(MAP_VIEW_CENTER);
+		CenterToOrigin(mv);
+	}
+
+	if ((mv->flags & MAP_VIEW_NO_BG) == 0) {
+		r.x = 0;
+		r.y = 0;
+		r.w = WIDTH(mv);
+		r.h = HEIGHT(mv);
+		AG_ColorRGB_8(&c, 50,50,50);
+		AG_ColorRGB_8(&c2, 40,40,40);
+		AG_DrawTiling(mv, &r, mapViewBgTileSize, 0, &c, &c2);
+	}
+
+	AG_ObjectLock(m);
+
+	if (m->map == NULL)
+		goto out;
+
+	/* Range of visible nodes (exclusive). */
+	xEnd = MIN(mv->mx + (int)mv->mw + 1, (int)m->mapw);
+	yEnd = MIN(mv->my + (int)mv->mh + 1, (int)m->maph);
+	if (xEnd <= mv->mx || yEnd <= mv->my)
+		goto out;
+
+	if (mv->flags & MAP_VIEW_NO_CHUNKS) {
+		for (layer = 0; layer < (int)m->nlayers; layer++) {
+			if (m->layers[layer].visible)
+				DrawNodes(mv, m, layer, mv->mx, mv->my,
+				    xEnd, yEnd);
+		}
+	} else {
+		DrawLayers(mv, m, xEnd, yEnd);
+	}
+	if (mv->flags & (MAP_VIEW_EDIT|MAP_VIEW_SHOW_OFFSETS) ||
+	    mv->mode == MAP_VIEW_EDIT_ATTRS)
+		DrawOverlays(mv, m, xEnd, yEnd, &rSel, &mSel);
 
 	/* Draw the node grid. */
 	if (mv->flags & MAP_VIEW_GRID) {
-		int rx2 = rx;
+		int rx2;
+
+		rx = mv->xoffs + (xEnd - mv->mx)*AGMTILESZ(mv);
+		ry = mv->yoffs + (yEnd - mv->my)*AGMTILESZ(mv);
+		rx2 = rx;
 
 		for (; ry >= mv->yoffs; ry -= AGMTILESZ(mv)) {
 			MAP_ViewHLine(mv, mv->xoffs, rx2, ry);
@@ -1621,6 +1936,15 @@ Init(void *_Nonnull obj)
 	mv->deftool = NULL;
 	TAILQ_INIT(&mv->tools);
 	SLIST_INIT(&mv->draw_cbs);
+
+	mv->chunks = Malloc(MAP_VIEW_CHUNK_BUCKETS*sizeof(MAP_ViewChunk *));
+	memset(mv->chunks, 0, MAP_VIEW_CHUNK_BUCKETS*sizeof(MAP_ViewChunk *));
+	mv->nChunks = 0;
+	mv->chunkBytes = 0;
+	mv->chunkFrame = 0;
+	mv->chunkMap = NULL;
+	mv->chunkMapGen = 0;
+	mv->chunkTileGen = 0;
 	
 	mv->cx = -1;
 	mv->cy = -1;
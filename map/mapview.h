@@ -19,6 +19,25 @@ typedef struct map_view_draw_cb {
 	AG_SLIST_ENTRY(map_view_draw_cb) draw_cbs;
 } MAP_ViewDrawCb;
 
+/*
+ * Cached rendering of one layer of a MAP_CHUNK_SIZE x MAP_CHUNK_SIZE
+ * block of nodes (chained in a hash bucket).
+ */
+typedef struct map_view_chunk {
+	int x, y;			/* Chunk coordinates */
+	int layer;			/* Map layer */
+	int tilesz;			/* Tile size at render time (or 0) */
+	int su;				/* Mapped surface (or -1 if empty) */
+	Uint32 gen;			/* MAP chunk counter at render time */
+	Uint32 lastUsed;		/* Frame of last use */
+	Uint size;			/* Surface size (bytes) */
+	int dynamic;			/* Has animations (not cacheable) */
+	struct map_view_chunk *_Nullable next;	/* Next in bucket */
+} MAP_ViewChunk;
+
+#define MAP_VIEW_CHUNK_BUCKETS 256	/* Buckets in chunk cache */
+#define MAP_VIEW_CHUNKS_MAX    4096	/* Max chunks in cache */
+
 typedef struct map_view {
 	AG_Widget wid;			/* AG_Widget -> MAP_View */
 
@@ -33,6 +52,7 @@ typedef struct map_view {
 #define MAP_VIEW_SET_ATTRS    0x080	/* Setting node attributes */
 #define MAP_VIEW_SHOW_OFFSETS 0x100	/* Show element tile offsets */
 #define MAP_VIEW_SHOW_ORIGIN  0x200	/* Show map origin node */
+#define MAP_VIEW_NO_CHUNKS    0x400	/* Disable the chunk cache */
 
 	enum map_view_mode {
 		MAP_VIEW_EDITION,	/* Default edition mode */
@@ -95,6 +115,14 @@ typedef struct map_view {
 	MAP_Tool *_Nullable curtool;			/* Selected tool */
 	MAP_Tool *_Nullable deftool;			/* Default tool if any */
 
+	MAP_ViewChunk *_Nullable *_Nonnull chunks;	/* Chunk cache */
+	Uint nChunks;					/* Cached chunks */
+	Uint chunkBytes;				/* Total surface size */
+	Uint32 chunkFrame;				/* Frame counter */
+	MAP *_Nullable chunkMap;			/* Map at last flush */
+	Uint32 chunkMapGen;				/* Map counter at flush */
+	Uint chunkTileGen;				/* Tile counter at flush */
+
 	AG_TAILQ_HEAD_(map_tool) tools;			/* Map edition tools */
 	AG_SLIST_HEAD_(map_view_draw_cb) draw_cbs;	/* Post-draw callbacks */
 } MAP_View;
@@ -106,6 +134,7 @@ typedef struct map_view {
 
 __BEGIN_DECLS
 extern AG_WidgetClass mapViewClass;
+extern int mapViewChunkMem;
 
 MAP_View *_Nonnull MAP_ViewNew(void *_Nullable, MAP *_Nullable, Uint,
                                struct ag_toolbar *_Nullable,
@@ -125,6 +154,7 @@ void MAP_ViewRegDrawCb(MAP_View *_Nonnull,
                        void *_Nullable);
 
 void MAP_ViewUpdateCamera(MAP_View *_Nonnull);
+void MAP_ViewFlushChunks(MAP_View *_Nonnull);
 void MAP_ViewUseScrollbars(MAP_View *_Nonnull,
                            struct ag_scrollbar *_Nullable,
                            struct ag_scrollbar *_Nullable);
@@ -55,6 +55,7 @@ MAP_UpdateRefSel(MAP_View *mv, int xRel, int yRel)
 				}
 				r->r_gfx.xcenter += xRel;
 				r->r_gfx.ycenter += yRel;
+				MAP_InvalidateNode(m, nx, ny);
 
 				if (xRel > 0 && r->r_gfx.xcenter > MAPTILESZ) {
 					r->r_gfx.xcenter = MAPTILESZ;
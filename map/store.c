@@ -0,0 +1,1119 @@
+/*
+ * Copyright (c) 2026 Julien Nadeau Carriere <vedge@csoft.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Compact storage for map nodes. The tile and animation items of each
+ * layer are kept in parallel arrays in row-major node order, with the
+ * tileset, transform chain and graphical parameters of every item interned
+ * into shared tables. Items which have no compact representation (warp
+ * points, items with node masks) are kept as regular MAP_Items in a sorted
+ * list of extras.
+ *
+ * MAP_StorePut() encodes a region of MAP nodes into the store and
+ * MAP_StoreGet() materializes a region back into MAP nodes, so that the
+ * existing MAP_Node interface can operate on a window of a larger world.
+ */
+
+#include <agar/core/core.h>
+
+#include <agar/gui/gui.h>
+#include <agar/gui/window.h>
+#include <agar/gui/icons.h>
+#include <agar/gui/primitive.h>
+
+#include <agar/map/map.h>
+
+#include <string.h>
+
+#define COLUMN_CHUNK 4096		/* Entries per bulk write */
+
+static void
+InitLayer(MAP_Store *_Nonnull st, MAP_StoreLayer *_Nonnull L)
+{
+	L->count = Malloc(st->w*st->h*sizeof(Uint8) + 1);
+	memset(L->count, 0, st->w*st->h*sizeof(Uint8));
+	L->row = Malloc((st->h+1)*sizeof(Uint32));
+	memset(L->row, 0, (st->h+1)*sizeof(Uint32));
+	L->type = NULL;
+	L->ts = NULL;
+	L->id = NULL;
+	L->flags = NULL;
+	L->xform = NULL;
+	L->gfx = NULL;
+	L->nItems = 0;
+	L->maxItems = 0;
+}
+
+static void
+FreeItems(MAP_StoreLayer *_Nonnull L)
+{
+	Free(L->type);
+	Free(L->ts);
+	Free(L->id);
+	Free(L->flags);
+	Free(L->xform);
+	Free(L->gfx);
+}
+
+/* Reserve space for n more items. */
+static void
+GrowItems(MAP_StoreLayer *_Nonnull L, Uint32 n)
+{
+	Uint32 maxNew;
+
+	if (L->nItems+n <= L->maxItems) {
+		return;
+	}
+	maxNew = L->maxItems + (L->maxItems >> 1);
+	if (maxNew < L->nItems+n) {
+		maxNew = L->nItems+n;
+	}
+	L->type = Realloc(L->type, maxNew*sizeof(Uint8));
+	L->ts = Realloc(L->ts, maxNew*sizeof(Uint16));
+	L->id = Realloc(L->id, maxNew*sizeof(Uint32));
+	L->flags = Realloc(L->flags, maxNew*sizeof(Uint16));
+	L->xform = Realloc(L->xform, maxNew*sizeof(Uint16));
+	L->gfx = Realloc(L->gfx, maxNew*sizeof(Uint16));
+	L->maxItems = maxNew;
+}
+
+/* Append n items of layer S (starting at index i) to layer D. */
+static void
+CopyItems(MAP_StoreLayer *_Nonnull D, const MAP_StoreLayer *_Nonnull S,
+    Uint32 i, Uint32 n)
+{
+	Uint32 j = D->nItems;
+
+	if (n == 0) {
+		return;
+	}
+	GrowItems(D, n);
+	memcpy(&D->type[j], &S->type[i], n*sizeof(Uint8));
+	memcpy(&D->ts[j], &S->ts[i], n*sizeof(Uint16));
+	memcpy(&D->id[j], &S->id[i], n*sizeof(Uint32));
+	memcpy(&D->flags[j], &S->flags[i], n*sizeof(Uint16));
+	memcpy(&D->xform[j], &S->xform[i], n*sizeof(Uint16));
+	memcpy(&D->gfx[j], &S->gfx[i], n*sizeof(Uint16));
+	D->nItems += n;
+}
+
+static void
+GrowLayers(MAP_Store *_Nonnull st, Uint nLayers)
+{
+	Uint l;
+
+	if (nLayers <= st->nLayers) {
+		return;
+	}
+	st->layers = Realloc(st->layers, nLayers*sizeof(MAP_StoreLayer));
+	for (l = st->nLayers; l < nLayers; l++) {
+		InitLayer(st, &st->layers[l]);
+	}
+	st->nLayers = nLayers;
+}
+
+static Uint32
+HashGfx(const MAP_StoreGfx *_Nonnull g)
+{
+	const Uint8 *p = (const Uint8 *)g;
+	Uint32 h = 2166136261U;
+	Uint i;
+
+	for (i = 0; i < sizeof(MAP_StoreGfx); i++) {
+		h = (h ^ p[i]) * 16777619U;
+	}
+	return (h);
+}
+
+/* Insert index i into an open-addressing table of n slots. */
+static void
+HashInsert(Uint32 *_Nonnull tbl, Uint n, Uint32 hash, Uint i)
+{
+	Uint j;
+
+	for (j = hash & (n-1); tbl[j] != 0; j = (j+1) & (n-1))
+		;
+	tbl[j] = i+1;
+}
+
+/* Append a transform chain to the table (the store takes ownership). */
+static Uint
+AddXform(MAP_Store *_Nonnull st, MAP_StoreXform *_Nonnull xf)
+{
+	Uint i;
+
+	if (st->nXforms*2 >= st->nXformHash) {
+		Uint nNew = (st->nXformHash > 0) ? st->nXformHash*2 : 64;
+
+		Free(st->xformHash);
+		st->xformHash = Malloc(nNew*sizeof(Uint32));
+		memset(st->xformHash, 0, nNew*sizeof(Uint32));
+		st->nXformHash = nNew;
+		for (i = 1; i < st->nXforms; i++)
+			HashInsert(st->xformHash, nNew, st->xforms[i]->hash, i);
+	}
+	st->xforms = Realloc(st->xforms, (st->nXforms+1) *
+	                                 sizeof(MAP_StoreXform *));
+	i = st->nXforms++;
+	st->xforms[i] = xf;
+	if (i > 0) {
+		HashInsert(st->xformHash, st->nXformHash, xf->hash, i);
+	}
+	return (i);
+}
+
+/* Look up or intern a transform chain (0 is the empty chain). */
+static int
+InternXform(MAP_Store *_Nonnull st, const RG_TransformChain *_Nonnull chain)
+{
+	MAP_StoreXform *xf;
+	Uint32 h;
+	Uint j;
+
+	if (TAILQ_EMPTY(chain)) {
+		return (0);
+	}
+	h = RG_TransformChainHash(chain);
+	if (st->nXformHash > 0) {
+		for (j = h & (st->nXformHash-1);
+		     st->xformHash[j] != 0;
+		     j = (j+1) & (st->nXformHash-1)) {
+			xf = st->xforms[st->xformHash[j]-1];
+			if (xf->hash == h &&
+			    RG_TransformChainCompare(&xf->chain, chain))
+				return (int)(st->xformHash[j]-1);
+		}
+	}
+	if (st->nXforms >= MAP_STORE_INTERN_MAX) {
+		return (-1);
+	}
+	xf = Malloc(sizeof(MAP_StoreXform));
+	RG_TransformChainInit(&xf->chain);
+	RG_TransformChainDup(chain, &xf->chain);
+	xf->hash = h;
+	return (int)AddXform(st, xf);
+}
+
+static Uint
+AddGfx(MAP_Store *_Nonnull st, const MAP_StoreGfx *_Nonnull g)
+{
+	Uint i;
+
+	if (st->nGfx*2 >= st->nGfxHash) {
+		Uint nNew = (st->nGfxHash > 0) ? st->nGfxHash*2 : 64;
+
+		Free(st->gfxHash);
+		st->gfxHash = Malloc(nNew*sizeof(Uint32));
+		memset(st->gfxHash, 0, nNew*sizeof(Uint32));
+		st->nGfxHash = nNew;
+		for (i = 0; i < st->nGfx; i++)
+			HashInsert(st->gfxHash, nNew, HashGfx(&st->gfx[i]), i);
+	}
+	if ((st->nGfx & (st->nGfx-1)) == 0) {		/* Power of 2 */
+		Uint maxNew = (st->nGfx > 8) ? st->nGfx*2 : 16;
+
+		st->gfx = Realloc(st->gfx, maxNew*sizeof(MAP_StoreGfx));
+	}
+	i = st->nGfx++;
+	memcpy(&st->gfx[i], g, sizeof(MAP_StoreGfx));
+	HashInsert(st->gfxHash, st->nGfxHash, HashGfx(g), i);
+	return (i);
+}
+
+static int
+InternGfx(MAP_Store *_Nonnull st, const MAP_StoreGfx *_Nonnull g)
+{
+	Uint32 h = HashGfx(g);
+	Uint j;
+
+	if (st->nGfxHash > 0) {
+		for (j = h & (st->nGfxHash-1);
+		     st->gfxHash[j] != 0;
+		     j = (j+1) & (st->nGfxHash-1)) {
+			if (memcmp(&st->gfx[st->gfxHash[j]-1], g,
+			    sizeof(MAP_StoreGfx)) == 0)
+				return (int)(st->gfxHash[j]-1);
+		}
+	}
+	if (st->nGfx >= MAP_STORE_INTERN_MAX) {
+		return (-1);
+	}
+	return (int)AddGfx(st, g);
+}
+
+static void
+AddTileset(MAP_Store *_Nonnull st, RG_Tileset *_Nonnull ts)
+{
+	st->tilesets = Realloc(st->tilesets, (st->nTilesets+1) *
+	                                     sizeof(RG_Tileset *));
+	st->tilesets[st->nTilesets++] = ts;
+	AG_ObjectAddDep(st->map, ts, 1);
+}
+
+static int
+InternTileset(MAP_Store *_Nonnull st, RG_Tileset *_Nonnull ts)
+{
+	Uint i;
+
+	for (i = 0; i < st->nTilesets; i++) {
+		if (st->tilesets[i] == ts)
+			return (int)i;
+	}
+	if (st->nTilesets >= MAP_STORE_INTERN_MAX) {
+		return (-1);
+	}
+	AddTileset(st, ts);
+	return (int)i;
+}
+
+/*
+ * Append the compact representation of a MAP item to L.
+ * Return -1 if the item has no compact representation.
+ */
+static int
+PushItem(MAP_Store *_Nonnull st, MAP_StoreLayer *_Nonnull L,
+    const MAP_Item *_Nonnull r)
+{
+	MAP_StoreGfx g;
+	RG_Tileset *ts;
+	Uint flags = r->flags & ~(MAP_ITEM_MOUSEOVER|MAP_ITEM_SELECTED);
+	Uint32 id, i;
+	int its, ixf, igfx;
+
+	switch (r->type) {
+	case MAP_ITEM_TILE:
+		ts = r->r_tile.obj;
+		id = (Uint32)r->r_tile.id;
+		break;
+	case MAP_ITEM_ANIM:
+		ts = r->r_anim.obj;
+		id = (Uint32)r->r_anim.id;
+		break;
+	default:
+		return (-1);
+	}
+	if (ts == NULL || !TAILQ_EMPTY(&r->masks) || flags > 0xffff)
+		return (-1);
+
+	memset(&g, 0, sizeof(g));
+	g.xcenter = r->r_gfx.xcenter;
+	g.ycenter = r->r_gfx.ycenter;
+	g.xmotion = r->r_gfx.xmotion;
+	g.ymotion = r->r_gfx.ymotion;
+	g.xorigin = r->r_gfx.xorigin;
+	g.yorigin = r->r_gfx.yorigin;
+	g.rx = (Sint16)r->r_gfx.rs.x;
+	g.ry = (Sint16)r->r_gfx.rs.y;
+	g.rw = (Uint16)r->r_gfx.rs.w;
+	g.rh = (Uint16)r->r_gfx.rs.h;
+	g.friction = r->friction;
+
+	if ((its = InternTileset(st, ts)) == -1 ||
+	    (ixf = InternXform(st, &r->transforms)) == -1 ||
+	    (igfx = InternGfx(st, &g)) == -1)
+		return (-1);
+
+	GrowItems(L, 1);
+	i = L->nItems++;
+	L->type[i] = (Uint8)r->type;
+	L->ts[i] = (Uint16)its;
+	L->id[i] = id;
+	L->flags[i] = (Uint16)flags;
+	L->xform[i] = (Uint16)ixf;
+	L->gfx[i] = (Uint16)igfx;
+	return (0);
+}
+
+/* Look up (and optionally create) the extras of a node. */
+static MAP_StoreExtra *_Nullable
+GetExtra(MAP_Store *_Nonnull st, Uint32 node, int create)
+{
+	MAP_StoreExtra *ex;
+	Uint lo = 0, hi = st->nExtras, mid;
+
+	while (lo < hi) {
+		mid = (lo+hi) >> 1;
+		if (st->extras[mid]->node < node) {
+			lo = mid+1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo < st->nExtras && st->extras[lo]->node == node) {
+		return (st->extras[lo]);
+	}
+	if (!create) {
+		return (NULL);
+	}
+	ex = Malloc(sizeof(MAP_StoreExtra));
+	ex->node = node;
+	MAP_NodeInit(&ex->items);
+
+	st->extras = Realloc(st->extras, (st->nExtras+1) *
+	                                 sizeof(MAP_StoreExtra *));
+	memmove(&st->extras[lo+1], &st->extras[lo],
+	    (st->nExtras - lo)*sizeof(MAP_StoreExtra *));
+	st->extras[lo] = ex;
+	st->nExtras++;
+	return (ex);
+}
+
+static void
+FreeExtra(MAP_Store *_Nonnull st, MAP_StoreExtra *_Nonnull ex)
+{
+	MAP_NodeDestroy(st->map, &ex->items);
+	free(ex);
+}
+
+/* Release all items and interned tables. */
+static void
+Clear(MAP_Store *_Nonnull st)
+{
+	Uint i;
+
+	for (i = 0; i < st->nLayers; i++) {
+		MAP_StoreLayer *L = &st->layers[i];
+
+		free(L->count);
+		free(L->row);
+		FreeItems(L);
+	}
+	Free(st->layers);
+	st->layers = NULL;
+	st->nLayers = 0;
+
+	for (i = 0; i < st->nTilesets; i++) {
+		AG_ObjectDelDep(st->map, st->tilesets[i]);
+	}
+	Free(st->tilesets);
+	st->tilesets = NULL;
+	st->nTilesets = 0;
+
+	for (i = 0; i < st->nXforms; i++) {
+		RG_TransformChainDestroy(&st->xforms[i]->chain);
+		free(st->xforms[i]);
+	}
+	Free(st->xforms);
+	Free(st->xformHash);
+	st->xforms = NULL;
+	st->xformHash = NULL;
+	st->nXforms = 0;
+	st->nXformHash = 0;
+
+	Free(st->gfx);
+	Free(st->gfxHash);
+	st->gfx = NULL;
+	st->gfxHash = NULL;
+	st->nGfx = 0;
+	st->nGfxHash = 0;
+
+	for (i = 0; i < st->nExtras; i++) {
+		FreeExtra(st, st->extras[i]);
+	}
+	Free(st->extras);
+	st->extras = NULL;
+	st->nExtras = 0;
+}
+
+/* Initialize the tables of an empty store. */
+static void
+InitTables(MAP_Store *_Nonnull st)
+{
+	MAP_StoreXform *xf;
+
+	xf = Malloc(sizeof(MAP_StoreXform));
+	RG_TransformChainInit(&xf->chain);
+	xf->hash = 0;
+	AddXform(st, xf);			/* Empty chain is #0 */
+}
+
+/*
+ * Initialize a store of w x h empty nodes. Tileset dependencies as well
+ * as the items kept as extras are associated with map m.
+ */
+void
+MAP_StoreInit(MAP_Store *st, MAP *m, Uint w, Uint h)
+{
+	memset(st, 0, sizeof(MAP_Store));
+	st->map = m;
+	st->w = w;
+	st->h = h;
+	InitTables(st);
+}
+
+void
+MAP_StoreDestroy(MAP_Store *st)
+{
+	AG_ObjectLock(st->map);
+	Clear(st);
+	AG_ObjectUnlock(st->map);
+}
+
+/* Replace the items of layer l in the given region of the store. */
+static void
+PutLayer(MAP_Store *_Nonnull st, Uint l, Uint xd, Uint yd, MAP *_Nonnull sm,
+    Uint xs, Uint ys, Uint w, Uint h)
+{
+	MAP_StoreLayer *L = &st->layers[l], T;
+	Uint32 base = L->row[yd], i, iEnd, n;
+	Uint x, y;
+
+	/* Rows above the region are unchanged. Rebuild the rest into T. */
+	memset(&T, 0, sizeof(T));
+	for (y = yd; y < yd+h; y++) {
+		Uint8 *count = &L->count[y*st->w];
+
+		i = L->row[y];
+		iEnd = L->row[y+1];
+		L->row[y] = base + T.nItems;
+
+		for (x = 0, n = 0; x < xd; x++) {
+			n += count[x];
+		}
+		CopyItems(&T, L, i, n);
+		i += n;
+		for (x = xd; x < xd+w; x++) {
+			MAP_Node *node = &sm->map[ys+y-yd][xs+x-xd];
+			MAP_Item *r;
+
+			i += count[x];
+			count[x] = 0;
+			TAILQ_FOREACH(r, &node->nrefs, nrefs) {
+				MAP_StoreExtra *ex;
+
+				if (r->layer != l ||
+				    (r->flags & MAP_ITEM_NOSAVE)) {
+					continue;
+				}
+				if (count[x] < MAP_STORE_NODE_ITEMS_MAX &&
+				    PushItem(st, &T, r) == 0) {
+					count[x]++;
+					continue;
+				}
+				ex = GetExtra(st, y*st->w + x, 1);
+				MAP_NodeCopyItem(r, st->map, &ex->items, -1);
+			}
+		}
+		CopyItems(&T, L, i, iEnd-i);
+	}
+
+	/* Rows below the region are unchanged; move them as a block. */
+	i = L->row[yd+h];
+	iEnd = L->row[st->h];
+	for (y = yd+h; y <= st->h; y++) {
+		L->row[y] = L->row[y] - i + base + T.nItems;
+	}
+	CopyItems(&T, L, i, iEnd-i);
+
+	L->nItems = base;
+	CopyItems(L, &T, 0, T.nItems);
+	FreeItems(&T);
+}
+
+static int
+CheckRegion(Uint w0, Uint h0, int x, int y, Uint w, Uint h)
+{
+	if (x < 0 || y < 0 ||
+	    (Uint)x + w > w0 || (Uint)y + h > h0) {
+		AG_SetError(_("Bad region %d,%d (%ux%u) in %ux%u nodes."),
+		    x, y, w, h, w0, h0);
+		return (-1);
+	}
+	return (0);
+}
+
+/*
+ * Encode the w x h nodes of map sm at xs,ys into the store at xd,yd,
+ * replacing any previous contents. Non-persistent items are ignored.
+ * Each call rewrites the item arrays from row yd onward, so a single
+ * call over a large region is cheaper than many small ones.
+ */
+int
+MAP_StorePut(MAP_Store *st, int xd, int yd, MAP *sm, int xs, int ys,
+    Uint w, Uint h)
+{
+	Uint nLayers, i, j, x, y;
+
+	if (CheckRegion(st->w, st->h, xd, yd, w, h) == -1 ||
+	    CheckRegion(sm->mapw, sm->maph, xs, ys, w, h) == -1)
+		return (-1);
+
+	AG_ObjectLock(sm);
+	AG_ObjectLock(st->map);
+
+	/* Allocate the layers referenced by the source items. */
+	nLayers = sm->nlayers;
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			MAP_Node *node = &sm->map[ys+y][xs+x];
+			MAP_Item *r;
+
+			TAILQ_FOREACH(r, &node->nrefs, nrefs) {
+				if ((Uint)r->layer+1 > nLayers)
+					nLayers = (Uint)r->layer+1;
+			}
+		}
+	}
+	GrowLayers(st, nLayers);
+
+	/* Remove the extras in the region. */
+	for (i = 0, j = 0; i < st->nExtras; i++) {
+		MAP_StoreExtra *ex = st->extras[i];
+
+		x = ex->node % st->w;
+		y = ex->node / st->w;
+		if (x >= (Uint)xd && x < (Uint)xd+w &&
+		    y >= (Uint)yd && y < (Uint)yd+h) {
+			FreeExtra(st, ex);
+			continue;
+		}
+		st->extras[j++] = ex;
+	}
+	st->nExtras = j;
+
+	for (i = 0; i < st->nLayers; i++)
+		PutLayer(st, i, xd, yd, sm, xs, ys, w, h);
+
+	AG_ObjectUnlock(st->map);
+	AG_ObjectUnlock(sm);
+	return (0);
+}
+
+/* Return the index of the first item of node x,y in layer L. */
+static __inline__ Uint32
+NodeOffset(const MAP_Store *_Nonnull st, const MAP_StoreLayer *_Nonnull L,
+    Uint x, Uint y)
+{
+	const Uint8 *count = &L->count[y*st->w];
+	Uint32 i = L->row[y];
+	Uint j;
+
+	for (j = 0; j < x; j++) {
+		i += count[j];
+	}
+	return (i);
+}
+
+/* Materialize n items of layer l starting at index i into node dn. */
+static void
+GetItems(MAP_Store *_Nonnull st, Uint l, Uint32 i, Uint n, MAP *_Nonnull dm,
+    MAP_Node *_Nonnull dn)
+{
+	const MAP_StoreLayer *L = &st->layers[l];
+
+	for (; n > 0; n--, i++) {
+		RG_Tileset *ts = st->tilesets[L->ts[i]];
+		const MAP_StoreGfx *g = &st->gfx[L->gfx[i]];
+		MAP_Item *r;
+
+		if (L->type[i] == MAP_ITEM_ANIM) {
+			r = MAP_NodeAddAnim(dm, dn, ts, L->id[i]);
+		} else {
+			r = MAP_NodeAddTile(dm, dn, ts, L->id[i]);
+		}
+		r->flags = (Uint)L->flags[i];
+		r->layer = (Uint8)l;
+		r->friction = g->friction;
+		r->r_gfx.xcenter = g->xcenter;
+		r->r_gfx.ycenter = g->ycenter;
+		r->r_gfx.xmotion = g->xmotion;
+		r->r_gfx.ymotion = g->ymotion;
+		r->r_gfx.xorigin = g->xorigin;
+		r->r_gfx.yorigin = g->yorigin;
+		r->r_gfx.rs.x = g->rx;
+		r->r_gfx.rs.y = g->ry;
+		r->r_gfx.rs.w = g->rw;
+		r->r_gfx.rs.h = g->rh;
+		if (L->xform[i] != 0)
+			RG_TransformChainDup(&st->xforms[L->xform[i]]->chain,
+			    &r->transforms);
+	}
+}
+
+static void
+GetExtras(MAP_Store *_Nonnull st, Uint32 node, MAP *_Nonnull dm,
+    MAP_Node *_Nonnull dn)
+{
+	MAP_StoreExtra *ex;
+	MAP_Item *r;
+
+	if ((ex = GetExtra(st, node, 0)) == NULL) {
+		return;
+	}
+	TAILQ_FOREACH(r, &ex->items.nrefs, nrefs)
+		MAP_NodeCopyItem(r, dm, dn, -1);
+}
+
+/*
+ * Append the items of node x,y of the store to node dn of map dm.
+ * Compact items come first, in layer order, followed by any extras.
+ */
+int
+MAP_StoreGetNode(MAP_Store *st, int x, int y, MAP *dm, MAP_Node *dn)
+{
+	Uint l;
+
+	if (CheckRegion(st->w, st->h, x, y, 1, 1) == -1) {
+		return (-1);
+	}
+	AG_ObjectLock(dm);
+	AG_ObjectLock(st->map);
+	for (l = 0; l < st->nLayers; l++) {
+		MAP_StoreLayer *L = &st->layers[l];
+
+		GetItems(st, l, NodeOffset(st, L, x, y),
+		    L->count[y*st->w + x], dm, dn);
+	}
+	GetExtras(st, y*st->w + x, dm, dn);
+	AG_ObjectUnlock(st->map);
+	AG_ObjectUnlock(dm);
+	return (0);
+}
+
+/*
+ * Materialize the w x h nodes of the store at xs,ys into the nodes of
+ * map dm at xd,yd. The previous items of the destination nodes are removed.
+ */
+int
+MAP_StoreGet(MAP_Store *st, int xs, int ys, MAP *dm, int xd, int yd,
+    Uint w, Uint h)
+{
+	Uint32 *offs;
+	Uint l, x, y;
+
+	if (CheckRegion(st->w, st->h, xs, ys, w, h) == -1 ||
+	    CheckRegion(dm->mapw, dm->maph, xd, yd, w, h) == -1)
+		return (-1);
+
+	AG_ObjectLock(dm);
+	AG_ObjectLock(st->map);
+	offs = Malloc((st->nLayers+1)*sizeof(Uint32));
+	for (y = 0; y < h; y++) {
+		Uint ny = ys+y;
+
+		for (l = 0; l < st->nLayers; l++) {
+			offs[l] = NodeOffset(st, &st->layers[l], xs, ny);
+		}
+		for (x = 0; x < w; x++) {
+			MAP_Node *dn = &dm->map[yd+y][xd+x];
+			Uint32 node = ny*st->w + xs+x;
+
+			MAP_NodeRemoveAll(dm, dn, -1);
+			for (l = 0; l < st->nLayers; l++) {
+				Uint n = st->layers[l].count[node];
+
+				GetItems(st, l, offs[l], n, dm, dn);
+				offs[l] += n;
+			}
+			GetExtras(st, node, dm, dn);
+		}
+	}
+	free(offs);
+	AG_ObjectUnlock(st->map);
+	AG_ObjectUnlock(dm);
+	return (0);
+}
+
+/* Return the number of items on node x,y. */
+Uint
+MAP_StoreNodeItems(const MAP_Store *st, int x, int y)
+{
+	MAP_StoreExtra *ex;
+	MAP_Item *r;
+	Uint l, n = 0;
+
+	if (x < 0 || y < 0 || (Uint)x >= st->w || (Uint)y >= st->h) {
+		return (0);
+	}
+	for (l = 0; l < st->nLayers; l++) {
+		n += st->layers[l].count[y*st->w + x];
+	}
+	if ((ex = GetExtra((MAP_Store *)st, y*st->w + x, 0)) != NULL) {
+		TAILQ_FOREACH(r, &ex->items.nrefs, nrefs)
+			n++;
+	}
+	return (n);
+}
+
+/* Return the approximate memory footprint of the store in bytes. */
+AG_Size
+MAP_StoreSize(const MAP_Store *st)
+{
+	AG_Size size = sizeof(MAP_Store);
+	Uint i;
+
+	for (i = 0; i < st->nLayers; i++) {
+		const MAP_StoreLayer *L = &st->layers[i];
+
+		size += sizeof(MAP_StoreLayer) + st->w*st->h*sizeof(Uint8) +
+		        (st->h+1)*sizeof(Uint32) +
+		        L->maxItems*(sizeof(Uint8) + 4*sizeof(Uint16) +
+		                     sizeof(Uint32));
+	}
+	for (i = 0; i < st->nXforms; i++) {
+		const RG_Transform *xf;
+
+		size += sizeof(MAP_StoreXform *) + sizeof(MAP_StoreXform);
+		TAILQ_FOREACH(xf, &st->xforms[i]->chain, transforms)
+			size += sizeof(RG_Transform);
+	}
+	size += st->nTilesets*sizeof(RG_Tileset *) +
+	        st->nGfx*sizeof(MAP_StoreGfx) +
+	        (st->nXformHash + st->nGfxHash)*sizeof(Uint32);
+
+	for (i = 0; i < st->nExtras; i++) {
+		const MAP_Item *r;
+
+		size += sizeof(MAP_StoreExtra *) + sizeof(MAP_StoreExtra);
+		TAILQ_FOREACH(r, &st->extras[i]->items.nrefs, nrefs)
+			size += sizeof(MAP_Item);
+	}
+	return (size);
+}
+
+static void
+WriteColumn16(AG_DataSource *_Nonnull ds, const Uint16 *_Nonnull v, Uint32 n)
+{
+	Uint16 buf[COLUMN_CHUNK];
+	Uint32 i, j, nChunk;
+
+	for (i = 0; i < n; i += nChunk) {
+		nChunk = MIN(n-i, COLUMN_CHUNK);
+		if (ds->byte_order == AG_BYTEORDER_BE) {
+			for (j = 0; j < nChunk; j++)
+				buf[j] = AG_SwapBE16(v[i+j]);
+		} else {
+			for (j = 0; j < nChunk; j++)
+				buf[j] = AG_SwapLE16(v[i+j]);
+		}
+		if (AG_Write(ds, buf, nChunk*sizeof(Uint16)) != 0)
+			AG_DataSourceError(ds, NULL);
+	}
+}
+
+static void
+WriteColumn32(AG_DataSource *_Nonnull ds, const Uint32 *_Nonnull v, Uint32 n)
+{
+	Uint32 buf[COLUMN_CHUNK];
+	Uint32 i, j, nChunk;
+
+	for (i = 0; i < n; i += nChunk) {
+		nChunk = MIN(n-i, COLUMN_CHUNK);
+		if (ds->byte_order == AG_BYTEORDER_BE) {
+			for (j = 0; j < nChunk; j++)
+				buf[j] = AG_SwapBE32(v[i+j]);
+		} else {
+			for (j = 0; j < nChunk; j++)
+				buf[j] = AG_SwapLE32(v[i+j]);
+		}
+		if (AG_Write(ds, buf, nChunk*sizeof(Uint32)) != 0)
+			AG_DataSourceError(ds, NULL);
+	}
+}
+
+static int
+ReadColumn16(AG_DataSource *_Nonnull ds, Uint16 *_Nonnull v, Uint32 n)
+{
+	Uint32 i;
+
+	if (n > 0 && AG_Read(ds, v, n*sizeof(Uint16)) != 0) {
+		return (-1);
+	}
+	if (ds->byte_order == AG_BYTEORDER_BE) {
+		for (i = 0; i < n; i++)
+			v[i] = AG_SwapBE16(v[i]);
+	} else {
+		for (i = 0; i < n; i++)
+			v[i] = AG_SwapLE16(v[i]);
+	}
+	return (0);
+}
+
+static int
+ReadColumn32(AG_DataSource *_Nonnull ds, Uint32 *_Nonnull v, Uint32 n)
+{
+	Uint32 i;
+
+	if (n > 0 && AG_Read(ds, v, n*sizeof(Uint32)) != 0) {
+		return (-1);
+	}
+	if (ds->byte_order == AG_BYTEORDER_BE) {
+		for (i = 0; i < n; i++)
+			v[i] = AG_SwapBE32(v[i]);
+	} else {
+		for (i = 0; i < n; i++)
+			v[i] = AG_SwapLE32(v[i]);
+	}
+	return (0);
+}
+
+/* Return -1 if any of the n indices in v is out of the [0,max) range. */
+static int
+CheckIndices(const Uint16 *_Nonnull v, Uint32 n, Uint max, const char *what)
+{
+	Uint32 i;
+
+	for (i = 0; i < n; i++) {
+		if (v[i] >= max) {
+			AG_SetError("Bad %s index: %u", what, (Uint)v[i]);
+			return (-1);
+		}
+	}
+	return (0);
+}
+
+static int
+LoadLayer(MAP_Store *_Nonnull st, MAP_StoreLayer *_Nonnull L,
+    AG_DataSource *_Nonnull ds)
+{
+	Uint32 nItems, i, n;
+	Uint x, y;
+
+	nItems = AG_ReadUint32(ds);
+	if (st->w*st->h > 0 &&
+	    AG_Read(ds, L->count, st->w*st->h) != 0) {
+		return (-1);
+	}
+	for (y = 0, n = 0; y < st->h; y++) {
+		const Uint8 *count = &L->count[y*st->w];
+
+		L->row[y] = n;
+		for (x = 0; x < st->w; x++)
+			n += count[x];
+	}
+	L->row[st->h] = n;
+	if (n != nItems) {
+		AG_SetError("Bad item count (%u != %u)", (Uint)n,
+		    (Uint)nItems);
+		return (-1);
+	}
+
+	GrowItems(L, nItems);
+	if (nItems > 0 && AG_Read(ds, L->type, nItems) != 0) {
+		return (-1);
+	}
+	for (i = 0; i < nItems; i++) {
+		if (L->type[i] != MAP_ITEM_TILE &&
+		    L->type[i] != MAP_ITEM_ANIM) {
+			AG_SetError("Bad item type: %u", (Uint)L->type[i]);
+			return (-1);
+		}
+	}
+	if (ReadColumn16(ds, L->ts, nItems) == -1 ||
+	    CheckIndices(L->ts, nItems, st->nTilesets, "tileset") == -1 ||
+	    ReadColumn32(ds, L->id, nItems) == -1 ||
+	    ReadColumn16(ds, L->flags, nItems) == -1 ||
+	    ReadColumn16(ds, L->xform, nItems) == -1 ||
+	    CheckIndices(L->xform, nItems, st->nXforms, "transform") == -1 ||
+	    ReadColumn16(ds, L->gfx, nItems) == -1 ||
+	    CheckIndices(L->gfx, nItems, st->nGfx, "gfx") == -1) {
+		return (-1);
+	}
+	L->nItems = nItems;
+	return (0);
+}
+
+/*
+ * Load the contents of a store from its bulk serialized form. Tileset
+ * references are resolved against the dependency table of the map.
+ */
+int
+MAP_StoreLoad(MAP_Store *st, AG_DataSource *ds)
+{
+	Uint32 w, h, n, i;
+
+	AG_ObjectLock(st->map);
+	Clear(st);
+	InitTables(st);
+	st->w = 0;
+	st->h = 0;
+
+	w = AG_ReadUint32(ds);
+	h = AG_ReadUint32(ds);
+	if (w > MAP_WIDTH_MAX || h > MAP_HEIGHT_MAX) {
+		AG_SetError(_("Invalid map geometry."));
+		goto fail;
+	}
+	st->w = (Uint)w;
+	st->h = (Uint)h;
+
+	/* Read the interned tables. */
+	if ((n = AG_ReadUint32(ds)) > MAP_STORE_INTERN_MAX) {
+		AG_SetError("Too many tilesets: %u", (Uint)n);
+		goto fail;
+	}
+	for (i = 0; i < n; i++) {
+		void *ts;
+
+		if (AG_ObjectFindDep(st->map, AG_ReadUint32(ds), &ts) == -1) {
+			goto fail;
+		}
+		AddTileset(st, ts);
+	}
+	if ((n = AG_ReadUint32(ds)) >= MAP_STORE_INTERN_MAX) {
+		AG_SetError("Too many transform chains: %u", (Uint)n);
+		goto fail;
+	}
+	for (i = 0; i < n; i++) {
+		MAP_StoreXform *xf;
+
+		xf = Malloc(sizeof(MAP_StoreXform));
+		RG_TransformChainInit(&xf->chain);
+		if (RG_TransformChainLoad(ds, &xf->chain) == -1) {
+			RG_TransformChainDestroy(&xf->chain);
+			free(xf);
+			goto fail;
+		}
+		xf->hash = RG_TransformChainHash(&xf->chain);
+		AddXform(st, xf);
+	}
+	if ((n = AG_ReadUint32(ds)) > MAP_STORE_INTERN_MAX) {
+		AG_SetError("Too many gfx entries: %u", (Uint)n);
+		goto fail;
+	}
+	for (i = 0; i < n; i++) {
+		MAP_StoreGfx g;
+
+		memset(&g, 0, sizeof(g));
+		g.xcenter = AG_ReadSint16(ds);
+		g.ycenter = AG_ReadSint16(ds);
+		g.xmotion = AG_ReadSint16(ds);
+		g.ymotion = AG_ReadSint16(ds);
+		g.xorigin = AG_ReadSint16(ds);
+		g.yorigin = AG_ReadSint16(ds);
+		g.rx = AG_ReadSint16(ds);
+		g.ry = AG_ReadSint16(ds);
+		g.rw = AG_ReadUint16(ds);
+		g.rh = AG_ReadUint16(ds);
+		g.friction = AG_ReadSint8(ds);
+		AddGfx(st, &g);
+	}
+
+	/* Read the item arrays. */
+	if ((n = AG_ReadUint32(ds)) > MAP_LAYERS_MAX) {
+		AG_SetError(_("Too many layers."));
+		goto fail;
+	}
+	GrowLayers(st, n);
+	for (i = 0; i < n; i++) {
+		if (LoadLayer(st, &st->layers[i], ds) == -1)
+			goto fail;
+	}
+
+	/* Read the extras. */
+	n = AG_ReadUint32(ds);
+	for (i = 0; i < n; i++) {
+		MAP_StoreExtra *ex;
+		Uint32 node;
+
+		if ((node = AG_ReadUint32(ds)) >= w*h) {
+			AG_SetError("Bad extra node: %u", (Uint)node);
+			goto fail;
+		}
+		ex = GetExtra(st, node, 1);
+		if (MAP_NodeLoad(st->map, ds, &ex->items) == -1)
+			goto fail;
+	}
+	AG_ObjectUnlock(st->map);
+	return (0);
+fail:
+	Clear(st);
+	InitTables(st);
+	st->w = 0;
+	st->h = 0;
+	AG_ObjectUnlock(st->map);
+	return (-1);
+}
+
+/*
+ * Write the store in bulk form: interned tables first, then each column
+ * of each layer as a contiguous array, then the extras.
+ */
+void
+MAP_StoreSave(MAP_Store *st, AG_DataSource *ds)
+{
+	Uint i;
+
+	AG_ObjectLock(st->map);
+
+	AG_WriteUint32(ds, (Uint32)st->w);
+	AG_WriteUint32(ds, (Uint32)st->h);
+
+	AG_WriteUint32(ds, (Uint32)st->nTilesets);
+	for (i = 0; i < st->nTilesets; i++) {
+		AG_WriteUint32(ds, AG_ObjectEncodeName(st->map,
+		    st->tilesets[i]));
+	}
+	AG_WriteUint32(ds, (Uint32)(st->nXforms-1));
+	for (i = 1; i < st->nXforms; i++) {
+		RG_TransformChainSave(ds, &st->xforms[i]->chain);
+	}
+	AG_WriteUint32(ds, (Uint32)st->nGfx);
+	for (i = 0; i < st->nGfx; i++) {
+		const MAP_StoreGfx *g = &st->gfx[i];
+
+		AG_WriteSint16(ds, g->xcenter);
+		AG_WriteSint16(ds, g->ycenter);
+		AG_WriteSint16(ds, g->xmotion);
+		AG_WriteSint16(ds, g->ymotion);
+		AG_WriteSint16(ds, g->xorigin);
+		AG_WriteSint16(ds, g->yorigin);
+		AG_WriteSint16(ds, g->rx);
+		AG_WriteSint16(ds, g->ry);
+		AG_WriteUint16(ds, g->rw);
+		AG_WriteUint16(ds, g->rh);
+		AG_WriteSint8(ds, g->friction);
+	}
+
+	AG_WriteUint32(ds, (Uint32)st->nLayers);
+	for (i = 0; i < st->nLayers; i++) {
+		const MAP_StoreLayer *L = &st->layers[i];
+
+		AG_WriteUint32(ds, L->nItems);
+		if (st->w*st->h > 0 &&
+		    AG_Write(ds, L->count, st->w*st->h) != 0) {
+			AG_DataSourceError(ds, NULL);
+		}
+		if (L->nItems == 0) {
+			continue;
+		}
+		if (AG_Write(ds, L->type, L->nItems) != 0) {
+			AG_DataSourceError(ds, NULL);
+		}
+		WriteColumn16(ds, L->ts, L->nItems);
+		WriteColumn32(ds, L->id, L->nItems);
+		WriteColumn16(ds, L->flags, L->nItems);
+		WriteColumn16(ds, L->xform, L->nItems);
+		WriteColumn16(ds, L->gfx, L->nItems);
+	}
+
+	AG_WriteUint32(ds, (Uint32)st->nExtras);
+	for (i = 0; i < st->nExtras; i++) {
+		AG_WriteUint32(ds, st->extras[i]->node);
+		MAP_NodeSave(st->map, ds, &st->extras[i]->items);
+	}
+
+	AG_ObjectUnlock(st->map);
+}
@@ -0,0 +1,94 @@
+/*	Public domain	*/
+
+#ifndef _AGAR_MAP_STORE_H_
+#define _AGAR_MAP_STORE_H_
+
+#include <agar/map/begin.h>
+
+#define MAP_STORE_NODE_ITEMS_MAX 255	/* Compact items per node and layer */
+#define MAP_STORE_INTERN_MAX	 65535	/* Max tilesets, transforms, gfx */
+
+/* Interned graphical parameters of an item. */
+typedef struct map_store_gfx {
+	Sint16 xcenter, ycenter;	/* Centering offsets */
+	Sint16 xmotion, ymotion;	/* Motion offsets */
+	Sint16 xorigin, yorigin;	/* Origin point */
+	Sint16 rx, ry;			/* Source rectangle */
+	Uint16 rw, rh;
+	Sint8 friction;			/* Coefficient of friction */
+	Uint8 _pad;
+} MAP_StoreGfx;
+
+/* Interned transform chain. */
+typedef struct map_store_xform {
+	RG_TransformChain chain;
+	Uint32 hash;			/* RG_TransformChainHash() */
+} MAP_StoreXform;
+
+/*
+ * Items of one layer, as parallel arrays in row-major node order.
+ * The items of node (x,y) start at row[y] + sum(count[y*w .. y*w+x-1]).
+ */
+typedef struct map_store_layer {
+	Uint8  *_Nullable count;	/* Items per node (w*h) */
+	Uint32 *_Nullable row;		/* First item of each row (h+1) */
+	Uint8  *_Nullable type;		/* MAP_ITEM_TILE or MAP_ITEM_ANIM */
+	Uint16 *_Nullable ts;		/* Tileset (index into tilesets) */
+	Uint32 *_Nullable id;		/* Tile or animation ID */
+	Uint16 *_Nullable flags;	/* Item flags */
+	Uint16 *_Nullable xform;	/* Transform chain (index into xforms) */
+	Uint16 *_Nullable gfx;		/* Parameters (index into gfx) */
+	Uint32 nItems, maxItems;
+} MAP_StoreLayer;
+
+/* Items of a node which have no compact representation (warps, masks). */
+typedef struct map_store_extra {
+	Uint32 node;			/* Node index (y*w + x) */
+	MAP_Node items;			/* Full items */
+} MAP_StoreExtra;
+
+/*
+ * Compact storage for the nodes of a large map. Nodes are materialized
+ * into the MAP_Node representation of a MAP on demand.
+ */
+typedef struct map_store {
+	MAP *_Nonnull map;			/* Map (dependencies, extras) */
+	Uint w, h;				/* Geometry in nodes */
+
+	MAP_StoreLayer *_Nullable layers;	/* Per-layer item arrays */
+	Uint                     nLayers;
+
+	RG_Tileset *_Nonnull *_Nullable tilesets; /* Interned tilesets */
+	Uint                           nTilesets;
+	MAP_StoreXform *_Nonnull *_Nullable xforms; /* Interned chains */
+	Uint                     nXforms;
+	MAP_StoreGfx *_Nullable gfx;		/* Interned parameters */
+	Uint                   nGfx;
+
+	Uint32 *_Nullable xformHash;		/* Hash tables of index+1 (or 0) */
+	Uint32 *_Nullable gfxHash;
+	Uint nXformHash, nGfxHash;		/* Table sizes (power of 2) */
+
+	MAP_StoreExtra *_Nonnull *_Nullable extras; /* Sorted by node */
+	Uint                               nExtras;
+} MAP_Store;
+
+__BEGIN_DECLS
+void MAP_StoreInit(MAP_Store *_Nonnull, MAP *_Nonnull, Uint, Uint);
+void MAP_StoreDestroy(MAP_Store *_Nonnull);
+
+int  MAP_StorePut(MAP_Store *_Nonnull, int,int, MAP *_Nonnull, int,int,
+                  Uint,Uint);
+int  MAP_StoreGet(MAP_Store *_Nonnull, int,int, MAP *_Nonnull, int,int,
+                  Uint,Uint);
+int  MAP_StoreGetNode(MAP_Store *_Nonnull, int,int, MAP *_Nonnull,
+                      MAP_Node *_Nonnull);
+Uint MAP_StoreNodeItems(const MAP_Store *_Nonnull, int,int);
+AG_Size MAP_StoreSize(const MAP_Store *_Nonnull);
+
+int  MAP_StoreLoad(MAP_Store *_Nonnull, AG_DataSource *_Nonnull);
+void MAP_StoreSave(MAP_Store *_Nonnull, AG_DataSource *_Nonnull);
+__END_DECLS
+
+#include <agar/map/close.h>
+#endif /* _AGAR_MAP_STORE_H_ */
@@ -941,6 +941,38 @@ MANLINKS+=M_Vector.3:M_VecElemPow4.3
 CATLINKS+=M_Vector.cat3:M_VecElemPow4.cat3
 MANLINKS+=M_Vector.3:M_VecVecAngle4.3
 CATLINKS+=M_Vector.cat3:M_VecVecAngle4.cat3
+MANLINKS+=M_Vector.3:M_VecTransformPoints3.3
+CATLINKS+=M_Vector.cat3:M_VecTransformPoints3.cat3
+MANLINKS+=M_Vector.3:M_VecTransform4.3
+CATLINKS+=M_Vector.cat3:M_VecTransform4.cat3
+MANLINKS+=M_Vector.3:M_VecDotArr3.3
+CATLINKS+=M_Vector.cat3:M_VecDotArr3.cat3
+MANLINKS+=M_Vector.3:M_VecCrossArr3.3
+CATLINKS+=M_Vector.cat3:M_VecCrossArr3.cat3
+MANLINKS+=M_Vector.3:M_VecNormArr3.3
+CATLINKS+=M_Vector.cat3:M_VecNormArr3.cat3
+MANLINKS+=M_Vector.3:M_VecBounds3.3
+CATLINKS+=M_Vector.cat3:M_VecBounds3.cat3
+MANLINKS+=M_Vector.3:M_VectorSoAInit3.3
+CATLINKS+=M_Vector.cat3:M_VectorSoAInit3.cat3
+MANLINKS+=M_Vector.3:M_VectorSoAResize3.3
+CATLINKS+=M_Vector.cat3:M_VectorSoAResize3.cat3
+MANLINKS+=M_Vector.3:M_VectorSoAFree3.3
+CATLINKS+=M_Vector.cat3:M_VectorSoAFree3.cat3
+MANLINKS+=M_Vector.3:M_VectorToSoA3.3
+CATLINKS+=M_Vector.cat3:M_VectorToSoA3.cat3
+MANLINKS+=M_Vector.3:M_VectorFromSoA3.3
+CATLINKS+=M_Vector.cat3:M_VectorFromSoA3.cat3
+MANLINKS+=M_Vector.3:M_VecTransformPointsSoA3.3
+CATLINKS+=M_Vector.cat3:M_VecTransformPointsSoA3.cat3
+MANLINKS+=M_Vector.3:M_VecDotSoA3.3
+CATLINKS+=M_Vector.cat3:M_VecDotSoA3.cat3
+MANLINKS+=M_Vector.3:M_VecCrossSoA3.3
+CATLINKS+=M_Vector.cat3:M_VecCrossSoA3.cat3
+MANLINKS+=M_Vector.3:M_VecNormSoA3.3
+CATLINKS+=M_Vector.cat3:M_VecNormSoA3.cat3
+MANLINKS+=M_Vector.3:M_VecBoundsSoA3.3
+CATLINKS+=M_Vector.cat3:M_VecBoundsSoA3.cat3
 MANLINKS+=M_PointSet.3:M_PointSet2.3
 CATLINKS+=M_PointSet.cat3:M_PointSet2.cat3
 MANLINKS+=M_PointSet.3:M_PointSet2i.3
@@ -10,6 +10,7 @@
 #include <agar/math/m_complex.h>
 #include <agar/math/m_vector.h>
 #include <agar/math/m_matrix.h>
+#include <agar/math/m_vector_array.h>
 #include <agar/math/m_quaternion.h>
 #include <agar/math/m_coordinates.h>
 #include <agar/math/m_color.h>
@@ -94,7 +94,7 @@ M_IntersectCircleCircle2(M_Circle2 C1, M_Circle2 C2)
 	M_Geom2 G1, G2;
 
 	if (Fabs(C1.p.x - C2.p.x) <= M_MACHEP &&
-	    Fabs(C1.p.x - C2.p.x) <= M_MACHEP &&
+	    Fabs(C1.p.y - C2.p.y) <= M_MACHEP &&
 	    Fabs(C1.r - C2.r) <= M_MACHEP) {
 		G1.type = M_CIRCLE;
 		G1.g.circle = C1;
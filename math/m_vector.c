@@ -33,6 +33,7 @@ const M_VectorOps *mVecOps = NULL;
 const M_VectorOps2 *mVecOps2 = NULL;
 const M_VectorOps3 *mVecOps3 = NULL;
 const M_VectorOps4 *mVecOps4 = NULL;
+const M_VectorArrayOps *mVecArrOps = NULL;
 
 void
 M_VectorInitEngine(void)
@@ -41,9 +42,12 @@ M_VectorInitEngine(void)
 	mVecOps2 = &mVecOps2_FPU;
 	mVecOps3 = &mVecOps3_FPU;
 	mVecOps4 = &mVecOps4_FPU;
+	mVecArrOps = &mVecArrOps_FPU;
 #ifdef HAVE_SSE
-	if (agCPU.ext & AG_EXT_SSE)
+	if (agCPU.ext & AG_EXT_SSE) {
 		mVecOps3 = &mVecOps3_SSE;
+		mVecArrOps = &mVecArrOps_SSE;
+	}
 # ifdef INLINE_SSE
 	else {
 		AG_FatalError("Compiled for SSE, but no SSE support in CPU! "
@@ -74,6 +78,10 @@ M_VectorInitEngine(void)
 #  endif
 	}
 # endif
+# ifdef M_HAVE_AVX2_KERNELS
+	if (agCPU.ext & AG_EXT_AVX2)
+		mVecArrOps = &mVecArrOps_AVX2;
+# endif
 #endif /* HAVE_SSE */
 }
 
@@ -0,0 +1,336 @@
+/*	Public domain	*/
+/*
+ * Batched operations on arrays of vectors using scalar instructions,
+ * and management of structure-of-arrays vector sets.
+ */
+
+#include <agar/core/core.h>
+#include <agar/math/m.h>
+
+const M_VectorArrayOps mVecArrOps_FPU = {
+	"scalar",
+	M_VectorTransformPoints3_FPU,
+	M_VectorTransform4_FPU,
+	M_VectorDotArr3_FPU,
+	M_VectorCrossArr3_FPU,
+	M_VectorNormArr3_FPU,
+	M_VectorBounds3_FPU,
+	M_VectorTransformPointsSoA3_FPU,
+	M_VectorDotSoA3_FPU,
+	M_VectorCrossSoA3_FPU,
+	M_VectorNormSoA3_FPU,
+	M_VectorBoundsSoA3_FPU
+};
+
+/* Initialize an empty structure-of-arrays vector set. */
+void
+M_VectorSoAInit3(M_VectorSoA3 *S)
+{
+	S->n = 0;
+	S->maxn = 0;
+	S->x = NULL;
+	S->y = NULL;
+	S->z = NULL;
+}
+
+/* Resize a structure-of-arrays vector set to n vectors. */
+int
+M_VectorSoAResize3(M_VectorSoA3 *S, Uint n)
+{
+	M_VectorReal *x, *y, *z;
+
+	if (n > S->maxn) {
+		if ((x = TryRealloc(S->x, n*sizeof(M_VectorReal))) == NULL) {
+			return (-1);
+		}
+		S->x = x;
+		if ((y = TryRealloc(S->y, n*sizeof(M_VectorReal))) == NULL) {
+			return (-1);
+		}
+		S->y = y;
+		if ((z = TryRealloc(S->z, n*sizeof(M_VectorReal))) == NULL) {
+			return (-1);
+		}
+		S->z = z;
+		S->maxn = n;
+	}
+	S->n = n;
+	return (0);
+}
+
+void
+M_VectorSoAFree3(M_VectorSoA3 *S)
+{
+	Free(S->x);
+	Free(S->y);
+	Free(S->z);
+	M_VectorSoAInit3(S);
+}
+
+/* Convert an array of n vectors to structure-of-arrays representation. */
+int
+M_VectorToSoA3(M_VectorSoA3 *S, const M_Vector3 *v, Uint n)
+{
+	Uint i;
+
+	if (M_VectorSoAResize3(S, n) == -1) {
+		return (-1);
+	}
+	for (i = 0; i < n; i++) {
+		S->x[i] = v[i].x;
+		S->y[i] = v[i].y;
+		S->z[i] = v[i].z;
+	}
+	return (0);
+}
+
+/* Convert a structure-of-arrays set back to an array of S->n vectors. */
+void
+M_VectorFromSoA3(M_Vector3 *v, const M_VectorSoA3 *S)
+{
+	Uint i;
+
+	for (i = 0; i < S->n; i++) {
+		v[i].x = S->x[i];
+		v[i].y = S->y[i];
+		v[i].z = S->z[i];
+#ifdef HAVE_SSE
+		v[i]._pad = 0.0f;
+#endif
+	}
+}
+
+/*
+ * Transform n points (with implicit w=1) by the matrix A and return the
+ * x,y,z components of the results into vOut. vOut may be the same as vIn.
+ */
+void
+M_VectorTransformPoints3_FPU(M_Vector3 *vOut, const M_Matrix44 *A,
+    const M_Vector3 *vIn, Uint n)
+{
+	Uint i;
+
+	for (i = 0; i < n; i++) {
+		M_VectorReal x = vIn[i].x;
+		M_VectorReal y = vIn[i].y;
+		M_VectorReal z = vIn[i].z;
+
+		vOut[i].x = A->m[0][0]*x + A->m[0][1]*y + A->m[0][2]*z +
+		            A->m[0][3];
+		vOut[i].y = A->m[1][0]*x + A->m[1][1]*y + A->m[1][2]*z +
+		            A->m[1][3];
+		vOut[i].z = A->m[2][0]*x + A->m[2][1]*y + A->m[2][2]*z +
+		            A->m[2][3];
+#ifdef HAVE_SSE
+		vOut[i]._pad = 0.0f;
+#endif
+	}
+}
+
+/* Multiply n vectors in R^4 by the matrix A. vOut may be the same as vIn. */
+void
+M_VectorTransform4_FPU(M_Vector4 *vOut, const M_Matrix44 *A,
+    const M_Vector4 *vIn, Uint n)
+{
+	Uint i;
+
+	for (i = 0; i < n; i++) {
+		M_VectorReal x = vIn[i].x;
+		M_VectorReal y = vIn[i].y;
+		M_VectorReal z = vIn[i].z;
+		M_VectorReal w = vIn[i].w;
+
+		vOut[i].x = A->m[0][0]*x + A->m[0][1]*y + A->m[0][2]*z +
+		            A->m[0][3]*w;
+		vOut[i].y = A->m[1][0]*x + A->m[1][1]*y + A->m[1][2]*z +
+		            A->m[1][3]*w;
+		vOut[i].z = A->m[2][0]*x + A->m[2][1]*y + A->m[2][2]*z +
+		            A->m[2][3]*w;
+		vOut[i].w = A->m[3][0]*x + A->m[3][1]*y + A->m[3][2]*z +
+		            A->m[3][3]*w;
+	}
+}
+
+/* Compute the n dot products a[i].b[i] into dot[]. */
+void
+M_VectorDotArr3_FPU(M_VectorReal *dot, const M_Vector3 *a, const M_Vector3 *b,
+    Uint n)
+{
+	Uint i;
+
+	for (i = 0; i < n; i++)
+		dot[i] = a[i].x*b[i].x + a[i].y*b[i].y + a[i].z*b[i].z;
+}
+
+/* Compute the n cross products a[i] x b[i]. c may be the same as a or b. */
+void
+M_VectorCrossArr3_FPU(M_Vector3 *c, const M_Vector3 *a, const M_Vector3 *b,
+    Uint n)
+{
+	Uint i;
+
+	for (i = 0; i < n; i++) {
+		M_VectorReal x = a[i].y*b[i].z - b[i].y*a[i].z;
+		M_VectorReal y = a[i].z*b[i].x - b[i].z*a[i].x;
+		M_VectorReal z = a[i].x*b[i].y - b[i].x*a[i].y;
+
+		c[i].x = x;
+		c[i].y = y;
+		c[i].z = z;
+#ifdef HAVE_SSE
+		c[i]._pad = 0.0f;
+#endif
+	}
+}
+
+/* Normalize n vectors in place. Zero-length vectors are left unchanged. */
+void
+M_VectorNormArr3_FPU(M_Vector3 *v, Uint n)
+{
+	Uint i;
+
+	for (i = 0; i < n; i++) {
+		M_VectorReal len2 = v[i].x*v[i].x + v[i].y*v[i].y +
+		                    v[i].z*v[i].z;
+		M_VectorReal len;
+
+		if (len2 <= 0.0) {
+			continue;
+		}
+		len = (M_VectorReal)M_Sqrt(len2);
+		v[i].x /= len;
+		v[i].y /= len;
+		v[i].z /= len;
+	}
+}
+
+/*
+ * Compute the axis-aligned bounding box of n points. If n is 0, both
+ * vMin and vMax are set to the zero vector.
+ */
+void
+M_VectorBounds3_FPU(const M_Vector3 *v, Uint n, M_Vector3 *vMin,
+    M_Vector3 *vMax)
+{
+	M_Vector3 lo, hi;
+	Uint i;
+
+	if (n == 0) {
+		*vMin = M_VecZero3();
+		*vMax = M_VecZero3();
+		return;
+	}
+	lo = v[0];
+	hi = v[0];
+	for (i = 1; i < n; i++) {
+		if (v[i].x < lo.x) { lo.x = v[i].x; }
+		if (v[i].y < lo.y) { lo.y = v[i].y; }
+		if (v[i].z < lo.z) { lo.z = v[i].z; }
+		if (v[i].x > hi.x) { hi.x = v[i].x; }
+		if (v[i].y > hi.y) { hi.y = v[i].y; }
+		if (v[i].z > hi.z) { hi.z = v[i].z; }
+	}
+	*vMin = lo;
+	*vMax = hi;
+}
+
+/*
+ * Structure-of-arrays variants. The output set must have been sized
+ * (with M_VectorSoAResize3()) to hold at least as many vectors as the input.
+ */
+void
+M_VectorTransformPointsSoA3_FPU(M_VectorSoA3 *Sout, const M_Matrix44 *A,
+    const M_VectorSoA3 *Sin)
+{
+	Uint i;
+
+	for (i = 0; i < Sin->n; i++) {
+		M_VectorReal x = Sin->x[i];
+		M_VectorReal y = Sin->y[i];
+		M_VectorReal z = Sin->z[i];
+
+		Sout->x[i] = A->m[0][0]*x + A->m[0][1]*y + A->m[0][2]*z +
+		             A->m[0][3];
+		Sout->y[i] = A->m[1][0]*x + A->m[1][1]*y + A->m[1][2]*z +
+		             A->m[1][3];
+		Sout->z[i] = A->m[2][0]*x + A->m[2][1]*y + A->m[2][2]*z +
+		             A->m[2][3];
+	}
+	Sout->n = Sin->n;
+}
+
+void
+M_VectorDotSoA3_FPU(M_VectorReal *dot, const M_VectorSoA3 *Sa,
+    const M_VectorSoA3 *Sb)
+{
+	Uint i;
+
+	for (i = 0; i < Sa->n; i++)
+		dot[i] = Sa->x[i]*Sb->x[i] + Sa->y[i]*Sb->y[i] +
+		         Sa->z[i]*Sb->z[i];
+}
+
+void
+M_VectorCrossSoA3_FPU(M_VectorSoA3 *Sc, const M_VectorSoA3 *Sa,
+    const M_VectorSoA3 *Sb)
+{
+	Uint i;
+
+	for (i = 0; i < Sa->n; i++) {
+		M_VectorReal x = Sa->y[i]*Sb->z[i] - Sb->y[i]*Sa->z[i];
+		M_VectorReal y = Sa->z[i]*Sb->x[i] - Sb->z[i]*Sa->x[i];
+		M_VectorReal z = Sa->x[i]*Sb->y[i] - Sb->x[i]*Sa->y[i];
+
+		Sc->x[i] = x;
+		Sc->y[i] = y;
+		Sc->z[i] = z;
+	}
+	Sc->n = Sa->n;
+}
+
+void
+M_VectorNormSoA3_FPU(M_VectorSoA3 *S)
+{
+	Uint i;
+
+	for (i = 0; i < S->n; i++) {
+		M_VectorReal len2 = S->x[i]*S->x[i] + S->y[i]*S->y[i] +
+		                    S->z[i]*S->z[i];
+		M_VectorReal len;
+
+		if (len2 <= 0.0) {
+			continue;
+		}
+		len = (M_VectorReal)M_Sqrt(len2);
+		S->x[i] /= len;
+		S->y[i] /= len;
+		S->z[i] /= len;
+	}
+}
+
+void
+M_VectorBoundsSoA3_FPU(const M_VectorSoA3 *S, M_Vector3 *vMin,
+    M_Vector3 *vMax)
+{
+	M_VectorReal lo[3], hi[3];
+	Uint i;
+
+	if (S->n == 0) {
+		*vMin = M_VecZero3();
+		*vMax = M_VecZero3();
+		return;
+	}
+	lo[0] = hi[0] = S->x[0];
+	lo[1] = hi[1] = S->y[0];
+	lo[2] = hi[2] = S->z[0];
+	for (i = 1; i < S->n; i++) {
+		if (S->x[i] < lo[0]) { lo[0] = S->x[i]; }
+		if (S->y[i] < lo[1]) { lo[1] = S->y[i]; }
+		if (S->z[i] < lo[2]) { lo[2] = S->z[i]; }
+		if (S->x[i] > hi[0]) { hi[0] = S->x[i]; }
+		if (S->y[i] > hi[1]) { hi[1] = S->y[i]; }
+		if (S->z[i] > hi[2]) { hi[2] = S->z[i]; }
+	}
+	*vMin = M_VecGet3(lo[0], lo[1], lo[2]);
+	*vMax = M_VecGet3(hi[0], hi[1], hi[2]);
+}
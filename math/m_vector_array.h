@@ -0,0 +1,121 @@
+/*	Public domain	*/
+
+/*
+ * Batched operations over arrays of vectors in R^3 and R^4, in both the
+ * array-of-structures (M_Vector3[], M_Vector4[]) and structure-of-arrays
+ * (M_VectorSoA3) layouts.
+ */
+
+/* AVX2 kernels are compiled with per-function target attributes. */
+#if defined(HAVE_SSE) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+# define M_HAVE_AVX2_KERNELS
+#endif
+
+/*
+ * Element type of M_Vector3 and M_Vector4. SIMD extensions force
+ * single-precision floats, regardless of the precision of M_Real.
+ */
+#ifdef HAVE_SSE
+typedef float M_VectorReal;
+#else
+typedef M_Real M_VectorReal;
+#endif
+
+/* Set of n vectors in R^3, in structure-of-arrays representation. */
+typedef struct m_vector_soa3 {
+	Uint n;				/* Number of vectors */
+	Uint maxn;			/* Allocated length of arrays */
+	M_VectorReal *_Nullable x;	/* X components */
+	M_VectorReal *_Nullable y;	/* Y components */
+	M_VectorReal *_Nullable z;	/* Z components */
+} M_VectorSoA3;
+
+/* Batched operations on arrays of vectors */
+typedef struct m_vector_array_ops {
+	const char *_Nonnull name;
+
+	/* Array-of-structures */
+	void (*_Nonnull TransformPoints3)(M_Vector3 *_Nonnull,
+	                                  const M_Matrix44 *_Nonnull,
+	                                  const M_Vector3 *_Nonnull, Uint);
+	void (*_Nonnull Transform4)(M_Vector4 *_Nonnull,
+	                            const M_Matrix44 *_Nonnull,
+	                            const M_Vector4 *_Nonnull, Uint);
+	void (*_Nonnull Dot3)(M_VectorReal *_Nonnull, const M_Vector3 *_Nonnull,
+	                      const M_Vector3 *_Nonnull, Uint);
+	void (*_Nonnull Cross3)(M_Vector3 *_Nonnull, const M_Vector3 *_Nonnull,
+	                        const M_Vector3 *_Nonnull, Uint);
+	void (*_Nonnull Norm3)(M_Vector3 *_Nonnull, Uint);
+	void (*_Nonnull Bounds3)(const M_Vector3 *_Nonnull, Uint,
+	                         M_Vector3 *_Nonnull, M_Vector3 *_Nonnull);
+
+	/* Structure-of-arrays */
+	void (*_Nonnull TransformPointsSoA3)(M_VectorSoA3 *_Nonnull,
+	                                     const M_Matrix44 *_Nonnull,
+	                                     const M_VectorSoA3 *_Nonnull);
+	void (*_Nonnull DotSoA3)(M_VectorReal *_Nonnull,
+	                         const M_VectorSoA3 *_Nonnull,
+	                         const M_VectorSoA3 *_Nonnull);
+	void (*_Nonnull CrossSoA3)(M_VectorSoA3 *_Nonnull,
+	                           const M_VectorSoA3 *_Nonnull,
+	                           const M_VectorSoA3 *_Nonnull);
+	void (*_Nonnull NormSoA3)(M_VectorSoA3 *_Nonnull);
+	void (*_Nonnull BoundsSoA3)(const M_VectorSoA3 *_Nonnull,
+	                            M_Vector3 *_Nonnull, M_Vector3 *_Nonnull);
+} M_VectorArrayOps;
+
+__BEGIN_DECLS
+extern const M_VectorArrayOps *_Nullable mVecArrOps;
+extern const M_VectorArrayOps mVecArrOps_FPU;
+#ifdef HAVE_SSE
+extern const M_VectorArrayOps mVecArrOps_SSE;
+#endif
+#ifdef M_HAVE_AVX2_KERNELS
+extern const M_VectorArrayOps mVecArrOps_AVX2;
+#endif
+
+void M_VectorSoAInit3(M_VectorSoA3 *_Nonnull);
+int  M_VectorSoAResize3(M_VectorSoA3 *_Nonnull, Uint);
+void M_VectorSoAFree3(M_VectorSoA3 *_Nonnull);
+int  M_VectorToSoA3(M_VectorSoA3 *_Nonnull, const M_Vector3 *_Nonnull, Uint);
+void M_VectorFromSoA3(M_Vector3 *_Nonnull, const M_VectorSoA3 *_Nonnull);
+
+void M_VectorTransformPoints3_FPU(M_Vector3 *_Nonnull,
+                                  const M_Matrix44 *_Nonnull,
+                                  const M_Vector3 *_Nonnull, Uint);
+void M_VectorTransform4_FPU(M_Vector4 *_Nonnull, const M_Matrix44 *_Nonnull,
+                            const M_Vector4 *_Nonnull, Uint);
+void M_VectorDotArr3_FPU(M_VectorReal *_Nonnull, const M_Vector3 *_Nonnull,
+                         const M_Vector3 *_Nonnull, Uint);
+void M_VectorCrossArr3_FPU(M_Vector3 *_Nonnull, const M_Vector3 *_Nonnull,
+                           const M_Vector3 *_Nonnull, Uint);
+void M_VectorNormArr3_FPU(M_Vector3 *_Nonnull, Uint);
+void M_VectorBounds3_FPU(const M_Vector3 *_Nonnull, Uint,
+                         M_Vector3 *_Nonnull, M_Vector3 *_Nonnull);
+void M_VectorTransformPointsSoA3_FPU(M_VectorSoA3 *_Nonnull,
+                                     const M_Matrix44 *_Nonnull,
+                                     const M_VectorSoA3 *_Nonnull);
+void M_VectorDotSoA3_FPU(M_VectorReal *_Nonnull, const M_VectorSoA3 *_Nonnull,
+                         const M_VectorSoA3 *_Nonnull);
+void M_VectorCrossSoA3_FPU(M_VectorSoA3 *_Nonnull, const M_VectorSoA3 *_Nonnull,
+                           const M_VectorSoA3 *_Nonnull);
+void M_VectorNormSoA3_FPU(M_VectorSoA3 *_Nonnull);
+void M_VectorBoundsSoA3_FPU(const M_VectorSoA3 *_Nonnull,
+                            M_Vector3 *_Nonnull, M_Vector3 *_Nonnull);
+__END_DECLS
+
+/*
+ * Batched operations on arrays of vectors
+ */
+#define M_VecTransformPoints3	mVecArrOps->TransformPoints3
+#define M_VecTransform4		mVecArrOps->Transform4
+#define M_VecDotArr3		mVecArrOps->Dot3
+#define M_VecCrossArr3		mVecArrOps->Cross3
+#define M_VecNormArr3		mVecArrOps->Norm3
+#define M_VecBounds3		mVecArrOps->Bounds3
+#define M_VecTransformPointsSoA3 mVecArrOps->TransformPointsSoA3
+#define M_VecDotSoA3		mVecArrOps->DotSoA3
+#define M_VecCrossSoA3		mVecArrOps->CrossSoA3
+#define M_VecNormSoA3		mVecArrOps->NormSoA3
+#define M_VecBoundsSoA3		mVecArrOps->BoundsSoA3
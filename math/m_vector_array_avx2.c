@@ -0,0 +1,423 @@
+/*	Public domain	*/
+/*
+ * Batched operations on arrays of vectors using AVX2 extensions.
+ *
+ * These routines are compiled with per-function target attributes (the rest
+ * of ag_math only assumes SSE), and are only selected by M_VectorInitEngine()
+ * if the CPU and operating system report AVX2 support at runtime.
+ * Remainders which do not fill a complete register are handed off to the
+ * scalar routines.
+ */
+
+#include <agar/core/core.h>
+#include <agar/math/m.h>
+
+#ifdef M_HAVE_AVX2_KERNELS
+
+#include <immintrin.h>
+
+#define M_AVX2 __attribute__((__target__("avx2")))
+
+static void TransformPoints3_AVX2(M_Vector3 *_Nonnull, const M_Matrix44 *_Nonnull,
+                                  const M_Vector3 *_Nonnull, Uint) M_AVX2;
+static void Transform4_AVX2(M_Vector4 *_Nonnull, const M_Matrix44 *_Nonnull,
+                            const M_Vector4 *_Nonnull, Uint) M_AVX2;
+static void DotArr3_AVX2(float *_Nonnull, const M_Vector3 *_Nonnull,
+                         const M_Vector3 *_Nonnull, Uint) M_AVX2;
+static void CrossArr3_AVX2(M_Vector3 *_Nonnull, const M_Vector3 *_Nonnull,
+                           const M_Vector3 *_Nonnull, Uint) M_AVX2;
+static void NormArr3_AVX2(M_Vector3 *_Nonnull, Uint) M_AVX2;
+static void Bounds3_AVX2(const M_Vector3 *_Nonnull, Uint, M_Vector3 *_Nonnull,
+                         M_Vector3 *_Nonnull) M_AVX2;
+static void TransformPointsSoA3_AVX2(M_VectorSoA3 *_Nonnull,
+                                     const M_Matrix44 *_Nonnull,
+                                     const M_VectorSoA3 *_Nonnull) M_AVX2;
+static void DotSoA3_AVX2(float *_Nonnull, const M_VectorSoA3 *_Nonnull,
+                         const M_VectorSoA3 *_Nonnull) M_AVX2;
+static void CrossSoA3_AVX2(M_VectorSoA3 *_Nonnull, const M_VectorSoA3 *_Nonnull,
+                           const M_VectorSoA3 *_Nonnull) M_AVX2;
+static void NormSoA3_AVX2(M_VectorSoA3 *_Nonnull) M_AVX2;
+static void BoundsSoA3_AVX2(const M_VectorSoA3 *_Nonnull, M_Vector3 *_Nonnull,
+                            M_Vector3 *_Nonnull) M_AVX2;
+
+const M_VectorArrayOps mVecArrOps_AVX2 = {
+	"avx2",
+	TransformPoints3_AVX2,
+	Transform4_AVX2,
+	DotArr3_AVX2,
+	CrossArr3_AVX2,
+	NormArr3_AVX2,
+	Bounds3_AVX2,
+	TransformPointsSoA3_AVX2,
+	DotSoA3_AVX2,
+	CrossSoA3_AVX2,
+	NormSoA3_AVX2,
+	BoundsSoA3_AVX2
+};
+
+/* View of the n vectors of a structure-of-arrays set starting at i. */
+static __inline__ void
+SubSoA3(M_VectorSoA3 *_Nonnull Ssub, const M_VectorSoA3 *_Nonnull S, Uint i,
+    Uint n)
+{
+	Ssub->n = n;
+	Ssub->maxn = n;
+	Ssub->x = &S->x[i];
+	Ssub->y = &S->y[i];
+	Ssub->z = &S->z[i];
+}
+
+/*
+ * Array-of-structures: each 256-bit register holds two consecutive
+ * M_Vector3 or M_Vector4 (one per 128-bit lane).
+ */
+static void
+TransformPoints3_AVX2(M_Vector3 *vOut, const M_Matrix44 *A,
+    const M_Vector3 *vIn, Uint n)
+{
+	__m256 c0, c1, c2, c3, v, r;
+	__m128 c;
+	Uint i;
+
+	c = _mm_set_ps(0.0f, A->m[2][0], A->m[1][0], A->m[0][0]);
+	c0 = _mm256_broadcast_ps(&c);
+	c = _mm_set_ps(0.0f, A->m[2][1], A->m[1][1], A->m[0][1]);
+	c1 = _mm256_broadcast_ps(&c);
+	c = _mm_set_ps(0.0f, A->m[2][2], A->m[1][2], A->m[0][2]);
+	c2 = _mm256_broadcast_ps(&c);
+	c = _mm_set_ps(0.0f, A->m[2][3], A->m[1][3], A->m[0][3]);
+	c3 = _mm256_broadcast_ps(&c);
+
+	for (i = 0; i+2 <= n; i += 2) {
+		v = _mm256_loadu_ps(&vIn[i].x);
+		r = _mm256_add_ps(
+		    _mm256_add_ps(
+		        _mm256_mul_ps(c0, _mm256_permute_ps(v, 0x00)),
+		        _mm256_mul_ps(c1, _mm256_permute_ps(v, 0x55))),
+		    _mm256_add_ps(
+		        _mm256_mul_ps(c2, _mm256_permute_ps(v, 0xaa)),
+		        c3));
+		_mm256_storeu_ps(&vOut[i].x, r);
+	}
+	if (i < n)
+		M_VectorTransformPoints3_FPU(&vOut[i], A, &vIn[i], n-i);
+}
+
+static void
+Transform4_AVX2(M_Vector4 *vOut, const M_Matrix44 *A, const M_Vector4 *vIn,
+    Uint n)
+{
+	__m256 c0, c1, c2, c3, v, r;
+	__m128 c;
+	Uint i;
+
+	c = _mm_set_ps(A->m[3][0], A->m[2][0], A->m[1][0], A->m[0][0]);
+	c0 = _mm256_broadcast_ps(&c);
+	c = _mm_set_ps(A->m[3][1], A->m[2][1], A->m[1][1], A->m[0][1]);
+	c1 = _mm256_broadcast_ps(&c);
+	c = _mm_set_ps(A->m[3][2], A->m[2][2], A->m[1][2], A->m[0][2]);
+	c2 = _mm256_broadcast_ps(&c);
+	c = _mm_set_ps(A->m[3][3], A->m[2][3], A->m[1][3], A->m[0][3]);
+	c3 = _mm256_broadcast_ps(&c);
+
+	for (i = 0; i+2 <= n; i += 2) {
+		v = _mm256_loadu_ps(&vIn[i].x);
+		r = _mm256_add_ps(
+		    _mm256_add_ps(
+		        _mm256_mul_ps(c0, _mm256_permute_ps(v, 0x00)),
+		        _mm256_mul_ps(c1, _mm256_permute_ps(v, 0x55))),
+		    _mm256_add_ps(
+		        _mm256_mul_ps(c2, _mm256_permute_ps(v, 0xaa)),
+		        _mm256_mul_ps(c3, _mm256_permute_ps(v, 0xff))));
+		_mm256_storeu_ps(&vOut[i].x, r);
+	}
+	if (i < n)
+		M_VectorTransform4_FPU(&vOut[i], A, &vIn[i], n-i);
+}
+
+static void
+DotArr3_AVX2(float *dot, const M_Vector3 *a, const M_Vector3 *b, Uint n)
+{
+	const __m256 xyz = _mm256_castsi256_ps(
+	    _mm256_set_epi32(0,-1,-1,-1, 0,-1,-1,-1));
+	const __m256i order = _mm256_set_epi32(7,3,6,2,5,1,4,0);
+	__m256 r0, r1, r2, r3;
+	Uint i;
+
+	for (i = 0; i+8 <= n; i += 8) {
+		r0 = _mm256_and_ps(xyz, _mm256_mul_ps(
+		    _mm256_loadu_ps(&a[i  ].x), _mm256_loadu_ps(&b[i  ].x)));
+		r1 = _mm256_and_ps(xyz, _mm256_mul_ps(
+		    _mm256_loadu_ps(&a[i+2].x), _mm256_loadu_ps(&b[i+2].x)));
+		r2 = _mm256_and_ps(xyz, _mm256_mul_ps(
+		    _mm256_loadu_ps(&a[i+4].x), _mm256_loadu_ps(&b[i+4].x)));
+		r3 = _mm256_and_ps(xyz, _mm256_mul_ps(
+		    _mm256_loadu_ps(&a[i+6].x), _mm256_loadu_ps(&b[i+6].x)));
+
+		/* Lanes now hold [d0 d2 d4 d6 | d1 d3 d5 d7]; interleave. */
+		r0 = _mm256_hadd_ps(_mm256_hadd_ps(r0, r1),
+		                    _mm256_hadd_ps(r2, r3));
+		_mm256_storeu_ps(&dot[i], _mm256_permutevar8x32_ps(r0, order));
+	}
+	if (i < n)
+		M_VectorDotArr3_FPU(&dot[i], &a[i], &b[i], n-i);
+}
+
+static void
+CrossArr3_AVX2(M_Vector3 *c, const M_Vector3 *a, const M_Vector3 *b, Uint n)
+{
+	const __m256 xyz = _mm256_castsi256_ps(
+	    _mm256_set_epi32(0,-1,-1,-1, 0,-1,-1,-1));
+	__m256 va, vb, r;
+	Uint i;
+
+	for (i = 0; i+2 <= n; i += 2) {
+		va = _mm256_loadu_ps(&a[i].x);
+		vb = _mm256_loadu_ps(&b[i].x);
+		r = _mm256_sub_ps(
+		    _mm256_mul_ps(va, _mm256_permute_ps(vb, _MM_SHUFFLE(3,0,2,1))),
+		    _mm256_mul_ps(_mm256_permute_ps(va, _MM_SHUFFLE(3,0,2,1)), vb));
+		r = _mm256_permute_ps(r, _MM_SHUFFLE(3,0,2,1));
+		_mm256_storeu_ps(&c[i].x, _mm256_and_ps(xyz, r));
+	}
+	if (i < n)
+		M_VectorCrossArr3_FPU(&c[i], &a[i], &b[i], n-i);
+}
+
+static void
+NormArr3_AVX2(M_Vector3 *v, Uint n)
+{
+	const __m256 xyz = _mm256_castsi256_ps(
+	    _mm256_set_epi32(0,-1,-1,-1, 0,-1,-1,-1));
+	const __m256 one = _mm256_set1_ps(1.0f);
+	__m256 p, len2, len;
+	Uint i;
+
+	for (i = 0; i+2 <= n; i += 2) {
+		p = _mm256_loadu_ps(&v[i].x);
+		len2 = _mm256_and_ps(xyz, _mm256_mul_ps(p, p));
+		len2 = _mm256_hadd_ps(len2, len2);
+		len2 = _mm256_hadd_ps(len2, len2);	/* Broadcast per lane */
+
+		/* Divide zero-length vectors by 1 (leave them unchanged). */
+		len = _mm256_blendv_ps(one, _mm256_sqrt_ps(len2),
+		    _mm256_cmp_ps(len2, _mm256_setzero_ps(), _CMP_GT_OQ));
+		_mm256_storeu_ps(&v[i].x, _mm256_div_ps(p, len));
+	}
+	if (i < n)
+		M_VectorNormArr3_FPU(&v[i], n-i);
+}
+
+static void
+Bounds3_AVX2(const M_Vector3 *v, Uint n, M_Vector3 *vMin, M_Vector3 *vMax)
+{
+	__m256 lo, hi, p;
+	Uint i;
+
+	if (n < 2) {
+		M_VectorBounds3_FPU(v, n, vMin, vMax);
+		return;
+	}
+	lo = hi = _mm256_loadu_ps(&v[0].x);
+	for (i = 2; i+2 <= n; i += 2) {
+		p = _mm256_loadu_ps(&v[i].x);
+		lo = _mm256_min_ps(lo, p);
+		hi = _mm256_max_ps(hi, p);
+	}
+	vMin->m128 = _mm_min_ps(_mm256_castps256_ps128(lo),
+	                        _mm256_extractf128_ps(lo, 1));
+	vMax->m128 = _mm_max_ps(_mm256_castps256_ps128(hi),
+	                        _mm256_extractf128_ps(hi, 1));
+	if (i < n) {
+		vMin->m128 = _mm_min_ps(vMin->m128, v[i].m128);
+		vMax->m128 = _mm_max_ps(vMax->m128, v[i].m128);
+	}
+	vMin->_pad = 0.0f;
+	vMax->_pad = 0.0f;
+}
+
+/*
+ * Structure-of-arrays: each 256-bit register holds one component of
+ * eight consecutive vectors.
+ */
+static void
+TransformPointsSoA3_AVX2(M_VectorSoA3 *Sout, const M_Matrix44 *A,
+    const M_VectorSoA3 *Sin)
+{
+	__m256 a[3][4], x, y, z;
+	Uint i, j, k;
+
+	for (j = 0; j < 3; j++) {
+		for (k = 0; k < 4; k++)
+			a[j][k] = _mm256_set1_ps(A->m[j][k]);
+	}
+	for (i = 0; i+8 <= Sin->n; i += 8) {
+		x = _mm256_loadu_ps(&Sin->x[i]);
+		y = _mm256_loadu_ps(&Sin->y[i]);
+		z = _mm256_loadu_ps(&Sin->z[i]);
+		_mm256_storeu_ps(&Sout->x[i], _mm256_add_ps(
+		    _mm256_add_ps(_mm256_mul_ps(a[0][0],x), _mm256_mul_ps(a[0][1],y)),
+		    _mm256_add_ps(_mm256_mul_ps(a[0][2],z), a[0][3])));
+		_mm256_storeu_ps(&Sout->y[i], _mm256_add_ps(
+		    _mm256_add_ps(_mm256_mul_ps(a[1][0],x), _mm256_mul_ps(a[1][1],y)),
+		    _mm256_add_ps(_mm256_mul_ps(a[1][2],z), a[1][3])));
+		_mm256_storeu_ps(&Sout->z[i], _mm256_add_ps(
+		    _mm256_add_ps(_mm256_mul_ps(a[2][0],x), _mm256_mul_ps(a[2][1],y)),
+		    _mm256_add_ps(_mm256_mul_ps(a[2][2],z), a[2][3])));
+	}
+	if (i < Sin->n) {
+		M_VectorSoA3 SinRem, SoutRem;
+
+		SubSoA3(&SinRem, Sin, i, Sin->n - i);
+		SubSoA3(&SoutRem, Sout, i, Sin->n - i);
+		M_VectorTransformPointsSoA3_FPU(&SoutRem, A, &SinRem);
+	}
+	Sout->n = Sin->n;
+}
+
+static void
+DotSoA3_AVX2(float *dot, const M_VectorSoA3 *Sa, const M_VectorSoA3 *Sb)
+{
+	Uint i;
+
+	for (i = 0; i+8 <= Sa->n; i += 8) {
+		_mm256_storeu_ps(&dot[i], _mm256_add_ps(
+		    _mm256_add_ps(
+		        _mm256_mul_ps(_mm256_loadu_ps(&Sa->x[i]),
+		                      _mm256_loadu_ps(&Sb->x[i])),
+		        _mm256_mul_ps(_mm256_loadu_ps(&Sa->y[i]),
+		                      _mm256_loadu_ps(&Sb->y[i]))),
+		    _mm256_mul_ps(_mm256_loadu_ps(&Sa->z[i]),
+		                  _mm256_loadu_ps(&Sb->z[i]))));
+	}
+	if (i < Sa->n) {
+		M_VectorSoA3 SaRem, SbRem;
+
+		SubSoA3(&SaRem, Sa, i, Sa->n - i);
+		SubSoA3(&SbRem, Sb, i, Sa->n - i);
+		M_VectorDotSoA3_FPU(&dot[i], &SaRem, &SbRem);
+	}
+}
+
+static void
+CrossSoA3_AVX2(M_VectorSoA3 *Sc, const M_VectorSoA3 *Sa,
+    const M_VectorSoA3 *Sb)
+{
+	__m256 ax, ay, az, bx, by, bz;
+	Uint i;
+
+	for (i = 0; i+8 <= Sa->n; i += 8) {
+		ax = _mm256_loadu_ps(&Sa->x[i]);
+		ay = _mm256_loadu_ps(&Sa->y[i]);
+		az = _mm256_loadu_ps(&Sa->z[i]);
+		bx = _mm256_loadu_ps(&Sb->x[i]);
+		by = _mm256_loadu_ps(&Sb->y[i]);
+		bz = _mm256_loadu_ps(&Sb->z[i]);
+		_mm256_storeu_ps(&Sc->x[i],
+		    _mm256_sub_ps(_mm256_mul_ps(ay,bz), _mm256_mul_ps(by,az)));
+		_mm256_storeu_ps(&Sc->y[i],
+		    _mm256_sub_ps(_mm256_mul_ps(az,bx), _mm256_mul_ps(bz,ax)));
+		_mm256_storeu_ps(&Sc->z[i],
+		    _mm256_sub_ps(_mm256_mul_ps(ax,by), _mm256_mul_ps(bx,ay)));
+	}
+	if (i < Sa->n) {
+		M_VectorSoA3 SaRem, SbRem, ScRem;
+
+		SubSoA3(&SaRem, Sa, i, Sa->n - i);
+		SubSoA3(&SbRem, Sb, i, Sa->n - i);
+		SubSoA3(&ScRem, Sc, i, Sa->n - i);
+		M_VectorCrossSoA3_FPU(&ScRem, &SaRem, &SbRem);
+	}
+	Sc->n = Sa->n;
+}
+
+static void
+NormSoA3_AVX2(M_VectorSoA3 *S)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	__m256 x, y, z, len2, len;
+	Uint i;
+
+	for (i = 0; i+8 <= S->n; i += 8) {
+		x = _mm256_loadu_ps(&S->x[i]);
+		y = _mm256_loadu_ps(&S->y[i]);
+		z = _mm256_loadu_ps(&S->z[i]);
+		len2 = _mm256_add_ps(
+		    _mm256_add_ps(_mm256_mul_ps(x,x), _mm256_mul_ps(y,y)),
+		    _mm256_mul_ps(z,z));
+		len = _mm256_blendv_ps(one, _mm256_sqrt_ps(len2),
+		    _mm256_cmp_ps(len2, _mm256_setzero_ps(), _CMP_GT_OQ));
+		_mm256_storeu_ps(&S->x[i], _mm256_div_ps(x, len));
+		_mm256_storeu_ps(&S->y[i], _mm256_div_ps(y, len));
+		_mm256_storeu_ps(&S->z[i], _mm256_div_ps(z, len));
+	}
+	if (i < S->n) {
+		M_VectorSoA3 SRem;
+
+		SubSoA3(&SRem, S, i, S->n - i);
+		M_VectorNormSoA3_FPU(&SRem);
+	}
+}
+
+/* Reduce the eight lanes of a register to their minimum or maximum. */
+static __inline__ float M_AVX2
+ReduceMin8(__m256 v)
+{
+	__m128 r;
+
+	r = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	r = _mm_min_ps(r, _mm_movehl_ps(r, r));
+	r = _mm_min_ss(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1,1,1,1)));
+	return _mm_cvtss_f32(r);
+}
+static __inline__ float M_AVX2
+ReduceMax8(__m256 v)
+{
+	__m128 r;
+
+	r = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	r = _mm_max_ps(r, _mm_movehl_ps(r, r));
+	r = _mm_max_ss(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1,1,1,1)));
+	return _mm_cvtss_f32(r);
+}
+
+static void
+BoundsSoA3_AVX2(const M_VectorSoA3 *S, M_Vector3 *vMin, M_Vector3 *vMax)
+{
+	__m256 lo[3], hi[3], t;
+	M_Vector3 remMin, remMax;
+	Uint i;
+
+	if (S->n < 8) {
+		M_VectorBoundsSoA3_FPU(S, vMin, vMax);
+		return;
+	}
+	lo[0] = hi[0] = _mm256_loadu_ps(&S->x[0]);
+	lo[1] = hi[1] = _mm256_loadu_ps(&S->y[0]);
+	lo[2] = hi[2] = _mm256_loadu_ps(&S->z[0]);
+	for (i = 8; i+8 <= S->n; i += 8) {
+		t = _mm256_loadu_ps(&S->x[i]);
+		lo[0] = _mm256_min_ps(lo[0], t);
+		hi[0] = _mm256_max_ps(hi[0], t);
+		t = _mm256_loadu_ps(&S->y[i]);
+		lo[1] = _mm256_min_ps(lo[1], t);
+		hi[1] = _mm256_max_ps(hi[1], t);
+		t = _mm256_loadu_ps(&S->z[i]);
+		lo[2] = _mm256_min_ps(lo[2], t);
+		hi[2] = _mm256_max_ps(hi[2], t);
+	}
+	vMin->m128 = _mm_set_ps(0.0f, ReduceMin8(lo[2]), ReduceMin8(lo[1]),
+	                        ReduceMin8(lo[0]));
+	vMax->m128 = _mm_set_ps(0.0f, ReduceMax8(hi[2]), ReduceMax8(hi[1]),
+	                        ReduceMax8(hi[0]));
+	if (i < S->n) {
+		M_VectorSoA3 SRem;
+
+		SubSoA3(&SRem, S, i, S->n - i);
+		M_VectorBoundsSoA3_FPU(&SRem, &remMin, &remMax);
+		vMin->m128 = _mm_min_ps(vMin->m128, remMin.m128);
+		vMax->m128 = _mm_max_ps(vMax->m128, remMax.m128);
+	}
+}
+
+#endif /* M_HAVE_AVX2_KERNELS */
@@ -0,0 +1,362 @@
+/*	Public domain	*/
+/*
+ * Batched operations on arrays of vectors using Streaming SIMD Extensions.
+ * Remainders which do not fill a complete register are handed off to the
+ * scalar routines.
+ */
+
+#include <agar/config/have_sse.h>
+#ifdef HAVE_SSE
+
+#include <agar/core/core.h>
+#include <agar/math/m.h>
+
+static void TransformPoints3_SSE(M_Vector3 *_Nonnull, const M_Matrix44 *_Nonnull,
+                                 const M_Vector3 *_Nonnull, Uint);
+static void Transform4_SSE(M_Vector4 *_Nonnull, const M_Matrix44 *_Nonnull,
+                           const M_Vector4 *_Nonnull, Uint);
+static void DotArr3_SSE(float *_Nonnull, const M_Vector3 *_Nonnull,
+                        const M_Vector3 *_Nonnull, Uint);
+static void CrossArr3_SSE(M_Vector3 *_Nonnull, const M_Vector3 *_Nonnull,
+                          const M_Vector3 *_Nonnull, Uint);
+static void NormArr3_SSE(M_Vector3 *_Nonnull, Uint);
+static void Bounds3_SSE(const M_Vector3 *_Nonnull, Uint, M_Vector3 *_Nonnull,
+                        M_Vector3 *_Nonnull);
+static void TransformPointsSoA3_SSE(M_VectorSoA3 *_Nonnull,
+                                    const M_Matrix44 *_Nonnull,
+                                    const M_VectorSoA3 *_Nonnull);
+static void DotSoA3_SSE(float *_Nonnull, const M_VectorSoA3 *_Nonnull,
+                        const M_VectorSoA3 *_Nonnull);
+static void CrossSoA3_SSE(M_VectorSoA3 *_Nonnull, const M_VectorSoA3 *_Nonnull,
+                          const M_VectorSoA3 *_Nonnull);
+static void NormSoA3_SSE(M_VectorSoA3 *_Nonnull);
+static void BoundsSoA3_SSE(const M_VectorSoA3 *_Nonnull, M_Vector3 *_Nonnull,
+                           M_Vector3 *_Nonnull);
+
+const M_VectorArrayOps mVecArrOps_SSE = {
+	"sse",
+	TransformPoints3_SSE,
+	Transform4_SSE,
+	DotArr3_SSE,
+	CrossArr3_SSE,
+	NormArr3_SSE,
+	Bounds3_SSE,
+	TransformPointsSoA3_SSE,
+	DotSoA3_SSE,
+	CrossSoA3_SSE,
+	NormSoA3_SSE,
+	BoundsSoA3_SSE
+};
+
+/* View of the n vectors of a structure-of-arrays set starting at i. */
+static __inline__ void
+SubSoA3(M_VectorSoA3 *_Nonnull Ssub, const M_VectorSoA3 *_Nonnull S, Uint i,
+    Uint n)
+{
+	Ssub->n = n;
+	Ssub->maxn = n;
+	Ssub->x = &S->x[i];
+	Ssub->y = &S->y[i];
+	Ssub->z = &S->z[i];
+}
+
+static void
+TransformPoints3_SSE(M_Vector3 *vOut, const M_Matrix44 *A, const M_Vector3 *vIn,
+    Uint n)
+{
+	__m128 c0, c1, c2, c3, v, r;
+	Uint i;
+
+	/* Columns of the upper 3x4 part of A (last row is ignored). */
+	c0 = _mm_set_ps(0.0f, A->m[2][0], A->m[1][0], A->m[0][0]);
+	c1 = _mm_set_ps(0.0f, A->m[2][1], A->m[1][1], A->m[0][1]);
+	c2 = _mm_set_ps(0.0f, A->m[2][2], A->m[1][2], A->m[0][2]);
+	c3 = _mm_set_ps(0.0f, A->m[2][3], A->m[1][3], A->m[0][3]);
+
+	for (i = 0; i < n; i++) {
+		v = vIn[i].m128;
+		r = _mm_add_ps(
+		    _mm_add_ps(
+		        _mm_mul_ps(c0, _mm_shuffle_ps(v,v,_MM_SHUFFLE(0,0,0,0))),
+		        _mm_mul_ps(c1, _mm_shuffle_ps(v,v,_MM_SHUFFLE(1,1,1,1)))),
+		    _mm_add_ps(
+		        _mm_mul_ps(c2, _mm_shuffle_ps(v,v,_MM_SHUFFLE(2,2,2,2))),
+		        c3));
+		vOut[i].m128 = r;
+	}
+}
+
+static void
+Transform4_SSE(M_Vector4 *vOut, const M_Matrix44 *A, const M_Vector4 *vIn,
+    Uint n)
+{
+	__m128 c0, c1, c2, c3, v, r;
+	Uint i;
+
+	c0 = _mm_set_ps(A->m[3][0], A->m[2][0], A->m[1][0], A->m[0][0]);
+	c1 = _mm_set_ps(A->m[3][1], A->m[2][1], A->m[1][1], A->m[0][1]);
+	c2 = _mm_set_ps(A->m[3][2], A->m[2][2], A->m[1][2], A->m[0][2]);
+	c3 = _mm_set_ps(A->m[3][3], A->m[2][3], A->m[1][3], A->m[0][3]);
+
+	for (i = 0; i < n; i++) {
+		v = vIn[i].m128;
+		r = _mm_add_ps(
+		    _mm_add_ps(
+		        _mm_mul_ps(c0, _mm_shuffle_ps(v,v,_MM_SHUFFLE(0,0,0,0))),
+		        _mm_mul_ps(c1, _mm_shuffle_ps(v,v,_MM_SHUFFLE(1,1,1,1)))),
+		    _mm_add_ps(
+		        _mm_mul_ps(c2, _mm_shuffle_ps(v,v,_MM_SHUFFLE(2,2,2,2))),
+		        _mm_mul_ps(c3, _mm_shuffle_ps(v,v,_MM_SHUFFLE(3,3,3,3)))));
+		vOut[i].m128 = r;
+	}
+}
+
+static void
+DotArr3_SSE(float *dot, const M_Vector3 *a, const M_Vector3 *b, Uint n)
+{
+	__m128 r0, r1, r2, r3;
+	Uint i;
+
+	for (i = 0; i+4 <= n; i += 4) {
+		r0 = _mm_mul_ps(a[i  ].m128, b[i  ].m128);
+		r1 = _mm_mul_ps(a[i+1].m128, b[i+1].m128);
+		r2 = _mm_mul_ps(a[i+2].m128, b[i+2].m128);
+		r3 = _mm_mul_ps(a[i+3].m128, b[i+3].m128);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);	/* r3 = pad products */
+		_mm_storeu_ps(&dot[i], _mm_add_ps(_mm_add_ps(r0, r1), r2));
+	}
+	if (i < n)
+		M_VectorDotArr3_FPU(&dot[i], &a[i], &b[i], n-i);
+}
+
+static void
+CrossArr3_SSE(M_Vector3 *c, const M_Vector3 *a, const M_Vector3 *b, Uint n)
+{
+	__m128 va, vb, r;
+	Uint i;
+
+	for (i = 0; i < n; i++) {
+		va = a[i].m128;
+		vb = b[i].m128;
+		r = _mm_sub_ps(
+		    _mm_mul_ps(va, _mm_shuffle_ps(vb,vb,_MM_SHUFFLE(3,0,2,1))),
+		    _mm_mul_ps(_mm_shuffle_ps(va,va,_MM_SHUFFLE(3,0,2,1)), vb));
+		c[i].m128 = _mm_shuffle_ps(r,r,_MM_SHUFFLE(3,0,2,1));
+		c[i]._pad = 0.0f;
+	}
+}
+
+static void
+NormArr3_SSE(M_Vector3 *v, Uint n)
+{
+	__m128 r0, r1, r2, r3, len2, len, one, nz;
+	float lens[4];
+	Uint i;
+
+	one = _mm_set1_ps(1.0f);
+	for (i = 0; i+4 <= n; i += 4) {
+		r0 = _mm_mul_ps(v[i  ].m128, v[i  ].m128);
+		r1 = _mm_mul_ps(v[i+1].m128, v[i+1].m128);
+		r2 = _mm_mul_ps(v[i+2].m128, v[i+2].m128);
+		r3 = _mm_mul_ps(v[i+3].m128, v[i+3].m128);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		len2 = _mm_add_ps(_mm_add_ps(r0, r1), r2);
+
+		/* Divide zero-length vectors by 1 (leave them unchanged). */
+		nz = _mm_cmpgt_ps(len2, _mm_setzero_ps());
+		len = _mm_or_ps(_mm_and_ps(nz, _mm_sqrt_ps(len2)),
+		                _mm_andnot_ps(nz, one));
+		_mm_storeu_ps(lens, len);
+
+		v[i  ].m128 = _mm_div_ps(v[i  ].m128, _mm_set1_ps(lens[0]));
+		v[i+1].m128 = _mm_div_ps(v[i+1].m128, _mm_set1_ps(lens[1]));
+		v[i+2].m128 = _mm_div_ps(v[i+2].m128, _mm_set1_ps(lens[2]));
+		v[i+3].m128 = _mm_div_ps(v[i+3].m128, _mm_set1_ps(lens[3]));
+	}
+	if (i < n)
+		M_VectorNormArr3_FPU(&v[i], n-i);
+}
+
+static void
+Bounds3_SSE(const M_Vector3 *v, Uint n, M_Vector3 *vMin, M_Vector3 *vMax)
+{
+	__m128 lo, hi;
+	Uint i;
+
+	if (n == 0) {
+		vMin->m128 = _mm_setzero_ps();
+		vMax->m128 = _mm_setzero_ps();
+		return;
+	}
+	lo = hi = v[0].m128;
+	for (i = 1; i < n; i++) {
+		lo = _mm_min_ps(lo, v[i].m128);
+		hi = _mm_max_ps(hi, v[i].m128);
+	}
+	vMin->m128 = lo;
+	vMax->m128 = hi;
+	vMin->_pad = 0.0f;
+	vMax->_pad = 0.0f;
+}
+
+static void
+TransformPointsSoA3_SSE(M_VectorSoA3 *Sout, const M_Matrix44 *A,
+    const M_VectorSoA3 *Sin)
+{
+	__m128 a[3][4], x, y, z;
+	Uint i, j, k;
+
+	for (j = 0; j < 3; j++) {
+		for (k = 0; k < 4; k++)
+			a[j][k] = _mm_set1_ps(A->m[j][k]);
+	}
+	for (i = 0; i+4 <= Sin->n; i += 4) {
+		x = _mm_loadu_ps(&Sin->x[i]);
+		y = _mm_loadu_ps(&Sin->y[i]);
+		z = _mm_loadu_ps(&Sin->z[i]);
+		_mm_storeu_ps(&Sout->x[i], _mm_add_ps(
+		    _mm_add_ps(_mm_mul_ps(a[0][0],x), _mm_mul_ps(a[0][1],y)),
+		    _mm_add_ps(_mm_mul_ps(a[0][2],z), a[0][3])));
+		_mm_storeu_ps(&Sout->y[i], _mm_add_ps(
+		    _mm_add_ps(_mm_mul_ps(a[1][0],x), _mm_mul_ps(a[1][1],y)),
+		    _mm_add_ps(_mm_mul_ps(a[1][2],z), a[1][3])));
+		_mm_storeu_ps(&Sout->z[i], _mm_add_ps(
+		    _mm_add_ps(_mm_mul_ps(a[2][0],x), _mm_mul_ps(a[2][1],y)),
+		    _mm_add_ps(_mm_mul_ps(a[2][2],z), a[2][3])));
+	}
+	if (i < Sin->n) {
+		M_VectorSoA3 SinRem, SoutRem;
+
+		SubSoA3(&SinRem, Sin, i, Sin->n - i);
+		SubSoA3(&SoutRem, Sout, i, Sin->n - i);
+		M_VectorTransformPointsSoA3_FPU(&SoutRem, A, &SinRem);
+	}
+	Sout->n = Sin->n;
+}
+
+static void
+DotSoA3_SSE(float *dot, const M_VectorSoA3 *Sa, const M_VectorSoA3 *Sb)
+{
+	Uint i;
+
+	for (i = 0; i+4 <= Sa->n; i += 4) {
+		_mm_storeu_ps(&dot[i], _mm_add_ps(
+		    _mm_add_ps(
+		        _mm_mul_ps(_mm_loadu_ps(&Sa->x[i]), _mm_loadu_ps(&Sb->x[i])),
+		        _mm_mul_ps(_mm_loadu_ps(&Sa->y[i]), _mm_loadu_ps(&Sb->y[i]))),
+		    _mm_mul_ps(_mm_loadu_ps(&Sa->z[i]), _mm_loadu_ps(&Sb->z[i]))));
+	}
+	if (i < Sa->n) {
+		M_VectorSoA3 SaRem, SbRem;
+
+		SubSoA3(&SaRem, Sa, i, Sa->n - i);
+		SubSoA3(&SbRem, Sb, i, Sa->n - i);
+		M_VectorDotSoA3_FPU(&dot[i], &SaRem, &SbRem);
+	}
+}
+
+static void
+CrossSoA3_SSE(M_VectorSoA3 *Sc, const M_VectorSoA3 *Sa, const M_VectorSoA3 *Sb)
+{
+	__m128 ax, ay, az, bx, by, bz;
+	Uint i;
+
+	for (i = 0; i+4 <= Sa->n; i += 4) {
+		ax = _mm_loadu_ps(&Sa->x[i]);
+		ay = _mm_loadu_ps(&Sa->y[i]);
+		az = _mm_loadu_ps(&Sa->z[i]);
+		bx = _mm_loadu_ps(&Sb->x[i]);
+		by = _mm_loadu_ps(&Sb->y[i]);
+		bz = _mm_loadu_ps(&Sb->z[i]);
+		_mm_storeu_ps(&Sc->x[i],
+		    _mm_sub_ps(_mm_mul_ps(ay,bz), _mm_mul_ps(by,az)));
+		_mm_storeu_ps(&Sc->y[i],
+		    _mm_sub_ps(_mm_mul_ps(az,bx), _mm_mul_ps(bz,ax)));
+		_mm_storeu_ps(&Sc->z[i],
+		    _mm_sub_ps(_mm_mul_ps(ax,by), _mm_mul_ps(bx,ay)));
+	}
+	if (i < Sa->n) {
+		M_VectorSoA3 SaRem, SbRem, ScRem;
+
+		SubSoA3(&SaRem, Sa, i, Sa->n - i);
+		SubSoA3(&SbRem, Sb, i, Sa->n - i);
+		SubSoA3(&ScRem, Sc, i, Sa->n - i);
+		M_VectorCrossSoA3_FPU(&ScRem, &SaRem, &SbRem);
+	}
+	Sc->n = Sa->n;
+}
+
+static void
+NormSoA3_SSE(M_VectorSoA3 *S)
+{
+	__m128 x, y, z, len2, len, nz, one;
+	Uint i;
+
+	one = _mm_set1_ps(1.0f);
+	for (i = 0; i+4 <= S->n; i += 4) {
+		x = _mm_loadu_ps(&S->x[i]);
+		y = _mm_loadu_ps(&S->y[i]);
+		z = _mm_loadu_ps(&S->z[i]);
+		len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x,x), _mm_mul_ps(y,y)),
+		                  _mm_mul_ps(z,z));
+		nz = _mm_cmpgt_ps(len2, _mm_setzero_ps());
+		len = _mm_or_ps(_mm_and_ps(nz, _mm_sqrt_ps(len2)),
+		                _mm_andnot_ps(nz, one));
+		_mm_storeu_ps(&S->x[i], _mm_div_ps(x, len));
+		_mm_storeu_ps(&S->y[i], _mm_div_ps(y, len));
+		_mm_storeu_ps(&S->z[i], _mm_div_ps(z, len));
+	}
+	if (i < S->n) {
+		M_VectorSoA3 SRem;
+
+		SubSoA3(&SRem, S, i, S->n - i);
+		M_VectorNormSoA3_FPU(&SRem);
+	}
+}
+
+static void
+BoundsSoA3_SSE(const M_VectorSoA3 *S, M_Vector3 *vMin, M_Vector3 *vMax)
+{
+	__m128 lo[3], hi[3], t;
+	float l[3][4], h[3][4];
+	M_Vector3 remMin, remMax;
+	Uint i, j;
+
+	if (S->n < 4) {
+		M_VectorBoundsSoA3_FPU(S, vMin, vMax);
+		return;
+	}
+	lo[0] = hi[0] = _mm_loadu_ps(&S->x[0]);
+	lo[1] = hi[1] = _mm_loadu_ps(&S->y[0]);
+	lo[2] = hi[2] = _mm_loadu_ps(&S->z[0]);
+	for (i = 4; i+4 <= S->n; i += 4) {
+		t = _mm_loadu_ps(&S->x[i]);
+		lo[0] = _mm_min_ps(lo[0], t);
+		hi[0] = _mm_max_ps(hi[0], t);
+		t = _mm_loadu_ps(&S->y[i]);
+		lo[1] = _mm_min_ps(lo[1], t);
+		hi[1] = _mm_max_ps(hi[1], t);
+		t = _mm_loadu_ps(&S->z[i]);
+		lo[2] = _mm_min_ps(lo[2], t);
+		hi[2] = _mm_max_ps(hi[2], t);
+	}
+	for (j = 0; j < 3; j++) {			/* Reduce across lanes */
+		_mm_storeu_ps(l[j], lo[j]);
+		_mm_storeu_ps(h[j], hi[j]);
+		l[j][0] = MIN(MIN(l[j][0], l[j][1]), MIN(l[j][2], l[j][3]));
+		h[j][0] = MAX(MAX(h[j][0], h[j][1]), MAX(h[j][2], h[j][3]));
+	}
+	vMin->m128 = _mm_set_ps(0.0f, l[2][0], l[1][0], l[0][0]);
+	vMax->m128 = _mm_set_ps(0.0f, h[2][0], h[1][0], h[0][0]);
+
+	if (i < S->n) {
+		M_VectorSoA3 SRem;
+
+		SubSoA3(&SRem, S, i, S->n - i);
+		M_VectorBoundsSoA3_FPU(&SRem, &remMin, &remMax);
+		vMin->m128 = _mm_min_ps(vMin->m128, remMin.m128);
+		vMax->m128 = _mm_max_ps(vMax->m128, remMax.m128);
+	}
+}
+
+#endif /* HAVE_SSE */
@@ -59,6 +59,12 @@ MANLINKS+=RG_Tile.3:RG_TileScale.3
 CATLINKS+=RG_Tile.cat3:RG_TileScale.cat3
 MANLINKS+=RG_Tile.3:RG_TileGenerate.3
 CATLINKS+=RG_Tile.cat3:RG_TileGenerate.cat3
+MANLINKS+=RG_Tile.3:RG_TileComposite.3
+CATLINKS+=RG_Tile.cat3:RG_TileComposite.cat3
+MANLINKS+=RG_Tile.3:RG_TileInvalidateRect.3
+CATLINKS+=RG_Tile.cat3:RG_TileInvalidateRect.cat3
+MANLINKS+=RG_Tile.3:RG_TileInvalidatePixmap.3
+CATLINKS+=RG_Tile.cat3:RG_TileInvalidatePixmap.cat3
 MANLINKS+=RG_Tile.3:RG_TileAddPixmap.3
 CATLINKS+=RG_Tile.cat3:RG_TileAddPixmap.cat3
 MANLINKS+=RG_Tile.3:RG_TileAddSketch.3
@@ -71,6 +77,14 @@ MANLINKS+=RG_Tile.3:RG_TileDelSketch.3
 CATLINKS+=RG_Tile.cat3:RG_TileDelSketch.cat3
 MANLINKS+=RG_Tile.3:RG_TileDelFeature.3
 CATLINKS+=RG_Tile.cat3:RG_TileDelFeature.cat3
+MANLINKS+=RG_Tile.3:RG_TileGetVariant.3
+CATLINKS+=RG_Tile.cat3:RG_TileGetVariant.cat3
+MANLINKS+=RG_Tile.3:RG_TileFreeVariants.3
+CATLINKS+=RG_Tile.cat3:RG_TileFreeVariants.cat3
+MANLINKS+=RG_Tile.3:RG_TransformChainHash.3
+CATLINKS+=RG_Tile.cat3:RG_TransformChainHash.cat3
+MANLINKS+=RG_Tile.3:RG_TransformChainCompare.3
+CATLINKS+=RG_Tile.cat3:RG_TransformChainCompare.cat3
 MANLINKS+=RG.3:RG_TilesetNew.3
 CATLINKS+=RG.cat3:RG_TilesetNew.cat3
 MANLINKS+=RG.3:RGTILE.3
@@ -91,6 +105,10 @@ MANLINKS+=RG.3:RG_TilesetResvTile.3
 CATLINKS+=RG.cat3:RG_TilesetResvTile.cat3
 MANLINKS+=RG.3:RG_TilesetResvPixmap.3
 CATLINKS+=RG.cat3:RG_TilesetResvPixmap.cat3
+MANLINKS+=RG.3:RG_TilesetGenerateAll.3
+CATLINKS+=RG.cat3:RG_TilesetGenerateAll.cat3
+MANLINKS+=RG.3:RG_TilesetInvalidatePixmap.3
+CATLINKS+=RG.cat3:RG_TilesetInvalidatePixmap.cat3
 MANLINKS+=RG_Tileview.3:RG_TileviewNew.3
 CATLINKS+=RG_Tileview.cat3:RG_TileviewNew.cat3
 MANLINKS+=RG_Tileview.3:RG_TileviewSetTile.3
@@ -531,6 +531,51 @@ RG_PixmapBeginUndoBlk(RG_Pixmap *px)
 	ublk->nmods = 0;
 }
 
+/*
+ * Mark the area modified by an undo block for recompositing, in every tile
+ * of the tileset using the pixmap.
+ */
+static void
+InvalidateUndoBlk(RG_Pixmap *_Nonnull px, const RG_PixmapUndoBlk *_Nonnull ublk)
+{
+	AG_Rect r;
+	int x1, y1, x2, y2;
+	Uint i;
+
+	if (ublk->nmods == 0)
+		return;
+
+	x1 = x2 = ublk->mods[0].x;
+	y1 = y2 = ublk->mods[0].y;
+	for (i = 1; i < ublk->nmods; i++) {
+		const RG_PixmapMod *mod = &ublk->mods[i];
+
+		if (mod->x < x1) { x1 = mod->x; }
+		if (mod->y < y1) { y1 = mod->y; }
+		if (mod->x > x2) { x2 = mod->x; }
+		if (mod->y > y2) { y2 = mod->y; }
+	}
+	r.x = x1;
+	r.y = y1;
+	r.w = x2 - x1 + 1;
+	r.h = y2 - y1 + 1;
+	RG_TilesetInvalidatePixmap(px->ts, px, &r);
+}
+
+/* Mark a modified pixel of the tile being edited for recompositing. */
+static void
+InvalidatePixel(RG_Tileview *_Nonnull tv, RG_TileElement *_Nonnull tel,
+    int x, int y)
+{
+	AG_Rect r;
+
+	r.x = tel->tel_pixmap.x + x;
+	r.y = tel->tel_pixmap.y + y;
+	r.w = 1;
+	r.h = 1;
+	RG_TileInvalidateRect(tv->tile, &r);
+}
+
 void
 RG_PixmapUndo(RG_Tileview *tv, RG_TileElement *tel)
 {
@@ -547,7 +592,7 @@ RG_PixmapUndo(RG_Tileview *tv, RG_TileElement *tel)
 	}
 
 	px->curblk--;
-	tv->tile->flags |= RG_TILE_DIRTY;
+	InvalidateUndoBlk(px, ublk);
 }
 
 void
@@ -610,7 +655,7 @@ RG_PixmapPutPixel(RG_Tileview *tv, RG_TileElement *tel, int x, int y,
 			    tel->tel_pixmap.y + y,
 			    c.r, c.g, c.b);
 		} else {
-			tv->tile->flags |= RG_TILE_DIRTY;
+			InvalidatePixel(tv, tel, x, y);
 		}
 		break;
 	case RG_PIXMAP_OVERLAY_ALPHA:
@@ -622,16 +667,16 @@ RG_PixmapPutPixel(RG_Tileview *tv, RG_TileElement *tel, int x, int y,
 			    c.r, c.g, c.b);
 		} else {
 			RG_BlendRGB(S, x, y, RG_PRIM_OVERLAY_ALPHA, &c);
-			tv->tile->flags |= RG_TILE_DIRTY;
+			InvalidatePixel(tv, tel, x, y);
 		}
 		break;
 	case RG_PIXMAP_AVERAGE_ALPHA:
 		RG_BlendRGB(S, x, y, RG_PRIM_AVERAGE_ALPHA, &c);
-		tv->tile->flags |= RG_TILE_DIRTY;
+		InvalidatePixel(tv, tel, x, y);
 		break;
 	case RG_PIXMAP_DEST_ALPHA:
 		RG_BlendRGB(S, x, y, RG_PRIM_DST_ALPHA, &c);
-		tv->tile->flags |= RG_TILE_DIRTY;
+		InvalidatePixel(tv, tel, x, y);
 		break;
 	}
 	return (0);
@@ -897,7 +942,7 @@ pixmap_fill(RG_Tileview *_Nonnull tv, RG_TileElement *_Nonnull tel,
 	}
 	cFill = AG_MapPixel32_RGBA8(&px->su->format, r,g,b,a);
 	fill_ortho(tv, tel, x, y, cOrig, cFill);
-	tv->tile->flags |= RG_TILE_DIRTY;
+	InvalidateUndoBlk(px, &px->ublks[px->nublks-1]);
 }
 
 static void
@@ -922,7 +967,7 @@ pixmap_randfill(RG_Tileview *_Nonnull tv, RG_TileElement *_Nonnull tel,
 	}
 	cFill = AG_MapPixel32_RGBA8(&px->su->format, r,g,b,a);
 	randfill_ortho(tv, tel, x, y, cOrig, cFill, &bit, &rand);
-	tv->tile->flags |= RG_TILE_DIRTY;
+	InvalidateUndoBlk(px, &px->ublks[px->nublks-1]);
 }
 
 static void
@@ -996,9 +1041,11 @@ void
 RG_PixmapButtonup(RG_Tileview *tv, RG_TileElement *tel, int x, int y,
     int xMouse, int yMouse, int button)
 {
+	RG_Pixmap *px = tel->tel_pixmap.px;
+
 	if (button == AG_MOUSE_LEFT) {
 		tv->tv_pixmap.state = RG_TVPIXMAP_IDLE;
-		tv->tile->flags |= RG_TILE_DIRTY;
+		InvalidateUndoBlk(px, &px->ublks[px->nublks-1]);
 	}
 }
 
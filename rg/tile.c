@@ -57,32 +57,45 @@ const char *rgTileSnapModes[] = {
 	NULL
 };
 
+/*
+ * Incremented whenever a tile surface is regenerated or freed, so that
+ * clients caching renderings of tiles (such as MAP_View) can tell when
+ * their contents are stale.
+ */
+Uint rgTileGen = 0;
+
+Uint rgTileVariantsMax = RG_TILE_VARIANTS_MAX;	/* Cached variants per tile */
+
 /*
  * Blend a pixmap with the tile; add the source alpha to the destination
- * alpha of each pixel.
+ * alpha of each pixel. Only pixels inside the clipping rectangle of the
+ * tile surface are visited.
  */
 static void
 BlendOverlayAlpha(RG_Tile *_Nonnull t, AG_Surface *_Nonnull su,
     AG_Rect *_Nonnull rd)
 {
-	Uint sx, sy, dx, dy;
+	const AG_Rect *rClip = &t->su->clipRect;
+	int sx0, sy0, sx1, sy1, sx, sy, dx, dy;
 	Uint8 *pSrc, *pDst;
 	AG_Color Csrc, Cdst;
 	int alpha;
 
-	for (sy = 0, dy = rd->y; sy < su->h; sy++, dy++) {
-		for (sx = 0, dx = rd->x; sx < su->w; sx++, dx++) {
-			if (AG_SurfaceClipped(t->su, dx,dy))
-				continue;
+	sx0 = AG_MAX(0, rClip->x - rd->x);
+	sy0 = AG_MAX(0, rClip->y - rd->y);
+	sx1 = AG_MIN((int)su->w, rClip->x + rClip->w - rd->x);
+	sy1 = AG_MIN((int)su->h, rClip->y + rClip->h - rd->y);
 
-			pSrc = (Uint8 *)su->pixels + sy*su->pitch + (sx << 2);
+	for (sy = sy0, dy = rd->y + sy0; sy < sy1; sy++, dy++) {
+		pSrc = (Uint8 *)su->pixels + sy*su->pitch + (sx0 << 2);
+		pDst = (Uint8 *)t->su->pixels + dy*t->su->pitch +
+		       ((rd->x + sx0) << 2);
 
+		for (sx = sx0, dx = rd->x + sx0; sx < sx1;
+		     sx++, dx++, pSrc += 4, pDst += 4) {
 			if (*(Uint32 *)pSrc == su->colorkey)
 				continue;
 
-			pDst = (Uint8 *)t->su->pixels + dy*t->su->pitch +
-					(dx << 2);
-
 			if (*(Uint32 *)pDst != t->su->colorkey) {
 				AG_GetColor32(&Cdst, *(Uint32 *)pDst, &t->su->format);
 				AG_GetColor32(&Csrc, *(Uint32 *)pSrc, &su->format);
@@ -140,13 +153,18 @@ RG_TileInit(RG_Tile *t, RG_Tileset *ts, const char *name)
 	t->su = NULL;
 	t->ts = ts;
 	t->nrefs = 0;
+	t->rDirty.x = 0;
+	t->rDirty.y = 0;
+	t->rDirty.w = 0;
+	t->rDirty.h = 0;
 	t->blend_fn = BlendOverlayAlpha;
 	t->attrs = NULL;
 	t->layers = NULL;
 	t->nw = 0;
 	t->nh = 0;
 	TAILQ_INIT(&t->elements);
-	SLIST_INIT(&t->vars);
+	TAILQ_INIT(&t->vars);
+	t->nvars = 0;
 }
 
 void
@@ -191,18 +209,78 @@ RG_TileScale(RG_Tileset *ts, RG_Tile *t, Uint16 w, Uint16 h)
 	t->flags |= RG_TILE_DIRTY;
 }
 
+/*
+ * Regenerate the tile surface. If only a region of the tile was invalidated
+ * (RG_TileInvalidateRect()), only that region is recomposited.
+ */
 void
 RG_TileGenerate(RG_Tile *t)
+{
+	RG_TileFreeVariants(t);
+	rgTileGen++;
+	RG_TileComposite(t);
+}
+
+/*
+ * Return 1 if the elements of the tile can be recomposited over a region.
+ * Features paint without regard to the clipping rectangle.
+ */
+static int
+CanCompositeRegion(RG_Tile *_Nonnull t)
+{
+	RG_TileElement *tel;
+
+	if ((t->flags & RG_TILE_DIRTY) || !(t->flags & RG_TILE_DIRTY_RECT))
+		return (0);
+
+	TAILQ_FOREACH(tel, &t->elements, elements) {
+		if (tel->visible && tel->type != RG_TILE_PIXMAP)
+			return (0);
+	}
+	return (1);
+}
+
+/*
+ * Composite the visible elements of the tile onto its surface. Unlike
+ * RG_TileGenerate(), cached variants are not released and no global state
+ * is modified, so distinct tiles may be composited concurrently.
+ */
+void
+RG_TileComposite(RG_Tile *t)
 {
 	RG_TileElement *tel;
 	RG_Tileset *ts = t->ts;
+	AG_Surface *su = t->su;
+	AG_Rect rClipSave = su->clipRect, r;
 	AG_Color c;
-	
-	AG_SurfaceSetAlpha(t->su, AG_SURFACE_ALPHA, ts->icon->alpha);
+	Uint32 pxNone;
+	Uint8 *p;
+	int x, y;
+
+	if (CanCompositeRegion(t)) {
+		r = t->rDirty;
+	} else {
+		r.x = 0;
+		r.y = 0;
+		r.w = su->w;
+		r.h = su->h;
+	}
+	t->flags &= ~(RG_TILE_DIRTY | RG_TILE_DIRTY_RECT);
+	su->clipRect = r;
+
+	AG_SurfaceSetAlpha(su, AG_SURFACE_ALPHA, ts->icon->alpha);
 
 	/* TODO check for opaque fill features/pixmaps first */
 	AG_ColorNone(&c);
-	AG_FillRect(t->su, NULL, &c);
+	pxNone = AG_MapPixel32(&su->format, &c);
+	for (y = r.y; y < r.y + r.h; y++) {
+		p = (Uint8 *)su->pixels + y*su->pitch +
+		    r.x*su->format.BytesPerPixel;
+		for (x = 0; x < r.w; x++) {
+			AG_SurfacePut32_At(su, p, pxNone);
+			p += su->format.BytesPerPixel;
+		}
+	}
 
 	TAILQ_FOREACH(tel, &t->elements, elements) {
 		if (!tel->visible) {
@@ -228,6 +306,10 @@ RG_TileGenerate(RG_Tile *t)
 				rd.y = tel->tel_pixmap.y;
 				rd.w = px->su->w;
 				rd.h = px->su->h;
+				if (rd.x >= r.x + r.w || rd.x + rd.w <= r.x ||
+				    rd.y >= r.y + r.h || rd.y + rd.h <= r.y) {
+					break;
+				}
 				t->blend_fn(t, px->su, &rd);
 			}
 			break;
@@ -238,28 +320,94 @@ RG_TileGenerate(RG_Tile *t)
 #endif
 		}
 	}
+	su->clipRect = rClipSave;
 
 	if ((t->flags & RG_TILE_SRCALPHA) == 0 &&
 	    (t->flags & RG_TILE_SRCCOLORKEY)) {
-		AG_Surface *su = t->su;
-		Uint i, size = su->w*su->h;
-		Uint8 *p = su->pixels;
-
-		for (i = 0; i < size; i++) {
-			AG_GetColor32(&c, AG_SurfaceGet32_At(su,p), &su->format);
-			AG_SurfacePut32_At(su, p,
-			    (c.a == 0) ? su->colorkey :
-			                 AG_MapPixel32(&su->format, &c));
-
-			p += su->format.BytesPerPixel;
+		for (y = r.y; y < r.y + r.h; y++) {
+			p = (Uint8 *)su->pixels + y*su->pitch +
+			    r.x*su->format.BytesPerPixel;
+			for (x = 0; x < r.w; x++) {
+				AG_GetColor32(&c, AG_SurfaceGet32_At(su,p),
+				    &su->format);
+				AG_SurfacePut32_At(su, p,
+				    (c.a == 0) ? su->colorkey :
+				                 AG_MapPixel32(&su->format, &c));
+
+				p += su->format.BytesPerPixel;
+			}
 		}
-		AG_SurfaceSetAlpha(t->su, 0, 0);
-		AG_SurfaceSetColorKey(t->su, AG_SURFACE_COLORKEY, ts->icon->colorkey);
+		AG_SurfaceSetAlpha(su, 0, 0);
+		AG_SurfaceSetColorKey(su, AG_SURFACE_COLORKEY, ts->icon->colorkey);
 	} else if ((t->flags & (RG_TILE_SRCCOLORKEY|RG_TILE_SRCALPHA)) == 0) {
-		AG_SurfaceSetAlpha(t->su, 0, 0);
-		AG_SurfaceSetColorKey(t->su, 0, 0);
+		AG_SurfaceSetAlpha(su, 0, 0);
+		AG_SurfaceSetColorKey(su, 0, 0);
 	} else {
-		AG_SurfaceSetColorKey(t->su, AG_SURFACE_COLORKEY, ts->icon->colorkey);
+		AG_SurfaceSetColorKey(su, AG_SURFACE_COLORKEY, ts->icon->colorkey);
+	}
+}
+
+/*
+ * Mark a region of the tile (in tile coordinates) for recompositing by the
+ * next RG_TileGenerate(). Has no effect if the whole tile is already dirty.
+ */
+void
+RG_TileInvalidateRect(RG_Tile *t, const AG_Rect *r)
+{
+	AG_Rect *rd = &t->rDirty;
+	int x1, y1, x2, y2;
+
+	if (t->flags & RG_TILE_DIRTY)
+		return;
+
+	x1 = AG_MAX(0, r->x);
+	y1 = AG_MAX(0, r->y);
+	x2 = AG_MIN((int)t->su->w, r->x + r->w);
+	y2 = AG_MIN((int)t->su->h, r->y + r->h);
+	if (x1 >= x2 || y1 >= y2)
+		return;
+
+	if (t->flags & RG_TILE_DIRTY_RECT) {
+		x1 = AG_MIN(x1, rd->x);
+		y1 = AG_MIN(y1, rd->y);
+		x2 = AG_MAX(x2, rd->x + rd->w);
+		y2 = AG_MAX(y2, rd->y + rd->h);
+	}
+	rd->x = x1;
+	rd->y = y1;
+	rd->w = x2 - x1;
+	rd->h = y2 - y1;
+	t->flags |= RG_TILE_DIRTY_RECT;
+}
+
+/*
+ * Mark the regions of the tile covered by visible instances of a pixmap
+ * for recompositing. The region r is in pixmap coordinates; if NULL, the
+ * whole pixmap is assumed.
+ */
+void
+RG_TileInvalidatePixmap(RG_Tile *t, RG_Pixmap *px, const AG_Rect *r)
+{
+	RG_TileElement *tel;
+	AG_Rect rd;
+
+	TAILQ_FOREACH(tel, &t->elements, elements) {
+		if (tel->type != RG_TILE_PIXMAP || !tel->visible ||
+		    tel->tel_pixmap.px != px) {
+			continue;
+		}
+		if (r != NULL) {
+			rd.x = tel->tel_pixmap.x + r->x;
+			rd.y = tel->tel_pixmap.y + r->y;
+			rd.w = r->w;
+			rd.h = r->h;
+		} else {
+			rd.x = tel->tel_pixmap.x;
+			rd.y = tel->tel_pixmap.y;
+			rd.w = px->su->w;
+			rd.h = px->su->h;
+		}
+		RG_TileInvalidateRect(t, &rd);
 	}
 }
 
@@ -449,7 +597,7 @@ RG_TileSave(RG_Tile *t, AG_DataSource *buf)
 	int x, y;
 
 	AG_WriteString(buf, t->name);
-	AG_WriteUint8(buf, t->flags & ~RG_TILE_DIRTY);
+	AG_WriteUint8(buf, t->flags & ~(RG_TILE_DIRTY | RG_TILE_DIRTY_RECT));
 	AG_WriteSurface(buf, t->su);
 	
 	AG_WriteSint16(buf, (Sint16)t->xOrig);
@@ -631,7 +779,7 @@ RG_TileLoad(RG_Tile *t, AG_DataSource *buf)
 			break;
 		}
 	}
-	t->flags &= ~RG_TILE_DIRTY;
+	t->flags &= ~(RG_TILE_DIRTY | RG_TILE_DIRTY_RECT);
 	return (0);
 }
 
@@ -639,11 +787,12 @@ void
 RG_TileDestroy(RG_Tile *t)
 {
 	RG_TileElement *tel, *tel_next;
-	RG_TileVariant *var, *var_next;
 
+	RG_TileFreeVariants(t);
 	Free(t->attrs);
 	Free(t->layers);
 	AG_SurfaceFree(t->su);
+	rgTileGen++;
 	
 	for (tel = TAILQ_FIRST(&t->elements);
 	     tel != TAILQ_END(&t->elements);
@@ -651,12 +800,108 @@ RG_TileDestroy(RG_Tile *t)
 		tel_next = TAILQ_NEXT(tel, elements);
 		Free(tel);
 	}
-	for (var = SLIST_FIRST(&t->vars);
-	     var != SLIST_END(&t->vars);
-	     var = var_next) {
-		var_next = SLIST_NEXT(var, vars);
-		Free(var);
+}
+
+static void
+FreeVariant(RG_Tile *_Nonnull t, RG_TileVariant *_Nonnull var)
+{
+	TAILQ_REMOVE(&t->vars, var, vars);
+	t->nvars--;
+	t->ts->varStats.nvars--;
+	t->ts->varStats.size -= var->size;
+
+	RG_TransformChainDestroy(&var->transforms);
+	AG_SurfaceFree(var->su);
+	Free(var);
+}
+
+/* Release all cached variants of a tile. */
+void
+RG_TileFreeVariants(RG_Tile *t)
+{
+	RG_TileVariant *var;
+
+	AG_ObjectLock(t->ts);
+	while ((var = TAILQ_FIRST(&t->vars)) != NULL) {
+		FreeVariant(t, var);
+	}
+	AG_ObjectUnlock(t->ts);
+}
+
+/*
+ * Return the variant of a tile with the given chain of transforms applied,
+ * generating it if it is not cached. Cached variants are looked up by the
+ * hash of their transform chain and kept in most-recently-used order. At
+ * most rgTileVariantsMax variants are kept per tile; beyond that, the least
+ * recently used variant is evicted.
+ *
+ * The caller must hold the tileset lock for as long as it uses the variant.
+ */
+RG_TileVariant *
+RG_TileGetVariant(RG_Tile *t, const RG_TransformChain *xchain)
+{
+	Uint32 hash = RG_TransformChainHash(xchain);
+	RG_TileVariant *var;
+	RG_Transform *xf;
+	AG_Surface *Sx, *Stile;
+
+	AG_ObjectLock(t->ts);
+
+	TAILQ_FOREACH(var, &t->vars, vars) {
+		if (var->hash == hash &&
+		    RG_TransformChainCompare(&var->transforms, xchain))
+			break;
+	}
+	if (var != NULL) {
+		if (var != TAILQ_FIRST(&t->vars)) {
+			TAILQ_REMOVE(&t->vars, var, vars);
+			TAILQ_INSERT_HEAD(&t->vars, var, vars);
+		}
+		t->ts->varStats.hits++;
+		goto out;
+	}
+	t->ts->varStats.misses++;
+
+	while (t->nvars > 0 && t->nvars >= rgTileVariantsMax) {
+		FreeVariant(t, TAILQ_LAST(&t->vars, rg_tile_variantq));
+		t->ts->varStats.evictions++;
+	}
+
+	var = Malloc(sizeof(RG_TileVariant));
+	TAILQ_INIT(&var->transforms);
+	RG_TransformChainDup(xchain, &var->transforms);
+	var->hash = hash;
+	var->texture = 0;
+	Stile = t->su;
+	var->su = AG_SurfaceRGBA(
+	    Stile->w, Stile->h, Stile->format.BitsPerPixel,
+	    Stile->flags & (AG_SURFACE_ALPHA|AG_SURFACE_COLORKEY),
+	    Stile->format.Rmask,
+	    Stile->format.Gmask,
+	    Stile->format.Bmask,
+	    Stile->format.Amask);
+	if (var->su == NULL) {
+		AG_FatalError(NULL);
 	}
+	AG_SurfaceCopy(var->su, Stile);
+
+	TAILQ_FOREACH(xf, &var->transforms, transforms) {
+		Sx = xf->func(var->su, xf->nargs, xf->args);
+		if (Sx != var->su) {
+			AG_SurfaceFree(var->su);
+			var->su = Sx;
+		}
+	}
+	var->size = var->su->h * var->su->pitch;
+
+	TAILQ_INSERT_HEAD(&t->vars, var, vars);
+	t->nvars++;
+	t->ts->varStats.nvars++;
+	t->ts->varStats.size += var->size;
+out:
+	var->last_drawn = AG_GetTicks();
+	AG_ObjectUnlock(t->ts);
+	return (var);
 }
 
 static void
@@ -711,6 +956,8 @@ CloseElement(RG_Tileview *_Nonnull tv)
 			AG_ObjectDetach(tv->tv_pixmap.win);
 			tv->tv_pixmap.win = NULL;
 		}
+		/* Update the other tiles sharing the pixmap. */
+		RG_TilesetGenerateAll(t->ts, RG_TILESET_GENERATE_DIRTY);
 		break;
 #if 0
 	case RG_TILEVIEW_SKETCH_EDIT:
@@ -59,6 +59,7 @@ typedef struct rg_tile_element {
 } RG_TileElement;
 
 AG_TAILQ_HEAD(rg_tile_elementq, rg_tile_element);
+AG_TAILQ_HEAD(rg_tile_variantq, rg_tile_variant);
 
 typedef struct rg_tile {
 	char name[RG_TILE_NAME_MAX];	/* User description */
@@ -79,6 +80,8 @@ typedef struct rg_tile {
 #define RG_TILE_SRCCOLORKEY	0x01	/* Colorkey source */
 #define RG_TILE_SRCALPHA	0x02	/* Alpha source */
 #define RG_TILE_DIRTY		0x04	/* Mark for redraw */
+#define RG_TILE_DIRTY_RECT	0x08	/* Only rDirty needs recompositing */
+	AG_Rect rDirty;			/* Region to recomposite */
 	Uint nrefs;			/* Reference count */
 	AG_Color c;			/* Current RGB color (edition) */
 	Uint32 pc;			/* Current pixel value (edition) */
@@ -96,23 +99,37 @@ typedef struct rg_tile {
 	void (*_Nonnull blend_fn)(struct rg_tile *_Nonnull,
 	                          AG_Surface *_Nonnull, AG_Rect *_Nonnull);
 
-	AG_SLIST_HEAD_(rg_tile_variant) vars;	/* Cached variants */
+	struct rg_tile_variantq vars;		/* Cached variants (MRU first) */
+	Uint                    nvars;
 	AG_TAILQ_ENTRY(rg_tile) tiles;
 } RG_Tile;
 
 /* Cached, transformed tile variant */
 typedef struct rg_tile_variant {
 	RG_TransformChain transforms;	/* Applied transforms */
+	Uint32 hash;			/* RG_TransformChainHash(transforms) */
 	AG_Surface *_Nonnull su;	/* Cached resulting surface */
+	Uint size;			/* Surface size (bytes) */
 
 	/* For OpenGL */
 	Uint texture;			/* Cached texture */
 	float texcoords[4];
 
 	Uint32 last_drawn;		/* Time last draw occured */
-	AG_SLIST_ENTRY(rg_tile_variant) vars;
+	AG_TAILQ_ENTRY(rg_tile_variant) vars;
 } RG_TileVariant;
 
+/* Tile variant cache statistics (per tileset). */
+typedef struct rg_tile_variant_stats {
+	Uint hits;			/* Lookups of a cached variant */
+	Uint misses;			/* Lookups generating a variant */
+	Uint evictions;			/* Variants evicted (LRU) */
+	Uint nvars;			/* Variants currently cached */
+	Uint size;			/* Total size of cached surfaces */
+} RG_TileVariantStats;
+
+#define RG_TILE_VARIANTS_MAX	32	/* Default cached variants per tile */
+
 #define RG_TILE_ATTR2(t,x,y) (t)->attrs[(y)*(t)->nw + (x)]
 #define RG_TILE_LAYER2(t,x,y) (t)->layers[(y)*(t)->nw + (x)]
 #define RG_TILE_ATTRS(t) (AG_SPRITE((t)->ts,(t)->s).attrs)
@@ -126,6 +143,8 @@ typedef struct rg_tile_variant {
 
 __BEGIN_DECLS
 extern const char *_Nullable rgTileSnapModes[];
+extern Uint rgTileGen;
+extern Uint rgTileVariantsMax;
 
 RG_Tile *_Nonnull RG_TileNew(struct rg_tileset *_Nonnull, const char *_Nullable,
                              Uint16,Uint16, Uint);
@@ -134,11 +153,18 @@ void RG_TileInit(RG_Tile *_Nonnull, struct rg_tileset *_Nonnull,
                  const char *_Nonnull);
 void RG_TileScale(struct rg_tileset *_Nonnull, RG_Tile *_Nonnull, Uint16,Uint16);
 void RG_TileGenerate(RG_Tile *_Nonnull);
+void RG_TileComposite(RG_Tile *_Nonnull);
+void RG_TileInvalidateRect(RG_Tile *_Nonnull, const AG_Rect *_Nonnull);
+void RG_TileInvalidatePixmap(RG_Tile *_Nonnull, struct rg_pixmap *_Nonnull,
+                             const AG_Rect *_Nullable);
 
 struct ag_window *_Nullable RG_TileEdit(struct rg_tileset *_Nonnull,
                                         RG_Tile *_Nonnull);
 
 void RG_TileDestroy(RG_Tile *_Nonnull);
+RG_TileVariant *_Nonnull RG_TileGetVariant(RG_Tile *_Nonnull,
+                                           const RG_TransformChain *_Nonnull);
+void RG_TileFreeVariants(RG_Tile *_Nonnull);
 void RG_TileSave(RG_Tile *_Nonnull, AG_DataSource *_Nonnull);
 int  RG_TileLoad(RG_Tile *_Nonnull, AG_DataSource *_Nonnull);
 void RG_TileOpenMenu(struct rg_tileview *_Nonnull, int,int);
@@ -54,6 +54,20 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include <agar/config/_mk_have_unistd_h.h>
+#ifdef _MK_HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+#define RG_GENERATE_MAX_THREADS	 8	/* Max tile compositing threads */
+#define RG_GENERATE_THREAD_TILES 16	/* Min tiles per thread */
+
+typedef struct rg_generate_job {
+	RG_Tile *_Nonnull *_Nonnull tiles;	/* Tiles to composite */
+	Uint nTiles;
+	Uint first, stride;			/* Tiles handled by this job */
+} RG_GenerateJob;
+
 extern const RG_FeatureOps rgFillOps;
 /* extern const RG_FeatureOps rgSketchProjOps; */
 
@@ -145,6 +159,7 @@ Init(void *_Nonnull obj)
 	ts->ntiletbl = 0;
 	ts->animtbl = NULL;
 	ts->nanimtbl = 0;
+	memset(&ts->varStats, 0, sizeof(RG_TileVariantStats));
 }
 
 static void
@@ -333,9 +348,9 @@ Load(void *_Nonnull obj, AG_DataSource *_Nonnull buf, const AG_Version *_Nonnull
 			goto fail;
 		}
 		RG_TileScale(ts, t, t->su->w, t->su->h);
-		RG_TileGenerate(t);
 		TAILQ_INSERT_TAIL(&ts->tiles, t, tiles);
 	}
+	RG_TilesetGenerateAll(ts, 0);
 
 	/* Load the animation information. */
 	count = AG_ReadUint32(buf);
@@ -569,6 +584,130 @@ RG_TilesetFindTile(RG_Tileset *ts, const char *name)
 	return (t);
 }
 
+static void
+GenerateTiles(const RG_GenerateJob *_Nonnull job)
+{
+	Uint i;
+
+	for (i = job->first; i < job->nTiles; i += job->stride)
+		RG_TileComposite(job->tiles[i]);
+}
+
+#ifdef AG_THREADS
+static void *_Nullable
+GenerateTilesThread(void *_Nullable p)
+{
+	GenerateTiles((const RG_GenerateJob *)p);
+	return (NULL);
+}
+#endif
+
+/* Return the number of threads to use for compositing count tiles. */
+static Uint
+GetGenerateThreads(Uint count)
+{
+	Uint nThreads = 1;
+#if defined(AG_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+	long nCPUs;
+
+	if ((nCPUs = sysconf(_SC_NPROCESSORS_ONLN)) > 1) {
+		nThreads = (nCPUs > RG_GENERATE_MAX_THREADS) ?
+		           RG_GENERATE_MAX_THREADS : (Uint)nCPUs;
+	}
+#endif
+	if (count/RG_GENERATE_THREAD_TILES < nThreads) {
+		nThreads = count/RG_GENERATE_THREAD_TILES;
+	}
+	return (nThreads > 0) ? nThreads : 1;
+}
+
+/*
+ * Regenerate the tiles of a tileset (or only the dirty tiles, with the
+ * RG_TILESET_GENERATE_DIRTY flag). Cached variants are released here, and
+ * the tiles (which are independent of each other) are then composited in
+ * parallel.
+ */
+void
+RG_TilesetGenerateAll(RG_Tileset *ts, Uint flags)
+{
+	RG_GenerateJob jobs[RG_GENERATE_MAX_THREADS];
+#ifdef AG_THREADS
+	AG_Thread th[RG_GENERATE_MAX_THREADS];
+	void *rv;
+#endif
+	RG_Tile **tiles, *t;
+	Uint nTiles = 0, i, nThreads;
+
+	AG_MutexLock(&ts->lock);
+
+	TAILQ_FOREACH(t, &ts->tiles, tiles) {
+		nTiles++;
+	}
+	if (nTiles == 0) {
+		goto out;
+	}
+	tiles = Malloc(nTiles*sizeof(RG_Tile *));
+	nTiles = 0;
+	TAILQ_FOREACH(t, &ts->tiles, tiles) {
+		if ((flags & RG_TILESET_GENERATE_DIRTY) &&
+		    !(t->flags & (RG_TILE_DIRTY | RG_TILE_DIRTY_RECT))) {
+			continue;
+		}
+		RG_TileFreeVariants(t);
+		rgTileGen++;
+		tiles[nTiles++] = t;
+	}
+
+	nThreads = GetGenerateThreads(nTiles);
+	for (i = 0; i < nThreads; i++) {
+		RG_GenerateJob *job = &jobs[i];
+
+		job->tiles = tiles;
+		job->nTiles = nTiles;
+		job->first = i;
+		job->stride = nThreads;
+	}
+#ifdef AG_THREADS
+	for (i = 1; i < nThreads; i++) {
+		if (AG_ThreadTryCreate(&th[i], GenerateTilesThread,
+		    &jobs[i]) == -1) {
+			GenerateTiles(&jobs[i]);	/* Do it ourselves */
+			jobs[i].nTiles = 0;
+		}
+	}
+	GenerateTiles(&jobs[0]);
+	for (i = 1; i < nThreads; i++) {
+		if (jobs[i].nTiles > 0)
+			AG_ThreadJoin(th[i], &rv);
+	}
+#else
+	for (i = 0; i < nThreads; i++)
+		GenerateTiles(&jobs[i]);
+#endif
+	Free(tiles);
+out:
+	AG_MutexUnlock(&ts->lock);
+}
+
+/*
+ * Mark the regions covered by a pixmap in every tile using it for
+ * recompositing. The region r is in pixmap coordinates (NULL = whole).
+ */
+void
+RG_TilesetInvalidatePixmap(RG_Tileset *ts, RG_Pixmap *px, const AG_Rect *r)
+{
+	RG_Tile *t;
+
+	if (px->nrefs == 0)
+		return;
+
+	AG_MutexLock(&ts->lock);
+	TAILQ_FOREACH(t, &ts->tiles, tiles) {
+		RG_TileInvalidatePixmap(t, px, r);
+	}
+	AG_MutexUnlock(&ts->lock);
+}
+
 #if 0
 RG_Sketch *
 RG_TilesetFindSketch(RG_Tileset *ts, const char *name)
@@ -49,6 +49,8 @@ typedef struct rg_tileset {
 	RG_Anim *_Nullable *_Nullable animtbl;	/* Animation ID mappings */
 	Uint                         nanimtbl;
 
+	RG_TileVariantStats varStats;	/* Tile variant cache statistics */
+
 	AG_TAILQ_HEAD_(rg_tile) tiles;
 #if 0
 	AG_TAILQ_HEAD_(rg_sketch) sketches;
@@ -75,6 +77,10 @@ void RG_DestroySubsystem(void);
 
 RG_Tileset *_Nonnull RG_TilesetNew(void *_Nullable, const char *_Nullable, Uint);
 RG_Tile *_Nullable RG_TilesetFindTile(RG_Tileset *_Nonnull, const char *_Nonnull);
+void RG_TilesetGenerateAll(RG_Tileset *_Nonnull, Uint);
+#define RG_TILESET_GENERATE_DIRTY 0x01	/* Only tiles marked dirty */
+void RG_TilesetInvalidatePixmap(RG_Tileset *_Nonnull, RG_Pixmap *_Nonnull,
+                                const AG_Rect *_Nullable);
 #if 0
 RG_Sketch *_Nullable RG_TilesetFindSketch(RG_Tileset *_Nonnull, const char *_Nonnull);
 #endif
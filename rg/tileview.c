@@ -1503,10 +1503,10 @@ Draw(void *_Nonnull obj)
 		t->flags |= RG_TILE_DIRTY;
 	}
 #endif
-	if ((t->flags & RG_TILE_DIRTY) || tv->su == -1) {
+	if ((t->flags & (RG_TILE_DIRTY | RG_TILE_DIRTY_RECT)) ||
+	    tv->su == -1) {
 		AG_Surface *Ss;
 
-		t->flags &= ~RG_TILE_DIRTY;
 		RG_TileGenerate(t);
 		Ss = AG_SurfaceScale(t->su, tv->scaled->w, tv->scaled->h, 0);
 		if (Ss == NULL) {
@@ -248,6 +248,43 @@ RG_TransformCompare(const RG_Transform *xf1, const RG_Transform *xf2)
 		 memcmp(xf1->args, xf2->args, xf1->nargs*sizeof(Uint32)) == 0));
 }
 
+/*
+ * Compute a hash of a transform chain (FNV-1a over the type and arguments
+ * of each transform). Chains which compare equal have the same hash.
+ */
+Uint32
+RG_TransformChainHash(const RG_TransformChain *xchain)
+{
+	const RG_Transform *xf;
+	Uint32 h = 2166136261U;
+	int i;
+
+	TAILQ_FOREACH(xf, xchain, transforms) {
+		h = (h ^ (Uint32)xf->type) * 16777619U;
+		h = (h ^ (Uint32)xf->nargs) * 16777619U;
+		for (i = 0; i < xf->nargs; i++)
+			h = (h ^ xf->args[i]) * 16777619U;
+	}
+	return (h);
+}
+
+/* Return 1 if two transform chains are identical. */
+int
+RG_TransformChainCompare(const RG_TransformChain *xchain1,
+    const RG_TransformChain *xchain2)
+{
+	const RG_Transform *xf1, *xf2;
+
+	for (xf1 = TAILQ_FIRST(xchain1), xf2 = TAILQ_FIRST(xchain2);
+	     xf1 != TAILQ_END(xchain1) && xf2 != TAILQ_END(xchain2);
+	     xf1 = TAILQ_NEXT(xf1, transforms),
+	     xf2 = TAILQ_NEXT(xf2, transforms)) {
+		if (!RG_TransformCompare(xf1, xf2))
+			return (0);
+	}
+	return (xf1 == TAILQ_END(xchain1) && xf2 == TAILQ_END(xchain2));
+}
+
 void
 RG_TransformDestroy(RG_Transform *xf)
 {
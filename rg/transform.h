@@ -50,6 +50,9 @@ void RG_TransformChainDup(const RG_TransformChain *_Nonnull,
                           RG_TransformChain *_Nonnull);
 int  RG_TransformCompare(const RG_Transform *_Nonnull,
                          const RG_Transform *_Nonnull);
+Uint32 RG_TransformChainHash(const RG_TransformChain *_Nonnull);
+int    RG_TransformChainCompare(const RG_TransformChain *_Nonnull,
+                                const RG_TransformChain *_Nonnull);
 __END_DECLS
 
 #include <agar/rg/close.h>
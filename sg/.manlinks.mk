@@ -111,6 +111,8 @@ MANLINKS+=SG_Node.3:SG_RotateJd.3
 CATLINKS+=SG_Node.cat3:SG_RotateJd.cat3
 MANLINKS+=SG_Node.3:SG_RotateKd.3
 CATLINKS+=SG_Node.cat3:SG_RotateKd.cat3
+MANLINKS+=SG_Node.3:SG_NodeInvalidate.3
+CATLINKS+=SG_Node.cat3:SG_NodeInvalidate.cat3
 MANLINKS+=SG_Node.3:SG_GetNodeTransform.3
 CATLINKS+=SG_Node.cat3:SG_GetNodeTransform.cat3
 MANLINKS+=SG_Node.3:SG_GetNodeTransformInverse.3
@@ -127,6 +129,8 @@ MANLINKS+=SG_Node.3:SG_Scale.3
 CATLINKS+=SG_Node.cat3:SG_Scale.cat3
 MANLINKS+=SG_Node.3:SG_Rotatev.3
 CATLINKS+=SG_Node.cat3:SG_Rotatev.cat3
+MANLINKS+=SG_Node.3:SG_NodeInvalidate.3
+CATLINKS+=SG_Node.cat3:SG_NodeInvalidate.cat3
 MANLINKS+=SG_Node.3:SG_GetNodeTransform.3
 CATLINKS+=SG_Node.cat3:SG_GetNodeTransform.cat3
 MANLINKS+=SG_Node.3:SG_GetNodeTransformInverse.3
@@ -181,6 +185,8 @@ MANLINKS+=SG_Object.3:SG_FacetFromTri3.3
 CATLINKS+=SG_Object.cat3:SG_FacetFromTri3.cat3
 MANLINKS+=SG_Object.3:SG_FacetFromQuad4.3
 CATLINKS+=SG_Object.cat3:SG_FacetFromQuad4.cat3
+MANLINKS+=SG_Object.3:SG_FacetsFromArray.3
+CATLINKS+=SG_Object.cat3:SG_FacetsFromArray.cat3
 MANLINKS+=SG_Object.3:SG_FacetDelete.3
 CATLINKS+=SG_Object.cat3:SG_FacetDelete.cat3
 MANLINKS+=SG_Object.3:SG_FacetNormal.3
@@ -201,6 +207,12 @@ MANLINKS+=SG_Object.3:SG_ObjectEdgeMatrix.3
 CATLINKS+=SG_Object.cat3:SG_ObjectEdgeMatrix.cat3
 MANLINKS+=SG_Object.3:SG_ObjectFacetMatrix.3
 CATLINKS+=SG_Object.cat3:SG_ObjectFacetMatrix.cat3
+MANLINKS+=SG_Object.3:SG_ObjectGetBounds.3
+CATLINKS+=SG_Object.cat3:SG_ObjectGetBounds.cat3
+MANLINKS+=SG_Object.3:SG_ObjectInvalidate.3
+CATLINKS+=SG_Object.cat3:SG_ObjectInvalidate.cat3
+MANLINKS+=SG_Object.3:SG_ObjectFreeCached.3
+CATLINKS+=SG_Object.cat3:SG_ObjectFreeCached.cat3
 MANLINKS+=SG_Plane.3:SG_PlaneNew.3
 CATLINKS+=SG_Plane.cat3:SG_PlaneNew.cat3
 MANLINKS+=SG_Point.3:SG_PointNew.3
@@ -166,6 +166,19 @@ Init(void *_Nonnull obj)
 	sg->def.lt[0] = NULL;
 	sg->def.lt[1] = NULL;
 	TAILQ_INIT(&sg->nodes);
+	sg->drawList = NULL;
+	sg->drawT = NULL;
+	sg->nDrawList = 0;
+	sg->maxDrawList = 0;
+}
+
+static void
+Destroy(void *_Nonnull obj)
+{
+	SG *sg = obj;
+
+	Free(sg->drawList);
+	Free(sg->drawT);
 }
 
 static int
@@ -284,7 +297,7 @@ AG_ObjectClass sgClass = {
 	{ 1,0 },
 	Init,
 	NULL,		/* reset */
-	NULL,		/* destroy */
+	Destroy,
 	Load,
 	Save,
 	SG_Edit
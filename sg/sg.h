@@ -123,13 +123,28 @@ typedef struct sg_node {
 	Uint flags;
 #define SG_NODE_SELECTED	0x01	/* Selection flag */
 #define SG_NODE_HIDE		0x02	/* Disable rendering */
+#define SG_NODE_TGLOB_DIRTY	0x04	/* Cached Tglob is stale */
+#define SG_NODE_TGLOBINV_DIRTY	0x08	/* Cached TglobInv is stale */
+#define SG_NODE_SAVED		(SG_NODE_SELECTED | SG_NODE_HIDE)
+#define SG_NODE_DIRTY		(SG_NODE_TGLOB_DIRTY | SG_NODE_TGLOBINV_DIRTY)
 	struct sg *_Nullable sg;	/* Back pointer to sg */
 	M_Matrix44 T;			/* Transformation from parent */
+	M_Matrix44 Tglob;		/* Cached SG_GetNodeTransform() */
+	M_Matrix44 TglobInv;		/* Cached SG_GetNodeTransformInverse() */
+	Uint drawIdx;			/* Index into SG draw list */
 	AG_TAILQ_ENTRY(sg_node) rnodes;	/* Used for quick inverse traversal */
 	AG_TAILQ_ENTRY(sg_node) nodes;	/* For flat list */
 	AG_TAILQ_HEAD_(sg_action) actions; /* Enabled node actions */
 } SG_Node;
 
+/* Entry in the flattened draw list of a scene. */
+typedef struct sg_draw_ent {
+	struct sg_node *_Nonnull node;	/* Node to render */
+	void (*_Nullable draw)(void *_Nonnull, struct sg_view *_Nonnull);
+	int parent;			/* Index of parent entry (or -1) */
+	Uint nDesc;			/* Number of descendants */
+} SG_DrawEnt;
+
 /* Scene graph object */
 typedef struct sg {
 	struct ag_object _inherit;
@@ -148,6 +163,10 @@ typedef struct sg {
 		struct sg_light  *_Nullable lt[2];	/* Default lights */
 	} def;
 	AG_TAILQ_HEAD_(sg_node) nodes;	/* Flat list of nodes */
+	SG_DrawEnt *_Nullable drawList;	/* Nodes in draw order */
+	M_Matrix44 *_Nullable drawT;	/* Modelview matrices (for draw) */
+	Uint nDrawList;			/* Draw list entries (0 = rebuild) */
+	Uint maxDrawList;		/* Allocated draw list entries */
 } SG;
 
 #define SGNODE(node) ((struct sg_node *)(node))
@@ -185,6 +204,7 @@ typedef struct sg {
 #include <agar/sg/sg_polygon.h>
 #include <agar/sg/sg_triangle.h>
 #include <agar/sg/sg_rectangle.h>
+#include <agar/sg/sg_octree.h>
 #include <agar/sg/sg_object.h>
 #include <agar/sg/sg_polyball.h>
 #include <agar/sg/sg_polybox.h>
@@ -216,6 +236,7 @@ void           SG_NodeDraw(SG *_Nonnull, SG_Node *_Nonnull, struct sg_view *_Non
 void *_Nonnull SG_NodeEdit(void *_Nonnull);
 void           SG_GetNodeTransform(void *_Nonnull, M_Matrix44 *_Nonnull);
 void           SG_GetNodeTransformInverse(void *_Nonnull, M_Matrix44 *_Nonnull);
+void           SG_NodeInvalidate(void *_Nonnull);
 
 void SG_ActionInit(SG_Action *_Nonnull, enum sg_action_type);
 void SG_ActionCopy(SG_Action *_Nonnull, const SG_Action *_Nonnull);
@@ -228,27 +249,34 @@ SG_Action *_Nullable SG_FetchAction(void *_Nonnull, enum sg_action_type);
 int  SG_EnableAction(void *_Nonnull, enum sg_action_type);
 void SG_DisableAction(void *_Nonnull, enum sg_action_type);
 
-#define SG_Identity(n)		M_MatIdentity44v(&SGNODE(n)->T)
-
-#define SG_Translatev(n,v)	M_MatTranslate44v(&SGNODE(n)->T,(v))
-#define SG_Translate(n,x,y,z)	M_MatTranslate44(&SGNODE(n)->T,(x),(y),(z))
-#define SG_TranslateX(n,t)	M_MatTranslate44X(&SGNODE(n)->T,(t))
-#define SG_TranslateY(n,t)	M_MatTranslate44Y(&SGNODE(n)->T,(t))
-#define SG_TranslateZ(n,t)	M_MatTranslate44Z(&SGNODE(n)->T,(t))
-
-#define SG_Scale(n,s)		M_MatUniScale44(&SGNODE(n)->T,(s))
-
-#define SG_Rotatev(n,a,d)	M_MatRotateAxis44(&SGNODE(n)->T,(a),(d))
-#define SG_RotateI(n,d)		M_MatRotate44I(&SGNODE(n)->T,(d))
-#define SG_RotateJ(n,d)		M_MatRotate44J(&SGNODE(n)->T,(d))
-#define SG_RotateK(n,d)		M_MatRotate44K(&SGNODE(n)->T,(d))
-#define SG_Rotatevd(n,a,v)	M_MatRotateAxis44(&SGNODE(n)->T,M_Radians(a),(v))
-#define SG_RotateId(n,a)	M_MatRotate44I(&SGNODE(n)->T,M_Radians(a))
-#define SG_RotateJd(n,a)	M_MatRotate44J(&SGNODE(n)->T,M_Radians(a))
-#define SG_RotateKd(n,a)	M_MatRotate44K(&SGNODE(n)->T,M_Radians(a))
-
-#define SG_Orbitv(n,p,a,d)	M_MatOrbitAxis44(&SGNODE(n)->T, \
-				M_VecSub3((p),SG_NodePos(n)),(a),(d));
+/*
+ * Modify the transformation matrix of a node (and invalidate the cached
+ * world transforms of the node and its descendants).
+ */
+#define SG_NodeTransform(n,op) \
+	do { op; SG_NodeInvalidate(n); } while (0)
+
+#define SG_Identity(n)		SG_NodeTransform((n), M_MatIdentity44v(&SGNODE(n)->T))
+
+#define SG_Translatev(n,v)	SG_NodeTransform((n), M_MatTranslate44v(&SGNODE(n)->T,(v)))
+#define SG_Translate(n,x,y,z)	SG_NodeTransform((n), M_MatTranslate44(&SGNODE(n)->T,(x),(y),(z)))
+#define SG_TranslateX(n,t)	SG_NodeTransform((n), M_MatTranslate44X(&SGNODE(n)->T,(t)))
+#define SG_TranslateY(n,t)	SG_NodeTransform((n), M_MatTranslate44Y(&SGNODE(n)->T,(t)))
+#define SG_TranslateZ(n,t)	SG_NodeTransform((n), M_MatTranslate44Z(&SGNODE(n)->T,(t)))
+
+#define SG_Scale(n,s)		SG_NodeTransform((n), M_MatUniScale44(&SGNODE(n)->T,(s)))
+
+#define SG_Rotatev(n,a,d)	SG_NodeTransform((n), M_MatRotateAxis44(&SGNODE(n)->T,(a),(d)))
+#define SG_RotateI(n,d)		SG_NodeTransform((n), M_MatRotate44I(&SGNODE(n)->T,(d)))
+#define SG_RotateJ(n,d)		SG_NodeTransform((n), M_MatRotate44J(&SGNODE(n)->T,(d)))
+#define SG_RotateK(n,d)		SG_NodeTransform((n), M_MatRotate44K(&SGNODE(n)->T,(d)))
+#define SG_Rotatevd(n,a,v)	SG_Rotatev((n),M_Radians(a),(v))
+#define SG_RotateId(n,a)	SG_RotateI((n),M_Radians(a))
+#define SG_RotateJd(n,a)	SG_RotateJ((n),M_Radians(a))
+#define SG_RotateKd(n,a)	SG_RotateK((n),M_Radians(a))
+
+#define SG_Orbitv(n,p,a,d)	SG_NodeTransform((n), M_MatOrbitAxis44(&SGNODE(n)->T, \
+				M_VecSub3((p),SG_NodePos(n)),(a),(d)))
 #define SG_Orbitvd(n,p,a,d)	SG_Orbitv((n),(p),(a),M_Radians(d))
 
 /* Return the absolute (world) coordinates of a node. */
@@ -70,6 +70,7 @@ SG_CameraNewDuplicate(void *parent, const char *name, SG_Camera *cOrig)
 	cNew->focus[0] = cOrig->focus[0];
 	cNew->focus[1] = cOrig->focus[1];
 	SGNODE(cNew)->T = SGNODE(cOrig)->T;
+	SG_NodeInvalidate(cNew);
 
 	AG_ObjectAttach(parent, cNew);
 
@@ -526,8 +527,7 @@ Edit(void *_Nonnull obj, SG_View *_Nullable sgv)
 
 	ntab = AG_NotebookAdd(nb, _("Pos"), AG_BOX_VERT);
 	{
-		M_EditTranslate3Mp(ntab, _("Eye coordinates: "),
-		    &SGNODE(cam)->T, lock);
+		SG_GUI_EditTranslate(ntab, _("Eye coordinates: "), SGNODE(cam));
 	}
 
 	ntab = AG_NotebookAdd(nb, _("Polygons"), AG_BOX_VERT);
@@ -765,7 +765,7 @@ SG_CameraMoveMouse(SG_Camera *cam, SG_View *sv, int xrel, int yrel, int zrel)
 	T->m[2][3] += m.z;
 #else
 	/* Translate along the local camera axis. */
-	M_MatTranslate44v(&SGNODE(cam)->T, m);
+	SG_Translatev(cam, m);
 #endif
 	AG_ObjectUnlock(cam);
 	if (cam->pmode == SG_CAMERA_ORTHOGRAPHIC) {
@@ -273,6 +273,37 @@ SG_GUI_NodePopupMenu(AG_Event *event)
 	AG_PopupShowAt(pm, x, y);
 }
 
+static void
+TranslateChanged(AG_Event *_Nonnull event)
+{
+	SG_Node *node = AG_PTR(1);
+
+	AG_ObjectLock(node);
+	SG_NodeInvalidate(node);
+	AG_ObjectUnlock(node);
+}
+
+/*
+ * Create widgets for editing the translation of a node. This is preferred
+ * to M_EditTranslate3() since it keeps the cached world transforms of the
+ * node and its descendants up to date.
+ */
+void *
+SG_GUI_EditTranslate(void *parent, const char *label, SG_Node *node)
+{
+	AG_Box *box;
+	AG_Numerical *num;
+
+	box = M_EditTranslate3Mp(parent, label, &node->T,
+	    &OBJECT(node)->pvt.lock);
+
+	OBJECT_FOREACH_CLASS(num, box, ag_numerical, "AG_Widget:AG_Numerical:*")
+		AG_SetEvent(num, "numerical-changed", TranslateChanged,
+		    "%p", node);
+
+	return (box);
+}
+
 static void
 EditNode(AG_Event *_Nonnull event)
 {
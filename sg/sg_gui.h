@@ -61,6 +61,7 @@ SG_Node   *SG_GUI_CreateNode(SG *, AG_ObjectClass *);
 void	   SG_GUI_DeleteNode(SG_Node *, SG_View *);
 void       SG_GUI_NodePopupMenu(AG_Event *);
 void       SG_GUI_EditNode(SG_Node *, AG_Widget *, SG_View *);
+void      *SG_GUI_EditTranslate(void *, const char *, SG_Node *);
 __END_DECLS
 #include <agar/sg/close.h>
 
@@ -266,6 +266,7 @@ Destroy(void *_Nonnull obj)
 {
 	SG_Image *si = obj;
 
+	AG_SurfaceLoadCancel(si);
 	gluDeleteTess(si->to);
 }
 
@@ -371,14 +372,15 @@ UpdateMode(AG_Event *_Nonnull event)
 	SG_ImageFreeCached(si);
 }
 
+/* Set the image surface once its file has been decoded. */
 static void
-LoadImageFile(AG_Event *_Nonnull event)
+LoadImageFileDone(AG_Event *_Nonnull event)
 {
-	SG_Image *si = AG_PTR(1);
-	char *path = AG_STRING(2);
-	AG_Surface *su;
+	SG_Image *si = AG_SELF();
+	const AG_Surface *su = AG_PTR(1);
+	const char *path = AG_STRING(2);
 
-	if ((su = AG_SurfaceFromFile(path)) == NULL) {
+	if (su == NULL) {
 		AG_TextMsgFromError();
 		return;
 	}
@@ -386,7 +388,16 @@ LoadImageFile(AG_Event *_Nonnull event)
 		SG_ImageSetShapeAuto(si);
 		Strlcpy(si->path, path, sizeof(si->path));
 	}
-	AG_SurfaceFree(su);
+}
+
+static void
+LoadImageFile(AG_Event *_Nonnull event)
+{
+	SG_Image *si = AG_PTR(1);
+	char *path = AG_STRING(2);
+
+	if (AG_SurfaceLoadAsync(si, path, LoadImageFileDone, NULL) == -1)
+		AG_TextMsgFromError();
 }
 
 static void
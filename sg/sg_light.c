@@ -211,8 +211,7 @@ Edit(void *_Nonnull obj, SG_View *_Nullable sgv)
 	nb = AG_NotebookNew(NULL, AG_NOTEBOOK_EXPAND);
 	ntab = AG_NotebookAdd(nb, _("Src"), AG_BOX_VERT);
 	{
-		M_EditTranslate3Mp(ntab, _("Position: "),
-		    &SGNODE(lt)->T, lock);
+		SG_GUI_EditTranslate(ntab, _("Position: "), SGNODE(lt));
 
 		num = AG_NumericalNew(ntab, 0, NULL, _("Priority: "));
 		AG_BindIntMp(num, "value", &lt->pri, lock);
@@ -36,10 +36,22 @@
 #include <ctype.h>
 #include <stdlib.h>
 
+#include <agar/config/_mk_have_unistd_h.h>
+#ifdef _MK_HAVE_UNISTD_H
+# include <unistd.h>
+# if defined(_POSIX_MAPPED_FILES) && (_POSIX_MAPPED_FILES > 0)
+#  include <sys/mman.h>
+#  define PLY_USE_MMAP
+# endif
+#endif
+
 #define PLY_MAX_HEADER		256
 #define PLY_MAX_ELEMENT_NAME	32
 #define PLY_MAX_PROP_NAME	32
 #define PLY_MAX_LIST_ITEMS	128
+#define PLY_MAX_THREADS		8	/* Max vertex decoding threads */
+#define PLY_THREAD_MIN_VERTS	65536	/* Min vertices per thread */
+#define PLY_FACET_CHUNK		65536	/* Facets per SG_FacetsFromArray() */
 
 enum ply_prop_type {
 	PLY_INT8,
@@ -60,6 +72,10 @@ static const char *plyTypeNamesLegacy[] = {
 	"char", "short", "int", "uchar", "ushort", "uint",
 	"float", "double"
 };
+static const Uint plyTypeSizes[] = {
+	1, 2, 4, 1, 2, 4,
+	4, 8
+};
 
 enum ply_std_prop {
 	PLY_VERTEX_INDICES,
@@ -694,6 +710,532 @@ fail:
 	return (-1);
 }
 
+/*
+ * Fast path for binary PLY files. The body of the file is mapped into
+ * memory, the (fixed-size) vertex records are decoded in parallel and the
+ * faces are inserted in batches with SG_FacetsFromArray().
+ */
+
+/* Property of a vertex record. */
+typedef struct ply_vtx_col {
+	Uint offs;				/* Offset in record */
+	enum ply_prop_type type;		/* Type of item */
+	enum ply_std_prop std;			/* Target (or PLY_STD_PROP_LAST) */
+} PLY_VtxCol;
+
+/* Range of vertex records to decode. */
+typedef struct ply_vtx_job {
+	const Uint8 *_Nonnull src;		/* First record */
+	SG_Vertex *_Nonnull dst;		/* First target vertex */
+	Uint count;				/* Number of records */
+	Uint stride;				/* Record size in bytes */
+	const PLY_VtxCol *_Nonnull cols;	/* Properties */
+	Uint nCols;
+	int swap;				/* Byte order differs */
+	const SG_Vertex *_Nonnull vInit;	/* Default vertex */
+} PLY_VtxJob;
+
+/* Read a number in any PLY type from memory. */
+static __inline__ M_Real
+DecodeReal(const Uint8 *_Nonnull p, enum ply_prop_type type, int swap)
+{
+	union {
+		Uint16 u16;
+		Sint16 s16;
+		Uint32 u32;
+		Sint32 s32;
+		float flt;
+		double dbl;
+		Uint8 b[8];
+	} d;
+	int i;
+
+	switch (type) {
+	case PLY_UINT8:
+		return (M_Real)p[0];
+	case PLY_INT8:
+		return (M_Real)(Sint8)p[0];
+	case PLY_UINT16:
+	case PLY_INT16:
+		memcpy(&d.u16, p, 2);
+		if (swap) {
+			d.u16 = AG_Swap16(d.u16);
+		}
+		return (type == PLY_INT16) ? (M_Real)d.s16 : (M_Real)d.u16;
+	case PLY_UINT32:
+	case PLY_INT32:
+	case PLY_FLOAT32:
+		memcpy(&d.u32, p, 4);
+		if (swap) {
+			d.u32 = AG_Swap32(d.u32);
+		}
+		return (type == PLY_FLOAT32) ? (M_Real)d.flt :
+		       (type == PLY_INT32) ? (M_Real)d.s32 : (M_Real)d.u32;
+	case PLY_FLOAT64:
+		if (swap) {
+			for (i = 0; i < 8; i++)
+				d.b[i] = p[7-i];
+		} else {
+			memcpy(d.b, p, 8);
+		}
+		return (M_Real)d.dbl;
+	default:
+		return (0.0);
+	}
+}
+
+/* Read an integer list count or index from memory. */
+static __inline__ Uint
+DecodeUint(const Uint8 *_Nonnull p, enum ply_prop_type type, int swap)
+{
+	Uint16 u16;
+	Uint32 u32;
+
+	switch (type) {
+	case PLY_INT8:
+	case PLY_UINT8:
+		return (Uint)p[0];
+	case PLY_INT16:
+	case PLY_UINT16:
+		memcpy(&u16, p, 2);
+		return (Uint)(swap ? AG_Swap16(u16) : u16);
+	case PLY_INT32:
+	case PLY_UINT32:
+		memcpy(&u32, p, 4);
+		return (Uint)(swap ? AG_Swap32(u32) : u32);
+	default:
+		return (0);
+	}
+}
+
+static __inline__ void
+SetVertexProp(SG_Vertex *_Nonnull v, enum ply_std_prop std, M_Real fv)
+{
+	switch (std) {
+	case PLY_X:	v->v.x = fv;			break;
+	case PLY_Y:	v->v.y = fv;			break;
+	case PLY_Z:	v->v.z = fv;			break;
+	case PLY_NX:	v->n.x = fv;			break;
+	case PLY_NY:	v->n.y = fv;			break;
+	case PLY_NZ:	v->n.z = fv;			break;
+	case PLY_U:	v->st.x = fv;			break;
+	case PLY_V:	v->st.y = fv;			break;
+	case PLY_RED:	v->c.r = fv/255.0;		break;
+	case PLY_GREEN:	v->c.g = fv/255.0;		break;
+	case PLY_BLUE:	v->c.b = fv/255.0;		break;
+	default:					break;
+	}
+}
+
+static void
+DecodeVertices(const PLY_VtxJob *_Nonnull job)
+{
+	const Uint8 *p = job->src;
+	SG_Vertex *v = job->dst;
+	Uint i, j;
+
+	for (i = 0; i < job->count; i++, v++, p += job->stride) {
+		*v = *job->vInit;
+
+		for (j = 0; j < job->nCols; j++) {
+			const PLY_VtxCol *col = &job->cols[j];
+
+			SetVertexProp(v, col->std,
+			    DecodeReal(&p[col->offs], col->type, job->swap));
+		}
+	}
+}
+
+#ifdef AG_THREADS
+static void *_Nullable
+DecodeVerticesThread(void *_Nullable p)
+{
+	DecodeVertices((const PLY_VtxJob *)p);
+	return (NULL);
+}
+#endif
+
+/* Return the number of threads to use for decoding count vertices. */
+static Uint
+GetDecodeThreads(Uint count)
+{
+	Uint nThreads = 1;
+#if defined(AG_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+	long nCPUs;
+
+	if ((nCPUs = sysconf(_SC_NPROCESSORS_ONLN)) > 1) {
+		nThreads = (nCPUs > PLY_MAX_THREADS) ? PLY_MAX_THREADS :
+		                                       (Uint)nCPUs;
+	}
+#endif
+	if (count/PLY_THREAD_MIN_VERTS < nThreads) {
+		nThreads = count/PLY_THREAD_MIN_VERTS;
+	}
+	return (nThreads > 0) ? nThreads : 1;
+}
+
+/* Decode a vertex element and append the vertices to the object. */
+static int
+LoadVerticesFast(SG_Object *_Nonnull so, PLY_Element *_Nonnull el,
+    const Uint8 *_Nonnull *_Nonnull p, const Uint8 *_Nonnull pEnd, int swap,
+    Uint flags)
+{
+	PLY_VtxCol cols[PLY_STD_PROP_LAST];
+	PLY_VtxJob jobs[PLY_MAX_THREADS];
+#ifdef AG_THREADS
+	AG_Thread th[PLY_MAX_THREADS];
+	void *rv;
+#endif
+	PLY_Prop *prop;
+	SG_Vertex *vtxNew, vInit;
+	size_t nVtxNew;
+	Uint nCols = 0, stride = 0, i, nThreads, nPer;
+
+	TAILQ_FOREACH(prop, &el->props, props) {
+		enum ply_std_prop std = prop->std;
+
+		if (((std == PLY_NX || std == PLY_NY || std == PLY_NZ) &&
+		     !(flags & SG_PLY_LOAD_VTX_NORMALS)) ||
+		    ((std == PLY_U || std == PLY_V) &&
+		     !(flags & SG_PLY_LOAD_TEXCOORDS)) ||
+		    ((std == PLY_RED || std == PLY_GREEN || std == PLY_BLUE) &&
+		     !(flags & SG_PLY_LOAD_VTX_COLORS))) {
+			std = PLY_STD_PROP_LAST;
+		}
+		if (std < PLY_X || std > PLY_BLUE) {
+			stride += plyTypeSizes[prop->type];
+			continue;
+		}
+		if (nCols == PLY_STD_PROP_LAST) {
+			AG_SetError("Too many vertex properties");
+			return (-1);
+		}
+		cols[nCols].offs = stride;
+		cols[nCols].type = prop->type;
+		cols[nCols].std = std;
+		nCols++;
+		stride += plyTypeSizes[prop->type];
+	}
+	if (stride == 0) {
+		AG_SetError("Vertex element has no properties");
+		return (-1);
+	}
+	if (el->count > 0 &&
+	    (size_t)stride > (size_t)(pEnd - *p) / el->count) {
+		AG_SetError("Premature end of PLY file");
+		return (-1);
+	}
+	nVtxNew = (size_t)so->nVtx + el->count;
+	if (el->count > AG_UINT_MAX - so->nVtx ||
+	    nVtxNew > AG_SIZE_MAX / sizeof(SG_Vertex)) {
+		AG_SetError("Too many vertices");
+		return (-1);
+	}
+	if ((vtxNew = TryRealloc(so->vtx, nVtxNew*sizeof(SG_Vertex))) == NULL) {
+		return (-1);
+	}
+	so->vtx = vtxNew;
+
+	SG_VertexInit(&vInit);
+	vInit.c.r = 0.5;
+	vInit.c.g = 0.5;
+	vInit.c.b = 0.5;
+
+	nThreads = GetDecodeThreads(el->count);
+	nPer = el->count / nThreads;
+	for (i = 0; i < nThreads; i++) {
+		PLY_VtxJob *job = &jobs[i];
+
+		job->src = *p + (size_t)i*nPer*stride;
+		job->dst = &so->vtx[so->nVtx + i*nPer];
+		job->count = (i == nThreads-1) ? el->count - i*nPer : nPer;
+		job->stride = stride;
+		job->cols = cols;
+		job->nCols = nCols;
+		job->swap = swap;
+		job->vInit = &vInit;
+	}
+#ifdef AG_THREADS
+	for (i = 1; i < nThreads; i++) {
+		if (AG_ThreadTryCreate(&th[i], DecodeVerticesThread,
+		    &jobs[i]) == -1) {
+			DecodeVertices(&jobs[i]);	/* Do it ourselves */
+			jobs[i].count = 0;
+		}
+	}
+	DecodeVertices(&jobs[0]);
+	for (i = 1; i < nThreads; i++) {
+		if (jobs[i].count > 0)
+			AG_ThreadJoin(th[i], &rv);
+	}
+#else
+	for (i = 0; i < nThreads; i++)
+		DecodeVertices(&jobs[i]);
+#endif
+	so->nVtx += el->count;
+	*p += (size_t)el->count*stride;
+	return (0);
+}
+
+/*
+ * Compute the size in bytes of the element record at s, checking that the
+ * record (including the items of its lists) lies entirely before pEnd.
+ */
+static int
+GetRecordSize(const PLY_Element *_Nonnull el, const Uint8 *_Nonnull s,
+    const Uint8 *_Nonnull pEnd, int swap, size_t *_Nonnull len)
+{
+	const PLY_Prop *prop;
+	size_t left = (size_t)(pEnd - s), n = 0, count, size, sizeCount;
+
+	TAILQ_FOREACH(prop, &el->props, props) {
+		size = plyTypeSizes[prop->type];
+		if (prop->list) {
+			sizeCount = plyTypeSizes[prop->list_type];
+			if (left - n < sizeCount) {
+				goto premature;
+			}
+			count = DecodeUint(&s[n], prop->list_type, swap);
+			n += sizeCount;
+		} else {
+			count = 1;
+		}
+		if ((left - n) / size < count) {
+			goto premature;
+		}
+		n += count*size;
+	}
+	*len = n;
+	return (0);
+premature:
+	AG_SetError("Premature end of PLY file");
+	return (-1);
+}
+
+/*
+ * Decode a face element, inserting facets in batches. Vertex indices are
+ * relative to vBase (the first vertex of the vertex element).
+ */
+static int
+LoadFacesFast(SG_Object *_Nonnull so, PLY_Element *_Nonnull el,
+    const Uint8 *_Nonnull *_Nonnull p, const Uint8 *_Nonnull pEnd, int swap,
+    Uint vBase, Uint nVerts)
+{
+	Uint *ind;
+	Uint8 *nInd;
+	PLY_Prop *prop;
+	const Uint8 *s = *p;
+	size_t len, nEdges;
+	Uint i, j, k, nFacets = 0, nIndTotal = 0;
+
+	if ((ind = TryMalloc(PLY_FACET_CHUNK*4*sizeof(Uint))) == NULL) {
+		return (-1);
+	}
+	if ((nInd = TryMalloc(PLY_FACET_CHUNK)) == NULL) {
+		Free(ind);
+		return (-1);
+	}
+
+	/*
+	 * Size the edge and facet tables for the entire element, assuming
+	 * that the object has an Euler characteristic of 2.
+	 */
+	nEdges = (size_t)el->count + so->nVtx;
+	nEdges = (nEdges > 2) ? nEdges - 2 : 1;
+	if (nEdges == (Uint)nEdges && so->nEdgeTbl < nEdges &&
+	    SG_EdgeRehash(so, (Uint)nEdges) == -1) {
+		goto fail;
+	}
+	if (so->nFacetTbl < el->count &&
+	    SG_FacetRehash(so, el->count) == -1)
+		goto fail;
+
+	for (i = 0; i < el->count; i++) {
+		/* Validate the whole record before decoding it. */
+		if (GetRecordSize(el, s, pEnd, swap, &len) == -1) {
+			goto fail;
+		}
+		TAILQ_FOREACH(prop, &el->props, props) {
+			size_t size = plyTypeSizes[prop->type];
+			Uint count;
+
+			if (!prop->list) {
+				s += size;
+				continue;
+			}
+			count = DecodeUint(s, prop->list_type, swap);
+			s += plyTypeSizes[prop->list_type];
+			if (prop->std != PLY_VERTEX_INDICES) {
+				s += (size_t)count*size;
+				continue;
+			}
+			if (count != 3 && count != 4) {
+				AG_SetError("%u-sided faces not supported",
+				    count);
+				goto fail;
+			}
+			for (j = 0; j < count; j++, s += size) {
+				k = DecodeUint(s, prop->type, swap);
+				if (k >= nVerts) {
+					AG_SetError("Bad ref %u in face %u",
+					    k, i);
+					goto fail;
+				}
+				ind[nIndTotal++] = vBase + k;
+			}
+			nInd[nFacets++] = (Uint8)count;
+
+			if (nFacets == PLY_FACET_CHUNK) {
+				if (SG_FacetsFromArray(so, ind, nInd,
+				    nFacets) == -1) {
+					goto fail;
+				}
+				nFacets = 0;
+				nIndTotal = 0;
+			}
+		}
+	}
+	if (nFacets > 0 &&
+	    SG_FacetsFromArray(so, ind, nInd, nFacets) == -1)
+		goto fail;
+
+	*p = s;
+	Free(nInd);
+	Free(ind);
+	return (0);
+fail:
+	Free(nInd);
+	Free(ind);
+	return (-1);
+}
+
+/* Skip over an element (other than vertices and faces). */
+static int
+SkipElementFast(PLY_Element *_Nonnull el, const Uint8 *_Nonnull *_Nonnull p,
+    const Uint8 *_Nonnull pEnd, int swap)
+{
+	const Uint8 *s = *p;
+	size_t len;
+	Uint i;
+
+	for (i = 0; i < el->count; i++) {
+		if (GetRecordSize(el, s, pEnd, swap, &len) == -1) {
+			return (-1);
+		}
+		s += len;
+	}
+	*p = s;
+	return (0);
+}
+
+/* Return 1 if the fast binary loader can handle the given file. */
+static int
+CanLoadFast(const PLY_Info *_Nonnull ply, Uint flags)
+{
+	PLY_Element *el;
+	PLY_Prop *prop;
+	int nVertexElements = 0;
+
+	if (ply->format == PLY_ASCII || (flags & SG_PLY_DUP_VERTICES)) {
+		return (0);
+	}
+	TAILQ_FOREACH(el, &ply->elements, elements) {
+		switch (el->std) {
+		case PLY_VERTEX:
+			TAILQ_FOREACH(prop, &el->props, props) {
+				if (prop->list)		/* Not fixed-size */
+					return (0);
+			}
+			nVertexElements++;
+			break;
+		case PLY_FACE:
+			if (nVertexElements != 1)
+				return (0);
+			break;
+		default:
+			break;
+		}
+	}
+	return (nVertexElements == 1);
+}
+
+static int
+LoadBinaryFast(SG_Object *_Nonnull so, PLY_Info *_Nonnull ply,
+    FILE *_Nonnull f, Uint flags)
+{
+	const Uint8 *p, *pEnd;
+	Uint8 *buf;
+	PLY_Element *el;
+	long offs, size;
+	Uint vBase = 0, nVerts = 0;
+	int swap, rv = -1;
+#ifdef PLY_USE_MMAP
+	void *map;
+#endif
+
+#if AG_BYTEORDER == AG_BIG_ENDIAN
+	swap = (ply->format == PLY_BIN_LE);
+#else
+	swap = (ply->format == PLY_BIN_BE);
+#endif
+	if ((offs = ftell(f)) == -1 ||
+	    fseek(f, 0, SEEK_END) == -1 ||
+	    (size = ftell(f)) == -1) {
+		AG_SetError("Seek failed: %s", strerror(errno));
+		return (-1);
+	}
+#ifdef PLY_USE_MMAP
+	if ((map = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE,
+	    fileno(f), 0)) == MAP_FAILED) {
+		AG_SetError("mmap: %s", strerror(errno));
+		return (-1);
+	}
+	buf = NULL;
+	p = (const Uint8 *)map + offs;
+	pEnd = (const Uint8 *)map + size;
+#else
+	if ((buf = TryMalloc((size_t)(size - offs) + 1)) == NULL) {
+		return (-1);
+	}
+	if (fseek(f, offs, SEEK_SET) == -1 ||
+	    fread(buf, 1, (size_t)(size - offs), f) < (size_t)(size - offs)) {
+		AG_SetError("Read error");
+		goto out;
+	}
+	p = buf;
+	pEnd = buf + (size - offs);
+#endif
+	TAILQ_FOREACH(el, &ply->elements, elements) {
+		switch (el->std) {
+		case PLY_VERTEX:
+			vBase = so->nVtx;
+			nVerts = el->count;
+			if (LoadVerticesFast(so, el, &p, pEnd, swap, flags) == -1) {
+				goto out;
+			}
+			break;
+		case PLY_FACE:
+			if (LoadFacesFast(so, el, &p, pEnd, swap,
+			    vBase, nVerts) == -1) {
+				goto out;
+			}
+			break;
+		default:
+			if (SkipElementFast(el, &p, pEnd, swap) == -1) {
+				goto out;
+			}
+			break;
+		}
+	}
+	rv = 0;
+out:
+#ifdef PLY_USE_MMAP
+	munmap(map, (size_t)size);
+#endif
+	Free(buf);
+	return (rv);
+}
+
 int
 SG_ObjectLoadPLY(void *obj, const char *path, Uint flags)
 {
@@ -839,12 +1381,20 @@ SG_ObjectLoadPLY(void *obj, const char *path, Uint flags)
 		break;
 	case PLY_BIN_BE:
 	case PLY_BIN_LE:
-		if (LoadBinary(so, &ply, f, flags) == -1) {
-			AG_ObjectUnlock(so);
-			goto fail;
+		if (CanLoadFast(&ply, flags)) {
+			if (LoadBinaryFast(so, &ply, f, flags) == -1) {
+				AG_ObjectUnlock(so);
+				goto fail;
+			}
+		} else {
+			if (LoadBinary(so, &ply, f, flags) == -1) {
+				AG_ObjectUnlock(so);
+				goto fail;
+			}
 		}
 		break;
 	}
+	SG_ObjectInvalidate(so);
 	AG_ObjectUnlock(so);
 
 	fclose(f);
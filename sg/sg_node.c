@@ -49,6 +49,8 @@ Attached(AG_Event *_Nonnull event)
 	AG_ObjectLock(sg);
 	TAILQ_INSERT_TAIL(&sg->nodes, node, nodes);
 	node->sg = sg;
+	sg->nDrawList = 0;
+	SG_NodeInvalidate(node);
 	AG_ObjectUnlock(sg);
 }
 
@@ -69,6 +71,8 @@ Detached(AG_Event *_Nonnull event)
 	AG_ObjectLock(sg);
 	TAILQ_REMOVE(&sg->nodes, node, nodes);
 	node->sg = NULL;
+	sg->nDrawList = 0;
+	SG_NodeInvalidate(node);
 	AG_ObjectUnlock(sg);
 }
 
@@ -77,8 +81,12 @@ Init(void *_Nonnull obj)
 {
 	SG_Node *node = obj;
 
-	node->flags = 0;
+	node->flags = SG_NODE_DIRTY;
+	node->sg = NULL;
+	node->drawIdx = 0;
 	M_MatIdentity44v(&node->T);
+	M_MatIdentity44v(&node->Tglob);
+	M_MatIdentity44v(&node->TglobInv);
 	TAILQ_INIT(&node->actions);
 
 	AG_SetEvent(node, "attached", Attached, NULL);
@@ -105,8 +113,10 @@ Load(void *_Nonnull obj, AG_DataSource *_Nonnull buf, const AG_Version *_Nonnull
 {
 	SG_Node *node = obj;
 
-	node->flags = (Uint)AG_ReadUint32(buf);
+	node->flags = ((Uint)AG_ReadUint32(buf) & SG_NODE_SAVED) |
+	              SG_NODE_DIRTY;
 	M_ReadMatrix44v(buf, &node->T);
+	SG_NodeInvalidate(node);
 	return (0);
 }
 
@@ -115,7 +125,7 @@ Save(void *_Nonnull obj, AG_DataSource *_Nonnull buf)
 {
 	SG_Node *node = obj;
 
-	AG_WriteUint32(buf, (Uint32)node->flags);
+	AG_WriteUint32(buf, (Uint32)(node->flags & SG_NODE_SAVED));
 	M_WriteMatrix44(buf, &node->T);
 	return (0);
 }
@@ -164,9 +174,78 @@ SG_NodeEdit(void *obj)
 	return (win);
 }
 
+/* Return the parent of a node if it is also an SG_Node. */
+static __inline__ SG_Node *_Nullable
+ParentNode(SG_Node *_Nonnull node)
+{
+	AG_Object *parent = OBJECT(node)->parent;
+
+	if (parent == NULL || !AG_OfClass(parent, "SG_Node:*")) {
+		return (NULL);
+	}
+	return (SG_Node *)parent;
+}
+
+/*
+ * Flag the cached world transforms of a node and its descendants as
+ * stale. This must be called whenever the T matrix of a node is modified
+ * directly (the SG_Translate(), SG_Rotate() and SG_Scale() family of
+ * macros do this automatically).
+ */
+void
+SG_NodeInvalidate(void *obj)
+{
+	SG_Node *node = obj, *chld;
+
+	/*
+	 * If both caches are already stale, so are those of every
+	 * descendant (caches are only refreshed from the top down).
+	 */
+	if ((node->flags & SG_NODE_DIRTY) == SG_NODE_DIRTY)
+		return;
+
+	node->flags |= SG_NODE_DIRTY;
+	OBJECT_FOREACH_CLASS(chld, node, sg_node, "SG_Node:*")
+		SG_NodeInvalidate(chld);
+}
+
+static const M_Matrix44 *_Nonnull
+GetNodeTransform(SG_Node *_Nonnull node)
+{
+	SG_Node *parent;
+
+	if (node->flags & SG_NODE_TGLOB_DIRTY) {
+		if ((parent = ParentNode(node)) != NULL) {
+			node->Tglob = M_MatMult44(node->T,
+			    *GetNodeTransform(parent));
+		} else {
+			node->Tglob = node->T;
+		}
+		node->flags &= ~(SG_NODE_TGLOB_DIRTY);
+	}
+	return (&node->Tglob);
+}
+
+static const M_Matrix44 *_Nonnull
+GetNodeTransformInverse(SG_Node *_Nonnull node)
+{
+	SG_Node *parent;
+
+	if (node->flags & SG_NODE_TGLOBINV_DIRTY) {
+		node->TglobInv = M_MatInvert44(node->T);
+		if ((parent = ParentNode(node)) != NULL) {
+			M_MatMult44v(&node->TglobInv,
+			    GetNodeTransformInverse(parent));
+		}
+		node->flags &= ~(SG_NODE_TGLOBINV_DIRTY);
+	}
+	return (&node->TglobInv);
+}
+
 /*
  * Compute the product of the transform matrices of the given node
- * and its parents.
+ * and its parents. The result is cached until the transform of the node
+ * or one of its parents changes.
  */
 void
 SG_GetNodeTransform(void *obj, M_Matrix44 *T)
@@ -175,101 +254,173 @@ SG_GetNodeTransform(void *obj, M_Matrix44 *T)
 #ifdef AG_THREADS
 	SG *sg = node->sg;
 #endif
-	SG_Node *chld = node;
-	TAILQ_HEAD_(sg_node) rnodes = TAILQ_HEAD_INITIALIZER(rnodes);
-
-	M_MatIdentity44v(T);
-
 	AG_ObjectLock(sg);
-	while (chld != NULL) {
-		TAILQ_INSERT_TAIL(&rnodes, chld, rnodes);
-		if (OBJECT(chld)->parent == NULL ||
-		    !AG_OfClass(OBJECT(chld)->parent, "SG_Node:*")) {
-			break;
-		}
-		chld = OBJECT(chld)->parent;
-	}
-	TAILQ_FOREACH(chld, &rnodes, rnodes) {
-		M_MatMult44v(T, &chld->T);
-	}
+	*T = *GetNodeTransform(node);
 	AG_ObjectUnlock(sg);
 }
 
 /*
  * Compute the product of the inverse transform matrices of the given node
- * and its parents.
+ * and its parents. The result is cached until the transform of the node
+ * or one of its parents changes.
  */
 void
 SG_GetNodeTransformInverse(void *obj, M_Matrix44 *T)
 {
 	SG_Node *node = obj;
-	SG_Node *chld = node;
 #ifdef AG_THREADS
 	SG *sg = node->sg;
 #endif
-	TAILQ_HEAD_(sg_node) rnodes = TAILQ_HEAD_INITIALIZER(rnodes);
-
-	M_MatIdentity44v(T);
-
 	AG_ObjectLock(sg);
-	while (chld != NULL) {
-		TAILQ_INSERT_TAIL(&rnodes, chld, rnodes);
-		if (OBJECT(chld)->parent == NULL ||
-		    !AG_OfClass(OBJECT(chld)->parent, "SG_Node:*")) {
-			break;
-		}
-		chld = OBJECT(chld)->parent;
-	}
-	TAILQ_FOREACH(chld, &rnodes, rnodes) {
-		M_Matrix44 Tinv;
-
-		Tinv = M_MatInvert44(chld->T);
-		M_MatMult44v(T, &Tinv);
-	}
+	*T = *GetNodeTransformInverse(node);
 	AG_ObjectUnlock(sg);
 }
 
 /*
- * Graphically render a node and its children.
- * The SG must be locked.
+ * Append a node and its descendants to the draw list in pre-order, and
+ * resolve its draw operation.
  */
-void
-SG_NodeDraw(SG *sg, SG_Node *node, SG_View *view)
+static int
+AddToDrawList(SG *_Nonnull sg, SG_Node *_Nonnull node, int parent)
 {
 	AG_ObjectClass **hier;
-	int i, nHier;
-	M_Matrix44 Tsave, T;
+	SG_DrawEnt *ent;
 	SG_Node *chld;
+	int i, nHier, idx;
 
-	GL_FetchMatrixv(GL_MODELVIEW_MATRIX, &Tsave);
-	T = M_MatTranspose44p(&node->T);	/* OpenGL is column-major */
-	GL_MultMatrixv(&T);
+	if (sg->nDrawList+1 > sg->maxDrawList) {
+		Uint maxNew = (sg->maxDrawList > 0) ? sg->maxDrawList*2 : 32;
+		SG_DrawEnt *dlNew;
+		M_Matrix44 *TNew;
 
-	AG_ObjectLock(node);
+		if ((dlNew = TryRealloc(sg->drawList,
+		    maxNew*sizeof(SG_DrawEnt))) == NULL) {
+			return (-1);
+		}
+		sg->drawList = dlNew;
+		if ((TNew = TryRealloc(sg->drawT,
+		    maxNew*sizeof(M_Matrix44))) == NULL) {
+			return (-1);
+		}
+		sg->drawT = TNew;
+		sg->maxDrawList = maxNew;
+	}
+	idx = (int)sg->nDrawList++;
+	ent = &sg->drawList[idx];
+	ent->node = node;
+	ent->draw = NULL;
+	ent->parent = parent;
+	ent->nDesc = 0;
+	node->drawIdx = (Uint)idx;
 
-	/* Render this node. */
 	if (AG_ObjectGetInheritHier(node, &hier, &nHier) != 0) {
-		AG_FatalError(NULL);
+		return (-1);
 	}
 	for (i = nHier-1; i >= 0; i--) {
 		SG_NodeClass *nc = (SG_NodeClass *)hier[i];
 
-		if (!AG_ClassIsNamed(hier[i], "SG_Node:*") ||
-		    nc->draw == NULL) {
-			continue;
+		if (AG_ClassIsNamed(hier[i], "SG_Node:*") &&
+		    nc->draw != NULL) {
+			ent->draw = nc->draw;
+			break;
 		}
-		nc->draw(node, view);
-		break;
 	}
+	Free(hier);
 
-	/* Render child nodes. */
 	OBJECT_FOREACH_CLASS(chld, node, sg_node, "SG_Node:*") {
-		SG_NodeDraw(sg, chld, view);
+		if (AddToDrawList(sg, chld, idx) == -1)
+			return (-1);
 	}
-	AG_ObjectUnlock(node);
+	sg->drawList[idx].nDesc = sg->nDrawList - (Uint)idx - 1;
+	return (0);
+}
+
+/*
+ * Rebuild the flattened draw list of a scene (following a change in the
+ * structure of the graph). The SG must be locked.
+ */
+static int
+UpdateDrawList(SG *_Nonnull sg)
+{
+	sg->nDrawList = 0;
+	if (sg->root == NULL) {
+		return (-1);
+	}
+	if (AddToDrawList(sg, sg->root, -1) == -1) {
+		sg->nDrawList = 0;
+		return (-1);
+	}
+	return (0);
+}
+
+/*
+ * Test whether a node's geometry lies entirely outside of the view
+ * frustum, given its (row-major) modelview matrix T.
+ */
+static int
+NodeIsCulled(SG_Node *_Nonnull node, SG_View *_Nonnull view,
+    const M_Matrix44 *_Nonnull T)
+{
+	M_Vector3 min, max;
 
+	if ((view->flags & SG_VIEW_CULLING) == 0 ||
+	    !AG_OfClass(node, "SG_Node:SG_Object:*") ||
+	    SG_ObjectGetBounds(node, &min, &max) == -1) {
+		return (0);
+	}
+	if (SG_OctreeBoxInFrustum(view->frustum, T, min, max)) {
+		return (0);
+	}
+	view->nCulled++;
+	return (1);
+}
+
+/*
+ * Graphically render a node and its children.
+ *
+ * Nodes are rendered from the flattened draw list of the scene, which is
+ * only rebuilt when nodes are attached or detached. The SG must be locked.
+ */
+void
+SG_NodeDraw(SG *sg, SG_Node *node, SG_View *view)
+{
+	M_Matrix44 Tsave, T;
+	Uint i, iStart, iEnd;
+
+	if ((sg->nDrawList == 0 ||
+	     node->drawIdx >= sg->nDrawList ||
+	     sg->drawList[node->drawIdx].node != node) &&
+	    UpdateDrawList(sg) == -1) {
+		AG_FatalError(NULL);
+	}
+	iStart = node->drawIdx;
+	iEnd = iStart + sg->drawList[iStart].nDesc;
+
+	GL_FetchMatrixv(GL_MODELVIEW_MATRIX, &Tsave);
+	for (i = iStart; i <= iEnd; i++) {
+		SG_DrawEnt *ent = &sg->drawList[i];
+		SG_Node *n = ent->node;
+
+		if (i == iStart) {
+			/* OpenGL is column-major */
+			sg->drawT[i] = M_MatMult44(M_MatTranspose44p(&Tsave),
+			                           n->T);
+		} else {
+			sg->drawT[i] = M_MatMult44(sg->drawT[ent->parent],
+			                           n->T);
+		}
+		if (ent->draw == NULL ||
+		    NodeIsCulled(n, view, &sg->drawT[i]))
+			continue;
+
+		T = M_MatTranspose44p(&sg->drawT[i]);
+		GL_LoadMatrixv(&T);
+
+		AG_ObjectLock(n);
+		ent->draw(n, view);
+		AG_ObjectUnlock(n);
+	}
 	GL_LoadMatrixv(&Tsave);
-	Free(hier);
 }
 
 /* Save node data (and child nodes) to a data source. */
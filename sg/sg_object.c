@@ -33,6 +33,14 @@
 
 #include <string.h>
 
+/* Display lists compiled for each view (see CompileLists()). */
+#define SG_OBJECT_LIST_FACETS	0	/* Triangles and quads */
+#define SG_OBJECT_LIST_EDGES	1	/* Edges (as lines) */
+#define SG_OBJECT_LIST_VERTICES	2	/* Vertices (as points) */
+#define SG_OBJECT_LIST_LAST	3
+
+#define SG_OBJECT_VA_STRIDE	12	/* Floats per vertex (T2F_C4F_N3F_V3F) */
+
 /* Create a new Object instance. */
 SG_Object *
 SG_ObjectNew(void *parent, const char *name)
@@ -137,6 +145,8 @@ Init(void *_Nonnull obj)
 	SG_VertexInit(&so->vtx[0]);				/* Reserved */
 	so->tex = NULL;
 	so->bsp = NULL;
+	SG_OctreeInit(&so->oct);
+	TAILQ_INIT(&so->vlist);
 
 	AG_SetEvent(so, "edit-list-poll", EditListPoll, NULL);
 }
@@ -216,6 +226,7 @@ SG_VertexNewv(void *obj, const M_Vector3 *vNew)
 	vtx->v.y = vNew->y;
 	vtx->v.z = vNew->z;
 	rv = (int)(so->nVtx++);
+	SG_ObjectInvalidate(so);
 out:
 	AG_ObjectUnlock(so);
 	return (rv);
@@ -233,6 +244,7 @@ SG_VertexNewvn(void *obj, const M_Vector3 *vNew, const M_Vector3 *nNew)
 	vn = SG_VertexNewv(obj, vNew);
 	vtx = &so->vtx[vn];
 	vtx->n = *nNew;
+	SG_ObjectInvalidate(so);
 	AG_ObjectUnlock(so);
 	return (vn);
 }
@@ -377,33 +389,18 @@ SG_FacetRehash(void *pso, Uint nFacetsNew)
 	return (0);
 }
 
-/*
- * Create (or fetch) the edge between vertices vT and vH. Returns the
- * HEAD halfedge (vH). By convention, the HEAD halfedge points to the
- * face at the LEFT of the edge.
- * 
- * This function does not assign the facet pointers. The face pointers of
- * existing edges are not changed, and for new edges they are set to NULL.
- */
-SG_Edge *
-SG_Edge2(void *obj, int vT, int vH)
+static SG_Edge *_Nonnull
+Edge2(SG_Object *_Nonnull so, int vT, int vH)
 {
-	SG_Object *so = obj;
-	SG_EdgeEnt *ee;
+	SG_EdgeEnt *ee = &so->edgeTbl[SG_HashEdge(so, vT,vH)];
 	SG_Edge *e;
-	
-	AG_ObjectLock(so);
-	ee = &so->edgeTbl[SG_HashEdge(so, vT,vH)];
 
 	SLIST_FOREACH(e, &ee->edges, edges) {
 		if (e->v == vH && e->oe->v == vT) {
-			AG_ObjectUnlock(so);
 			return (e);
 		}
-		if (e->v == vT && e->oe->v == vH) {
-			AG_ObjectUnlock(so);
+		if (e->v == vT && e->oe->v == vH)
 			return (e->oe);
-		}
 	}
 	e = Malloc(sizeof(SG_Edge));
 	e->v = vH;
@@ -417,7 +414,25 @@ SG_Edge2(void *obj, int vT, int vH)
 	e->oe->f = NULL;
 	e->oe->flags = 0;
 	SLIST_INSERT_HEAD(&ee->edges, e->oe, edges);
+	return (e);
+}
+
+/*
+ * Create (or fetch) the edge between vertices vT and vH. Returns the
+ * HEAD halfedge (vH). By convention, the HEAD halfedge points to the
+ * face at the LEFT of the edge.
+ * 
+ * This function does not assign the facet pointers. The face pointers of
+ * existing edges are not changed, and for new edges they are set to NULL.
+ */
+SG_Edge *
+SG_Edge2(void *obj, int vT, int vH)
+{
+	SG_Object *so = obj;
+	SG_Edge *e;
 	
+	AG_ObjectLock(so);
+	e = Edge2(so, vT, vH);
 	AG_ObjectUnlock(so);
 	return (e);
 }
@@ -454,49 +469,71 @@ SG_FacetDelete(SG_Facet *f)
 	fe = &so->facetTbl[SG_HashFacet(so,f)];
 	SLIST_REMOVE(&fe->facets, f, sg_facet, facets);
 	Free(f);
+	SG_ObjectInvalidate(so);
 	
 	AG_ObjectUnlock(so);
 }
 
-/* 
- * Generate a triangular facet from a specified contour.
- *
- * If the contour specifies one or more existing edges, the orientation of
- * the facet may be reversed to be consistent with the existing facets sharing
- * those edges.
+/*
+ * Create a triangular or quad facet (and its opposite facet) from the
+ * contour v[0..n-1]. The object must be locked.
  */
-SG_Facet *
-SG_FacetFromTri3(void *obj, int v1, int v2, int v3)
+static SG_Facet *_Nonnull
+FacetNew(SG_Object *_Nonnull so, const int *_Nonnull v, int n)
 {
-	SG_Object *so = obj;
 	SG_FacetEnt *fe;
 	SG_Facet *f;
 	int i;
-	
+
 	f = Malloc(sizeof(SG_Facet));
 	f->obj = so;
-	f->n = 3;
+	f->n = n;
 	f->flags = 0;
 	f->of = Malloc(sizeof(SG_Facet));
 	f->of->obj = so;
-	f->of->n = 3;
+	f->of->n = n;
 	f->of->flags = 0;
 
-	AG_ObjectLock(so);
-
-	f->e[0] = SG_Edge2(so, v1,v2);	f->of->e[0] = f->e[0]->oe;
-	f->e[1] = SG_Edge2(so, v2,v3);	f->of->e[1] = f->e[1]->oe;
-	f->e[2] = SG_Edge2(so, v3,v1);	f->of->e[2] = f->e[2]->oe;
-	f->e[3] = NULL;			f->of->e[3] = NULL;
-
-	for (i = 0; i < 3; i++) {
+	for (i = 0; i < n; i++) {
+		f->e[i] = Edge2(so, v[i], v[(i+1) % n]);
+		f->of->e[i] = f->e[i]->oe;
+	}
+	if (n == 3) {
+		f->e[3] = NULL;
+		f->of->e[3] = NULL;
+	}
+	for (i = 0; i < n; i++) {
 		f->e[i]->f = f;
 		f->e[i]->oe->f = f->of;
 	}
 
-	fe = &so->facetTbl[SG_HashTriangle(so, v1,v2,v3)];
+	fe = &so->facetTbl[(n == 3) ? SG_HashTriangle(so, v[0],v[1],v[2]) :
+	                              SG_HashQuad(so, v[0],v[1],v[2],v[3])];
 	SLIST_INSERT_HEAD(&fe->facets, f, facets);
+	return (f);
+}
+
+/* 
+ * Generate a triangular facet from a specified contour.
+ *
+ * If the contour specifies one or more existing edges, the orientation of
+ * the facet may be reversed to be consistent with the existing facets sharing
+ * those edges.
+ */
+SG_Facet *
+SG_FacetFromTri3(void *obj, int v1, int v2, int v3)
+{
+	SG_Object *so = obj;
+	SG_Facet *f;
+	int v[3];
+
+	v[0] = v1;
+	v[1] = v2;
+	v[2] = v3;
 
+	AG_ObjectLock(so);
+	f = FacetNew(so, v, 3);
+	SG_ObjectInvalidate(so);
 	AG_ObjectUnlock(so);
 	return (f);
 }
@@ -506,35 +543,76 @@ SG_Facet *
 SG_FacetFromQuad4(void *obj, int v1, int v2, int v3, int v4)
 {
 	SG_Object *so = obj;
-	SG_FacetEnt *fe;
 	SG_Facet *f;
-	int i;
+	int v[4];
 
-	f = Malloc(sizeof(SG_Facet));
-	f->obj = so;
-	f->n = 4;
-	f->flags = 0;
-	f->of = Malloc(sizeof(SG_Facet));
-	f->of->obj = so;
-	f->of->n = 4;
-	f->of->flags = 0;
+	v[0] = v1;
+	v[1] = v2;
+	v[2] = v3;
+	v[3] = v4;
 
 	AG_ObjectLock(so);
+	f = FacetNew(so, v, 4);
+	SG_ObjectInvalidate(so);
+	AG_ObjectUnlock(so);
+	return (f);
+}
 
-	f->e[0] = SG_Edge2(so, v1,v2);	f->of->e[0] = f->e[0]->oe;
-	f->e[1] = SG_Edge2(so, v2,v3);	f->of->e[1] = f->e[1]->oe;
-	f->e[2] = SG_Edge2(so, v3,v4);	f->of->e[2] = f->e[2]->oe;
-	f->e[3] = SG_Edge2(so, v4,v1);	f->of->e[3] = f->e[3]->oe;
-	for (i = 0; i < 4; i++) {
-		f->e[i]->f = f;
-		f->e[i]->oe->f = f->of;
+/*
+ * Generate facets in bulk. The vertex indices of facet i are the n[i]
+ * (3 or 4) next consecutive entries of v. The edge and facet tables are
+ * resized once up front (if needed) instead of being grown as facets
+ * are inserted. Return 0 on success or -1 on failure.
+ */
+int
+SG_FacetsFromArray(void *obj, const Uint *v, const Uint8 *n, Uint count)
+{
+	SG_Object *so = obj;
+	Uint i, j, nInd = 0, nEdges;
+	int vf[4];
+
+	AG_ObjectLock(so);
+
+	for (i = 0; i < count; i++) {
+		if (n[i] != 3 && n[i] != 4) {
+			AG_SetError("%u-sided facet", (Uint)n[i]);
+			goto fail;
+		}
+		for (j = 0; j < n[i]; j++) {
+			if (v[nInd+j] == 0 || v[nInd+j] >= so->nVtx) {
+				AG_SetError("Bad vertex %u in facet %u",
+				    v[nInd+j], i);
+				goto fail;
+			}
+		}
+		nInd += n[i];
+	}
+
+	/* Each facet edge is shared with (at most) one other facet. */
+	nEdges = nInd/2 + 1;
+	if (so->nEdgeTbl < nEdges &&
+	    SG_EdgeRehash(so, nEdges) == -1) {
+		goto fail;
+	}
+	if (so->nFacetTbl < count &&
+	    SG_FacetRehash(so, count) == -1)
+		goto fail;
+
+	for (i = 0, nInd = 0; i < count; i++) {
+		for (j = 0; j < n[i]; j++) {
+			vf[j] = (int)v[nInd+j];
+		}
+		(void)FacetNew(so, vf, n[i]);
+		nInd += n[i];
+	}
+	if (count > 0) {
+		SG_ObjectInvalidate(so);
 	}
-	
-	fe = &so->facetTbl[SG_HashQuad(so, v1,v2,v3,v4)];
-	SLIST_INSERT_HEAD(&fe->facets, f, facets);
-	
 	AG_ObjectUnlock(so);
-	return (f);
+	return (0);
+fail:
+	AG_ObjectUnlock(so);
+	return (-1);
 }
 
 /*
@@ -689,6 +767,7 @@ SG_ObjectNormalize(void *obj)
 			FACET_N(so,f,i) = n;
 		}
 	}
+	SG_ObjectInvalidate(so);
 	AG_ObjectUnlock(so);
 	return (0);
 }
@@ -946,15 +1025,44 @@ SG_ObjectFreeGeometry(void *p)
 	/* Free the vertices */
 	so->vtx = Realloc(so->vtx, sizeof(SG_Vertex));
 	so->nVtx = 1;
+
+	SG_OctreeFree(&so->oct);
+	so->flags |= SG_OBJECT_DIRTY;
 	
 	AG_ObjectUnlock(so);
 }
 
+/*
+ * Release the per-view display lists of an object. The lists will be
+ * recompiled as needed on the next draw.
+ */
+void
+SG_ObjectFreeCached(void *p)
+{
+	SG_Object *so = p;
+	SG_ViewList *vl, *vlNext;
+	int i;
+
+	AG_ObjectLock(so);
+	for (vl = TAILQ_FIRST(&so->vlist);
+	     vl != TAILQ_END(&so->vlist);
+	     vl = vlNext) {
+		vlNext = TAILQ_NEXT(vl, lists);
+		for (i = 0; i < SG_OBJECT_LIST_LAST; i++) {
+			AG_GL_DeleteList(WIDGET(vl->sv)->drv, vl->name+i);
+		}
+		Free(vl);
+	}
+	TAILQ_INIT(&so->vlist);
+	AG_ObjectUnlock(so);
+}
+
 static void
 Destroy(void *_Nonnull p)
 {
 	SG_Object *so = p;
 
+	SG_ObjectFreeCached(so);
 	SG_ObjectFreeGeometry(so);
 }
 
@@ -970,7 +1078,7 @@ Load(void *_Nonnull obj, AG_DataSource *_Nonnull ds, const AG_Version *_Nonnull
 	SG_FacetEnt *facetTblNew;
 	Uint v[4];
 
-	so->flags = AG_ReadUint32(ds);
+	so->flags = AG_ReadUint32(ds) & SG_OBJECT_SAVED;
 
 	/* Load the vertex data. */
 	so->vtx = NULL;
@@ -1080,6 +1188,7 @@ Load(void *_Nonnull obj, AG_DataSource *_Nonnull ds, const AG_Version *_Nonnull
 
 	/* XXX TODO: load texture */
 
+	SG_ObjectInvalidate(so);
 	return (0);
 fail:
 	SG_ObjectFreeGeometry(so);
@@ -1096,7 +1205,7 @@ Save(void *_Nonnull p, AG_DataSource *_Nonnull ds)
 	SG_Vertex *vtx;
 	SG_Facet *f;
 	
-	AG_WriteUint32(ds, (Uint32)so->flags);
+	AG_WriteUint32(ds, (Uint32)(so->flags & SG_OBJECT_SAVED));
 
 	/* Save the vertices. */
 	AG_WriteUint32(ds, so->nVtx);
@@ -1206,131 +1315,187 @@ DrawVertexNormals(SG_Object *_Nonnull so)
 	GL_EnableSaved(GL_LIGHTING, lighting);
 }
 
+/*
+ * Compile the display lists for an object: facets, edges and vertices.
+ * The geometry is packed into vertex arrays, so that it is transferred
+ * to the GL only once (and again only after it changes).
+ */
+static SG_ViewList *_Nullable
+CompileLists(SG_Object *_Nonnull so, SG_View *_Nonnull view)
+{
+	SG_ViewList *vl;
+	GLfloat *va = NULL, *pva;
+	GLuint *tris = NULL, *quads = NULL, *edges = NULL;
+	Uint i, fi, nTris = 0, nQuads = 0, nEdges = 0;
+	SG_Facet *f;
+	SG_Edge *e;
+
+	if ((vl = TryMalloc(sizeof(SG_ViewList))) == NULL) {
+		return (NULL);
+	}
+	vl->node = so;
+	vl->sv = view;
+	vl->frame = -1;
+
+	/* Count the primitives. */
+	SG_FOREACH_FACET(f, fi, so) {
+		if (f->n == 3) {
+			nTris++;
+		} else {
+			nQuads++;
+		}
+	}
+	SG_FOREACH_EDGE(e, i, so) {
+		if (e->v < e->oe->v)		/* One line per halfedge pair */
+			nEdges++;
+	}
+
+	/* Pack the vertices in GL_T2F_C4F_N3F_V3F format. */
+	if ((va = TryMalloc(so->nVtx*SG_OBJECT_VA_STRIDE*sizeof(GLfloat)))
+	    == NULL ||
+	    (tris = TryMalloc((nTris*3 + 1)*sizeof(GLuint))) == NULL ||
+	    (quads = TryMalloc((nQuads*4 + 1)*sizeof(GLuint))) == NULL ||
+	    (edges = TryMalloc((nEdges*2 + 1)*sizeof(GLuint))) == NULL)
+		goto fail;
+
+	for (i = 0, pva = va; i < so->nVtx; i++) {
+		const SG_Vertex *vtx = &so->vtx[i];
+
+		*pva++ = (GLfloat)vtx->st.x;
+		*pva++ = (GLfloat)vtx->st.y;
+		*pva++ = (GLfloat)vtx->c.r;
+		*pva++ = (GLfloat)vtx->c.g;
+		*pva++ = (GLfloat)vtx->c.b;
+		*pva++ = (GLfloat)vtx->c.a;
+		*pva++ = (GLfloat)vtx->n.x;
+		*pva++ = (GLfloat)vtx->n.y;
+		*pva++ = (GLfloat)vtx->n.z;
+		*pva++ = (GLfloat)vtx->v.x;
+		*pva++ = (GLfloat)vtx->v.y;
+		*pva++ = (GLfloat)vtx->v.z;
+	}
+	nTris = 0;
+	nQuads = 0;
+	SG_FOREACH_FACET(f, fi, so) {
+		if (f->n == 3) {
+			tris[nTris++] = (GLuint)f->e[0]->v;
+			tris[nTris++] = (GLuint)f->e[1]->v;
+			tris[nTris++] = (GLuint)f->e[2]->v;
+		} else {
+			quads[nQuads++] = (GLuint)f->e[0]->v;
+			quads[nQuads++] = (GLuint)f->e[1]->v;
+			quads[nQuads++] = (GLuint)f->e[2]->v;
+			quads[nQuads++] = (GLuint)f->e[3]->v;
+		}
+	}
+	nEdges = 0;
+	SG_FOREACH_EDGE(e, i, so) {
+		if (e->v < e->oe->v) {
+			edges[nEdges++] = (GLuint)e->v;
+			edges[nEdges++] = (GLuint)e->oe->v;
+		}
+	}
+
+	if ((vl->name = GL_GenLists(SG_OBJECT_LIST_LAST)) == 0)
+		goto fail;
+
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glInterleavedArrays(GL_T2F_C4F_N3F_V3F, 0, va);
+
+	if (GL_NewList(vl->name + SG_OBJECT_LIST_FACETS, GL_COMPILE) == -1) {
+		goto fail_lists;
+	}
+	if (nTris > 0) {
+		glDrawElements(GL_TRIANGLES, nTris, GL_UNSIGNED_INT, tris);
+	}
+	if (nQuads > 0) {
+		glDrawElements(GL_QUADS, nQuads, GL_UNSIGNED_INT, quads);
+	}
+	GL_EndList();
+
+	/* Edges and vertices are drawn in the current color. */
+	glDisableClientState(GL_COLOR_ARRAY);
+
+	if (GL_NewList(vl->name + SG_OBJECT_LIST_EDGES, GL_COMPILE) == -1) {
+		goto fail_lists;
+	}
+	if (nEdges > 0) {
+		glDrawElements(GL_LINES, nEdges, GL_UNSIGNED_INT, edges);
+	}
+	GL_EndList();
+
+	if (GL_NewList(vl->name + SG_OBJECT_LIST_VERTICES, GL_COMPILE) == -1) {
+		goto fail_lists;
+	}
+	if (so->nVtx > 1) {
+		glDrawArrays(GL_POINTS, 1, so->nVtx - 1);  /* Skip reserved */
+	}
+	GL_EndList();
+
+	glPopClientAttrib();
+
+	Free(edges);
+	Free(quads);
+	Free(tris);
+	Free(va);
+	return (vl);
+fail_lists:
+	glPopClientAttrib();
+	glDeleteLists(vl->name, SG_OBJECT_LIST_LAST);
+fail:
+	Free(edges);
+	Free(quads);
+	Free(tris);
+	Free(va);
+	Free(vl);
+	return (NULL);
+}
+
 static void
-DrawObjectSilouhette(SG_Object *_Nonnull so, SG_View *_Nonnull view)
+DrawObjectSilouhette(SG_ViewList *_Nonnull vl)
 {
-#if 0
-	M_Vector3 vCam = SG_NodeDir(view->cam);
-	int depthTest;
-#endif
-	Uint i;
-	
 	GL_PushAttrib(GL_LIGHTING_BIT|GL_LINE_BIT|GL_COLOR_BUFFER_BIT);
 	GL_Disable(GL_LIGHTING);
-#if 0
-	GL_DisableSave(GL_DEPTH_TEST, &depthTest);
-#endif
 	GL_LineWidth(4.0);
 
 	GL_Enable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	GL_Begin(GL_LINES);
 	GL_Color4ub(0, 255, 0, 50);
-	for (i = 0; i < so->nEdgeTbl; i++) {
-		SG_EdgeEnt *ent = &so->edgeTbl[i];
-		SG_Edge *e;
+	GL_CallList(vl->name + SG_OBJECT_LIST_EDGES);
 
-		SLIST_FOREACH(e, &ent->edges, edges) {
-#if 0
-			/*
-			 * Edge is a silouhette edge if it is shared
-			 * by both a front-facing and back-facing
-			 * polygon.
-			 */
-			if (e->f != NULL && e->oe->f != NULL) {
-				M_Real dot1 = M_VecDot3(vCam,
-				    SG_FacetNormal(so, e->f));
-				M_Real dot2 = M_VecDot3(vCam,
-				    SG_FacetNormal(so, e->oe->f));
-
-				if ((dot1 >= 0 && dot2 <= 0) ||
-				    (dot1 <= 0 && dot2 >= 0)) {
-					GL_Vertex3v(&so->vtx[e->v].v);
-					GL_Vertex3v(&so->vtx[e->oe->v].v);
-				}
-			}
-#else
-			GL_Vertex3v(&so->vtx[e->v].v);
-			GL_Vertex3v(&so->vtx[e->oe->v].v);
-			
-#endif
-		}
-	}
-	GL_End();
-#if 0
-	GL_EnableSaved(GL_DEPTH_TEST, depthTest);
-#endif
 	GL_PopAttrib();
 }
 
 static void
-DrawObjectWireframe(SG_Object *_Nonnull so)
+DrawObjectWireframe(SG_ViewList *_Nonnull vl)
 {
-	Uint i;
-
-	GL_Begin(GL_LINES);
 	GL_Color3ub(128, 128, 128);
-	for (i = 0; i < so->nEdgeTbl; i++) {
-		SG_EdgeEnt *ent = &so->edgeTbl[i];
-		SG_Edge *e;
-
-		SLIST_FOREACH(e, &ent->edges, edges) {
-			GL_Vertex3v(&so->vtx[e->v].v);
-			GL_Vertex3v(&so->vtx[e->oe->v].v);
-		}
-	}
-	GL_End();
+	GL_CallList(vl->name + SG_OBJECT_LIST_EDGES);
 }
 
 static void
-DrawObjectVertices(SG_Object *_Nonnull so)
+DrawObjectVertices(SG_ViewList *_Nonnull vl)
 {
 	float pointSize;
 	int lighting;
-	Uint i;
 
 	GL_DisableSave(GL_LIGHTING, &lighting);
 	GL_GetFloatv(GL_POINT_SIZE, &pointSize);
 	GL_PointSize(3.0);
-	GL_Begin(GL_POINTS);
-	for (i = 1; i < so->nVtx; i++) {
-		GL_VertexTN(&so->vtx[i]);
-	}
-	GL_End();
+	GL_CallList(vl->name + SG_OBJECT_LIST_VERTICES);
 	GL_EnableSaved(GL_LIGHTING, lighting);
 	GL_PointSize(pointSize);
 }
 
+/* Draw the overlays for individual facets (normals or selection state). */
 static void
-Draw(void *_Nonnull p, SG_View *_Nonnull view)
+DrawFacetOverlays(SG_Object *_Nonnull so, SG *_Nonnull sg)
 {
-	SG_Object *so = p;
-	SG *sg = view->sg;
 	SG_Facet *f;
 	Uint fi, j;
 
-	if (so->tex != NULL) {
-		SG_TextureBind(so->tex, view);
-	}
 	SG_FOREACH_FACET(f, fi, so) {
-		switch (f->n) {
-		case 3:
-			GL_Begin(GL_TRIANGLES);
-			GL_VertexTN(&so->vtx[f->e[0]->v]);
-			GL_VertexTN(&so->vtx[f->e[1]->v]);
-			GL_VertexTN(&so->vtx[f->e[2]->v]);
-			GL_End();
-			break;
-		case 4:
-			GL_Begin(GL_QUADS);
-			GL_VertexTN(&so->vtx[f->e[0]->v]);
-			GL_VertexTN(&so->vtx[f->e[1]->v]);
-			GL_VertexTN(&so->vtx[f->e[2]->v]);
-			GL_VertexTN(&so->vtx[f->e[3]->v]);
-			GL_End();
-			break;
-		}
 		if (sg->flags & SG_OVERLAY_FNORMALS)
 			DrawFacetNormals(so, f);
 
@@ -1347,30 +1512,105 @@ Draw(void *_Nonnull p, SG_View *_Nonnull view)
 			glEnable(GL_LIGHTING);
 		}
 	}
+}
+
+static void
+Draw(void *_Nonnull p, SG_View *_Nonnull view)
+{
+	SG_Object *so = p;
+	SG *sg = view->sg;
+	SG_ViewList *vl;
+
+	if (so->flags & SG_OBJECT_DIRTY) {
+		SG_ObjectFreeCached(so);
+		so->flags &= ~(SG_OBJECT_DIRTY);
+	}
+	TAILQ_FOREACH(vl, &so->vlist, lists) {
+		if (vl->sv == view)
+			break;
+	}
+	if (vl == NULL) {
+		if ((vl = CompileLists(so, view)) == NULL) {
+			Verbose("%s: %s\n", OBJECT(so)->name, AG_GetError());
+			return;
+		}
+		TAILQ_INSERT_TAIL(&so->vlist, vl, lists);
+	}
+
+	if (so->tex != NULL) {
+		SG_TextureBind(so->tex, view);
+	}
+	GL_CallList(vl->name + SG_OBJECT_LIST_FACETS);
 	if (so->tex != NULL) {
 		SG_TextureUnbind(so->tex, view);
 	}
+	if ((sg->flags & SG_OVERLAY_FNORMALS) || SGNODE_SELECTED(so))
+		DrawFacetOverlays(so, sg);
 	if (SGNODE_SELECTED(so))
-		DrawObjectSilouhette(so, view);
+		DrawObjectSilouhette(vl);
 	if (sg->flags & SG_OVERLAY_WIREFRAME)
-		DrawObjectWireframe(so);
+		DrawObjectWireframe(vl);
 	if (sg->flags & SG_OVERLAY_VERTICES)
-		DrawObjectVertices(so);
+		DrawObjectVertices(vl);
 	if (sg->flags & SG_OVERLAY_VNORMALS)
 		DrawVertexNormals(so);
-#if 0
-	glInterleavedArrays(GL_T2F_N3F_V3F, SG_VERTEX_STRIDE,
-	    (const GLvoid *)so->vtx);
-	SLIST_FOREACH(prim, &so->prims, prims) {
-		glDrawArrays(prim->type, 0, prim->n);
+}
+
+/*
+ * Return the bounding box of the object's facets (in object coordinates),
+ * rebuilding the facet octree if the geometry has changed. Return -1 if
+ * the object has no facets or the octree could not be built.
+ */
+int
+SG_ObjectGetBounds(void *obj, M_Vector3 *min, M_Vector3 *max)
+{
+	SG_Object *so = obj;
+	int rv = -1;
+
+	AG_ObjectLock(so);
+	if ((so->oct.flags & SG_OCTREE_DIRTY) &&
+	    SG_OctreeBuild(&so->oct, so) == -1) {
+		goto out;
 	}
-#endif
+	if (so->oct.root != NULL) {
+		*min = so->oct.root->min;
+		*max = so->oct.root->max;
+		rv = 0;
+	}
+out:
+	AG_ObjectUnlock(so);
+	return (rv);
 }
 
 static int
 Intersect(void *_Nonnull obj, M_Geom3 g, M_GeomSet3 *_Nullable S)
 {
-	return (0);
+	SG_Object *so = obj;
+	M_Geom3 xg;
+	M_Real t;
+	int rv = 0;
+
+	if (g.type != M_LINE)
+		return (-1);
+
+	AG_ObjectLock(so);
+	if ((so->oct.flags & SG_OCTREE_DIRTY) &&
+	    SG_OctreeBuild(&so->oct, so) == -1) {
+		rv = -1;
+		goto out;
+	}
+	if (SG_OctreeIntersectLine(&so->oct, so, g.g.line, &t, NULL) == 1) {
+		if (S != NULL) {
+			xg.type = M_POINT;
+			xg.g.point = M_VecAdd3(g.g.line.p,
+			                       M_VecScale3(g.g.line.d, t));
+			M_GeomSetAdd3(S, &xg);
+		}
+		rv = 1;
+	}
+out:
+	AG_ObjectUnlock(so);
+	return (rv);
 }
 
 static void
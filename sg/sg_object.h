@@ -61,6 +61,9 @@ typedef struct sg_object {
 #define SG_OBJECT_STATIC	0x01	/* Geometry is unchanging */
 #define SG_OBJECT_NODUPVERTEX	0x02	/* Check for duplicate vertices in
 					   SG_VertexNew*() */
+#define SG_OBJECT_DIRTY		0x04	/* Geometry changed since the display
+					   lists were compiled */
+#define SG_OBJECT_SAVED		(SG_OBJECT_STATIC|SG_OBJECT_NODUPVERTEX)
 	SG_Vertex *_Nonnull vtx;	/* Vertex array */
 	Uint               nVtx;
 	SG_EdgeEnt *_Nonnull edgeTbl;	/* Edge table */
@@ -69,6 +72,8 @@ typedef struct sg_object {
 	Uint                 nFacetTbl;
 	SG_Texture *_Nullable tex;	/* Associated texture */
 	SG_BSPNode *_Nullable bsp;	/* Root BSP node */
+	SG_Octree oct;			/* Facet octree (for picking/culling) */
+	AG_TAILQ_HEAD_(sg_view_list) vlist; /* Per-view display lists */
 } SG_Object;
 
 typedef enum sg_extrude_mode {
@@ -130,6 +135,9 @@ int  SG_ObjectCheckConnectivity(void *_Nonnull, struct ag_console *_Nonnull);
 int  SG_ObjectNormalize(void *_Nonnull);
 Uint SG_ObjectConvQuadsToTriangles(void *_Nonnull);
 void SG_ObjectFreeGeometry(void *_Nonnull);
+void SG_ObjectFreeCached(void *_Nonnull);
+int  SG_ObjectGetBounds(void *_Nonnull, M_Vector3 *_Nonnull,
+                        M_Vector3 *_Nonnull);
 void SG_ObjectMenuInstance(void *_Nonnull, struct ag_menu_item *_Nonnull,
                            struct sg_view *_Nonnull);
 
@@ -151,6 +159,8 @@ void              SG_EdgeGetName(SG_Edge *_Nonnull, char *_Nonnull, size_t)
 
 SG_Facet *_Nonnull SG_FacetFromTri3(void *_Nonnull, int,int,int);
 SG_Facet *_Nonnull SG_FacetFromQuad4(void *_Nonnull, int,int,int,int);
+int                SG_FacetsFromArray(void *_Nonnull, const Uint *_Nonnull,
+                                      const Uint8 *_Nonnull, Uint);
 
 int  SG_FacetExtrude(void *_Nonnull, SG_Facet *_Nonnull, M_Vector3, SG_ExtrudeMode);
 void SG_FacetDelete(SG_Facet *_Nonnull);
@@ -263,6 +273,18 @@ SG_FacetNormal(SG_Object *_Nonnull so, const SG_Facet *_Nonnull f)
 	                       M_VecSub3(v0,v2));
 }
 
+/*
+ * Flag the compiled display lists and the facet octree of an object as
+ * stale following a change in geometry. This must be called after
+ * modifying the vtx[] array directly.
+ */
+static __inline__ void
+SG_ObjectInvalidate(SG_Object *_Nonnull so)
+{
+	so->flags |= SG_OBJECT_DIRTY;
+	SG_OctreeInvalidate(&so->oct);
+}
+
 #ifdef _AGAR_SG_INTERNAL
 /* Specify a vertex in immediate mode. */
 static __inline__ void
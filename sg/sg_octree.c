@@ -23,70 +23,370 @@
  */
 
 /*
- * Space partitioning using octrees.
+ * Space partitioning of SG_Object facets using octrees. Facets are
+ * distributed among octants by centroid, and node bounds are grown to
+ * enclose their facets, which keeps every facet in exactly one leaf.
  */
 
 #include <agar/core/core.h>
 #include <agar/sg/sg.h>
 
+#include <string.h>
+
+#define SG_OCTREE_INVD_MAX 1e30
+
+/* Facet entry (used during construction). */
+typedef struct sg_octree_ent {
+	SG_Facet *_Nonnull f;
+	M_Vector3 min, max;		/* Facet bounds */
+	M_Vector3 ctr;			/* Facet centroid */
+} SG_OctreeEnt;
+
 /* Initialize an Octree structure. */
 void
-SG_OctreeInit(SG *sg, SG_Octree *oct)
+SG_OctreeInit(SG_Octree *oct)
 {
+	oct->flags = SG_OCTREE_DIRTY;
+	oct->nNodes = 0;
 	oct->root = NULL;
 }
 
-/* Build an Octree structure from a scene. */
-int
-SG_OctreeBuild(SG *sg, SG_Octree *oct)
+static void
+FreeNode(SG_Octnode *_Nonnull node)
 {
-	SG_Object *so;
-	SG_Facet *fct;
-	M_Vector3 min = M_VecZero3();
-	M_Vector3 max = M_VecZero3();
 	int i;
 
-	AG_ObjectLock(sg);
-
-	/* Find the scene extrema. */
-	SG_FOREACH_NODE_CLASS(so, sg, sg_object, "Object:*") {
-		for (i = 0; i < so->nfacets; i++) {
-			SG_Polygon P = SG_FacetPolygon(so, i);
-			int i;
-
-			for (i = 0; i < P.n; i++) {
-				if (P.v[i].x < min.x) { min.x = P.v[i].x; }
-				if (P.v[i].y < min.y) { min.y = P.v[i].y; }
-				if (P.v[i].z < min.z) { min.z = P.v[i].z; }
-				if (P.v[i].x > max.x) { max.x = P.v[i].x; }
-				if (P.v[i].y > max.y) { max.y = P.v[i].y; }
-				if (P.v[i].z > max.z) { max.z = P.v[i].z; }
-			}
+	for (i = 0; i < 8; i++) {
+		if (node->Q[i] != NULL)
+			FreeNode(node->Q[i]);
+	}
+	Free(node->facets);
+	Free(node);
+}
+
+/* Release the nodes of an Octree. */
+void
+SG_OctreeFree(SG_Octree *oct)
+{
+	if (oct->root != NULL) {
+		FreeNode(oct->root);
+		oct->root = NULL;
+	}
+	oct->nNodes = 0;
+	oct->flags |= SG_OCTREE_DIRTY;
+}
+
+static SG_Octnode *_Nullable
+BuildNode(SG_Octree *_Nonnull oct, SG_OctreeEnt *_Nonnull ent,
+    SG_OctreeEnt *_Nonnull tmp, Uint n, int depth)
+{
+	SG_Octnode *node;
+	M_Vector3 cMin, cMax, mid;
+	Uint count[8], offs[8];
+	Uint i;
+	int q;
+
+	if ((node = TryMalloc(sizeof(SG_Octnode))) == NULL) {
+		return (NULL);
+	}
+	node->facets = NULL;
+	node->nFacets = 0;
+	for (q = 0; q < 8; q++) {
+		node->Q[q] = NULL;
+	}
+	oct->nNodes++;
+
+	node->min = ent[0].min;
+	node->max = ent[0].max;
+	cMin = ent[0].ctr;
+	cMax = ent[0].ctr;
+	for (i = 1; i < n; i++) {
+		const SG_OctreeEnt *e = &ent[i];
+
+		node->min.x = MIN(node->min.x, e->min.x);
+		node->min.y = MIN(node->min.y, e->min.y);
+		node->min.z = MIN(node->min.z, e->min.z);
+		node->max.x = MAX(node->max.x, e->max.x);
+		node->max.y = MAX(node->max.y, e->max.y);
+		node->max.z = MAX(node->max.z, e->max.z);
+		cMin.x = MIN(cMin.x, e->ctr.x);
+		cMin.y = MIN(cMin.y, e->ctr.y);
+		cMin.z = MIN(cMin.z, e->ctr.z);
+		cMax.x = MAX(cMax.x, e->ctr.x);
+		cMax.y = MAX(cMax.y, e->ctr.y);
+		cMax.z = MAX(cMax.z, e->ctr.z);
+	}
+	if (n <= SG_OCTREE_LEAF_MAX || depth >= SG_OCTREE_DEPTH_MAX)
+		goto leaf;
+
+	/* Distribute the facets among octants by centroid. */
+	mid = M_VecLERP3(cMin, cMax, 0.5);
+	for (q = 0; q < 8; q++) {
+		count[q] = 0;
+	}
+	for (i = 0; i < n; i++) {
+		const M_Vector3 *c = &ent[i].ctr;
+
+		count[(c->x > mid.x) | (c->y > mid.y) << 1 |
+		      (c->z > mid.z) << 2]++;
+	}
+	for (q = 0; q < 8; q++) {
+		if (count[q] == n)		/* Degenerate split */
+			goto leaf;
+	}
+	for (q = 0, offs[0] = 0; q < 7; q++) {
+		offs[q+1] = offs[q] + count[q];
+	}
+	for (i = 0; i < n; i++) {
+		const M_Vector3 *c = &ent[i].ctr;
+
+		q = (c->x > mid.x) | (c->y > mid.y) << 1 | (c->z > mid.z) << 2;
+		tmp[offs[q]++] = ent[i];
+	}
+	memcpy(ent, tmp, n*sizeof(SG_OctreeEnt));
+
+	for (q = 0, i = 0; q < 8; i += count[q], q++) {
+		if (count[q] == 0) {
+			continue;
+		}
+		node->Q[q] = BuildNode(oct, &ent[i], &tmp[i], count[q], depth+1);
+		if (node->Q[q] == NULL) {
+			FreeNode(node);
+			return (NULL);
+		}
+	}
+	return (node);
+leaf:
+	if ((node->facets = TryMalloc(n*sizeof(SG_Facet *))) == NULL) {
+		Free(node);
+		return (NULL);
+	}
+	for (i = 0; i < n; i++) {
+		node->facets[i] = ent[i].f;
+	}
+	node->nFacets = n;
+	return (node);
+}
+
+/*
+ * Build an Octree over the facets of an object. Any existing nodes are
+ * released. The object must be locked.
+ */
+int
+SG_OctreeBuild(SG_Octree *oct, SG_Object *so)
+{
+	SG_OctreeEnt *ent, *tmp;
+	SG_Facet *f;
+	Uint i, j, fi, n = 0;
+
+	SG_OctreeFree(oct);
+
+	SG_FOREACH_FACET(f, fi, so) {
+		n++;
+	}
+	if (n == 0) {
+		oct->flags &= ~(SG_OCTREE_DIRTY);
+		return (0);
+	}
+	if ((ent = TryMalloc(n*sizeof(SG_OctreeEnt))) == NULL) {
+		return (-1);
+	}
+	if ((tmp = TryMalloc(n*sizeof(SG_OctreeEnt))) == NULL) {
+		Free(ent);
+		return (-1);
+	}
+	i = 0;
+	SG_FOREACH_FACET(f, fi, so) {
+		SG_OctreeEnt *e = &ent[i++];
+		M_Vector3 sum = M_VecZero3();
+
+		e->f = f;
+		e->min = FACET_V(so,f,0);
+		e->max = e->min;
+		for (j = 0; j < f->n; j++) {
+			M_Vector3 v = FACET_V(so,f,j);
+
+			e->min.x = MIN(e->min.x, v.x);
+			e->min.y = MIN(e->min.y, v.y);
+			e->min.z = MIN(e->min.z, v.z);
+			e->max.x = MAX(e->max.x, v.x);
+			e->max.y = MAX(e->max.y, v.y);
+			e->max.z = MAX(e->max.z, v.z);
+			M_VecAdd3v(&sum, &v);
 		}
+		e->ctr = M_VecScale3(sum, 1.0/(M_Real)f->n);
+	}
+	oct->root = BuildNode(oct, ent, tmp, n, 0);
+	Free(tmp);
+	Free(ent);
+	if (oct->root == NULL) {
+		oct->nNodes = 0;
+		return (-1);
+	}
+	oct->flags &= ~(SG_OCTREE_DIRTY);
+	return (0);
+}
+
+/*
+ * Test the segment p + t*d (with invd = 1/d) against an axis-aligned box.
+ * Return the entry distance or -1 if there is no intersection within
+ * [0,tMax].
+ */
+static __inline__ M_Real
+SegmentBoxDist(M_Vector3 p, M_Vector3 invd, M_Real tMax,
+    const SG_Octnode *_Nonnull node)
+{
+	M_Real t0 = 0.0, t1 = tMax, tNear, tFar;
+
+	tNear = (node->min.x - p.x)*invd.x;
+	tFar  = (node->max.x - p.x)*invd.x;
+	if (tNear > tFar) { M_Real t = tNear; tNear = tFar; tFar = t; }
+	t0 = MAX(t0, tNear);
+	t1 = MIN(t1, tFar);
+
+	tNear = (node->min.y - p.y)*invd.y;
+	tFar  = (node->max.y - p.y)*invd.y;
+	if (tNear > tFar) { M_Real t = tNear; tNear = tFar; tFar = t; }
+	t0 = MAX(t0, tNear);
+	t1 = MIN(t1, tFar);
+
+	tNear = (node->min.z - p.z)*invd.z;
+	tFar  = (node->max.z - p.z)*invd.z;
+	if (tNear > tFar) { M_Real t = tNear; tNear = tFar; tFar = t; }
+	t0 = MAX(t0, tNear);
+	t1 = MIN(t1, tFar);
+
+	return (t0 <= t1) ? t0 : -1.0;
+}
+
+/*
+ * Intersect the ray p + t*d with the triangle v0,v1,v2 (Moller-Trumbore).
+ * Return the distance t, or -1 if there is no intersection.
+ */
+static __inline__ M_Real
+RayTriangleDist(M_Vector3 p, M_Vector3 d, M_Vector3 v0, M_Vector3 v1,
+    M_Vector3 v2)
+{
+	M_Vector3 e1 = M_VecSub3(v1, v0);
+	M_Vector3 e2 = M_VecSub3(v2, v0);
+	M_Vector3 pv, tv, qv;
+	M_Real det, invDet, u, v;
+
+	pv = M_VecCross3(d, e2);
+	det = M_VecDot3(e1, pv);
+	if (Fabs(det) < M_MACHEP) {
+		return (-1.0);
+	}
+	invDet = 1.0/det;
+	tv = M_VecSub3(p, v0);
+	u = M_VecDot3(tv, pv)*invDet;
+	if (u < 0.0 || u > 1.0) {
+		return (-1.0);
 	}
+	qv = M_VecCross3(tv, e1);
+	v = M_VecDot3(d, qv)*invDet;
+	if (v < 0.0 || u+v > 1.0) {
+		return (-1.0);
+	}
+	return M_VecDot3(e2, qv)*invDet;
+}
+
+/*
+ * Find the nearest facet intersecting the line segment L (in object
+ * coordinates). If there is an intersection, return 1 and set t to the
+ * distance from the initial point of L (and pFacet to the facet). The
+ * octree must be up to date and the object must be locked.
+ */
+int
+SG_OctreeIntersectLine(const SG_Octree *oct, SG_Object *so, M_Line3 L,
+    M_Real *t, SG_Facet **pFacet)
+{
+	const SG_Octnode *stack[8*SG_OCTREE_DEPTH_MAX + 8];
+	const SG_Octnode *node;
+	SG_Facet *fBest = NULL;
+	M_Real tBest = L.t, tBox;
+	M_Vector3 invd;
+	int sp = 0;
+	Uint i;
+	int q;
+
+	if (oct->root == NULL) {
+		return (0);
+	}
+	/* Avoid infinities (and 0*inf in the slab test) for axial rays. */
+	invd.x = (L.d.x != 0.0) ? 1.0/L.d.x : SG_OCTREE_INVD_MAX;
+	invd.y = (L.d.y != 0.0) ? 1.0/L.d.y : SG_OCTREE_INVD_MAX;
+	invd.z = (L.d.z != 0.0) ? 1.0/L.d.z : SG_OCTREE_INVD_MAX;
+
+	stack[sp++] = oct->root;
+	while (sp > 0) {
+		node = stack[--sp];
+		tBox = SegmentBoxDist(L.p, invd, tBest, node);
+		if (tBox < 0.0) {
+			continue;
+		}
+		for (i = 0; i < node->nFacets; i++) {
+			SG_Facet *f = node->facets[i];
+			M_Vector3 v0 = FACET_V(so,f,0);
+			M_Real tf;
 
-	oct->root = Malloc(sizeof(SG_Octnode));
-	
-	AG_ObjectUnlock(sg);
+			tf = RayTriangleDist(L.p, L.d, v0,
+			    FACET_V(so,f,1), FACET_V(so,f,2));
+			if (tf < 0.0 && f->n == 4) {
+				tf = RayTriangleDist(L.p, L.d, v0,
+				    FACET_V(so,f,2), FACET_V(so,f,3));
+			}
+			if (tf >= 0.0 && tf <= tBest) {
+				tBest = tf;
+				fBest = f;
+			}
+		}
+		for (q = 0; q < 8; q++) {
+			if (node->Q[q] != NULL)
+				stack[sp++] = node->Q[q];
+		}
+	}
+	if (fBest == NULL) {
+		return (0);
+	}
+	*t = tBest;
+	if (pFacet != NULL) {
+		*pFacet = fBest;
+	}
+	return (1);
 }
 
+/*
+ * Test whether the box [min,max] (in object coordinates), transformed by
+ * the row-major modelview matrix T, may intersect the view frustum
+ * described by the six eye-space planes P (with normals pointing inward).
+ */
 int
-SG_OctreeBuildNode(SG *sg, SG_Octree *oct, M_Vector3 min, M_Vector3 max)
+SG_OctreeBoxInFrustum(const M_Plane *P, const M_Matrix44 *T, M_Vector3 min,
+    M_Vector3 max)
 {
-	SG_Object *so;
-	SG_Facet *fct;
+	M_Vector3 c, e, ct, et;
 	int i;
 
-	AG_ObjectLock(sg);
+	c = M_VecLERP3(min, max, 0.5);
+	e = M_VecSub3(max, c);
 
-	SG_FOREACH_NODE_CLASS(so, sg, sg_object, "Object:*") {
-		for (i = 0; i < so->nfacets; i++) {
-			SG_Polygon P;
+	ct.x = T->m[0][0]*c.x + T->m[0][1]*c.y + T->m[0][2]*c.z + T->m[0][3];
+	ct.y = T->m[1][0]*c.x + T->m[1][1]*c.y + T->m[1][2]*c.z + T->m[1][3];
+	ct.z = T->m[2][0]*c.x + T->m[2][1]*c.y + T->m[2][2]*c.z + T->m[2][3];
+	et.x = Fabs(T->m[0][0])*e.x + Fabs(T->m[0][1])*e.y +
+	       Fabs(T->m[0][2])*e.z;
+	et.y = Fabs(T->m[1][0])*e.x + Fabs(T->m[1][1])*e.y +
+	       Fabs(T->m[1][2])*e.z;
+	et.z = Fabs(T->m[2][0])*e.x + Fabs(T->m[2][1])*e.y +
+	       Fabs(T->m[2][2])*e.z;
 
-			P = SG_FacetPolygon(so, i);
-			/* TODO TODO */
-		}
+	for (i = 0; i < 6; i++) {
+		const M_Vector3 *n = &P[i].n;
+		M_Real r = Fabs(n->x)*et.x + Fabs(n->y)*et.y + Fabs(n->z)*et.z;
+
+		if (M_VecDot3p(n, &ct) + P[i].d + r < 0.0)
+			return (0);
 	}
-	
-	AG_ObjectUnlock(sg);
+	return (1);
 }
@@ -1,19 +1,45 @@
 /*	Public domain	*/
 
+struct sg_facet;
+struct sg_object;
+
+#define SG_OCTREE_LEAF_MAX	8	/* Max facets in a leaf node */
+#define SG_OCTREE_DEPTH_MAX	16	/* Max tree depth */
+
+/*
+ * Octree node. The bounds of a node enclose all of its facets (and
+ * those of its subnodes), so subnodes may overlap.
+ */
 typedef struct sg_octnode {
-	M_Vector3 min, max;	/* Extent of cube */
-	M_Vector3 ctr;		/* Center point */
-	M_Real halfWd;		/* Half width */
-	Uint *polys;		/* Polygon names */
-	Uint npolys;
-	SG_Octnode *Q[8];	/* Subnodes */
+	M_Vector3 min, max;			/* Bounding box */
+	struct sg_facet *_Nonnull *_Nullable facets; /* Facets (leaf nodes) */
+	Uint nFacets;
+	struct sg_octnode *_Nullable Q[8];	/* Subnodes */
 } SG_Octnode;
 
+/* Facet octree over the geometry of an SG_Object (in object coordinates). */
 typedef struct sg_octree {
-	SG_Octnode *root;
+	Uint flags;
+#define SG_OCTREE_DIRTY	0x01			/* Geometry has changed */
+	Uint nNodes;				/* Total node count */
+	SG_Octnode *_Nullable root;		/* Root node (or NULL) */
 } SG_Octree;
 
 __BEGIN_DECLS
-void SG_OctreeInit(SG_Octree *);
-void SG_OctreeBuild(SG *, SG_Octree *);
+void SG_OctreeInit(SG_Octree *_Nonnull);
+void SG_OctreeFree(SG_Octree *_Nonnull);
+int  SG_OctreeBuild(SG_Octree *_Nonnull, struct sg_object *_Nonnull);
+int  SG_OctreeIntersectLine(const SG_Octree *_Nonnull,
+                            struct sg_object *_Nonnull, M_Line3,
+                            M_Real *_Nonnull,
+                            struct sg_facet *_Nullable *_Nullable);
+int  SG_OctreeBoxInFrustum(const M_Plane *_Nonnull, const M_Matrix44 *_Nonnull,
+                           M_Vector3, M_Vector3);
+
+/* Flag the octree for rebuild following a change in geometry. */
+static __inline__ void
+SG_OctreeInvalidate(SG_Octree *_Nonnull oct)
+{
+	oct->flags |= SG_OCTREE_DIRTY;
+}
 __END_DECLS
@@ -1119,10 +1119,12 @@ UpdateAction(SG_ScriptEditCtx *_Nonnull e, int xWid, int yWid)
 	 */
 	Tsave = node->T;
 	node->T = act->Torig;
+	SG_NodeInvalidate(node);
 	SG_GetNodeTransformInverse(node, &T);
 	act->Rcur = M_LineFromPts3(M_VecFromProj3(M_MatMultVector44(T,pNear)),
 	                           M_VecFromProj3(M_MatMultVector44(T,pFar)));
 	node->T = Tsave;
+	SG_NodeInvalidate(node);
 
 	/* Invoke the node's editor_action routine. */
 	SGNODE_OPS(node)->editor_action(node, act->type, act);
@@ -96,6 +96,12 @@ Reset(void *_Nonnull obj)
 	tex->surface = NULL;
 }
 
+static void
+Destroy(void *_Nonnull obj)
+{
+	AG_SurfaceLoadCancel(obj);
+}
+
 static int
 Load(void *_Nonnull obj, AG_DataSource *_Nonnull ds, const AG_Version *_Nonnull ver)
 {
@@ -343,37 +349,39 @@ SG_TextureDelProgram(SG_Texture *tex, SG_TextureProgram *tp)
 	Free(tp);
 }
 
-/* Import texture surface from file. */
+/* Add a texture surface once its image file has been decoded. */
 static void
-ImportSurface(AG_Event *_Nonnull event)
+ImportSurfaceLoaded(AG_Event *_Nonnull event)
 {
-	SG_Texture *tex = AG_PTR(1);
-	char *path = AG_STRING(2);
-	AG_Surface *s;
-	SG_TextureSurface *tsu;
+	SG_Texture *tex = AG_SELF();
+	const AG_Surface *s = AG_PTR(1);
 
-	if ((s = AG_SurfaceFromFile(path)) == NULL) {
+	if (s == NULL || SG_TextureAddSurface(tex, s) == NULL) {
 		AG_TextMsgFromError();
 		return;
 	}
-
-	AG_ObjectLock(tex);
-	if ((tsu = SG_TextureAddSurface(tex, s)) == NULL) {
-		AG_TextMsgFromError();
-		AG_SurfaceFree(s);
-	}
 	SG_TextureCompile(tex);
-	AG_ObjectUnlock(tex);
 }
 
+/* Import texture surface from file (decoded in the background). */
 static void
-PreviewTexture(AG_Event *_Nonnull event)
+ImportSurface(AG_Event *_Nonnull event)
 {
-	AG_Pixmap *px = AG_PTR(1);
+	SG_Texture *tex = AG_PTR(1);
 	char *path = AG_STRING(2);
-	AG_Surface *suFile, *suScaled = NULL;
 
-	if ((suFile = AG_SurfaceFromFile(path)) == NULL) {
+	if (AG_SurfaceLoadAsync(tex, path, ImportSurfaceLoaded, NULL) == -1)
+		AG_TextMsgFromError();
+}
+
+static void
+PreviewTextureLoaded(AG_Event *_Nonnull event)
+{
+	AG_Pixmap *px = AG_SELF();
+	const AG_Surface *suFile = AG_PTR(1);
+	AG_Surface *suScaled;
+
+	if (suFile == NULL) {
 		AG_TextColor(&WCOLOR(px,TEXT_COLOR));
 		AG_PixmapReplaceSurface(px, px->n, AG_TextRender(AG_GetError()));
 		return;
@@ -382,7 +390,16 @@ PreviewTexture(AG_Event *_Nonnull event)
 		return;
 	}
 	AG_PixmapReplaceSurface(px, px->n, suScaled);
-	AG_SurfaceFree(suFile);
+}
+
+static void
+PreviewTexture(AG_Event *_Nonnull event)
+{
+	AG_Pixmap *px = AG_PTR(1);
+	char *path = AG_STRING(2);
+
+	AG_SurfaceLoadCancel(px);		/* Discard stale previews */
+	(void)AG_SurfaceLoadAsync(px, path, PreviewTextureLoaded, NULL);
 }
 
 static void
@@ -727,7 +744,7 @@ AG_ObjectClass sgTextureClass = {
 	{ 0,0 },
 	Init,
 	Reset,
-	NULL,			/* destroy */
+	Destroy,
 	Load,
 	Save,
 	Edit
@@ -295,6 +295,44 @@ SetupLights(SG_View *_Nonnull sv, SG_Node *_Nonnull root)
 	}
 }
 
+/*
+ * Compute the planes of the view frustum in eye coordinates (with normals
+ * pointing inward) for use by SG_NodeDraw() in culling. Culling is only
+ * performed with perspective projection in mono rendering.
+ */
+static void
+UpdateFrustum(SG_View *_Nonnull sv)
+{
+	SG_Camera *cam = sv->cam;
+	M_Rectangle3 rNear, rFar;
+	M_Vector3 pIn;
+	M_Plane *P = &sv->frustum[0];
+	int i;
+
+	sv->flags &= ~(SG_VIEW_CULLING);
+	sv->nCulled = 0;
+	if ((sv->flags & SG_VIEW_NO_CULLING) || agStereo ||
+	    cam->pmode != SG_CAMERA_PERSPECTIVE)
+		return;
+
+	SG_CameraFrustum(cam, &rNear, &rFar);
+	P[0] = M_PlaneFromPts(rNear.a, rNear.b, rNear.c);	/* Near */
+	P[1] = M_PlaneFromPts(rFar.a, rFar.b, rFar.c);		/* Far */
+	P[2] = M_PlaneFromPts(rNear.a, rNear.b, rFar.a);	/* Right */
+	P[3] = M_PlaneFromPts(rNear.b, rNear.c, rFar.b);	/* Top */
+	P[4] = M_PlaneFromPts(rNear.c, rNear.d, rFar.c);	/* Left */
+	P[5] = M_PlaneFromPts(rNear.d, rNear.a, rFar.d);	/* Bottom */
+
+	pIn = M_VecScale3(M_VecK3(), -(cam->pNear + cam->pFar)/2.0);
+	for (i = 0; i < 6; i++) {
+		if (M_VecDot3(P[i].n, pIn) + P[i].d < 0.0) {
+			P[i].n = M_VecFlip3(P[i].n);
+			P[i].d = -P[i].d;
+		}
+	}
+	sv->flags |= SG_VIEW_CULLING;
+}
+
 static void
 Draw(void *_Nonnull obj)
 {
@@ -334,6 +372,7 @@ Draw(void *_Nonnull obj)
 	/* Set the modelview matrix and rendering modes the current camera. */
 	GL_LoadIdentity();
 	SG_CameraSetup(sv->cam);
+	UpdateFrustum(sv);
 
 	/* Enable the light sources. */
 	if ((sv->flags & SG_VIEW_NO_LIGHTING) == 0) {
@@ -799,6 +838,7 @@ Init(void *_Nonnull obj)
 	sv->editStatus[0] = '\0';
 	sv->pmView = NULL;
 	sv->pmNode = NULL;
+	sv->nCulled = 0;
 	AG_InitTimer(&sv->toTransFade, "transFade", 0);
 	AG_InitTimer(&sv->toRefresh, "refresh", 0);
 
@@ -47,6 +47,8 @@ typedef struct sg_view {
 #define SG_VIEW_EDIT_STATUS	0x080 /* Display edition status overlay */
 #define SG_VIEW_MOVING		0x100 /* Moving object */
 #define SG_VIEW_ROTATING	0x200 /* Rotating object */
+#define SG_VIEW_NO_CULLING	0x400 /* Disable view frustum culling */
+#define SG_VIEW_CULLING		0x800 /* Frustum planes are valid (internal) */
 
 	SG *_Nullable sg;		/* Scene graph */
 	SG *_Nullable sgTrans;		/* For SG_ViewTransition() */
@@ -79,6 +81,8 @@ typedef struct sg_view {
 	AG_PopupMenu *_Nonnull pmView;	/* Popup menu per view */
 	AG_PopupMenu *_Nonnull pmNode;	/* Popup menu per node */
 	AG_Timer toRefresh;		/* View refresh timer */
+	M_Plane frustum[6];		/* View frustum (eye coordinates) */
+	Uint nCulled;			/* Nodes culled in last frame */
 } SG_View;
 
 __BEGIN_DECLS
@@ -11,12 +11,22 @@ MANLINKS+=SK.3:SK_NodeAttach.3
 CATLINKS+=SK.cat3:SK_NodeAttach.cat3
 MANLINKS+=SK.3:SK_NodeDetach.3
 CATLINKS+=SK.cat3:SK_NodeDetach.cat3
+MANLINKS+=SK.3:SK_NodeSetHandle.3
+CATLINKS+=SK.cat3:SK_NodeSetHandle.cat3
 MANLINKS+=SK.3:SK_Scalev.3
 CATLINKS+=SK.cat3:SK_Scalev.cat3
 MANLINKS+=SK.3:SK_Rotatev.3
 CATLINKS+=SK.cat3:SK_Rotatev.cat3
 MANLINKS+=SK.3:SK_GetNodeTransform.3
 CATLINKS+=SK.cat3:SK_GetNodeTransform.cat3
+MANLINKS+=SK.3:SK_ComputeIntersections.3
+CATLINKS+=SK.cat3:SK_ComputeIntersections.cat3
+MANLINKS+=SK.3:SK_IntersectNodes.3
+CATLINKS+=SK.cat3:SK_IntersectNodes.cat3
+MANLINKS+=SK.3:SK_Solve.3
+CATLINKS+=SK.cat3:SK_Solve.cat3
+MANLINKS+=SK.3:SK_SolveInvalidate.3
+CATLINKS+=SK.cat3:SK_SolveInvalidate.cat3
 MANLINKS+=SK_View.3:SK_ViewNew.3
 CATLINKS+=SK_View.cat3:SK_ViewNew.cat3
 MANLINKS+=SK_View.3:SK_ViewZoom.3
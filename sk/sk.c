@@ -200,6 +200,8 @@ SK_InitRoot(SK *_Nonnull sk)
 	SKNODE(pt)->sk = sk;
 	SKNODE(pt)->flags |= SK_NODE_FIXED;
 	TAILQ_INSERT_TAIL(&sk->nodes, sk->root, nodes);
+	AG_HandleInsert(&sk->handles, sk->root->ops->name, &sk->root->hEnt,
+	    sk->root->handle, sk->root);
 }
 
 static void
@@ -210,12 +212,18 @@ Init(void *_Nonnull obj)
 	
 	OBJECT(sk)->flags |= AG_OBJECT_REOPEN_ONLOAD;
 
-	sk->flags = 0;
+	sk->flags = SK_SOLVE_INCREMENTAL;
 	AG_MutexInitRecursive(&sk->lock);
 	SK_InitCluster(&sk->ctGraph, 0);
 	TAILQ_INIT(&sk->nodes);
+	AG_HandleTblsInit(&sk->handles);
 	TAILQ_INIT(&sk->clusters);
 	TAILQ_INIT(&sk->insns);
+	sk->compDirty = NULL;
+	sk->nComps = 0;
+	sk->nDirty = 0;
+	sk->solveComp = 0;
+	sk->clusterName = 0;
 
 	if ((un = AG_FindUnit("mm")) == NULL) {
 		AG_FatalError(NULL);
@@ -228,17 +236,176 @@ Init(void *_Nonnull obj)
 	SK_InitRoot(sk);
 }
 
-/* Allocate a new node name. */
+static __inline__ Uint
+HashClusterNode(const SK_Cluster *_Nonnull cl, const SK_Node *_Nonnull node)
+{
+	Uint h = (Uint)((AG_Size)node >> 4);
+
+	h ^= h >> 16;
+	h *= 0x45d9f3bU;
+	h ^= h >> 16;
+	return (h & (cl->nNodeTbl - 1));
+}
+
+/* Look up a node in the membership table of a cluster. */
+static SK_ClusterNode *_Nullable
+GetClusterNode(const SK_Cluster *_Nonnull cl, const SK_Node *_Nonnull node)
+{
+	SK_ClusterNode *cn;
+
+	if (cl->nNodeTbl == 0) {
+		return (NULL);
+	}
+	for (cn = cl->nodeTbl[HashClusterNode(cl, node)];
+	     cn != NULL;
+	     cn = cn->next) {
+		if (cn->node == node)
+			return (cn);
+	}
+	return (NULL);
+}
+
+/* Record an edge incident to a node of a cluster. */
+static void
+AddClusterNodeEdge(SK_Cluster *_Nonnull cl, SK_Node *_Nonnull node,
+    SK_Constraint *_Nonnull ct)
+{
+	SK_ClusterNode *cn;
+	Uint h;
+
+	if ((cn = GetClusterNode(cl, node)) == NULL) {
+		if (cl->nNodes >= cl->nNodeTbl) {	/* Grow and rehash */
+			SK_ClusterNode **tblOld = cl->nodeTbl, *cnNext;
+			Uint i, nOld = cl->nNodeTbl;
+
+			cl->nNodeTbl = (nOld > 0) ? nOld<<1 : 8;
+			cl->nodeTbl = Malloc(cl->nNodeTbl *
+			                     sizeof(SK_ClusterNode *));
+			memset(cl->nodeTbl, 0, cl->nNodeTbl *
+			                       sizeof(SK_ClusterNode *));
+			for (i = 0; i < nOld; i++) {
+				for (cn = tblOld[i]; cn != NULL; cn = cnNext) {
+					cnNext = cn->next;
+					h = HashClusterNode(cl, cn->node);
+					cn->next = cl->nodeTbl[h];
+					cl->nodeTbl[h] = cn;
+				}
+			}
+			Free(tblOld);
+		}
+		cn = Malloc(sizeof(SK_ClusterNode));
+		cn->node = node;
+		cn->edges = NULL;
+		cn->nEdges = 0;
+		cn->maxEdges = 0;
+		h = HashClusterNode(cl, node);
+		cn->next = cl->nodeTbl[h];
+		cl->nodeTbl[h] = cn;
+		cl->nNodes++;
+	}
+	if (cn->nEdges+1 > cn->maxEdges) {
+		cn->maxEdges = (cn->maxEdges > 0) ? cn->maxEdges<<1 : 4;
+		cn->edges = Realloc(cn->edges, cn->maxEdges *
+		                               sizeof(SK_Constraint *));
+	}
+	cn->edges[cn->nEdges++] = ct;
+}
+
+/* Forget an edge incident to a node of a cluster. */
+static void
+DelClusterNodeEdge(SK_Cluster *_Nonnull cl, SK_Node *_Nonnull node,
+    SK_Constraint *_Nonnull ct)
+{
+	SK_ClusterNode *cn, **pcn;
+	Uint i;
+
+	if (cl->nNodeTbl == 0) {
+		return;
+	}
+	for (pcn = &cl->nodeTbl[HashClusterNode(cl, node)];
+	     (cn = *pcn) != NULL;
+	     pcn = &cn->next) {
+		if (cn->node == node)
+			break;
+	}
+	if (cn == NULL) {
+		return;
+	}
+	for (i = 0; i < cn->nEdges; i++) {
+		if (cn->edges[i] != ct) {
+			continue;
+		}
+		if (i < cn->nEdges-1) {
+			memmove(&cn->edges[i], &cn->edges[i+1],
+			    (cn->nEdges - i - 1)*sizeof(SK_Constraint *));
+		}
+		cn->nEdges--;
+		break;
+	}
+	if (cn->nEdges == 0) {
+		*pcn = cn->next;
+		Free(cn->edges);
+		Free(cn);
+		cl->nNodes--;
+	}
+}
+
+/*
+ * Insert an edge into a constraint graph. Changes to the constraint
+ * graph of a sketch are reported to the solver.
+ */
+static void
+InsertEdge(SK_Cluster *_Nonnull cl, SK_Constraint *_Nonnull ct)
+{
+	SK *sk = ct->n1->sk;
+
+	TAILQ_INSERT_TAIL(&cl->edges, ct, constraints);
+	AddClusterNodeEdge(cl, ct->n1, ct);
+	if (ct->n2 != ct->n1) {
+		AddClusterNodeEdge(cl, ct->n2, ct);
+	}
+	if (sk != NULL && cl == &sk->ctGraph) {
+		SK_SolveInvalidate(sk, ct->n1);
+		SK_SolveInvalidate(sk, ct->n2);
+	}
+}
+
+/*
+ * Allocate a new node name. This is the lowest handle not in use by an
+ * instance of the class.
+ */
 Uint
 SK_GenNodeName(SK *sk, const char *type)
 {
-	Uint name = 1;
+	Uint handle;
 
-	while (SK_FindNode(sk, name, type) != NULL) {
-		if (++name >= SK_NAME_MAX)
-			AG_FatalError("Out of node names");
+	handle = AG_HandleGenerate(&sk->handles, type, SK_NAME_MAX);
+	if (handle == 0) {
+		AG_FatalError("Out of node names");
 	}
-	return (name);
+	return (handle);
+}
+
+/*
+ * Change the handle of a node. If the node->handle was modified directly
+ * (e.g., by a widget binding), calling this function with node->handle
+ * updates the handle table accordingly.
+ */
+void
+SK_NodeSetHandle(void *p, Uint handle)
+{
+	SK_Node *node = p;
+
+	if (node->sk == NULL) {
+		node->handle = handle;
+		return;
+	}
+	AG_MutexLock(&node->sk->lock);
+	AG_HandleRemove(&node->sk->handles, node->ops->name, &node->hEnt);
+	node->handle = handle;
+	AG_HandleInsert(&node->sk->handles, node->ops->name, &node->hEnt,
+	    node->handle, node);
+	AG_MutexUnlock(&node->sk->lock);
 }
 
 M_Color
@@ -277,6 +444,12 @@ SK_NodeInit(void *np, const void *ops, Uint handle, Uint flags)
 
 	n->ops = (const SK_NodeOps *)ops;
 	n->handle = handle;
+	n->hEnt.handle = handle;
+	n->hEnt.p = n;
+	n->hEnt.next = NULL;
+	n->comp = 0;
+	n->solveIdx = 0;
+	n->solveRoot = NULL;
 	AG_Snprintf(n->name, sizeof(n->name), "%s%u", n->ops->name, (Uint)handle);
 
 	n->flags = flags;
@@ -334,11 +507,22 @@ Reset(void *_Nonnull obj)
 		sk->root = NULL;
 	}
 	TAILQ_INIT(&sk->nodes);
+	AG_HandleTblsFree(&sk->handles);
 	SK_InitRoot(sk);
 
 	SK_FreeCluster(&sk->ctGraph);
 	SK_FreeClusters(sk);
 	SK_FreeInsns(sk);
+	SK_SolveInvalidate(sk, NULL);
+}
+
+static void
+Destroy(void *_Nonnull obj)
+{
+	SK *sk = obj;
+
+	AG_HandleTblsFree(&sk->handles);
+	Free(sk->compDirty);
 }
 
 static int
@@ -539,6 +723,8 @@ Load(void *_Nonnull obj, AG_DataSource *_Nonnull buf, const AG_Version *_Nonnull
 		sk->root = NULL;
 	}
 	TAILQ_INIT(&sk->nodes);
+	AG_HandleTblsFree(&sk->handles);
+	SK_SolveInvalidate(sk, NULL);
 
 	/*
 	 * Load the generic part of all nodes. We need to load the data
@@ -548,6 +734,8 @@ Load(void *_Nonnull obj, AG_DataSource *_Nonnull buf, const AG_Version *_Nonnull
 		goto fail;
 	}
 	TAILQ_INSERT_HEAD(&sk->nodes, sk->root, nodes);
+	AG_HandleInsert(&sk->handles, sk->root->ops->name, &sk->root->hEnt,
+	    sk->root->handle, sk->root);
 
 	/* Load the data part of all nodes. */
 	if (SK_LoadNodeData(sk, sk->root, buf) == -1)
@@ -573,7 +761,7 @@ Load(void *_Nonnull obj, AG_DataSource *_Nonnull buf, const AG_Version *_Nonnull
 		}
 		SK_NodeAddConstraint(ct->n1, ct);
 		SK_NodeAddConstraint(ct->n2, ct);
-		TAILQ_INSERT_TAIL(&sk->ctGraph.edges, ct, constraints);
+		InsertEdge(&sk->ctGraph, ct);
 	}
 	SK_Update(sk);
 	AG_MutexUnlock(&sk->lock);
@@ -745,13 +933,11 @@ SK_FindNode(SK *sk, Uint handle, const char *type)
 {
 	SK_Node *node;
 
-	TAILQ_FOREACH(node, &sk->nodes, nodes) {
-		if (node->handle == handle &&
-		    strcmp(node->ops->name, type) == 0)
-			return (node);
+	if ((node = AG_HandleLookup(&sk->handles, type, handle)) == NULL) {
+		AG_SetError("No such node: %u", (Uint)handle);
+		return (NULL);
 	}
-	AG_SetError("No such node: %u", (Uint)handle);
-	return (NULL);
+	return (node);
 }
 
 /* Search a node by name only. */
@@ -805,6 +991,8 @@ SK_NodeAttach(void *ppNode, void *pcNode)
 	cNode->pNode = pNode;
 	TAILQ_INSERT_TAIL(&pNode->cnodes, cNode, sknodes);
 	TAILQ_INSERT_TAIL(&pNode->sk->nodes, cNode, nodes);
+	AG_HandleInsert(&pNode->sk->handles, cNode->ops->name, &cNode->hEnt,
+	    cNode->handle, cNode);
 }
 
 /* Detach a node from its parent in the sketch. */
@@ -829,6 +1017,7 @@ free_constraints:
 	}
 	TAILQ_REMOVE(&pNode->cnodes, cNode, sknodes);
 	TAILQ_REMOVE(&sk->nodes, cNode, nodes);
+	AG_HandleRemove(&sk->handles, cNode->ops->name, &cNode->hEnt);
 	cNode->sk = NULL;
 	cNode->pNode = NULL;
 }
@@ -1034,12 +1223,19 @@ SK_FindCluster(SK *sk, Uint name)
 	return (NULL);
 }
 
-/* Allocate a new cluster name. */
+/*
+ * Allocate a new cluster name. Names are handed out in sequence until
+ * the cluster list is freed.
+ */
 Uint
 SK_GenClusterName(SK *sk)
 {
-	Uint name = 1;
+	Uint name;
 
+	if (sk->clusterName+1 < SK_NAME_MAX) {
+		return (++sk->clusterName);
+	}
+	name = 1;
 	while (SK_FindCluster(sk, name) != NULL) {
 		if (++name >= SK_NAME_MAX)
 			AG_FatalError("Out of cluster names");
@@ -1051,7 +1247,11 @@ void
 SK_InitCluster(SK_Cluster *cl, Uint name)
 {
 	cl->name = name;
+	cl->comp = 0;
 	TAILQ_INIT(&cl->edges);
+	cl->nodeTbl = NULL;
+	cl->nNodeTbl = 0;
+	cl->nNodes = 0;
 }
 
 void
@@ -1067,11 +1267,24 @@ void
 SK_FreeCluster(SK_Cluster *cl)
 {
 	SK_Constraint *ct;
+	SK_ClusterNode *cn, *cnNext;
+	Uint i;
 
 	while ((ct = TAILQ_FIRST(&cl->edges)) != NULL) {
 		TAILQ_REMOVE(&cl->edges, ct, constraints);
 		Free(ct);
 	}
+	for (i = 0; i < cl->nNodeTbl; i++) {
+		for (cn = cl->nodeTbl[i]; cn != NULL; cn = cnNext) {
+			cnNext = cn->next;
+			Free(cn->edges);
+			Free(cn);
+		}
+	}
+	Free(cl->nodeTbl);
+	cl->nodeTbl = NULL;
+	cl->nNodeTbl = 0;
+	cl->nNodes = 0;
 }
 
 void
@@ -1084,6 +1297,17 @@ SK_FreeClusters(SK *sk)
 		SK_FreeCluster(cl);
 		Free(cl);
 	}
+	sk->clusterName = 0;
+}
+
+void
+SK_FreeInsn(SK_Insn *si)
+{
+	Free(si->ct01);
+	if (si->type == SK_COMPOSE_RING) {
+		Free(si->ct02);
+	}
+	Free(si);
 }
 
 void
@@ -1093,7 +1317,7 @@ SK_FreeInsns(SK *sk)
 
 	while ((si = TAILQ_FIRST(&sk->insns)) != NULL) {
 		TAILQ_REMOVE(&sk->insns, si, insns);
-		Free(si);
+		SK_FreeInsn(si);
 	}
 }
 
@@ -1146,7 +1370,7 @@ SK_AddConstraint(SK_Cluster *cl, void *node1, void *node2,
 		ct->type = ct->uType;
 		break;
 	}
-	TAILQ_INSERT_TAIL(&cl->edges, ct, constraints);
+	InsertEdge(cl, ct);
 	return (ct);
 }
 
@@ -1195,7 +1419,17 @@ SK_AddConstraintCopy(SK_Cluster *clDst, const SK_Constraint *ct)
 void
 SK_DelConstraint(SK_Cluster *cl, SK_Constraint *ct)
 {
+	SK *sk = ct->n1->sk;
+
 	TAILQ_REMOVE(&cl->edges, ct, constraints);
+	DelClusterNodeEdge(cl, ct->n1, ct);
+	if (ct->n2 != ct->n1) {
+		DelClusterNodeEdge(cl, ct->n2, ct);
+	}
+	if (sk != NULL && cl == &sk->ctGraph) {
+		SK_SolveInvalidate(sk, ct->n1);
+		SK_SolveInvalidate(sk, ct->n2);
+	}
 	Free(ct);
 }
 
@@ -1243,9 +1477,15 @@ SK_Constraint *
 SK_FindConstraint(const SK_Cluster *cl, enum sk_constraint_type type,
     void *n1, void *n2)
 {
+	SK_ClusterNode *cn;
 	SK_Constraint *ct;
+	Uint i;
 
-	TAILQ_FOREACH(ct, &cl->edges, constraints) {
+	if ((cn = GetClusterNode(cl, n1)) == NULL) {
+		return (NULL);
+	}
+	for (i = 0; i < cn->nEdges; i++) {
+		ct = cn->edges[i];
 		if ((ct->type == type || type == SK_CONSTRAINT_ANY) &&
 		    ((ct->n1 == n1 && ct->n2 == n2) ||
 		     (ct->n1 == n2 && ct->n2 == n1)))
@@ -1275,9 +1515,15 @@ SK_Constraint *
 SK_ConstrainedNodes(const SK_Cluster *cl, const SK_Node *n1,
     const SK_Node *n2)
 {
+	SK_ClusterNode *cn;
 	SK_Constraint *ct;
+	Uint i;
 
-	TAILQ_FOREACH(ct, &cl->edges, constraints) {
+	if ((cn = GetClusterNode(cl, n1)) == NULL) {
+		return (NULL);
+	}
+	for (i = 0; i < cn->nEdges; i++) {
+		ct = cn->edges[i];
 		if ((ct->n1 == n1 && ct->n2 == n2) ||
 		    (ct->n1 == n2 && ct->n2 == n1))
 			return (ct);
@@ -1292,15 +1538,16 @@ SK_ConstrainedNodes(const SK_Cluster *cl, const SK_Node *n1,
 Uint
 SK_NodeConstraintCount(const SK_Cluster *cl, void *node)
 {
+	SK_ClusterNode *cn;
 	SK_Node *nOther;
 	SK_Constraint *ct;
-	Uint count = 0;
+	Uint i, count = 0;
 
-	/* TODO use nCons */
-	TAILQ_FOREACH(ct, &cl->edges, constraints) {
-		if (ct->n1 != node && ct->n2 != node) {
-			continue;
-		}
+	if ((cn = GetClusterNode(cl, node)) == NULL) {
+		return (0);
+	}
+	for (i = 0; i < cn->nEdges; i++) {
+		ct = cn->edges[i];
 		nOther = (ct->n1 == node) ? ct->n2 : ct->n1;
 		if (ct->type == SK_DISTANCE && ct->ct_distance == 0.0) {
 			if (SK_NodeOfClass(node, "Point:*") &&
@@ -1318,17 +1565,10 @@ SK_NodeConstraintCount(const SK_Cluster *cl, void *node)
 }
 
 /* Evaluate whether the given node is in the given constraint graph. */
-/* XXX optimize */
 int
 SK_NodeInCluster(const SK_Node *node, const SK_Cluster *cl)
 {
-	SK_Constraint *ct;
-
-	TAILQ_FOREACH(ct, &cl->edges, constraints) {
-		if (ct->n1 == node || ct->n2 == node)
-			return (1);
-	}
-	return (0);
+	return (GetClusterNode(cl, node) != NULL);
 }
 
 /*
@@ -1339,10 +1579,15 @@ Uint
 SK_ConstraintsToSubgraph(const SK_Cluster *clOrig, const SK_Node *node,
     const SK_Cluster *clSub, SK_Constraint *rv[2])
 {
+	SK_ClusterNode *cn;
 	SK_Constraint *ct;
-	Uint count = 0;
+	Uint i, count = 0;
 
-	TAILQ_FOREACH(ct, &clOrig->edges, constraints) {
+	if ((cn = GetClusterNode(clOrig, node)) == NULL) {
+		return (0);
+	}
+	for (i = 0; i < cn->nEdges; i++) {
+		ct = cn->edges[i];
 		if ((ct->n1 == node && SK_NodeInCluster(ct->n2, clSub)) ||
 		    (ct->n2 == node && SK_NodeInCluster(ct->n1, clSub))) {
 			if (count < 2) {
@@ -1363,6 +1608,7 @@ SK_AddInsn(SK *sk, enum sk_insn_type type, ...)
 
 	si = Malloc(sizeof(SK_Insn));
 	si->type = type;
+	si->comp = sk->solveComp;
 
 	va_start(ap, type);
 	switch (type) {
@@ -1580,7 +1826,7 @@ AG_ObjectClass skClass = {
 	{ 0,0 },
 	Init,
 	Reset,
-	NULL,		/* destroy */
+	Destroy,
 	Load,
 	Save,
 	SK_Edit
@@ -108,6 +108,12 @@ typedef struct sk_node {
 	AG_TAILQ_ENTRY(sk_node) sknodes; /* Entry in transformation tree */
 	AG_TAILQ_ENTRY(sk_node) nodes;	 /* Entry in flat node list */
 	AG_TAILQ_ENTRY(sk_node) rnodes;	 /* Reverse entry (optimization) */
+
+	AG_HandleEnt hEnt;		 /* Entry in handle table */
+
+	Uint comp;			 /* Constraint graph component (solver) */
+	Uint solveIdx;			 /* Position in node list (solver) */
+	struct sk_node *_Nullable solveRoot; /* Union-find parent (solver) */
 } SK_Node;
 
 /* Pair of nodes */
@@ -145,10 +151,22 @@ typedef struct sk_constraint {
 	AG_TAILQ_ENTRY(sk_constraint) constraints;
 } SK_Constraint;
 
+/* Node of a cluster, with its incident constraint edges. */
+typedef struct sk_cluster_node {
+	SK_Node *_Nonnull node;
+	SK_Constraint *_Nonnull *_Nullable edges;	/* Incident edges */
+	Uint                               nEdges, maxEdges;
+	struct sk_cluster_node *_Nullable next;		/* Next in bucket */
+} SK_ClusterNode;
+
 /* Rigid cluster of constrained nodes */
 typedef struct sk_cluster {
 	Uint name;
+	Uint comp;				/* Graph component (solver) */
 	AG_TAILQ_HEAD_(sk_constraint) edges;
+	SK_ClusterNode *_Nullable *_Nullable nodeTbl; /* Nodes (hashed) */
+	Uint                                nNodeTbl; /* Buckets (power of 2) */
+	Uint                                nNodes;
 	AG_TAILQ_ENTRY(sk_cluster) clusters;
 } SK_Cluster;
 
@@ -162,6 +180,7 @@ typedef struct sk_insn {
 	SK_Node *_Nullable n[3];	/* Nodes (n0 = unknown) */
 	SK_Constraint *_Nonnull ct01;	/* Constraint #1 */
 	SK_Constraint *_Nonnull ct02;	/* Constraint #2 */
+	Uint comp;			/* Graph component */
 	AG_TAILQ_ENTRY(sk_insn) insns;
 } SK_Insn;
 
@@ -186,10 +205,13 @@ typedef struct sk {
 	Uint flags;
 #define SK_SKIP_UNKNOWN_NODES	0x01		/* Ignore unimplemented nodes
 						   in load (otherwise fail) */
+#define SK_SOLVE_INCREMENTAL	0x02		/* Only reanalyze the parts of
+						   the graph changed by edits */
 	_Nonnull_Mutex AG_Mutex lock;
 	const struct ag_unit *_Nonnull uLen;	/* Length unit */
 	SK_Node *_Nullable root;		/* Root node */
 	struct sk_nodeq nodes;			/* Flat node list */
+	AG_HandleTbls handles;			/* Handle tables (per class) */
 	SK_Status status;			/* Constrainedness status */
 	char statusText[SK_STATUS_MAX];		/* Status text */
 	Uint nSolutions;			/* Total number of solutions
@@ -200,6 +222,13 @@ typedef struct sk {
 	AG_TAILQ_HEAD_(sk_cluster) clusters;	/* Rigid clusters */
 	AG_TAILQ_HEAD_(sk_insn) insns;		/* Construction steps */
 	AG_TAILQ_HEAD_(sk_group) group;		/* Item groups */
+
+	/* For incremental solving */
+	Uint8 *_Nullable compDirty;		/* Changed graph components */
+	Uint            nComps;			/* Components at last solve */
+	Uint            nDirty;			/* Changes since last solve */
+	Uint solveComp;				/* Component being analyzed */
+	Uint clusterName;			/* Last generated cluster name */
 } SK;
 
 #define SKNODE(node) ((SK_Node *)(node))
@@ -263,6 +292,7 @@ SK_Node	*_Nonnull SK_NodeNew(void *_Nonnull);
 
 void SK_NodeInit(void *_Nonnull, const void *_Nonnull, Uint, Uint);
 void SK_NodeSetName(void *_Nonnull, const char *_Nonnull, ...);
+void SK_NodeSetHandle(void *_Nonnull, Uint);
 int  SK_NodeDel(void *_Nonnull);
 void SK_NodeAttach(void *_Nonnull, void *_Nonnull);
 void SK_NodeDetach(void *_Nonnull, void *_Nonnull);
@@ -293,8 +323,10 @@ void *_Nullable SK_ProximitySearch(SK *_Nonnull, const char *_Nullable,
 		                   M_Vector3 *_Nonnull, void *_Nullable);
 
 int  SK_Solve(SK *_Nonnull);
+void SK_SolveInvalidate(SK *_Nonnull, void *_Nullable);
 void SK_FreeClusters(SK *_Nonnull);
 void SK_FreeInsns(SK *_Nonnull);
+void SK_FreeInsn(SK_Insn *_Nonnull);
 void SK_InitCluster(SK_Cluster *_Nonnull, Uint);
 void SK_FreeCluster(SK_Cluster *_Nonnull);
 void SK_CopyCluster(const SK_Cluster *_Nonnull, SK_Cluster *_Nonnull);
@@ -345,6 +377,9 @@ SK_Constraint *_Nullable SK_ConstrainedNodes(const SK_Cluster *_Nonnull,
 
 Uint SK_NodeConstraintCount(const SK_Cluster *_Nonnull, void *_Nonnull);
 void SK_ComputeIntersections(SK_Group *_Nonnull, SK_Node *_Nonnull, SK_Node *_Nonnull);
+Uint SK_IntersectNodes(SK_Group *_Nonnull, SK_Node *_Nonnull const *_Nonnull,
+                       Uint, Uint);
+#define SK_INTERSECT_ALL_PAIRS 0x01	/* Test every pair (no broad phase) */
 void SK_GeometryMenu(struct sk_view *_Nonnull, void *_Nonnull);
 
 #define	SK_Identity(n)       M_MatIdentity44v(&SKNODE(n)->T)
@@ -383,12 +418,16 @@ static __inline__ void
 SK_SuppressConstraints(void *_Nonnull p)
 {
 	SKNODE(p)->flags |= SK_NODE_SUPCONSTRAINTS;
+	if (SKNODE(p)->sk != NULL)
+		SK_SolveInvalidate(SKNODE(p)->sk, p);
 }
 
 static __inline__ void
 SK_UnsuppressConstraints(void *_Nonnull p)
 {
 	SKNODE(p)->flags &= ~(SK_NODE_SUPCONSTRAINTS);
+	if (SKNODE(p)->sk != NULL)
+		SK_SolveInvalidate(SKNODE(p)->sk, p);
 }
 
 __END_DECLS
@@ -411,6 +411,7 @@ NodeSetName(AG_Event *_Nonnull event)
 {
 	SK_Node *node = AG_PTR(1);
 
+	SK_NodeSetHandle(node, node->handle);	/* Rehash */
 	AG_Snprintf(node->name, sizeof(node->name), "%s%u", node->ops->name,
 	   (Uint)node->handle);
 }
@@ -500,7 +501,9 @@ static void
 UpdateConstraint(AG_Event *_Nonnull event)
 {
 	SK_View *skv = AG_PTR(1);
+	SK_Constraint *ct = AG_PTR(2);
 
+	SK_SolveInvalidate(skv->sk, ct->n1);	/* Program has a copy */
 	SK_Update(skv->sk);
 }
 
@@ -724,6 +727,9 @@ SK_Edit(void *p)
 		/* TODO */
 		AG_MenuAction(pitem, _("Undo"), NULL, NULL, "%p", NULL);
 		AG_MenuAction(pitem, _("Redo"), NULL, NULL, "%p", NULL);
+		AG_MenuSeparator(pitem);
+		AG_MenuUintFlagsMp(pitem, _("Incremental solving"), NULL,
+		    &sk->flags, SK_SOLVE_INCREMENTAL, 0, &sk->lock);
 	}
 	pitem = AG_MenuNode(menu->root, _("View"), NULL);
 	{
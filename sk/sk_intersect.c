@@ -135,6 +135,185 @@ SK_ComputeIntersections(SK_Group *g, SK_Node *n1, SK_Node *n2)
 	}
 }
 
+/* Bounding box of a node, for SK_IntersectNodes(). */
+typedef struct sk_intersect_box {
+	M_Real x1, y1, x2, y2;
+	Uint idx;				/* Index in node array */
+} SK_IntersectBox;
+
+/* Candidate pair of nodes (by index, i < j). */
+typedef struct sk_intersect_pair {
+	Uint i, j;
+} SK_IntersectPair;
+
+/*
+ * Compute the bounding box of a node for the broad phase. Return -1 if
+ * the node cannot intersect with anything. Boxes are padded by the
+ * tolerance of the exact tests.
+ */
+static int
+NodeBounds(SK_Node *_Nonnull node, SK_IntersectBox *_Nonnull b)
+{
+	M_Real eps;
+
+	if (SK_NodeOfClass(node, "Point:*")) {
+		M_Vector3 p = SK_Pos(node);
+
+		b->x1 = b->x2 = p.x;
+		b->y1 = b->y2 = p.y;
+	} else if (SK_NodeOfClass(node, "Line:*")) {
+		M_Vector2 p1 = SK_Pos2(SKLINE(node)->p1);
+		M_Vector2 p2 = SK_Pos2(SKLINE(node)->p2);
+
+		b->x1 = MIN(p1.x, p2.x);
+		b->x2 = MAX(p1.x, p2.x);
+		b->y1 = MIN(p1.y, p2.y);
+		b->y2 = MAX(p1.y, p2.y);
+	} else if (SK_NodeOfClass(node, "Circle:*")) {
+		M_Circle2 C = SK_CircleValue(SKCIRCLE(node));
+
+		b->x1 = C.p.x - C.r;
+		b->x2 = C.p.x + C.r;
+		b->y1 = C.p.y - C.r;
+		b->y2 = C.p.y + C.r;
+	} else {
+		return (-1);
+	}
+	eps = M_MACHEP*(1.0 + MAX(MAX(Fabs(b->x1), Fabs(b->x2)),
+	                          MAX(Fabs(b->y1), Fabs(b->y2))));
+	b->x1 -= eps;
+	b->y1 -= eps;
+	b->x2 += eps;
+	b->y2 += eps;
+	return (0);
+}
+
+static int
+CompareBoxes(const void *_Nonnull p1, const void *_Nonnull p2)
+{
+	const SK_IntersectBox *b1 = p1;
+	const SK_IntersectBox *b2 = p2;
+
+	if (b1->x1 < b2->x1) { return (-1); }
+	if (b1->x1 > b2->x1) { return (1); }
+	return (b1->idx < b2->idx) ? -1 : (b1->idx > b2->idx);
+}
+
+static int
+ComparePairs(const void *_Nonnull p1, const void *_Nonnull p2)
+{
+	const SK_IntersectPair *a = p1;
+	const SK_IntersectPair *b = p2;
+
+	if (a->i != b->i) {
+		return (a->i < b->i) ? -1 : 1;
+	}
+	return (a->j < b->j) ? -1 : (a->j > b->j);
+}
+
+/*
+ * Compute the intersections between every pair of nodes in an array and
+ * create entities for them in the given group. Return the number of pairs
+ * passed to SK_ComputeIntersections().
+ *
+ * Unless SK_INTERSECT_ALL_PAIRS is given, a sweep over the bounding boxes
+ * of the nodes selects the pairs worth testing. The pairs are tested in
+ * the same order (i < j) in both cases, so the same entities are created.
+ */
+Uint
+SK_IntersectNodes(SK_Group *g, SK_Node *const *nodes, Uint nNodes, Uint flags)
+{
+	SK_IntersectBox *boxes;
+	SK_IntersectPair *pairs = NULL;
+	Uint *active, nActive = 0;
+	Uint nBoxes = 0, nPairs = 0, maxPairs = 0;
+	Uint i, j, k;
+	M_Real wx = 0.0, wy = 0.0;
+	M_Real xMin, xMax, yMin, yMax;
+	int swap;
+
+	if (flags & SK_INTERSECT_ALL_PAIRS) {
+		for (i = 0; i < nNodes; i++) {
+			for (j = i+1; j < nNodes; j++)
+				SK_ComputeIntersections(g, nodes[i], nodes[j]);
+		}
+		return (nNodes > 1) ? nNodes*(nNodes-1)/2 : 0;
+	}
+	if (nNodes < 2)
+		return (0);
+
+	boxes = Malloc(nNodes*sizeof(SK_IntersectBox));
+	xMin = yMin = M_INFINITY;
+	xMax = yMax = -M_INFINITY;
+	for (i = 0; i < nNodes; i++) {
+		SK_IntersectBox *b = &boxes[nBoxes];
+
+		if (NodeBounds(nodes[i], b) == -1) {
+			continue;
+		}
+		b->idx = i;
+		wx += b->x2 - b->x1;
+		wy += b->y2 - b->y1;
+		xMin = MIN(xMin, b->x1);
+		xMax = MAX(xMax, b->x2);
+		yMin = MIN(yMin, b->y1);
+		yMax = MAX(yMax, b->y2);
+		nBoxes++;
+	}
+
+	/* Sweep along the axis where the boxes overlap the least. */
+	swap = (wy*(xMax - xMin) < wx*(yMax - yMin));
+	if (swap) {
+		for (i = 0; i < nBoxes; i++) {
+			SK_IntersectBox *b = &boxes[i];
+			M_Real t;
+
+			t = b->x1;  b->x1 = b->y1;  b->y1 = t;
+			t = b->x2;  b->x2 = b->y2;  b->y2 = t;
+		}
+	}
+	qsort(boxes, nBoxes, sizeof(SK_IntersectBox), CompareBoxes);
+
+	active = Malloc((nBoxes+1)*sizeof(Uint));
+	for (i = 0; i < nBoxes; i++) {
+		const SK_IntersectBox *b = &boxes[i];
+
+		for (j = 0, k = 0; j < nActive; j++) {
+			const SK_IntersectBox *bA = &boxes[active[j]];
+
+			if (bA->x2 < b->x1) {		/* Left behind */
+				continue;
+			}
+			active[k++] = active[j];
+			if (bA->y2 < b->y1 || bA->y1 > b->y2) {
+				continue;
+			}
+			if (nPairs+1 > maxPairs) {
+				maxPairs = (maxPairs > 0) ? maxPairs<<1 : 64;
+				pairs = Realloc(pairs,
+				    maxPairs*sizeof(SK_IntersectPair));
+			}
+			pairs[nPairs].i = MIN(b->idx, bA->idx);
+			pairs[nPairs].j = MAX(b->idx, bA->idx);
+			nPairs++;
+		}
+		nActive = k;
+		active[nActive++] = i;
+	}
+	Free(active);
+	Free(boxes);
+
+	if (nPairs > 0) {
+		qsort(pairs, nPairs, sizeof(SK_IntersectPair), ComparePairs);
+		for (i = 0; i < nPairs; i++) {
+			SK_ComputeIntersections(g, nodes[pairs[i].i],
+			                           nodes[pairs[i].j]);
+		}
+		Free(pairs);
+	}
+	return (nPairs);
+}
+
 const SK_IntersectFn skIntersectFns[] = {
 	{ "Point:*",	"Point:*",	IntersectPointPoint },
 /*	{ "Point:*",	"Line:*",	IntersectPointLine }, */
@@ -46,75 +46,181 @@
  *   equations (linear, linear-quadratic and quadratic). Where multiple
  *   solutions are possible, we optimize for minimum displacement from
  *   the original point.
+ *
+ * Incremental solving (SK_SOLVE_INCREMENTAL):
+ *   Clusters never span two connected components of the constraint graph,
+ *   so the analysis is done one component at a time and the resulting
+ *   clusters and instructions are tagged with their component. Changes to
+ *   the constraint graph mark the components of the affected nodes dirty
+ *   (see SK_SolveInvalidate()), and the next SK_Solve() only reanalyzes
+ *   those components, keeping the program of the others.
  */
 
 #include <agar/core/core.h>
 
 #include "sk.h"
 
+AG_TAILQ_HEAD(sk_clusterq, sk_cluster);
+
+/* Working state of SK_Solve(). */
+typedef struct sk_solve_ctx {
+	SK *_Nonnull sk;
+	SK_Node *_Nonnull *_Nonnull nodes;	/* Nodes (by solveIdx) */
+	Uint                       nNodes;
+	SK_Constraint *_Nonnull *_Nonnull edges; /* Constraint graph edges */
+	Uint                             nEdges;
+	Uint8 *_Nonnull edgeUsed;		/* Edge belongs to a cluster */
+	Uint *_Nonnull adjOffs;			/* Incident edges of nodes */
+	Uint *_Nonnull adj;
+	Uint8 *_Nonnull queued;			/* Node is in work queue */
+	Uint *_Nonnull queue;			/* Work queue (min-heap) */
+	Uint          nQueue;
+} SK_SolveCtx;
+
+static SK_Node *_Nonnull
+FindRoot(SK_Node *_Nonnull node)
+{
+	while (node->solveRoot != node) {
+		node->solveRoot = node->solveRoot->solveRoot;
+		node = node->solveRoot;
+	}
+	return (node);
+}
+
 /*
- * Look for nodes in clOrig that share exactly two edges with cluster cl
- * and merge them into it (deleting them from clOrig). Since our elements
- * have two degrees of freedom, any element connected to a rigid cluster
- * by two constraints can be merged in that cluster.
+ * Queue a node for evaluation by MergeConstrainedRings(). Nodes come out
+ * in the order of the sketch's node list.
  */
 static void
-MergeConstrainedRings(SK *_Nonnull sk, SK_Cluster *_Nonnull clOrig,
-    SK_Cluster *_Nonnull cl)
+QueueNode(SK_SolveCtx *_Nonnull ctx, const SK_Node *_Nonnull node)
 {
-	SK_Constraint *ct, *ctPair[2];
-	SK_Node *nUnknown, *nKnown[2];
-	Uint i, count;
-	
-	Debug(sk, "Solver: MergeConstrainedRings(Cluster%u)\n", (Uint)cl->name);
-restart:
-	TAILQ_FOREACH(nUnknown, &sk->nodes, nodes) {
-		if (nUnknown->flags & (SK_NODE_SUPCONSTRAINTS|SK_NODE_FIXED)) {
+	Uint idx = node->solveIdx, i;
+
+	if (ctx->queued[idx] ||
+	    node->flags & (SK_NODE_SUPCONSTRAINTS|SK_NODE_FIXED)) {
+		return;
+	}
+	ctx->queued[idx] = 1;
+	for (i = ctx->nQueue++; i > 0; i = (i-1) >> 1) {
+		if (ctx->queue[(i-1) >> 1] <= idx) {
+			break;
+		}
+		ctx->queue[i] = ctx->queue[(i-1) >> 1];
+	}
+	ctx->queue[i] = idx;
+}
+
+static SK_Node *_Nullable
+DequeueNode(SK_SolveCtx *_Nonnull ctx)
+{
+	Uint idx, last, i = 0, j;
+
+	if (ctx->nQueue == 0) {
+		return (NULL);
+	}
+	idx = ctx->queue[0];
+	last = ctx->queue[--ctx->nQueue];
+	while ((j = (i << 1) + 1) < ctx->nQueue) {
+		if (j+1 < ctx->nQueue && ctx->queue[j+1] < ctx->queue[j]) {
+			j++;
+		}
+		if (last <= ctx->queue[j]) {
+			break;
+		}
+		ctx->queue[i] = ctx->queue[j];
+		i = j;
+	}
+	ctx->queue[i] = last;
+	ctx->queued[idx] = 0;
+	return (ctx->nodes[idx]);
+}
+
+/* Queue the nodes sharing an unused edge with the given node. */
+static void
+QueueNeighbors(SK_SolveCtx *_Nonnull ctx, const SK_Node *_Nonnull node)
+{
+	Uint k;
+
+	for (k = ctx->adjOffs[node->solveIdx];
+	     k < ctx->adjOffs[node->solveIdx+1];
+	     k++) {
+		const SK_Constraint *ct = ctx->edges[ctx->adj[k]];
+
+		if (ctx->edgeUsed[ctx->adj[k]]) {
 			continue;
 		}
+		QueueNode(ctx, (ct->n1 == node) ? ct->n2 : ct->n1);
+	}
+}
+
+/*
+ * Look for nodes that share exactly two unused edges with cluster cl
+ * and merge them into it. Since our elements have two degrees of freedom,
+ * any element connected to a rigid cluster by two constraints can be
+ * merged in that cluster.
+ *
+ * Only the nodes whose edge count to cl may have changed are examined,
+ * lowest position in the node list first.
+ */
+static void
+MergeConstrainedRings(SK_SolveCtx *_Nonnull ctx, SK_Cluster *_Nonnull cl,
+    SK_Node *_Nonnull n1, SK_Node *_Nonnull n2)
+{
+	SK *sk = ctx->sk;
+	SK_Node *nUnknown, *nOther, *nKnown[2];
+	Uint i, k, count, ePair[2];
+	
+	Debug(sk, "Solver: MergeConstrainedRings(Cluster%u)\n", (Uint)cl->name);
+
+	QueueNeighbors(ctx, n1);
+	QueueNeighbors(ctx, n2);
+
+	while ((nUnknown = DequeueNode(ctx)) != NULL) {
 		count = 0;
-		TAILQ_FOREACH(ct, &clOrig->edges, constraints) {
-			if (ct->n1 == nUnknown &&
-			    SK_NodeInCluster(ct->n2, cl)) {
-				if (count < 2) {
-					ctPair[count] = ct;
-					nKnown[count] = ct->n2;
-				}
-				count++;
-			} else if (ct->n2 == nUnknown &&
-			     SK_NodeInCluster(ct->n1, cl)) {
-				if (count < 2) {
-					ctPair[count] = ct;
-					nKnown[count] = ct->n1;
-				}
-				count++;
+		for (k = ctx->adjOffs[nUnknown->solveIdx];
+		     k < ctx->adjOffs[nUnknown->solveIdx+1];
+		     k++) {
+			SK_Constraint *ct = ctx->edges[ctx->adj[k]];
+
+			if (ctx->edgeUsed[ctx->adj[k]]) {
+				continue;
 			}
+			nOther = (ct->n1 == nUnknown) ? ct->n2 : ct->n1;
+			if (!SK_NodeInCluster(nOther, cl)) {
+				continue;
+			}
+			if (count < 2) {
+				ePair[count] = ctx->adj[k];
+				nKnown[count] = nOther;
+			}
+			count++;
 		}
 		if (count != 2) {
 			continue;
 		}
 		SK_AddInsn(sk, SK_COMPOSE_RING,
 		    nUnknown, nKnown[0], nKnown[1],
-		    SK_DupConstraint(ctPair[0]),
-		    SK_DupConstraint(ctPair[1]));
+		    SK_DupConstraint(ctx->edges[ePair[0]]),
+		    SK_DupConstraint(ctx->edges[ePair[1]]));
 		for (i = 0; i < 2; i++) {
-			SK_AddConstraintCopy(cl, ctPair[i]);
-			SK_DelConstraint(clOrig, ctPair[i]);
+			SK_AddConstraintCopy(cl, ctx->edges[ePair[i]]);
+			ctx->edgeUsed[ePair[i]] = 1;
 		}
-
-		/* XXX is this needed? */
-		goto restart;
+		QueueNode(ctx, nKnown[0]);
+		QueueNode(ctx, nKnown[1]);
+		QueueNeighbors(ctx, nUnknown);
 	}
 }
 
 /*
- * Look for any sketch cluster that shares two elements with the given
+ * Look for any cluster that shares two elements with the given
  * cluster, and merge them into a single cluster.
  *
- * cl must not be already attached to sk.
+ * cl must not be already in the list.
  */
 static void
-MergeConstrainedClusters(SK *_Nonnull sk, SK_Cluster *_Nonnull clMerged)
+MergeConstrainedClusters(SK *_Nonnull sk, struct sk_clusterq *_Nonnull clq,
+    SK_Cluster *_Nonnull clMerged)
 {
 	SK_Cluster *cl;
 	SK_Constraint *ct;
@@ -123,7 +229,7 @@ MergeConstrainedClusters(SK *_Nonnull sk, SK_Cluster *_Nonnull clMerged)
 	Debug(sk, "Solver: MergeConstrainedClusters(Cluster%u)\n",
 	    (Uint)clMerged->name);
 restart:
-	TAILQ_FOREACH(cl, &sk->clusters, clusters) {
+	TAILQ_FOREACH(cl, clq, clusters) {
 		count = 0;
 		TAILQ_FOREACH(ct, &cl->edges, constraints) {
 			if (SK_NodeInCluster(ct->n1, clMerged) ||
@@ -135,7 +241,7 @@ restart:
 			    "Solver: Merging cluster%d into cluster%d (pair)\n",
 			    cl->name, clMerged->name);
 			SK_CopyCluster(cl, clMerged);
-			TAILQ_REMOVE(&sk->clusters, cl, clusters);
+			TAILQ_REMOVE(clq, cl, clusters);
 			SK_FreeCluster(cl);
 			Free(cl);
 			goto restart;		/* Cluster chain changed */
@@ -214,49 +320,47 @@ under:
 }
 
 /*
- * Analyze the constraint graph, determine its constrainedness and
- * generate a sketch placement program.
+ * Analyze one connected component of the constraint graph (given as its
+ * edges and nodes, in list order), generating its clusters and its part
+ * of the placement program.
  */
-int
-SK_Solve(SK *sk)
+static void
+AnalyzeComponent(SK_SolveCtx *_Nonnull ctx, Uint comp,
+    const Uint *_Nonnull compEdges, Uint nCompEdges,
+    SK_Node *_Nonnull *_Nonnull compNodes, Uint nCompNodes)
 {
-	SK_Cluster clOrig;
+	SK *sk = ctx->sk;
+	struct sk_clusterq clq = TAILQ_HEAD_INITIALIZER(clq);
 	SK_Cluster *cl, *clRing[3], *clPair[2];
 	SK_Constraint *ct;
 	SK_Node *node;
 	Uint i, j, count, nRing;
 
-	AG_MutexLock(&sk->lock);
-
-	if (TAILQ_EMPTY(&sk->ctGraph.edges)) 		/* Nothing to do */
-		goto out;
+	sk->solveComp = comp;
 
 	/*
 	 * First Phase: Degree of freedom analysis.
 	 */
-
-	/* Copy the source graph since we will modify its elements. */
-	SK_FreeClusters(sk);
-	SK_FreeInsns(sk);
-	SK_InitCluster(&clOrig, 1);
-	SK_CopyCluster(&sk->ctGraph, &clOrig);
-
-	while (!TAILQ_EMPTY(&clOrig.edges)) {
+	for (j = 0; j < nCompEdges; j++) {
+		if (ctx->edgeUsed[compEdges[j]]) {
+			continue;
+		}
 		cl = Malloc(sizeof(SK_Cluster));
 		SK_InitCluster(cl, SK_GenClusterName(sk));
+		cl->comp = comp;
 
-		/* Start with any edge and find n2 from n1. */
-		ct = TAILQ_FIRST(&clOrig.edges);
+		/* Start with the first unused edge and find n2 from n1. */
+		ct = ctx->edges[compEdges[j]];
 		Debug(sk, "Solver: Starting DOF analysis with %s-%s\n",
 		    ct->n1->name, ct->n2->name);
 		SK_AddConstraintCopy(cl, ct);
 		SK_AddInsn(sk, SK_COMPOSE_PAIR, ct->n1, ct->n2,
 		    SK_DupConstraint(ct));
-		SK_DelConstraint(&clOrig, ct);
+		ctx->edgeUsed[compEdges[j]] = 1;
 	
 		/* Keep merging constrained rings into this cluster. */
-		MergeConstrainedRings(sk, &clOrig, cl);
-		TAILQ_INSERT_TAIL(&sk->clusters, cl, clusters);
+		MergeConstrainedRings(ctx, cl, ct->n1, ct->n2);
+		TAILQ_INSERT_TAIL(&clq, cl, clusters);
 	}
 
 	/*
@@ -265,30 +369,34 @@ SK_Solve(SK *sk)
 	 */
 merge_rings:
 	nRing = 0;
-	TAILQ_FOREACH(node, &sk->nodes, nodes) {
+	for (j = 0; j < nCompNodes; j++) {
+		node = compNodes[j];
 		if (node->flags & SK_NODE_SUPCONSTRAINTS) {
 			continue;
 		}
 		count = 0;
-		TAILQ_FOREACH(cl, &sk->clusters, clusters) {
+		TAILQ_FOREACH(cl, &clq, clusters) {
 			if (SK_NodeInCluster(node, cl)) {
 				if (count < 2) {
 					clPair[count] = cl;
 				}
-				count++;
+				if (++count > 2)
+					break;
 			}
 		}
 		if (count == 2) {
 			Debug(sk,
 			    "Solver: %s is shared by Cluster%u and Cluster%u\n",
 			    node->name, (Uint)clPair[0]->name, (Uint)clPair[1]->name);
-			for (j = 0; j < 2; j++) {
-				for (i = 0; i < nRing; i++) {
-					if (clRing[i] == clPair[j])
+			for (i = 0; i < 2; i++) {
+				Uint k;
+
+				for (k = 0; k < nRing; k++) {
+					if (clRing[k] == clPair[i])
 						break;
 				}
-				if (i == nRing && nRing < 3) {
-					clRing[nRing++] = clPair[j];
+				if (k == nRing && nRing < 3) {
+					clRing[nRing++] = clPair[i];
 				}
 			}
 			if (nRing == 3)
@@ -300,6 +408,7 @@ merge_rings:
 
 		clMerged = Malloc(sizeof(SK_Cluster));
 		SK_InitCluster(clMerged, SK_GenClusterName(sk));
+		clMerged->comp = comp;
 		Debug(sk,
 		    "Solver: Merging ring: Cluster%u-Cluster%u-Cluster%u -> "
 		    "Cluster%u\n",
@@ -307,7 +416,7 @@ merge_rings:
 		    clMerged->name);
 		for (i = 0; i < 3; i++) {
 			SK_CopyCluster(clRing[i], clMerged);
-			TAILQ_REMOVE(&sk->clusters, clRing[i], clusters);
+			TAILQ_REMOVE(&clq, clRing[i], clusters);
 			SK_FreeCluster(clRing[i]);
 			Free(clRing[i]);
 		}
@@ -316,13 +425,293 @@ merge_rings:
 		 * Merge any other cluster sharing two elements with
 		 * the new cluster.
 		 */
-		MergeConstrainedClusters(sk, clMerged);
+		MergeConstrainedClusters(sk, &clq, clMerged);
 
-		TAILQ_INSERT_TAIL(&sk->clusters, clMerged, clusters);
+		TAILQ_INSERT_TAIL(&clq, clMerged, clusters);
 		goto merge_rings;
 	}
+
+	while ((cl = TAILQ_FIRST(&clq)) != NULL) {
+		TAILQ_REMOVE(&clq, cl, clusters);
+		TAILQ_INSERT_TAIL(&sk->clusters, cl, clusters);
+	}
+	sk->solveComp = 0;
+}
+
+/*
+ * Analyze the constraint graph, determine its constrainedness and
+ * generate a sketch placement program.
+ *
+ * In incremental mode, only the components of the graph changed since
+ * the last call are analyzed again.
+ */
+int
+SK_Solve(SK *sk)
+{
+	SK_SolveCtx ctx;
+	SK_Cluster *cl, *clNext;
+	SK_Insn *si, *siNext;
+	SK_Constraint *ct;
+	SK_Node *node, *r1, *r2, **compNodes;
+	Uint *rootComp, *edgeComp, *compOld, *oldToNew, *compEdges;
+	Uint *compEdgeOffs, *compNodeOffs, *fill;
+	Uint8 *compClean;
+	Uint i, c, oc, nComps;
+
+	AG_MutexLock(&sk->lock);
+
+	if (!(sk->flags & SK_SOLVE_INCREMENTAL)) {
+		SK_FreeClusters(sk);
+		SK_FreeInsns(sk);
+		SK_SolveInvalidate(sk, NULL);
+	} else if (sk->nDirty == 0) {
+		/*
+		 * The program is up to date, but unconstrained nodes may
+		 * have been added or deleted since.
+		 */
+		UpdateConstraintStatus(sk);
+		goto out;
+	}
+	if (TAILQ_EMPTY(&sk->ctGraph.edges)) {		/* Nothing to do */
+		SK_FreeClusters(sk);
+		SK_FreeInsns(sk);
+		sk->nComps = 0;
+		sk->nDirty = 0;
+		goto out;
+	}
+
+	/* Index the nodes and edges. */
+	ctx.sk = sk;
+	ctx.nNodes = 0;
+	TAILQ_FOREACH(node, &sk->nodes, nodes) {
+		node->solveIdx = ctx.nNodes++;
+		node->solveRoot = node;
+	}
+	ctx.nodes = Malloc(ctx.nNodes*sizeof(SK_Node *));
+	TAILQ_FOREACH(node, &sk->nodes, nodes) {
+		ctx.nodes[node->solveIdx] = node;
+	}
+	ctx.nEdges = 0;
+	TAILQ_FOREACH(ct, &sk->ctGraph.edges, constraints) {
+		ctx.nEdges++;
+	}
+	ctx.edges = Malloc(ctx.nEdges*sizeof(SK_Constraint *));
+	i = 0;
+	TAILQ_FOREACH(ct, &sk->ctGraph.edges, constraints) {
+		ctx.edges[i++] = ct;
+		if ((r1 = FindRoot(ct->n1)) != (r2 = FindRoot(ct->n2)))
+			r2->solveRoot = r1;
+	}
+
+	/* Number the connected components of the graph. */
+	rootComp = Malloc(ctx.nNodes*sizeof(Uint));
+	memset(rootComp, 0, ctx.nNodes*sizeof(Uint));
+	edgeComp = Malloc(ctx.nEdges*sizeof(Uint));
+	nComps = 0;
+	for (i = 0; i < ctx.nEdges; i++) {
+		r1 = FindRoot(ctx.edges[i]->n1);
+		if (rootComp[r1->solveIdx] == 0) {
+			rootComp[r1->solveIdx] = ++nComps;
+		}
+		edgeComp[i] = rootComp[r1->solveIdx];
+	}
+
+	/*
+	 * A component is clean if all of its nodes were in the same component
+	 * at the last solve, and no change was reported for that component.
+	 */
+	compOld = Malloc((nComps+1)*sizeof(Uint));
+	memset(compOld, 0, (nComps+1)*sizeof(Uint));
+	compClean = Malloc(nComps+1);
+	memset(compClean, 1, nComps+1);
+	for (i = 0; i < ctx.nEdges; i++) {
+		SK_Node *n[2];
+		int k;
+
+		c = edgeComp[i];
+		n[0] = ctx.edges[i]->n1;
+		n[1] = ctx.edges[i]->n2;
+		for (k = 0; k < 2; k++) {
+			oc = n[k]->comp;
+			if (oc == 0 || oc > sk->nComps || sk->compDirty[oc]) {
+				compClean[c] = 0;
+			} else if (compOld[c] == 0) {
+				compOld[c] = oc;
+			} else if (compOld[c] != oc) {
+				compClean[c] = 0;
+			}
+		}
+	}
+	oldToNew = Malloc((sk->nComps+1)*sizeof(Uint));
+	memset(oldToNew, 0, (sk->nComps+1)*sizeof(Uint));
+	for (c = 1; c <= nComps; c++) {
+		if (!compClean[c]) {
+			continue;
+		}
+		if (oldToNew[compOld[c]] != 0) {	/* Split (paranoid) */
+			compClean[oldToNew[compOld[c]]] = 0;
+			compClean[c] = 0;
+		} else {
+			oldToNew[compOld[c]] = c;
+		}
+	}
+	for (c = 1; c <= nComps; c++) {
+		if (compOld[c] != 0 && oldToNew[compOld[c]] != 0 &&
+		    !compClean[oldToNew[compOld[c]]])
+			oldToNew[compOld[c]] = 0;
+	}
+
+	/* Discard the clusters and instructions of changed components. */
+	for (cl = TAILQ_FIRST(&sk->clusters);
+	     cl != TAILQ_END(&sk->clusters);
+	     cl = clNext) {
+		clNext = TAILQ_NEXT(cl, clusters);
+		oc = cl->comp;
+		if (oc >= 1 && oc <= sk->nComps && oldToNew[oc] != 0) {
+			cl->comp = oldToNew[oc];
+			continue;
+		}
+		TAILQ_REMOVE(&sk->clusters, cl, clusters);
+		SK_FreeCluster(cl);
+		Free(cl);
+	}
+	for (si = TAILQ_FIRST(&sk->insns);
+	     si != TAILQ_END(&sk->insns);
+	     si = siNext) {
+		siNext = TAILQ_NEXT(si, insns);
+		oc = si->comp;
+		if (oc >= 1 && oc <= sk->nComps && oldToNew[oc] != 0) {
+			si->comp = oldToNew[oc];
+			continue;
+		}
+		TAILQ_REMOVE(&sk->insns, si, insns);
+		SK_FreeInsn(si);
+	}
+	if (TAILQ_EMPTY(&sk->clusters))
+		sk->clusterName = 0;
+
+	/* Record the new components. */
+	TAILQ_FOREACH(node, &sk->nodes, nodes) {
+		node->comp = 0;
+	}
+	for (i = 0; i < ctx.nEdges; i++) {
+		ctx.edges[i]->n1->comp = edgeComp[i];
+		ctx.edges[i]->n2->comp = edgeComp[i];
+	}
+
+	/* Build the edge incidence lists (in edge order). */
+	ctx.adjOffs = Malloc((ctx.nNodes+1)*sizeof(Uint));
+	memset(ctx.adjOffs, 0, (ctx.nNodes+1)*sizeof(Uint));
+	for (i = 0; i < ctx.nEdges; i++) {
+		ct = ctx.edges[i];
+		ctx.adjOffs[ct->n1->solveIdx+1]++;
+		if (ct->n2 != ct->n1)
+			ctx.adjOffs[ct->n2->solveIdx+1]++;
+	}
+	for (i = 0; i < ctx.nNodes; i++) {
+		ctx.adjOffs[i+1] += ctx.adjOffs[i];
+	}
+	ctx.adj = Malloc((ctx.adjOffs[ctx.nNodes]+1)*sizeof(Uint));
+	fill = Malloc((ctx.nNodes+1)*sizeof(Uint));
+	memcpy(fill, ctx.adjOffs, ctx.nNodes*sizeof(Uint));
+	for (i = 0; i < ctx.nEdges; i++) {
+		ct = ctx.edges[i];
+		ctx.adj[fill[ct->n1->solveIdx]++] = i;
+		if (ct->n2 != ct->n1)
+			ctx.adj[fill[ct->n2->solveIdx]++] = i;
+	}
+	ctx.edgeUsed = Malloc(ctx.nEdges);
+	memset(ctx.edgeUsed, 0, ctx.nEdges);
+	ctx.queued = Malloc(ctx.nNodes);
+	memset(ctx.queued, 0, ctx.nNodes);
+	ctx.queue = Malloc((ctx.nNodes+1)*sizeof(Uint));
+	ctx.nQueue = 0;
+
+	/* Group the edges and the nodes by component (in list order). */
+	compEdgeOffs = Malloc((nComps+2)*sizeof(Uint));
+	compNodeOffs = Malloc((nComps+2)*sizeof(Uint));
+	memset(compEdgeOffs, 0, (nComps+2)*sizeof(Uint));
+	memset(compNodeOffs, 0, (nComps+2)*sizeof(Uint));
+	for (i = 0; i < ctx.nEdges; i++) {
+		compEdgeOffs[edgeComp[i]+1]++;
+	}
+	for (i = 0; i < ctx.nNodes; i++) {
+		compNodeOffs[ctx.nodes[i]->comp+1]++;
+	}
+	for (c = 0; c <= nComps; c++) {
+		compEdgeOffs[c+1] += compEdgeOffs[c];
+		compNodeOffs[c+1] += compNodeOffs[c];
+	}
+	compEdges = Malloc((ctx.nEdges+1)*sizeof(Uint));
+	compNodes = Malloc((ctx.nNodes+1)*sizeof(SK_Node *));
+	fill = Realloc(fill, (nComps+1)*sizeof(Uint));
+	memcpy(fill, compEdgeOffs, (nComps+1)*sizeof(Uint));
+	for (i = 0; i < ctx.nEdges; i++) {
+		compEdges[fill[edgeComp[i]]++] = i;
+	}
+	memcpy(fill, compNodeOffs, (nComps+1)*sizeof(Uint));
+	for (i = 0; i < ctx.nNodes; i++) {
+		compNodes[fill[ctx.nodes[i]->comp]++] = ctx.nodes[i];
+	}
+
+	/* Analyze the changed components. */
+	for (c = 1; c <= nComps; c++) {
+		if (compClean[c]) {
+			continue;
+		}
+		AnalyzeComponent(&ctx, c,
+		    &compEdges[compEdgeOffs[c]],
+		    compEdgeOffs[c+1] - compEdgeOffs[c],
+		    &compNodes[compNodeOffs[c]],
+		    compNodeOffs[c+1] - compNodeOffs[c]);
+	}
+
+	sk->compDirty = Realloc(sk->compDirty, nComps+1);
+	memset(sk->compDirty, 0, nComps+1);
+	sk->nComps = nComps;
+	sk->nDirty = 0;
+
+	Free(compNodes);
+	Free(compEdges);
+	Free(compNodeOffs);
+	Free(compEdgeOffs);
+	Free(fill);
+	Free(ctx.queue);
+	Free(ctx.queued);
+	Free(ctx.edgeUsed);
+	Free(ctx.adj);
+	Free(ctx.adjOffs);
+	Free(oldToNew);
+	Free(compClean);
+	Free(compOld);
+	Free(edgeComp);
+	Free(rootComp);
+	Free(ctx.edges);
+	Free(ctx.nodes);
+
 	UpdateConstraintStatus(sk);
 out:
 	AG_MutexUnlock(&sk->lock);
 	return (0);
 }
+
+/*
+ * Report a change affecting the analysis of the constraint graph around
+ * the given node (e.g., a modified constraint), or of the entire graph if
+ * node is NULL. Adding or removing constraints in the graph of the sketch
+ * is reported automatically.
+ */
+void
+SK_SolveInvalidate(SK *sk, void *pNode)
+{
+	SK_Node *node = pNode;
+
+	AG_MutexLock(&sk->lock);
+	if (node == NULL) {
+		sk->nComps = 0;
+	} else if (node->comp > 0 && node->comp <= sk->nComps) {
+		sk->compDirty[node->comp] = 1;
+	}
+	sk->nDirty++;
+	AG_MutexUnlock(&sk->lock);
+}
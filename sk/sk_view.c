@@ -510,40 +510,32 @@ static void
 ComputeIntersections(AG_Event *_Nonnull event)
 {
 	SK *sk = AG_PTR(1);
-	SK_Node *n1, *n2;
+	SK_Node *node, **nodes;
 	SK_Group *g;
-	SK_NodePair *tested;
-	Uint i, nTested = 0;
-
-	g = SK_GroupNew(sk->root);
-	tested = Malloc(sizeof(SK_NodePair));
+	Uint nNodes = 0;
+#ifdef AG_DEBUG
+	Uint nPairs;
+#endif
 
-	TAILQ_FOREACH(n1, &sk->nodes, nodes) {
-		if (!SKNODE_SELECTED(n1)) {
-			continue;
-		}
-		TAILQ_FOREACH(n2, &sk->nodes, nodes) {
-			if (!SKNODE_SELECTED(n2) || n2 == n1) {
-				continue;
-			}
-			for (i = 0; i < nTested; i++) {
-				if (SK_CompareNodePair(&tested[i], n1, n2))
-					break;
-			}
-			if (i < nTested) {
-				continue;
-			}
-			Debug(sk, "Computing %s-%s intersections\n",
-			    n1->name, n2->name);
-			SK_ComputeIntersections(g, n1, n2);
-			tested = Realloc(tested, (nTested+1)*
-			                         sizeof(SK_NodePair));
-			tested[nTested].n1 = n1;
-			tested[nTested].n2 = n2;
-			nTested++;
-		}
+	TAILQ_FOREACH(node, &sk->nodes, nodes) {
+		if (SKNODE_SELECTED(node))
+			nNodes++;
 	}
-	Free(tested);
+	nodes = Malloc((nNodes+1)*sizeof(SK_Node *));
+	nNodes = 0;
+	TAILQ_FOREACH(node, &sk->nodes, nodes) {
+		if (SKNODE_SELECTED(node))
+			nodes[nNodes++] = node;
+	}
+	g = SK_GroupNew(sk->root);
+#ifdef AG_DEBUG
+	nPairs = SK_IntersectNodes(g, nodes, nNodes, 0);
+	Debug(sk, "Computed intersections of %u pairs (%u nodes)\n",
+	    nPairs, nNodes);
+#else
+	SK_IntersectNodes(g, nodes, nNodes, 0);
+#endif
+	Free(nodes);
 }
 
 /* Expand the SK_View popup menu. */
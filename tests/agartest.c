@@ -10,10 +10,16 @@
 #include <string.h>
 
 #include <agar/config/ag_unicode.h>
+#include <agar/config/ag_serialization.h>
+#include <agar/config/_mk_have_unistd_h.h>
 #include <agar/config/have_opengl.h>
 #include "config/have_agar_au.h"
+#include "config/have_agar_sk.h"
 #include "config/datadir.h"
 
+#ifdef HAVE_AGAR_AU
+extern const AG_TestCase audioTest;
+#endif
 extern const AG_TestCase checkboxTest;
 #ifdef AG_UNICODE
 extern const AG_TestCase charsetsTest;
@@ -23,7 +29,11 @@ extern const AG_TestCase compositingTest;
 #endif
 extern const AG_TestCase configSettingsTest;
 extern const AG_TestCase consoleTest;
+extern const AG_TestCase coreOpsTest;
 extern const AG_TestCase customWidgetTest;
+#if defined(AG_SERIALIZATION) && defined(_MK_HAVE_UNISTD_H)
+extern const AG_TestCase dbTest;
+#endif
 extern const AG_TestCase fixedResTest;
 extern const AG_TestCase focusingTest;
 extern const AG_TestCase fontsTest;
@@ -50,6 +60,9 @@ extern const AG_TestCase plottingTest;
 extern const AG_TestCase renderToSurfaceTest;
 extern const AG_TestCase scrollbarTest;
 extern const AG_TestCase scrollviewTest;
+#ifdef HAVE_AGAR_SK
+extern const AG_TestCase sketchTest;
+#endif
 extern const AG_TestCase socketsTest;
 #ifdef AG_ENABLE_STRING
 extern const AG_TestCase stringTest;
@@ -61,6 +74,8 @@ extern const AG_TestCase threadsTest;
 #ifdef AG_TIMERS
 extern const AG_TestCase timeoutsTest;
 #endif
+extern const AG_TestCase tlistTest;
+extern const AG_TestCase treetblTest;
 extern const AG_TestCase unitconvTest;
 #ifdef AG_USER
 extern const AG_TestCase userTest;
@@ -69,6 +84,9 @@ extern const AG_TestCase widgetsTest;
 extern const AG_TestCase windowsTest;
 
 const AG_TestCase *testCases[] = {
+#ifdef HAVE_AGAR_AU
+	&audioTest,
+#endif
 #ifdef AG_UNICODE
 	&charsetsTest,
 #endif
@@ -78,7 +96,11 @@ const AG_TestCase *testCases[] = {
 #endif
 	&configSettingsTest,
 	&consoleTest,
+	&coreOpsTest,
 	&customWidgetTest,
+#if defined(AG_SERIALIZATION) && defined(_MK_HAVE_UNISTD_H)
+	&dbTest,
+#endif
 	&fixedResTest,
 	&focusingTest,
 	&fontsTest,
@@ -107,6 +129,9 @@ const AG_TestCase *testCases[] = {
 	&renderToSurfaceTest,
 	&scrollbarTest,
 	&scrollviewTest,
+#ifdef HAVE_AGAR_SK
+	&sketchTest,
+#endif
 	&socketsTest,
 #ifdef AG_ENABLE_STRING
 	&stringTest,
@@ -118,6 +143,8 @@ const AG_TestCase *testCases[] = {
 #ifdef AG_TIMERS
 	&timeoutsTest,
 #endif
+	&tlistTest,
+	&treetblTest,
 	&unitconvTest,
 #ifdef AG_USER
 	&userTest,
@@ -177,6 +204,13 @@ AG_Console *C = NULL;
 AG_Button *btnTest, *btnBench;
 char consoleBuf[2048];
 
+enum bench_format {
+	BENCH_FORMAT_NONE,			/* Interactive */
+	BENCH_FORMAT_JSON,
+	BENCH_FORMAT_CSV
+} benchFormat = BENCH_FORMAT_NONE;		/* Batch benchmark output */
+int benchResults = 0;				/* Results written so far */
+
 static void
 SelectedTest(AG_Event *event)
 {
@@ -229,12 +263,18 @@ CreateTestInstance(AG_TestCase *tc)
 
 	if (tc->init != NULL &&
 	    tc->init(ti) == -1) {
-		AG_ConsoleMsg(C, _("%s: Failed: %s"), tc->name, AG_GetError());
+		if (C != NULL) {
+			AG_ConsoleMsg(C, _("%s: Failed: %s"), tc->name,
+			    AG_GetError());
+		}
 		goto fail;
 	}
 	return (ti);
 fail:
-	AG_LabelTextS(status, AG_GetError());
+	if (status != NULL) {
+		AG_LabelTextS(status, AG_GetError());
+	}
+	free(ti);
 	return (NULL);
 }
 
@@ -397,18 +437,25 @@ TestMsg(void *obj, const char *fmt, ...)
 
 	va_start(args, fmt);
 	AG_Vasprintf(&s, fmt, args);
-	ln = AG_ConsoleMsgS(ti->console, s);
 	va_end(args);
+	ln = TestMsgS(ti, s);
 	free(s);
 	return (ln);
 }
 
-/* Write a message to the test console (C string). */
+/*
+ * Write a message to the test console (C string). Without a console
+ * (in batch mode), write to the standard error instead.
+ */
 AG_ConsoleLine *
 TestMsgS(void *obj, const char *s)
 {
 	AG_TestInstance *ti = obj;
 
+	if (ti->console == NULL) {
+		fprintf(stderr, "%s: %s\n", ti->name, s);
+		return (NULL);
+	}
 	return AG_ConsoleMsgS(ti->console, s);
 }
 
@@ -417,22 +464,74 @@ TestMsgS(void *obj, const char *s)
 static __inline__ Uint64
 rdtsc(void)
 {
-	Uint64 rv;
+	Uint32 lo, hi;
 
-	__asm __volatile(".byte 0x0f, 0x31" : "=A" (rv));
-	return (rv);
+	__asm __volatile(".byte 0x0f, 0x31" : "=a" (lo), "=d" (hi));
+	return (((Uint64)hi << 32) | lo);
 }
 #else
 # undef HAVE_RDTSC
 #endif
 
-/* Execute a benchmark module (called from bench() op) */
+/* Write a string quoted for the batch output format. */
+static void
+BenchPrintString(const char *s)
+{
+	const char *c;
+
+	putchar('"');
+	for (c = s; *c != '\0'; c++) {
+		if (*c == '"') {
+			putchar((benchFormat == BENCH_FORMAT_JSON) ? '\\' : '"');
+		} else if (*c == '\\' && benchFormat == BENCH_FORMAT_JSON) {
+			putchar('\\');
+		}
+		putchar(*c);
+	}
+	putchar('"');
+}
+
+/* Write the result of a benchmark function in the batch output format. */
+static void
+BenchReport(const AG_TestInstance *ti, const AG_Benchmark *bm,
+    const AG_BenchmarkFn *bfn, const char *unit)
+{
+	if (benchFormat == BENCH_FORMAT_JSON) {
+		printf("%s\n    {\"test\": ", (benchResults > 0) ? "," : "");
+		BenchPrintString(ti->name);
+		fputs(", \"benchmark\": ", stdout);
+		BenchPrintString(bm->name);
+		fputs(", \"function\": ", stdout);
+		BenchPrintString(bfn->name);
+		printf(", \"unit\": \"%s\", \"min\": %lu, \"avg\": %lu, "
+		       "\"max\": %lu, \"runs\": %u, \"iterations\": %u}", unit,
+		    (Ulong)bfn->clksMin, (Ulong)bfn->clksAvg,
+		    (Ulong)bfn->clksMax, bm->runs, bm->iterations);
+	} else {
+		BenchPrintString(ti->name);
+		putchar(',');
+		BenchPrintString(bm->name);
+		putchar(',');
+		BenchPrintString(bfn->name);
+		printf(",%s,%lu,%lu,%lu,%u,%u\n", unit,
+		    (Ulong)bfn->clksMin, (Ulong)bfn->clksAvg,
+		    (Ulong)bfn->clksMax, bm->runs, bm->iterations);
+	}
+	benchResults++;
+}
+
+/*
+ * Execute a benchmark module (called from bench() op). With TSC, the
+ * results are in clock cycles per iteration; otherwise they are in ticks
+ * (ms) per run of the given number of iterations.
+ */
 void
 TestExecBenchmark(void *obj, AG_Benchmark *bm)
 {
 	AG_TestInstance *ti = obj;
+	AG_Console *cons = ti->console;
 	Uint i, j, fIdx;
-#if defined(HAVE_64BIT)
+#if defined(AG_HAVE_64BIT)
 	Uint64 t1, t2;
 	Uint64 tTot, tRun;
 #else
@@ -440,19 +539,25 @@ TestExecBenchmark(void *obj, AG_Benchmark *bm)
 	Uint32 tTot, tRun;
 #endif
 
-	AG_RedrawOnTick(ti->console, 1);
+	if (cons != NULL) {
+		AG_RedrawOnTick(cons, 1);
+	}
 	for (fIdx = 0; fIdx < bm->nFuncs; fIdx++) {
 		char pbuf[64];
 		AG_BenchmarkFn *bfn = &bm->funcs[fIdx];
-		AG_ConsoleLine *cl;
-
-		bfn->clksMax = -1;
-		cl = AG_ConsoleMsg(ti->console, "\t%s: ...", bfn->name);
-		if (cl == NULL) {
+		AG_ConsoleLine *cl = NULL;
+		const char *unit;
+
+		bfn->clksMin = 0;
+		bfn->clksAvg = 0;
+		bfn->clksMax = 0;
+		if (cons != NULL &&
+		    (cl = AG_ConsoleMsg(cons, "\t%s: ...", bfn->name)) == NULL) {
 			continue;
 		}
 #ifdef HAVE_RDTSC
 		if (agCPU.ext & AG_EXT_TSC) {
+			unit = "clks";
 			for (i = 0, tTot = 0; i < bm->runs; i++) {
 retry:
 				t1 = rdtsc();
@@ -462,31 +567,32 @@ retry:
 				t2 = rdtsc();
 				tRun = (t2 - t1) / bm->iterations;
 			
-				Snprintf(pbuf, sizeof(pbuf),
-				    "\t%s: %lu clks [%i/%i]",
-				    bfn->name,
-				    (Ulong)tRun, i, bm->runs);
-				AG_ConsoleMsgEdit(cl, pbuf);
-
-				if (bm->maximum > 0 && tRun > bm->maximum) {
+				if (cl != NULL) {
 					Snprintf(pbuf, sizeof(pbuf),
-					    "\t%s: <preempted>", bfn->name);
+					    "\t%s: %lu clks [%i/%i]",
+					    bfn->name,
+					    (Ulong)tRun, i, bm->runs);
 					AG_ConsoleMsgEdit(cl, pbuf);
+				}
+				if (bm->maximum > 0 && tRun > bm->maximum) {
+					if (cl != NULL) {
+						Snprintf(pbuf, sizeof(pbuf),
+						    "\t%s: <preempted>",
+						    bfn->name);
+						AG_ConsoleMsgEdit(cl, pbuf);
+					}
 					goto retry;
 				}
 				bfn->clksMax = AG_MAX(bfn->clksMax,tRun);
-				bfn->clksMin = (bfn->clksMin > 0) ?
+				bfn->clksMin = (i > 0) ?
 				               AG_MIN(bfn->clksMin,tRun) :
 					       tRun;
 				tTot += tRun;
 			}
-			bfn->clksAvg = (tTot / bm->runs);
-			Snprintf(pbuf, sizeof(pbuf), "\t%s: %lu clks [%i]",
-			    bfn->name, (Ulong)bfn->clksAvg, bm->runs);
-			AG_ConsoleMsgEdit(cl, pbuf);
 		} else
 #endif /* HAVE_RDTSC */
 		{
+			unit = "ticks";
 			for (i = 0, tTot = 0; i < bm->runs; i++) {
 				t1 = AG_GetTicks();
 				for (j = 0; j < bm->iterations; j++) {
@@ -494,22 +600,30 @@ retry:
 				}
 				t2 = AG_GetTicks();
 				tRun = (t2 - t1);
-				Snprintf(pbuf, sizeof(pbuf),
-				    "\t%s: %lu ticks [%i/%i]",
-				    bfn->name, (Ulong)tRun, i, bm->runs);
-				AG_ConsoleMsgEdit(cl, pbuf);
+				if (cl != NULL) {
+					Snprintf(pbuf, sizeof(pbuf),
+					    "\t%s: %lu ticks [%i/%i]",
+					    bfn->name, (Ulong)tRun, i, bm->runs);
+					AG_ConsoleMsgEdit(cl, pbuf);
+				}
 				bfn->clksMax = AG_MAX(bfn->clksMax,tRun);
-				bfn->clksMin = (bfn->clksMin > 0) ?
+				bfn->clksMin = (i > 0) ?
 				               AG_MIN(bfn->clksMin,tRun) :
 					       tRun;
 				tTot += tRun;
 			}
-			Snprintf(pbuf, sizeof(pbuf), "\t%s: %lu ticks [%i]",
-			    bfn->name, (Ulong)bfn->clksAvg, bm->runs);
+		}
+		bfn->clksAvg = (tTot / bm->runs);
+		if (cl != NULL) {
+			Snprintf(pbuf, sizeof(pbuf), "\t%s: %lu %s [%i]",
+			    bfn->name, (Ulong)bfn->clksAvg, unit, bm->runs);
 			AG_ConsoleMsgEdit(cl, pbuf);
 		}
+		if (benchFormat != BENCH_FORMAT_NONE)
+			BenchReport(ti, bm, bfn, unit);
 	}
-	AG_RedrawOnTick(ti->console, -1);
+	if (cons != NULL)
+		AG_RedrawOnTick(cons, -1);
 }
 
 #if defined(AG_DEBUG) && defined(AG_TIMERS)
@@ -553,6 +667,99 @@ ConsoleWindowDetached(AG_Event *event)
 	C = NULL;
 }
 
+/* Redirect AG_Debug() and AG_Verbose() to the standard error. */
+static int
+StderrWrite(const char *msg)
+{
+	fputs(msg, stderr);
+	return (1);
+}
+
+/*
+ * Run the benchmarks of the named tests (or of all tests) without user
+ * interaction and write the results to the standard output. Return 0 if
+ * all benchmarks completed successfully, otherwise -1.
+ */
+static int
+RunBenchBatch(char *names[], int nNames)
+{
+	const AG_TestCase **pTest;
+	AG_AgarVersion av;
+	int i, rv = 0;
+
+	for (i = 0; i < nNames; i++) {
+		for (pTest = &testCases[0]; *pTest != NULL; pTest++) {
+			if (strcmp((*pTest)->name, names[i]) == 0)
+				break;
+		}
+		if (*pTest == NULL) {
+			fprintf(stderr, _("No such test: %s\n"), names[i]);
+			return (-1);
+		}
+	}
+
+	AG_GetVersion(&av);
+	if (benchFormat == BENCH_FORMAT_JSON) {
+		printf("{\n  \"agar\": \"%d.%d.%d\",\n  \"arch\": ",
+		    av.major, av.minor, av.patch);
+		BenchPrintString(agCPU.arch);
+		fputs(",\n  \"driver\": ", stdout);
+		BenchPrintString(agDriverOps->name);
+		fputs(",\n  \"results\": [", stdout);
+	} else {
+		printf("test,benchmark,function,unit,min,avg,max,runs,"
+		       "iterations\n");
+	}
+
+	for (pTest = &testCases[0]; *pTest != NULL; pTest++) {
+		const AG_TestCase *tc = *pTest;
+		AG_TestInstance *ti;
+
+		if (tc->bench == NULL) {
+			continue;
+		}
+		if (nNames > 0) {
+			for (i = 0; i < nNames; i++) {
+				if (strcmp(tc->name, names[i]) == 0)
+					break;
+			}
+			if (i == nNames)
+				continue;
+		}
+		if (((tc->flags & AG_TEST_OPENGL) &&
+		     !(agDriverOps->flags & AG_DRIVER_OPENGL)) ||
+		    ((tc->flags & AG_TEST_SDL) &&
+		     !(agDriverOps->flags & AG_DRIVER_SDL))) {
+			fprintf(stderr, _("%s: Skipped (unsupported by %s)\n"),
+			    tc->name, agDriverOps->name);
+			continue;
+		}
+		if ((ti = CreateTestInstance((AG_TestCase *)tc)) == NULL) {
+			fprintf(stderr, _("%s: Failed: %s\n"), tc->name,
+			    AG_GetError());
+			rv = -1;
+			continue;
+		}
+		if (tc->bench(ti) == 0) {
+			fprintf(stderr, _("%s: Success\n"), tc->name);
+		} else {
+			fprintf(stderr, _("%s: Failed (%s)\n"), tc->name,
+			    AG_GetError());
+			rv = -1;
+		}
+		if (tc->destroy != NULL) {
+			tc->destroy(ti);
+		}
+		free(ti);
+		AG_WindowProcessQueued();	/* Windows detached by bench() */
+	}
+
+	if (benchFormat == BENCH_FORMAT_JSON) {
+		fputs("\n  ]\n}\n", stdout);
+	}
+	return (rv);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -568,11 +775,22 @@ main(int argc, char *argv[])
 
 	TAILQ_INIT(&tests);
 
-	while ((c = AG_Getopt(argc, argv, "Cp:?hd:s:t:", &optArg, &optInd)) != -1) {
+	while ((c = AG_Getopt(argc, argv, "Cb:p:?hd:s:t:", &optArg, &optInd)) != -1) {
 		switch (c) {
 		case 'C':
 			noConsoleRedir = 1;
 			break;
+		case 'b':
+			if (strcmp(optArg, "json") == 0) {
+				benchFormat = BENCH_FORMAT_JSON;
+			} else if (strcmp(optArg, "csv") == 0) {
+				benchFormat = BENCH_FORMAT_CSV;
+			} else {
+				fprintf(stderr, "Bad benchmark format: %s\n",
+				    optArg);
+				return (1);
+			}
+			break;
 		case 'p':
 			break;
 		case 'd':
@@ -587,13 +805,26 @@ main(int argc, char *argv[])
 		case '?':
 		case 'h':
 		default:
-			printf("Usage: agartest [-C] [-d driver] [-s stylesheet] [-t font] [test1 test2 ...]\n");
+			printf("Usage: agartest [-C] [-b json|csv] [-d driver] [-s stylesheet] [-t font] [test1 test2 ...]\n");
 			return (1);
 		}
 	}
+	if (benchFormat != BENCH_FORMAT_NONE) {
+		initFlags |= AG_SOFT_TIMERS;	/* Measure AG_ProcessTimeouts() */
+	}
 	if (AG_InitCore("agartest", initFlags) == -1) {
 		goto fail;
 	}
+	if (benchFormat != BENCH_FORMAT_NONE) {
+		/*
+		 * Batch benchmark mode: keep the standard output for the
+		 * results and default to the headless driver.
+		 */
+		AG_SetVerboseCallback(StderrWrite);
+		AG_SetDebugCallback(StderrWrite);
+		if (driverSpec == NULL)
+			driverSpec = "headless";
+	}
 	if (fontSpec != NULL) {
 		AG_TextParseFontSpec(fontSpec);
 	}
@@ -604,6 +835,15 @@ main(int argc, char *argv[])
 	    AG_LoadStyleSheet(NULL, styleSheet) == NULL)
 		goto fail;
 
+	if (benchFormat != BENCH_FORMAT_NONE) {
+		int rv;
+
+		rv = RunBenchBatch(&argv[optInd], argc - optInd);
+		AG_DestroyGraphics();
+		AG_Destroy();
+		return (rv == 0) ? 0 : 1;
+	}
+
 	/* Redirect AG_Verbose() and AG_Debug() output to the AG_Console. */
 	consoleBuf[0] = '\0';
 	if (!noConsoleRedir) {
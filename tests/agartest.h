@@ -38,7 +38,7 @@ typedef struct ag_test_instance {
 	const char *_Nonnull name;
 	Uint flags;
 	float score;				/* Numerical result */
-	AG_Console *_Nullable console;		/* Output console */
+	AG_Console *_Nullable console;		/* Output console (or stderr) */
 	AG_Window *_Nullable win;		/* Main (control) window */
 	AG_Button *_Nullable closeBtn;		/* "Close this test" */
 	AG_TAILQ_ENTRY(ag_test_instance) instances;
@@ -66,8 +66,8 @@ typedef struct ag_benchmark {
 					   preemption and retry (0=disable) */
 } AG_Benchmark;
 
-AG_ConsoleLine *_Nonnull TestMsg(void *_Nonnull, const char *_Nonnull, ...);
-AG_ConsoleLine *_Nonnull TestMsgS(void *_Nonnull, const char *_Nonnull);
+AG_ConsoleLine *_Nullable TestMsg(void *_Nonnull, const char *_Nonnull, ...);
+AG_ConsoleLine *_Nullable TestMsgS(void *_Nonnull, const char *_Nonnull);
 
 void TestExecBenchmark(void *_Nonnull, AG_Benchmark *_Nonnull);
 void TestWindowClose(AG_Event *_Nonnull);
@@ -0,0 +1,168 @@
+/*	Public domain	*/
+
+/*
+ * Test the Agar audio library (ag_au). Mix a known tone through the file
+ * output driver and check the frames written to the file.
+ */
+
+#include "config/have_agar_au.h"
+#ifdef HAVE_AGAR_AU
+
+#include <agar/core.h>
+#include <agar/gui.h>
+#include <agar/au.h>
+
+#include "agartest.h"
+
+#include <agar/config/ag_threads.h>
+#include <agar/config/have_sndfile.h>
+
+#if defined(AG_THREADS) && defined(HAVE_SNDFILE)
+
+#include <sndfile.h>
+#include <math.h>
+#include <string.h>
+
+#define TONE_FILE	"agartest-tone.wav"
+#define TONE_RATE	44100
+#define TONE_FREQ	441.0		/* Exactly 100 frames per cycle */
+#define TONE_FRAMES	(TONE_RATE*2)	/* Exceeds the channel ring size */
+#define TONE_BLOCK	1000		/* Frames per AU_WriteFloat() call */
+
+/*
+ * Left and right samples of frame i. The tone has an offset so that no
+ * sample is zero, which lets us tell it apart from the silence the mixer
+ * pads periods with when the writer falls behind.
+ */
+static __inline__ float
+ToneSample(Uint i, int ch)
+{
+	float v = (float)(0.6 + 0.3*sin(2.0*M_PI*TONE_FREQ*i / TONE_RATE));
+
+	return (ch == 0) ? v : -v;
+}
+
+static int
+Init(void *obj)
+{
+	AU_InitSubsystem();
+	return (0);
+}
+
+static void
+Destroy(void *obj)
+{
+	AU_DestroySubsystem();
+}
+
+static int
+Test(void *obj)
+{
+	float *buf, *in = NULL;
+	AU_DevOut *dev;
+	SNDFILE *sf;
+	SF_INFO info;
+	sf_count_t nRead;
+	Uint i, j, nTone = 0, nSilent = 0;
+	int rv = -1;
+
+	buf = Malloc(TONE_FRAMES*2*sizeof(float));
+	for (i = 0; i < TONE_FRAMES; i++) {
+		buf[i*2]   = ToneSample(i, 0);
+		buf[i*2+1] = ToneSample(i, 1);
+	}
+	if ((dev = AU_OpenOut("file(" TONE_FILE ")", TONE_RATE, 2)) == NULL) {
+		TestMsg(obj, "AU_OpenOut: %s", AG_GetError());
+		goto out;
+	}
+	for (i = 0; i < TONE_FRAMES; i += TONE_BLOCK) {
+		Uint n = AG_MIN(TONE_BLOCK, TONE_FRAMES - i);
+
+		if (AU_WriteFloat(dev, &buf[i*2], n) == -1) {
+			TestMsg(obj, "AU_WriteFloat: %s", AG_GetError());
+			AU_CloseOut(dev);
+			goto out;
+		}
+	}
+	AU_CloseOut(dev);			/* Drains the channels */
+
+	memset(&info, 0, sizeof(info));
+	if ((sf = sf_open(TONE_FILE, SFM_READ, &info)) == NULL) {
+		TestMsg(obj, "%s: %s", TONE_FILE, sf_strerror(NULL));
+		goto out;
+	}
+	if (info.channels != 2 || info.samplerate != TONE_RATE) {
+		TestMsg(obj, "%s: %d-Ch, %dHz (expected 2-Ch, %dHz)",
+		    TONE_FILE, info.channels, info.samplerate, TONE_RATE);
+		sf_close(sf);
+		goto out;
+	}
+	in = Malloc((info.frames+1)*2*sizeof(float));
+	nRead = sf_readf_float(sf, in, info.frames);
+	sf_close(sf);
+	if (nRead != info.frames) {
+		TestMsg(obj, "%s: Read %ld of %ld frames", TONE_FILE,
+		    (long)nRead, (long)info.frames);
+		goto out;
+	}
+
+	/*
+	 * Apart from padding silence (in case the output thread had to
+	 * advance without us), the file must hold the tone, frame for frame.
+	 */
+	for (j = 0; j < (Uint)nRead; j++) {
+		const float *f = &in[j*2];
+
+		if (f[0] == 0.0f && f[1] == 0.0f) {
+			nSilent++;
+			continue;
+		}
+		if (nTone >= TONE_FRAMES) {
+			TestMsg(obj, "Frame %u: Extra frame after tone", j);
+			goto out;
+		}
+		if (fabs(f[0] - ToneSample(nTone,0)) > 1e-6 ||
+		    fabs(f[1] - ToneSample(nTone,1)) > 1e-6) {
+			TestMsg(obj, "Frame %u: (%f,%f) != tone[%u] (%f,%f)",
+			    j, f[0], f[1], nTone,
+			    ToneSample(nTone,0), ToneSample(nTone,1));
+			goto out;
+		}
+		nTone++;
+	}
+	if (nTone != TONE_FRAMES) {
+		TestMsg(obj, "Wrote %u tone frames (expected %u)", nTone,
+		    (Uint)TONE_FRAMES);
+		goto out;
+	}
+	TestMsg(obj, "%s: %u tone frames OK (%u frames of padding)",
+	    TONE_FILE, nTone, nSilent);
+	rv = 0;
+out:
+	AG_FileDelete(TONE_FILE);
+	Free(in);
+	Free(buf);
+	return (rv);
+}
+
+#endif /* AG_THREADS and HAVE_SNDFILE */
+
+const AG_TestCase audioTest = {
+	"audio",
+	N_("Test mixing a tone through the ag_au file output driver"),
+	"1.6.0",
+	AG_TEST_AUDIO,
+	sizeof(AG_TestInstance),
+#if defined(AG_THREADS) && defined(HAVE_SNDFILE)
+	Init,
+	Destroy,
+	Test,
+#else
+	NULL,		/* init */
+	NULL,		/* destroy */
+	NULL,		/* test */
+#endif
+	NULL,		/* testGUI */
+	NULL		/* bench */
+};
+#endif /* HAVE_AGAR_AU */
@@ -0,0 +1,255 @@
+/*	Public domain	*/
+/*
+ * Benchmark frequently-used routines of the core library: event dispatch
+ * with AG_PostEvent(3), AG_Tbl(3) hash table lookups and AG_DataSource(3)
+ * serialization.
+ */
+
+#include "agartest.h"
+
+#include <stdlib.h>
+
+#include <agar/core/snprintf.h>
+
+#define NEVENTS   16		/* Registered event handlers */
+#define NKEYS    256		/* Entries in the AG_Tbl */
+#define NBUCKETS  64		/* Buckets in the AG_Tbl */
+#define NRECORDS  64		/* Records per serialization run */
+
+typedef struct {
+	AG_TestInstance _inherit;
+	AG_Object *_Nullable obj;		/* Event receiver */
+	AG_Tbl *_Nullable tbl;			/* Hash table */
+	AG_DataSource *_Nullable ds;		/* Serialization buffer */
+	char keys[NKEYS][16];			/* Keys present in tbl */
+	char keysMissing[NKEYS][16];		/* Keys absent from tbl */
+	Uint nEvents;				/* Events received */
+	int curKey;
+} MyTestInstance;
+
+static void
+BenchEventHandler(AG_Event *event)
+{
+	MyTestInstance *ti = AG_PTR(1);
+
+	ti->nEvents++;
+}
+
+static void
+PostEventNoArgs(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	AG_PostEvent(NULL, ti->obj, "bench-event", NULL);
+}
+static void
+PostEventArgs(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	AG_PostEvent(NULL, ti->obj, "bench-event", "%i,%p,%s",
+	    ti->curKey, ti, "foo");
+}
+static void
+PostEventLast(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	AG_PostEvent(NULL, ti->obj, "event-15", NULL);
+}
+
+static __inline__ int
+NextKey(MyTestInstance *ti)
+{
+	if (++ti->curKey >= NKEYS) { ti->curKey = 0; }
+	return (ti->curKey);
+}
+
+static void
+TblLookup(void *obj)
+{
+	MyTestInstance *ti = obj;
+	void *p;
+
+	(void)AG_TblLookupPointer(ti->tbl, ti->keys[NextKey(ti)], &p);
+}
+static void
+TblLookupMissing(void *obj)
+{
+	MyTestInstance *ti = obj;
+	void *p;
+
+	(void)AG_TblLookupPointer(ti->tbl, ti->keysMissing[NextKey(ti)], &p);
+}
+static void
+TblInsertDelete(void *obj)
+{
+	MyTestInstance *ti = obj;
+	const char *key = ti->keysMissing[NextKey(ti)];
+
+	if (AG_TblInsertPointer(ti->tbl, key, ti) == 0)
+		AG_TblDelete(ti->tbl, key);
+}
+
+static void
+WriteRecords(MyTestInstance *ti)
+{
+	AG_DataSource *ds = ti->ds;
+	int i;
+
+	AG_Seek(ds, 0, AG_SEEK_SET);
+	for (i = 0; i < NRECORDS; i++) {
+		AG_WriteUint8(ds, (Uint8)i);
+		AG_WriteUint16(ds, (Uint16)i);
+		AG_WriteUint32(ds, (Uint32)i);
+#ifdef AG_HAVE_64BIT
+		AG_WriteUint64(ds, (Uint64)i);
+#endif
+		AG_WriteString(ds, ti->keys[i]);
+	}
+}
+
+static void
+DataSourceWrite(void *obj)
+{
+	WriteRecords(obj);
+}
+static void
+DataSourceRead(void *obj)
+{
+	MyTestInstance *ti = obj;
+	AG_DataSource *ds = ti->ds;
+	char buf[16];
+	int i;
+
+	AG_Seek(ds, 0, AG_SEEK_SET);
+	for (i = 0; i < NRECORDS; i++) {
+		(void)AG_ReadUint8(ds);
+		(void)AG_ReadUint16(ds);
+		(void)AG_ReadUint32(ds);
+#ifdef AG_HAVE_64BIT
+		(void)AG_ReadUint64(ds);
+#endif
+		(void)AG_CopyString(buf, ds, sizeof(buf));
+	}
+}
+
+static struct ag_benchmark_fn eventBenchFns[] = {
+	{ "PostEvent (no args)",	PostEventNoArgs	},
+	{ "PostEvent (3 args)",		PostEventArgs	},
+	{ "PostEvent (last handler)",	PostEventLast	},
+};
+static struct ag_benchmark eventBench = {
+	"AG_PostEvent",
+	&eventBenchFns[0],
+	sizeof(eventBenchFns) / sizeof(eventBenchFns[0]),
+	10, 10000, 0
+};
+
+static struct ag_benchmark_fn tblBenchFns[] = {
+	{ "Lookup (hit)",		TblLookup		},
+	{ "Lookup (miss)",		TblLookupMissing	},
+	{ "Insert+Delete",		TblInsertDelete		},
+};
+static struct ag_benchmark tblBench = {
+	"AG_Tbl",
+	&tblBenchFns[0],
+	sizeof(tblBenchFns) / sizeof(tblBenchFns[0]),
+	10, 10000, 0
+};
+
+static struct ag_benchmark_fn dsBenchFns[] = {
+	{ "Write records",		DataSourceWrite	},
+	{ "Read records",		DataSourceRead	},
+};
+static struct ag_benchmark dsBench = {
+	"AG_DataSource",
+	&dsBenchFns[0],
+	sizeof(dsBenchFns) / sizeof(dsBenchFns[0]),
+	10, 1000, 0
+};
+
+static int
+Init(void *obj)
+{
+	MyTestInstance *ti = obj;
+	char name[16];
+	int i;
+
+	ti->nEvents = 0;
+	ti->curKey = 0;
+	ti->tbl = NULL;
+	ti->ds = NULL;
+
+	if ((ti->obj = AG_ObjectNew(NULL, "coreOps", &agObjectClass)) == NULL) {
+		return (-1);
+	}
+	AG_SetEvent(ti->obj, "bench-event", BenchEventHandler, "%p", ti);
+	for (i = 0; i < NEVENTS; i++) {
+		Snprintf(name, sizeof(name), "event-%d", i);
+		AG_AddEvent(ti->obj, name, BenchEventHandler, "%p", ti);
+	}
+
+	ti->tbl = AG_TblNew(NBUCKETS, 0);
+	for (i = 0; i < NKEYS; i++) {
+		Snprintf(ti->keys[i], sizeof(ti->keys[i]), "key-%d", i);
+		Snprintf(ti->keysMissing[i], sizeof(ti->keysMissing[i]),
+		    "missing-%d", i);
+		if (AG_TblInsertPointer(ti->tbl, ti->keys[i], ti) == -1)
+			return (-1);
+	}
+
+	if ((ti->ds = AG_OpenAutoCore()) == NULL) {
+		return (-1);
+	}
+	WriteRecords(ti);
+	return (0);
+}
+
+static void
+Destroy(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	if (ti->ds != NULL) {
+		AG_CloseCore(ti->ds);
+	}
+	if (ti->tbl != NULL) {
+		AG_TblDestroy(ti->tbl);
+		free(ti->tbl);
+	}
+	if (ti->obj != NULL)
+		AG_ObjectDestroy(ti->obj);
+}
+
+static int
+Bench(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	TestMsg(ti, "AG_PostEvent() to an object with %d handlers:",
+	    NEVENTS+1);
+	TestExecBenchmark(obj, &eventBench);
+	if (ti->nEvents == 0) {
+		AG_SetErrorS("No events received");
+		return (-1);
+	}
+	TestMsg(ti, "AG_Tbl with %d keys in %d buckets:", NKEYS, NBUCKETS);
+	TestExecBenchmark(obj, &tblBench);
+	TestMsg(ti, "AG_DataSource with %d records:", NRECORDS);
+	TestExecBenchmark(obj, &dsBench);
+	return (0);
+}
+
+const AG_TestCase coreOpsTest = {
+	"coreOps",
+	N_("Benchmark event dispatch, AG_Tbl(3) and AG_DataSource(3)"),
+	"1.6.0",
+	0,
+	sizeof(MyTestInstance),
+	Init,
+	Destroy,
+	NULL,		/* test */
+	NULL,		/* testGUI */
+	Bench
+};
@@ -0,0 +1,387 @@
+/*	Public domain	*/
+
+/*
+ * Test the built-in log-structured key/value database backend ("kv").
+ */
+
+#include <agar/config/ag_serialization.h>
+#include <agar/config/_mk_have_unistd_h.h>
+#if defined(AG_SERIALIZATION) && defined(_MK_HAVE_UNISTD_H)
+
+#include "agartest.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+
+#define DB_FILE		"agartest-db.kv"
+#define DB_NKEYS	200		/* Keys in the database */
+#define DB_VALSIZE	2048		/* Size of values for compaction */
+#define DB_ROUNDS	4		/* Overwrites of every key */
+
+typedef struct {
+	AG_TestInstance _inherit;
+	AG_Db *db;
+} MyTestInstance;
+
+/* State of an AG_DbIterate() walk. */
+typedef struct {
+	MyTestInstance *ti;
+	char prev[32];			/* Previous key */
+	AG_Size prevLen;
+	Uint nVisited;
+	int rv;
+} DbWalk;
+
+/* Fill buf with the key of entry i. Keys do not sort in numerical order. */
+static AG_Size
+KeyFor(char *buf, AG_Size len, Uint i)
+{
+	return (AG_Size)Snprintf(buf, len, "key-%u-%u", (i*7919) % 997, i);
+}
+
+/* Fill buf with the value of entry i in the given round. */
+static void
+ValueFor(Uint8 *buf, AG_Size len, Uint i, Uint round)
+{
+	AG_Size j;
+
+	for (j = 0; j < len; j++)
+		buf[j] = (Uint8)(i*31 + round*7 + j);
+}
+
+static int
+OpenDb(MyTestInstance *ti)
+{
+	if ((ti->db = AG_DbNew("kv")) == NULL) {
+		TestMsg(ti, "AG_DbNew: %s", AG_GetError());
+		return (-1);
+	}
+	if (AG_DbOpen(ti->db, DB_FILE, 0) == -1) {
+		TestMsg(ti, "AG_DbOpen: %s", AG_GetError());
+		AG_ObjectDestroy(ti->db);
+		ti->db = NULL;
+		return (-1);
+	}
+	return (0);
+}
+
+static void
+CloseDb(MyTestInstance *ti)
+{
+	if (ti->db != NULL) {
+		AG_DbClose(ti->db);
+		AG_ObjectDestroy(ti->db);
+		ti->db = NULL;
+	}
+}
+
+static int
+PutEntry(MyTestInstance *ti, Uint i, Uint round, AG_Size valSize)
+{
+	char keyBuf[32];
+	Uint8 valBuf[DB_VALSIZE];
+	AG_Dbt key, val;
+
+	ValueFor(valBuf, valSize, i, round);
+	key.data = keyBuf;
+	key.size = KeyFor(keyBuf, sizeof(keyBuf), i);
+	val.data = valBuf;
+	val.size = valSize;
+	if (AG_DbPut(ti->db, &key, &val) == -1) {
+		TestMsg(ti, "AG_DbPut(%s): %s", keyBuf, AG_GetError());
+		return (-1);
+	}
+	return (0);
+}
+
+static int
+DelEntry(MyTestInstance *ti, Uint i)
+{
+	char keyBuf[32];
+	AG_Dbt key;
+
+	key.data = keyBuf;
+	key.size = KeyFor(keyBuf, sizeof(keyBuf), i);
+	if (AG_DbDel(ti->db, &key) == -1) {
+		TestMsg(ti, "AG_DbDel(%s): %s", keyBuf, AG_GetError());
+		return (-1);
+	}
+	return (0);
+}
+
+/*
+ * Check that entry i holds the value of the given round (or does not
+ * exist if valSize is 0).
+ */
+static int
+CheckEntry(MyTestInstance *ti, Uint i, Uint round, AG_Size valSize)
+{
+	char keyBuf[32];
+	Uint8 valBuf[DB_VALSIZE];
+	AG_Dbt key, val;
+	int rv = 0;
+
+	key.data = keyBuf;
+	key.size = KeyFor(keyBuf, sizeof(keyBuf), i);
+	if (valSize == 0) {
+		if (AG_DbExists(ti->db, &key)) {
+			TestMsg(ti, "%s: Deleted key exists", keyBuf);
+			return (-1);
+		}
+		return (0);
+	}
+	if (!AG_DbExists(ti->db, &key)) {
+		TestMsg(ti, "%s: Key does not exist", keyBuf);
+		return (-1);
+	}
+	if (AG_DbGet(ti->db, &key, &val) == -1) {
+		TestMsg(ti, "AG_DbGet(%s): %s", keyBuf, AG_GetError());
+		return (-1);
+	}
+	ValueFor(valBuf, valSize, i, round);
+	if (val.size != valSize || memcmp(val.data, valBuf, valSize) != 0) {
+		TestMsg(ti, "%s: Bad value (%lu bytes, expected %lu)", keyBuf,
+		    (Ulong)val.size, (Ulong)valSize);
+		rv = -1;
+	}
+	Free(val.data);
+	return (rv);
+}
+
+static off_t
+FileSize(const char *path)
+{
+	struct stat sb;
+
+	return (stat(path, &sb) == 0) ? sb.st_size : -1;
+}
+
+/* Check that keys are visited in increasing (bytewise) order. */
+static int
+WalkEntry(const AG_Dbt *key, const AG_Dbt *val, void *arg)
+{
+	DbWalk *w = arg;
+	char keyBuf[32];
+	AG_Dbt keyDup, valDup;
+	AG_Size len;
+
+	if (w->nVisited > 0) {
+		len = AG_MIN(key->size, w->prevLen);
+		if (memcmp(w->prev, key->data, len) > 0 ||
+		    (memcmp(w->prev, key->data, len) == 0 &&
+		     w->prevLen >= key->size)) {
+			TestMsg(w->ti, "Key %u out of order", w->nVisited);
+			w->rv = -1;
+			return (-1);
+		}
+	}
+	if (key->size >= sizeof(w->prev)) {
+		TestMsg(w->ti, "Key %u is too long", w->nVisited);
+		w->rv = -1;
+		return (-1);
+	}
+	memcpy(w->prev, key->data, key->size);
+	w->prevLen = key->size;
+
+	/*
+	 * Reading and writing the database from the callback must not
+	 * invalidate the value pointer we were passed.
+	 */
+	memcpy(keyBuf, key->data, key->size);
+	keyBuf[key->size] = '\0';
+	if (AG_DbGet(w->ti->db, key, &valDup) == -1) {
+		TestMsg(w->ti, "AG_DbGet(%s): %s", keyBuf, AG_GetError());
+		w->rv = -1;
+		return (-1);
+	}
+	Free(valDup.data);
+	keyDup.data = "walk-marker";
+	keyDup.size = sizeof("walk-marker") - 1;
+	if (AG_DbPut(w->ti->db, &keyDup, val) == -1 ||
+	    AG_DbGet(w->ti->db, &keyDup, &valDup) == -1) {
+		TestMsg(w->ti, "walk-marker: %s", AG_GetError());
+		w->rv = -1;
+		return (-1);
+	}
+	if (valDup.size != val->size ||
+	    memcmp(valDup.data, val->data, val->size) != 0) {
+		TestMsg(w->ti, "%s: Value changed during walk", keyBuf);
+		Free(valDup.data);
+		w->rv = -1;
+		return (-1);
+	}
+	Free(valDup.data);
+	w->nVisited++;
+	return (0);
+}
+
+static int
+Init(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	ti->db = NULL;
+	return (0);
+}
+
+static void
+Destroy(void *obj)
+{
+	CloseDb(obj);
+	AG_FileDelete(DB_FILE);
+}
+
+static int
+Test(void *obj)
+{
+	MyTestInstance *ti = obj;
+	AG_Dbt prefix;
+	DbWalk w;
+	off_t sizeFull, sizeTrunc, sizeCompact;
+	Uint i, round;
+
+	AG_FileDelete(DB_FILE);
+	if (OpenDb(ti) == -1)
+		return (-1);
+
+	/* Put, get and delete. */
+	for (i = 0; i < DB_NKEYS; i++) {
+		if (PutEntry(ti, i, 0, 1 + i % 64) == -1)
+			return (-1);
+	}
+	for (i = 0; i < DB_NKEYS; i += 3) {
+		if (DelEntry(ti, i) == -1)
+			return (-1);
+	}
+	for (i = 0; i < DB_NKEYS; i++) {
+		if (CheckEntry(ti, i, 0, (i % 3 == 0) ? 0 : 1 + i % 64) == -1)
+			return (-1);
+	}
+	TestMsg(ti, "Put/get/del of %u keys OK", DB_NKEYS);
+
+	/* Ordered iteration (the callback reads and writes the database). */
+	memset(&w, 0, sizeof(w));
+	w.ti = ti;
+	if (AG_DbIterate(ti->db, WalkEntry, &w) == -1 || w.rv == -1) {
+		TestMsg(ti, "AG_DbIterate: %s", AG_GetError());
+		return (-1);
+	}
+	if (w.nVisited != DB_NKEYS - (DB_NKEYS+2)/3) {
+		TestMsg(ti, "AG_DbIterate: Visited %u keys (expected %u)",
+		    w.nVisited, DB_NKEYS - (DB_NKEYS+2)/3);
+		return (-1);
+	}
+	memset(&w, 0, sizeof(w));
+	w.ti = ti;
+	prefix.data = "key-1";
+	prefix.size = sizeof("key-1") - 1;
+	if (AG_DbIteratePrefix(ti->db, &prefix, WalkEntry, &w) == -1 ||
+	    w.rv == -1 || w.nVisited == 0) {
+		TestMsg(ti, "AG_DbIteratePrefix: Failed (%u keys)", w.nVisited);
+		return (-1);
+	}
+	TestMsg(ti, "Ordered iteration OK");
+	CloseDb(ti);
+
+	/*
+	 * Truncate the file in the middle of the last write, and check that
+	 * the partial record is dropped (and the file is writable again).
+	 */
+	sizeFull = FileSize(DB_FILE);
+	if (OpenDb(ti) == -1 ||
+	    PutEntry(ti, DB_NKEYS, 0, 64) == -1) {
+		return (-1);
+	}
+	CloseDb(ti);
+	if (FileSize(DB_FILE) <= sizeFull ||
+	    truncate(DB_FILE, FileSize(DB_FILE) - 12) == -1) {
+		TestMsg(ti, "%s: Cannot truncate", DB_FILE);
+		return (-1);
+	}
+	if (OpenDb(ti) == -1 ||
+	    CheckEntry(ti, DB_NKEYS, 0, 0) == -1) {
+		return (-1);
+	}
+	if ((sizeTrunc = FileSize(DB_FILE)) != sizeFull) {
+		TestMsg(ti, "Replay kept %ld bytes (expected %ld)",
+		    (long)sizeTrunc, (long)sizeFull);
+		return (-1);
+	}
+	if (PutEntry(ti, DB_NKEYS, 1, 64) == -1) {
+		return (-1);
+	}
+	CloseDb(ti);
+	if (OpenDb(ti) == -1) {
+		return (-1);
+	}
+	for (i = 0; i < DB_NKEYS; i++) {
+		if (CheckEntry(ti, i, 0, (i % 3 == 0) ? 0 : 1 + i % 64) == -1)
+			return (-1);
+	}
+	if (CheckEntry(ti, DB_NKEYS, 1, 64) == -1) {
+		return (-1);
+	}
+	TestMsg(ti, "Reopen after truncated tail OK");
+
+	/* Overwrite every key until dead records dominate, then compact. */
+	for (round = 1; round <= DB_ROUNDS; round++) {
+		for (i = 0; i < DB_NKEYS; i++) {
+			if (PutEntry(ti, i, round, DB_VALSIZE) == -1)
+				return (-1);
+		}
+	}
+	for (i = 0; i < DB_NKEYS; i += 5) {
+		if (DelEntry(ti, i) == -1)
+			return (-1);
+	}
+	sizeFull = FileSize(DB_FILE);
+	if (AG_DbSync(ti->db) == -1) {
+		TestMsg(ti, "AG_DbSync: %s", AG_GetError());
+		return (-1);
+	}
+	sizeCompact = FileSize(DB_FILE);
+	if (sizeCompact*2 >= sizeFull) {
+		TestMsg(ti, "Not compacted (%ld -> %ld bytes)",
+		    (long)sizeFull, (long)sizeCompact);
+		return (-1);
+	}
+	for (i = 0; i < DB_NKEYS; i++) {
+		if (CheckEntry(ti, i, DB_ROUNDS,
+		    (i % 5 == 0) ? 0 : DB_VALSIZE) == -1)
+			return (-1);
+	}
+	CloseDb(ti);
+	if (OpenDb(ti) == -1) {
+		return (-1);
+	}
+	for (i = 0; i < DB_NKEYS; i++) {
+		if (CheckEntry(ti, i, DB_ROUNDS,
+		    (i % 5 == 0) ? 0 : DB_VALSIZE) == -1)
+			return (-1);
+	}
+	if (CheckEntry(ti, DB_NKEYS, 1, 64) == -1) {
+		return (-1);
+	}
+	TestMsg(ti, "Compaction OK (%ld -> %ld bytes)", (long)sizeFull,
+	    (long)sizeCompact);
+	CloseDb(ti);
+	return (0);
+}
+
+const AG_TestCase dbTest = {
+	"db",
+	N_("Test the AG_Db(3) \"kv\" database backend"),
+	"1.6.0",
+	0,
+	sizeof(MyTestInstance),
+	Init,
+	Destroy,
+	Test,
+	NULL,		/* testGUI */
+	NULL		/* bench */
+};
+
+#endif /* AG_SERIALIZATION and _MK_HAVE_UNISTD_H */
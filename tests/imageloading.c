@@ -231,6 +231,14 @@ TestGUI(void *obj, AG_Window *win)
 	} else {
 		AG_LabelNewS(vBox, 0, AG_GetError());
 	}
+
+	/* Load a PNG file in the background (see AG_SurfaceLoadAsync(3)). */
+	if (!AG_ConfigFind(AG_CONFIG_PATH_DATA, "axe.png", path, sizeof(path))) {
+		AG_LabelNew(vBox, 0, "Loaded asynchronously:");
+		AG_PixmapFromFileAsync(vBox, 0, path, 64, 64);
+	} else {
+		AG_LabelNewS(vBox, 0, AG_GetError());
+	}
 	
 	AG_WindowSetGeometry(win, -1, -1, 500, 800);
 	return (0);
@@ -30,6 +30,7 @@
 #define NREALS 10000
 #define NVECTORS 1000
 #define NMATRICES 100
+#define MATRIX_N 16
 
 typedef struct {
 	AG_TestInstance _inherit;
@@ -38,6 +39,12 @@ typedef struct {
 	M_Vector3 v3[NVECTORS];
 	M_Vector4 v4[NVECTORS];
 	M_Matrix44 m44[NMATRICES];
+	M_Vector3 v3out[NVECTORS];
+	M_Vector4 v4out[NVECTORS];
+	M_VectorReal dots[NVECTORS];
+	M_VectorSoA3 soa, soaOut;
+	M_Matrix *A, *B, *AB;		/* MATRIX_N x MATRIX_N matrices */
+	M_Vector *b, *x;		/* Right-hand side and solution */
 	int curReal, curVec, curMat;
 } MyTestInstance;
 
@@ -70,6 +77,8 @@ RandomMatrix44(MyTestInstance *ti)
 
 #include "math_vector3.h"
 #include "math_matrix44.h"
+#include "math_vector_array.h"
+#include "math_matrix.h"
 
 static int
 Init(void *obj)
@@ -128,9 +137,47 @@ Init(void *obj)
 #endif
 		M_MatFromDoubles44(&ti->m44[i], rands);
 	}
+	M_VectorSoAInit3(&ti->soa);
+	M_VectorSoAInit3(&ti->soaOut);
+	if (M_VectorToSoA3(&ti->soa, ti->v3, NVECTORS) == -1 ||
+	    M_VectorToSoA3(&ti->soaOut, ti->v3, NVECTORS) == -1) {
+		return (-1);
+	}
+
+	/* Diagonally dominant (thus non-singular) system for the LU tests. */
+	ti->A = M_New(MATRIX_N, MATRIX_N);
+	ti->B = M_New(MATRIX_N, MATRIX_N);
+	ti->AB = M_New(MATRIX_N, MATRIX_N);
+	ti->b = M_VecNew(MATRIX_N);
+	ti->x = M_VecNew(MATRIX_N);
+	for (i = 0; i < MATRIX_N; i++) {
+		for (j = 0; j < MATRIX_N; j++) {
+			M_Set(ti->A, i,j, RandomReal(ti));
+			M_Set(ti->B, i,j, RandomReal(ti));
+		}
+		M_Set(ti->A, i,i, M_Get(ti->A, i,i) + (M_Real)MATRIX_N);
+		M_VecSet(ti->b, i, RandomReal(ti));
+	}
+	if (M_FactorizeLU(ti->A) == -1) {
+		return (-1);
+	}
 	return (0);
 }
 
+static void
+Destroy(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	M_VectorSoAFree3(&ti->soa);
+	M_VectorSoAFree3(&ti->soaOut);
+	M_Free(ti->A);
+	M_Free(ti->B);
+	M_Free(ti->AB);
+	M_VecFree(ti->b);
+	M_VecFree(ti->x);
+}
+
 static void
 TestComplex(AG_TestInstance *ti)
 {
@@ -261,6 +308,174 @@ TestMatrix44(AG_TestInstance *ti)
 	TestMsgS(ti, AG_Printf("\tUniScale=%[M44]", &UniScale));
 }
 
+/* Relative tolerance of the batched vector operations. */
+#define VEC_ARRAY_EPSILON 1e-4
+
+/*
+ * Check that x is within VEC_ARRAY_EPSILON of xRef, relative to the
+ * magnitude scale of the operands.
+ */
+static int
+CheckReal(const char *engine, const char *op, Uint i, M_Real x, M_Real xRef,
+    M_Real scale)
+{
+	if (M_Fabs(x - xRef) > VEC_ARRAY_EPSILON*(1.0 + M_Fabs(scale))) {
+		AG_SetError("%s: %s[%u] = %g (expected %g)", engine, op, i,
+		    (double)x, (double)xRef);
+		return (-1);
+	}
+	return (0);
+}
+
+static int
+CheckVector3(const char *engine, const char *op, Uint i, M_Vector3 v,
+    M_Vector3 vRef, M_Real scale)
+{
+	if (CheckReal(engine, op, i, v.x, vRef.x, scale) == -1 ||
+	    CheckReal(engine, op, i, v.y, vRef.y, scale) == -1 ||
+	    CheckReal(engine, op, i, v.z, vRef.z, scale) == -1) {
+		return (-1);
+	}
+	return (0);
+}
+
+/* Transform the point v by A using the scalar M_Matrix44 engine. */
+static M_Vector3
+TransformPoint3(const M_Matrix44 *A, M_Vector3 v)
+{
+	M_Vector4 v4, r;
+
+	v4 = M_VECTOR4(v.x, v.y, v.z, 1.0);
+	r = mMatOps44_FPU.MultVector(*A, v4);
+	return M_VECTOR3(r.x, r.y, r.z);
+}
+
+/*
+ * Compare, element by element, the results of the batched vector
+ * operations in engine ops against the scalar M_Vector3, M_Vector4 and
+ * M_Matrix44 routines. Return -1 on mismatch.
+ */
+static int
+TestVectorArray(MyTestInstance *ti, const M_VectorArrayOps *ops)
+{
+	const M_VectorOps3 *V3 = &mVecOps3_FPU;
+	M_Vector3 *xf, *out, vMin, vMax, vMinRef, vMaxRef;
+	M_Matrix44 *A = &ti->m44[0];
+	M_VectorSoA3 soaCross;
+	M_Real scale;
+	Uint i, n;
+	int rv = -1;
+
+	xf = Malloc(NVECTORS*sizeof(M_Vector3));
+	out = Malloc(NVECTORS*sizeof(M_Vector3));
+	M_VectorSoAInit3(&soaCross);
+
+	/* Array-of-structures */
+	ops->TransformPoints3(xf, A, ti->v3, NVECTORS);
+	for (i = 0; i < NVECTORS; i++) {
+		M_Vector3 vRef = TransformPoint3(A, ti->v3[i]);
+
+		if (CheckVector3(ops->name, "TransformPoints3", i, xf[i], vRef,
+		    V3->Len(vRef)) == -1)
+			goto out;
+	}
+	ops->Transform4(ti->v4out, A, ti->v4, NVECTORS);
+	for (i = 0; i < NVECTORS; i++) {
+		M_Vector4 vRef = mMatOps44_FPU.MultVector(*A, ti->v4[i]);
+
+		scale = mVecOps4_FPU.Len(vRef);
+		if (CheckReal(ops->name, "Transform4", i, ti->v4out[i].x,
+		    vRef.x, scale) == -1 ||
+		    CheckReal(ops->name, "Transform4", i, ti->v4out[i].y,
+		    vRef.y, scale) == -1 ||
+		    CheckReal(ops->name, "Transform4", i, ti->v4out[i].z,
+		    vRef.z, scale) == -1 ||
+		    CheckReal(ops->name, "Transform4", i, ti->v4out[i].w,
+		    vRef.w, scale) == -1)
+			goto out;
+	}
+	ops->Dot3(ti->dots, ti->v3, xf, NVECTORS);
+	ops->Cross3(out, ti->v3, xf, NVECTORS);
+	for (i = 0; i < NVECTORS; i++) {
+		scale = V3->Len(ti->v3[i]) * V3->Len(xf[i]);
+		if (CheckReal(ops->name, "Dot3", i, ti->dots[i],
+		    V3->Dot(ti->v3[i], xf[i]), scale) == -1 ||
+		    CheckVector3(ops->name, "Cross3", i, out[i],
+		    V3->Cross(ti->v3[i], xf[i]), scale) == -1)
+			goto out;
+	}
+	memcpy(out, ti->v3, NVECTORS*sizeof(M_Vector3));
+	ops->Norm3(out, NVECTORS);
+	for (i = 0; i < NVECTORS; i++) {
+		if (CheckVector3(ops->name, "Norm3", i, out[i],
+		    V3->Norm(ti->v3[i]), 1.0) == -1)
+			goto out;
+	}
+
+	/* Odd count to exercise the remainder loops. */
+	n = NVECTORS - 1;
+	ops->Bounds3(ti->v3, n, &vMin, &vMax);
+	vMinRef = vMaxRef = ti->v3[0];
+	for (i = 1; i < n; i++) {
+		vMinRef.x = AG_MIN(vMinRef.x, ti->v3[i].x);
+		vMinRef.y = AG_MIN(vMinRef.y, ti->v3[i].y);
+		vMinRef.z = AG_MIN(vMinRef.z, ti->v3[i].z);
+		vMaxRef.x = AG_MAX(vMaxRef.x, ti->v3[i].x);
+		vMaxRef.y = AG_MAX(vMaxRef.y, ti->v3[i].y);
+		vMaxRef.z = AG_MAX(vMaxRef.z, ti->v3[i].z);
+	}
+	if (CheckVector3(ops->name, "Bounds3.min", 0, vMin, vMinRef, 0.0) == -1 ||
+	    CheckVector3(ops->name, "Bounds3.max", 0, vMax, vMaxRef, 0.0) == -1)
+		goto out;
+
+	/* Structure-of-arrays */
+	ops->TransformPointsSoA3(&ti->soaOut, A, &ti->soa);
+	M_VectorFromSoA3(out, &ti->soaOut);
+	for (i = 0; i < NVECTORS; i++) {
+		if (CheckVector3(ops->name, "TransformPointsSoA3", i, out[i],
+		    xf[i], V3->Len(xf[i])) == -1)
+			goto out;
+	}
+	if (M_VectorSoAResize3(&soaCross, NVECTORS) == -1) {
+		goto out;
+	}
+	ops->DotSoA3(ti->dots, &ti->soa, &ti->soaOut);
+	ops->CrossSoA3(&soaCross, &ti->soa, &ti->soaOut);
+	M_VectorFromSoA3(out, &soaCross);
+	for (i = 0; i < NVECTORS; i++) {
+		scale = V3->Len(ti->v3[i]) * V3->Len(xf[i]);
+		if (CheckReal(ops->name, "DotSoA3", i, ti->dots[i],
+		    V3->Dot(ti->v3[i], xf[i]), scale) == -1 ||
+		    CheckVector3(ops->name, "CrossSoA3", i, out[i],
+		    V3->Cross(ti->v3[i], xf[i]), scale) == -1)
+			goto out;
+	}
+	ops->BoundsSoA3(&ti->soa, &vMin, &vMax);
+	vMinRef.x = AG_MIN(vMinRef.x, ti->v3[n].x);
+	vMinRef.y = AG_MIN(vMinRef.y, ti->v3[n].y);
+	vMinRef.z = AG_MIN(vMinRef.z, ti->v3[n].z);
+	vMaxRef.x = AG_MAX(vMaxRef.x, ti->v3[n].x);
+	vMaxRef.y = AG_MAX(vMaxRef.y, ti->v3[n].y);
+	vMaxRef.z = AG_MAX(vMaxRef.z, ti->v3[n].z);
+	if (CheckVector3(ops->name, "BoundsSoA3.min", 0, vMin, vMinRef, 0.0) == -1 ||
+	    CheckVector3(ops->name, "BoundsSoA3.max", 0, vMax, vMaxRef, 0.0) == -1)
+		goto out;
+	ops->NormSoA3(&ti->soaOut);
+	M_VectorFromSoA3(out, &ti->soaOut);
+	for (i = 0; i < NVECTORS; i++) {
+		if (CheckVector3(ops->name, "NormSoA3", i, out[i],
+		    V3->Norm(xf[i]), 1.0) == -1)
+			goto out;
+	}
+	TestMsg(ti, "\t%s: %u vectors OK", ops->name, NVECTORS);
+	rv = 0;
+out:
+	M_VectorSoAFree3(&soaCross);
+	Free(out);
+	Free(xf);
+	return (rv);
+}
+
 static int
 Test(void *obj)
 {
@@ -305,6 +520,7 @@ Test(void *obj)
 	TestMsg(ti, "\tM_Vector4 engine: %s", mVecOps4->name);
 	TestMsg(ti, "\tM_Matrix engine: %s", mMatOps->name);
 	TestMsg(ti, "\tM_Matrix44 engine: %s", mMatOps44->name);
+	TestMsg(ti, "\tM_Vector array engine: %s", mVecArrOps->name);
 	TestMsgS(ti, "");
 	
 	mVecOps3 = &mVecOps3_FPU;
@@ -326,9 +542,29 @@ Test(void *obj)
 	TestMsgS(ti, "M_Matrix44 Test (SSE):");	TestMatrix44(ti);
 #endif /* HAVE_SSE */
 
+	TestMsgS(ti, "");
+	TestMsgS(ti, "M_Vector array Test (vs. scalar):");
+	if (TestVectorArray(obj, &mVecArrOps_FPU) == -1) {
+		goto fail;
+	}
+#if defined(HAVE_SSE)
+	if (TestVectorArray(obj, &mVecArrOps_SSE) == -1) {
+		goto fail;
+	}
+#endif
+#if defined(M_HAVE_AVX2_KERNELS)
+	if ((agCPU.ext & AG_EXT_AVX2) &&
+	    TestVectorArray(obj, &mVecArrOps_AVX2) == -1)
+		goto fail;
+#endif
+
 	mMatOps44 = prevMatOps44;
 	mVecOps3 = prevVecOps3;
 	return (0);
+fail:
+	mMatOps44 = prevMatOps44;
+	mVecOps3 = prevVecOps3;
+	return (-1);
 }
 
 static int
@@ -337,27 +573,57 @@ Bench(void *obj)
 	AG_TestInstance *ti = obj;
 	const M_VectorOps3 *prevVecOps3 = mVecOps3;
 	const M_MatrixOps44 *prevMatOps44 = mMatOps44;
+	const M_VectorArrayOps *prevVecArrOps = mVecArrOps;
 
 #if defined(INLINE_SSE)
+	mathBenchVector3.name = "M_Vector3 (INLINE SSE)";
 	TestMsg(ti, "M_Vector3 Microbenchmark (INLINE SSE):");
 	TestExecBenchmark(obj, &mathBenchVector3);
 #else /* !INLINE_SSE */
 	mVecOps3 = &mVecOps3_FPU;
 	mMatOps44 = &mMatOps44_FPU;
+	mathBenchVector3.name = "M_Vector3 (FPU)";
 	TestMsg(ti, "M_Vector3 Microbenchmark (FPU):");
 	TestExecBenchmark(obj, &mathBenchVector3);
+	mathBenchMatrix44.name = "M_Matrix44 (FPU)";
 	TestMsg(ti, "M_Matrix44 Microbenchmark (FPU):");
 	TestExecBenchmark(obj, &mathBenchMatrix44);
 # ifdef HAVE_SSE
 	mVecOps3 = &mVecOps3_SSE;
 	mMatOps44 = &mMatOps44_SSE;
+	mathBenchVector3.name = "M_Vector3 (SSE)";
 	TestMsg(ti, "M_Vector3 Microbenchmark (SSE):");
 	TestExecBenchmark(obj, &mathBenchVector3);
+	mathBenchMatrix44.name = "M_Matrix44 (SSE)";
 	TestMsg(ti, "M_Matrix44 Microbenchmark (SSE):");
 	TestExecBenchmark(obj, &mathBenchMatrix44);
 # endif
 #endif /* !INLINE_SSE */
 
+	mVecArrOps = &mVecArrOps_FPU;
+	mathBenchVectorArray.name = "M_Vector array (scalar)";
+	TestMsg(ti, "M_Vector array Microbenchmark (scalar):");
+	TestExecBenchmark(obj, &mathBenchVectorArray);
+#ifdef HAVE_SSE
+	mVecArrOps = &mVecArrOps_SSE;
+	mathBenchVectorArray.name = "M_Vector array (SSE)";
+	TestMsg(ti, "M_Vector array Microbenchmark (SSE):");
+	TestExecBenchmark(obj, &mathBenchVectorArray);
+#endif
+#ifdef M_HAVE_AVX2_KERNELS
+	if (agCPU.ext & AG_EXT_AVX2) {
+		mVecArrOps = &mVecArrOps_AVX2;
+		mathBenchVectorArray.name = "M_Vector array (AVX2)";
+		TestMsg(ti, "M_Vector array Microbenchmark (AVX2):");
+		TestExecBenchmark(obj, &mathBenchVectorArray);
+	}
+#endif
+
+	TestMsg(ti, "M_Matrix Microbenchmark (%s, %dx%d):", mMatOps->name,
+	    MATRIX_N, MATRIX_N);
+	TestExecBenchmark(obj, &mathBenchMatrix);
+
+	mVecArrOps = prevVecArrOps;
 	mMatOps44 = prevMatOps44;
 	mVecOps3 = prevVecOps3;
 	return (0);
@@ -370,7 +636,7 @@ const AG_TestCase mathTest = {
 	0,
 	sizeof(MyTestInstance),
 	Init,
-	NULL,	/* destroy */
+	Destroy,
 	Test,
 	NULL,	/* testGUI */
 	Bench
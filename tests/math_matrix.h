@@ -0,0 +1,44 @@
+/*	Public domain	*/
+/*
+ * Microbenchmarks for operations on m*n matrices (M_Matrix) under the
+ * current M_Matrix engine.
+ */
+
+static void
+MatrixMulv(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	M_Mulv(ti->A, ti->B, ti->AB);
+	realJunk = M_Get(ti->AB, 0,0);
+}
+
+static void
+MatrixFactorizeLU(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	M_FactorizeLU(ti->A);
+}
+
+static void
+MatrixBacksubstLU(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	M_VecCopy(ti->x, ti->b);
+	M_BacksubstLU(ti->A, ti->x);
+	realJunk = M_VecGet(ti->x, 0);
+}
+
+static struct ag_benchmark_fn mathBenchMatrixFns[] = {
+	{ "Mulv()",		MatrixMulv		},
+	{ "FactorizeLU()",	MatrixFactorizeLU	},
+	{ "BacksubstLU()",	MatrixBacksubstLU	},
+};
+struct ag_benchmark mathBenchMatrix = {
+	"M_Matrix",
+	&mathBenchMatrixFns[0],
+	sizeof(mathBenchMatrixFns) / sizeof(mathBenchMatrixFns[0]),
+	10, 1000, 0
+};
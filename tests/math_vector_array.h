@@ -0,0 +1,117 @@
+/*	Public domain	*/
+/*
+ * Microbenchmarks for comparing the performance of batched operations on
+ * arrays of vectors (M_VectorArrayOps), under different backends.
+ */
+
+static void
+VectorTransformPoints3(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	M_VecTransformPoints3(ti->v3out, &ti->m44[0], ti->v3, NVECTORS);
+	realJunk = ti->v3out[NVECTORS-1].x;
+}
+static void
+VectorTransform4(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	M_VecTransform4(ti->v4out, &ti->m44[0], ti->v4, NVECTORS);
+	realJunk = ti->v4out[NVECTORS-1].x;
+}
+static void
+VectorDotArr3(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	M_VecDotArr3(ti->dots, ti->v3, ti->v3out, NVECTORS);
+	realJunk = ti->dots[NVECTORS-1];
+}
+static void
+VectorCrossArr3(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	M_VecCrossArr3(ti->v3out, ti->v3, ti->v3out, NVECTORS);
+	realJunk = ti->v3out[NVECTORS-1].x;
+}
+static void
+VectorNormArr3(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	memcpy(ti->v3out, ti->v3, sizeof(ti->v3));
+	M_VecNormArr3(ti->v3out, NVECTORS);
+	realJunk = ti->v3out[NVECTORS-1].x;
+}
+static void
+VectorBounds3(void *obj)
+{
+	MyTestInstance *ti = obj;
+	M_Vector3 vMin, vMax;
+
+	M_VecBounds3(ti->v3, NVECTORS, &vMin, &vMax);
+	realJunk = vMax.x - vMin.x;
+}
+static void
+VectorTransformPointsSoA3(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	M_VecTransformPointsSoA3(&ti->soaOut, &ti->m44[0], &ti->soa);
+	realJunk = ti->soaOut.x[NVECTORS-1];
+}
+static void
+VectorDotSoA3(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	M_VecDotSoA3(ti->dots, &ti->soa, &ti->soaOut);
+	realJunk = ti->dots[NVECTORS-1];
+}
+static void
+VectorCrossSoA3(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	M_VecCrossSoA3(&ti->soaOut, &ti->soa, &ti->soaOut);
+	realJunk = ti->soaOut.x[NVECTORS-1];
+}
+static void
+VectorNormSoA3(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	M_VecNormSoA3(&ti->soaOut);
+	realJunk = ti->soaOut.x[NVECTORS-1];
+}
+static void
+VectorBoundsSoA3(void *obj)
+{
+	MyTestInstance *ti = obj;
+	M_Vector3 vMin, vMax;
+
+	M_VecBoundsSoA3(&ti->soa, &vMin, &vMax);
+	realJunk = vMax.x - vMin.x;
+}
+
+static struct ag_benchmark_fn mathBenchVectorArrayFns[] = {
+	{ "TransformPoints3(1000)",	VectorTransformPoints3		},
+	{ "Transform4(1000)",		VectorTransform4		},
+	{ "DotArr3(1000)",		VectorDotArr3			},
+	{ "CrossArr3(1000)",		VectorCrossArr3			},
+	{ "NormArr3(1000)",		VectorNormArr3			},
+	{ "Bounds3(1000)",		VectorBounds3			},
+	{ "TransformPointsSoA3(1000)",	VectorTransformPointsSoA3	},
+	{ "DotSoA3(1000)",		VectorDotSoA3			},
+	{ "CrossSoA3(1000)",		VectorCrossSoA3			},
+	{ "NormSoA3(1000)",		VectorNormSoA3			},
+	{ "BoundsSoA3(1000)",		VectorBoundsSoA3		},
+};
+struct ag_benchmark mathBenchVectorArray = {
+	"M_VectorArray",
+	&mathBenchVectorArrayFns[0],
+	sizeof(mathBenchVectorArrayFns) / sizeof(mathBenchVectorArrayFns[0]),
+	10, 100, 10000000
+};
@@ -5,6 +5,19 @@
 
 #include "agartest.h"
 
+#include <stdlib.h>
+
+typedef struct {
+	AG_TestInstance _inherit;
+	AG_Surface *_Nullable dst;		/* Blit target (for bench) */
+	AG_Surface *_Nullable srcOpaque;	/* Opaque source */
+	AG_Surface *_Nullable srcAlpha;		/* Source with alpha blending */
+	AG_Surface *_Nullable srcColorkey;	/* Source with colorkey */
+	AG_Surface *_Nullable srcIndexed;	/* 8-bit indexed source */
+	AG_Surface *_Nullable srcRGB;		/* RGB24 source (for convert) */
+	AG_Surface *_Nullable srcBGRA;		/* BGRA32 source (for convert) */
+} MyTestInstance;
+
 static void
 RenderToSurface(AG_Event *event)
 {
@@ -50,15 +63,348 @@ TestGUI(void *obj, AG_Window *win)
 	return (0);
 }
 
+/*
+ * Surfaces for the conversion tests. The width is odd so that the row
+ * converters also go through their scalar tails.
+ */
+#define CONV_W 37
+#define CONV_H 19
+
+static AG_Surface *
+NewRGB24(Uint w, Uint h)
+{
+#if AG_BYTEORDER == AG_BIG_ENDIAN
+	return AG_SurfaceRGB(w,h, 24, 0, 0xff0000, 0x00ff00, 0x0000ff);
+#else
+	return AG_SurfaceRGB(w,h, 24, 0, 0x0000ff, 0x00ff00, 0xff0000);
+#endif
+}
+
+static AG_Surface *
+NewBGRA32(Uint w, Uint h)
+{
+#if AG_BYTEORDER == AG_BIG_ENDIAN
+	return AG_SurfaceRGBA(w,h, 32, 0,
+	    0x0000ff00, 0x00ff0000, 0xff000000, 0x000000ff);
+#else
+	return AG_SurfaceRGBA(w,h, 32, 0,
+	    0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+#endif
+}
+
+/* Fill a surface with a pattern covering a range of colors and alphas. */
+static void
+FillPattern(AG_Surface *S)
+{
+	Uint x, y;
+
+	if (S->format.mode == AG_SURFACE_INDEXED) {
+		AG_Color pal[256];
+		Uint i;
+
+		for (i = 0; i < 256; i++) {
+			AG_ColorRGBA_8(&pal[i], i, 255-i, (i*37) & 0xff,
+			    (i*91) & 0xff);
+		}
+		AG_SurfaceSetColors(S, pal, 0, 256);
+		for (y = 0; y < S->h; y++) {
+			for (x = 0; x < S->w; x++)
+				AG_SurfacePut(S, x,y, (x + y*CONV_W) & 0xff);
+		}
+		return;
+	}
+	for (y = 0; y < S->h; y++) {
+		for (x = 0; x < S->w; x++) {
+			AG_Color c;
+
+			AG_ColorRGBA_8(&c, (x*7) & 0xff, (y*13) & 0xff,
+			    ((x^y)*29) & 0xff, (x*y*3 + 17) & 0xff);
+			AG_SurfacePut(S, x,y, AG_MapPixel(&S->format, &c));
+		}
+	}
+}
+
+/* Return 1 if components of A and B differ by at most one 8-bit step. */
+static int
+ColorsClose(const AG_Color *A, const AG_Color *B)
+{
+	const int tol = AG_MAX(1, AG_COLOR_LAST/255);
+
+	return (abs((int)A->r - (int)B->r) <= tol &&
+	        abs((int)A->g - (int)B->g) <= tol &&
+	        abs((int)A->b - (int)B->b) <= tol &&
+	        abs((int)A->a - (int)B->a) <= tol);
+}
+
+/*
+ * Compare the pixels of D against the reference conversion of the pixels
+ * of S (through AG_GetColor() and AG_MapPixel()). If premul is set, the
+ * reference is premultiplied and components may differ by one (rounding).
+ */
+static int
+CheckConversion(void *obj, const char *what, const AG_Surface *S,
+    const AG_Surface *D, int premul)
+{
+	Uint x, y;
+
+	for (y = 0; y < S->h; y++) {
+		for (x = 0; x < S->w; x++) {
+			AG_Color c, cD;
+			AG_Pixel px, pxRef;
+
+			AG_GetColor(&c, AG_SurfaceGet(S,x,y), &S->format);
+			if (premul) {
+				c.r = (Uint32)c.r * c.a / AG_COLOR_LAST;
+				c.g = (Uint32)c.g * c.a / AG_COLOR_LAST;
+				c.b = (Uint32)c.b * c.a / AG_COLOR_LAST;
+			}
+			pxRef = AG_MapPixel(&D->format, &c);
+			px = AG_SurfaceGet(D,x,y);
+			if (px == pxRef) {
+				continue;
+			}
+			if (premul) {
+				AG_GetColor(&c, pxRef, &D->format);
+				AG_GetColor(&cD, px, &D->format);
+				if (ColorsClose(&c, &cD))
+					continue;
+			}
+			TestMsg(obj, "%s: Pixel %u,%u is 0x%lx (expected 0x%lx)",
+			    what, x, y, (Ulong)px, (Ulong)pxRef);
+			return (-1);
+		}
+	}
+	return (0);
+}
+
+static int
+Test(void *obj)
+{
+	const char *srcNames[] = { "RGB24", "BGRA32", "Indexed8" };
+	const char *dstNames[] = { "RGB24", "BGRA32", "Native" };
+	AG_Surface *src[3], *dst[3], *D;
+	AG_Palette *pal;
+	Uint i, j, nColors, x, y;
+	char what[64];
+	int rv = -1;
+
+	src[0] = NewRGB24(CONV_W, CONV_H);
+	src[1] = NewBGRA32(CONV_W, CONV_H);
+	src[2] = AG_SurfaceIndexed(CONV_W, CONV_H, 8, 0);
+	dst[0] = NewRGB24(CONV_W, CONV_H);
+	dst[1] = NewBGRA32(CONV_W, CONV_H);
+	dst[2] = AG_SurfaceNew(agSurfaceFmt, CONV_W, CONV_H, 0);
+	for (i = 0; i < 3; i++)
+		FillPattern(src[i]);
+
+	/* AG_SurfaceCopy() between every source and destination format. */
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 3; j++) {
+			Snprintf(what, sizeof(what), "Copy %s -> %s",
+			    srcNames[i], dstNames[j]);
+			AG_SurfaceCopy(dst[j], src[i]);
+			if (CheckConversion(obj, what, src[i], dst[j], 0) == -1)
+				goto out;
+		}
+	}
+	TestMsg(obj, "AG_SurfaceCopy() matches AG_GetColor/AG_MapPixel");
+
+	/* AG_SurfacePremultiplyAlpha() on 32-bit formats with alpha. */
+	for (j = 1; j < 3; j++) {
+		if (dst[j]->format.Amask == 0) {
+			continue;
+		}
+		AG_SurfaceCopy(dst[j], src[1]);
+		D = AG_SurfaceDup(dst[j]);
+		AG_SurfacePremultiplyAlpha(D);
+		Snprintf(what, sizeof(what), "Premultiply %s", dstNames[j]);
+		if (CheckConversion(obj, what, dst[j], D, 1) == -1) {
+			AG_SurfaceFree(D);
+			goto out;
+		}
+		AG_SurfaceFree(D);
+	}
+	TestMsg(obj, "AG_SurfacePremultiplyAlpha() matches reference");
+
+	/* Copying from an indexed surface with an empty palette. */
+	pal = src[2]->format.palette;
+	nColors = pal->nColors;
+	pal->nColors = 0;
+	AG_SurfaceCopy(dst[1], src[2]);
+	pal->nColors = nColors;
+	for (y = 0; y < CONV_H; y++) {
+		for (x = 0; x < CONV_W; x++) {
+			if (AG_SurfaceGet(dst[1],x,y) != 0) {
+				TestMsg(obj, "Empty palette: Pixel %u,%u is set",
+				    x, y);
+				goto out;
+			}
+		}
+	}
+	TestMsg(obj, "Copy from an empty palette OK");
+	rv = 0;
+out:
+	for (i = 0; i < 3; i++) {
+		AG_SurfaceFree(dst[i]);
+		AG_SurfaceFree(src[i]);
+	}
+	return (rv);
+}
+
+static void
+BlitOpaque(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	AG_SurfaceBlit(ti->srcOpaque, NULL, ti->dst, 10, 10);
+}
+static void
+BlitAlpha(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	AG_SurfaceBlit(ti->srcAlpha, NULL, ti->dst, 10, 10);
+}
+static void
+BlitColorkey(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	AG_SurfaceBlit(ti->srcColorkey, NULL, ti->dst, 10, 10);
+}
+static void
+BlitIndexed(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	AG_SurfaceBlit(ti->srcIndexed, NULL, ti->dst, 10, 10);
+}
+static void
+BlitClipped(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	AG_SurfaceBlit(ti->srcOpaque, NULL, ti->dst, -32, 224);
+}
+
+static void
+ConvertRGB(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	AG_SurfaceCopy(ti->dst, ti->srcRGB);
+}
+static void
+ConvertBGRA(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	AG_SurfaceCopy(ti->dst, ti->srcBGRA);
+}
+static void
+ConvertIndexed(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	AG_SurfaceCopy(ti->dst, ti->srcIndexed);
+}
+static void
+PremultiplyBGRA(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	AG_SurfacePremultiplyAlpha(ti->srcBGRA);
+}
+
+static struct ag_benchmark_fn blitBenchFns[] = {
+	{ "Blit 64x64 (opaque)",	BlitOpaque	},
+	{ "Blit 64x64 (alpha)",		BlitAlpha	},
+	{ "Blit 64x64 (colorkey)",	BlitColorkey	},
+	{ "Blit 64x64 (indexed)",	BlitIndexed	},
+	{ "Blit 64x64 (clipped)",	BlitClipped	},
+};
+static struct ag_benchmark blitBench = {
+	"AG_SurfaceBlit",
+	&blitBenchFns[0],
+	sizeof(blitBenchFns) / sizeof(blitBenchFns[0]),
+	10, 100, 0
+};
+
+static struct ag_benchmark_fn convBenchFns[] = {
+	{ "Copy 256x256 (RGB24)",	ConvertRGB	},
+	{ "Copy 256x256 (BGRA32)",	ConvertBGRA	},
+	{ "Copy 64x64 (indexed)",	ConvertIndexed	},
+	{ "Premultiply 256x256",	PremultiplyBGRA	},
+};
+static struct ag_benchmark convBench = {
+	"AG_SurfaceCopy",
+	&convBenchFns[0],
+	sizeof(convBenchFns) / sizeof(convBenchFns[0]),
+	10, 100, 0
+};
+
+static int
+Bench(void *obj)
+{
+	MyTestInstance *ti = obj;
+	AG_Color c;
+
+	ti->dst = AG_SurfaceNew(agSurfaceFmt, 256,256, 0);
+	ti->srcOpaque = AG_SurfaceNew(agSurfaceFmt, 64,64, 0);
+	ti->srcAlpha = AG_SurfaceNew(agSurfaceFmt, 64,64, 0);
+	ti->srcColorkey = AG_SurfaceNew(agSurfaceFmt, 64,64, 0);
+	ti->srcIndexed = AG_SurfaceIndexed(64,64, 8, 0);
+#if AG_BYTEORDER == AG_BIG_ENDIAN
+	ti->srcRGB = AG_SurfaceRGB(256,256, 24, 0,
+	    0xff0000, 0x00ff00, 0x0000ff);
+	ti->srcBGRA = AG_SurfaceRGBA(256,256, 32, 0,
+	    0x0000ff00, 0x00ff0000, 0xff000000, 0x000000ff);
+#else
+	ti->srcRGB = AG_SurfaceRGB(256,256, 24, 0,
+	    0x0000ff, 0x00ff00, 0xff0000);
+	ti->srcBGRA = AG_SurfaceRGBA(256,256, 32, 0,
+	    0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+#endif
+
+	AG_ColorRGB_8(&c, 0,0,120);
+	AG_FillRect(ti->dst, NULL, &c);
+	AG_ColorRGB_8(&c, 200,100,50);
+	AG_FillRect(ti->srcOpaque, NULL, &c);
+	AG_FillRect(ti->srcColorkey, NULL, &c);
+	AG_FillRect(ti->srcRGB, NULL, &c);
+	AG_ColorRGBA_8(&c, 200,100,50,128);
+	AG_FillRect(ti->srcAlpha, NULL, &c);
+	AG_FillRect(ti->srcBGRA, NULL, &c);
+	AG_SurfaceSetAlpha(ti->srcAlpha, AG_SURFACE_ALPHA, AG_OPAQUE);
+	AG_SurfaceSetColorKey(ti->srcColorkey, AG_SURFACE_COLORKEY,
+	    AG_MapPixel(&ti->srcColorkey->format, &c));
+
+	TestMsg(ti, "Blitting to %dx%dx%d surface:", ti->dst->w, ti->dst->h,
+	    ti->dst->format.BitsPerPixel);
+	TestExecBenchmark(obj, &blitBench);
+	TestMsg(ti, "Converting to %dx%dx%d surface:", ti->dst->w, ti->dst->h,
+	    ti->dst->format.BitsPerPixel);
+	TestExecBenchmark(obj, &convBench);
+
+	AG_SurfaceFree(ti->srcBGRA);
+	AG_SurfaceFree(ti->srcRGB);
+	AG_SurfaceFree(ti->srcIndexed);
+	AG_SurfaceFree(ti->srcColorkey);
+	AG_SurfaceFree(ti->srcAlpha);
+	AG_SurfaceFree(ti->srcOpaque);
+	AG_SurfaceFree(ti->dst);
+	return (0);
+}
+
 const AG_TestCase renderToSurfaceTest = {
 	"renderToSurface",
 	N_("Test rendering Agar GUI widgets to software surfaces"),
 	"1.4.2",
 	0,
-	sizeof(AG_TestInstance),
+	sizeof(MyTestInstance),
 	NULL,		/* init */
 	NULL,		/* destroy */
-	NULL,		/* test */
+	Test,
 	TestGUI,
-	NULL		/* bench */
+	Bench
 };
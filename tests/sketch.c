@@ -0,0 +1,212 @@
+/*	Public domain	*/
+
+/*
+ * Test the Agar sketch library (ag_sk).
+ */
+
+#include "config/have_agar_sk.h"
+#ifdef HAVE_AGAR_SK
+
+#include <agar/core.h>
+#include <agar/gui.h>
+#include <agar/math.h>
+#include <agar/sk.h>
+
+#include "agartest.h"
+
+#include "config/have_rand48.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NSEGMENTS 1000		/* Line segments in intersection test */
+#define NCIRCLES  100		/* Circles in intersection test */
+#define NPOINTS   100		/* Points in intersection test */
+
+typedef struct {
+	AG_TestInstance _inherit;
+	SK *_Nullable sk;			/* Input sketch */
+	SK *_Nullable skOut;			/* Output sketch */
+	SK_Node *_Nonnull *_Nullable nodes;	/* Input nodes */
+	Uint nNodes;
+} MyTestInstance;
+
+static M_Real
+RandomCoord(M_Real scale)
+{
+#ifdef HAVE_RAND48
+	return (M_Real)(drand48()*scale);
+#else
+	return (M_Real)(rand() % 10000)*scale/10000.0;
+#endif
+}
+
+static SK_Point *_Nonnull
+PointAt(SK *_Nonnull sk, M_Real x, M_Real y)
+{
+	SK_Point *pt;
+
+	pt = SK_PointNew(sk->root);
+	SK_Translate2(pt, x, y);
+	return (pt);
+}
+
+static int
+Init(void *obj)
+{
+	MyTestInstance *ti = obj;
+	const M_Real scale = 100.0;
+	M_Real x, y;
+	Uint i;
+
+	M_InitSubsystem();
+	SK_InitSubsystem();
+
+	ti->sk = SK_New(NULL, "sketch");
+	ti->skOut = SK_New(NULL, "sketch-out");
+	ti->nodes = Malloc((NSEGMENTS+NCIRCLES+NPOINTS) * sizeof(SK_Node *));
+	ti->nNodes = 0;
+
+	/* Short segments scattered over the sketch. */
+	for (i = 0; i < NSEGMENTS; i++) {
+		SK_Line *line;
+
+		x = RandomCoord(scale);
+		y = RandomCoord(scale);
+		line = SK_LineNew(ti->sk->root);
+		line->p1 = PointAt(ti->sk, x, y);
+		line->p2 = PointAt(ti->sk, x + RandomCoord(4.0) - 2.0,
+		                           y + RandomCoord(4.0) - 2.0);
+		SK_NodeAddReference(line, line->p1);
+		SK_NodeAddReference(line, line->p2);
+		ti->nodes[ti->nNodes++] = SKNODE(line);
+	}
+	for (i = 0; i < NCIRCLES; i++) {
+		SK_Circle *circle;
+
+		circle = SK_CircleNew(ti->sk->root);
+		circle->p = PointAt(ti->sk, RandomCoord(scale),
+		                            RandomCoord(scale));
+		circle->r = 0.5 + RandomCoord(3.0);
+		SK_NodeAddReference(circle, circle->p);
+		ti->nodes[ti->nNodes++] = SKNODE(circle);
+	}
+	/* Pairs of coincident points. */
+	for (i = 0; i < NPOINTS; i += 2) {
+		x = RandomCoord(scale);
+		y = RandomCoord(scale);
+		ti->nodes[ti->nNodes++] = SKNODE(PointAt(ti->sk, x, y));
+		ti->nodes[ti->nNodes++] = SKNODE(PointAt(ti->sk, x, y));
+	}
+	return (0);
+}
+
+static void
+Destroy(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	Free(ti->nodes);
+	if (ti->sk != NULL) { AG_ObjectDestroy(ti->sk); }
+	if (ti->skOut != NULL) { AG_ObjectDestroy(ti->skOut); }
+}
+
+static int
+Test(void *obj)
+{
+	MyTestInstance *ti = obj;
+	SK_Group *gSweep, *gAll;
+	SK_Node *n1, *n2;
+	Uint nPairsSweep, nPairsAll, nSweep = 0, nAll = 0;
+
+	gSweep = SK_GroupNew(ti->skOut->root);
+	gAll = SK_GroupNew(ti->skOut->root);
+
+	nPairsSweep = SK_IntersectNodes(gSweep, ti->nodes, ti->nNodes, 0);
+	nPairsAll = SK_IntersectNodes(gAll, ti->nodes, ti->nNodes,
+	    SK_INTERSECT_ALL_PAIRS);
+
+	TestMsg(ti, "SK_IntersectNodes(%u nodes): %u/%u pairs tested",
+	    ti->nNodes, nPairsSweep, nPairsAll);
+
+	/* Both methods must generate the same entities, in the same order. */
+	n2 = TAILQ_FIRST(&SKNODE(gAll)->cnodes);
+	TAILQ_FOREACH(n1, &SKNODE(gSweep)->cnodes, sknodes) {
+		M_Vector3 v1, v2;
+
+		nSweep++;
+		if (n2 == NULL) {
+			continue;
+		}
+		nAll++;
+		v1 = SK_Pos(n1);
+		v2 = SK_Pos(n2);
+		if (strcmp(n1->ops->name, n2->ops->name) != 0 ||
+		    v1.x != v2.x || v1.y != v2.y) {
+			TestMsg(ti, "Mismatch: %s (%f,%f) vs. %s (%f,%f)",
+			    n1->name, v1.x, v1.y, n2->name, v2.x, v2.y);
+			return (-1);
+		}
+		n2 = TAILQ_NEXT(n2, sknodes);
+	}
+	for (; n2 != NULL; n2 = TAILQ_NEXT(n2, sknodes)) {
+		nAll++;
+	}
+	TestMsg(ti, "Intersections: %u (sweep), %u (all pairs)", nSweep, nAll);
+	if (nSweep != nAll) {
+		return (-1);
+	}
+	return (0);
+}
+
+static void
+IntersectSweep(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	SK_IntersectNodes(SK_GroupNew(ti->skOut->root),
+	    ti->nodes, ti->nNodes, 0);
+}
+static void
+IntersectAllPairs(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	SK_IntersectNodes(SK_GroupNew(ti->skOut->root),
+	    ti->nodes, ti->nNodes, SK_INTERSECT_ALL_PAIRS);
+}
+
+static struct ag_benchmark_fn sketchBenchIntersectFns[] = {
+	{ "IntersectNodes(1200, sweep)",	IntersectSweep		},
+	{ "IntersectNodes(1200, all pairs)",	IntersectAllPairs	},
+};
+static struct ag_benchmark sketchBenchIntersect = {
+	"SK_IntersectNodes",
+	&sketchBenchIntersectFns[0],
+	sizeof(sketchBenchIntersectFns) / sizeof(sketchBenchIntersectFns[0]),
+	4, 1, 0
+};
+
+static int
+Bench(void *obj)
+{
+	AG_TestInstance *ti = obj;
+
+	TestMsg(ti, "SK_IntersectNodes() Benchmark:");
+	TestExecBenchmark(obj, &sketchBenchIntersect);
+	return (0);
+}
+
+const AG_TestCase sketchTest = {
+	"sketch",
+	N_("Test the ag_sk library"),
+	"1.6.0",
+	0,
+	sizeof(MyTestInstance),
+	Init,
+	Destroy,
+	Test,
+	NULL,	/* testGUI */
+	Bench
+};
+#endif /* HAVE_AGAR_SK */
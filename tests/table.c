@@ -20,6 +20,11 @@
 
 #include <agar/core/snprintf.h>
 
+typedef struct {
+	AG_TestInstance _inherit;
+	AG_Table *_Nullable table;		/* Table to fill (for bench) */
+} MyTestInstance;
+
 /* This function is called to sort the elements of a column (Ex.1) */
 static int
 MyCustomSortFn(const void *p1, const void *p2)
@@ -312,15 +317,86 @@ TestGUI(void *obj, AG_Window *win)
 	return (0);
 }
 
+/*
+ * Repopulate the table between AG_TableBegin() and AG_TableEnd(), as a
+ * polled table would do on every update.
+ */
+static void
+FillTable(AG_Table *t, int nRows)
+{
+	int i;
+
+	AG_TableBegin(t);
+	for (i = 0; i < nRows; i++) {
+		AG_TableAddRow(t, "%s:%d:%.02f", "Foo", i, (float)i/3.0f);
+	}
+	AG_TableEnd(t);
+}
+
+static void
+TableFill10(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	FillTable(ti->table, 10);
+}
+static void
+TableFill100(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	FillTable(ti->table, 100);
+}
+static void
+TableFill1000(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	FillTable(ti->table, 1000);
+}
+
+static struct ag_benchmark_fn tableBenchFns[] = {
+	{ "Fill 10 rows",	TableFill10	},
+	{ "Fill 100 rows",	TableFill100	},
+	{ "Fill 1000 rows",	TableFill1000	},
+};
+static struct ag_benchmark tableBench = {
+	"AG_Table",
+	&tableBenchFns[0],
+	sizeof(tableBenchFns) / sizeof(tableBenchFns[0]),
+	10, 20, 0
+};
+
+static int
+Bench(void *obj)
+{
+	MyTestInstance *ti = obj;
+	AG_Window *win;
+
+	if ((win = AG_WindowNew(0)) == NULL) {
+		return (-1);
+	}
+	ti->table = AG_TableNew(win, AG_TABLE_EXPAND);
+	AG_TableAddCol(ti->table, "Name", "<HIDDEN POINTER>", NULL);
+	AG_TableAddCol(ti->table, "Val", "<8888>", MyCustomSortFn);
+	AG_TableAddCol(ti->table, "Stuff", NULL, NULL);
+
+	TestExecBenchmark(obj, &tableBench);
+
+	AG_ObjectDetach(win);
+	ti->table = NULL;
+	return (0);
+}
+
 const AG_TestCase tableTest = {
 	"table",
 	N_("Test the AG_Table(3) widget"),
 	"1.4.2",
 	0,
-	sizeof(AG_TestInstance),
+	sizeof(MyTestInstance),
 	NULL,		/* init */
 	NULL,		/* destroy */
 	NULL,		/* test */
 	TestGUI,
-	NULL		/* bench */
+	Bench
 };
@@ -5,11 +5,17 @@
 #include "agartest.h"
 #ifdef AG_TIMERS
 
+#define NBENCHPENDING 100	/* Pending timers in AG_ProcessTimeouts() bench */
+#define NBENCHEXPIRED 10	/* Expiring timers in AG_ProcessTimeouts() bench */
+
 typedef struct {
 	AG_TestInstance _inherit;
 	AG_Timer to[3], toReg;
 	AG_Window *win;
 	Uint tick, period;
+	AG_Object *_Nullable benchObj;		/* Parent of bench timers */
+	AG_Timer toPending[NBENCHPENDING];
+	AG_Timer toExpired[NBENCHEXPIRED];
 } MyTestInstance;
 
 static Uint32
@@ -88,6 +94,7 @@ Init(void *obj)
 	ti->win = NULL;
 	ti->tick = 0;
 	ti->period = 1000;
+	ti->benchObj = NULL;
 	AG_InitTimer(&ti->to[0], "testTimer1", 0);
 	AG_InitTimer(&ti->to[1], "testTimer2", 0);
 	AG_InitTimer(&ti->to[2], "testTimer3", 0);
@@ -139,6 +146,82 @@ TestGUI(void *obj, AG_Window *win)
 	return (0);
 }
 
+static Uint32
+BenchTimeout(AG_Timer *to, AG_Event *event)
+{
+	return (0);
+}
+
+/* Scan the pending timers, none of which are due. */
+static void
+ProcessPending(void *obj)
+{
+	AG_ProcessTimeouts(AG_GetTicks());
+}
+
+/* Schedule and expire a batch of one-shot timers. */
+static void
+ProcessExpired(void *obj)
+{
+	MyTestInstance *ti = obj;
+	int i;
+
+	for (i = 0; i < NBENCHEXPIRED; i++) {
+		AG_AddTimer(ti->benchObj, &ti->toExpired[i], 1,
+		    BenchTimeout, NULL);
+	}
+	AG_ProcessTimeouts(AG_GetTicks() + 2);
+}
+
+static struct ag_benchmark_fn timeoutsBenchFns[] = {
+	{ "ProcessTimeouts (pending)",	ProcessPending	},
+	{ "ProcessTimeouts (expired)",	ProcessExpired	},
+};
+static struct ag_benchmark timeoutsBench = {
+	"AG_ProcessTimeouts",
+	&timeoutsBenchFns[0],
+	sizeof(timeoutsBenchFns) / sizeof(timeoutsBenchFns[0]),
+	10, 1000, 0
+};
+
+static int
+Bench(void *obj)
+{
+	MyTestInstance *ti = obj;
+	int i;
+
+	if (AG_GetEventSource()->caps[AG_SINK_TIMER]) {
+		TestMsgS(ti, "Timers are handled by the event source; skipping");
+		return (0);
+	}
+	if ((ti->benchObj = AG_ObjectNew(NULL, "timeoutsBench",
+	    &agObjectClass)) == NULL) {
+		return (-1);
+	}
+	for (i = 0; i < NBENCHPENDING; i++) {
+		AG_InitTimer(&ti->toPending[i], "pending", 0);
+		if (AG_AddTimer(ti->benchObj, &ti->toPending[i], 3600000,
+		    BenchTimeout, NULL) == -1)
+			goto fail;
+	}
+	for (i = 0; i < NBENCHEXPIRED; i++)
+		AG_InitTimer(&ti->toExpired[i], "expired", 0);
+
+	TestMsg(ti, "%d pending timers, %d expiring per iteration:",
+	    NBENCHPENDING, NBENCHEXPIRED);
+	TestExecBenchmark(obj, &timeoutsBench);
+
+	AG_DelTimers(ti->benchObj);
+	AG_ObjectDestroy(ti->benchObj);
+	ti->benchObj = NULL;
+	return (0);
+fail:
+	AG_DelTimers(ti->benchObj);
+	AG_ObjectDestroy(ti->benchObj);
+	ti->benchObj = NULL;
+	return (-1);
+}
+
 const AG_TestCase timeoutsTest = {
 	"timeouts",
 	N_("Test AG_Timer(3) facility"),
@@ -149,7 +232,7 @@ const AG_TestCase timeoutsTest = {
 	NULL,
 	NULL,		/* test */
 	TestGUI,
-	NULL		/* bench */
+	Bench
 };
 
 #endif /* AG_TIMERS */
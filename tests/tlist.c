@@ -0,0 +1,357 @@
+/*	Public domain	*/
+
+/*
+ * Test the AG_Tlist(3) state restoration of polled refreshes (under the
+ * standard and custom compare functions), and the AG_TLIST_VIRTUAL mode.
+ */
+
+#include "agartest.h"
+
+#include <string.h>
+
+#ifdef AG_TIMERS
+
+#define NITEMS		500		/* Items in the polled list */
+#define NCHILDREN	3		/* Child items of expanded items */
+#define NVIRT		100000		/* Items in the virtual list */
+
+typedef struct {
+	AG_TestInstance _inherit;
+	int items[NITEMS];			/* Targets of p1 */
+	int children[NITEMS*NCHILDREN];
+	char virt[NVIRT];
+	int gen;				/* Refresh generation */
+} MyTestInstance;
+
+/* Initially selected and expanded items. */
+#define SELECTED(i)	((i) % 7 == 0)
+#define EXPANDED(i)	((i) % 20 == 0)
+#define HAS_CHILDREN(i)	((i) % 10 == 0)
+#define DROPPED(i)	((i) % 3 == 0)
+
+/*
+ * Generate the polled list. Odd generations are in reverse order, and
+ * generation 2 leaves out some of the items.
+ */
+static void
+PollItems(AG_Event *event)
+{
+	AG_Tlist *tl = AG_SELF();
+	MyTestInstance *ti = AG_PTR(1);
+	AG_TlistItem *it;
+	int k, i, j;
+
+	AG_TlistBegin(tl);
+	for (k = 0; k < NITEMS; k++) {
+		i = (ti->gen & 1) ? NITEMS-1-k : k;
+		if (ti->gen == 2 && DROPPED(i)) {
+			continue;
+		}
+		it = AG_TlistAddPtr(tl, NULL, "", &ti->items[i]);
+		Snprintf(it->text, sizeof(it->text), "Item %d", i);
+		if (!HAS_CHILDREN(i)) {
+			continue;
+		}
+		it->flags |= AG_TLIST_HAS_CHILDREN;
+		if (!AG_TlistVisibleChildren(tl, it)) {
+			continue;
+		}
+		for (j = 0; j < NCHILDREN; j++) {
+			it = AG_TlistAdd(tl, NULL, "Item %d.%d", i, j);
+			it->p1 = &ti->children[i*NCHILDREN + j];
+			it->depth = 1;
+		}
+	}
+	AG_TlistEnd(tl);
+}
+
+/* Custom compare function (not eligible for keyed matching). */
+static int
+CompareCustom(const AG_TlistItem *a, const AG_TlistItem *b)
+{
+	return (a->p1 == b->p1 && strcmp(a->text, b->text) == 0);
+}
+
+/*
+ * Check the selection and expansion of every item in the polled list. If
+ * lost is set, items which were left out of a refresh must have lost
+ * their state.
+ */
+static int
+CheckPolled(MyTestInstance *ti, AG_Tlist *tl, const char *what, int lost)
+{
+	AG_TlistItem *it;
+	int nItems = 0, nExpected = 0, i;
+
+	for (i = 0; i < NITEMS; i++) {
+		nExpected++;
+		if (HAS_CHILDREN(i) && EXPANDED(i) && !(lost && DROPPED(i)))
+			nExpected += NCHILDREN;
+	}
+	AG_TLIST_FOREACH(it, tl) {
+		int sel, exp;
+
+		nItems++;
+		if (it->depth > 0) {
+			continue;
+		}
+		i = (int *)it->p1 - &ti->items[0];
+		sel = SELECTED(i) && !(lost && DROPPED(i));
+		exp = HAS_CHILDREN(i) && EXPANDED(i) && !(lost && DROPPED(i));
+		if (it->selected != sel) {
+			TestMsg(ti, "%s: %s is %sselected", what, it->text,
+			    it->selected ? "" : "not ");
+			return (-1);
+		}
+		if (((it->flags & AG_TLIST_EXPANDED) != 0) != exp) {
+			TestMsg(ti, "%s: %s is %sexpanded", what, it->text,
+			    exp ? "not " : "");
+			return (-1);
+		}
+	}
+	if (nItems != nExpected) {
+		TestMsg(ti, "%s: %d items (expected %d)", what, nItems,
+		    nExpected);
+		return (-1);
+	}
+	return (0);
+}
+
+static int
+TestPolled(MyTestInstance *ti, const char *name,
+    int (*compareFn)(const AG_TlistItem *, const AG_TlistItem *))
+{
+	AG_Tlist *tl;
+	AG_TlistItem *it;
+	char what[64];
+	int i, rv = -1;
+
+	tl = AG_TlistNewPolled(NULL, AG_TLIST_MULTI, PollItems, "%p", ti);
+	AG_TlistSetCompareFn(tl, compareFn);
+
+	ti->gen = 0;
+	AG_PostEvent(NULL, tl, "tlist-poll", NULL);
+	AG_TLIST_FOREACH(it, tl) {
+		i = (int *)it->p1 - &ti->items[0];
+		if (SELECTED(i)) {
+			AG_TlistSelect(tl, it);
+		}
+		if (HAS_CHILDREN(i) && EXPANDED(i))
+			it->flags |= AG_TLIST_EXPANDED;
+	}
+
+	/* Expanding items adds their children on the next refresh. */
+	for (ti->gen = 0; ti->gen < 2; ti->gen++) {
+		AG_PostEvent(NULL, tl, "tlist-poll", NULL);
+		Snprintf(what, sizeof(what), "%s: Refresh %d", name, ti->gen);
+		if (CheckPolled(ti, tl, what, 0) == -1)
+			goto out;
+	}
+
+	/* Items left out of a refresh forget their state. */
+	for (ti->gen = 2; ti->gen < 4; ti->gen++) {
+		AG_PostEvent(NULL, tl, "tlist-poll", NULL);
+	}
+	Snprintf(what, sizeof(what), "%s: Refresh without items", name);
+	if (CheckPolled(ti, tl, what, 1) == -1) {
+		goto out;
+	}
+	TestMsg(ti, "Polled refresh (%s) OK", name);
+	rv = 0;
+out:
+	AG_ObjectDestroy(tl);
+	return (rv);
+}
+
+static int
+CountVirtual(AG_Tlist *tl, void *arg)
+{
+	return (NVIRT);
+}
+
+static void
+FetchVirtual(AG_Tlist *tl, AG_TlistItem *it, int i, void *arg)
+{
+	MyTestInstance *ti = arg;
+
+	Snprintf(it->text, sizeof(it->text), "Row %d", i);
+	it->p1 = &ti->virt[i];
+	if (i % 1000 == 0)
+		it->flags |= AG_TLIST_HAS_CHILDREN;
+}
+
+static void
+PressKey(AG_Tlist *tl, AG_KeySym ks)
+{
+	AG_PostEvent(NULL, tl, "key-down", "%i(key),%i(mod),%lu(ch)",
+	    (int)ks, 0, 0UL);
+	AG_PostEvent(NULL, tl, "key-up", "%i(key),%i(mod),%lu(ch)",
+	    (int)ks, 0, 0UL);
+}
+
+/*
+ * Check that row iSel is the one selected row, that it is returned by
+ * AG_TlistSelectedItem(), and that it is materialized if in view.
+ */
+static int
+CheckVirtualSel(MyTestInstance *ti, AG_Tlist *tl, const char *what, int iSel)
+{
+	AG_TlistItem *it;
+	int i, nSel = 0;
+
+	if ((it = AG_TlistSelectedItem(tl)) == NULL ||
+	    it->p1 != &ti->virt[iSel]) {
+		TestMsg(ti, "%s: Selected %s (expected Row %d)", what,
+		    (it != NULL) ? it->text : "nothing", iSel);
+		return (-1);
+	}
+	for (i = 0; i < tl->nvisitems; i++) {
+		if ((it = AG_TlistFindByIndex(tl, tl->rOffs+i+1)) == NULL) {
+			TestMsg(ti, "%s: Row %d is missing", what, tl->rOffs+i);
+			return (-1);
+		}
+		if (it->p1 != &ti->virt[tl->rOffs+i]) {
+			TestMsg(ti, "%s: Row %d is %s", what, tl->rOffs+i,
+			    it->text);
+			return (-1);
+		}
+		if (it->selected)
+			nSel++;
+	}
+	if (nSel != (iSel >= tl->rOffs && iSel < tl->rOffs+tl->nvisitems)) {
+		TestMsg(ti, "%s: %d rows selected in view", what, nSel);
+		return (-1);
+	}
+	return (0);
+}
+
+static int
+TestVirtual(MyTestInstance *ti)
+{
+	AG_Tlist *tl;
+	AG_TlistItem *it;
+	AG_SizeReq r;
+	AG_SizeAlloc a;
+	int i, iSel, nVis, rv = -1;
+
+	tl = AG_TlistNew(NULL, 0);
+	AG_TlistSetVirtual(tl, CountVirtual, FetchVirtual, ti);
+	AG_WidgetSizeReq(tl, &r);
+	a.x = 0;
+	a.y = 0;
+	a.w = 320;
+	a.h = tl->item_h*10;
+	AG_WidgetSizeAlloc(tl, &a);
+	if ((nVis = tl->nvisitems) < 2) {
+		TestMsg(ti, "Virtual: %d rows in view", nVis);
+		goto out;
+	}
+
+	/* Select and expand rows in the first window. */
+	if ((it = AG_TlistFindByIndex(tl, 1)) == NULL) {
+		TestMsg(ti, "Virtual: No first row");
+		goto out;
+	}
+	it->flags |= AG_TLIST_EXPANDED;
+	AG_TlistSelect(tl, AG_TlistFindByIndex(tl, 2));
+	if (CheckVirtualSel(ti, tl, "Select", 1) == -1)
+		goto out;
+
+	/* Move the selection past the materialized window. */
+	for (i = 0; i < nVis+3; i++) {
+		PressKey(tl, AG_KEY_DOWN);
+	}
+	iSel = 1 + nVis+3;
+	if (tl->rOffs != iSel - nVis + 1) {
+		TestMsg(ti, "Virtual: Scrolled to %d (expected %d)", tl->rOffs,
+		    iSel - nVis + 1);
+		goto out;
+	}
+	if (CheckVirtualSel(ti, tl, "Key down", iSel) == -1) {
+		goto out;
+	}
+	PressKey(tl, AG_KEY_PAGEDOWN);
+	iSel += agPageIncrement;
+	if (CheckVirtualSel(ti, tl, "Page down", iSel) == -1)
+		goto out;
+
+	/* Selection and expansion persist out of view. */
+	AG_TlistScrollToEnd(tl);
+	if ((it = AG_TlistFindByIndex(tl, NVIRT)) == NULL ||
+	    it->p1 != &ti->virt[NVIRT-1]) {
+		TestMsg(ti, "Virtual: Last row is %s",
+		    (it != NULL) ? it->text : "missing");
+		goto out;
+	}
+	if (CheckVirtualSel(ti, tl, "Scroll to end", iSel) == -1) {
+		goto out;
+	}
+	AG_TlistScrollToStart(tl);
+	if (CheckVirtualSel(ti, tl, "Scroll to start", iSel) == -1) {
+		goto out;
+	}
+	if (!(AG_TlistFindByIndex(tl, 1)->flags & AG_TLIST_EXPANDED)) {
+		TestMsg(ti, "Virtual: Row 0 is no longer expanded");
+		goto out;
+	}
+	AG_TlistRefresh(tl);
+	if (CheckVirtualSel(ti, tl, "Refresh", iSel) == -1) {
+		goto out;
+	}
+
+	/* Keyboard navigation from the end of the list. */
+	AG_TlistScrollToEnd(tl);
+	PressKey(tl, AG_KEY_DOWN);
+	iSel = NVIRT - nVis;
+	if (CheckVirtualSel(ti, tl, "Key down at end", iSel) == -1) {
+		goto out;
+	}
+	for (i = 0; i < nVis+1; i++) {
+		PressKey(tl, AG_KEY_DOWN);
+	}
+	if (CheckVirtualSel(ti, tl, "Last row", NVIRT-1) == -1) {
+		goto out;
+	}
+	TestMsg(ti, "Virtual list (%d of %d rows in view) OK", nVis, NVIRT);
+	rv = 0;
+out:
+	AG_ObjectDestroy(tl);
+	return (rv);
+}
+
+/*
+ * The lists are not attached to a window, so nothing is drawn. We only
+ * size the virtual list (to set the number of rows in view).
+ */
+static int
+Test(void *obj)
+{
+	MyTestInstance *ti = obj;
+
+	if (TestPolled(ti, "ComparePtrs", AG_TlistComparePtrs) == -1 ||
+	    TestPolled(ti, "CompareStrings", AG_TlistCompareStrings) == -1 ||
+	    TestPolled(ti, "Custom", CompareCustom) == -1 ||
+	    TestVirtual(ti) == -1) {
+		return (-1);
+	}
+	return (0);
+}
+
+#endif /* AG_TIMERS */
+
+const AG_TestCase tlistTest = {
+	"tlist",
+	N_("Test AG_Tlist(3) polled refreshes and virtual mode"),
+	"1.6.0",
+	0,
+	sizeof(MyTestInstance),
+	NULL,		/* init */
+	NULL,		/* destroy */
+#ifdef AG_TIMERS
+	Test,
+#else
+	NULL,		/* test */
+#endif
+	NULL,		/* testGUI */
+	NULL		/* bench */
+};
@@ -0,0 +1,294 @@
+/*	Public domain	*/
+
+/*
+ * Test the AG_Treetbl(3) row ID hash and the flattened array of expanded
+ * rows against a reference walk of the tree, under random expansions,
+ * collapses and deletions of lazily populated rows.
+ */
+
+#include "agartest.h"
+
+#define NROOTS		2000		/* Rows at the root */
+#define NCHILDREN	5		/* Rows created by Populate() */
+#define MAXDEPTH	4		/* Deepest lazily populated row */
+#define NTOGGLES	1500		/* Random expansions and collapses */
+#define NDELETES	200		/* Random deletions */
+#define NREF_MAX	200000		/* Limit on the reference walk */
+
+typedef struct {
+	AG_TestInstance _inherit;
+	AG_Window *win;
+	AG_Treetbl *tt;
+	AG_TreetblRow **ref;		/* Reference flattening */
+	int nRef;
+	int nextID;			/* Next row ID for Populate() */
+	Uint32 seed;
+} MyTestInstance;
+
+/* Deterministic pseudo-random numbers (so that failures can be replayed). */
+static int
+Rand(MyTestInstance *ti, int n)
+{
+	ti->seed = ti->seed*1103515245 + 12345;
+	return (int)((ti->seed >> 16) % (Uint32)n);
+}
+
+static void
+Populate(AG_Treetbl *tt, AG_TreetblRow *row)
+{
+	MyTestInstance *ti = AG_GetPointer(tt, "test-instance");
+	AG_TreetblRow *child;
+	int i;
+
+	for (i = 0; i < NCHILDREN; i++) {
+		child = AG_TreetblAddRow(tt, row, ti->nextID++, "%s", 0,
+		    "Child");
+		if (child != NULL && row->depth < MAXDEPTH)
+			child->flags |= AG_TREETBL_ROW_LAZY;
+	}
+}
+
+/* Flatten the expanded rows the slow way. */
+static int
+Flatten(MyTestInstance *ti, AG_TreetblRowQ *q)
+{
+	AG_TreetblRow *row;
+
+	TAILQ_FOREACH(row, q, siblings) {
+		if (ti->nRef >= NREF_MAX) {
+			AG_SetErrorS("Reference walk too large");
+			return (-1);
+		}
+		ti->ref[ti->nRef++] = row;
+		if ((row->flags & AG_TREETBL_ROW_EXPANDED) &&
+		    Flatten(ti, &row->children) == -1)
+			return (-1);
+	}
+	return (0);
+}
+
+/*
+ * Redraw the window (which updates the visible rows from the flattened
+ * array), then compare the expanded row count, the flattened array and the
+ * visible rows against the reference walk.
+ */
+static int
+Check(MyTestInstance *ti, const char *what)
+{
+	AG_Treetbl *tt = ti->tt;
+	AG_Driver *drv = AGWIDGET(ti->win)->drv;
+	int i, value;
+
+	ti->nRef = 0;
+	if (Flatten(ti, &tt->children) == -1)
+		return (-1);
+
+	tt->visible.dirty = 1;
+	AG_BeginRendering(drv);
+	AG_WindowDraw(ti->win);
+	AG_EndRendering(drv);
+
+	if (tt->nExpandedRows != ti->nRef) {
+		AG_SetError("%s: %d expanded rows (expected %d)", what,
+		    tt->nExpandedRows, ti->nRef);
+		return (-1);
+	}
+	if (tt->expRowsOK) {
+		for (i = 0; i < ti->nRef; i++) {
+			if (tt->expRows[i] != ti->ref[i]) {
+				AG_SetError("%s: expRows[%d] is row %d "
+				            "(expected %d)", what, i,
+				    tt->expRows[i]->rid, ti->ref[i]->rid);
+				return (-1);
+			}
+		}
+	}
+	value = AG_GetInt(tt->vBar, "value");
+	for (i = 0; i < (int)tt->visible.count; i++) {
+		AG_TreetblRow *row = tt->visible.items[i].row;
+
+		if (value+i >= ti->nRef) {
+			if (row != NULL) {
+				AG_SetError("%s: Visible row %d past the end",
+				    what, i);
+				return (-1);
+			}
+			continue;
+		}
+		if (row != ti->ref[value+i] ||
+		    tt->visible.items[i].depth != (int)row->depth) {
+			AG_SetError("%s: Visible row %d (at %d) is %d "
+			            "(expected %d)", what, i, value,
+			    (row != NULL) ? row->rid : -1,
+			    ti->ref[value+i]->rid);
+			return (-1);
+		}
+	}
+	return (0);
+}
+
+/* Check that every row ID in [0,nextID) maps to the right row, if any. */
+static int
+CheckLookup(MyTestInstance *ti, const char *what, int *nFound)
+{
+	AG_TreetblRow *row;
+	int i;
+
+	*nFound = 0;
+	for (i = 0; i < ti->nextID; i++) {
+		if ((row = AG_TreetblLookupRow(ti->tt, i)) == NULL) {
+			continue;
+		}
+		if (row->rid != i) {
+			AG_SetError("%s: Lookup of %d returned row %d", what,
+			    i, row->rid);
+			return (-1);
+		}
+		(*nFound)++;
+	}
+	if (AG_TreetblLookupRow(ti->tt, -1) != NULL) {
+		AG_SetError("%s: Lookup of -1 succeeded", what);
+		return (-1);
+	}
+	return (0);
+}
+
+static void
+Scroll(MyTestInstance *ti)
+{
+	AG_Treetbl *tt = ti->tt;
+
+	AG_SetInt(tt->vBar, "value",
+	    Rand(ti, (tt->nExpandedRows > 0) ? tt->nExpandedRows : 1));
+}
+
+static int
+TestRows(MyTestInstance *ti)
+{
+	AG_Treetbl *tt = ti->tt;
+	AG_TreetblRow *row;
+	int i, nFound;
+
+	for (i = 0; i < NROOTS; i++) {
+		if ((row = AG_TreetblAddRow(tt, NULL, i, "%s", 0,
+		    "Root")) == NULL) {
+			return (-1);
+		}
+		if (i % 20 == 0)
+			row->flags |= AG_TREETBL_ROW_LAZY;
+	}
+	ti->nextID = NROOTS;
+	if (AG_TreetblAddRow(tt, NULL, 5, "%s", 0, "Duplicate") != NULL) {
+		AG_SetErrorS("Added a duplicate row ID");
+		return (-1);
+	}
+	if (Check(ti, "Initial") == -1 ||
+	    CheckLookup(ti, "Initial", &nFound) == -1)
+		return (-1);
+
+	/* Toggle random rows, root rows first and then deeper ones. */
+	for (i = 0; i < NTOGGLES; i++) {
+		int rid = (i < NTOGGLES/2) ? Rand(ti, NROOTS) :
+		                             Rand(ti, ti->nextID);
+
+		if ((row = AG_TreetblLookupRow(tt, rid)) == NULL) {
+			continue;
+		}
+		if ((row->flags & AG_TREETBL_ROW_EXPANDED) &&
+		    (i < NTOGGLES/2 || Rand(ti, 3) == 0)) {
+			AG_TreetblCollapseRow(tt, row);
+		} else {
+			AG_TreetblExpandRow(tt, row);
+		}
+		if (i % 7 == 0) {
+			Scroll(ti);
+		}
+		if (i % 25 == 0 && Check(ti, "Toggle") == -1)
+			return (-1);
+	}
+	if (Check(ti, "Toggled") == -1 ||
+	    CheckLookup(ti, "Toggled", &nFound) == -1)
+		return (-1);
+	TestMsg(ti, "%d rows (%d expanded) after %d toggles", nFound,
+	    tt->nExpandedRows, NTOGGLES);
+
+	for (i = 0; i < NDELETES; i++) {
+		row = AG_TreetblLookupRow(tt, Rand(ti, ti->nextID));
+		if (row != NULL) {
+			AG_TreetblDelRow(tt, row);
+		}
+		if (i % 10 == 0) {
+			Scroll(ti);
+			if (Check(ti, "Delete") == -1)
+				return (-1);
+		}
+	}
+	if (Check(ti, "Deleted") == -1 ||
+	    CheckLookup(ti, "Deleted", &nFound) == -1)
+		return (-1);
+	TestMsg(ti, "%d rows (%d expanded) after %d deletions", nFound,
+	    tt->nExpandedRows, NDELETES);
+
+	AG_TreetblClearRows(tt);
+	if (CheckLookup(ti, "Cleared", &nFound) == -1 ||
+	    Check(ti, "Cleared") == -1) {
+		return (-1);
+	}
+	if (nFound != 0) {
+		AG_SetError("%d rows still hashed after clear", nFound);
+		return (-1);
+	}
+	for (i = 0; i < 100; i++) {
+		if (AG_TreetblAddRow(tt, NULL, i, "%s", 0, "Again") == NULL)
+			return (-1);
+	}
+	if (Check(ti, "Re-added") == -1 ||
+	    CheckLookup(ti, "Re-added", &nFound) == -1) {
+		return (-1);
+	}
+	if (nFound != 100) {
+		AG_SetError("%d rows hashed after re-adding 100", nFound);
+		return (-1);
+	}
+	return (0);
+}
+
+static int
+Test(void *obj)
+{
+	MyTestInstance *ti = obj;
+	AG_TreetblCol *col;
+	int rv;
+
+	ti->seed = 1;
+	ti->ref = Malloc(NREF_MAX*sizeof(AG_TreetblRow *));
+
+	ti->win = AG_WindowNew(AG_WINDOW_NOBUTTONS);
+	AG_WindowSetCaption(ti->win, "agartest: %s", ti->_inherit.name);
+	ti->tt = AG_TreetblNew(ti->win, AG_TREETBL_EXPAND, NULL, NULL);
+	AG_SetPointer(ti->tt, "test-instance", ti);
+	col = AG_TreetblAddCol(ti->tt, 0, "<XXXXXXXXXXXXXXXX>", "Name");
+	AG_TreetblSetExpanderCol(ti->tt, col);
+	AG_TreetblSetPopulateFn(ti->tt, Populate);
+	AG_WindowSetGeometry(ti->win, 0, 0, 300, 600);
+	AG_WindowShow(ti->win);
+
+	rv = TestRows(ti);
+
+	AG_ObjectDetach(ti->win);
+	Free(ti->ref);
+	return (rv);
+}
+
+const AG_TestCase treetblTest = {
+	"treetbl",
+	N_("Test the AG_Treetbl(3) row hash and expanded row array"),
+	"1.6.0",
+	0,
+	sizeof(MyTestInstance),
+	NULL,		/* init */
+	NULL,		/* destroy */
+	Test,
+	NULL,		/* testGUI */
+	NULL		/* bench */
+};
@@ -128,6 +128,10 @@ VG_Init(VG *vg, Uint flags)
 	vg->layers = NULL;
 	vg->nLayers = 0;
 	TAILQ_INIT(&vg->nodes);
+	AG_HandleTblsInit(&vg->handles);
+	TAILQ_INIT(&vg->indices);
+	vg->idxVisit = 0;
+	vg->idxMark = 0;
 	AG_MutexInitRecursive(&vg->lock);
 	
 	vg->T = Malloc(sizeof(VG_Matrix));
@@ -167,6 +171,7 @@ VG_NodeDestroy(void *p)
 	if (vn->ops->destroy != NULL) {
 		vn->ops->destroy(vn);
 	}
+	Free(vn->users);
 	Free(vn);
 }
 
@@ -212,7 +217,16 @@ VG_ClearColors(VG *vg)
 void
 VG_Destroy(VG *vg)
 {
+	VG_Index *idx, *idxNext;
+
+	for (idx = TAILQ_FIRST(&vg->indices);
+	     idx != TAILQ_END(&vg->indices);
+	     idx = idxNext) {
+		idxNext = TAILQ_NEXT(idx, indices);
+		VG_IndexSetVG(idx, NULL);
+	}
 	VG_Clear(vg);
+	AG_HandleTblsFree(&vg->handles);
 	Free(vg->layers);
 	AG_MutexDestroy(&vg->lock);
 }
@@ -296,7 +310,10 @@ MoveNodesRecursively(VG *_Nonnull vgDst, VG_Node *_Nonnull vn)
 	VG_FOREACH_CHLD(vnChld, vn, vg_node) {
 		MoveNodesRecursively(vgDst, vnChld);
 	}
+	AG_HandleRemove(&vn->vg->handles, vn->ops->name, &vn->hEnt);
 	vn->handle = VG_GenNodeName(vgDst, vn->ops->name);
+	AG_HandleInsert(&vgDst->handles, vn->ops->name, &vn->hEnt, vn->handle,
+	    vn);
 	TAILQ_REMOVE(&vn->vg->nodes, vn, list);
 	vn->vg = vgDst;
 	TAILQ_INSERT_TAIL(&vgDst->nodes, vn, list);
@@ -311,7 +328,14 @@ VG_Merge(void *pVnDst, VG *vgSrc)
 {
 	VG_Node *vnDst = pVnDst;
 	VG_Node *vn = vgSrc->root;
+	VG_Index *idx;
 
+	TAILQ_FOREACH(idx, &vgSrc->indices, indices) {
+		VG_IndexInvalidate(idx, NULL);
+	}
+	TAILQ_FOREACH(idx, &vnDst->vg->indices, indices) {
+		VG_IndexInvalidate(idx, NULL);
+	}
 	vn->vg = vnDst->vg;
 	vn->parent = vnDst;
 	TAILQ_INSERT_TAIL(&vnDst->vg->nodes, vn, list);
@@ -329,15 +353,20 @@ VG_AddRef(void *p, void *pRef)
 	if (vn->vg != NULL) { VG_Lock(vn->vg); }
 	vn->refs = Realloc(vn->refs, (vn->nRefs+1)*sizeof(VG_Node *));
 	vn->refs[vn->nRefs++] = VGNODE(pRef);
-	VGNODE(pRef)->nDeps++;
-	if (vn->vg != NULL) { VG_Unlock(vn->vg); }
+	VGNODE(pRef)->users = Realloc(VGNODE(pRef)->users,
+	    (VGNODE(pRef)->nDeps+1)*sizeof(VG_Node *));
+	VGNODE(pRef)->users[VGNODE(pRef)->nDeps++] = vn;
+	if (vn->vg != NULL) {
+		VG_NodeInvalidate(vn);
+		VG_Unlock(vn->vg);
+	}
 }
 
 /* Remove a node reference to another node. */
 Uint
 VG_DelRef(void *pVn, void *pRef)
 {
-	VG_Node *vn = pVn;
+	VG_Node *vn = pVn, *vnRef = pRef;
 	Uint newDeps;
 	int i;
 
@@ -354,11 +383,65 @@ VG_DelRef(void *pVn, void *pRef)
 		    (vn->nRefs-i-1)*sizeof(VG_Node *));
 	}
 	vn->nRefs--;
-	newDeps = (--VGNODE(pRef)->nDeps);
-	if (vn->vg != NULL) { VG_Unlock(vn->vg); }
+
+	for (i = 0; i < vnRef->nDeps; i++) {
+		if (vnRef->users[i] == vn)
+			break;
+	}
+	if (i < vnRef->nDeps-1) {
+		memmove(&vnRef->users[i], &vnRef->users[i+1],
+		    (vnRef->nDeps-i-1)*sizeof(VG_Node *));
+	}
+	newDeps = (--vnRef->nDeps);
+	if (vn->vg != NULL) {
+		VG_NodeInvalidate(vn);
+		VG_Unlock(vn->vg);
+	}
 	return (newDeps);
 }
 
+static void
+InvalidateNode(VG *_Nonnull vg, VG_Node *_Nonnull vn)
+{
+	VG_Node *vnChld;
+	VG_Index *idx;
+	Uint i;
+
+	if (vn->idxVisit == vg->idxVisit) {
+		return;
+	}
+	vn->idxVisit = vg->idxVisit;
+	vn->idxVer++;
+
+	TAILQ_FOREACH(idx, &vg->indices, indices) {
+		VG_IndexPush(idx, vn);
+	}
+	for (i = 0; i < vn->nDeps; i++) {
+		InvalidateNode(vg, vn->users[i]);
+	}
+	VG_FOREACH_CHLD(vnChld, vn, vg_node)
+		InvalidateNode(vg, vnChld);
+}
+
+/*
+ * Signal a change in the geometry of a node. Its child nodes and the
+ * nodes depending on it are also invalidated.
+ */
+void
+VG_NodeInvalidate(void *p)
+{
+	VG_Node *vn = p;
+	VG *vg = vn->vg;
+
+	if (vg == NULL || TAILQ_EMPTY(&vg->indices)) {
+		return;
+	}
+	VG_Lock(vg);
+	vg->idxVisit++;
+	InvalidateNode(vg, vn);
+	VG_Unlock(vg);
+}
+
 void VG_SetBackgroundColor(VG *vg, VG_Color c) { vg->fillColor = c; }
 void VG_SetSelectionColor(VG *vg, VG_Color c) { vg->selectionColor = c; }
 void VG_SetMouseOverColor(VG *vg, VG_Color c) { vg->mouseoverColor = c; }
@@ -379,6 +462,13 @@ VG_NodeInit(void *p, VG_NodeOps *vnOps)
 	vn->refs = NULL;
 	vn->nRefs = 0;
 	vn->nDeps = 0;
+	vn->users = NULL;
+	vn->idxVer = 0;
+	vn->idxVisit = 0;
+	vn->idxMark = 0;
+	vn->hEnt.handle = 0;
+	vn->hEnt.p = vn;
+	vn->hEnt.next = NULL;
 	vn->T = VG_MatrixIdentity();
 	vn->p = NULL;
 	TAILQ_INIT(&vn->cNodes);
@@ -387,17 +477,27 @@ VG_NodeInit(void *p, VG_NodeOps *vnOps)
 		vn->ops->init(vn);
 }
 
-/* Generate a unique name for a node of the specified type. */
+/*
+ * Generate a unique name for a node of the specified type. This is the
+ * lowest handle not in use by an instance of the class.
+ */
 Uint32
 VG_GenNodeName(VG *vg, const char *type)
 {
-	Uint32 name = 1;
+	Uint32 handle;
 
-	while (VG_FindNode(vg, name, type) != NULL) {
-		if (++name >= VG_HANDLE_MAX)
-			AG_FatalError("Out of node names");
+	handle = AG_HandleGenerate(&vg->handles, type, VG_HANDLE_MAX);
+	if (handle == 0) {
+		AG_FatalError("Out of node names");
 	}
-	return (name);
+	return (handle);
+}
+
+/* Search a node by handle and class. Used for loading datafiles. */
+void *
+VG_FindNode(VG *vg, Uint32 handle, const char *type)
+{
+	return AG_HandleLookup(&vg->handles, type, handle);
 }
 
 /*
@@ -409,6 +509,7 @@ VG_NodeAttach(void *pParent, void *pNode)
 {
 	VG_Node *vnParent = pParent;
 	VG_Node *vn = pNode;
+	VG_Index *idx;
 	VG *vg;
 
 	if (vnParent == NULL) {
@@ -423,10 +524,15 @@ VG_NodeAttach(void *pParent, void *pNode)
 	if (vn->handle == 0) {
 		vn->handle = VG_GenNodeName(vg, vn->ops->name);
 	}
+	AG_HandleInsert(&vg->handles, vn->ops->name, &vn->hEnt, vn->handle,
+	    vn);
 	vn->parent = vnParent;
 	TAILQ_INSERT_TAIL(&vnParent->cNodes, vn, tree);
 	TAILQ_INSERT_TAIL(&vg->nodes, vn, list);
 	vn->vg = vg;
+	TAILQ_FOREACH(idx, &vg->indices, indices) {
+		VG_IndexPush(idx, vn);
+	}
 	VG_Unlock(vg);
 }
 
@@ -441,12 +547,16 @@ VG_NodeDetach(void *p)
 	VG_Node *vn = p;
 	VG *vg = vn->vg;
 	VG_Node *vnChld, *vnNext;
+	VG_Index *idx;
 
 #ifdef AG_DEBUG
 	if (vg == NULL)
 		AG_FatalError("Unattached node");
 #endif
 	VG_Lock(vg);
+	TAILQ_FOREACH(idx, &vg->indices, indices) {
+		VG_IndexInvalidate(idx, vn);
+	}
 	for (vnChld = TAILQ_FIRST(&vn->cNodes);
 	     vnChld != TAILQ_END(&vn->cNodes);
 	     vnChld = vnNext) {
@@ -460,6 +570,7 @@ VG_NodeDetach(void *p)
 		vn->parent = NULL;
 	}
 	TAILQ_REMOVE(&vg->nodes, vn, list);
+	AG_HandleRemove(&vg->handles, vn->ops->name, &vn->hEnt);
 	vn->vg = NULL;
 	VG_Unlock(vg);
 }
@@ -848,32 +959,7 @@ void *
 VG_PointProximity(VG_View *vv, const char *type, const VG_Vector *vPt,
     VG_Vector *vC, void *ignoreNode)
 {
-	VG *vg = vv->vg;
-	VG_Node *vn, *vnClosest = NULL;
-	float distClosest = AG_FLT_MAX, p;
-	VG_Vector v, vClosest = VGVECTOR(AG_FLT_MAX,AG_FLT_MAX);
-
-	VG_FOREACH_NODE(vn, vg, vg_node) {
-		if (vn == ignoreNode ||
-		    vn->ops->pointProximity == NULL) {
-			continue;
-		}
-		if (type != NULL &&
-		    strcmp(vn->ops->name, type) != 0) {
-			continue;
-		}
-		v = *vPt;
-		p = vn->ops->pointProximity(vn, vv, &v);
-		if (p < distClosest) {
-			distClosest = p;
-			vnClosest = vn;
-			vClosest = v;
-		}
-	}
-	if (vC != NULL) {
-		*vC = vClosest;
-	}
-	return (vnClosest);
+	return VG_PointProximityMax(vv, type, vPt, vC, ignoreNode, AG_FLT_MAX);
 }
 
 /*
@@ -884,28 +970,11 @@ void *
 VG_PointProximityMax(VG_View *vv, const char *type, const VG_Vector *vPt,
     VG_Vector *vC, void *ignoreNode, float distMax)
 {
-	VG *vg = vv->vg;
-	VG_Node *vn, *vnClosest = NULL;
-	float distClosest = AG_FLT_MAX, p;
-	VG_Vector v, vClosest = VGVECTOR(AG_FLT_MAX,AG_FLT_MAX);
+	VG_Node *vnClosest;
+	VG_Vector vClosest = VGVECTOR(AG_FLT_MAX,AG_FLT_MAX);
 
-	VG_FOREACH_NODE(vn, vg, vg_node) {
-		if (vn == ignoreNode ||
-		    vn->ops->pointProximity == NULL) {
-			continue;
-		}
-		if (type != NULL &&
-		    strcmp(vn->ops->name, type) != 0) {
-			continue;
-		}
-		v = *vPt;
-		p = vn->ops->pointProximity(vn, vv, &v);
-		if (p < distMax && p < distClosest) {
-			distClosest = p;
-			vnClosest = vn;
-			vClosest = v;
-		}
-	}
+	vnClosest = VG_IndexNearest(&vv->idx, *vPt, type, ignoreNode, distMax,
+	    &vClosest);
 	if (vC != NULL) {
 		*vC = vClosest;
 	}
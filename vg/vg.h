@@ -42,6 +42,7 @@ typedef struct vg_indexed_color {
 struct vg;
 struct vg_view;
 struct vg_node;
+struct vg_index;
 struct ag_static_icon;
 
 #include <agar/vg/vg_snap.h>
@@ -103,6 +104,11 @@ typedef struct vg_node {
 	Uint                               nRefs;   /* Referenced node count */
 
 	Uint nDeps;			/* Dependency count */
+	struct vg_node *_Nullable *_Nullable users; /* Dependent nodes */
+
+	Uint idxVer;			/* Geometry version (for VG_Index) */
+	Uint idxVisit;			/* For VG_NodeInvalidate() */
+	Uint idxMark;			/* Last VG_Index query stamp */
 
 	VG_Color  color;		/* Element color */
 	int       layer;		/* Layer index */
@@ -115,6 +121,7 @@ typedef struct vg_node {
 	AG_TAILQ_ENTRY(vg_node) list;	/* Entry in global list */
 	AG_TAILQ_ENTRY(vg_node) reverse; /* For VG_NodeTransform() */
 	AG_TAILQ_ENTRY(vg_node) user;	/* Entry in user list */
+	AG_HandleEnt hEnt;		/* Entry in handle table */
 } VG_Node;
 
 #define VGNODE(p) ((VG_Node *)(p))
@@ -140,6 +147,12 @@ typedef struct vg {
 
 	VG_Node *_Nullable root;	/* Tree of entities */
 	AG_TAILQ_HEAD_(vg_node) nodes;	/* List of entities */
+
+	AG_HandleTbls handles;		/* Handle tables (per class) */
+
+	AG_TAILQ_HEAD_(vg_index) indices; /* Spatial indices (of views) */
+	Uint idxVisit;			/* For VG_NodeInvalidate() */
+	Uint idxMark;			/* VG_Index query stamp */
 	AG_TAILQ_ENTRY(vg) user;	/* Entry in user list */
 } VG;
 
@@ -199,8 +212,11 @@ void   VG_Merge(void *_Nonnull, VG *_Nonnull);
 void   VG_AddRef(void *_Nonnull, void *_Nonnull);
 Uint   VG_DelRef(void *_Nonnull, void *_Nonnull);
 void   VG_NodeTransform(void *_Nonnull, VG_Matrix *_Nonnull);
+void   VG_NodeInvalidate(void *_Nonnull);
 Uint32 VG_GenNodeName(VG *_Nonnull, const char *_Nonnull)
                      _Warn_Unused_Result;
+void *_Nullable VG_FindNode(VG *_Nonnull, Uint32, const char *_Nonnull)
+                           _Warn_Unused_Result;
 
 void VG_SetBackgroundColor(VG *_Nonnull, VG_Color);
 void VG_SetSelectionColor(VG *_Nonnull, VG_Color);
@@ -327,20 +343,6 @@ VG_FindNodeSym(VG *_Nonnull vg, const char *_Nonnull sym)
 	return (NULL);
 }
 
-/* Search a node by handle and class. Used for loading datafiles. */
-static __inline__ void *_Nullable
-VG_FindNode(VG *_Nonnull vg, Uint32 handle, const char *_Nonnull type)
-{
-	VG_Node *vn;
-
-	AG_TAILQ_FOREACH(vn, &vg->nodes, list) {
-		if (vn->handle == handle &&
-		    strcmp(vn->ops->name, type) == 0)
-			return (vn);
-	}
-	return (NULL);
-}
-
 /* Push the transformation matrix stack. */
 static __inline__ void
 VG_PushMatrix(VG *_Nonnull vg)
@@ -369,6 +371,7 @@ VG_LoadIdentity(void *_Nonnull pNode)
 	vn->T.m[0][0] = 1.0f;	vn->T.m[0][1] = 0.0f;	vn->T.m[0][2] = 0.0f;
 	vn->T.m[1][0] = 0.0f;	vn->T.m[1][1] = 1.0f;	vn->T.m[1][2] = 0.0f;
 	vn->T.m[2][0] = 0.0f;	vn->T.m[2][1] = 0.0f;	vn->T.m[2][2] = 1.0f;
+	if (vn->vg != NULL) { VG_NodeInvalidate(vn); }
 }
 
 /* Set the position of the given node relative to its parent. */
@@ -379,6 +382,7 @@ VG_SetPositionInParent(void *_Nonnull pNode, VG_Vector v)
 	
 	vn->T.m[0][2] = v.x;
 	vn->T.m[1][2] = v.y;
+	if (vn->vg != NULL) { VG_NodeInvalidate(vn); }
 }
 
 /* Translate the given node. */
@@ -393,6 +397,7 @@ VG_Translate(void *_Nonnull pNode, VG_Vector v)
 	T.m[2][0] = 0.0f;	T.m[2][1] = 0.0f;	T.m[2][2] = 1.0f;
 
 	VG_MultMatrix(&vn->T, &T);
+	if (vn->vg != NULL) { VG_NodeInvalidate(vn); }
 }
 
 /* Apply uniform scaling to the current viewing matrix. */
@@ -407,6 +412,7 @@ VG_Scale(void *_Nonnull pNode, float s)
 	T.m[2][0] = 0.0f;	T.m[2][1] = 0.0f;	T.m[2][2] = s;
 
 	VG_MultMatrix(&vn->T, &T);
+	if (vn->vg != NULL) { VG_NodeInvalidate(vn); }
 }
 
 /* Apply a rotation to the current viewing matrix. */
@@ -423,6 +429,7 @@ VG_Rotate(void *_Nonnull pNode, float theta)
 	T.m[2][0] = 0.0f;	T.m[2][1] = 0.0f;	T.m[2][2] = 1.0f;
 
 	VG_MultMatrix(&vn->T, &T);
+	if (vn->vg != NULL) { VG_NodeInvalidate(vn); }
 }
 
 /* Reflection about vertical line going through the origin. */
@@ -437,6 +444,7 @@ VG_FlipVert(void *_Nonnull pNode)
 	T.m[2][0] = 0.0f;	T.m[2][1] = 0.0f;	T.m[2][2] = 1.0f;
 
 	VG_MultMatrix(&vn->T, &T);
+	if (vn->vg != NULL) { VG_NodeInvalidate(vn); }
 }
 
 /* Reflection about horizontal line going through the origin. */
@@ -451,6 +459,7 @@ VG_FlipHoriz(void *_Nonnull pNode)
 	T.m[2][0] = 0.0f;	T.m[2][1] = 0.0f;	T.m[2][2] = 1.0f;
 
 	VG_MultMatrix(&vn->T, &T);
+	if (vn->vg != NULL) { VG_NodeInvalidate(vn); }
 }
 
 /* Mark node as selected. */
@@ -511,6 +520,7 @@ VG_SetPosition(void *_Nonnull pNode, VG_Vector v)
 		vn->T.m[0][2] -= vParent.x;
 		vn->T.m[1][2] -= vParent.y;
 	}
+	if (vn->vg != NULL) { VG_NodeInvalidate(vn); }
 }
 __END_DECLS
 
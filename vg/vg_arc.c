@@ -66,6 +66,7 @@ VG_ArcRadius(VG_Arc *va, float r)
 {
 	VG_Lock(VGNODE(va)->vg);
 	va->r = r;
+	VG_NodeInvalidate(va);
 	VG_Unlock(VGNODE(va)->vg);
 }
 
@@ -183,6 +184,13 @@ Move(void *p, VG_Vector vCurs, VG_Vector vRel)
 	VG_Arc *va = p;
 
 	va->r = VG_Distance(VG_Pos(va->p), vCurs);
+	VG_NodeInvalidate(va);
+}
+
+static void
+Invalidate(AG_Event *_Nonnull event)
+{
+	VG_NodeInvalidate(AG_PTR(1));
 }
 
 static void *
@@ -190,8 +198,10 @@ Edit(void *p, VG_View *vv)
 {
 	VG_Arc *va = p;
 	AG_Box *box = AG_BoxNewVert(NULL, AG_BOX_EXPAND);
+	AG_Numerical *num;
 
-	AG_NumericalNewFlt(box, 0, NULL, _("Radius: "), &va->r);
+	num = AG_NumericalNewFlt(box, 0, NULL, _("Radius: "), &va->r);
+	AG_SetEvent(num, "numerical-changed", Invalidate, "%p", va);
 	AG_NumericalNewFlt(box, 0, NULL, _("Start angle: "), &va->a1);
 	AG_NumericalNewFlt(box, 0, NULL, _("End angle: "), &va->a2);
 
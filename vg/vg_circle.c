@@ -148,6 +148,13 @@ Move(void *_Nonnull obj, VG_Vector vCurs, VG_Vector vRel)
 	VG_Circle *vc = obj;
 
 	vc->r = VG_Distance(VG_Pos(vc->p), vCurs);
+	VG_NodeInvalidate(vc);
+}
+
+static void
+Invalidate(AG_Event *_Nonnull event)
+{
+	VG_NodeInvalidate(AG_PTR(1));
 }
 
 static void *_Nonnull
@@ -155,8 +162,10 @@ Edit(void *_Nonnull obj, VG_View *_Nonnull vv)
 {
 	VG_Circle *vc = obj;
 	AG_Box *box = AG_BoxNewVert(NULL, AG_BOX_EXPAND);
+	AG_Numerical *num;
 
-	AG_NumericalNewFlt(box, 0, NULL, _("Radius: "), &vc->r);
+	num = AG_NumericalNewFlt(box, 0, NULL, _("Radius: "), &vc->r);
+	AG_SetEvent(num, "numerical-changed", Invalidate, "%p", vc);
 	return (box);
 }
 
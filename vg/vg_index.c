@@ -0,0 +1,660 @@
+/*
+ * Copyright (c) 2026 Julien Nadeau Carriere <vedge@csoft.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Spatial index of VG nodes for VG_View. Node extents are hashed into a
+ * uniform grid. Nodes changed through VG_NodeInvalidate() (or attached)
+ * are queued and re-inserted on the next query; their previous entries
+ * are recognized as stale by version number. Detaching nodes or changing
+ * the view scale forces a full rebuild.
+ *
+ * Nearest-node queries visit rings of cells around the query point and
+ * stop as soon as no unvisited cell can hold a closer node. This relies
+ * on the pointProximity() of a node never being smaller than the distance
+ * to its extent.
+ */
+
+#include <agar/core/core.h>
+#include <agar/gui/gui.h>
+#include <agar/vg/vg.h>
+#include <agar/vg/vg_view.h>
+
+#include <string.h>
+
+#define VG_INDEX_COORD_MAX 0x1000000	/* Max cell coordinate */
+#define VG_INDEX_UNBOUNDED(ent) ((ent)->a.x == -AG_FLT_MAX)
+
+/* Nearest-node query in progress. */
+typedef struct vg_index_query {
+	VG_Index *_Nonnull idx;
+	VG_Vector pos;			/* Query point */
+	const char *_Nullable type;	/* Class filter */
+	void *_Nullable ignore;		/* Node to ignore */
+	Uint stamp;			/* Query stamp */
+	float best;			/* Smallest proximity so far */
+	VG_Node *_Nullable vnBest;	/* Closest node so far */
+	VG_Vector vBest;		/* Closest point on vnBest */
+} VG_IndexQuery;
+
+void
+VG_IndexInit(VG_Index *idx, VG_View *vv)
+{
+	idx->flags = VG_INDEX_REBUILD;
+	idx->vg = NULL;
+	idx->vv = vv;
+	idx->scale = 0.0f;
+	idx->cellSize = 1.0f;
+	idx->x1 = idx->y1 = 0;
+	idx->x2 = idx->y2 = 0;
+	idx->buckets = NULL;
+	idx->nBuckets = 0;
+	idx->nCells = 0;
+	idx->large = NULL;
+	idx->nLarge = 0;
+	idx->maxLarge = 0;
+	idx->dirty = NULL;
+	idx->nDirty = 0;
+	idx->maxDirty = 0;
+	idx->nEnts = 0;
+	idx->nEntsBase = 0;
+	idx->nNodes = 0;
+	idx->vnHover = NULL;
+}
+
+static void
+FreeCells(VG_Index *_Nonnull idx)
+{
+	VG_IndexCell *cell, *cellNext;
+	Uint i;
+
+	for (i = 0; i < idx->nBuckets; i++) {
+		for (cell = idx->buckets[i]; cell != NULL; cell = cellNext) {
+			cellNext = cell->next;
+			Free(cell->ents);
+			Free(cell);
+		}
+		idx->buckets[i] = NULL;
+	}
+	idx->nCells = 0;
+	idx->nLarge = 0;
+	idx->nEnts = 0;
+}
+
+void
+VG_IndexDestroy(VG_Index *idx)
+{
+	VG_IndexSetVG(idx, NULL);
+	FreeCells(idx);
+	Free(idx->buckets);
+	Free(idx->large);
+	Free(idx->dirty);
+}
+
+/* Register the index with a VG (or unregister it if vg is NULL). */
+void
+VG_IndexSetVG(VG_Index *idx, VG *vg)
+{
+	if (idx->vg == vg) {
+		return;
+	}
+	if (idx->vg != NULL) {
+		VG_Lock(idx->vg);
+		TAILQ_REMOVE(&idx->vg->indices, idx, indices);
+		VG_Unlock(idx->vg);
+	}
+	if ((idx->vg = vg) != NULL) {
+		VG_Lock(vg);
+		TAILQ_INSERT_TAIL(&vg->indices, idx, indices);
+		VG_Unlock(vg);
+	}
+	idx->flags |= VG_INDEX_REBUILD;
+	idx->nDirty = 0;
+	idx->vnHover = NULL;
+}
+
+/* Queue a changed node for re-insertion. The VG must be locked. */
+void
+VG_IndexPush(VG_Index *idx, VG_Node *vn)
+{
+	if (idx->flags & VG_INDEX_REBUILD) {
+		return;
+	}
+	if (idx->nDirty == VG_INDEX_DIRTY_MAX) {
+		idx->flags |= VG_INDEX_REBUILD;
+		idx->nDirty = 0;
+		return;
+	}
+	if (idx->nDirty+1 > idx->maxDirty) {
+		idx->maxDirty = (idx->maxDirty > 0) ? idx->maxDirty*2 : 32;
+		idx->dirty = Realloc(idx->dirty,
+		    idx->maxDirty*sizeof(VG_Node *));
+	}
+	idx->dirty[idx->nDirty++] = vn;
+}
+
+/*
+ * Force a rebuild of the index. If vn is not NULL, it is about to be
+ * detached. The VG must be locked.
+ */
+void
+VG_IndexInvalidate(VG_Index *idx, VG_Node *vn)
+{
+	idx->flags |= VG_INDEX_REBUILD;
+	idx->nDirty = 0;
+	if (vn != NULL && idx->vnHover == vn)
+		idx->vnHover = NULL;
+}
+
+static __inline__ int
+CellCoord(const VG_Index *_Nonnull idx, float v)
+{
+	float f = VG_Floor(v / idx->cellSize);
+
+	if (f < -VG_INDEX_COORD_MAX) { return (-VG_INDEX_COORD_MAX); }
+	if (f > +VG_INDEX_COORD_MAX) { return (+VG_INDEX_COORD_MAX); }
+	return ((int)f);
+}
+
+static __inline__ Uint
+HashCell(const VG_Index *_Nonnull idx, int x, int y)
+{
+	return (((Uint)x*73856093U) ^ ((Uint)y*19349663U)) &
+	       (idx->nBuckets - 1);
+}
+
+static __inline__ VG_IndexCell *_Nullable
+LookupCell(const VG_Index *_Nonnull idx, int x, int y)
+{
+	VG_IndexCell *cell;
+
+	for (cell = idx->buckets[HashCell(idx,x,y)];
+	     cell != NULL;
+	     cell = cell->next) {
+		if (cell->x == x && cell->y == y)
+			return (cell);
+	}
+	return (NULL);
+}
+
+static void
+AddEnt(VG_IndexEnt *_Nullable *_Nonnull ents, Uint *_Nonnull n,
+    Uint *_Nonnull max, const VG_IndexEnt *_Nonnull ent)
+{
+	if (*n+1 > *max) {
+		*max = (*max > 0) ? (*max)*2 : 4;
+		*ents = Realloc(*ents, (*max)*sizeof(VG_IndexEnt));
+	}
+	(*ents)[(*n)++] = *ent;
+}
+
+static void
+InsertEnt(VG_Index *_Nonnull idx, const VG_IndexEnt *_Nonnull ent)
+{
+	VG_IndexCell *cell;
+	int x1, y1, x2, y2, x, y;
+	int empty = (idx->nCells == 0);
+	Uint h;
+
+	if (VG_INDEX_UNBOUNDED(ent)) {
+		goto large;
+	}
+	x1 = CellCoord(idx, ent->a.x);
+	y1 = CellCoord(idx, ent->a.y);
+	x2 = CellCoord(idx, ent->b.x);
+	y2 = CellCoord(idx, ent->b.y);
+	if (x2-x1 >= VG_INDEX_SPAN_MAX || y2-y1 >= VG_INDEX_SPAN_MAX ||
+	    (x2-x1+1)*(y2-y1+1) > VG_INDEX_SPAN_MAX)
+		goto large;
+
+	for (y = y1; y <= y2; y++) {
+		for (x = x1; x <= x2; x++) {
+			if ((cell = LookupCell(idx, x,y)) == NULL) {
+				cell = Malloc(sizeof(VG_IndexCell));
+				cell->x = x;
+				cell->y = y;
+				cell->ents = NULL;
+				cell->nEnts = 0;
+				cell->maxEnts = 0;
+				h = HashCell(idx, x,y);
+				cell->next = idx->buckets[h];
+				idx->buckets[h] = cell;
+				idx->nCells++;
+			}
+			AddEnt(&cell->ents, &cell->nEnts, &cell->maxEnts, ent);
+			idx->nEnts++;
+		}
+	}
+	if (empty) {
+		idx->x1 = x1;
+		idx->y1 = y1;
+		idx->x2 = x2;
+		idx->y2 = y2;
+	} else {
+		if (x1 < idx->x1) { idx->x1 = x1; }
+		if (y1 < idx->y1) { idx->y1 = y1; }
+		if (x2 > idx->x2) { idx->x2 = x2; }
+		if (y2 > idx->y2) { idx->y2 = y2; }
+	}
+	return;
+large:
+	AddEnt(&idx->large, &idx->nLarge, &idx->maxLarge, ent);
+	idx->nEnts++;
+}
+
+/* Compute the indexed bounding box of a node. */
+static void
+GetEnt(VG_Index *_Nonnull idx, VG_Node *_Nonnull vn, VG_IndexEnt *_Nonnull ent)
+{
+	float t;
+
+	ent->vn = vn;
+	ent->ver = vn->idxVer;
+	if (vn->ops->extent == NULL) {
+		ent->a.x = ent->a.y = -AG_FLT_MAX;
+		ent->b.x = ent->b.y = +AG_FLT_MAX;
+		return;
+	}
+	vn->ops->extent(vn, idx->vv, &ent->a, &ent->b);
+	if (ent->a.x > ent->b.x) { t = ent->a.x; ent->a.x = ent->b.x; ent->b.x = t; }
+	if (ent->a.y > ent->b.y) { t = ent->a.y; ent->a.y = ent->b.y; ent->b.y = t; }
+}
+
+static void
+Rebuild(VG_Index *_Nonnull idx)
+{
+	VG *vg = idx->vg;
+	VG_IndexEnt *ents;
+	VG_Node *vn;
+	VG_Vector a = { 0.0f, 0.0f }, b = { 0.0f, 0.0f };
+	float dimSum = 0.0f, area, cellSize;
+	Uint i, n = 0, nBounded = 0, nBuckets;
+
+	FreeCells(idx);
+	idx->flags &= ~(VG_INDEX_REBUILD);
+	idx->nDirty = 0;
+	idx->scale = idx->vv->scale;
+
+	TAILQ_FOREACH(vn, &vg->nodes, list) {
+		n++;
+	}
+	ents = (n > 0) ? Malloc(n*sizeof(VG_IndexEnt)) : NULL;
+
+	i = 0;
+	TAILQ_FOREACH(vn, &vg->nodes, list) {
+		VG_IndexEnt *ent = &ents[i++];
+
+		GetEnt(idx, vn, ent);
+		if (VG_INDEX_UNBOUNDED(ent)) {
+			continue;
+		}
+		if (nBounded++ == 0) {
+			a = ent->a;
+			b = ent->b;
+		} else {
+			if (ent->a.x < a.x) { a.x = ent->a.x; }
+			if (ent->a.y < a.y) { a.y = ent->a.y; }
+			if (ent->b.x > b.x) { b.x = ent->b.x; }
+			if (ent->b.y > b.y) { b.y = ent->b.y; }
+		}
+		dimSum += (ent->b.x - ent->a.x) + (ent->b.y - ent->a.y);
+	}
+
+	/*
+	 * Aim for a few nodes per cell, but avoid cells much smaller than
+	 * the typical node.
+	 */
+	cellSize = 0.0f;
+	if (nBounded > 0) {
+		area = (b.x - a.x)*(b.y - a.y);
+		cellSize = 2.0f*VG_Sqrt(area / (float)nBounded);
+		if (dimSum/(float)nBounded > cellSize)
+			cellSize = dimSum/(float)nBounded;
+		if (cellSize < (b.x - a.x)/VG_INDEX_COORD_MAX)
+			cellSize = (b.x - a.x)/VG_INDEX_COORD_MAX;
+		if (cellSize < (b.y - a.y)/VG_INDEX_COORD_MAX)
+			cellSize = (b.y - a.y)/VG_INDEX_COORD_MAX;
+	}
+	if (!(cellSize > 0.0f)) {
+		cellSize = (b.x - a.x) + (b.y - a.y);
+		if (!(cellSize > 0.0f))
+			cellSize = 1.0f;
+	}
+	idx->cellSize = cellSize;
+
+	for (nBuckets = 64; nBuckets < nBounded; nBuckets <<= 1)
+		;;
+	if (nBuckets != idx->nBuckets) {
+		Free(idx->buckets);
+		idx->buckets = Malloc(nBuckets*sizeof(VG_IndexCell *));
+		idx->nBuckets = nBuckets;
+	}
+	memset(idx->buckets, 0, nBuckets*sizeof(VG_IndexCell *));
+
+	for (i = 0; i < n; i++) {
+		InsertEnt(idx, &ents[i]);
+	}
+	idx->nEntsBase = idx->nEnts;
+	idx->nNodes = n;
+	Free(ents);
+}
+
+/*
+ * Bring the index up to date with the VG displayed by the view.
+ * The VG must be locked.
+ */
+void
+VG_IndexUpdate(VG_Index *idx)
+{
+	VG *vg = idx->vv->vg;
+	VG_IndexEnt ent;
+	VG_Node *vn;
+	Uint i, stamp;
+
+	if (idx->vg != vg) {
+		VG_IndexSetVG(idx, vg);
+	}
+	if (vg == NULL) {
+		return;
+	}
+	if (idx->scale != idx->vv->scale ||
+	    idx->nEnts > (idx->nEntsBase << 1) + VG_INDEX_DIRTY_MAX)
+		idx->flags |= VG_INDEX_REBUILD;
+
+	if (idx->flags & VG_INDEX_REBUILD) {
+		Rebuild(idx);
+		return;
+	}
+	if (idx->nDirty == 0) {
+		return;
+	}
+	stamp = ++vg->idxMark;
+	for (i = 0; i < idx->nDirty; i++) {
+		vn = idx->dirty[i];
+		if (vn->idxMark == stamp || vn->parent == NULL) {
+			continue;
+		}
+		vn->idxMark = stamp;
+		GetEnt(idx, vn, &ent);
+		InsertEnt(idx, &ent);
+	}
+	idx->nDirty = 0;
+
+	/* Rebuild if nodes moved far enough to make the grid too sparse. */
+	if ((float)(idx->x2 - idx->x1 + 1)*(float)(idx->y2 - idx->y1 + 1) >
+	    (float)(idx->nNodes << 2) + (float)(VG_INDEX_DIRTY_MAX << 2))
+		Rebuild(idx);
+}
+
+static __inline__ float
+BoxDistance(const VG_IndexEnt *_Nonnull ent, VG_Vector v)
+{
+	float dx = 0.0f, dy = 0.0f;
+
+	if (v.x < ent->a.x)      { dx = ent->a.x - v.x; }
+	else if (v.x > ent->b.x) { dx = v.x - ent->b.x; }
+	if (v.y < ent->a.y)      { dy = ent->a.y - v.y; }
+	else if (v.y > ent->b.y) { dy = v.y - ent->b.y; }
+
+	if (dx == 0.0f) { return (dy); }
+	if (dy == 0.0f) { return (dx); }
+	return VG_Hypot(dx, dy);
+}
+
+static void
+EvalEnt(VG_IndexQuery *_Nonnull q, const VG_IndexEnt *_Nonnull ent)
+{
+	VG_Node *vn = ent->vn;
+	VG_Vector v;
+	float prox;
+
+	if (ent->ver != vn->idxVer || vn->idxMark == q->stamp) {
+		return;
+	}
+	vn->idxMark = q->stamp;
+
+	if (vn == q->ignore || vn->ops->pointProximity == NULL ||
+	    (q->type != NULL && strcmp(vn->ops->name, q->type) != 0))
+		return;
+
+	if (!VG_INDEX_UNBOUNDED(ent)) {
+		float d = BoxDistance(ent, q->pos);
+
+		if (d > 0.0f && d >= q->best)	/* Proximity may be negative */
+			return;
+	}
+
+	v = q->pos;
+	prox = vn->ops->pointProximity(vn, q->idx->vv, &v);
+	if (prox < q->best) {
+		q->best = prox;
+		q->vnBest = vn;
+		q->vBest = v;
+	}
+}
+
+static __inline__ void
+EvalCell(VG_IndexQuery *_Nonnull q, int x, int y)
+{
+	VG_IndexCell *cell;
+	Uint i;
+
+	if ((cell = LookupCell(q->idx, x,y)) == NULL) {
+		return;
+	}
+	for (i = 0; i < cell->nEnts; i++)
+		EvalEnt(q, &cell->ents[i]);
+}
+
+static void
+EvalAllCells(VG_IndexQuery *_Nonnull q)
+{
+	VG_Index *idx = q->idx;
+	VG_IndexCell *cell;
+	Uint i, j;
+
+	for (i = 0; i < idx->nBuckets; i++) {
+		for (cell = idx->buckets[i]; cell != NULL; cell = cell->next) {
+			for (j = 0; j < cell->nEnts; j++)
+				EvalEnt(q, &cell->ents[j]);
+		}
+	}
+}
+
+/*
+ * Return the node closest to vPos (and the closest point on that node
+ * into vC), optionally filtering by class name and ignoring a given node.
+ * Only nodes with a proximity smaller than distMax are considered.
+ */
+VG_Node *
+VG_IndexNearest(VG_Index *idx, VG_Vector vPos, const char *type,
+    void *ignore, float distMax, VG_Vector *vC)
+{
+	VG *vg = idx->vv->vg;
+	VG_IndexQuery q;
+	float cs, d, dMin;
+	int cx, cy, r, rStart, rEnd, x, y, t;
+	Uint i;
+
+	if (vg == NULL) {
+		return (NULL);
+	}
+	VG_Lock(vg);
+	VG_IndexUpdate(idx);
+
+	q.idx = idx;
+	q.pos = vPos;
+	q.type = type;
+	q.ignore = ignore;
+	q.stamp = ++vg->idxMark;
+	q.best = distMax;
+	q.vnBest = NULL;
+	q.vBest = vPos;
+
+	for (i = 0; i < idx->nLarge; i++) {
+		EvalEnt(&q, &idx->large[i]);
+	}
+	if (idx->nCells == 0) {
+		goto out;
+	}
+	cs = idx->cellSize;
+	if (VG_Fabs(vPos.x/cs) >= VG_INDEX_COORD_MAX ||
+	    VG_Fabs(vPos.y/cs) >= VG_INDEX_COORD_MAX) {
+		EvalAllCells(&q);
+		goto out;
+	}
+	cx = CellCoord(idx, vPos.x);
+	cy = CellCoord(idx, vPos.y);
+
+	/* Rings before rStart and after rEnd hold no cells. */
+	rStart = 0;
+	if ((t = idx->x1 - cx) > rStart) { rStart = t; }
+	if ((t = cx - idx->x2) > rStart) { rStart = t; }
+	if ((t = idx->y1 - cy) > rStart) { rStart = t; }
+	if ((t = cy - idx->y2) > rStart) { rStart = t; }
+	rEnd = cx - idx->x1;
+	if ((t = idx->x2 - cx) > rEnd) { rEnd = t; }
+	if ((t = cy - idx->y1) > rEnd) { rEnd = t; }
+	if ((t = idx->y2 - cy) > rEnd) { rEnd = t; }
+
+	for (r = rStart; r <= rEnd; r++) {
+		int xMin, xMax, yMin, yMax;
+
+		if (r > 0) {
+			/*
+			 * Distance to the outside of the rings visited so
+			 * far (a lower bound for any node not yet visited).
+			 */
+			dMin = vPos.x - (float)(cx-r+1)*cs;
+			if ((d = (float)(cx+r)*cs - vPos.x) < dMin) { dMin = d; }
+			if ((d = vPos.y - (float)(cy-r+1)*cs) < dMin) { dMin = d; }
+			if ((d = (float)(cy+r)*cs - vPos.y) < dMin) { dMin = d; }
+			if (dMin >= q.best)
+				break;
+		}
+		xMin = MAX(cx-r, idx->x1);
+		xMax = MIN(cx+r, idx->x2);
+		yMin = MAX(cy-r+1, idx->y1);
+		yMax = MIN(cy+r-1, idx->y2);
+
+		if (cy-r >= idx->y1) {
+			for (x = xMin; x <= xMax; x++)
+				EvalCell(&q, x, cy-r);
+		}
+		if (r > 0 && cy+r <= idx->y2) {
+			for (x = xMin; x <= xMax; x++)
+				EvalCell(&q, x, cy+r);
+		}
+		if (r > 0 && cx-r >= idx->x1) {
+			for (y = yMin; y <= yMax; y++)
+				EvalCell(&q, cx-r, y);
+		}
+		if (r > 0 && cx+r <= idx->x2) {
+			for (y = yMin; y <= yMax; y++)
+				EvalCell(&q, cx+r, y);
+		}
+	}
+out:
+	VG_Unlock(vg);
+	if (vC != NULL) {
+		*vC = q.vBest;
+	}
+	return (q.vnBest);
+}
+
+static __inline__ void
+MarkEnt(const VG_IndexEnt *_Nonnull ent, Uint stamp, VG_Vector a, VG_Vector b)
+{
+	if (ent->ver != ent->vn->idxVer) {
+		return;
+	}
+	if (ent->b.x < a.x || ent->a.x > b.x ||
+	    ent->b.y < a.y || ent->a.y > b.y) {
+		return;
+	}
+	ent->vn->idxMark = stamp;
+}
+
+/*
+ * Set the idxMark of every node whose extent overlaps the rectangle (a,b)
+ * to a new query stamp and return it. Return 0 if all nodes may overlap.
+ */
+Uint
+VG_IndexMarkRect(VG_Index *idx, VG_Vector a, VG_Vector b)
+{
+	VG *vg = idx->vv->vg;
+	VG_IndexCell *cell;
+	int x1, y1, x2, y2, x, y;
+	Uint i, stamp;
+
+	if (vg == NULL) {
+		return (0);
+	}
+	VG_Lock(vg);
+	VG_IndexUpdate(idx);
+
+	x1 = CellCoord(idx, a.x);
+	y1 = CellCoord(idx, a.y);
+	x2 = CellCoord(idx, b.x);
+	y2 = CellCoord(idx, b.y);
+	if (idx->nCells == 0 ||
+	    (x1 < idx->x1 && y1 < idx->y1 && x2 > idx->x2 && y2 > idx->y2)) {
+		VG_Unlock(vg);
+		return (0);
+	}
+	stamp = ++vg->idxMark;
+
+	for (i = 0; i < idx->nLarge; i++) {
+		MarkEnt(&idx->large[i], stamp, a, b);
+	}
+	if (x1 < idx->x1) { x1 = idx->x1; }
+	if (y1 < idx->y1) { y1 = idx->y1; }
+	if (x2 > idx->x2) { x2 = idx->x2; }
+	if (y2 > idx->y2) { y2 = idx->y2; }
+
+	if ((float)(x2-x1+1)*(float)(y2-y1+1) > (float)idx->nCells) {
+		for (i = 0; i < idx->nBuckets; i++) {
+			for (cell = idx->buckets[i];
+			     cell != NULL;
+			     cell = cell->next) {
+				Uint j;
+
+				for (j = 0; j < cell->nEnts; j++)
+					MarkEnt(&cell->ents[j], stamp, a, b);
+			}
+		}
+	} else {
+		for (y = y1; y <= y2; y++) {
+			for (x = x1; x <= x2; x++) {
+				if ((cell = LookupCell(idx, x,y)) == NULL) {
+					continue;
+				}
+				for (i = 0; i < cell->nEnts; i++)
+					MarkEnt(&cell->ents[i], stamp, a, b);
+			}
+		}
+	}
+	VG_Unlock(vg);
+	return (stamp);
+}
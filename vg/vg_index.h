@@ -0,0 +1,68 @@
+/*	Public domain	*/
+
+struct vg_view;
+
+#define VG_INDEX_SPAN_MAX	16	/* Max cells covered by a node */
+#define VG_INDEX_DIRTY_MAX	1024	/* Rebuild beyond this many changes */
+
+/* Indexed bounding box of a node (in VG coordinates). */
+typedef struct vg_index_ent {
+	VG_Node *_Nonnull vn;		/* Indexed node */
+	Uint ver;			/* Node version at insertion time */
+	VG_Vector a, b;			/* Bounding box */
+} VG_IndexEnt;
+
+/* Grid cell (chained in a hash bucket). */
+typedef struct vg_index_cell {
+	int x, y;				/* Cell coordinates */
+	VG_IndexEnt *_Nullable ents;		/* Overlapping nodes */
+	Uint                  nEnts, maxEnts;
+	struct vg_index_cell *_Nullable next;	/* Next in bucket */
+} VG_IndexCell;
+
+/*
+ * Uniform grid over the node extents of a VG, as seen from a VG_View.
+ * It is updated lazily from the list of nodes changed since the last query.
+ */
+typedef struct vg_index {
+	Uint flags;
+#define VG_INDEX_REBUILD 0x01			/* Full rebuild needed */
+
+	struct vg      *_Nullable vg;		/* Indexed drawing (or NULL) */
+	struct vg_view *_Nonnull  vv;		/* View (for extent ops) */
+	float scale;				/* View scale at last rebuild */
+	float cellSize;				/* Cell size in VG units */
+	int   x1, y1, x2, y2;			/* Bounds of nonempty cells */
+
+	VG_IndexCell *_Nullable *_Nullable buckets; /* Hash table of cells */
+	Uint                              nBuckets;
+	Uint                              nCells;
+
+	VG_IndexEnt *_Nullable large;		/* Large/unbounded nodes */
+	Uint                  nLarge, maxLarge;
+
+	VG_Node *_Nonnull *_Nullable dirty;	/* Nodes changed since update */
+	Uint                        nDirty, maxDirty;
+
+	Uint nEnts;				/* Total entries (incl. stale) */
+	Uint nEntsBase;				/* Entries after last rebuild */
+	Uint nNodes;				/* Nodes at last rebuild */
+
+	VG_Node *_Nullable vnHover;		/* Highlighted node */
+
+	AG_TAILQ_ENTRY(vg_index) indices;	/* Entry in VG index list */
+} VG_Index;
+
+__BEGIN_DECLS
+void VG_IndexInit(VG_Index *_Nonnull, struct vg_view *_Nonnull);
+void VG_IndexDestroy(VG_Index *_Nonnull);
+void VG_IndexSetVG(VG_Index *_Nonnull, struct vg *_Nullable);
+void VG_IndexUpdate(VG_Index *_Nonnull);
+void VG_IndexPush(VG_Index *_Nonnull, VG_Node *_Nonnull);
+void VG_IndexInvalidate(VG_Index *_Nonnull, VG_Node *_Nullable);
+
+VG_Node *_Nullable VG_IndexNearest(VG_Index *_Nonnull, VG_Vector,
+                                   const char *_Nullable, void *_Nullable,
+                                   float, VG_Vector *_Nullable);
+Uint VG_IndexMarkRect(VG_Index *_Nonnull, VG_Vector, VG_Vector);
+__END_DECLS
@@ -44,64 +44,6 @@ typedef struct vg_select_tool {
 	VG_Node *vnMouseOver;	/* Element under cursor */
 } VG_SelectTool;
 
-/* Return the entity nearest to vPos. */
-static void *_Nullable
-ProximityQuery(VG_View *_Nonnull vv, VG_Vector vPos)
-{
-	VG *vg = vv->vg;
-	float prox, proxNearest;
-	VG_Node *vn, *vnNearest;
-	VG_Vector v;
-
-#if 0
-	/* First check if we intersect a block. */
-	TAILQ_FOREACH(vn, &vg->nodes, list) {
-		if (!VG_NodeIsClass(vn, "Block")) {
-			continue;
-		}
-		v = vPos;
-		prox = vn->ops->pointProximity(vn, vv, &v);
-		if (prox == 0.0f)
-			return (vn);
-	}
-#endif
-
-	/* Then prioritize points at a fixed distance. */
-	proxNearest = AG_FLT_MAX;
-	vnNearest = NULL;
-	TAILQ_FOREACH(vn, &vg->nodes, list) {
-		if (!VG_NodeIsClass(vn, "Point")) {
-			continue;
-		}
-		v = vPos;
-		prox = vn->ops->pointProximity(vn, vv, &v);
-		if (prox <= vv->pointSelRadius) {
-			if (prox < proxNearest) {
-				proxNearest = prox;
-				vnNearest = vn;
-			}
-		}
-	}
-	if (vnNearest != NULL)
-		return (vnNearest);
-
-	/* Finally, fallback to a general query. */
-	proxNearest = AG_FLT_MAX;
-	vnNearest = NULL;
-	TAILQ_FOREACH(vn, &vg->nodes, list) {
-		if (vn->ops->pointProximity == NULL) {
-			continue;
-		}
-		v = vPos;
-		prox = vn->ops->pointProximity(vn, vv, &v);
-		if (prox < proxNearest) {
-			proxNearest = prox;
-			vnNearest = vn;
-		}
-	}
-	return (vnNearest);
-}
-
 static int
 MouseButtonDown(void *_Nonnull obj, VG_Vector v, int b)
 {
@@ -109,7 +51,7 @@ MouseButtonDown(void *_Nonnull obj, VG_Vector v, int b)
 	VG_View *vv = VGTOOL(t)->vgv;
 	VG_Node *vn;
 
-	if ((vn = ProximityQuery(vv, v)) == NULL)
+	if ((vn = VG_Nearest(vv, v)) == NULL)
 		return (0);
 
 	VG_ClearEditAreas(vv);
@@ -159,7 +101,7 @@ MouseMotion(void *_Nonnull obj, VG_Vector vPos, VG_Vector vRel, int buttons)
 
 	/* Provide visual feedback of current selection. */
 	if ((t->flags & MOVING_ENTITIES) == 0) {
-		if ((vn = ProximityQuery(vv, vPos)) != NULL &&
+		if ((vn = VG_Nearest(vv, vPos)) != NULL &&
 		    t->vnMouseOver != vn) {
 			t->vnMouseOver = vn;
 			VG_Status(vv, _("Select schematic entity: %s%u"),
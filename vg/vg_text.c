@@ -157,6 +157,7 @@ VG_TextString(VG_Text *vt, const char *s)
 	} else {
 		vt->text[0] = '\0';
 	}
+	VG_NodeInvalidate(vt);
 	VG_Unlock(VGNODE(vt)->vg);
 }
 
@@ -174,6 +175,7 @@ VG_TextPrintf(VG_Text *vt, const char *fmt, ...)
 	} else {
 		vt->text[0] = '\0';
 	}
+	VG_NodeInvalidate(vt);
 	VG_Unlock(VGNODE(vt)->vg);
 }
 
@@ -270,18 +272,18 @@ Extent(void *_Nonnull obj, VG_View *_Nonnull vv, VG_Vector *_Nonnull a,
 	VG_Vector v1, v2;
 	int su;
 
-	if ((su = AG_TextCacheGet(vv->tCache, vt->text)) == -1) {
-		a->x = 0.0f;
-		a->y = 0.0f;
-		return;
+	if ((su = AG_TextCacheGet(vv->tCache, vt->text)) != -1) {
+		wText = (float)WSURFACE(vv,su)->w/vv->scale;
+		hText = (float)WSURFACE(vv,su)->h/vv->scale;
+	} else {
+		wText = 0.0f;
+		hText = 0.0f;
 	}
-	wText = (float)WSURFACE(vv,su)->w/vv->scale;
-	hText = (float)WSURFACE(vv,su)->h/vv->scale;
 	v1 = VG_Pos(vt->p1);
 	v2 = VG_Pos(vt->p2);
 	a->x = MIN(v1.x,v2.x) - wText/2.0f;
 	a->y = MIN(v1.y,v2.y) - hText/2.0f;
-	b->x = MAX(v1.x,v2.x) + hText/2.0f;
+	b->x = MAX(v1.x,v2.x) + wText/2.0f;
 	b->y = MAX(v1.y,v2.y) + hText/2.0f;
 }
 
@@ -355,6 +357,12 @@ SelectFontDlg(AG_Event *_Nonnull event)
 		AG_WindowAttach(winParent, win);
 }
 
+static void
+Invalidate(AG_Event *_Nonnull event)
+{
+	VG_NodeInvalidate(AG_PTR(1));
+}
+
 static void *
 Edit(void *_Nonnull obj, VG_View *_Nonnull vv)
 {
@@ -375,6 +383,7 @@ Edit(void *_Nonnull obj, VG_View *_Nonnull vv)
 #else
 	AG_TextboxBindASCII(tb, vt->text, sizeof(vt->text));
 #endif
+	AG_SetEvent(tb, "textbox-postchg", Invalidate, "%p", vt);
 
 	bAlv = AG_BoxNewVertNS(vPane->div[1], AG_BOX_HFILL|AG_BOX_FRAME);
 	AG_LabelNew(bAlv, 0, _("Alignment: "));
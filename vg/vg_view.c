@@ -39,6 +39,8 @@
 #include <stdarg.h>
 #include <string.h>
 
+#define VG_VIEW_CULL_MARGIN 32	/* Extra pixels drawn around the view */
+
 static const float scaleFactors[] = {
 	1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f,
 	12.0f, 14.0f, 16.0f, 18.0f, 20.0f, 22.0f, 24.0f, 26.0f, 28.0f,
@@ -68,71 +70,24 @@ VG_ViewNew(void *parent, VG *vg, Uint flags)
 void *
 VG_NearestPoint(VG_View *vv, VG_Vector vPos, void *ignore)
 {
-	float prox, proxNearest = AG_FLT_MAX;
-	VG_Node *vn, *vnNearest = NULL;
-	VG_Vector v;
-
-	TAILQ_FOREACH(vn, &vv->vg->nodes, list) {
-		if (vn->ops->pointProximity == NULL ||
-		    vn == ignore ||
-		    !VG_NodeIsClass(vn, "Point")) {
-			continue;
-		}
-		v = vPos;
-		prox = vn->ops->pointProximity(vn, vv, &v);
-		if (prox < vv->grid[0].ival) {
-			if (prox < proxNearest) {
-				proxNearest = prox;
-				vnNearest = vn;
-			}
-		}
-	}
-	return (vnNearest);
+	return VG_IndexNearest(&vv->idx, vPos, "Point", ignore,
+	    (float)vv->grid[0].ival, NULL);
 }
 
 /* Return the entity nearest to vPos. */
 void *
 VG_Nearest(VG_View *vv, VG_Vector vPos)
 {
-	VG *vg = vv->vg;
-	float prox, proxNearest;
-	VG_Node *vn, *vnNearest;
-	VG_Vector v;
+	VG_Node *vn;
 
 	/* Prioritize points at a fixed distance. */
-	proxNearest = AG_FLT_MAX;
-	vnNearest = NULL;
-	TAILQ_FOREACH(vn, &vg->nodes, list) {
-		if (!VG_NodeIsClass(vn, "Point")) {
-			continue;
-		}
-		v = vPos;
-		prox = vn->ops->pointProximity(vn, vv, &v);
-		if (prox <= vv->pointSelRadius) {
-			if (prox < proxNearest) {
-				proxNearest = prox;
-				vnNearest = vn;
-			}
-		}
-	}
-	if (vnNearest != NULL)
-		return (vnNearest);
+	vn = VG_IndexNearest(&vv->idx, vPos, "Point", NULL,
+	    (float)vv->pointSelRadius, NULL);
+	if (vn != NULL)
+		return (vn);
 
 	/* Fallback to a general query. */
-	proxNearest = AG_FLT_MAX;
-	vnNearest = NULL;
-	TAILQ_FOREACH(vn, &vg->nodes, list) {
-		if (vn->ops->pointProximity == NULL) {
-			continue;
-		}
-		v = vPos;
-		prox = vn->ops->pointProximity(vn, vv, &v);
-		if (prox < proxNearest) {
-			proxNearest = prox;
-			vnNearest = vn;
-		}
-	}
-	return (vnNearest);
+	return VG_IndexNearest(&vv->idx, vPos, NULL, NULL, AG_FLT_MAX, NULL);
 }
 
 /* Highlight and return the Point nearest to vPos. */
@@ -140,27 +95,27 @@ void *
 VG_HighlightNearestPoint(VG_View *vv, VG_Vector vPos, void *ignore)
 {
 	VG *vg = vv->vg;
-	float prox, proxNearest = AG_FLT_MAX;
-	VG_Node *vn, *vnNearest = NULL;
-	VG_Vector v;
-
-	TAILQ_FOREACH(vn, &vg->nodes, list) {
-		vn->flags &= ~(VG_NODE_MOUSEOVER);
-		if (vn->ops->pointProximity == NULL ||
-		    vn == ignore ||
-		    !VG_NodeIsClass(vn, "Point")) {
-			continue;
+	VG_Node *vn;
+
+	if (vg == NULL) {
+		return (NULL);
+	}
+	vn = VG_IndexNearest(&vv->idx, vPos, "Point", ignore,
+	    (float)vv->grid[0].ival, NULL);
+
+	VG_Lock(vg);
+	if (vv->idx.vnHover != vn) {
+		if (vv->idx.vnHover != NULL) {
+			vv->idx.vnHover->flags &= ~(VG_NODE_MOUSEOVER);
 		}
-		v = vPos;
-		prox = vn->ops->pointProximity(vn, vv, &v);
-		if (prox < vv->grid[0].ival) {
-			if (prox < proxNearest) {
-				proxNearest = prox;
-				vnNearest = vn;
-			}
+		if (vn != NULL) {
+			vn->flags |= VG_NODE_MOUSEOVER;
 		}
+		vv->idx.vnHover = vn;
+		AG_Redraw(vv);
 	}
-	return (vnNearest);
+	VG_Unlock(vg);
+	return (vn);
 }
 
 /*
@@ -465,6 +420,7 @@ Init(void *_Nonnull obj)
 	vv->r.w = 0;
 	vv->r.h = 0;
 	TAILQ_INIT(&vv->tools);
+	VG_IndexInit(&vv->idx, vv);
 
 	vv->nGrids = 0;
 	VG_ViewSetGrid(vv, 0, VG_GRID_POINTS, 8, VG_GetColorRGB(100,100,100));
@@ -511,6 +467,7 @@ Destroy(void *_Nonnull obj)
 {
 	VG_View *vv = obj;
 
+	VG_IndexDestroy(&vv->idx);
 	AG_TextCacheDestroy(vv->tCache);
 }
 
@@ -521,6 +478,7 @@ VG_ViewSetVG(VG_View *vv, VG *vg)
 	AG_ObjectLock(vv);
 	if (vv->vg != vg) {
 		vv->vg = vg;
+		VG_IndexSetVG(&vv->idx, vg);
 		VG_ViewSelectTool(vv, NULL, NULL);
 	}
 	AG_ObjectUnlock(vv);
@@ -717,8 +675,13 @@ DrawNodeExtent(VG_Node *_Nonnull vn, VG_View *_Nonnull vv)
 }
 #endif /* AG_DEBUG */
 
+/*
+ * Draw a node and its children. If stamp is nonzero, skip the nodes not
+ * marked visible by VG_IndexMarkRect().
+ */
 static void
-DrawNode(VG *_Nonnull vg, VG_Node *_Nonnull vn, VG_View *_Nonnull vv)
+DrawNode(VG *_Nonnull vg, VG_Node *_Nonnull vn, VG_View *_Nonnull vv,
+    Uint stamp)
 {
 	VG_Node *vnChld;
 	VG_Color colorSave;
@@ -727,7 +690,12 @@ DrawNode(VG *_Nonnull vg, VG_Node *_Nonnull vn, VG_View *_Nonnull vv)
 	VG_MultMatrix(&vg->T[vg->nT-1], &vn->T);
 
 	VG_FOREACH_CHLD(vnChld, vn, vg_node)
-		DrawNode(vg, vnChld, vv);
+		DrawNode(vg, vnChld, vv, stamp);
+
+	if (stamp != 0 && vn->idxMark != stamp && vn->parent != NULL) {
+		VG_PopMatrix(vg);
+		return;
+	}
 #ifdef AG_DEBUG
 	if (vv->flags & VG_VIEW_EXTENTS)
 		DrawNodeExtent(vn, vv);
@@ -752,6 +720,7 @@ Draw(void *_Nonnull obj)
 	VG *vg = vv->vg;
 	VG_Tool *curtool = vv->curtool;
 	AG_Color c;
+	Uint stamp = 0;
 	int su, i;
 
 	if (vg == NULL)
@@ -781,7 +750,18 @@ Draw(void *_Nonnull obj)
 		curtool->ops->postdraw(curtool, vv);
 	}
 
-	DrawNode(vg, vg->root, vv);
+	if (!(vv->flags & VG_VIEW_NO_CULLING)) {
+		VG_Vector a, b;
+
+		VG_GetVGCoords(vv,
+		    vv->r.x - VG_VIEW_CULL_MARGIN,
+		    vv->r.y - VG_VIEW_CULL_MARGIN, &a);
+		VG_GetVGCoords(vv,
+		    vv->r.x + vv->r.w + VG_VIEW_CULL_MARGIN,
+		    vv->r.y + vv->r.h + VG_VIEW_CULL_MARGIN, &b);
+		stamp = VG_IndexMarkRect(&vv->idx, a, b);
+	}
+	DrawNode(vg, vg->root, vv, stamp);
 
 	VG_Unlock(vg);
 
@@ -16,6 +16,8 @@
 
 #include <agar/vg/begin.h>
 
+#include <agar/vg/vg_index.h>
+
 typedef enum vg_grid_type {
 	VG_GRID_POINTS,
 	VG_GRID_LINES
@@ -43,6 +45,7 @@ typedef struct vg_view {
 #define VG_VIEW_EXTENTS		0x08		/* Display extents (DEBUG) */
 #define VG_VIEW_DISABLE_BG	0x10		/* Enable VG background */
 #define VG_VIEW_CONSTRUCTION	0x20		/* Construction geometry */
+#define VG_VIEW_NO_CULLING	0x40		/* Draw nodes outside of view */
 #define VG_VIEW_EXPAND	(VG_VIEW_HFILL|VG_VIEW_VFILL)
 
 	VG *_Nullable vg;			/* Vector graphics object */
@@ -83,6 +86,7 @@ typedef struct vg_view {
 
 	int pointSelRadius;			/* Point selection threshold */
 	AG_Rect r;				/* View area */
+	VG_Index idx;				/* Spatial index of vg */
 } VG_View;
 
 #define VGVIEW(p) ((VG_View *)(p))